@@ -93,6 +93,9 @@ uint8 GetSwitchPortWakeupReason_FunctionCalled = 0;
 
 Eth_ModeType TrcvModeGlobal = ETH_MODE_ACTIVE;
 
+/* Set by the application from the switch link-change events */
+EthTrcv_LinkStateType TrcvLinkStateGlobal = ETHTRCV_LINK_STATE_DOWN;
+
 /*==================================================================================================
 *                                   LOCAL FUNCTION PROTOTYPES
 ==================================================================================================*/
@@ -306,9 +309,8 @@ Std_ReturnType EthTrcv_StartAutoNegotiation(uint8 TrcvIdx)
 Std_ReturnType EthTrcv_GetLinkState (uint8 TrcvIdx, EthTrcv_LinkStateType * LinkStatePtr)
 {
     (void)TrcvIdx;
-    (void)LinkStatePtr;
     Std_ReturnType checkStatus = (Std_ReturnType)E_OK;
-
+    *LinkStatePtr = TrcvLinkStateGlobal;
     GetLinkState_FunctionCalled++;
 
     return checkStatus;
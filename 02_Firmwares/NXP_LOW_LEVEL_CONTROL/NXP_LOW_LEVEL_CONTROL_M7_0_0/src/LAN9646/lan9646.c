@@ -11,8 +11,12 @@ static lan9646r_t prv_spi_read_reg(lan9646_t* handle, uint16_t reg_addr, uint8_t
 static lan9646r_t prv_spi_write_reg(lan9646_t* handle, uint16_t reg_addr, const uint8_t* data, uint16_t len);
 static lan9646r_t prv_i2c_read_reg(lan9646_t* handle, uint16_t reg_addr, uint8_t* data, uint16_t len);
 static lan9646r_t prv_i2c_write_reg(lan9646_t* handle, uint16_t reg_addr, const uint8_t* data, uint16_t len);
-static lan9646r_t prv_miim_read_reg(lan9646_t* handle, uint16_t reg_addr, uint8_t* data, uint16_t len);
-static lan9646r_t prv_miim_write_reg(lan9646_t* handle, uint16_t reg_addr, const uint8_t* data, uint16_t len);
+static lan9646r_t prv_miim_read_reg(lan9646_t* handle, const lan9646_miim_t* miim, uint16_t reg_addr,
+                                    uint8_t* data, uint16_t len);
+static lan9646r_t prv_miim_write_reg(lan9646_t* handle, const lan9646_miim_t* miim, uint16_t reg_addr,
+                                     const uint8_t* data, uint16_t len);
+static lan9646r_t prv_read(lan9646_t* handle, uint16_t reg_addr, uint8_t* data, uint16_t len);
+static lan9646r_t prv_write(lan9646_t* handle, uint16_t reg_addr, const uint8_t* data, uint16_t len);
 
 /**
  * \brief           Initialize LAN9646 device
@@ -26,6 +30,9 @@ lan9646_init(lan9646_t* handle, const lan9646_cfg_t* cfg) {
     }
 
     memcpy(&handle->cfg, cfg, sizeof(lan9646_cfg_t));
+    handle->shadow = NULL;
+    handle->phy_bus = NULL;
+    handle->phy_bus_ops = 0;
 
     switch (cfg->if_type) {
         case LAN9646_IF_SPI:
@@ -72,6 +79,19 @@ lan9646_deinit(lan9646_t* handle) {
     return lan9646OK;
 }
 
+/**
+ * \brief           Build the 32-bit SPI command word
+ */
+static void
+prv_spi_cmd(uint8_t op, uint16_t reg_addr, uint8_t cmd_buf[LAN9646_SPI_CMD_LEN]) {
+    uint32_t cmd = LAN9646_SPI_CMD(op, reg_addr);
+
+    cmd_buf[0] = (uint8_t)(cmd >> 24);
+    cmd_buf[1] = (uint8_t)(cmd >> 16);
+    cmd_buf[2] = (uint8_t)(cmd >> 8);
+    cmd_buf[3] = (uint8_t)cmd;
+}
+
 /**
  * \brief           SPI read register implementation
  */
@@ -79,22 +99,23 @@ static lan9646r_t
 prv_spi_read_reg(lan9646_t* handle, uint16_t reg_addr, uint8_t* data, uint16_t len) {
     lan9646_spi_t* spi;
     lan9646r_t res;
-    uint8_t cmd_buf[4];
+    uint8_t cmd_buf[LAN9646_SPI_CMD_LEN];
 
     spi = &handle->cfg.ops.spi;
+    prv_spi_cmd(LAN9646_SPI_CMD_READ, reg_addr, cmd_buf);
+
+    /* Command and data in one frame, the whole burst in one transfer */
+    if (spi->frame_fn != NULL) {
+        return spi->frame_fn(cmd_buf, LAN9646_SPI_CMD_LEN, NULL, data, len);
+    }
 
     if (spi->cs_low_fn == NULL || spi->cs_high_fn == NULL || spi->transfer_fn == NULL) {
         return lan9646INVPARAM;
     }
 
-    cmd_buf[0] = LAN9646_SPI_CMD_READ;
-    cmd_buf[1] = (uint8_t)(reg_addr >> 8);
-    cmd_buf[2] = (uint8_t)(reg_addr & 0xFF);
-    cmd_buf[3] = 0x00;
-
     spi->cs_low_fn();
 
-    res = spi->transfer_fn(cmd_buf, NULL, 4);
+    res = spi->transfer_fn(cmd_buf, NULL, LAN9646_SPI_CMD_LEN);
     if (res != lan9646OK) {
         spi->cs_high_fn();
         return res;
@@ -113,21 +134,22 @@ static lan9646r_t
 prv_spi_write_reg(lan9646_t* handle, uint16_t reg_addr, const uint8_t* data, uint16_t len) {
     lan9646_spi_t* spi;
     lan9646r_t res;
-    uint8_t cmd_buf[3];
+    uint8_t cmd_buf[LAN9646_SPI_CMD_LEN];
 
     spi = &handle->cfg.ops.spi;
+    prv_spi_cmd(LAN9646_SPI_CMD_WRITE, reg_addr, cmd_buf);
+
+    if (spi->frame_fn != NULL) {
+        return spi->frame_fn(cmd_buf, LAN9646_SPI_CMD_LEN, data, NULL, len);
+    }
 
     if (spi->cs_low_fn == NULL || spi->cs_high_fn == NULL || spi->write_fn == NULL) {
         return lan9646INVPARAM;
     }
 
-    cmd_buf[0] = LAN9646_SPI_CMD_WRITE;
-    cmd_buf[1] = (uint8_t)(reg_addr >> 8);
-    cmd_buf[2] = (uint8_t)(reg_addr & 0xFF);
-
     spi->cs_low_fn();
 
-    res = spi->write_fn(cmd_buf, 3);
+    res = spi->write_fn(cmd_buf, LAN9646_SPI_CMD_LEN);
     if (res != lan9646OK) {
         spi->cs_high_fn();
         return res;
@@ -184,53 +206,257 @@ prv_i2c_write_reg(lan9646_t* handle, uint16_t reg_addr, const uint8_t* data, uin
 }
 
 /**
- * \brief           MIIM read register implementation
+ * \brief           Translate a PHY window register to its MDIO address
  */
-static lan9646r_t
-prv_miim_read_reg(lan9646_t* handle, uint16_t reg_addr, uint8_t* data, uint16_t len) {
-    lan9646_miim_t* miim;
-    lan9646r_t res;
-    uint16_t val;
+bool
+lan9646_miim_xlate(uint16_t reg_addr, uint8_t phy_base, uint8_t* phy_addr, uint8_t* reg) {
+    uint8_t port = (uint8_t)(reg_addr >> 12);
+    uint16_t offs = reg_addr & 0x0FFF;
 
-    if (len != 2) {
+    if (port < 1 || port > 4 || (reg_addr & 1U)
+        || offs < LAN9646_PHY_WINDOW_FIRST
+        || offs >= LAN9646_PHY_WINDOW_FIRST + LAN9646_PHY_WINDOW_LEN) {
+        return false;
+    }
+    if (phy_addr != NULL) {
+        *phy_addr = (uint8_t)((phy_base + port - 1U) & 0x1FU);
+    }
+    if (reg != NULL) {
+        *reg = (uint8_t)((offs - LAN9646_PHY_WINDOW_FIRST) >> 1);
+    }
+    return true;
+}
+
+/**
+ * \brief           MIIM read register implementation, one MDIO frame per 16 bits
+ */
+static lan9646r_t
+prv_miim_read_reg(lan9646_t* handle, const lan9646_miim_t* miim, uint16_t reg_addr,
+                  uint8_t* data, uint16_t len) {
+    lan9646r_t res = lan9646OK;
+    uint8_t phy, reg;
+    uint16_t i, val;
+
+    if (miim->read_fn == NULL || len == 0 || (len & 1U)
+        || !lan9646_miim_xlate((uint16_t)(reg_addr + len - 2U), handle->cfg.phy_addr, NULL, NULL)
+        || !lan9646_miim_xlate(reg_addr, handle->cfg.phy_addr, &phy, &reg)) {
         return lan9646INVPARAM;
     }
 
-    miim = &handle->cfg.ops.miim;
+    for (i = 0; i < len && res == lan9646OK; i += 2U) {
+        res = miim->read_fn(phy, (uint8_t)(reg + (i >> 1)), &val);
+        if (res == lan9646OK) {
+            data[i] = (uint8_t)(val >> 8);
+            data[i + 1U] = (uint8_t)(val & 0xFF);
+        }
+    }
 
-    if (miim->read_fn == NULL) {
+    return res;
+}
+
+/**
+ * \brief           MIIM write register implementation, one MDIO frame per 16 bits
+ */
+static lan9646r_t
+prv_miim_write_reg(lan9646_t* handle, const lan9646_miim_t* miim, uint16_t reg_addr,
+                   const uint8_t* data, uint16_t len) {
+    lan9646r_t res = lan9646OK;
+    uint8_t phy, reg;
+    uint16_t i, val;
+
+    if (miim->write_fn == NULL || len == 0 || (len & 1U)
+        || !lan9646_miim_xlate((uint16_t)(reg_addr + len - 2U), handle->cfg.phy_addr, NULL, NULL)
+        || !lan9646_miim_xlate(reg_addr, handle->cfg.phy_addr, &phy, &reg)) {
         return lan9646INVPARAM;
     }
 
-    res = miim->read_fn(handle->cfg.phy_addr, (uint8_t)(reg_addr & 0x1F), &val);
-    if (res == lan9646OK) {
-        data[0] = (uint8_t)(val >> 8);
-        data[1] = (uint8_t)(val & 0xFF);
+    for (i = 0; i < len && res == lan9646OK; i += 2U) {
+        val = ((uint16_t)data[i] << 8) | data[i + 1U];
+        res = miim->write_fn(phy, (uint8_t)(reg + (i >> 1)), val);
     }
 
     return res;
 }
 
 /**
- * \brief           MIIM write register implementation
+ * \brief           True when the access goes over the PHY MDIO route: whole
+ *                  16-bit registers inside one port's PHY window
+ */
+static bool
+prv_use_phy_bus(const lan9646_t* handle, uint16_t reg_addr, uint16_t len) {
+    return handle->phy_bus != NULL && len > 0 && (len & 1U) == 0
+           && lan9646_miim_xlate(reg_addr, handle->cfg.phy_addr, NULL, NULL)
+           && lan9646_miim_xlate((uint16_t)(reg_addr + len - 2U), handle->cfg.phy_addr, NULL, NULL);
+}
+
+/**
+ * \brief           Bus access for the configured interface; PHY registers
+ *                  take the MDIO route when one is set
  */
 static lan9646r_t
-prv_miim_write_reg(lan9646_t* handle, uint16_t reg_addr, const uint8_t* data, uint16_t len) {
-    lan9646_miim_t* miim;
-    uint16_t val;
+prv_bus_read(lan9646_t* handle, uint16_t reg_addr, uint8_t* data, uint16_t len) {
+    if (prv_use_phy_bus(handle, reg_addr, len)) {
+        handle->phy_bus_ops++;
+        return prv_miim_read_reg(handle, handle->phy_bus, reg_addr, data, len);
+    }
 
-    if (len != 2) {
-        return lan9646INVPARAM;
+    if (handle->shadow != NULL) {
+        handle->shadow->stats.bus_reads++;
     }
 
-    miim = &handle->cfg.ops.miim;
+    switch (handle->cfg.if_type) {
+        case LAN9646_IF_SPI: return prv_spi_read_reg(handle, reg_addr, data, len);
+        case LAN9646_IF_I2C: return prv_i2c_read_reg(handle, reg_addr, data, len);
+        case LAN9646_IF_MIIM: return prv_miim_read_reg(handle, &handle->cfg.ops.miim, reg_addr, data, len);
+        default: return lan9646ERR;
+    }
+}
 
-    if (miim->write_fn == NULL) {
-        return lan9646INVPARAM;
+static lan9646r_t
+prv_bus_write(lan9646_t* handle, uint16_t reg_addr, const uint8_t* data, uint16_t len) {
+    if (prv_use_phy_bus(handle, reg_addr, len)) {
+        handle->phy_bus_ops++;
+        return prv_miim_write_reg(handle, handle->phy_bus, reg_addr, data, len);
+    }
+
+    if (handle->shadow != NULL) {
+        handle->shadow->stats.bus_writes++;
+    }
+
+    switch (handle->cfg.if_type) {
+        case LAN9646_IF_SPI: return prv_spi_write_reg(handle, reg_addr, data, len);
+        case LAN9646_IF_I2C: return prv_i2c_write_reg(handle, reg_addr, data, len);
+        case LAN9646_IF_MIIM: return prv_miim_write_reg(handle, &handle->cfg.ops.miim, reg_addr, data, len);
+        default: return lan9646ERR;
     }
+}
+
+#define BIT_GET(map, i)     (((map)[(i) >> 3] >> ((i) & 7U)) & 1U)
+#define BIT_SET(map, i)     ((map)[(i) >> 3] |= (uint8_t)(1U << ((i) & 7U)))
+#define BIT_CLR(map, i)     ((map)[(i) >> 3] &= (uint8_t)~(1U << ((i) & 7U)))
+
+/**
+ * \brief           Shadow slot of one register byte
+ * \param[out]      cls: Class of the address, may be NULL
+ * \return          Index into shadow data, -1 if the byte is not cacheable
+ */
+static int16_t
+prv_sh_slot(const lan9646_shadow_t* sh, uint16_t addr, lan9646_reg_class_t* cls) {
+    uint8_t i;
 
-    val = ((uint16_t)data[0] << 8) | data[1];
-    return miim->write_fn(handle->cfg.phy_addr, (uint8_t)(reg_addr & 0x1F), val);
+    for (i = 0; i < sh->nranges; i++) {
+        const lan9646_reg_range_t* r = &sh->ranges[i];
+
+        if (addr >= r->addr && (uint16_t)(addr - r->addr) < r->len) {
+            if (cls != NULL) {
+                *cls = r->cls;
+            }
+            return (r->cls == LAN9646_REG_CACHEABLE)
+                   ? (int16_t)(sh->offs[i] + (addr - r->addr)) : -1;
+        }
+    }
+    if (cls != NULL) {
+        *cls = LAN9646_REG_VOLATILE;
+    }
+    return -1;
+}
+
+/**
+ * \brief           Shadow-aware read: served from memory when every byte is
+ *                  cached, otherwise read from the bus and cached
+ */
+static lan9646r_t
+prv_read(lan9646_t* handle, uint16_t reg_addr, uint8_t* data, uint16_t len) {
+    lan9646_shadow_t* sh = handle->shadow;
+    lan9646r_t res;
+    bool cached = false;
+    uint16_t i;
+    int16_t s;
+
+    if (sh == NULL) {
+        return prv_bus_read(handle, reg_addr, data, len);
+    }
+
+    for (i = 0; i < len; i++) {
+        s = prv_sh_slot(sh, (uint16_t)(reg_addr + i), NULL);
+        if (s < 0 || !BIT_GET(sh->valid, (uint16_t)s)) break;
+    }
+    if (i == len) {
+        for (i = 0; i < len; i++) {
+            data[i] = sh->data[prv_sh_slot(sh, (uint16_t)(reg_addr + i), NULL)];
+        }
+        sh->stats.hits++;
+        return lan9646OK;
+    }
+
+    res = prv_bus_read(handle, reg_addr, data, len);
+    if (res != lan9646OK) {
+        return res;
+    }
+
+    for (i = 0; i < len; i++) {
+        s = prv_sh_slot(sh, (uint16_t)(reg_addr + i), NULL);
+        if (s < 0) continue;
+        cached = true;
+        if (BIT_GET(sh->dirty, (uint16_t)s)) {
+            /* Not written back yet: the shadow is newer than the device */
+            data[i] = sh->data[s];
+        } else {
+            sh->data[s] = data[i];
+            BIT_SET(sh->valid, (uint16_t)s);
+        }
+    }
+    if (cached) {
+        sh->stats.misses++;
+    }
+    return lan9646OK;
+}
+
+/**
+ * \brief           Shadow-aware write: write-through, or held as dirty in
+ *                  write-back mode when every byte is cacheable
+ */
+static lan9646r_t
+prv_write(lan9646_t* handle, uint16_t reg_addr, const uint8_t* data, uint16_t len) {
+    lan9646_shadow_t* sh = handle->shadow;
+    lan9646r_t res;
+    bool all_cached = true;
+    uint16_t i;
+    int16_t s;
+
+    if (sh == NULL) {
+        return prv_bus_write(handle, reg_addr, data, len);
+    }
+
+    for (i = 0; i < len; i++) {
+        s = prv_sh_slot(sh, (uint16_t)(reg_addr + i), NULL);
+        if (s < 0) {
+            all_cached = false;
+            continue;
+        }
+        sh->data[s] = data[i];
+        BIT_SET(sh->valid, (uint16_t)s);
+    }
+
+    if (sh->write_back && all_cached) {
+        for (i = 0; i < len; i++) {
+            BIT_SET(sh->dirty, (uint16_t)prv_sh_slot(sh, (uint16_t)(reg_addr + i), NULL));
+        }
+        sh->stats.deferred++;
+        return lan9646OK;
+    }
+
+    res = prv_bus_write(handle, reg_addr, data, len);
+    for (i = 0; i < len; i++) {
+        s = prv_sh_slot(sh, (uint16_t)(reg_addr + i), NULL);
+        if (s < 0) continue;
+        BIT_CLR(sh->dirty, (uint16_t)s);
+        if (res != lan9646OK) {
+            /* Device state unknown */
+            BIT_CLR(sh->valid, (uint16_t)s);
+        }
+    }
+    return res;
 }
 
 /**
@@ -238,16 +464,12 @@ prv_miim_write_reg(lan9646_t* handle, uint16_t reg_addr, const uint8_t* data, ui
  */
 lan9646r_t
 lan9646_read_reg8(lan9646_t* handle, uint16_t reg_addr, uint8_t* data) {
-    if (handle == NULL || data == NULL || !handle->is_init) {
+    if (handle == NULL || data == NULL || !handle->is_init
+        || handle->cfg.if_type == LAN9646_IF_MIIM) {
         return lan9646INVPARAM;
     }
 
-    switch (handle->cfg.if_type) {
-        case LAN9646_IF_SPI: return prv_spi_read_reg(handle, reg_addr, data, 1);
-        case LAN9646_IF_I2C: return prv_i2c_read_reg(handle, reg_addr, data, 1);
-        case LAN9646_IF_MIIM: return lan9646INVPARAM;
-        default: return lan9646ERR;
-    }
+    return prv_read(handle, reg_addr, data, 1);
 }
 
 /**
@@ -255,16 +477,11 @@ lan9646_read_reg8(lan9646_t* handle, uint16_t reg_addr, uint8_t* data) {
  */
 lan9646r_t
 lan9646_write_reg8(lan9646_t* handle, uint16_t reg_addr, uint8_t data) {
-    if (handle == NULL || !handle->is_init) {
+    if (handle == NULL || !handle->is_init || handle->cfg.if_type == LAN9646_IF_MIIM) {
         return lan9646INVPARAM;
     }
 
-    switch (handle->cfg.if_type) {
-        case LAN9646_IF_SPI: return prv_spi_write_reg(handle, reg_addr, &data, 1);
-        case LAN9646_IF_I2C: return prv_i2c_write_reg(handle, reg_addr, &data, 1);
-        case LAN9646_IF_MIIM: return lan9646INVPARAM;
-        default: return lan9646ERR;
-    }
+    return prv_write(handle, reg_addr, &data, 1);
 }
 
 /**
@@ -279,13 +496,7 @@ lan9646_read_reg16(lan9646_t* handle, uint16_t reg_addr, uint16_t* data) {
         return lan9646INVPARAM;
     }
 
-    switch (handle->cfg.if_type) {
-        case LAN9646_IF_SPI: res = prv_spi_read_reg(handle, reg_addr, buf, 2); break;
-        case LAN9646_IF_I2C: res = prv_i2c_read_reg(handle, reg_addr, buf, 2); break;
-        case LAN9646_IF_MIIM: res = prv_miim_read_reg(handle, reg_addr, buf, 2); break;
-        default: return lan9646ERR;
-    }
-
+    res = prv_read(handle, reg_addr, buf, 2);
     if (res == lan9646OK) {
         *data = ((uint16_t)buf[0] << 8) | buf[1];
     }
@@ -307,12 +518,7 @@ lan9646_write_reg16(lan9646_t* handle, uint16_t reg_addr, uint16_t data) {
     buf[0] = (uint8_t)(data >> 8);
     buf[1] = (uint8_t)(data & 0xFF);
 
-    switch (handle->cfg.if_type) {
-        case LAN9646_IF_SPI: return prv_spi_write_reg(handle, reg_addr, buf, 2);
-        case LAN9646_IF_I2C: return prv_i2c_write_reg(handle, reg_addr, buf, 2);
-        case LAN9646_IF_MIIM: return prv_miim_write_reg(handle, reg_addr, buf, 2);
-        default: return lan9646ERR;
-    }
+    return prv_write(handle, reg_addr, buf, 2);
 }
 
 /**
@@ -323,17 +529,12 @@ lan9646_read_reg32(lan9646_t* handle, uint16_t reg_addr, uint32_t* data) {
     lan9646r_t res;
     uint8_t buf[4];
 
-    if (handle == NULL || data == NULL || !handle->is_init) {
+    if (handle == NULL || data == NULL || !handle->is_init
+        || handle->cfg.if_type == LAN9646_IF_MIIM) {
         return lan9646INVPARAM;
     }
 
-    switch (handle->cfg.if_type) {
-        case LAN9646_IF_SPI: res = prv_spi_read_reg(handle, reg_addr, buf, 4); break;
-        case LAN9646_IF_I2C: res = prv_i2c_read_reg(handle, reg_addr, buf, 4); break;
-        case LAN9646_IF_MIIM: return lan9646INVPARAM;
-        default: return lan9646ERR;
-    }
-
+    res = prv_read(handle, reg_addr, buf, 4);
     if (res == lan9646OK) {
         *data = ((uint32_t)buf[0] << 24) | ((uint32_t)buf[1] << 16) |
                 ((uint32_t)buf[2] << 8) | buf[3];
@@ -349,7 +550,7 @@ lan9646r_t
 lan9646_write_reg32(lan9646_t* handle, uint16_t reg_addr, uint32_t data) {
     uint8_t buf[4];
 
-    if (handle == NULL || !handle->is_init) {
+    if (handle == NULL || !handle->is_init || handle->cfg.if_type == LAN9646_IF_MIIM) {
         return lan9646INVPARAM;
     }
 
@@ -358,12 +559,7 @@ lan9646_write_reg32(lan9646_t* handle, uint16_t reg_addr, uint32_t data) {
     buf[2] = (uint8_t)(data >> 8);
     buf[3] = (uint8_t)(data & 0xFF);
 
-    switch (handle->cfg.if_type) {
-        case LAN9646_IF_SPI: return prv_spi_write_reg(handle, reg_addr, buf, 4);
-        case LAN9646_IF_I2C: return prv_i2c_write_reg(handle, reg_addr, buf, 4);
-        case LAN9646_IF_MIIM: return lan9646INVPARAM;
-        default: return lan9646ERR;
-    }
+    return prv_write(handle, reg_addr, buf, 4);
 }
 
 /**
@@ -371,16 +567,12 @@ lan9646_write_reg32(lan9646_t* handle, uint16_t reg_addr, uint32_t data) {
  */
 lan9646r_t
 lan9646_read_burst(lan9646_t* handle, uint16_t reg_addr, uint8_t* data, uint16_t len) {
-    if (handle == NULL || data == NULL || !handle->is_init || len == 0) {
+    if (handle == NULL || data == NULL || !handle->is_init || len == 0
+        || handle->cfg.if_type == LAN9646_IF_MIIM) {
         return lan9646INVPARAM;
     }
 
-    switch (handle->cfg.if_type) {
-        case LAN9646_IF_SPI: return prv_spi_read_reg(handle, reg_addr, data, len);
-        case LAN9646_IF_I2C: return prv_i2c_read_reg(handle, reg_addr, data, len);
-        case LAN9646_IF_MIIM: return lan9646INVPARAM;
-        default: return lan9646ERR;
-    }
+    return prv_read(handle, reg_addr, data, len);
 }
 
 /**
@@ -388,16 +580,12 @@ lan9646_read_burst(lan9646_t* handle, uint16_t reg_addr, uint8_t* data, uint16_t
  */
 lan9646r_t
 lan9646_write_burst(lan9646_t* handle, uint16_t reg_addr, const uint8_t* data, uint16_t len) {
-    if (handle == NULL || data == NULL || !handle->is_init || len == 0) {
+    if (handle == NULL || data == NULL || !handle->is_init || len == 0
+        || handle->cfg.if_type == LAN9646_IF_MIIM) {
         return lan9646INVPARAM;
     }
 
-    switch (handle->cfg.if_type) {
-        case LAN9646_IF_SPI: return prv_spi_write_reg(handle, reg_addr, data, len);
-        case LAN9646_IF_I2C: return prv_i2c_write_reg(handle, reg_addr, data, len);
-        case LAN9646_IF_MIIM: return lan9646INVPARAM;
-        default: return lan9646ERR;
-    }
+    return prv_write(handle, reg_addr, data, len);
 }
 
 /**
@@ -495,8 +683,323 @@ lan9646_soft_reset(lan9646_t* handle) {
         return lan9646INVPARAM;
     }
 
+    /* Registers return to their defaults, the shadow is stale */
+    lan9646_shadow_invalidate(handle, 0, 0);
+
     /* Set soft reset bit (bit 0) in register 0x0003 */
     return lan9646_modify_reg8(handle, LAN9646_REG_GLOBAL_CTRL,
                                LAN9646_GLOBAL_SW_RESET, LAN9646_GLOBAL_SW_RESET);
 }
 
+/*===========================================================================*/
+/*                           PHY MDIO ROUTE                                   */
+/*===========================================================================*/
+
+/**
+ * \brief           Route PHY window accesses over MDIO
+ */
+lan9646r_t
+lan9646_set_phy_bus(lan9646_t* handle, const lan9646_miim_t* miim) {
+    lan9646r_t res = lan9646OK;
+    uint8_t port, phy, reg, buf[4];
+    uint16_t id1, id2;
+
+    if (handle == NULL || !handle->is_init
+        || (miim != NULL && (miim->read_fn == NULL || miim->write_fn == NULL))) {
+        return lan9646INVPARAM;
+    }
+
+    /* Every PHY must answer on MDIO with the ID the main bus reads from its window */
+    handle->phy_bus = NULL;
+    for (port = 1; miim != NULL && port <= 4U && res == lan9646OK; port++) {
+        (void)lan9646_miim_xlate(LAN9646_REG_PORT_PHY_ID_H(port), handle->cfg.phy_addr, &phy, &reg);
+        res = prv_bus_read(handle, LAN9646_REG_PORT_PHY_ID_H(port), buf, sizeof(buf));
+        if (res == lan9646OK) res = miim->read_fn(phy, reg, &id1);
+        if (res == lan9646OK) res = miim->read_fn(phy, (uint8_t)(reg + 1U), &id2);
+        if (res == lan9646OK
+            && (id1 != (((uint16_t)buf[0] << 8) | buf[1]) || id2 != (((uint16_t)buf[2] << 8) | buf[3])
+                || id1 == 0xFFFF || id1 == 0x0000)) {
+            res = lan9646ERR;
+        }
+    }
+
+    if (res == lan9646OK) {
+        handle->phy_bus = miim;
+    }
+    return res;
+}
+
+/**
+ * \brief           MIIM backend serving the PHYs: the MDIO route or the
+ *                  main bus in MIIM mode, NULL if neither
+ */
+static const lan9646_miim_t*
+prv_phy_miim(const lan9646_t* handle) {
+    if (handle->phy_bus != NULL) {
+        return handle->phy_bus;
+    }
+    return (handle->cfg.if_type == LAN9646_IF_MIIM) ? &handle->cfg.ops.miim : NULL;
+}
+
+/**
+ * \brief           Read a PHY MMD register: Clause 45 frame when the backend
+ *                  has one, else indirect through MMD setup/data
+ */
+lan9646r_t
+lan9646_phy_mmd_read(lan9646_t* handle, uint8_t port, uint8_t devad, uint16_t reg, uint16_t* data) {
+    const lan9646_miim_t* miim;
+    lan9646r_t res;
+
+    if (handle == NULL || data == NULL || !handle->is_init || port < 1 || port > 4
+        || devad > LAN9646_MMD_DEVAD_MASK) {
+        return lan9646INVPARAM;
+    }
+
+    miim = prv_phy_miim(handle);
+    if (miim != NULL && miim->mmd_read_fn != NULL) {
+        handle->phy_bus_ops++;
+        return miim->mmd_read_fn((uint8_t)((handle->cfg.phy_addr + port - 1U) & 0x1FU),
+                                 devad, reg, data);
+    }
+
+    res = lan9646_write_reg16(handle, LAN9646_REG_PORT_PHY_MMD_SETUP(port),
+                              LAN9646_MMD_FUNC_ADDR | devad);
+    if (res != lan9646OK) return res;
+    res = lan9646_write_reg16(handle, LAN9646_REG_PORT_PHY_MMD_DATA(port), reg);
+    if (res != lan9646OK) return res;
+    res = lan9646_write_reg16(handle, LAN9646_REG_PORT_PHY_MMD_SETUP(port),
+                              LAN9646_MMD_FUNC_DATA | devad);
+    if (res != lan9646OK) return res;
+    return lan9646_read_reg16(handle, LAN9646_REG_PORT_PHY_MMD_DATA(port), data);
+}
+
+/**
+ * \brief           Write a PHY MMD register
+ */
+lan9646r_t
+lan9646_phy_mmd_write(lan9646_t* handle, uint8_t port, uint8_t devad, uint16_t reg, uint16_t data) {
+    const lan9646_miim_t* miim;
+    lan9646r_t res;
+
+    if (handle == NULL || !handle->is_init || port < 1 || port > 4
+        || devad > LAN9646_MMD_DEVAD_MASK) {
+        return lan9646INVPARAM;
+    }
+
+    miim = prv_phy_miim(handle);
+    if (miim != NULL && miim->mmd_write_fn != NULL) {
+        handle->phy_bus_ops++;
+        return miim->mmd_write_fn((uint8_t)((handle->cfg.phy_addr + port - 1U) & 0x1FU),
+                                  devad, reg, data);
+    }
+
+    res = lan9646_write_reg16(handle, LAN9646_REG_PORT_PHY_MMD_SETUP(port),
+                              LAN9646_MMD_FUNC_ADDR | devad);
+    if (res != lan9646OK) return res;
+    res = lan9646_write_reg16(handle, LAN9646_REG_PORT_PHY_MMD_DATA(port), reg);
+    if (res != lan9646OK) return res;
+    res = lan9646_write_reg16(handle, LAN9646_REG_PORT_PHY_MMD_SETUP(port),
+                              LAN9646_MMD_FUNC_DATA | devad);
+    if (res != lan9646OK) return res;
+    return lan9646_write_reg16(handle, LAN9646_REG_PORT_PHY_MMD_DATA(port), data);
+}
+
+/*===========================================================================*/
+/*                           REGISTER SHADOW                                  */
+/*===========================================================================*/
+
+/**
+ * \brief           Attach a register shadow cache
+ */
+lan9646r_t
+lan9646_shadow_attach(lan9646_t* handle, lan9646_shadow_t* shadow,
+                      const lan9646_reg_range_t* ranges, uint8_t count) {
+    uint32_t off = 0;
+    uint8_t i;
+
+    if (handle == NULL || shadow == NULL || (ranges == NULL && count > 0)
+        || count > LAN9646_SHADOW_MAX_RANGES) {
+        return lan9646INVPARAM;
+    }
+
+    memset(shadow, 0, sizeof(*shadow));
+    for (i = 0; i < count; i++) {
+        shadow->offs[i] = (uint16_t)off;
+        if (ranges[i].cls == LAN9646_REG_CACHEABLE) {
+            off += ranges[i].len;
+        }
+    }
+    if (off > LAN9646_SHADOW_BYTES) {
+        return lan9646INVPARAM;
+    }
+
+    shadow->ranges = ranges;
+    shadow->nranges = count;
+    handle->shadow = shadow;
+    return lan9646OK;
+}
+
+/**
+ * \brief           Select write-through or write-back
+ */
+lan9646r_t
+lan9646_shadow_set_write_back(lan9646_t* handle, bool enable) {
+    lan9646r_t res = lan9646OK;
+
+    if (handle == NULL || handle->shadow == NULL) {
+        return lan9646INVPARAM;
+    }
+
+    if (!enable && handle->shadow->write_back) {
+        res = lan9646_shadow_sync(handle);
+    }
+    if (res == lan9646OK) {
+        handle->shadow->write_back = enable;
+    }
+    return res;
+}
+
+/**
+ * \brief           Write dirty bytes back, one burst per contiguous run
+ */
+lan9646r_t
+lan9646_shadow_sync(lan9646_t* handle) {
+    lan9646_shadow_t* sh;
+    lan9646r_t res;
+    uint16_t j, start, base;
+    uint8_t i;
+
+    if (handle == NULL || !handle->is_init || handle->shadow == NULL) {
+        return lan9646INVPARAM;
+    }
+    sh = handle->shadow;
+
+    for (i = 0; i < sh->nranges; i++) {
+        const lan9646_reg_range_t* r = &sh->ranges[i];
+
+        if (r->cls != LAN9646_REG_CACHEABLE) continue;
+
+        base = sh->offs[i];
+        j = 0;
+        while (j < r->len) {
+            if (!BIT_GET(sh->dirty, (uint16_t)(base + j))) {
+                j++;
+                continue;
+            }
+            start = j;
+            while (j < r->len && BIT_GET(sh->dirty, (uint16_t)(base + j))) {
+                j++;
+            }
+
+            res = prv_bus_write(handle, (uint16_t)(r->addr + start), &sh->data[base + start],
+                                (uint16_t)(j - start));
+            if (res != lan9646OK) {
+                return res;
+            }
+            sh->stats.flushes++;
+            for (; start < j; start++) {
+                BIT_CLR(sh->dirty, (uint16_t)(base + start));
+            }
+        }
+    }
+    return lan9646OK;
+}
+
+/**
+ * \brief           Forget cached bytes
+ */
+void
+lan9646_shadow_invalidate(lan9646_t* handle, uint16_t addr, uint16_t len) {
+    lan9646_shadow_t* sh;
+    uint16_t i;
+    int16_t s;
+
+    if (handle == NULL || handle->shadow == NULL) {
+        return;
+    }
+    sh = handle->shadow;
+
+    if (len == 0) {
+        memset(sh->valid, 0, sizeof(sh->valid));
+        memset(sh->dirty, 0, sizeof(sh->dirty));
+        return;
+    }
+
+    for (i = 0; i < len; i++) {
+        s = prv_sh_slot(sh, (uint16_t)(addr + i), NULL);
+        if (s >= 0) {
+            BIT_CLR(sh->valid, (uint16_t)s);
+            BIT_CLR(sh->dirty, (uint16_t)s);
+        }
+    }
+}
+
+/**
+ * \brief           Load all cacheable ranges with burst reads
+ */
+lan9646r_t
+lan9646_shadow_refresh(lan9646_t* handle) {
+    lan9646_shadow_t* sh;
+    lan9646_reg_class_t cls;
+    lan9646r_t res;
+    uint8_t buf[32];
+    uint16_t j, k, start, addr;
+    uint8_t i;
+    int16_t s;
+
+    if (handle == NULL || !handle->is_init || handle->shadow == NULL) {
+        return lan9646INVPARAM;
+    }
+    sh = handle->shadow;
+
+    for (i = 0; i < sh->nranges; i++) {
+        const lan9646_reg_range_t* r = &sh->ranges[i];
+
+        if (r->cls != LAN9646_REG_CACHEABLE) continue;
+
+        j = 0;
+        while (j < r->len) {
+            /* Runs stop at read-clear bytes; volatile holes are read but not kept */
+            prv_sh_slot(sh, (uint16_t)(r->addr + j), &cls);
+            if (cls == LAN9646_REG_READ_CLEAR) {
+                j++;
+                continue;
+            }
+            start = j;
+            while (j < r->len && (uint16_t)(j - start) < sizeof(buf)) {
+                prv_sh_slot(sh, (uint16_t)(r->addr + j), &cls);
+                if (cls == LAN9646_REG_READ_CLEAR) break;
+                j++;
+            }
+
+            addr = (uint16_t)(r->addr + start);
+            res = prv_bus_read(handle, addr, buf, (uint16_t)(j - start));
+            if (res != lan9646OK) {
+                return res;
+            }
+            for (k = 0; k < (uint16_t)(j - start); k++) {
+                s = prv_sh_slot(sh, (uint16_t)(addr + k), NULL);
+                if (s >= 0 && !BIT_GET(sh->dirty, (uint16_t)s)) {
+                    sh->data[s] = buf[k];
+                    BIT_SET(sh->valid, (uint16_t)s);
+                }
+            }
+        }
+    }
+    return lan9646OK;
+}
+
+/**
+ * \brief           Get shadow counters
+ */
+void
+lan9646_shadow_get_stats(const lan9646_t* handle, lan9646_shadow_stats_t* stats) {
+    if (stats == NULL) {
+        return;
+    }
+    if (handle == NULL || handle->shadow == NULL) {
+        memset(stats, 0, sizeof(*stats));
+        return;
+    }
+    *stats = handle->shadow->stats;
+}
@@ -47,6 +47,8 @@ typedef struct {
     lan9646r_t (*transfer_fn)(const uint8_t* tx_data, uint8_t* rx_data, uint16_t len);
     void (*cs_low_fn)(void);
     void (*cs_high_fn)(void);
+    /* Optional: one chip-select frame, cmd then len data bytes; replaces cs/transfer/write when set */
+    lan9646r_t (*frame_fn)(const uint8_t* cmd, uint8_t cmd_len, const uint8_t* tx, uint8_t* rx, uint16_t len);
 } lan9646_spi_t;
 
 typedef struct {
@@ -61,6 +63,9 @@ typedef struct {
     lan9646r_t (*init_fn)(void);
     lan9646r_t (*write_fn)(uint8_t phy_addr, uint8_t reg_addr, uint16_t data);
     lan9646r_t (*read_fn)(uint8_t phy_addr, uint8_t reg_addr, uint16_t* data);
+    /* Optional Clause 45 frames; NULL = MMD through the Clause 22 registers 13/14 */
+    lan9646r_t (*mmd_write_fn)(uint8_t phy_addr, uint8_t devad, uint16_t reg_addr, uint16_t data);
+    lan9646r_t (*mmd_read_fn)(uint8_t phy_addr, uint8_t devad, uint16_t reg_addr, uint16_t* data);
 } lan9646_miim_t;
 
 typedef struct {
@@ -71,12 +76,75 @@ typedef struct {
         lan9646_miim_t miim;
     } ops;
     uint8_t i2c_addr;
-    uint8_t phy_addr;
+    uint8_t phy_addr;           /*!< MDIO address of the port 1 PHY, port n is phy_addr + n - 1 */
 } lan9646_cfg_t;
 
+/*===========================================================================*/
+/*                           REGISTER SHADOW                                  */
+/*===========================================================================*/
+
+#ifndef LAN9646_SHADOW_BYTES
+#define LAN9646_SHADOW_BYTES        128U    /*!< Cached register bytes, multiple of 8 */
+#endif
+
+#ifndef LAN9646_SHADOW_MAX_RANGES
+#define LAN9646_SHADOW_MAX_RANGES   24U
+#endif
+
+/**
+ * \brief           Register range class
+ */
+typedef enum {
+    LAN9646_REG_VOLATILE = 0,   /*!< Changed by hardware: always read from the device */
+    LAN9646_REG_CACHEABLE,      /*!< Only changed by us: reads and RMW use the shadow */
+    LAN9646_REG_READ_CLEAR,     /*!< Reading has side effects: never cached or refreshed */
+} lan9646_reg_class_t;
+
+/**
+ * \brief           Register range declaration
+ * \note            The first range containing an address decides its class,
+ *                  so volatile/read-clear entries placed first can carve
+ *                  holes into a larger cacheable range. Undeclared
+ *                  addresses are volatile.
+ */
+typedef struct {
+    uint16_t addr;
+    uint16_t len;               /*!< Bytes */
+    lan9646_reg_class_t cls;
+} lan9646_reg_range_t;
+
+/**
+ * \brief           Shadow cache counters
+ */
+typedef struct {
+    uint32_t hits;              /*!< Reads served from the shadow */
+    uint32_t misses;            /*!< Reads of cacheable bytes that went to the bus */
+    uint32_t bus_reads;         /*!< Read transactions on the bus */
+    uint32_t bus_writes;        /*!< Write transactions on the bus */
+    uint32_t deferred;          /*!< Writes held as dirty (write-back mode) */
+    uint32_t flushes;           /*!< Burst writes issued by sync */
+} lan9646_shadow_stats_t;
+
+/**
+ * \brief           Shadow cache state (one per device, see lan9646_shadow_attach())
+ */
+typedef struct {
+    const lan9646_reg_range_t* ranges;
+    uint8_t nranges;
+    bool write_back;                                /*!< Defer writes until sync */
+    uint16_t offs[LAN9646_SHADOW_MAX_RANGES];       /*!< Offset of each range in data */
+    uint8_t data[LAN9646_SHADOW_BYTES];
+    uint8_t valid[LAN9646_SHADOW_BYTES / 8U];
+    uint8_t dirty[LAN9646_SHADOW_BYTES / 8U];
+    lan9646_shadow_stats_t stats;
+} lan9646_shadow_t;
+
 typedef struct {
     lan9646_cfg_t cfg;
     uint8_t is_init;
+    lan9646_shadow_t* shadow;   /*!< Optional register shadow, NULL = none */
+    const lan9646_miim_t* phy_bus;  /*!< Optional MDIO route for PHY registers, NULL = none */
+    uint32_t phy_bus_ops;       /*!< Transactions sent over phy_bus */
 } lan9646_t;
 
 /*===========================================================================*/
@@ -87,6 +155,13 @@ typedef struct {
 #define LAN9646_SPI_CMD_WRITE       0x02
 #define LAN9646_SPI_CMD_FAST_READ   0x0B
 
+/*
+ * 32-bit command word, sent MSB first: 3-bit opcode, 24-bit address and
+ * 5 turnaround bits. The address auto-increments for the rest of the frame.
+ */
+#define LAN9646_SPI_CMD_LEN         4U
+#define LAN9646_SPI_CMD(op, addr)   (((uint32_t)(op) << 29) | (((uint32_t)(addr) & 0xFFFFFFUL) << 5))
+
 /*===========================================================================*/
 /*                           I2C ADDRESS                                      */
 /*===========================================================================*/
@@ -165,6 +240,9 @@ typedef struct {
 #define LAN9646_REG_GLOBAL_MIRROR   0x0370  /*!< Global Mirror Control */
 #define LAN9646_REG_MIRROR_DSCP     0x0378  /*!< Mirror DSCP */
 
+/* DiffServ Priority Mapping (0x0340-0x035F), two DSCP values per byte */
+#define LAN9646_REG_DIFFSERV_MAP(i) (0x0340 + (i))
+
 /* Queue Management */
 #define LAN9646_REG_QUEUE_MGMT_CTRL 0x0390  /*!< Queue Management Control 0 */
 
@@ -176,26 +254,35 @@ typedef struct {
 #define LAN9646_REG_SWITCH_MAC4     0x0306  /*!< Switch MAC Address [15:8] */
 #define LAN9646_REG_SWITCH_MAC5     0x0307  /*!< Switch MAC Address [7:0] */
 
+/* Switch MAC Control (storm protection) */
+#define LAN9646_REG_SW_MAC_CTRL2    0x0332  /*!< Multicast storm, storm rate [10:8] */
+#define LAN9646_REG_SW_MAC_CTRL3    0x0333  /*!< Storm rate [7:0] */
+
 /* Switch MIB Control */
-#define LAN9646_REG_SWITCH_MIB_CTRL 0x0308  /*!< Switch MIB Control */
+#define LAN9646_REG_SWITCH_MIB_CTRL 0x0336  /*!< Switch MIB Control */
 
 /*===========================================================================*/
 /*                    GLOBAL LUE CONTROL (0x0400-0x04FF)                      */
 /*===========================================================================*/
 
-/* ALU Table Access */
-#define LAN9646_REG_ALU_TABLE_CTRL  0x0410  /*!< ALU Table Access Control */
-#define LAN9646_REG_ALU_TABLE_INDEX 0x0414  /*!< ALU Table Entry Index */
-#define LAN9646_REG_ALU_TABLE_ENTRY0 0x0420  /*!< ALU Table Entry 0 */
-#define LAN9646_REG_ALU_TABLE_ENTRY1 0x0424  /*!< ALU Table Entry 1 */
-#define LAN9646_REG_ALU_TABLE_ENTRY2 0x0428  /*!< ALU Table Entry 2 */
-#define LAN9646_REG_ALU_TABLE_ENTRY3 0x042C  /*!< ALU Table Entry 3 */
+/* VLAN Table Access: entry, index and control are contiguous (0x0400-0x040E) */
+#define LAN9646_REG_VLAN_ENTRY      0x0400  /*!< VLAN Entry: valid, FID */
+#define LAN9646_REG_VLAN_UNTAG      0x0404  /*!< VLAN Entry untagged ports */
+#define LAN9646_REG_VLAN_PORTS      0x0408  /*!< VLAN Entry member ports */
+#define LAN9646_REG_VLAN_INDEX      0x040C  /*!< VLAN Table Index (VID, 16-bit) */
+#define LAN9646_REG_VLAN_CTRL       0x040E  /*!< VLAN Table Access Control */
 
-/* Static Table Access */
-#define LAN9646_REG_STATIC_TABLE_CTRL 0x0440
+/* ALU Table Access */
+#define LAN9646_REG_ALU_INDEX0      0x0410  /*!< ALU Index 0: FID, MAC [47:32] */
+#define LAN9646_REG_ALU_INDEX1      0x0414  /*!< ALU Index 1: MAC [31:0] */
+#define LAN9646_REG_ALU_TABLE_CTRL  0x0418  /*!< ALU Table Access Control */
+#define LAN9646_REG_ALU_TABLE_ENTRY0 0x0420  /*!< ALU/Static Table Entry 0 */
+#define LAN9646_REG_ALU_TABLE_ENTRY1 0x0424  /*!< ALU/Static Table Entry 1 */
+#define LAN9646_REG_ALU_TABLE_ENTRY2 0x0428  /*!< ALU/Static Table Entry 2 */
+#define LAN9646_REG_ALU_TABLE_ENTRY3 0x042C  /*!< ALU/Static Table Entry 3 */
 
-/* VLAN Table (at 0x0480 with VID offset) */
-#define LAN9646_REG_VLAN_TABLE_BASE 0x0480
+/* Static Address / Reserved Multicast Table Access (entries at 0x0420) */
+#define LAN9646_REG_STATIC_TABLE_CTRL 0x041C
 
 /*===========================================================================*/
 /*                        PORT REGISTERS (0xN000-0xNFFF)                      */
@@ -237,10 +324,20 @@ typedef struct {
 #define LAN9646_REG_PORT_PHY_LP_NP(n)       (LAN9646_PORT_BASE(n) | 0x0110)
 #define LAN9646_REG_PORT_PHY_1000_CTRL(n)   (LAN9646_PORT_BASE(n) | 0x0112)
 #define LAN9646_REG_PORT_PHY_1000_STAT(n)   (LAN9646_PORT_BASE(n) | 0x0114)
-#define LAN9646_REG_PORT_PHY_MMD_SETUP(n)   (LAN9646_PORT_BASE(n) | 0x0134)
-#define LAN9646_REG_PORT_PHY_MMD_DATA(n)    (LAN9646_PORT_BASE(n) | 0x0136)
+#define LAN9646_REG_PORT_PHY_MMD_SETUP(n)   (LAN9646_PORT_BASE(n) | 0x011A)
+#define LAN9646_REG_PORT_PHY_MMD_DATA(n)    (LAN9646_PORT_BASE(n) | 0x011C)
+#define LAN9646_REG_PORT_PHY_INT_CTRL(n)    (LAN9646_PORT_BASE(n) | 0x0136)
 #define LAN9646_REG_PORT_PHY_EXT_STAT(n)    (LAN9646_PORT_BASE(n) | 0x013E)
 
+/* Over MDIO the window 0xN100-0xN13F is Clause 22 register (addr & 0x3F) / 2 */
+#define LAN9646_PHY_WINDOW_FIRST            0x0100
+#define LAN9646_PHY_WINDOW_LEN              0x0040
+#define LAN9646_MIIM_MMD_SETUP              0x0D
+#define LAN9646_MIIM_MMD_DATA               0x0E
+#define LAN9646_MMD_FUNC_ADDR               0x0000  /*!< MMD setup [15:14]: data is the address */
+#define LAN9646_MMD_FUNC_DATA               0x4000  /*!< MMD setup [15:14]: data, no increment */
+#define LAN9646_MMD_DEVAD_MASK              0x001F
+
 /*---------------------------------------------------------------------------*/
 /* Port SGMII Registers (0xN200-0xN2FF) - Port 7 only                        */
 /*---------------------------------------------------------------------------*/
@@ -258,9 +355,9 @@ typedef struct {
 /*---------------------------------------------------------------------------*/
 #define LAN9646_REG_PORT_MAC_CTRL0(n)       (LAN9646_PORT_BASE(n) | 0x0400)
 #define LAN9646_REG_PORT_MAC_CTRL1(n)       (LAN9646_PORT_BASE(n) | 0x0401)
-#define LAN9646_REG_PORT_IN_RATE(n)         (LAN9646_PORT_BASE(n) | 0x0410)
-#define LAN9646_REG_PORT_PRI_RATE(n)        (LAN9646_PORT_BASE(n) | 0x0411)
-#define LAN9646_REG_PORT_OUT_RATE(n)        (LAN9646_PORT_BASE(n) | 0x0420)
+#define LAN9646_REG_PORT_RATE_CTRL(n)       (LAN9646_PORT_BASE(n) | 0x0403)
+#define LAN9646_REG_PORT_IN_RATE(n,p)       (LAN9646_PORT_BASE(n) | (0x0410 + (p)))  /*!< Priority 0-7 */
+#define LAN9646_REG_PORT_OUT_RATE(n,q)      (LAN9646_PORT_BASE(n) | (0x0420 + (q)))  /*!< Queue 0-3 */
 
 /*---------------------------------------------------------------------------*/
 /* Port MIB Counters (0xN500-0xN5FF) - Indirect Access                       */
@@ -271,22 +368,28 @@ typedef struct {
 /*---------------------------------------------------------------------------*/
 /* Port ACL (0xN600-0xN6FF)                                                  */
 /*---------------------------------------------------------------------------*/
-#define LAN9646_REG_PORT_ACL_CTRL0(n)       (LAN9646_PORT_BASE(n) | 0x0680)
-#define LAN9646_REG_PORT_ACL_CTRL1(n)       (LAN9646_PORT_BASE(n) | 0x0681)
 #define LAN9646_REG_PORT_ACL_ACCESS(n,i)    (LAN9646_PORT_BASE(n) | (0x0600 + (i)))
+#define LAN9646_REG_PORT_ACL_BYTE_EN(n)     (LAN9646_PORT_BASE(n) | 0x0610)
+#define LAN9646_REG_PORT_ACL_CTRL0(n)       (LAN9646_PORT_BASE(n) | 0x0612)
+#define LAN9646_REG_PORT_ACL_CTRL1(n)       (LAN9646_PORT_BASE(n) | 0x0613)
 
 /*---------------------------------------------------------------------------*/
 /* Port Ingress Control (0xN800-0xN8FF)                                      */
 /*---------------------------------------------------------------------------*/
-#define LAN9646_REG_PORT_CLASS_CTRL(n)      (LAN9646_PORT_BASE(n) | 0x0800)
+#define LAN9646_REG_PORT_PRIO_CTRL(n)       (LAN9646_PORT_BASE(n) | 0x0801)  /*!< Priority sources */
+#define LAN9646_REG_PORT_AUTH_CTRL(n)       (LAN9646_PORT_BASE(n) | 0x0803)
 #define LAN9646_REG_PORT_MIRROR_CTRL(n)     (LAN9646_PORT_BASE(n) | 0x0804)
-#define LAN9646_REG_PORT_PRIO_CTRL(n)       (LAN9646_PORT_BASE(n) | 0x0808)
+#define LAN9646_REG_PORT_TC_MAP(n)          (LAN9646_PORT_BASE(n) | 0x0808)  /*!< 32-bit priority to queue */
 
 /*---------------------------------------------------------------------------*/
 /* Port Egress Control (0xN900-0xN9FF)                                       */
 /*---------------------------------------------------------------------------*/
-#define LAN9646_REG_PORT_SCHED_CTRL(n)      (LAN9646_PORT_BASE(n) | 0x0900)
-#define LAN9646_REG_PORT_SHAPING_CTRL(n)    (LAN9646_PORT_BASE(n) | 0x0904)
+#define LAN9646_REG_PORT_MTI_QUEUE_INDEX(n) (LAN9646_PORT_BASE(n) | 0x0900)  /*!< 32-bit, selects 0x0914- */
+#define LAN9646_REG_PORT_MTI_QUEUE_CTRL0(n) (LAN9646_PORT_BASE(n) | 0x0914)  /*!< Scheduling, shaping */
+#define LAN9646_REG_PORT_MTI_QUEUE_CTRL1(n) (LAN9646_PORT_BASE(n) | 0x0915)  /*!< WRR weight */
+#define LAN9646_REG_PORT_MTI_HI_CREDIT(n)   (LAN9646_PORT_BASE(n) | 0x0916)  /*!< 16-bit */
+#define LAN9646_REG_PORT_MTI_LO_CREDIT(n)   (LAN9646_PORT_BASE(n) | 0x0918)  /*!< 16-bit */
+#define LAN9646_REG_PORT_MTI_CREDIT_INC(n)  (LAN9646_PORT_BASE(n) | 0x091C)  /*!< 32-bit */
 
 /*---------------------------------------------------------------------------*/
 /* Port Queue Management (0xNA00-0xNAFF)                                     */
@@ -328,20 +431,21 @@ typedef struct {
 #define LAN9646_MIB_RX_1523_2000       0x13  /*!< RX 1523-2000 bytes */
 #define LAN9646_MIB_RX_2001_PLUS       0x14  /*!< RX 2001+ bytes */
 
-#define LAN9646_MIB_TX_HI_PRIO_BYTE    0x60  /*!< TX high priority bytes */
-#define LAN9646_MIB_TX_LATE_COL        0x61  /*!< TX late collisions */
-#define LAN9646_MIB_TX_PAUSE           0x62  /*!< TX pause frames */
-#define LAN9646_MIB_TX_BROADCAST       0x63  /*!< TX broadcast */
-#define LAN9646_MIB_TX_MULTICAST       0x64  /*!< TX multicast */
-#define LAN9646_MIB_TX_UNICAST         0x65  /*!< TX unicast */
-#define LAN9646_MIB_TX_DEFERRED        0x66  /*!< TX deferred */
-#define LAN9646_MIB_TX_TOTAL_COL       0x67  /*!< TX total collisions */
-#define LAN9646_MIB_TX_EXCESS_COL      0x68  /*!< TX excessive collisions */
-#define LAN9646_MIB_TX_SINGLE_COL      0x69  /*!< TX single collision */
-#define LAN9646_MIB_TX_MULTI_COL       0x6A  /*!< TX multiple collisions */
-
-#define LAN9646_MIB_RX_TOTAL           0x80  /*!< Total RX packet count */
-#define LAN9646_MIB_TX_TOTAL           0x81  /*!< Total TX byte count */
+#define LAN9646_MIB_TX_HI_PRIO_BYTE    0x15  /*!< TX high priority bytes */
+#define LAN9646_MIB_TX_LATE_COL        0x16  /*!< TX late collisions */
+#define LAN9646_MIB_TX_PAUSE           0x17  /*!< TX pause frames */
+#define LAN9646_MIB_TX_BROADCAST       0x18  /*!< TX broadcast */
+#define LAN9646_MIB_TX_MULTICAST       0x19  /*!< TX multicast */
+#define LAN9646_MIB_TX_UNICAST         0x1A  /*!< TX unicast */
+#define LAN9646_MIB_TX_DEFERRED        0x1B  /*!< TX deferred */
+#define LAN9646_MIB_TX_TOTAL_COL       0x1C  /*!< TX total collisions */
+#define LAN9646_MIB_TX_EXCESS_COL      0x1D  /*!< TX excessive collisions */
+#define LAN9646_MIB_TX_SINGLE_COL      0x1E  /*!< TX single collision */
+#define LAN9646_MIB_TX_MULTI_COL       0x1F  /*!< TX multiple collisions */
+
+/* There are no packet totals: total = unicast + multicast + broadcast */
+#define LAN9646_MIB_RX_BYTE_CNT        0x80  /*!< RX byte count (36-bit) */
+#define LAN9646_MIB_TX_BYTE_CNT        0x81  /*!< TX byte count (36-bit) */
 #define LAN9646_MIB_RX_DROP            0x82  /*!< RX dropped packets */
 #define LAN9646_MIB_TX_DROP            0x83  /*!< TX dropped packets */
 
@@ -362,6 +466,16 @@ typedef struct {
 #define LAN9646_PORT_STATUS_TX_FLOW         0x02    /*!< Bit 1: TX Flow Control */
 #define LAN9646_PORT_STATUS_RX_FLOW         0x01    /*!< Bit 0: RX Flow Control */
 
+/* Port Interrupt Status/Mask (0xN01B/0xN01F), mask bit 1 = disabled */
+#define LAN9646_PORT_INT_PHY                0x02    /*!< Bit 1: PHY interrupt */
+#define LAN9646_PORT_INT_ACL                0x01    /*!< Bit 0: ACL interrupt */
+
+/* PHY Interrupt Control/Status (0xN136) - status bits clear on read */
+#define LAN9646_PHY_INT_LINK_DOWN_EN        0x0400  /*!< Bit 10: Link down enable */
+#define LAN9646_PHY_INT_LINK_UP_EN          0x0100  /*!< Bit 8: Link up enable */
+#define LAN9646_PHY_INT_LINK_DOWN           0x0004  /*!< Bit 2: Link down occurred */
+#define LAN9646_PHY_INT_LINK_UP             0x0001  /*!< Bit 0: Link up occurred */
+
 /* PHY Basic Status Register (0xN102) - For Link Status */
 #define LAN9646_REG_PHY_BASIC_STATUS(n)     (LAN9646_PORT_BASE(n) | 0x0102)
 #define LAN9646_PHY_LINK_STATUS             0x0004  /*!< Bit 2: Link 1=Up */
@@ -389,6 +503,91 @@ typedef struct {
 #define LAN9646_MIRROR_TX_SNIFF             0x20
 #define LAN9646_MIRROR_SNIFFER_PORT         0x02
 
+/* Port Operation Control 0 (0xN020) */
+#define LAN9646_PORT_QUEUE_SPLIT_MASK       0x03
+#define LAN9646_PORT_QUEUE_SPLIT_1          0x00
+#define LAN9646_PORT_QUEUE_SPLIT_2          0x01
+#define LAN9646_PORT_QUEUE_SPLIT_4          0x02
+
+/* Port Priority Control (0xN801) */
+#define LAN9646_PORT_PRIO_HIGHEST           0x80    /*!< Highest of the enabled sources wins */
+#define LAN9646_PORT_PRIO_OR                0x40
+#define LAN9646_PORT_PRIO_MAC               0x10    /*!< ALU entry priority */
+#define LAN9646_PORT_PRIO_VLAN              0x08    /*!< VLAN table priority */
+#define LAN9646_PORT_PRIO_ACL               0x04
+#define LAN9646_PORT_PRIO_DIFFSERV          0x02
+#define LAN9646_PORT_PRIO_8021P             0x01    /*!< Tag PCP */
+#define LAN9646_PORT_PRIO_SRC_MASK          0x1F
+
+/* Port TC Map (0xN808): one nibble per priority, priority 0 in [3:0] */
+#define LAN9646_TC_MAP_SHIFT(p)             ((p) * 4U)
+#define LAN9646_TC_MAP_QUEUE_MASK           0x03UL
+
+/* DiffServ map: even DSCP in [3:0], odd DSCP in [7:4] */
+#define LAN9646_DIFFSERV_PRIO_MASK          0x07
+
+/* MTI Queue Control 1 (0xN915) */
+#define LAN9646_MTI_WEIGHT_MASK             0x7F
+
+/* Port MAC Control 0 (0xN400) */
+#define LAN9646_PORT_BCAST_STORM_EN         0x02
+
+/* Port Rate Limit Control (0xN403) */
+#define LAN9646_RATE_IN_PORT_BASED          0x40    /*!< One ingress limit for all priorities */
+#define LAN9646_RATE_PACKET_BASED           0x20
+#define LAN9646_RATE_IN_FLOW_CTRL           0x10    /*!< Pause instead of drop on ingress */
+#define LAN9646_RATE_COUNT_IFG              0x02
+#define LAN9646_RATE_COUNT_PREAMBLE         0x01
+
+/* Rate limit codes (0xN410-0xN417, 0xN420-0xN423) */
+#define LAN9646_RATE_CODE_UNLIMITED         0x00
+#define LAN9646_RATE_CODE_MBPS_MAX          0x64    /*!< 1-100: n Mbps, n x 10 Mbps at 1000 */
+#define LAN9646_RATE_CODE_KBPS_BASE         0x64    /*!< 0x65-0x73: (code - 0x64) x 64 kbps, x 640 at 1000 */
+#define LAN9646_RATE_CODE_KBPS_STEPS        15U
+
+/* Switch MAC Control 2/3 (0x0332-0x0333) */
+#define LAN9646_SW_MCAST_STORM_DIS          0x40    /*!< Exclude multicast from storm counting */
+#define LAN9646_SW_STORM_RATE_HI_MASK       0x07
+#define LAN9646_SW_STORM_RATE_MAX           0x07FF
+
+/* MTI Queue Control 0 (0xN914) */
+#define LAN9646_MTI_SCHED_MASK              0xC0
+#define LAN9646_MTI_SCHED_SHIFT             6
+#define LAN9646_MTI_SCHED_STRICT            0U
+#define LAN9646_MTI_SCHED_WRR               2U
+#define LAN9646_MTI_SHAPING_MASK            0x30
+#define LAN9646_MTI_SHAPING_SHIFT           4
+#define LAN9646_MTI_SHAPING_OFF             0U
+#define LAN9646_MTI_SHAPING_CBS             1U      /*!< Credit-based shaper */
+
+/* Port Authentication Control (0xN803) */
+#define LAN9646_PORT_ACL_EN                 0x04
+
+/* Port ACL Access Control 0 (0xN612) */
+#define LAN9646_ACL_WRITE_DONE              0x40
+#define LAN9646_ACL_READ_DONE               0x20
+#define LAN9646_ACL_WRITE                   0x10    /*!< 1 = write, 0 = read */
+#define LAN9646_ACL_INDEX_MASK              0x0F
+
+/* ACL entry byte 0: matching mode */
+#define LAN9646_ACL_MD_SHIFT                4       /*!< Bits [5:4] */
+#define LAN9646_ACL_MD_L2                   1U      /*!< MAC / EtherType */
+#define LAN9646_ACL_MD_L3                   2U      /*!< IPv4 address */
+#define LAN9646_ACL_MD_L4                   3U      /*!< IP protocol, TCP/UDP port */
+#define LAN9646_ACL_ENB_SHIFT               2       /*!< Bits [3:2]: field selection */
+#define LAN9646_ACL_SRC                     0x02    /*!< Compare source, not destination */
+#define LAN9646_ACL_EQUAL                   0x01    /*!< Match when equal (else not equal) */
+
+/* ACL entry bytes 1-3: action */
+#define LAN9646_ACL_PM_SHIFT                6       /*!< Byte 1 [7:6]: priority mode */
+#define LAN9646_ACL_PM_REPLACE              3U
+#define LAN9646_ACL_P_SHIFT                 3       /*!< Byte 1 [5:3]: priority */
+#define LAN9646_ACL_MM_SHIFT                5       /*!< Byte 2 [6:5]: map mode */
+#define LAN9646_ACL_MM_OR                   1U
+#define LAN9646_ACL_MM_AND                  2U
+#define LAN9646_ACL_MM_REPLACE              3U
+#define LAN9646_ACL_FWD_MAP_MASK            0x7F    /*!< Byte 3 [6:0]: bit 0 = port 1 */
+
 /* Port MSTP State (0xNB04) */
 #define LAN9646_MSTP_TX_EN                  0x04
 #define LAN9646_MSTP_RX_EN                  0x02
@@ -400,19 +599,96 @@ typedef struct {
 #define LAN9646_MIB_FLUSH_FREEZE_EN         0x01000000UL  /*!< Bit 24: Flush/Freeze En */
 #define LAN9646_MIB_INDEX_MASK              0x00FF0000UL  /*!< Bits [23:16]: MIB Index */
 #define LAN9646_MIB_INDEX_SHIFT             16
+#define LAN9646_MIB_DATA_HI_MASK            0x0000000FUL  /*!< Bits [3:0]: byte count [35:32] */
+#define LAN9646_MIB_CNT_MASK                0x3FFFFFFFUL  /*!< 30-bit counters */
 
-/* Switch MIB Control (0x0308) */
+/* Switch Operation (0x0300) */
+#define LAN9646_SWITCH_START                0x01    /*!< Bit 0: Start switch */
+
+/* Switch MIB Control (0x0336) */
 #define LAN9646_SW_MIB_FREEZE               0x40
 #define LAN9646_SW_MIB_FLUSH                0x80
 
 /* LUE Control 0 (0x0310) */
-#define LAN9646_LUE_HASH_OPTION             0x80
-#define LAN9646_LUE_UNICAST_EN              0x40
-#define LAN9646_LUE_MULTICAST_EN            0x20
-#define LAN9646_LUE_VLAN_EN                 0x10
-#define LAN9646_LUE_AGE_CNT_MASK            0x0E
-#define LAN9646_LUE_AGE_CNT_SHIFT           1
-#define LAN9646_LUE_LEARNING_DIS            0x01
+#define LAN9646_LUE_VLAN_EN                 0x80    /*!< Bit 7: 802.1Q VLAN mode */
+#define LAN9646_LUE_DROP_INVALID_VID        0x40
+#define LAN9646_LUE_AGE_CNT_MASK            0x38
+#define LAN9646_LUE_AGE_CNT_SHIFT           3
+#define LAN9646_LUE_RESV_MCAST_EN           0x04
+#define LAN9646_LUE_HASH_OPTION_MASK        0x03
+
+/* LUE Control 1 (0x0311) */
+#define LAN9646_LUE1_UCAST_LEARN_DIS        0x80    /*!< Bit 7: No unicast learning */
+#define LAN9646_LUE1_AGING_EN               0x04    /*!< Bit 2: Age dynamic entries */
+#define LAN9646_LUE1_FAST_AGING             0x02
+#define LAN9646_LUE1_LINK_AUTO_AGING        0x01    /*!< Bit 0: Flush a port on link down */
+
+/* Unknown Unicast/Multicast/VID Control (0x0320-0x032B) */
+#define LAN9646_UNKNOWN_FWD_EN              0x80000000UL  /*!< Bit 31: Use the port map below */
+#define LAN9646_UNKNOWN_PORT_MASK           0x0000007FUL  /*!< Bits [6:0]: bit 0 = port 1 */
+
+/* ALU Table Access Control (0x0418) */
+#define LAN9646_ALU_VALID_CNT_MASK          0x3FFF0000UL  /*!< Bits [29:16]: Valid entries */
+#define LAN9646_ALU_VALID_CNT_SHIFT         16
+#define LAN9646_ALU_START                   0x00000080UL  /*!< Bit 7: Start / busy */
+#define LAN9646_ALU_VALID                   0x00000040UL  /*!< Bit 6: Search result ready */
+#define LAN9646_ALU_SEARCH_END              0x00000020UL
+#define LAN9646_ALU_DIRECT                  0x00000004UL
+#define LAN9646_ALU_ACTION_WRITE            0x00000001UL
+#define LAN9646_ALU_ACTION_READ             0x00000002UL
+#define LAN9646_ALU_ACTION_SEARCH           0x00000003UL
+
+/* Static Address Table Control (0x041C) */
+#define LAN9646_STA_INDEX_MASK              0x003F0000UL  /*!< Bits [21:16]: Entry index */
+#define LAN9646_STA_INDEX_SHIFT             16
+#define LAN9646_STA_START                   0x00000080UL  /*!< Bit 7: Start / busy */
+#define LAN9646_STA_TABLE_MCAST             0x00000002UL  /*!< Bit 1: Reserved multicast table */
+#define LAN9646_STA_READ                    0x00000001UL  /*!< Bit 0: 1 = read, 0 = write */
+
+/* ALU/Static Table Entry 0 (0x0420) */
+#define LAN9646_ALU_E0_VALID                0x80000000UL  /*!< Static: valid, dynamic: static */
+#define LAN9646_ALU_E0_SRC_FILTER           0x40000000UL
+#define LAN9646_ALU_E0_DST_FILTER           0x20000000UL
+#define LAN9646_ALU_E0_PRIO_MASK            0x1C000000UL  /*!< Priority (dynamic: age count) */
+#define LAN9646_ALU_E0_PRIO_SHIFT           26
+#define LAN9646_ALU_E0_MSTP_MASK            0x00000007UL
+
+/* ALU/Static Table Entry 1 (0x0424) */
+#define LAN9646_ALU_E1_OVERRIDE             0x80000000UL  /*!< Forward past port state */
+#define LAN9646_ALU_E1_USE_FID              0x40000000UL
+#define LAN9646_ALU_E1_PORT_MASK            0x0000007FUL  /*!< Bits [6:0]: bit 0 = port 1 */
+
+/* ALU/Static Table Entry 2 (0x0428) */
+#define LAN9646_ALU_E2_FID_MASK             0x007F0000UL
+#define LAN9646_ALU_E2_FID_SHIFT            16
+#define LAN9646_ALU_E2_MAC_HI_MASK          0x0000FFFFUL
+
+/* VLAN Table Entry (0x0400) */
+#define LAN9646_VLAN_VALID                  0x80000000UL
+#define LAN9646_VLAN_FWD_OPTION             0x08000000UL  /*!< Forward to member ports only */
+#define LAN9646_VLAN_PRIO_MASK              0x07000000UL
+#define LAN9646_VLAN_PRIO_SHIFT             24
+#define LAN9646_VLAN_MSTP_MASK              0x00007000UL
+#define LAN9646_VLAN_MSTP_SHIFT             12
+#define LAN9646_VLAN_FID_MASK               0x0000007FUL
+
+/* VLAN Table Index (0x040C) / Access Control (0x040E) */
+#define LAN9646_VLAN_VID_MASK               0x0FFF
+#define LAN9646_VLAN_START                  0x80    /*!< Bit 7: Start / busy */
+#define LAN9646_VLAN_ACTION_WRITE           0x01
+#define LAN9646_VLAN_ACTION_READ            0x02
+#define LAN9646_VLAN_ACTION_CLEAR           0x03    /*!< Clear the whole table */
+
+/* Port Default Tag (0xN000-0xN001, 16-bit) */
+#define LAN9646_PORT_PVID_MASK              0x0FFF
+#define LAN9646_PORT_PCP_MASK               0xE000
+#define LAN9646_PORT_PCP_SHIFT              13
+
+/* Port Control 2 (0xNB00) */
+#define LAN9646_PORT_LUE_VLAN_LOOKUP_VID0   0x80
+#define LAN9646_PORT_LUE_INGRESS_FILTER     0x40    /*!< Drop if the port is not a VID member */
+#define LAN9646_PORT_LUE_DISCARD_NON_PVID   0x20
+#define LAN9646_PORT_LUE_SRC_ADDR_FILTER    0x08
 
 /* Port VLAN Membership (0xNA04) */
 #define LAN9646_VLAN_MEMBERSHIP_MASK        0x7F
@@ -437,6 +713,75 @@ lan9646r_t lan9646_write_burst(lan9646_t* handle, uint16_t reg_addr, const uint8
 lan9646r_t lan9646_modify_reg8(lan9646_t* handle, uint16_t reg_addr, uint8_t mask, uint8_t value);
 lan9646r_t lan9646_modify_reg16(lan9646_t* handle, uint16_t reg_addr, uint16_t mask, uint16_t value);
 
+/**
+ * \brief           Attach a register shadow cache (call after lan9646_init())
+ * \param[in]       handle: Device handle
+ * \param[in]       shadow: Cache state, must outlive the handle
+ * \param[in]       ranges: Range table (kept by reference)
+ * \param[in]       count: Number of ranges
+ * \return          \ref lan9646INVPARAM if the cacheable ranges exceed
+ *                  LAN9646_SHADOW_BYTES or there are too many ranges
+ */
+lan9646r_t lan9646_shadow_attach(lan9646_t* handle, lan9646_shadow_t* shadow,
+                                 const lan9646_reg_range_t* ranges, uint8_t count);
+
+/**
+ * \brief           Select write-through (default) or write-back
+ * \note            In write-back mode writes that only touch cacheable bytes
+ *                  stay in the shadow until lan9646_shadow_sync(). Leaving
+ *                  write-back syncs first.
+ */
+lan9646r_t lan9646_shadow_set_write_back(lan9646_t* handle, bool enable);
+
+/**
+ * \brief           Write all dirty bytes to the device, one burst per run
+ */
+lan9646r_t lan9646_shadow_sync(lan9646_t* handle);
+
+/**
+ * \brief           Forget cached bytes (dirty ones are dropped, sync first)
+ * \param[in]       addr: First register address
+ * \param[in]       len: Bytes, 0 = the whole shadow
+ */
+void lan9646_shadow_invalidate(lan9646_t* handle, uint16_t addr, uint16_t len);
+
+/**
+ * \brief           Load all cacheable ranges with burst reads
+ * \note            Read-clear registers are skipped, dirty bytes are kept
+ */
+lan9646r_t lan9646_shadow_refresh(lan9646_t* handle);
+
+/**
+ * \brief           Get shadow counters (zeroed if no shadow is attached)
+ */
+void lan9646_shadow_get_stats(const lan9646_t* handle, lan9646_shadow_stats_t* stats);
+
+/**
+ * \brief           Translate a PHY window register to its MDIO address
+ * \param[in]       reg_addr: Switch address, 0xN100-0xN13F of ports 1-4, even
+ * \param[in]       phy_base: MDIO address of the port 1 PHY
+ * \return          false if the address is not a PHY register
+ */
+bool lan9646_miim_xlate(uint16_t reg_addr, uint8_t phy_base, uint8_t* phy_addr, uint8_t* reg);
+
+/**
+ * \brief           Send PHY window accesses over MDIO, the rest stays on the main bus
+ * \param[in]       miim: MDIO backend, NULL to use the main bus for everything
+ * \return          \ref lan9646ERR if a PHY of ports 1-4 does not answer on MDIO with
+ *                  the PHY ID read through the switch; the main bus is kept then
+ * \note            Only 16-bit aligned accesses are routed; byte accesses to the
+ *                  window still go through the switch
+ */
+lan9646r_t lan9646_set_phy_bus(lan9646_t* handle, const lan9646_miim_t* miim);
+
+/**
+ * \brief           Read/write a PHY MMD register of port 1-4
+ */
+lan9646r_t lan9646_phy_mmd_read(lan9646_t* handle, uint8_t port, uint8_t devad, uint16_t reg,
+                                uint16_t* data);
+lan9646r_t lan9646_phy_mmd_write(lan9646_t* handle, uint8_t port, uint8_t devad, uint16_t reg,
+                                 uint16_t data);
+
 lan9646r_t lan9646_get_chip_id(lan9646_t* handle, uint16_t* chip_id, uint8_t* revision);
 lan9646r_t lan9646_soft_reset(lan9646_t* handle);
 
@@ -0,0 +1,256 @@
+/**
+ * \file            lan9646_acl.c
+ * \brief           LAN9646 port ACL rule compiler
+ */
+
+#include "lan9646_acl.h"
+#include <string.h>
+
+/* Entry byte offsets */
+#define ACL_OFS_MODE                0x00U
+#define ACL_OFS_PRIO                0x01U
+#define ACL_OFS_MAP_MODE            0x02U
+#define ACL_OFS_FWD_MAP             0x03U
+#define ACL_OFS_MAC                 0x04U   /* L2: 6 bytes */
+#define ACL_OFS_ETHERTYPE           0x0AU   /* L2: 2 bytes */
+#define ACL_OFS_IP                  0x04U   /* L3: 4 bytes */
+#define ACL_OFS_IP_MASK             0x08U   /* L3: 4 bytes */
+#define ACL_OFS_PORT_MAX            0x04U   /* L4: 2 bytes */
+#define ACL_OFS_PORT_MIN            0x06U   /* L4: 2 bytes */
+#define ACL_OFS_PORT_CMP            0x08U   /* L4: PC [2:1] */
+#define ACL_OFS_PROTO               0x09U   /* L4 */
+#define ACL_OFS_RULESET             0x0EU   /* 2 bytes, bit n = entry n */
+
+/* L4 port comparison: port within [min, max] */
+#define ACL_PC_RANGE                0x02U
+
+/* Entry + byte enables (0x10-0x11) + control 0 (0x12) */
+#define ACL_REGS_LEN                19U
+#define ACL_CTRL_OFS                18U
+
+/*===========================================================================*/
+/*                          PRIVATE FUNCTIONS                                 */
+/*===========================================================================*/
+
+static bool prv_is_valid_port(uint8_t port) {
+    return (port >= 1 && port <= 4) || (port == 6) || (port == 7);
+}
+
+static void prv_put_be16(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t)(v >> 8);
+    p[1] = (uint8_t)v;
+}
+
+static lan9646r_t prv_wait(lan9646_t* dev, uint8_t port, uint8_t done) {
+    uint8_t tries = 0;
+    uint8_t ctrl;
+    lan9646r_t res;
+
+    for (;;) {
+        res = lan9646_read_reg8(dev, LAN9646_REG_PORT_ACL_CTRL0(port), &ctrl);
+        if (res != lan9646OK) return res;
+        if (ctrl & done) return lan9646OK;
+        if (++tries > LAN9646_ACL_POLL_MAX) return lan9646TIMEOUT;
+    }
+}
+
+/**
+ * \brief           Write one entry: data, byte enables and control in one burst
+ */
+static lan9646r_t prv_write(lan9646_t* dev, uint8_t port, uint8_t index,
+                            const lan9646_acl_entry_t* e) {
+    uint8_t buf[ACL_REGS_LEN];
+    lan9646r_t res;
+
+    memcpy(buf, e->b, LAN9646_ACL_ENTRY_LEN);
+    buf[16] = 0xFF;
+    buf[17] = 0xFF;
+    buf[ACL_CTRL_OFS] = LAN9646_ACL_WRITE | (index & LAN9646_ACL_INDEX_MASK);
+
+    res = lan9646_write_burst(dev, LAN9646_REG_PORT_ACL_ACCESS(port, 0), buf, sizeof(buf));
+    if (res != lan9646OK) return res;
+    return prv_wait(dev, port, LAN9646_ACL_WRITE_DONE);
+}
+
+static lan9646r_t prv_compile_all(const lan9646_acl_rule_t* rules, uint8_t count,
+                                  lan9646_acl_entry_t* entries) {
+    lan9646r_t res;
+    uint8_t i;
+
+    /* Unused entries stay all-zero: matching mode 0 disables them */
+    memset(entries, 0, LAN9646_ACL_ENTRIES * sizeof(*entries));
+    for (i = 0; i < count; i++) {
+        res = lan9646_acl_compile(&rules[i], i, &entries[i]);
+        if (res != lan9646OK) return res;
+    }
+    return lan9646OK;
+}
+
+/*===========================================================================*/
+/*                              API FUNCTIONS                                 */
+/*===========================================================================*/
+
+lan9646r_t lan9646_acl_compile(const lan9646_acl_rule_t* rule, uint8_t index,
+                               lan9646_acl_entry_t* entry) {
+    uint8_t* b;
+    uint8_t md, enb, mm, map = 0;
+
+    if (rule == NULL || entry == NULL || index >= LAN9646_ACL_ENTRIES) {
+        return lan9646INVPARAM;
+    }
+
+    b = entry->b;
+    memset(b, 0, LAN9646_ACL_ENTRY_LEN);
+
+    switch (rule->match) {
+        case LAN9646_ACL_MATCH_MAC:
+        case LAN9646_ACL_MATCH_ETHERTYPE:
+        case LAN9646_ACL_MATCH_MAC_ETHERTYPE:
+            md = LAN9646_ACL_MD_L2;
+            enb = (rule->match == LAN9646_ACL_MATCH_MAC) ? 2U
+                  : (rule->match == LAN9646_ACL_MATCH_ETHERTYPE) ? 1U : 3U;
+            memcpy(&b[ACL_OFS_MAC], rule->mac, 6);
+            prv_put_be16(&b[ACL_OFS_ETHERTYPE], rule->ethertype);
+            break;
+        case LAN9646_ACL_MATCH_IPV4:
+            md = LAN9646_ACL_MD_L3;
+            enb = 1U;
+            memcpy(&b[ACL_OFS_IP], rule->ip, 4);
+            memcpy(&b[ACL_OFS_IP_MASK], rule->ip_mask, 4);
+            break;
+        case LAN9646_ACL_MATCH_IP_PROTO:
+            md = LAN9646_ACL_MD_L4;
+            enb = 0U;
+            b[ACL_OFS_PROTO] = rule->proto;
+            break;
+        case LAN9646_ACL_MATCH_TCP_PORT:
+        case LAN9646_ACL_MATCH_UDP_PORT:
+            if (rule->port_min > rule->port_max) return lan9646INVPARAM;
+            md = LAN9646_ACL_MD_L4;
+            enb = (rule->match == LAN9646_ACL_MATCH_TCP_PORT) ? 1U : 2U;
+            prv_put_be16(&b[ACL_OFS_PORT_MAX], rule->port_max);
+            prv_put_be16(&b[ACL_OFS_PORT_MIN], rule->port_min);
+            b[ACL_OFS_PORT_CMP] = ACL_PC_RANGE;
+            break;
+        default:
+            return lan9646INVPARAM;
+    }
+
+    b[ACL_OFS_MODE] = (uint8_t)((md << LAN9646_ACL_MD_SHIFT) | (enb << LAN9646_ACL_ENB_SHIFT));
+    if (rule->src) b[ACL_OFS_MODE] |= LAN9646_ACL_SRC;
+    if (!rule->not_equal) b[ACL_OFS_MODE] |= LAN9646_ACL_EQUAL;
+
+    switch (rule->action) {
+        case LAN9646_ACL_PERMIT:
+            mm = LAN9646_ACL_MM_OR;             /* OR with nothing: unchanged */
+            break;
+        case LAN9646_ACL_DROP:
+            mm = LAN9646_ACL_MM_REPLACE;
+            break;
+        case LAN9646_ACL_REDIRECT:
+            mm = LAN9646_ACL_MM_REPLACE;
+            map = rule->port_map;
+            break;
+        case LAN9646_ACL_MASK:
+            mm = LAN9646_ACL_MM_AND;
+            map = rule->port_map;
+            break;
+        case LAN9646_ACL_PRIORITY:
+            if (rule->prio > 7U) return lan9646INVPARAM;
+            mm = LAN9646_ACL_MM_OR;
+            b[ACL_OFS_PRIO] = (uint8_t)((LAN9646_ACL_PM_REPLACE << LAN9646_ACL_PM_SHIFT)
+                                        | (rule->prio << LAN9646_ACL_P_SHIFT));
+            break;
+        default:
+            return lan9646INVPARAM;
+    }
+    b[ACL_OFS_MAP_MODE] = (uint8_t)(mm << LAN9646_ACL_MM_SHIFT);
+    b[ACL_OFS_FWD_MAP] = map & LAN9646_ACL_FWD_MAP_MASK;
+
+    /* Rule set of one: this entry alone triggers the action */
+    prv_put_be16(&b[ACL_OFS_RULESET], (uint16_t)(1U << index));
+    return lan9646OK;
+}
+
+lan9646r_t lan9646_acl_program(lan9646_t* dev, uint8_t port, const lan9646_acl_rule_t* rules,
+                               uint8_t count) {
+    lan9646_acl_entry_t entries[LAN9646_ACL_ENTRIES];
+    lan9646r_t res;
+    uint8_t i;
+
+    if (dev == NULL || !prv_is_valid_port(port) || count > LAN9646_ACL_ENTRIES
+        || (rules == NULL && count > 0)) {
+        return lan9646INVPARAM;
+    }
+
+    /* Compile everything first: a bad rule leaves the port untouched */
+    res = prv_compile_all(rules, count, entries);
+    if (res != lan9646OK) return res;
+
+    res = lan9646_modify_reg8(dev, LAN9646_REG_PORT_AUTH_CTRL(port), LAN9646_PORT_ACL_EN, 0);
+    if (res != lan9646OK) return res;
+
+    for (i = 0; i < LAN9646_ACL_ENTRIES; i++) {
+        res = prv_write(dev, port, i, &entries[i]);
+        if (res != lan9646OK) return res;
+    }
+
+    if (count == 0) return lan9646OK;
+    return lan9646_modify_reg8(dev, LAN9646_REG_PORT_AUTH_CTRL(port), LAN9646_PORT_ACL_EN,
+                               LAN9646_PORT_ACL_EN);
+}
+
+lan9646r_t lan9646_acl_read_entry(lan9646_t* dev, uint8_t port, uint8_t index,
+                                  lan9646_acl_entry_t* entry) {
+    uint8_t buf[ACL_REGS_LEN];
+    uint8_t tries = 0;
+    lan9646r_t res;
+
+    if (dev == NULL || entry == NULL || !prv_is_valid_port(port)
+        || index >= LAN9646_ACL_ENTRIES) {
+        return lan9646INVPARAM;
+    }
+
+    res = lan9646_write_reg8(dev, LAN9646_REG_PORT_ACL_CTRL0(port), index);
+    if (res != lan9646OK) return res;
+
+    /* Entry and control in one burst: the entry is current once READ_DONE is set */
+    for (;;) {
+        res = lan9646_read_burst(dev, LAN9646_REG_PORT_ACL_ACCESS(port, 0), buf, sizeof(buf));
+        if (res != lan9646OK) return res;
+        if (buf[ACL_CTRL_OFS] & LAN9646_ACL_READ_DONE) break;
+        if (++tries > LAN9646_ACL_POLL_MAX) return lan9646TIMEOUT;
+    }
+
+    memcpy(entry->b, buf, LAN9646_ACL_ENTRY_LEN);
+    return lan9646OK;
+}
+
+lan9646r_t lan9646_acl_verify(lan9646_t* dev, uint8_t port, const lan9646_acl_rule_t* rules,
+                              uint8_t count, uint16_t* bad) {
+    lan9646_acl_entry_t entries[LAN9646_ACL_ENTRIES];
+    lan9646_acl_entry_t hw;
+    uint16_t mismatch = 0;
+    lan9646r_t res;
+    uint8_t i;
+
+    if (dev == NULL || count > LAN9646_ACL_ENTRIES || (rules == NULL && count > 0)) {
+        return lan9646INVPARAM;
+    }
+
+    res = prv_compile_all(rules, count, entries);
+    if (res != lan9646OK) return res;
+
+    for (i = 0; i < LAN9646_ACL_ENTRIES; i++) {
+        res = lan9646_acl_read_entry(dev, port, i, &hw);
+        if (res != lan9646OK) return res;
+        if (memcmp(hw.b, entries[i].b, LAN9646_ACL_ENTRY_LEN) != 0) {
+            mismatch |= (uint16_t)(1U << i);
+        }
+    }
+
+    if (bad != NULL) {
+        *bad = mismatch;
+    }
+    return mismatch ? lan9646ERR : lan9646OK;
+}
@@ -0,0 +1,134 @@
+/**
+ * \file            lan9646_acl.h
+ * \brief           LAN9646 port ACL rule compiler
+ *
+ * Rules are compiled into the 16-byte ACL entry format, one entry per
+ * rule, with the rule set of each entry pointing at itself. Lower indices
+ * take precedence. A port's rule list is replaced as a whole: the port's
+ * ACL is switched off, all 16 entries are rewritten (unused ones
+ * disabled), then it is switched back on. The port never runs a mix of
+ * old and new rules, but it forwards unfiltered for the few milliseconds
+ * the rewrite takes.
+ *
+ * Each entry costs one burst (entry, byte enables and control together)
+ * and one control read.
+ *
+ * \note            The switch has no per-rule hit counters; frames dropped
+ *                  by a rule show up in the port's RX drop MIB counter.
+ */
+
+#ifndef LAN9646_ACL_HDR_H
+#define LAN9646_ACL_HDR_H
+
+#include "lan9646.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/*===========================================================================*/
+/*                              CONFIGURATION                                 */
+/*===========================================================================*/
+
+#ifndef LAN9646_ACL_POLL_MAX
+#define LAN9646_ACL_POLL_MAX        16U     /*!< Control reads until an access is done */
+#endif
+
+#define LAN9646_ACL_ENTRIES         16U     /*!< Entries per port */
+#define LAN9646_ACL_ENTRY_LEN       16U     /*!< Bytes 0x00-0x0F */
+
+/*===========================================================================*/
+/*                              DATA TYPES                                    */
+/*===========================================================================*/
+
+/**
+ * \brief           Frame field a rule compares
+ */
+typedef enum {
+    LAN9646_ACL_MATCH_MAC = 0,          /*!< mac */
+    LAN9646_ACL_MATCH_ETHERTYPE,        /*!< ethertype */
+    LAN9646_ACL_MATCH_MAC_ETHERTYPE,    /*!< mac and ethertype */
+    LAN9646_ACL_MATCH_IPV4,             /*!< ip under ip_mask */
+    LAN9646_ACL_MATCH_IP_PROTO,         /*!< proto */
+    LAN9646_ACL_MATCH_TCP_PORT,         /*!< port_min..port_max */
+    LAN9646_ACL_MATCH_UDP_PORT,         /*!< port_min..port_max */
+} lan9646_acl_match_t;
+
+/**
+ * \brief           What a matching frame gets
+ */
+typedef enum {
+    LAN9646_ACL_PERMIT = 0,             /*!< Forward normally, later rules are skipped */
+    LAN9646_ACL_DROP,                   /*!< Forward nowhere */
+    LAN9646_ACL_REDIRECT,               /*!< Forward to port_map only */
+    LAN9646_ACL_MASK,                   /*!< Forward normally, but never to ports outside port_map */
+    LAN9646_ACL_PRIORITY,               /*!< Forward normally with priority prio */
+} lan9646_acl_action_t;
+
+/**
+ * \brief           One rule
+ */
+typedef struct {
+    lan9646_acl_match_t match;
+    bool src;                   /*!< Compare the source MAC/IP/port, else the destination */
+    bool not_equal;             /*!< Match frames that do NOT compare equal */
+    uint8_t mac[6];
+    uint16_t ethertype;
+    uint8_t ip[4];
+    uint8_t ip_mask[4];         /*!< 1 bits are compared */
+    uint8_t proto;              /*!< IP protocol number */
+    uint16_t port_min;
+    uint16_t port_max;
+    lan9646_acl_action_t action;
+    uint8_t port_map;           /*!< REDIRECT/MASK ports, bit 0 = port 1 */
+    uint8_t prio;               /*!< PRIORITY: 0-7 */
+} lan9646_acl_rule_t;
+
+/**
+ * \brief           One hardware entry
+ */
+typedef struct {
+    uint8_t b[LAN9646_ACL_ENTRY_LEN];
+} lan9646_acl_entry_t;
+
+/*===========================================================================*/
+/*                              API FUNCTIONS                                 */
+/*===========================================================================*/
+
+/**
+ * \brief           Compile a rule into the entry at index
+ * \return          \ref lan9646OK, \ref lan9646INVPARAM for a rule the
+ *                  hardware cannot express
+ */
+lan9646r_t lan9646_acl_compile(const lan9646_acl_rule_t* rule, uint8_t index,
+                               lan9646_acl_entry_t* entry);
+
+/**
+ * \brief           Replace the rules of a port
+ * \param[in]       port: Ingress port (1-4, 6, 7)
+ * \param[in]       rules: Rules in precedence order, NULL with count 0 to clear
+ * \param[in]       count: Up to LAN9646_ACL_ENTRIES
+ * \return          \ref lan9646OK; nothing is written if a rule does not compile
+ */
+lan9646r_t lan9646_acl_program(lan9646_t* dev, uint8_t port, const lan9646_acl_rule_t* rules,
+                               uint8_t count);
+
+/**
+ * \brief           Read one entry back from the device
+ */
+lan9646r_t lan9646_acl_read_entry(lan9646_t* dev, uint8_t port, uint8_t index,
+                                  lan9646_acl_entry_t* entry);
+
+/**
+ * \brief           Compare a port's entries with the compiled rules
+ * \param[out]      bad: Entries that differ, bit n = entry n, may be NULL
+ * \return          \ref lan9646OK if all match, \ref lan9646ERR otherwise
+ */
+lan9646r_t lan9646_acl_verify(lan9646_t* dev, uint8_t port, const lan9646_acl_rule_t* rules,
+                              uint8_t count, uint16_t* bad);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* LAN9646_ACL_HDR_H */
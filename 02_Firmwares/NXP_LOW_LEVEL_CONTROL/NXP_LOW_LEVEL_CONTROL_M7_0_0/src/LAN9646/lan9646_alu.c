@@ -0,0 +1,305 @@
+/**
+ * \file            lan9646_alu.c
+ * \brief           LAN9646 address lookup unit (ALU) table management
+ */
+
+#include "lan9646_alu.h"
+#include <string.h>
+
+/*===========================================================================*/
+/*                          PRIVATE FUNCTIONS                                 */
+/*===========================================================================*/
+
+static bool prv_is_valid_port(uint8_t port) {
+    return (port >= 1 && port <= 4) || (port == 6) || (port == 7);
+}
+
+static uint32_t prv_be32(const uint8_t* p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static void prv_put_be32(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+/**
+ * \brief           Entry registers (0x0420-0x042F) from an entry
+ * \param[in]       valid: Static table valid bit
+ */
+static void prv_encode(const lan9646_alu_entry_t* e, bool valid, uint8_t* buf) {
+    uint32_t w0 = ((uint32_t)(e->prio & 0x07U) << LAN9646_ALU_E0_PRIO_SHIFT)
+                  | (e->mstp & LAN9646_ALU_E0_MSTP_MASK);
+    uint32_t w1 = e->port_map & LAN9646_ALU_E1_PORT_MASK;
+
+    if (valid) w0 |= LAN9646_ALU_E0_VALID;
+    if (e->flags & LAN9646_ALU_F_SRC_FILTER) w0 |= LAN9646_ALU_E0_SRC_FILTER;
+    if (e->flags & LAN9646_ALU_F_DST_FILTER) w0 |= LAN9646_ALU_E0_DST_FILTER;
+    if (e->flags & LAN9646_ALU_F_OVERRIDE) w1 |= LAN9646_ALU_E1_OVERRIDE;
+    if (e->flags & LAN9646_ALU_F_USE_FID) w1 |= LAN9646_ALU_E1_USE_FID;
+
+    prv_put_be32(&buf[0], w0);
+    prv_put_be32(&buf[4], w1);
+    prv_put_be32(&buf[8], ((uint32_t)(e->fid & 0x7FU) << LAN9646_ALU_E2_FID_SHIFT)
+                          | ((uint32_t)e->mac[0] << 8) | e->mac[1]);
+    memcpy(&buf[12], &e->mac[2], 4);
+}
+
+/**
+ * \brief           Entry from the entry registers
+ * \return          Bit 31 of entry 0 (static table: valid, ALU: static)
+ */
+static bool prv_decode(const uint8_t* buf, lan9646_alu_entry_t* e) {
+    uint32_t w0 = prv_be32(&buf[0]);
+    uint32_t w1 = prv_be32(&buf[4]);
+    uint32_t w2 = prv_be32(&buf[8]);
+
+    memset(e, 0, sizeof(*e));
+    e->mac[0] = (uint8_t)(w2 >> 8);
+    e->mac[1] = (uint8_t)w2;
+    memcpy(&e->mac[2], &buf[12], 4);
+    e->port_map = (uint8_t)(w1 & LAN9646_ALU_E1_PORT_MASK);
+    e->fid = (uint8_t)((w2 & LAN9646_ALU_E2_FID_MASK) >> LAN9646_ALU_E2_FID_SHIFT);
+    e->prio = (uint8_t)((w0 & LAN9646_ALU_E0_PRIO_MASK) >> LAN9646_ALU_E0_PRIO_SHIFT);
+    e->mstp = (uint8_t)(w0 & LAN9646_ALU_E0_MSTP_MASK);
+
+    if (w0 & LAN9646_ALU_E0_SRC_FILTER) e->flags |= LAN9646_ALU_F_SRC_FILTER;
+    if (w0 & LAN9646_ALU_E0_DST_FILTER) e->flags |= LAN9646_ALU_F_DST_FILTER;
+    if (w1 & LAN9646_ALU_E1_OVERRIDE) e->flags |= LAN9646_ALU_F_OVERRIDE;
+    if (w1 & LAN9646_ALU_E1_USE_FID) e->flags |= LAN9646_ALU_F_USE_FID;
+    return (w0 & LAN9646_ALU_E0_VALID) != 0;
+}
+
+/**
+ * \brief           Start an indirect access and wait until START clears
+ */
+static lan9646r_t prv_run(lan9646_alu_t* alu, uint16_t reg, uint32_t ctrl) {
+    uint8_t tries = 0;
+    uint32_t val;
+    lan9646r_t res;
+
+    alu->stats.table_ops++;
+    res = lan9646_write_reg32(alu->dev, reg, ctrl);
+    if (res != lan9646OK) return res;
+
+    for (;;) {
+        res = lan9646_read_reg32(alu->dev, reg, &val);
+        if (res != lan9646OK) return res;
+        if ((val & LAN9646_STA_START) == 0) return lan9646OK;
+        if (++tries > LAN9646_ALU_POLL_MAX) {
+            alu->stats.timeouts++;
+            return lan9646TIMEOUT;
+        }
+        alu->stats.polls++;
+    }
+}
+
+static lan9646r_t prv_static_read(lan9646_alu_t* alu, uint8_t idx, lan9646_alu_entry_t* e,
+                                  bool* valid) {
+    uint8_t buf[16];
+    lan9646r_t res;
+
+    res = prv_run(alu, LAN9646_REG_STATIC_TABLE_CTRL,
+                  ((uint32_t)idx << LAN9646_STA_INDEX_SHIFT) | LAN9646_STA_START | LAN9646_STA_READ);
+    if (res != lan9646OK) return res;
+
+    res = lan9646_read_burst(alu->dev, LAN9646_REG_ALU_TABLE_ENTRY0, buf, sizeof(buf));
+    if (res != lan9646OK) return res;
+
+    *valid = prv_decode(buf, e);
+    return lan9646OK;
+}
+
+/**
+ * \brief           Load the entry registers in one burst, then commit them to a slot
+ */
+static lan9646r_t prv_static_write(lan9646_alu_t* alu, uint8_t idx, const lan9646_alu_entry_t* e,
+                                   bool valid) {
+    uint8_t buf[16];
+    lan9646r_t res;
+
+    prv_encode(e, valid, buf);
+    res = lan9646_write_burst(alu->dev, LAN9646_REG_ALU_TABLE_ENTRY0, buf, sizeof(buf));
+    if (res != lan9646OK) return res;
+
+    return prv_run(alu, LAN9646_REG_STATIC_TABLE_CTRL,
+                   ((uint32_t)idx << LAN9646_STA_INDEX_SHIFT) | LAN9646_STA_START);
+}
+
+static int prv_find(const lan9646_alu_t* alu, const uint8_t* mac, uint8_t fid) {
+    uint8_t i;
+
+    for (i = 0; i < LAN9646_ALU_STATIC_ENTRIES; i++) {
+        if ((alu->used & (1U << i)) && alu->sta[i].fid == fid
+            && memcmp(alu->sta[i].mac, mac, 6) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/*===========================================================================*/
+/*                              API FUNCTIONS                                 */
+/*===========================================================================*/
+
+lan9646r_t lan9646_alu_init(lan9646_alu_t* alu, lan9646_t* dev) {
+    lan9646r_t res;
+    bool valid;
+    uint8_t i;
+
+    if (alu == NULL || dev == NULL) return lan9646INVPARAM;
+
+    memset(alu, 0, sizeof(*alu));
+    alu->dev = dev;
+
+    for (i = 0; i < LAN9646_ALU_STATIC_ENTRIES; i++) {
+        res = prv_static_read(alu, i, &alu->sta[i], &valid);
+        if (res != lan9646OK) return res;
+        if (valid) {
+            alu->used |= (uint16_t)(1U << i);
+        }
+    }
+    return lan9646OK;
+}
+
+lan9646r_t lan9646_alu_static_add(lan9646_alu_t* alu, const lan9646_alu_entry_t* entry) {
+    lan9646_alu_entry_t e;
+    lan9646r_t res;
+    int idx;
+
+    if (alu == NULL || alu->dev == NULL || entry == NULL) return lan9646INVPARAM;
+
+    e = *entry;
+    e.flags &= (uint8_t)~LAN9646_ALU_F_STATIC;
+
+    idx = prv_find(alu, e.mac, e.fid);
+    if (idx < 0) {
+        for (idx = 0; idx < (int)LAN9646_ALU_STATIC_ENTRIES; idx++) {
+            if ((alu->used & (1U << idx)) == 0) break;
+        }
+        if (idx == (int)LAN9646_ALU_STATIC_ENTRIES) return lan9646ERR;
+    }
+
+    res = prv_static_write(alu, (uint8_t)idx, &e, true);
+    if (res != lan9646OK) return res;
+
+    alu->sta[idx] = e;
+    alu->used |= (uint16_t)(1U << idx);
+    return lan9646OK;
+}
+
+lan9646r_t lan9646_alu_static_remove(lan9646_alu_t* alu, const uint8_t* mac, uint8_t fid) {
+    lan9646r_t res;
+    int idx;
+
+    if (alu == NULL || alu->dev == NULL || mac == NULL) return lan9646INVPARAM;
+
+    idx = prv_find(alu, mac, fid);
+    if (idx < 0) return lan9646ERR;
+
+    res = prv_static_write(alu, (uint8_t)idx, &alu->sta[idx], false);
+    if (res != lan9646OK) return res;
+
+    alu->used &= (uint16_t)~(1U << idx);
+    return lan9646OK;
+}
+
+bool lan9646_alu_static_find(const lan9646_alu_t* alu, const uint8_t* mac, uint8_t fid,
+                             lan9646_alu_entry_t* entry) {
+    int idx;
+
+    if (alu == NULL || mac == NULL) return false;
+
+    idx = prv_find(alu, mac, fid);
+    if (idx < 0) return false;
+    if (entry != NULL) {
+        *entry = alu->sta[idx];
+    }
+    return true;
+}
+
+lan9646r_t lan9646_alu_dump(lan9646_alu_t* alu, lan9646_alu_dump_fn fn, void* arg,
+                            uint16_t* count) {
+    lan9646_alu_entry_t e;
+    uint8_t buf[16];
+    uint16_t n = 0;
+    uint8_t tries = 0;
+    uint32_t ctrl = 0;
+    lan9646r_t res;
+
+    if (alu == NULL || alu->dev == NULL) return lan9646INVPARAM;
+
+    alu->stats.table_ops++;
+    alu->stats.searches++;
+    res = lan9646_write_reg32(alu->dev, LAN9646_REG_ALU_TABLE_CTRL,
+                              LAN9646_ALU_ACTION_SEARCH | LAN9646_ALU_START);
+
+    while (res == lan9646OK) {
+        res = lan9646_read_reg32(alu->dev, LAN9646_REG_ALU_TABLE_CTRL, &ctrl);
+        if (res != lan9646OK) break;
+
+        if (ctrl & LAN9646_ALU_VALID) {
+            /* Reading the last entry register moves the search on */
+            res = lan9646_read_burst(alu->dev, LAN9646_REG_ALU_TABLE_ENTRY0, buf, sizeof(buf));
+            if (res != lan9646OK) break;
+
+            tries = 0;
+            if (prv_decode(buf, &e)) {
+                e.flags |= LAN9646_ALU_F_STATIC;
+            }
+            n++;
+            if ((fn != NULL && !fn(&e, arg)) || n >= LAN9646_ALU_SEARCH_MAX) break;
+        } else if ((ctrl & LAN9646_ALU_START) == 0) {
+            break;
+        } else if (++tries > LAN9646_ALU_POLL_MAX) {
+            alu->stats.timeouts++;
+            res = lan9646TIMEOUT;
+        } else {
+            alu->stats.polls++;
+        }
+    }
+
+    /* Stopped early or failed: end the search so the next access starts clean */
+    if (res != lan9646OK || (ctrl & LAN9646_ALU_START)) {
+        lan9646_write_reg32(alu->dev, LAN9646_REG_ALU_TABLE_CTRL, 0);
+    }
+
+    alu->stats.last_entries = n;
+    if (count != NULL) {
+        *count = n;
+    }
+    return res;
+}
+
+lan9646r_t lan9646_alu_set_aging(lan9646_alu_t* alu, bool enable, uint8_t period_s) {
+    lan9646r_t res;
+
+    if (alu == NULL || alu->dev == NULL || period_s == 0) return lan9646INVPARAM;
+
+    res = lan9646_write_reg8(alu->dev, LAN9646_REG_AGE_PERIOD, period_s);
+    if (res != lan9646OK) return res;
+
+    return lan9646_modify_reg8(alu->dev, LAN9646_REG_LUE_CTRL1, LAN9646_LUE1_AGING_EN,
+                               enable ? LAN9646_LUE1_AGING_EN : 0);
+}
+
+lan9646r_t lan9646_alu_set_learning(lan9646_alu_t* alu, uint8_t port, bool enable) {
+    if (alu == NULL || alu->dev == NULL || !prv_is_valid_port(port)) return lan9646INVPARAM;
+
+    return lan9646_modify_reg8(alu->dev, LAN9646_REG_PORT_MSTP_STATE(port), LAN9646_MSTP_LEARN_DIS,
+                               enable ? 0 : LAN9646_MSTP_LEARN_DIS);
+}
+
+lan9646r_t lan9646_alu_set_unknown_unicast(lan9646_alu_t* alu, uint8_t port_map) {
+    if (alu == NULL || alu->dev == NULL) return lan9646INVPARAM;
+
+    return lan9646_write_reg32(alu->dev, LAN9646_REG_UNKNOWN_UCAST,
+                               LAN9646_UNKNOWN_FWD_EN | (port_map & LAN9646_UNKNOWN_PORT_MASK));
+}
+
+void lan9646_alu_get_stats(const lan9646_alu_t* alu, lan9646_alu_stats_t* stats) {
+    if (alu == NULL || stats == NULL) return;
+    *stats = alu->stats;
+}
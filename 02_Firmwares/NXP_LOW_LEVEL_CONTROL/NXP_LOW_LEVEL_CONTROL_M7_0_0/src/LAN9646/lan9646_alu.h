@@ -0,0 +1,162 @@
+/**
+ * \file            lan9646_alu.h
+ * \brief           LAN9646 address lookup unit (ALU) table management
+ *
+ * Static MAC entries live in the 16-entry static address table and are
+ * written through the static table control register (0x041C). A copy of
+ * the table is kept in RAM, so lookups and free-slot searches cost no bus
+ * access; only add and remove touch the device.
+ *
+ * The dynamic (learned) table is dumped with one hardware search: the
+ * switch walks its hash table and presents each valid entry in turn, so
+ * every entry costs one poll and one 16-byte burst read.
+ *
+ * Port maps use bit 0 = port 1, like LAN9646_PORT_MASK_xxx.
+ */
+
+#ifndef LAN9646_ALU_HDR_H
+#define LAN9646_ALU_HDR_H
+
+#include "lan9646.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/*===========================================================================*/
+/*                              CONFIGURATION                                 */
+/*===========================================================================*/
+
+#ifndef LAN9646_ALU_POLL_MAX
+#define LAN9646_ALU_POLL_MAX        16U     /*!< Control reads while an access is busy */
+#endif
+
+#ifndef LAN9646_ALU_SEARCH_MAX
+#define LAN9646_ALU_SEARCH_MAX      4096U   /*!< Entries returned by one search at most */
+#endif
+
+#define LAN9646_ALU_STATIC_ENTRIES  16U     /*!< Static address table size */
+
+/* Entry flags */
+#define LAN9646_ALU_F_STATIC        0x01U   /*!< Dynamic table: entry is static */
+#define LAN9646_ALU_F_SRC_FILTER    0x02U   /*!< Drop frames with this source MAC */
+#define LAN9646_ALU_F_DST_FILTER    0x04U   /*!< Drop frames to this MAC */
+#define LAN9646_ALU_F_OVERRIDE      0x08U   /*!< Forward even if the port is blocked */
+#define LAN9646_ALU_F_USE_FID       0x10U   /*!< Match the FID as well as the MAC */
+
+/*===========================================================================*/
+/*                              DATA TYPES                                    */
+/*===========================================================================*/
+
+/**
+ * \brief           One ALU or static table entry
+ */
+typedef struct {
+    uint8_t mac[6];
+    uint8_t port_map;           /*!< Forwarding ports, bit 0 = port 1 */
+    uint8_t fid;                /*!< Filter ID (with LAN9646_ALU_F_USE_FID) */
+    uint8_t prio;               /*!< Priority, age count for dynamic entries */
+    uint8_t mstp;               /*!< MSTP instance */
+    uint8_t flags;              /*!< LAN9646_ALU_F_xxx */
+} lan9646_alu_entry_t;
+
+/**
+ * \brief           Dump callback
+ * \return          false to stop the search
+ */
+typedef bool (*lan9646_alu_dump_fn)(const lan9646_alu_entry_t* entry, void* arg);
+
+/**
+ * \brief           ALU counters
+ */
+typedef struct {
+    uint32_t table_ops;         /*!< Indirect table accesses started */
+    uint32_t polls;             /*!< Extra control reads (access still busy) */
+    uint32_t timeouts;
+    uint32_t searches;
+    uint32_t last_entries;      /*!< Entries returned by the last search */
+} lan9646_alu_stats_t;
+
+/**
+ * \brief           ALU context
+ */
+typedef struct {
+    lan9646_t* dev;
+    uint16_t used;              /*!< Valid static entries, bit n = entry n */
+    lan9646_alu_entry_t sta[LAN9646_ALU_STATIC_ENTRIES];    /*!< Copy of the static table */
+    lan9646_alu_stats_t stats;
+} lan9646_alu_t;
+
+/*===========================================================================*/
+/*                              API FUNCTIONS                                 */
+/*===========================================================================*/
+
+/**
+ * \brief           Set up the context and load the static table
+ * \param[out]      alu: Context
+ * \param[in]       dev: Device handle
+ * \return          \ref lan9646OK on success
+ */
+lan9646r_t lan9646_alu_init(lan9646_alu_t* alu, lan9646_t* dev);
+
+/**
+ * \brief           Add or update a static entry
+ * \param[in]       alu: Context
+ * \param[in]       entry: Entry; an existing entry with the same MAC (and
+ *                  FID with LAN9646_ALU_F_USE_FID) is overwritten
+ * \return          \ref lan9646OK, \ref lan9646ERR if the table is full
+ */
+lan9646r_t lan9646_alu_static_add(lan9646_alu_t* alu, const lan9646_alu_entry_t* entry);
+
+/**
+ * \brief           Remove a static entry
+ * \return          \ref lan9646OK, \ref lan9646ERR if there is no such entry
+ */
+lan9646r_t lan9646_alu_static_remove(lan9646_alu_t* alu, const uint8_t* mac, uint8_t fid);
+
+/**
+ * \brief           Look up a static entry (no bus access)
+ * \param[out]      entry: Entry, may be NULL
+ * \return          true if found
+ */
+bool lan9646_alu_static_find(const lan9646_alu_t* alu, const uint8_t* mac, uint8_t fid,
+                             lan9646_alu_entry_t* entry);
+
+/**
+ * \brief           Walk the dynamic table with one hardware search
+ * \param[in]       fn: Called for every valid entry, may be NULL to count only
+ * \param[out]      count: Entries returned, may be NULL
+ * \return          \ref lan9646OK on success
+ */
+lan9646r_t lan9646_alu_dump(lan9646_alu_t* alu, lan9646_alu_dump_fn fn, void* arg,
+                            uint16_t* count);
+
+/**
+ * \brief           Configure aging of dynamic entries
+ * \param[in]       enable: Age out entries not refreshed within the period
+ * \param[in]       period_s: Age period register value in seconds (1-255)
+ */
+lan9646r_t lan9646_alu_set_aging(lan9646_alu_t* alu, bool enable, uint8_t period_s);
+
+/**
+ * \brief           Enable or disable source MAC learning on a port
+ * \param[in]       port: Port (1-4, 6, 7)
+ */
+lan9646r_t lan9646_alu_set_learning(lan9646_alu_t* alu, uint8_t port, bool enable);
+
+/**
+ * \brief           Restrict where unicast frames to unknown MACs are flooded
+ * \param[in]       port_map: Ports that still receive them, bit 0 = port 1
+ */
+lan9646r_t lan9646_alu_set_unknown_unicast(lan9646_alu_t* alu, uint8_t port_map);
+
+/**
+ * \brief           Get ALU counters
+ */
+void lan9646_alu_get_stats(const lan9646_alu_t* alu, lan9646_alu_stats_t* stats);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* LAN9646_ALU_HDR_H */
@@ -0,0 +1,234 @@
+/**
+ * \file            lan9646_async.c
+ * \brief           LAN9646 queued, non-blocking register access
+ */
+
+#include "lan9646_async.h"
+#include <string.h>
+
+/*===========================================================================*/
+/*                          PRIVATE FUNCTIONS                                 */
+/*===========================================================================*/
+
+static uint16_t prv_depth(const lan9646_async_t* eng) {
+    return (uint16_t)(eng->count[LAN9646_ASYNC_HIGH] + eng->count[LAN9646_ASYNC_NORMAL]);
+}
+
+static lan9646r_t prv_queue(lan9646_async_t* eng, lan9646_async_prio_t prio, uint16_t addr,
+                            bool read, uint8_t* data, const uint8_t* wdata, uint16_t len,
+                            lan9646_async_done_fn done, void* arg) {
+    lan9646_async_req_t* r;
+    uint16_t depth;
+
+    if (eng == NULL || eng->bus == NULL || prio >= LAN9646_ASYNC_PRIOS || len == 0
+        || (read && data == NULL) || (!read && wdata == NULL)) {
+        return lan9646INVPARAM;
+    }
+    if (eng->count[prio] >= LAN9646_ASYNC_QUEUE_LEN) {
+        eng->stats.full++;
+        return lan9646ERR;
+    }
+
+    r = &eng->q[prio][(eng->head[prio] + eng->count[prio]) % LAN9646_ASYNC_QUEUE_LEN];
+    r->addr = addr;
+    r->len = len;
+    r->read = read;
+    r->done = done;
+    r->arg = arg;
+    r->pair = false;
+    r->copied = !read && len <= LAN9646_ASYNC_INLINE;
+    if (r->copied) {
+        memcpy(r->val, wdata, len);
+        r->data = NULL;
+    } else {
+        r->data = read ? data : (uint8_t*)wdata;
+    }
+    eng->count[prio]++;
+    eng->stats.queued++;
+
+    depth = prv_depth(eng);
+    if (depth > eng->stats.max_depth) {
+        eng->stats.max_depth = depth;
+    }
+    return lan9646OK;
+}
+
+/**
+ * \brief           Take the next request, high queue first, and put it on the bus
+ * \return          false if nothing is queued
+ */
+static bool prv_start_next(lan9646_async_t* eng) {
+    lan9646_async_prio_t prio;
+    lan9646_async_req_t* cur = &eng->cur;
+
+    if (eng->count[LAN9646_ASYNC_HIGH] > 0) {
+        prio = LAN9646_ASYNC_HIGH;
+        if (eng->count[LAN9646_ASYNC_NORMAL] > 0) {
+            eng->stats.jumps++;
+        }
+    } else if (eng->count[LAN9646_ASYNC_NORMAL] > 0) {
+        prio = LAN9646_ASYNC_NORMAL;
+    } else {
+        return false;
+    }
+
+    *cur = eng->q[prio][eng->head[prio]];
+    eng->head[prio] = (uint8_t)((eng->head[prio] + 1U) % LAN9646_ASYNC_QUEUE_LEN);
+    eng->count[prio]--;
+    if (cur->copied) {
+        cur->data = cur->val;
+    }
+
+    eng->cur_res = eng->bus->start_fn(cur->read, cur->addr, cur->data, cur->len);
+    eng->running = (eng->cur_res == lan9646OK);
+    eng->finished = !eng->running;
+    return true;
+}
+
+/**
+ * \brief           The transaction on the bus ended: start the read of a
+ *                  pair, or leave the request for its callback
+ */
+static void prv_bus_done(lan9646_async_t* eng) {
+    lan9646_async_req_t* cur = &eng->cur;
+
+    if (cur->pair && eng->cur_res == lan9646OK) {
+        cur->pair = false;
+        cur->read = true;
+        cur->addr = cur->rd_addr;
+        cur->data = cur->rd_data;
+        cur->len = cur->rd_len;
+        eng->cur_res = eng->bus->start_fn(true, cur->addr, cur->data, cur->len);
+        if (eng->cur_res == lan9646OK) return;
+    }
+    eng->finished = true;
+}
+
+static void prv_complete(lan9646_async_t* eng) {
+    eng->running = false;
+    eng->finished = false;
+    eng->stats.completed++;
+    if (eng->cur_res != lan9646OK) {
+        eng->stats.errors++;
+    }
+    if (eng->cur.done != NULL) {
+        eng->cur.done(eng->cur_res, eng->cur.arg);
+    }
+}
+
+/*===========================================================================*/
+/*                              API FUNCTIONS                                 */
+/*===========================================================================*/
+
+lan9646r_t lan9646_async_init(lan9646_async_t* eng, const lan9646_async_bus_t* bus) {
+    if (eng == NULL || bus == NULL || bus->start_fn == NULL || bus->step_fn == NULL) {
+        return lan9646INVPARAM;
+    }
+
+    memset(eng, 0, sizeof(*eng));
+    eng->bus = bus;
+    return lan9646OK;
+}
+
+lan9646r_t lan9646_async_read(lan9646_async_t* eng, lan9646_async_prio_t prio, uint16_t addr,
+                              uint8_t* data, uint16_t len, lan9646_async_done_fn done, void* arg) {
+    return prv_queue(eng, prio, addr, true, data, NULL, len, done, arg);
+}
+
+lan9646r_t lan9646_async_write(lan9646_async_t* eng, lan9646_async_prio_t prio, uint16_t addr,
+                               const uint8_t* data, uint16_t len, lan9646_async_done_fn done,
+                               void* arg) {
+    return prv_queue(eng, prio, addr, false, NULL, data, len, done, arg);
+}
+
+lan9646r_t lan9646_async_write8(lan9646_async_t* eng, lan9646_async_prio_t prio, uint16_t addr,
+                                uint8_t value, lan9646_async_done_fn done, void* arg) {
+    return prv_queue(eng, prio, addr, false, NULL, &value, 1, done, arg);
+}
+
+lan9646r_t lan9646_async_write32(lan9646_async_t* eng, lan9646_async_prio_t prio, uint16_t addr,
+                                 uint32_t value, lan9646_async_done_fn done, void* arg) {
+    uint8_t buf[4];
+
+    buf[0] = (uint8_t)(value >> 24);
+    buf[1] = (uint8_t)(value >> 16);
+    buf[2] = (uint8_t)(value >> 8);
+    buf[3] = (uint8_t)value;
+    return prv_queue(eng, prio, addr, false, NULL, buf, sizeof(buf), done, arg);
+}
+
+lan9646r_t lan9646_async_write_read(lan9646_async_t* eng, lan9646_async_prio_t prio,
+                                    uint16_t waddr, const uint8_t* wdata, uint16_t wlen,
+                                    uint16_t raddr, uint8_t* rdata, uint16_t rlen,
+                                    lan9646_async_done_fn done, void* arg) {
+    lan9646_async_req_t* r;
+    lan9646r_t res;
+
+    if (wlen > LAN9646_ASYNC_INLINE || rdata == NULL || rlen == 0) {
+        return lan9646INVPARAM;
+    }
+    res = prv_queue(eng, prio, waddr, false, NULL, wdata, wlen, done, arg);
+    if (res == lan9646OK) {
+        r = &eng->q[prio][(eng->head[prio] + eng->count[prio] - 1U) % LAN9646_ASYNC_QUEUE_LEN];
+        r->pair = true;
+        r->rd_addr = raddr;
+        r->rd_data = rdata;
+        r->rd_len = rlen;
+    }
+    return res;
+}
+
+bool lan9646_async_service(lan9646_async_t* eng, uint16_t budget) {
+    uint16_t spent = 0, used;
+
+    if (eng == NULL || eng->bus == NULL) return false;
+
+    while (spent < budget || eng->finished) {
+        if (eng->finished) {
+            /* The callback may queue the next step of its sequence */
+            prv_complete(eng);
+            continue;
+        }
+        if (!eng->running && !prv_start_next(eng)) {
+            break;
+        }
+        if (eng->finished) {
+            /* start_fn failed: costs one unit so the call stays bounded */
+            spent++;
+            continue;
+        }
+
+        used = 0;
+        if (!eng->bus->step_fn((uint16_t)(budget - spent), &used, &eng->cur_res)) {
+            prv_bus_done(eng);
+        }
+        spent = (uint16_t)(spent + (used > 0 ? used : 1U));
+    }
+
+    if (spent > eng->stats.max_used) {
+        eng->stats.max_used = spent;
+    }
+    return lan9646_async_pending(eng);
+}
+
+bool lan9646_async_pending(const lan9646_async_t* eng) {
+    return eng != NULL && (eng->running || eng->finished || prv_depth(eng) > 0);
+}
+
+void lan9646_async_quiesce(lan9646_async_t* eng) {
+    uint16_t used;
+
+    if (eng == NULL || !eng->running || eng->finished) return;
+
+    while (!eng->finished) {
+        while (eng->bus->step_fn(0xFFFFU, &used, &eng->cur_res)) {
+        }
+        prv_bus_done(eng);
+    }
+    eng->stats.quiesced++;
+}
+
+void lan9646_async_get_stats(const lan9646_async_t* eng, lan9646_async_stats_t* stats) {
+    if (eng == NULL || stats == NULL) return;
+    *stats = eng->stats;
+}
@@ -0,0 +1,195 @@
+/**
+ * \file            lan9646_async.h
+ * \brief           LAN9646 queued, non-blocking register access
+ *
+ * Callers queue reads and writes with a completion callback and return at
+ * once. lan9646_async_service() moves the bus forward by at most a given
+ * budget per call (half-clock phases for the stepped soft I2C), so the
+ * superloop never waits on a whole transaction and packet processing keeps
+ * its latency while MIB snapshots or bulk reads run in the background.
+ *
+ * There are two queues. A request from the high queue is started before
+ * any waiting normal one; a transaction already on the bus is always
+ * finished first.
+ *
+ * A write/read pair (lan9646_async_write_read()) is one request: the read
+ * starts as soon as the write ends, so nothing gets between them. That is
+ * what indirect registers need, e.g. a MIB latch and the fetch of the
+ * latched value.
+ *
+ * The engine talks to the bus directly: the register shadow of lan9646_t
+ * is not consulted or updated, so use it for volatile registers (MIB,
+ * status, tables). Blocking lan9646_xxx() calls on the same bus must call
+ * lan9646_async_quiesce() before they touch it.
+ */
+
+#ifndef LAN9646_ASYNC_HDR_H
+#define LAN9646_ASYNC_HDR_H
+
+#include "lan9646.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/*===========================================================================*/
+/*                              CONFIGURATION                                 */
+/*===========================================================================*/
+
+#ifndef LAN9646_ASYNC_QUEUE_LEN
+#define LAN9646_ASYNC_QUEUE_LEN     8U      /*!< Requests per priority */
+#endif
+
+#ifndef LAN9646_ASYNC_INLINE
+#define LAN9646_ASYNC_INLINE        8U      /*!< Writes up to this size are copied */
+#endif
+
+/*===========================================================================*/
+/*                              DATA TYPES                                    */
+/*===========================================================================*/
+
+typedef enum {
+    LAN9646_ASYNC_HIGH = 0,     /*!< Link/status reads */
+    LAN9646_ASYNC_NORMAL,       /*!< Bulk traffic (MIB, tables) */
+    LAN9646_ASYNC_PRIOS,
+} lan9646_async_prio_t;
+
+/**
+ * \brief           Completion callback, called from lan9646_async_service()
+ * \note            May queue the next request
+ */
+typedef void (*lan9646_async_done_fn)(lan9646r_t res, void* arg);
+
+/**
+ * \brief           Stepped bus backend
+ */
+typedef struct {
+    /* Begin one transaction; nothing needs to happen on the bus yet */
+    lan9646r_t (*start_fn)(bool read, uint16_t reg_addr, uint8_t* data, uint16_t len);
+    /* Run at most budget units; true while the transaction is still running */
+    bool (*step_fn)(uint16_t budget, uint16_t* used, lan9646r_t* res);
+} lan9646_async_bus_t;
+
+/**
+ * \brief           Queued request
+ */
+typedef struct {
+    uint8_t* data;              /*!< Caller's buffer, or val for short writes */
+    void* arg;
+    lan9646_async_done_fn done;
+    uint16_t addr;
+    uint16_t len;
+    bool read;
+    bool copied;                /*!< Write data lives in val */
+    bool pair;                  /*!< A read of rd_addr follows the write */
+    uint16_t rd_addr;
+    uint16_t rd_len;
+    uint8_t* rd_data;
+    uint8_t val[LAN9646_ASYNC_INLINE];
+} lan9646_async_req_t;
+
+/**
+ * \brief           Engine counters
+ */
+typedef struct {
+    uint32_t queued;
+    uint32_t completed;
+    uint32_t errors;            /*!< Completed with a bus error */
+    uint32_t full;              /*!< Rejected, queue full */
+    uint32_t jumps;             /*!< High requests started while normal ones waited */
+    uint32_t quiesced;          /*!< Transactions finished by lan9646_async_quiesce() */
+    uint16_t max_depth;         /*!< Most requests waiting at once */
+    uint16_t max_used;          /*!< Largest budget used by one service call */
+} lan9646_async_stats_t;
+
+/**
+ * \brief           Engine state
+ */
+typedef struct {
+    const lan9646_async_bus_t* bus;
+    lan9646_async_req_t q[LAN9646_ASYNC_PRIOS][LAN9646_ASYNC_QUEUE_LEN];
+    uint8_t head[LAN9646_ASYNC_PRIOS];
+    uint8_t count[LAN9646_ASYNC_PRIOS];
+    lan9646_async_req_t cur;    /*!< Request on the bus */
+    bool running;               /*!< cur is on the bus */
+    bool finished;              /*!< cur ended, callback not called yet */
+    lan9646r_t cur_res;
+    lan9646_async_stats_t stats;
+} lan9646_async_t;
+
+/*===========================================================================*/
+/*                              API FUNCTIONS                                 */
+/*===========================================================================*/
+
+/**
+ * \brief           Set up the engine on a stepped bus
+ */
+lan9646r_t lan9646_async_init(lan9646_async_t* eng, const lan9646_async_bus_t* bus);
+
+/**
+ * \brief           Queue a read
+ * \param[out]      data: Filled before done is called, must stay valid until then
+ * \return          \ref lan9646OK once queued, \ref lan9646ERR if the queue is full
+ */
+lan9646r_t lan9646_async_read(lan9646_async_t* eng, lan9646_async_prio_t prio, uint16_t addr,
+                              uint8_t* data, uint16_t len, lan9646_async_done_fn done, void* arg);
+
+/**
+ * \brief           Queue a write
+ * \param[in]       data: Copied when len <= LAN9646_ASYNC_INLINE, otherwise
+ *                  it must stay valid until done is called
+ */
+lan9646r_t lan9646_async_write(lan9646_async_t* eng, lan9646_async_prio_t prio, uint16_t addr,
+                               const uint8_t* data, uint16_t len, lan9646_async_done_fn done,
+                               void* arg);
+
+/**
+ * \brief           Queue a big-endian 8/32-bit register write
+ */
+lan9646r_t lan9646_async_write8(lan9646_async_t* eng, lan9646_async_prio_t prio, uint16_t addr,
+                                uint8_t value, lan9646_async_done_fn done, void* arg);
+lan9646r_t lan9646_async_write32(lan9646_async_t* eng, lan9646_async_prio_t prio, uint16_t addr,
+                                 uint32_t value, lan9646_async_done_fn done, void* arg);
+
+/**
+ * \brief           Queue a write and a read that run back to back as one request
+ * \param[in]       wdata: Copied, wlen at most LAN9646_ASYNC_INLINE
+ * \param[out]      rdata: Filled before done is called, must stay valid until then
+ * \note            The read is skipped when the write fails; done gets the error
+ */
+lan9646r_t lan9646_async_write_read(lan9646_async_t* eng, lan9646_async_prio_t prio,
+                                    uint16_t waddr, const uint8_t* wdata, uint16_t wlen,
+                                    uint16_t raddr, uint8_t* rdata, uint16_t rlen,
+                                    lan9646_async_done_fn done, void* arg);
+
+/**
+ * \brief           Move the bus forward and deliver completions
+ * \param[in]       budget: Most bus units to spend; every transaction costs
+ *                  at least one, so the call is bounded for any backend
+ * \return          true while requests are queued or running
+ */
+bool lan9646_async_service(lan9646_async_t* eng, uint16_t budget);
+
+/**
+ * \brief           Check for queued or running requests
+ */
+bool lan9646_async_pending(const lan9646_async_t* eng);
+
+/**
+ * \brief           Finish the request on the bus (blocking) and start no other
+ * \note            Call before a blocking access to the same bus. A write/read
+ *                  pair is finished with its read. The callback runs from the
+ *                  next lan9646_async_service().
+ */
+void lan9646_async_quiesce(lan9646_async_t* eng);
+
+/**
+ * \brief           Get engine counters
+ */
+void lan9646_async_get_stats(const lan9646_async_t* eng, lan9646_async_stats_t* stats);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* LAN9646_ASYNC_HDR_H */
@@ -0,0 +1,193 @@
+/**
+ * \file            lan9646_batch.c
+ * \brief           LAN9646 batched register writes
+ */
+
+#include "lan9646_batch.h"
+#include <string.h>
+
+/*===========================================================================*/
+/*                          PRIVATE TYPES / DATA                              */
+/*===========================================================================*/
+
+typedef struct {
+    uint16_t addr;
+    uint8_t val;
+    uint8_t seq;                /* Queue position, later wins on overlap */
+} wbyte_t;
+
+/* Commit scratch: every queued byte, sorted by address */
+static wbyte_t g_bytes[LAN9646_BATCH_MAX * 4U];
+
+/*===========================================================================*/
+/*                          PRIVATE FUNCTIONS                                 */
+/*===========================================================================*/
+
+/**
+ * \brief           Expand, sort and de-duplicate the queued writes
+ * \return          Number of distinct bytes in g_bytes
+ */
+static uint16_t prv_build(const lan9646_batch_t* b) {
+    uint16_t n = 0;
+    uint16_t i, j;
+    uint8_t k;
+
+    for (i = 0; i < b->count; i++) {
+        const lan9646_batch_entry_t* e = &b->ent[i];
+
+        for (k = 0; k < e->width; k++) {
+            g_bytes[n].addr = (uint16_t)(e->addr + k);
+            g_bytes[n].val = (uint8_t)(e->value >> (8U * (e->width - 1U - k)));
+            g_bytes[n].seq = (uint8_t)i;
+            n++;
+        }
+    }
+
+    /* Insertion sort by address, then queue order (n is small) */
+    for (i = 1; i < n; i++) {
+        wbyte_t t = g_bytes[i];
+
+        j = i;
+        while (j > 0 && (g_bytes[j - 1U].addr > t.addr
+                         || (g_bytes[j - 1U].addr == t.addr && g_bytes[j - 1U].seq > t.seq))) {
+            g_bytes[j] = g_bytes[j - 1U];
+            j--;
+        }
+        g_bytes[j] = t;
+    }
+
+    /* Keep the last write of every address */
+    j = 0;
+    for (i = 0; i < n; i++) {
+        if (j > 0 && g_bytes[j - 1U].addr == g_bytes[i].addr) {
+            g_bytes[j - 1U] = g_bytes[i];
+        } else {
+            g_bytes[j++] = g_bytes[i];
+        }
+    }
+    return j;
+}
+
+/**
+ * \brief           Length of the burst starting at g_bytes[start]
+ */
+static uint16_t prv_run(uint16_t start, uint16_t n) {
+    uint16_t len = 1;
+
+    while (start + len < n && len < LAN9646_BATCH_BURST_MAX
+           && g_bytes[start + len].addr == (uint16_t)(g_bytes[start].addr + len)) {
+        len++;
+    }
+    return len;
+}
+
+/*===========================================================================*/
+/*                              API FUNCTIONS                                 */
+/*===========================================================================*/
+
+void lan9646_batch_init(lan9646_batch_t* batch, lan9646_t* dev, bool verify) {
+    if (batch == NULL) return;
+
+    memset(batch, 0, sizeof(*batch));
+    batch->dev = dev;
+    batch->verify = verify;
+}
+
+lan9646r_t lan9646_batch_add(lan9646_batch_t* batch, uint16_t addr, uint8_t width, uint32_t value) {
+    if (batch == NULL || (width != 1U && width != 2U && width != 4U)) {
+        return lan9646INVPARAM;
+    }
+    if (batch->count >= LAN9646_BATCH_MAX) {
+        return lan9646ERR;
+    }
+
+    batch->ent[batch->count].addr = addr;
+    batch->ent[batch->count].width = width;
+    batch->ent[batch->count].value = value;
+    batch->count++;
+    batch->stats.writes++;
+    return lan9646OK;
+}
+
+lan9646r_t lan9646_batch_add_table(lan9646_batch_t* batch, const lan9646_batch_entry_t* table,
+                                   uint16_t count) {
+    lan9646r_t res;
+    uint16_t i;
+
+    if (table == NULL && count > 0) return lan9646INVPARAM;
+
+    for (i = 0; i < count; i++) {
+        res = lan9646_batch_add(batch, table[i].addr, table[i].width, table[i].value);
+        if (res != lan9646OK) return res;
+    }
+    return lan9646OK;
+}
+
+lan9646r_t lan9646_batch_commit(lan9646_batch_t* batch) {
+    uint8_t buf[LAN9646_BATCH_BURST_MAX];
+    lan9646r_t res = lan9646OK;
+    bool mismatch = false;
+    uint16_t n, i, len, k;
+
+    if (batch == NULL || batch->dev == NULL) return lan9646INVPARAM;
+
+    n = prv_build(batch);
+    batch->count = 0;
+
+    for (i = 0; i < n; i += len) {
+        len = prv_run(i, n);
+        for (k = 0; k < len; k++) {
+            buf[k] = g_bytes[i + k].val;
+        }
+        res = lan9646_write_burst(batch->dev, g_bytes[i].addr, buf, len);
+        batch->stats.transactions++;
+        if (res != lan9646OK) return res;
+    }
+
+    if (!batch->verify) return lan9646OK;
+
+    /* Writes held in a write-back shadow must reach the device first */
+    if (batch->dev->shadow != NULL) {
+        res = lan9646_shadow_sync(batch->dev);
+        if (res != lan9646OK) return res;
+    }
+
+    /* Read back with the same bursts, from the device rather than the shadow */
+    for (i = 0; i < n; i += len) {
+        len = prv_run(i, n);
+        lan9646_shadow_invalidate(batch->dev, g_bytes[i].addr, len);
+        res = lan9646_read_burst(batch->dev, g_bytes[i].addr, buf, len);
+        batch->stats.verify_reads++;
+        if (res != lan9646OK) return res;
+
+        for (k = 0; k < len; k++) {
+            if (buf[k] != g_bytes[i + k].val) {
+                batch->stats.verify_errors++;
+                mismatch = true;
+            }
+        }
+    }
+    return mismatch ? lan9646ERR : lan9646OK;
+}
+
+lan9646r_t lan9646_batch_write_table(lan9646_t* dev, const lan9646_batch_entry_t* table,
+                                     uint16_t count, bool verify) {
+    static lan9646_batch_t batch;
+    lan9646r_t res = lan9646OK;
+    uint16_t i, chunk;
+
+    if (dev == NULL || (table == NULL && count > 0)) return lan9646INVPARAM;
+
+    for (i = 0; i < count && res == lan9646OK; i += chunk) {
+        chunk = (uint16_t)(count - i);
+        if (chunk > LAN9646_BATCH_MAX) {
+            chunk = LAN9646_BATCH_MAX;
+        }
+        lan9646_batch_init(&batch, dev, verify);
+        res = lan9646_batch_add_table(&batch, &table[i], chunk);
+        if (res == lan9646OK) {
+            res = lan9646_batch_commit(&batch);
+        }
+    }
+    return res;
+}
@@ -0,0 +1,116 @@
+/**
+ * \file            lan9646_batch.h
+ * \brief           LAN9646 batched register writes
+ *
+ * Writes are queued and issued on commit, sorted by address. Bytes at
+ * consecutive addresses are merged into one burst transaction, and where
+ * writes overlap the one queued last wins. Gaps are never filled, so no
+ * register is written that was not queued.
+ *
+ * \note            Commit reorders writes. Sequences that depend on order
+ *                  (enable after configure, index then trigger) must be
+ *                  split into separate commits.
+ */
+
+#ifndef LAN9646_BATCH_HDR_H
+#define LAN9646_BATCH_HDR_H
+
+#include "lan9646.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/*===========================================================================*/
+/*                              CONFIGURATION                                 */
+/*===========================================================================*/
+
+#ifndef LAN9646_BATCH_MAX
+#define LAN9646_BATCH_MAX           32U     /*!< Writes per batch */
+#endif
+
+#ifndef LAN9646_BATCH_BURST_MAX
+#define LAN9646_BATCH_BURST_MAX     32U     /*!< Bytes per burst transaction */
+#endif
+
+/*===========================================================================*/
+/*                              DATA TYPES                                    */
+/*===========================================================================*/
+
+/**
+ * \brief           One register write (also the element of const init tables)
+ */
+typedef struct {
+    uint16_t addr;              /*!< Register address */
+    uint8_t width;              /*!< 1, 2 or 4 bytes */
+    uint32_t value;
+} lan9646_batch_entry_t;
+
+/**
+ * \brief           Batch counters (accumulated over commits)
+ */
+typedef struct {
+    uint32_t writes;            /*!< Writes queued */
+    uint32_t transactions;      /*!< Burst writes issued */
+    uint32_t verify_reads;      /*!< Burst reads issued for verification */
+    uint32_t verify_errors;     /*!< Bytes that read back differently */
+} lan9646_batch_stats_t;
+
+/**
+ * \brief           Write batch
+ */
+typedef struct {
+    lan9646_t* dev;
+    bool verify;                /*!< Read back every burst after commit */
+    uint8_t count;
+    lan9646_batch_entry_t ent[LAN9646_BATCH_MAX];
+    lan9646_batch_stats_t stats;
+} lan9646_batch_t;
+
+/*===========================================================================*/
+/*                              API FUNCTIONS                                 */
+/*===========================================================================*/
+
+/**
+ * \brief           Start an empty batch
+ * \param[out]      batch: Batch
+ * \param[in]       dev: Device handle
+ * \param[in]       verify: Read back and compare after commit (not for
+ *                  self-clearing or read-clear registers)
+ */
+void lan9646_batch_init(lan9646_batch_t* batch, lan9646_t* dev, bool verify);
+
+/**
+ * \brief           Queue one write
+ * \param[in]       batch: Batch
+ * \param[in]       addr: Register address
+ * \param[in]       width: 1, 2 or 4 bytes
+ * \param[in]       value: Value (big-endian on the bus, like lan9646_write_reg32)
+ * \return          \ref lan9646OK, \ref lan9646ERR if the batch is full
+ */
+lan9646r_t lan9646_batch_add(lan9646_batch_t* batch, uint16_t addr, uint8_t width, uint32_t value);
+
+/**
+ * \brief           Queue a table of writes
+ */
+lan9646r_t lan9646_batch_add_table(lan9646_batch_t* batch, const lan9646_batch_entry_t* table,
+                                   uint16_t count);
+
+/**
+ * \brief           Issue the queued writes as merged bursts and empty the batch
+ * \return          \ref lan9646OK on success, the first bus error otherwise,
+ *                  \ref lan9646ERR if verification found a mismatch
+ */
+lan9646r_t lan9646_batch_commit(lan9646_batch_t* batch);
+
+/**
+ * \brief           Queue a table and commit it
+ */
+lan9646r_t lan9646_batch_write_table(lan9646_t* dev, const lan9646_batch_entry_t* table,
+                                     uint16_t count, bool verify);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* LAN9646_BATCH_HDR_H */
@@ -0,0 +1,429 @@
+/**
+ * \file            lan9646_config.c
+ * \brief           LAN9646 declarative switch configuration
+ */
+
+#include "lan9646_config.h"
+#include "lan9646_batch.h"
+#include <string.h>
+
+/*===========================================================================*/
+/*                          PRIVATE TYPES / DATA                              */
+/*===========================================================================*/
+
+typedef struct {
+    uint16_t addr;
+    uint8_t mask;               /* Bits the description owns */
+    uint8_t val;
+} cbyte_t;
+
+typedef struct {
+    lan9646_t* dev;
+    bool dry_run;
+    lan9646_config_fn fn;
+    void* arg;
+    lan9646_config_report_t* rep;
+    uint16_t n;
+} ctx_t;
+
+/* Wanted register bytes of one step, sorted by address */
+static cbyte_t g_img[LAN9646_CONFIG_BYTES_MAX];
+static lan9646_batch_t g_batch;
+
+/*===========================================================================*/
+/*                          PRIVATE FUNCTIONS                                 */
+/*===========================================================================*/
+
+static bool prv_is_valid_port(uint8_t port) {
+    return (port >= 1 && port <= 4) || (port == 6) || (port == 7);
+}
+
+static lan9646r_t prv_put8(ctx_t* c, uint16_t addr, uint8_t mask, uint8_t val) {
+    uint16_t i = c->n;
+
+    /* Insert sorted; a byte described twice merges, later bits win */
+    while (i > 0 && g_img[i - 1U].addr > addr) {
+        i--;
+    }
+    if (i > 0 && g_img[i - 1U].addr == addr) {
+        cbyte_t* b = &g_img[i - 1U];
+
+        b->val = (uint8_t)((b->val & ~mask) | (val & mask));
+        b->mask |= mask;
+        return lan9646OK;
+    }
+    if (c->n >= LAN9646_CONFIG_BYTES_MAX) return lan9646ERR;
+
+    memmove(&g_img[i + 1U], &g_img[i], (size_t)(c->n - i) * sizeof(g_img[0]));
+    g_img[i].addr = addr;
+    g_img[i].mask = mask;
+    g_img[i].val = (uint8_t)(val & mask);
+    c->n++;
+    return lan9646OK;
+}
+
+/**
+ * \brief           Describe a big-endian register of 1, 2 or 4 bytes
+ */
+static lan9646r_t prv_put(ctx_t* c, uint16_t addr, uint8_t width, uint32_t mask, uint32_t val) {
+    lan9646r_t res;
+    uint8_t k, sh;
+
+    for (k = 0; k < width; k++) {
+        sh = (uint8_t)(8U * (width - 1U - k));
+        res = prv_put8(c, (uint16_t)(addr + k), (uint8_t)(mask >> sh), (uint8_t)(val >> sh));
+        if (res != lan9646OK) return res;
+    }
+    return lan9646OK;
+}
+
+static void prv_report(ctx_t* c, lan9646_config_chg_kind_t kind, uint16_t addr, uint8_t index,
+                       uint32_t old_val, uint32_t new_val) {
+    lan9646_config_change_t chg;
+
+    if (c->fn == NULL) return;
+
+    chg.kind = kind;
+    chg.addr = addr;
+    chg.index = index;
+    chg.old_val = old_val;
+    chg.new_val = new_val;
+    c->fn(&chg, c->arg);
+}
+
+/**
+ * \brief           Length of the read burst starting at g_img[start]
+ * \param[out]      end: Index after the last image byte it covers
+ */
+static uint16_t prv_range(const ctx_t* c, uint16_t start, uint16_t* end) {
+    uint16_t j = (uint16_t)(start + 1U);
+
+    while (j < c->n
+           && (uint16_t)(g_img[j].addr - g_img[start].addr) < LAN9646_BATCH_BURST_MAX
+           && (uint16_t)(g_img[j].addr - g_img[j - 1U].addr) <= LAN9646_CONFIG_GAP_MAX + 1U) {
+        j++;
+    }
+    *end = j;
+    return (uint16_t)(g_img[j - 1U].addr - g_img[start].addr + 1U);
+}
+
+/**
+ * \brief           Issue the batch; a read-back mismatch is only counted
+ */
+static lan9646r_t prv_commit(void) {
+    uint32_t errors = g_batch.stats.verify_errors;
+    lan9646r_t res = lan9646_batch_commit(&g_batch);
+
+    if (res == lan9646ERR && g_batch.stats.verify_errors != errors) {
+        res = lan9646OK;
+    }
+    return res;
+}
+
+static lan9646r_t prv_queue_write(uint16_t addr, uint8_t val) {
+    lan9646r_t res = lan9646_batch_add(&g_batch, addr, 1, val);
+
+    if (res == lan9646ERR) {
+        /* Batch full: issue it, bytes of one step may go in any order */
+        res = prv_commit();
+        if (res == lan9646OK) {
+            res = lan9646_batch_add(&g_batch, addr, 1, val);
+        }
+    }
+    return res;
+}
+
+/**
+ * \brief           Read the image ranges, write the bytes that differ, empty the image
+ */
+static lan9646r_t prv_sync(ctx_t* c, bool verify) {
+    uint8_t buf[LAN9646_BATCH_BURST_MAX];
+    lan9646r_t res = lan9646OK;
+    uint16_t i, j, end, len;
+    uint8_t cur, want;
+
+    lan9646_batch_init(&g_batch, c->dev, verify);
+
+    /* Pending write-back bytes go out first, the invalidate below drops them */
+    if (c->dev->shadow != NULL) {
+        res = lan9646_shadow_sync(c->dev);
+    }
+
+    for (i = 0; i < c->n && res == lan9646OK; i = end) {
+        len = prv_range(c, i, &end);
+        /* Compare with the device, not the shadow */
+        lan9646_shadow_invalidate(c->dev, g_img[i].addr, len);
+        res = lan9646_read_burst(c->dev, g_img[i].addr, buf, len);
+        c->rep->reads++;
+        if (res != lan9646OK) break;
+
+        for (j = i; j < end && res == lan9646OK; j++) {
+            cur = buf[g_img[j].addr - g_img[i].addr];
+            want = (uint8_t)((cur & ~g_img[j].mask) | g_img[j].val);
+            c->rep->checked++;
+            if (want == cur) continue;
+
+            c->rep->changed++;
+            prv_report(c, LAN9646_CONFIG_CHG_REG, g_img[j].addr, 0, cur, want);
+            if (!c->dry_run) {
+                res = prv_queue_write(g_img[j].addr, want);
+            }
+        }
+    }
+
+    if (res == lan9646OK && !c->dry_run) {
+        res = prv_commit();
+    }
+    c->rep->writes = (uint16_t)(c->rep->writes + g_batch.stats.transactions);
+    c->rep->verify_errors = (uint16_t)(c->rep->verify_errors + g_batch.stats.verify_errors);
+    c->n = 0;
+    return res;
+}
+
+/**
+ * \brief           Scheduling mode field of a queue, as lan9646_qos_set_sched()
+ */
+static lan9646r_t prv_sched_mode(const lan9646_qos_queue_t* q, uint8_t* mode) {
+    switch (q->sched) {
+        case LAN9646_QOS_STRICT:
+            *mode = LAN9646_MTI_SCHED_STRICT;
+            return lan9646OK;
+        case LAN9646_QOS_WRR:
+            if (q->weight == 0 || q->weight > LAN9646_MTI_WEIGHT_MASK) return lan9646INVPARAM;
+            *mode = LAN9646_MTI_SCHED_WRR;
+            return lan9646OK;
+        default:
+            return lan9646INVPARAM;
+    }
+}
+
+/**
+ * \brief           Describe the direct registers of one port
+ */
+static lan9646r_t prv_put_port(ctx_t* c, const lan9646_config_port_t* p) {
+    const lan9646_qos_port_cfg_t* q = p->qos;
+    lan9646r_t res = lan9646OK;
+    uint32_t tc_map;
+    uint8_t split, mode, k;
+
+    if (!prv_is_valid_port(p->port)) return lan9646INVPARAM;
+
+    if (p->fields & LAN9646_CONFIG_XMII) {
+        res = prv_put(c, LAN9646_REG_PORT_XMII_CTRL0(p->port), 1, 0xFFU, p->xmii_ctrl0);
+        if (res == lan9646OK) {
+            res = prv_put(c, LAN9646_REG_PORT_XMII_CTRL1(p->port), 1, 0xFFU, p->xmii_ctrl1);
+        }
+    }
+    if (res == lan9646OK && (p->fields & LAN9646_CONFIG_MEMBERS)) {
+        res = prv_put(c, LAN9646_REG_PORT_MEMBERSHIP(p->port), 4, 0xFFFFFFFFUL, p->members);
+    }
+    if (res == lan9646OK && (p->fields & LAN9646_CONFIG_PVID)) {
+        if (p->pvid < 1U || p->pvid > LAN9646_VLAN_VID_MAX) return lan9646INVPARAM;
+        res = prv_put(c, LAN9646_REG_PORT_DEFAULT_TAG0(p->port), 2, LAN9646_PORT_PVID_MASK,
+                      p->pvid);
+    }
+    if (res != lan9646OK || q == NULL) return res;
+
+    /* Same registers and fields as lan9646_qos_port_apply() */
+    if (q->port != p->port || (q->sources & ~LAN9646_PORT_PRIO_SRC_MASK)) return lan9646INVPARAM;
+    switch (q->queues) {
+        case 1: split = LAN9646_PORT_QUEUE_SPLIT_1; break;
+        case 2: split = LAN9646_PORT_QUEUE_SPLIT_2; break;
+        case 4: split = LAN9646_PORT_QUEUE_SPLIT_4; break;
+        default: return lan9646INVPARAM;
+    }
+    res = lan9646_qos_encode_tc_map(q->prio_queue, &tc_map);
+    for (k = 0; k < LAN9646_QOS_PRIOS && res == lan9646OK; k++) {
+        if (q->prio_queue[k] >= q->queues) res = lan9646INVPARAM;
+    }
+    for (k = 0; k < q->queues && res == lan9646OK; k++) {
+        res = prv_sched_mode(&q->q[k], &mode);
+    }
+    if (res != lan9646OK) return res;
+
+    res = prv_put(c, LAN9646_REG_PORT_PRIO_CTRL(p->port), 1,
+                  LAN9646_PORT_PRIO_HIGHEST | LAN9646_PORT_PRIO_OR | LAN9646_PORT_PRIO_SRC_MASK,
+                  LAN9646_PORT_PRIO_HIGHEST | q->sources);
+    if (res == lan9646OK) {
+        res = prv_put(c, LAN9646_REG_PORT_OP_CTRL0(p->port), 1, LAN9646_PORT_QUEUE_SPLIT_MASK,
+                      split);
+    }
+    if (res == lan9646OK) {
+        res = prv_put(c, LAN9646_REG_PORT_TC_MAP(p->port), 4, 0xFFFFFFFFUL, tc_map);
+    }
+    return res;
+}
+
+/**
+ * \brief           Bring the scheduling of one egress queue in line
+ */
+static lan9646r_t prv_sync_queue(ctx_t* c, uint8_t port, uint8_t queue,
+                                 const lan9646_qos_queue_t* q) {
+    uint16_t reg = LAN9646_REG_PORT_MTI_QUEUE_CTRL0(port);
+    uint8_t cur[2], want[2];
+    uint8_t mode, k;
+    lan9646r_t res;
+
+    res = prv_sched_mode(q, &mode);
+    if (res != lan9646OK) return res;
+    res = lan9646_write_reg32(c->dev, LAN9646_REG_PORT_MTI_QUEUE_INDEX(port), queue);
+    if (res != lan9646OK) return res;
+    res = lan9646_read_burst(c->dev, reg, cur, sizeof(cur));
+    if (res != lan9646OK) return res;
+
+    want[0] = (uint8_t)((cur[0] & ~LAN9646_MTI_SCHED_MASK) | (mode << LAN9646_MTI_SCHED_SHIFT));
+    want[1] = (q->sched == LAN9646_QOS_WRR) ? q->weight : cur[1];
+    c->rep->queues_checked++;
+    if (want[0] == cur[0] && want[1] == cur[1]) return lan9646OK;
+
+    c->rep->queues_changed++;
+    for (k = 0; k < 2U; k++) {
+        if (want[k] != cur[k]) {
+            prv_report(c, LAN9646_CONFIG_CHG_QUEUE, (uint16_t)(reg + k), queue, cur[k], want[k]);
+        }
+    }
+    return c->dry_run ? lan9646OK : lan9646_write_burst(c->dev, reg, want, sizeof(want));
+}
+
+/**
+ * \brief           Bring the VLAN table in line
+ * \return          \ref lan9646OK once every VID is in place
+ */
+static lan9646r_t prv_sync_vlans(ctx_t* c, lan9646_vlan_t* vlan, const lan9646_config_t* cfg) {
+    lan9646_vlan_entry_t cur, want;
+    lan9646r_t res = lan9646OK, r;
+    uint16_t i;
+    bool valid;
+
+    for (i = 0; i < cfg->vlan_count; i++) {
+        want = cfg->vlans[i];
+        want.members &= LAN9646_VLAN_MEMBERSHIP_MASK;
+        want.untag &= LAN9646_VLAN_MEMBERSHIP_MASK;
+        want.fid &= (uint8_t)LAN9646_VLAN_FID_MASK;
+
+        r = lan9646_vlan_read(c->dev, want.vid, &cur, &valid);
+        c->rep->vlans_checked++;
+        if (r == lan9646OK && valid && cur.members == want.members && cur.untag == want.untag
+            && cur.fid == want.fid) {
+            r = c->dry_run ? lan9646OK : lan9646_vlan_track(vlan, want.vid);
+        } else if (r == lan9646OK) {
+            c->rep->vlans_changed++;
+            prv_report(c, LAN9646_CONFIG_CHG_VLAN, want.vid, 0, LAN9646_CONFIG_VLAN_WORD(valid, &cur),
+                       LAN9646_CONFIG_VLAN_WORD(true, &want));
+            r = c->dry_run ? lan9646OK : lan9646_vlan_add(vlan, &want);
+        }
+        if (r != lan9646OK && res == lan9646OK) {
+            res = r;
+        }
+    }
+    return res;
+}
+
+/**
+ * \brief           Describe the port and switch-wide registers of step 1
+ * \return          \ref lan9646INVPARAM for a bad description
+ */
+static lan9646r_t prv_put_regs(ctx_t* c, const lan9646_config_t* cfg) {
+    uint8_t regs[LAN9646_QOS_DSCP_MAP_LEN];
+    lan9646r_t res = lan9646OK;
+    uint16_t v;
+    uint8_t i;
+
+    for (v = 0; v < cfg->vlan_count; v++) {
+        if (cfg->vlans[v].vid < 1U || cfg->vlans[v].vid > LAN9646_VLAN_VID_MAX) {
+            return lan9646INVPARAM;
+        }
+    }
+    for (i = 0; i < cfg->port_count && res == lan9646OK; i++) {
+        res = prv_put_port(c, &cfg->ports[i]);
+    }
+    if (res != lan9646OK || cfg->dscp_prio == NULL) return res;
+
+    res = lan9646_qos_encode_dscp_map(cfg->dscp_prio, regs);
+    for (i = 0; i < LAN9646_QOS_DSCP_MAP_LEN && res == lan9646OK; i++) {
+        res = prv_put(c, LAN9646_REG_DIFFSERV_MAP(i), 1, 0xFFU, regs[i]);
+    }
+    return res;
+}
+
+static lan9646r_t prv_sync_queues(ctx_t* c, const lan9646_config_t* cfg) {
+    const lan9646_qos_port_cfg_t* qc;
+    lan9646r_t res = lan9646OK;
+    uint8_t i, q;
+
+    for (i = 0; i < cfg->port_count && res == lan9646OK; i++) {
+        qc = cfg->ports[i].qos;
+        for (q = 0; qc != NULL && q < qc->queues && res == lan9646OK; q++) {
+            res = prv_sync_queue(c, qc->port, q, &qc->q[q]);
+        }
+    }
+    return res;
+}
+
+/**
+ * \brief           Steps 3 and 4: VIDs, then 802.1Q mode and start
+ * \note            A VID not applied keeps 802.1Q mode off, the switch is
+ *                  still started
+ */
+static lan9646r_t prv_sync_final(ctx_t* c, lan9646_vlan_t* vlan, const lan9646_config_t* cfg) {
+    lan9646r_t res = lan9646OK, r = lan9646OK;
+
+    if (vlan != NULL && cfg->vlan_count > 0) {
+        res = prv_sync_vlans(c, vlan, cfg);
+    }
+    if (vlan != NULL && cfg->vlan_enable && res == lan9646OK) {
+        r = prv_put(c, LAN9646_REG_LUE_CTRL0, 1, LAN9646_LUE_VLAN_EN, LAN9646_LUE_VLAN_EN);
+    }
+    if (r == lan9646OK && cfg->start) {
+        r = prv_put(c, LAN9646_REG_SWITCH_OP, 1, LAN9646_SWITCH_START, LAN9646_SWITCH_START);
+    }
+    if (r == lan9646OK) {
+        r = prv_sync(c, false);
+    }
+    return (res != lan9646OK) ? res : r;
+}
+
+/*===========================================================================*/
+/*                              API FUNCTIONS                                 */
+/*===========================================================================*/
+
+lan9646r_t lan9646_config_apply(lan9646_t* dev, lan9646_vlan_t* vlan, const lan9646_config_t* cfg,
+                                bool dry_run, lan9646_config_fn fn, void* arg,
+                                lan9646_config_report_t* report) {
+    lan9646_config_report_t rep;
+    lan9646r_t res;
+    ctx_t c;
+
+    if (dev == NULL || cfg == NULL || (cfg->ports == NULL && cfg->port_count > 0)
+        || (cfg->vlans == NULL && cfg->vlan_count > 0)) {
+        return lan9646INVPARAM;
+    }
+
+    memset(&rep, 0, sizeof(rep));
+    c.dev = dev;
+    c.dry_run = dry_run;
+    c.fn = fn;
+    c.arg = arg;
+    c.rep = &rep;
+    c.n = 0;
+
+    /* A bad description is found before anything is touched */
+    res = prv_put_regs(&c, cfg);
+    if (res == lan9646OK) {
+        res = prv_sync(&c, !dry_run);
+    }
+    if (res == lan9646OK) {
+        res = prv_sync_queues(&c, cfg);
+    }
+    if (res == lan9646OK) {
+        res = prv_sync_final(&c, vlan, cfg);
+    }
+    if (res == lan9646OK && rep.verify_errors > 0) {
+        res = lan9646ERR;
+    }
+
+    if (report != NULL) {
+        *report = rep;
+    }
+    return res;
+}
@@ -0,0 +1,158 @@
+/**
+ * \file            lan9646_config.h
+ * \brief           LAN9646 declarative switch configuration
+ *
+ * The wanted switch state (port XMII, membership, PVID, QoS, DSCP map,
+ * VLAN table, 802.1Q and start) is described by one const structure.
+ * Apply compares it with the device and writes only what differs, so a
+ * warm restart that finds the switch already set up costs a handful of
+ * burst reads and no writes.
+ *
+ * Direct registers are expanded into a byte image with a mask per byte
+ * and sorted. Neighbouring bytes are read with one burst, registers in
+ * small gaps included, and the bytes that differ go out through a
+ * lan9646_batch_t, which merges adjacent ones into bursts. Indexed state
+ * (egress queue scheduling, VLAN entries) is read and written entry by
+ * entry, and only entries that differ are written.
+ *
+ * Order is kept where it matters: port registers first, then queues and
+ * VIDs, then 802.1Q mode (only if every VID is in place) and switch start
+ * in a final step.
+ *
+ * A dry run reports the differences without writing, for drift checks.
+ *
+ * \note            Gap reads must not cover read-clear registers: none lie
+ *                  within LAN9646_CONFIG_GAP_MAX of the registers used here.
+ */
+
+#ifndef LAN9646_CONFIG_HDR_H
+#define LAN9646_CONFIG_HDR_H
+
+#include "lan9646.h"
+#include "lan9646_qos.h"
+#include "lan9646_vlan.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/*===========================================================================*/
+/*                              CONFIGURATION                                 */
+/*===========================================================================*/
+
+#ifndef LAN9646_CONFIG_BYTES_MAX
+#define LAN9646_CONFIG_BYTES_MAX    192U    /*!< Direct register bytes per apply */
+#endif
+
+#ifndef LAN9646_CONFIG_GAP_MAX
+#define LAN9646_CONFIG_GAP_MAX      8U      /*!< Unused bytes read to join two bursts */
+#endif
+
+/* Port fields to apply, combine with | */
+#define LAN9646_CONFIG_XMII         0x01U   /*!< xmii_ctrl0/1 */
+#define LAN9646_CONFIG_MEMBERS      0x02U   /*!< members */
+#define LAN9646_CONFIG_PVID         0x04U   /*!< pvid */
+
+/*===========================================================================*/
+/*                              DATA TYPES                                    */
+/*===========================================================================*/
+
+/**
+ * \brief           Wanted state of one port (also the element of const tables)
+ */
+typedef struct {
+    uint8_t port;               /*!< 1-4, 6, 7 */
+    uint8_t fields;             /*!< LAN9646_CONFIG_xxx to apply */
+    uint8_t xmii_ctrl0;
+    uint8_t xmii_ctrl1;
+    uint32_t members;           /*!< Port membership register, bit 0 = port 1 */
+    uint16_t pvid;
+    const lan9646_qos_port_cfg_t* qos;      /*!< NULL to leave QoS alone */
+} lan9646_config_port_t;
+
+/**
+ * \brief           Wanted switch state
+ */
+typedef struct {
+    const lan9646_config_port_t* ports;
+    uint8_t port_count;
+    const uint8_t* dscp_prio;   /*!< LAN9646_QOS_DSCPS priorities, NULL to leave alone */
+    const lan9646_vlan_entry_t* vlans;
+    uint16_t vlan_count;
+    bool vlan_enable;           /*!< 802.1Q forwarding once all VIDs are in place */
+    bool start;                 /*!< Set the switch start bit last */
+} lan9646_config_t;
+
+/**
+ * \brief           Kind of a reported difference
+ */
+typedef enum {
+    LAN9646_CONFIG_CHG_REG = 0,     /*!< addr: register, old/new: byte */
+    LAN9646_CONFIG_CHG_QUEUE,       /*!< addr: queue register, index: queue, old/new: byte */
+    LAN9646_CONFIG_CHG_VLAN,        /*!< addr: VID, old/new: LAN9646_CONFIG_VLAN_WORD() */
+} lan9646_config_chg_kind_t;
+
+/* VLAN entry packed for reports: valid, FID, untagged and member ports */
+#define LAN9646_CONFIG_VLAN_WORD(valid, e) \
+    (((valid) ? 0x80000000UL : 0UL) | ((uint32_t)(e)->fid << 16) \
+     | ((uint32_t)(e)->untag << 8) | (uint32_t)(e)->members)
+
+/**
+ * \brief           One difference between the description and the device
+ */
+typedef struct {
+    lan9646_config_chg_kind_t kind;
+    uint16_t addr;
+    uint8_t index;
+    uint32_t old_val;
+    uint32_t new_val;
+} lan9646_config_change_t;
+
+/**
+ * \brief           Change callback, called for every difference found
+ */
+typedef void (*lan9646_config_fn)(const lan9646_config_change_t* chg, void* arg);
+
+/**
+ * \brief           Apply report
+ */
+typedef struct {
+    uint16_t checked;           /*!< Register bytes compared */
+    uint16_t changed;           /*!< Register bytes that differed */
+    uint16_t reads;             /*!< Burst reads of direct registers */
+    uint16_t writes;            /*!< Burst writes of direct registers */
+    uint16_t verify_errors;     /*!< Bytes that read back differently */
+    uint8_t queues_checked;
+    uint8_t queues_changed;
+    uint16_t vlans_checked;
+    uint16_t vlans_changed;
+} lan9646_config_report_t;
+
+/*===========================================================================*/
+/*                              API FUNCTIONS                                 */
+/*===========================================================================*/
+
+/**
+ * \brief           Bring the device to the described state
+ * \param[in]       dev: Device handle
+ * \param[in]       vlan: VLAN engine, its VID list is updated; NULL skips the
+ *                  VLAN table and 802.1Q mode
+ * \param[in]       cfg: Wanted state
+ * \param[in]       dry_run: Only compare and report, write nothing (the
+ *                  queue index register is still selected, and pending
+ *                  write-back bytes of the shadow are flushed first)
+ * \param[in]       fn: Change callback, may be NULL
+ * \param[out]      report: Counters of this apply, may be NULL
+ * \return          \ref lan9646OK, \ref lan9646INVPARAM for a bad description
+ *                  (nothing written), \ref lan9646ERR on a read-back mismatch
+ *                  or a VID not applied, the first bus error otherwise
+ */
+lan9646r_t lan9646_config_apply(lan9646_t* dev, lan9646_vlan_t* vlan, const lan9646_config_t* cfg,
+                                bool dry_run, lan9646_config_fn fn, void* arg,
+                                lan9646_config_report_t* report);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* LAN9646_CONFIG_HDR_H */
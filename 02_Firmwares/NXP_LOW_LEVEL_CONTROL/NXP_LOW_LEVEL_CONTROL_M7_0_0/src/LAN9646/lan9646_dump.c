@@ -5,6 +5,8 @@
 
 #include "lan9646.h"
 #include "lan9646_dump.h"
+#include "lan9646_mib.h"
+#include "lan9646_vlan.h"
 #include "log_debug.h"
 #include <stdio.h>
 
@@ -67,28 +69,13 @@ static uint32_t read32(lan9646_t* h, uint16_t addr) {
 }
 
 /**
- * \brief           Read MIB counter (corrected per datasheet)
+ * \brief           Read MIB counter (byte counts truncated to 32 bits)
  */
 static uint32_t read_mib(lan9646_t* h, uint8_t port, uint8_t index) {
-    uint16_t base = (uint16_t)port << 12;
-    uint32_t ctrl;
-    uint32_t data = 0;
-    uint32_t timeout = 1000;
-
-    /* Write: MIB Index [23:16] + Read Enable [25] */
-    ctrl = ((uint32_t)index << 16) | LAN9646_MIB_READ_EN;
-    lan9646_write_reg32(h, base | 0x0500, ctrl);
-
-    /* Poll until bit 25 clears */
-    do {
-        lan9646_read_reg32(h, base | 0x0500, &ctrl);
-        if (--timeout == 0) break;
-    } while (ctrl & LAN9646_MIB_READ_EN);
-
-    /* Read data: bits [35:32] in ctrl[3:0], bits [31:0] in data reg */
-    lan9646_read_reg32(h, base | 0x0504, &data);
+    uint64_t data = 0;
 
-    return data;
+    lan9646_mib_read(h, port, index, &data);
+    return (uint32_t)data;
 }
 
 /*===========================================================================*/
@@ -154,7 +141,7 @@ void lan9646_dump_global(lan9646_t* h) {
           mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
 
     /* MIB Control */
-    print_reg8(h, "SWITCH_MIB_CTRL", 0x0308);
+    print_reg8(h, "SWITCH_MIB_CTRL", LAN9646_REG_SWITCH_MIB_CTRL);
 
     /* LUE Control */
     LOG_I(TAG, "");
@@ -165,8 +152,9 @@ void lan9646_dump_global(lan9646_t* h) {
     print_reg8(h, "AGE_PERIOD", 0x0313);
 
     uint8_t lue0 = read8(h, 0x0310);
-    LOG_I(TAG, "  -> VLAN Enable: %s", (lue0 & 0x10) ? "YES" : "NO");
-    LOG_I(TAG, "  -> Learning Disable: %s", (lue0 & 0x01) ? "YES" : "NO");
+    uint8_t lue1 = read8(h, 0x0311);
+    LOG_I(TAG, "  -> VLAN Enable: %s", (lue0 & LAN9646_LUE_VLAN_EN) ? "YES" : "NO");
+    LOG_I(TAG, "  -> Learning Disable: %s", (lue1 & LAN9646_LUE1_UCAST_LEARN_DIS) ? "YES" : "NO");
 
     /* ALU Interrupt */
     LOG_I(TAG, "");
@@ -301,8 +289,8 @@ void lan9646_dump_port(lan9646_t* h, uint8_t port) {
     /* Classification */
     LOG_I(TAG, "");
     LOG_I(TAG, "--- Classification ---");
-    snprintf(name, sizeof(name), "P%d_CLASS_CTRL", port);
-    print_reg8(h, name, base | 0x0800);
+    snprintf(name, sizeof(name), "P%d_PRIO_CTRL", port);
+    print_reg8(h, name, base | 0x0801);
 
     /* Mirror */
     LOG_I(TAG, "");
@@ -319,8 +307,8 @@ void lan9646_dump_port(lan9646_t* h, uint8_t port) {
     /* Priority */
     LOG_I(TAG, "");
     LOG_I(TAG, "--- Priority ---");
-    snprintf(name, sizeof(name), "P%d_PRIO_CTRL", port);
-    print_reg8(h, name, base | 0x0808);
+    snprintf(name, sizeof(name), "P%d_TC_MAP", port);
+    print_reg32(h, name, base | 0x0808);
 
     /* Queue */
     LOG_I(TAG, "");
@@ -483,22 +471,22 @@ void lan9646_dump_mib(lan9646_t* h, uint8_t port) {
 
     LOG_I(TAG, "");
     LOG_I(TAG, "--- TX Counters ---");
-    LOG_I(TAG, "  TX Hi Priority Bytes: %lu", (unsigned long)read_mib(h, port, 0x60));
-    LOG_I(TAG, "  TX Late Collisions:   %lu", (unsigned long)read_mib(h, port, 0x61));
-    LOG_I(TAG, "  TX Pause:             %lu", (unsigned long)read_mib(h, port, 0x62));
-    LOG_I(TAG, "  TX Broadcast:         %lu", (unsigned long)read_mib(h, port, 0x63));
-    LOG_I(TAG, "  TX Multicast:         %lu", (unsigned long)read_mib(h, port, 0x64));
-    LOG_I(TAG, "  TX Unicast:           %lu", (unsigned long)read_mib(h, port, 0x65));
-    LOG_I(TAG, "  TX Deferred:          %lu", (unsigned long)read_mib(h, port, 0x66));
-    LOG_I(TAG, "  TX Total Collisions:  %lu", (unsigned long)read_mib(h, port, 0x67));
-    LOG_I(TAG, "  TX Excess Collisions: %lu", (unsigned long)read_mib(h, port, 0x68));
-    LOG_I(TAG, "  TX Single Collision:  %lu", (unsigned long)read_mib(h, port, 0x69));
-    LOG_I(TAG, "  TX Multi Collision:   %lu", (unsigned long)read_mib(h, port, 0x6A));
+    LOG_I(TAG, "  TX Hi Priority Bytes: %lu", (unsigned long)read_mib(h, port, 0x15));
+    LOG_I(TAG, "  TX Late Collisions:   %lu", (unsigned long)read_mib(h, port, 0x16));
+    LOG_I(TAG, "  TX Pause:             %lu", (unsigned long)read_mib(h, port, 0x17));
+    LOG_I(TAG, "  TX Broadcast:         %lu", (unsigned long)read_mib(h, port, 0x18));
+    LOG_I(TAG, "  TX Multicast:         %lu", (unsigned long)read_mib(h, port, 0x19));
+    LOG_I(TAG, "  TX Unicast:           %lu", (unsigned long)read_mib(h, port, 0x1A));
+    LOG_I(TAG, "  TX Deferred:          %lu", (unsigned long)read_mib(h, port, 0x1B));
+    LOG_I(TAG, "  TX Total Collisions:  %lu", (unsigned long)read_mib(h, port, 0x1C));
+    LOG_I(TAG, "  TX Excess Collisions: %lu", (unsigned long)read_mib(h, port, 0x1D));
+    LOG_I(TAG, "  TX Single Collision:  %lu", (unsigned long)read_mib(h, port, 0x1E));
+    LOG_I(TAG, "  TX Multi Collision:   %lu", (unsigned long)read_mib(h, port, 0x1F));
 
     LOG_I(TAG, "");
     LOG_I(TAG, "--- Summary Counters ---");
-    LOG_I(TAG, "  RX Total Packets:     %lu", (unsigned long)read_mib(h, port, 0x80));
-    LOG_I(TAG, "  TX Total Bytes:       %lu", (unsigned long)read_mib(h, port, 0x81));
+    LOG_I(TAG, "  RX Bytes:             %lu", (unsigned long)read_mib(h, port, 0x80));
+    LOG_I(TAG, "  TX Bytes:             %lu", (unsigned long)read_mib(h, port, 0x81));
     LOG_I(TAG, "  RX Dropped:           %lu", (unsigned long)read_mib(h, port, 0x82));
     LOG_I(TAG, "  TX Dropped:           %lu", (unsigned long)read_mib(h, port, 0x83));
 }
@@ -807,10 +795,17 @@ void lan9646_dump_vlan_table(lan9646_t* h, uint16_t start_vid, uint16_t count) {
 
     separator("VLAN TABLE");
 
-    for (uint16_t vid = start_vid; vid < start_vid + count; vid++) {
-        uint32_t entry = read32(h, 0x0480 + (vid - 1) * 4);
-        if (entry != 0) {
-            LOG_I(TAG, "VID %4d: 0x%08lX", vid, (unsigned long)entry);
+    for (uint16_t vid = start_vid; vid < start_vid + count && vid <= LAN9646_VLAN_VID_MASK; vid++) {
+        lan9646_vlan_entry_t e;
+        bool valid;
+
+        if (lan9646_vlan_read(h, vid, &e, &valid) != lan9646OK) {
+            LOG_E(TAG, "VID %4d: READ ERROR", vid);
+            break;
+        }
+        if (valid) {
+            LOG_I(TAG, "VID %4d: members=0x%02X untag=0x%02X fid=%u",
+                  vid, e.members, e.untag, e.fid);
         }
     }
 }
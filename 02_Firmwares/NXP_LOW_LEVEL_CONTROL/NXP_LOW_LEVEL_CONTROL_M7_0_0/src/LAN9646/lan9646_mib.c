@@ -0,0 +1,405 @@
+/**
+ * \file            lan9646_mib.c
+ * \brief           LAN9646 MIB snapshot engine
+ */
+
+#include "lan9646_mib.h"
+#include <string.h>
+
+/*===========================================================================*/
+/*                          PRIVATE FUNCTIONS                                 */
+/*===========================================================================*/
+
+static bool prv_is_valid_port(uint8_t port) {
+    return (port >= 1 && port <= 4) || (port == 6) || (port == 7);
+}
+
+/**
+ * \brief           Counter index of a slot (0x00-0x1F, then 0x80-0x83)
+ */
+static uint8_t prv_index(uint8_t slot) {
+    return (slot < 0x20U) ? slot : (uint8_t)(slot + 0x60U);
+}
+
+static bool prv_is_wide(uint8_t index) {
+    return index == LAN9646_MIB_RX_BYTE_CNT || index == LAN9646_MIB_TX_BYTE_CNT;
+}
+
+static uint32_t prv_be32(const uint8_t* p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+/**
+ * \brief           Latch one counter and fetch control + data in one burst
+ * \param[out]      ctrl: Control register (overflow, data [35:32])
+ * \param[out]      data: Data register
+ * \param[in,out]   txn: Bus transactions, incremented
+ * \param[in,out]   polls: Extra control reads, incremented
+ * \note            The flush/freeze enable bit is kept set on every access so
+ *                  a switch-wide freeze or flush always covers the port
+ */
+static lan9646r_t prv_latch(lan9646_t* dev, uint8_t port, uint8_t index,
+                            uint32_t* ctrl, uint32_t* data, uint32_t* txn, uint32_t* polls) {
+    uint8_t buf[8];
+    uint8_t tries = 0;
+    lan9646r_t res;
+
+    res = lan9646_write_reg32(dev, LAN9646_REG_PORT_MIB_CTRL(port),
+                              ((uint32_t)index << LAN9646_MIB_INDEX_SHIFT)
+                              | LAN9646_MIB_READ_EN | LAN9646_MIB_FLUSH_FREEZE_EN);
+    (*txn)++;
+    if (res != lan9646OK) return res;
+
+    /* The latch completes well within one bus transaction; poll only as a fallback */
+    for (;;) {
+        res = lan9646_read_burst(dev, LAN9646_REG_PORT_MIB_CTRL(port), buf, sizeof(buf));
+        (*txn)++;
+        if (res != lan9646OK) return res;
+
+        *ctrl = prv_be32(&buf[0]);
+        if ((*ctrl & LAN9646_MIB_READ_EN) == 0) break;
+        if (++tries > LAN9646_MIB_POLL_MAX) return lan9646TIMEOUT;
+        (*polls)++;
+    }
+
+    *data = prv_be32(&buf[4]);
+    return lan9646OK;
+}
+
+static uint64_t prv_value(uint8_t index, uint32_t ctrl, uint32_t data) {
+    if (prv_is_wide(index)) {
+        return ((uint64_t)(ctrl & LAN9646_MIB_DATA_HI_MASK) << 32) | data;
+    }
+    return data & LAN9646_MIB_CNT_MASK;
+}
+
+/**
+ * \brief           Add a hardware reading to the 64-bit total
+ */
+static void prv_accumulate(lan9646_mib_port_t* p, uint8_t slot, uint8_t index,
+                           uint32_t ctrl, uint32_t data) {
+    uint64_t range = prv_is_wide(index) ? (1ULL << 36) : (1ULL << 30);
+    uint64_t val = prv_value(index, ctrl, data);
+    uint64_t delta;
+
+    if (ctrl & LAN9646_MIB_OVERFLOW) {
+        p->overflows++;
+    }
+#if LAN9646_MIB_READ_CLEAR
+    /* Count since the last read; the flag means it wrapped once on the way */
+    delta = val;
+    if (ctrl & LAN9646_MIB_OVERFLOW) {
+        delta += range;
+    }
+#else
+    /* Free-running: modular difference covers one wrap between snapshots */
+    delta = (val - p->raw[slot]) & (range - 1U);
+    p->raw[slot] = val;
+#endif
+    p->cnt[slot] += delta;
+}
+
+static uint32_t prv_rate(uint64_t delta, uint32_t scale, uint32_t dt_ms) {
+    uint64_t r = delta * scale / dt_ms;
+
+    return (r > 0xFFFFFFFFULL) ? 0xFFFFFFFFUL : (uint32_t)r;
+}
+
+static void prv_update_rates(lan9646_mib_engine_t* eng, uint32_t dt_ms) {
+    uint8_t i;
+
+    for (i = 0; i < LAN9646_MIB_PORTS; i++) {
+        lan9646_mib_port_t* p = &eng->port[i];
+        uint64_t pkts[2], bytes[2];
+
+        if ((eng->port_mask & (1U << (i + 1U))) == 0) continue;
+
+        pkts[0] = p->cnt[LAN9646_MIB_SLOT(LAN9646_MIB_RX_UNICAST)]
+                  + p->cnt[LAN9646_MIB_SLOT(LAN9646_MIB_RX_MULTICAST)]
+                  + p->cnt[LAN9646_MIB_SLOT(LAN9646_MIB_RX_BROADCAST)];
+        pkts[1] = p->cnt[LAN9646_MIB_SLOT(LAN9646_MIB_TX_UNICAST)]
+                  + p->cnt[LAN9646_MIB_SLOT(LAN9646_MIB_TX_MULTICAST)]
+                  + p->cnt[LAN9646_MIB_SLOT(LAN9646_MIB_TX_BROADCAST)];
+        bytes[0] = p->cnt[LAN9646_MIB_SLOT(LAN9646_MIB_RX_BYTE_CNT)];
+        bytes[1] = p->cnt[LAN9646_MIB_SLOT(LAN9646_MIB_TX_BYTE_CNT)];
+
+        if (dt_ms > 0) {
+            p->rate.rx_pps = prv_rate(pkts[0] - p->prev_pkts[0], 1000U, dt_ms);
+            p->rate.tx_pps = prv_rate(pkts[1] - p->prev_pkts[1], 1000U, dt_ms);
+            p->rate.rx_bps = prv_rate(bytes[0] - p->prev_bytes[0], 8000U, dt_ms);
+            p->rate.tx_bps = prv_rate(bytes[1] - p->prev_bytes[1], 8000U, dt_ms);
+        }
+        memcpy(p->prev_pkts, pkts, sizeof(pkts));
+        memcpy(p->prev_bytes, bytes, sizeof(bytes));
+    }
+}
+
+/**
+ * \brief           Close a pass: rates, time stamp and pass counters
+ */
+static void prv_finish(lan9646_mib_engine_t* eng, uint32_t now_ms, uint32_t counters,
+                       uint32_t txn) {
+    prv_update_rates(eng, eng->primed ? (now_ms - eng->last_ms) : 0U);
+    eng->primed = true;
+    eng->last_ms = now_ms;
+
+    eng->stats.snapshots++;
+    eng->stats.counters = counters;
+    eng->stats.transactions = txn;
+}
+
+/*---------------------------------------------------------------------------*/
+/* Queued snapshot: each completion callback queues the next request         */
+/*---------------------------------------------------------------------------*/
+
+static void prv_as_read(lan9646r_t res, void* arg);
+static void prv_as_next_port(lan9646_mib_engine_t* eng);
+
+static void prv_as_done(lan9646r_t res, void* arg) {
+    lan9646_mib_engine_t* eng = arg;
+
+    if (res != lan9646OK) {
+        eng->stats.errors++;
+    }
+    prv_finish(eng, eng->as.now_ms, eng->as.counters, eng->as.txn);
+    eng->as.eng = NULL;
+}
+
+static void prv_as_end(lan9646_mib_engine_t* eng) {
+    if (eng->freeze) {
+        eng->as.txn++;
+        if (lan9646_async_write8(eng->as.eng, LAN9646_ASYNC_NORMAL, LAN9646_REG_SWITCH_MIB_CTRL,
+                                 0, prv_as_done, eng) == lan9646OK) {
+            return;
+        }
+        eng->stats.errors++;
+    }
+    prv_as_done(lan9646OK, eng);
+}
+
+/**
+ * \brief           Latch and fetch as one write/read pair: a blocking MIB read
+ *                  that quiesces the engine cannot latch another counter in between
+ */
+static void prv_as_latch(lan9646_mib_engine_t* eng) {
+    uint32_t ctrl = ((uint32_t)prv_index(eng->as.slot) << LAN9646_MIB_INDEX_SHIFT)
+                    | LAN9646_MIB_READ_EN | LAN9646_MIB_FLUSH_FREEZE_EN;
+    uint8_t cmd[4];
+
+    cmd[0] = (uint8_t)(ctrl >> 24);
+    cmd[1] = (uint8_t)(ctrl >> 16);
+    cmd[2] = (uint8_t)(ctrl >> 8);
+    cmd[3] = (uint8_t)ctrl;
+    eng->as.tries = 0;
+    eng->as.txn += 2U;
+    if (lan9646_async_write_read(eng->as.eng, LAN9646_ASYNC_NORMAL,
+                                 LAN9646_REG_PORT_MIB_CTRL(eng->as.port), cmd, sizeof(cmd),
+                                 LAN9646_REG_PORT_MIB_CTRL(eng->as.port), eng->as.buf,
+                                 sizeof(eng->as.buf), prv_as_read, eng) != lan9646OK) {
+        /* Queue full: stop here, the totals keep what was read */
+        eng->stats.errors++;
+        prv_as_end(eng);
+    }
+}
+
+static void prv_as_fetch(lan9646_mib_engine_t* eng) {
+    eng->as.txn++;
+    if (lan9646_async_read(eng->as.eng, LAN9646_ASYNC_NORMAL,
+                           LAN9646_REG_PORT_MIB_CTRL(eng->as.port), eng->as.buf,
+                           sizeof(eng->as.buf), prv_as_read, eng) != lan9646OK) {
+        eng->stats.errors++;
+        prv_as_end(eng);
+    }
+}
+
+static void prv_as_next_counter(lan9646_mib_engine_t* eng) {
+    if (++eng->as.slot < LAN9646_MIB_COUNTERS) {
+        prv_as_latch(eng);
+    } else {
+        eng->as.port++;
+        prv_as_next_port(eng);
+    }
+}
+
+static void prv_as_next_port(lan9646_mib_engine_t* eng) {
+    while (eng->as.port <= LAN9646_MIB_PORTS && (eng->port_mask & (1U << eng->as.port)) == 0) {
+        eng->as.port++;
+    }
+    if (eng->as.port > LAN9646_MIB_PORTS) {
+        prv_as_end(eng);
+        return;
+    }
+    eng->as.slot = 0;
+    prv_as_latch(eng);
+}
+
+static void prv_as_read(lan9646r_t res, void* arg) {
+    lan9646_mib_engine_t* eng = arg;
+    uint32_t ctrl;
+    uint8_t index = prv_index(eng->as.slot);
+
+    if (res == lan9646OK) {
+        ctrl = prv_be32(&eng->as.buf[0]);
+        if (ctrl & LAN9646_MIB_READ_EN) {
+            if (++eng->as.tries <= LAN9646_MIB_POLL_MAX) {
+                eng->stats.polls++;
+                prv_as_fetch(eng);
+                return;
+            }
+            res = lan9646TIMEOUT;
+        } else {
+            prv_accumulate(&eng->port[eng->as.port - 1U], eng->as.slot, index, ctrl,
+                           prv_be32(&eng->as.buf[4]));
+            eng->as.counters++;
+        }
+    }
+    if (res != lan9646OK) {
+        eng->stats.errors++;
+    }
+    prv_as_next_counter(eng);
+}
+
+static void prv_as_frozen(lan9646r_t res, void* arg) {
+    lan9646_mib_engine_t* eng = arg;
+
+    if (res != lan9646OK) {
+        /* Same as the blocking pass: no freeze, no snapshot */
+        eng->as.eng = NULL;
+        return;
+    }
+    eng->as.port = 1;
+    prv_as_next_port(eng);
+}
+
+/*===========================================================================*/
+/*                              API FUNCTIONS                                 */
+/*===========================================================================*/
+
+lan9646r_t lan9646_mib_read(lan9646_t* dev, uint8_t port, uint8_t index, uint64_t* value) {
+    uint32_t ctrl, data, txn = 0, polls = 0;
+    lan9646r_t res;
+
+    if (dev == NULL || value == NULL || !prv_is_valid_port(port)) {
+        return lan9646INVPARAM;
+    }
+
+    res = prv_latch(dev, port, index, &ctrl, &data, &txn, &polls);
+    if (res == lan9646OK) {
+        *value = prv_value(index, ctrl, data);
+    }
+    return res;
+}
+
+lan9646r_t lan9646_mib_init(lan9646_mib_engine_t* eng, lan9646_t* dev, uint8_t port_mask,
+                            bool freeze) {
+    lan9646r_t res;
+    uint8_t port;
+
+    if (eng == NULL || dev == NULL) return lan9646INVPARAM;
+
+    memset(eng, 0, sizeof(*eng));
+    eng->dev = dev;
+    eng->freeze = freeze;
+
+    for (port = 1; port <= LAN9646_MIB_PORTS; port++) {
+        if ((port_mask & (1U << port)) == 0 || !prv_is_valid_port(port)) continue;
+        eng->port_mask |= (uint8_t)(1U << port);
+
+        /* Let the switch-wide freeze cover this port from the first snapshot */
+        res = lan9646_write_reg32(dev, LAN9646_REG_PORT_MIB_CTRL(port),
+                                  LAN9646_MIB_FLUSH_FREEZE_EN);
+        if (res != lan9646OK) return res;
+    }
+    return lan9646OK;
+}
+
+lan9646r_t lan9646_mib_snapshot(lan9646_mib_engine_t* eng, uint32_t now_ms) {
+    lan9646r_t res = lan9646OK, r;
+    uint32_t ctrl, data, txn = 0, counters = 0;
+    uint8_t port, slot, index;
+
+    if (eng == NULL || eng->dev == NULL) return lan9646INVPARAM;
+
+    if (eng->freeze) {
+        res = lan9646_write_reg8(eng->dev, LAN9646_REG_SWITCH_MIB_CTRL, LAN9646_SW_MIB_FREEZE);
+        txn++;
+        if (res != lan9646OK) return res;
+    }
+
+    for (port = 1; port <= LAN9646_MIB_PORTS; port++) {
+        if ((eng->port_mask & (1U << port)) == 0) continue;
+
+        for (slot = 0; slot < LAN9646_MIB_COUNTERS; slot++) {
+            index = prv_index(slot);
+            r = prv_latch(eng->dev, port, index, &ctrl, &data, &txn, &eng->stats.polls);
+            if (r != lan9646OK) {
+                eng->stats.errors++;
+                if (res == lan9646OK) res = r;
+                continue;
+            }
+            prv_accumulate(&eng->port[port - 1U], slot, index, ctrl, data);
+            counters++;
+        }
+    }
+
+    if (eng->freeze) {
+        r = lan9646_write_reg8(eng->dev, LAN9646_REG_SWITCH_MIB_CTRL, 0);
+        txn++;
+        if (res == lan9646OK) res = r;
+    }
+
+    prv_finish(eng, now_ms, counters, txn);
+    return res;
+}
+
+lan9646r_t lan9646_mib_snapshot_async(lan9646_mib_engine_t* eng, lan9646_async_t* async,
+                                      uint32_t now_ms) {
+    if (eng == NULL || async == NULL || eng->dev == NULL) return lan9646INVPARAM;
+    if (eng->as.eng != NULL) return lan9646ERR;
+
+    eng->as.eng = async;
+    eng->as.now_ms = now_ms;
+    eng->as.txn = 0;
+    eng->as.counters = 0;
+
+    if (eng->freeze) {
+        eng->as.txn++;
+        if (lan9646_async_write8(async, LAN9646_ASYNC_NORMAL, LAN9646_REG_SWITCH_MIB_CTRL,
+                                 LAN9646_SW_MIB_FREEZE, prv_as_frozen, eng) != lan9646OK) {
+            eng->as.eng = NULL;
+            return lan9646ERR;
+        }
+        return lan9646OK;
+    }
+
+    eng->as.port = 1;
+    prv_as_next_port(eng);
+    return lan9646OK;
+}
+
+bool lan9646_mib_busy(const lan9646_mib_engine_t* eng) {
+    return eng != NULL && eng->as.eng != NULL;
+}
+
+uint64_t lan9646_mib_get(const lan9646_mib_engine_t* eng, uint8_t port, uint8_t index) {
+    if (eng == NULL || !prv_is_valid_port(port)
+        || (index >= 0x20U && (index < 0x80U || index > 0x83U))) {
+        return 0;
+    }
+    return eng->port[port - 1U].cnt[LAN9646_MIB_SLOT(index)];
+}
+
+bool lan9646_mib_get_rate(const lan9646_mib_engine_t* eng, uint8_t port,
+                          lan9646_mib_rate_t* rate) {
+    if (eng == NULL || rate == NULL || !prv_is_valid_port(port)
+        || (eng->port_mask & (1U << port)) == 0 || eng->stats.snapshots < 2U) {
+        return false;
+    }
+    *rate = eng->port[port - 1U].rate;
+    return true;
+}
+
+void lan9646_mib_get_stats(const lan9646_mib_engine_t* eng, lan9646_mib_stats_t* stats) {
+    if (eng == NULL || stats == NULL) return;
+    *stats = eng->stats;
+}
@@ -0,0 +1,195 @@
+/**
+ * \file            lan9646_mib.h
+ * \brief           LAN9646 MIB snapshot engine
+ *
+ * All MIB access goes through lan9646_mib_read(): one index write, then
+ * one 8-byte burst that returns the control and data registers together,
+ * so a counter normally costs two bus transactions with no extra polling.
+ *
+ * The engine reads every counter of the selected ports in one table-driven
+ * pass and accumulates them into 64-bit software counters, handling the
+ * 30-bit and 36-bit (byte count) hardware widths and the overflow flag.
+ * With freeze enabled the pass runs under the switch-wide MIB freeze, so
+ * all ports are sampled at the same instant; the switch does not count
+ * while frozen, so traffic during the pass is lost from the totals.
+ *
+ * lan9646_mib_snapshot_async() runs the same pass through the queued
+ * register engine, one latch/fetch pair per counter at normal priority, so
+ * the caller is never blocked and high-priority requests get in between
+ * counters. Direct lan9646_mib_read() calls may run meanwhile as long as
+ * the bus callbacks call lan9646_async_quiesce() first.
+ */
+
+#ifndef LAN9646_MIB_HDR_H
+#define LAN9646_MIB_HDR_H
+
+#include "lan9646.h"
+#include "lan9646_async.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/*===========================================================================*/
+/*                              CONFIGURATION                                 */
+/*===========================================================================*/
+
+#ifndef LAN9646_MIB_READ_CLEAR
+#define LAN9646_MIB_READ_CLEAR      1       /*!< 1: counters clear on read, 0: free-running */
+#endif
+
+#ifndef LAN9646_MIB_POLL_MAX
+#define LAN9646_MIB_POLL_MAX        8U      /*!< Re-reads while READ_EN is still set */
+#endif
+
+#define LAN9646_MIB_COUNTERS        36U     /*!< Indices 0x00-0x1F and 0x80-0x83 */
+#define LAN9646_MIB_PORTS           7U      /*!< Ports 1-7 (5 does not exist) */
+
+/**
+ * \brief           Slot of a counter index in lan9646_mib_port_t.cnt
+ */
+#define LAN9646_MIB_SLOT(index)     ((index) < 0x80U ? (index) : ((index) - 0x60U))
+
+/*===========================================================================*/
+/*                              DATA TYPES                                    */
+/*===========================================================================*/
+
+/**
+ * \brief           Per-port rates over the last snapshot interval
+ */
+typedef struct {
+    uint32_t rx_pps;            /*!< RX packets/s (unicast + multicast + broadcast) */
+    uint32_t tx_pps;            /*!< TX packets/s */
+    uint32_t rx_bps;            /*!< RX bits/s (from the 36-bit byte counter) */
+    uint32_t tx_bps;            /*!< TX bits/s */
+} lan9646_mib_rate_t;
+
+/**
+ * \brief           Per-port accumulated counters
+ */
+typedef struct {
+    uint64_t cnt[LAN9646_MIB_COUNTERS];     /*!< Totals, indexed by LAN9646_MIB_SLOT() */
+#if !LAN9646_MIB_READ_CLEAR
+    uint64_t raw[LAN9646_MIB_COUNTERS];     /*!< Last hardware value */
+#endif
+    uint64_t prev_pkts[2];      /*!< RX/TX packet totals at the previous snapshot */
+    uint64_t prev_bytes[2];     /*!< RX/TX byte totals at the previous snapshot */
+    lan9646_mib_rate_t rate;
+    uint32_t overflows;         /*!< Hardware overflow flags seen */
+} lan9646_mib_port_t;
+
+/**
+ * \brief           Engine counters
+ */
+typedef struct {
+    uint32_t snapshots;
+    uint32_t counters;          /*!< Counters read by the last snapshot */
+    uint32_t transactions;      /*!< Bus transactions of the last snapshot */
+    uint32_t polls;             /*!< Extra control reads (READ_EN still set), total */
+    uint32_t errors;            /*!< Counters that failed to read, total */
+} lan9646_mib_stats_t;
+
+/**
+ * \brief           State of a queued snapshot
+ */
+typedef struct {
+    lan9646_async_t* eng;       /*!< NULL when no snapshot is running */
+    uint32_t now_ms;
+    uint32_t txn;
+    uint32_t counters;
+    uint8_t port;
+    uint8_t slot;
+    uint8_t tries;
+    uint8_t buf[8];             /*!< Control + data registers */
+} lan9646_mib_async_t;
+
+/**
+ * \brief           MIB engine
+ */
+typedef struct {
+    lan9646_t* dev;
+    uint8_t port_mask;          /*!< Bit n = port n */
+    bool freeze;
+    bool primed;                /*!< A previous snapshot exists for rates */
+    uint32_t last_ms;           /*!< Time of the previous snapshot */
+    lan9646_mib_port_t port[LAN9646_MIB_PORTS];     /*!< Index = port - 1 */
+    lan9646_mib_stats_t stats;
+    lan9646_mib_async_t as;
+} lan9646_mib_engine_t;
+
+/*===========================================================================*/
+/*                              API FUNCTIONS                                 */
+/*===========================================================================*/
+
+/**
+ * \brief           Read one hardware counter
+ * \param[in]       dev: Device handle
+ * \param[in]       port: Port (1-4, 6, 7)
+ * \param[in]       index: Counter index (LAN9646_MIB_xxx)
+ * \param[out]      value: Counter value, 36 bits for the byte counters
+ * \return          \ref lan9646OK on success
+ * \note            Counters are READ-CLEAR (LAN9646_MIB_READ_CLEAR)
+ */
+lan9646r_t lan9646_mib_read(lan9646_t* dev, uint8_t port, uint8_t index, uint64_t* value);
+
+/**
+ * \brief           Set up the engine
+ * \param[out]      eng: Engine
+ * \param[in]       dev: Device handle
+ * \param[in]       port_mask: Ports to snapshot (bit n = port n)
+ * \param[in]       freeze: Sample all ports under the switch-wide freeze
+ * \return          \ref lan9646OK on success
+ */
+lan9646r_t lan9646_mib_init(lan9646_mib_engine_t* eng, lan9646_t* dev, uint8_t port_mask,
+                            bool freeze);
+
+/**
+ * \brief           Read all counters of all selected ports and update totals and rates
+ * \param[in]       eng: Engine
+ * \param[in]       now_ms: Current time in ms (sys_timer_now_ms())
+ * \return          \ref lan9646OK, or the first bus error (the pass goes on
+ *                  and updates every counter that could be read)
+ * \note            Blocks for two bus transactions per counter
+ */
+lan9646r_t lan9646_mib_snapshot(lan9646_mib_engine_t* eng, uint32_t now_ms);
+
+/**
+ * \brief           Start a snapshot through the queued register engine
+ * \param[in]       eng: Engine
+ * \param[in]       async: Queued register engine on the same bus
+ * \param[in]       now_ms: Time stamp used for the rates
+ * \return          \ref lan9646OK once started, \ref lan9646ERR if one is
+ *                  running or the queue is full
+ * \note            Totals and rates change when the last counter is in
+ */
+lan9646r_t lan9646_mib_snapshot_async(lan9646_mib_engine_t* eng, lan9646_async_t* async,
+                                      uint32_t now_ms);
+
+/**
+ * \brief           Check for a queued snapshot in progress
+ */
+bool lan9646_mib_busy(const lan9646_mib_engine_t* eng);
+
+/**
+ * \brief           Get an accumulated counter
+ * \return          Total since lan9646_mib_init(), 0 for unknown port/index
+ */
+uint64_t lan9646_mib_get(const lan9646_mib_engine_t* eng, uint8_t port, uint8_t index);
+
+/**
+ * \brief           Get the rates of a port
+ * \return          false for an unknown port or before the second snapshot
+ */
+bool lan9646_mib_get_rate(const lan9646_mib_engine_t* eng, uint8_t port,
+                          lan9646_mib_rate_t* rate);
+
+/**
+ * \brief           Get engine counters
+ */
+void lan9646_mib_get_stats(const lan9646_mib_engine_t* eng, lan9646_mib_stats_t* stats);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* LAN9646_MIB_HDR_H */
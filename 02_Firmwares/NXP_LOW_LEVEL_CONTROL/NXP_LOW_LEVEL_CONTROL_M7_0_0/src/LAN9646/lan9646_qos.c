@@ -0,0 +1,178 @@
+/**
+ * \file            lan9646_qos.c
+ * \brief           LAN9646 QoS classification and egress queue scheduling
+ */
+
+#include "lan9646_qos.h"
+#include <stddef.h>
+
+/*===========================================================================*/
+/*                          PRIVATE FUNCTIONS                                 */
+/*===========================================================================*/
+
+static bool prv_is_valid_port(uint8_t port) {
+    return (port >= 1 && port <= 4) || (port == 6) || (port == 7);
+}
+
+/*===========================================================================*/
+/*                              API FUNCTIONS                                 */
+/*===========================================================================*/
+
+lan9646r_t lan9646_qos_encode_tc_map(const uint8_t prio_queue[LAN9646_QOS_PRIOS], uint32_t* reg) {
+    uint32_t v = 0;
+    uint8_t p;
+
+    if (prio_queue == NULL || reg == NULL) return lan9646INVPARAM;
+
+    for (p = 0; p < LAN9646_QOS_PRIOS; p++) {
+        if (prio_queue[p] >= LAN9646_QOS_QUEUES) return lan9646INVPARAM;
+        v |= (uint32_t)prio_queue[p] << LAN9646_TC_MAP_SHIFT(p);
+    }
+    *reg = v;
+    return lan9646OK;
+}
+
+lan9646r_t lan9646_qos_encode_dscp_map(const uint8_t dscp_prio[LAN9646_QOS_DSCPS],
+                                       uint8_t regs[LAN9646_QOS_DSCP_MAP_LEN]) {
+    uint8_t d;
+
+    if (dscp_prio == NULL || regs == NULL) return lan9646INVPARAM;
+
+    for (d = 0; d < LAN9646_QOS_DSCPS; d += 2U) {
+        if (dscp_prio[d] > LAN9646_DIFFSERV_PRIO_MASK
+            || dscp_prio[d + 1U] > LAN9646_DIFFSERV_PRIO_MASK) {
+            return lan9646INVPARAM;
+        }
+        regs[d >> 1] = (uint8_t)(dscp_prio[d] | (dscp_prio[d + 1U] << 4));
+    }
+    return lan9646OK;
+}
+
+lan9646r_t lan9646_qos_set_dscp_map(lan9646_t* dev, const uint8_t dscp_prio[LAN9646_QOS_DSCPS]) {
+    uint8_t regs[LAN9646_QOS_DSCP_MAP_LEN];
+    lan9646r_t res;
+
+    if (dev == NULL) return lan9646INVPARAM;
+
+    res = lan9646_qos_encode_dscp_map(dscp_prio, regs);
+    if (res != lan9646OK) return res;
+    return lan9646_write_burst(dev, LAN9646_REG_DIFFSERV_MAP(0), regs, sizeof(regs));
+}
+
+lan9646r_t lan9646_qos_set_dscp(lan9646_t* dev, uint8_t dscp, uint8_t prio) {
+    uint8_t shift = (uint8_t)((dscp & 1U) * 4U);
+
+    if (dev == NULL || dscp >= LAN9646_QOS_DSCPS || prio > LAN9646_DIFFSERV_PRIO_MASK) {
+        return lan9646INVPARAM;
+    }
+    return lan9646_modify_reg8(dev, LAN9646_REG_DIFFSERV_MAP(dscp >> 1),
+                               (uint8_t)(0x0FU << shift), (uint8_t)(prio << shift));
+}
+
+lan9646r_t lan9646_qos_set_sources(lan9646_t* dev, uint8_t port, uint8_t sources) {
+    if (dev == NULL || !prv_is_valid_port(port) || (sources & ~LAN9646_PORT_PRIO_SRC_MASK)) {
+        return lan9646INVPARAM;
+    }
+    return lan9646_modify_reg8(dev, LAN9646_REG_PORT_PRIO_CTRL(port),
+                               LAN9646_PORT_PRIO_HIGHEST | LAN9646_PORT_PRIO_OR
+                                   | LAN9646_PORT_PRIO_SRC_MASK,
+                               LAN9646_PORT_PRIO_HIGHEST | sources);
+}
+
+lan9646r_t lan9646_qos_set_queues(lan9646_t* dev, uint8_t port, uint8_t queues) {
+    uint8_t split;
+
+    if (dev == NULL || !prv_is_valid_port(port)) return lan9646INVPARAM;
+
+    switch (queues) {
+        case 1: split = LAN9646_PORT_QUEUE_SPLIT_1; break;
+        case 2: split = LAN9646_PORT_QUEUE_SPLIT_2; break;
+        case 4: split = LAN9646_PORT_QUEUE_SPLIT_4; break;
+        default: return lan9646INVPARAM;
+    }
+    return lan9646_modify_reg8(dev, LAN9646_REG_PORT_OP_CTRL0(port),
+                               LAN9646_PORT_QUEUE_SPLIT_MASK, split);
+}
+
+lan9646r_t lan9646_qos_set_prio_queue(lan9646_t* dev, uint8_t port,
+                                      const uint8_t prio_queue[LAN9646_QOS_PRIOS]) {
+    uint32_t reg;
+    lan9646r_t res;
+
+    if (dev == NULL || !prv_is_valid_port(port)) return lan9646INVPARAM;
+
+    res = lan9646_qos_encode_tc_map(prio_queue, &reg);
+    if (res != lan9646OK) return res;
+    return lan9646_write_reg32(dev, LAN9646_REG_PORT_TC_MAP(port), reg);
+}
+
+lan9646r_t lan9646_qos_set_sched(lan9646_t* dev, uint8_t port, uint8_t queue,
+                                 const lan9646_qos_queue_t* q) {
+    uint8_t mode;
+    lan9646r_t res;
+
+    if (dev == NULL || q == NULL || !prv_is_valid_port(port) || queue >= LAN9646_QOS_QUEUES) {
+        return lan9646INVPARAM;
+    }
+
+    switch (q->sched) {
+        case LAN9646_QOS_STRICT:
+            mode = LAN9646_MTI_SCHED_STRICT;
+            break;
+        case LAN9646_QOS_WRR:
+            if (q->weight == 0 || q->weight > LAN9646_MTI_WEIGHT_MASK) return lan9646INVPARAM;
+            mode = LAN9646_MTI_SCHED_WRR;
+            break;
+        default:
+            return lan9646INVPARAM;
+    }
+
+    res = lan9646_write_reg32(dev, LAN9646_REG_PORT_MTI_QUEUE_INDEX(port), queue);
+    if (res != lan9646OK) return res;
+    res = lan9646_modify_reg8(dev, LAN9646_REG_PORT_MTI_QUEUE_CTRL0(port), LAN9646_MTI_SCHED_MASK,
+                              (uint8_t)(mode << LAN9646_MTI_SCHED_SHIFT));
+    if (res != lan9646OK || q->sched != LAN9646_QOS_WRR) return res;
+    return lan9646_write_reg8(dev, LAN9646_REG_PORT_MTI_QUEUE_CTRL1(port), q->weight);
+}
+
+lan9646r_t lan9646_qos_port_apply(lan9646_t* dev, const lan9646_qos_port_cfg_t* cfg) {
+    uint32_t reg;
+    lan9646r_t res;
+    uint8_t q;
+
+    if (dev == NULL || cfg == NULL || !prv_is_valid_port(cfg->port)) return lan9646INVPARAM;
+
+    /* Check the map before touching the port: every priority on an enabled queue */
+    res = lan9646_qos_encode_tc_map(cfg->prio_queue, &reg);
+    if (res != lan9646OK) return res;
+    if (cfg->queues != 1U && cfg->queues != 2U && cfg->queues != 4U) return lan9646INVPARAM;
+    for (q = 0; q < LAN9646_QOS_PRIOS; q++) {
+        if (cfg->prio_queue[q] >= cfg->queues) return lan9646INVPARAM;
+    }
+
+    res = lan9646_qos_set_sources(dev, cfg->port, cfg->sources);
+    if (res != lan9646OK) return res;
+    res = lan9646_qos_set_queues(dev, cfg->port, cfg->queues);
+    if (res != lan9646OK) return res;
+    res = lan9646_write_reg32(dev, LAN9646_REG_PORT_TC_MAP(cfg->port), reg);
+    if (res != lan9646OK) return res;
+
+    for (q = 0; q < cfg->queues; q++) {
+        res = lan9646_qos_set_sched(dev, cfg->port, q, &cfg->q[q]);
+        if (res != lan9646OK) return res;
+    }
+    return lan9646OK;
+}
+
+lan9646r_t lan9646_qos_get_drops(const lan9646_mib_engine_t* mib, uint8_t port,
+                                 lan9646_qos_drops_t* drops) {
+    if (mib == NULL || drops == NULL || !prv_is_valid_port(port)
+        || (mib->port_mask & (1U << port)) == 0) {
+        return lan9646INVPARAM;
+    }
+
+    drops->rx_drop = lan9646_mib_get(mib, port, LAN9646_MIB_RX_DROP);
+    drops->tx_drop = lan9646_mib_get(mib, port, LAN9646_MIB_TX_DROP);
+    drops->tx_hi_prio_bytes = lan9646_mib_get(mib, port, LAN9646_MIB_TX_HI_PRIO_BYTE);
+    return lan9646OK;
+}
@@ -0,0 +1,154 @@
+/**
+ * \file            lan9646_qos.h
+ * \brief           LAN9646 QoS classification and egress queue scheduling
+ *
+ * A frame gets an internal priority (0-7) on ingress from the sources the
+ * receiving port enables: the tag PCP, the DSCP through the switch-wide
+ * DiffServ map, or an ACL PRIORITY rule. The egress port maps the priority
+ * to one of its queues and serves the queues strict-priority or weighted
+ * round robin. Strict queues must be the highest ones: queue 3 is served
+ * first.
+ *
+ * The 64-entry DSCP map goes out as one 32-byte burst. The encoders are
+ * exposed so the register images can be checked without a device.
+ *
+ * \note            The switch counts drops per port, not per queue.
+ */
+
+#ifndef LAN9646_QOS_HDR_H
+#define LAN9646_QOS_HDR_H
+
+#include "lan9646.h"
+#include "lan9646_mib.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/*===========================================================================*/
+/*                              CONFIGURATION                                 */
+/*===========================================================================*/
+
+#define LAN9646_QOS_PRIOS           8U
+#define LAN9646_QOS_QUEUES          4U
+#define LAN9646_QOS_DSCPS           64U
+#define LAN9646_QOS_DSCP_MAP_LEN    32U     /*!< 0x0340-0x035F */
+
+/* Priority sources, combine with | */
+#define LAN9646_QOS_SRC_PCP         LAN9646_PORT_PRIO_8021P
+#define LAN9646_QOS_SRC_DSCP        LAN9646_PORT_PRIO_DIFFSERV
+#define LAN9646_QOS_SRC_ACL         LAN9646_PORT_PRIO_ACL
+#define LAN9646_QOS_SRC_VLAN        LAN9646_PORT_PRIO_VLAN
+#define LAN9646_QOS_SRC_MAC         LAN9646_PORT_PRIO_MAC
+
+/*===========================================================================*/
+/*                              DATA TYPES                                    */
+/*===========================================================================*/
+
+/**
+ * \brief           Queue scheduling
+ */
+typedef enum {
+    LAN9646_QOS_STRICT = 0,
+    LAN9646_QOS_WRR,
+} lan9646_qos_sched_t;
+
+/**
+ * \brief           Scheduling of one egress queue
+ */
+typedef struct {
+    lan9646_qos_sched_t sched;
+    uint8_t weight;             /*!< WRR weight, 1-127 */
+} lan9646_qos_queue_t;
+
+/**
+ * \brief           QoS setup of one port (also the element of const tables)
+ */
+typedef struct {
+    uint8_t port;
+    uint8_t sources;            /*!< Ingress priority sources, LAN9646_QOS_SRC_xxx */
+    uint8_t queues;             /*!< Egress queues: 1, 2 or 4 */
+    uint8_t prio_queue[LAN9646_QOS_PRIOS];      /*!< Egress queue of each priority */
+    lan9646_qos_queue_t q[LAN9646_QOS_QUEUES];
+} lan9646_qos_port_cfg_t;
+
+/**
+ * \brief           Drop counters of a port, totals from the MIB engine
+ */
+typedef struct {
+    uint64_t rx_drop;           /*!< Dropped on ingress (policing, ACL, no buffer) */
+    uint64_t tx_drop;           /*!< Dropped in the egress queues */
+    uint64_t tx_hi_prio_bytes;  /*!< Bytes sent from the highest queue */
+} lan9646_qos_drops_t;
+
+/*===========================================================================*/
+/*                              API FUNCTIONS                                 */
+/*===========================================================================*/
+
+/**
+ * \brief           Encode a priority-to-queue map into the TC map register
+ * \return          \ref lan9646OK, \ref lan9646INVPARAM for a queue above 3
+ */
+lan9646r_t lan9646_qos_encode_tc_map(const uint8_t prio_queue[LAN9646_QOS_PRIOS], uint32_t* reg);
+
+/**
+ * \brief           Encode a DSCP-to-priority map into the DiffServ registers
+ * \param[out]      regs: Image of 0x0340-0x035F
+ * \return          \ref lan9646OK, \ref lan9646INVPARAM for a priority above 7
+ */
+lan9646r_t lan9646_qos_encode_dscp_map(const uint8_t dscp_prio[LAN9646_QOS_DSCPS],
+                                       uint8_t regs[LAN9646_QOS_DSCP_MAP_LEN]);
+
+/**
+ * \brief           Write the switch-wide DSCP-to-priority map
+ */
+lan9646r_t lan9646_qos_set_dscp_map(lan9646_t* dev, const uint8_t dscp_prio[LAN9646_QOS_DSCPS]);
+
+/**
+ * \brief           Change the priority of one DSCP value
+ */
+lan9646r_t lan9646_qos_set_dscp(lan9646_t* dev, uint8_t dscp, uint8_t prio);
+
+/**
+ * \brief           Select the ingress priority sources of a port
+ * \param[in]       sources: LAN9646_QOS_SRC_xxx; with several, the highest priority wins
+ */
+lan9646r_t lan9646_qos_set_sources(lan9646_t* dev, uint8_t port, uint8_t sources);
+
+/**
+ * \brief           Set the number of egress queues of a port (1, 2 or 4)
+ */
+lan9646r_t lan9646_qos_set_queues(lan9646_t* dev, uint8_t port, uint8_t queues);
+
+/**
+ * \brief           Map priorities to egress queues of a port
+ */
+lan9646r_t lan9646_qos_set_prio_queue(lan9646_t* dev, uint8_t port,
+                                      const uint8_t prio_queue[LAN9646_QOS_PRIOS]);
+
+/**
+ * \brief           Set the scheduling of one egress queue
+ * \note            The queue's shaper setting is kept
+ */
+lan9646r_t lan9646_qos_set_sched(lan9646_t* dev, uint8_t port, uint8_t queue,
+                                 const lan9646_qos_queue_t* q);
+
+/**
+ * \brief           Apply a whole port setup
+ * \return          \ref lan9646INVPARAM, with the port untouched, if a
+ *                  priority maps to a queue the port does not enable
+ */
+lan9646r_t lan9646_qos_port_apply(lan9646_t* dev, const lan9646_qos_port_cfg_t* cfg);
+
+/**
+ * \brief           Get the drop counters of a port
+ * \return          \ref lan9646OK, \ref lan9646INVPARAM for a port the engine does not read
+ */
+lan9646r_t lan9646_qos_get_drops(const lan9646_mib_engine_t* mib, uint8_t port,
+                                 lan9646_qos_drops_t* drops);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* LAN9646_QOS_HDR_H */
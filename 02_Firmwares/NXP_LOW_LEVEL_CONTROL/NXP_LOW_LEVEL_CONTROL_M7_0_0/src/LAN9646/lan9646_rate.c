@@ -0,0 +1,340 @@
+/**
+ * \file            lan9646_rate.c
+ * \brief           LAN9646 ingress policing, egress shaping and storm control
+ */
+
+#include "lan9646_rate.h"
+#include <string.h>
+
+/* Storm threshold at 100 % of the link rate */
+#define RATE_STORM_FULL             9969UL
+
+/* Credit increment: idle slope as a fraction of the link rate, 2^24 = 1 */
+#define RATE_CBS_INC_SHIFT          24U
+#define RATE_CBS_INC_MAX            ((1UL << RATE_CBS_INC_SHIFT) - 1UL)
+
+/*===========================================================================*/
+/*                          PRIVATE FUNCTIONS                                 */
+/*===========================================================================*/
+
+static bool prv_is_valid_port(uint8_t port) {
+    return (port >= 1 && port <= 4) || (port == 6) || (port == 7);
+}
+
+static uint32_t prv_link_bps(lan9646_speed_t speed) {
+    switch (speed) {
+        case LAN9646_SPEED_10M:   return 10000000UL;
+        case LAN9646_SPEED_100M:  return 100000000UL;
+        default:                  return 1000000000UL;
+    }
+}
+
+/* bits/s of codes 1-100 */
+static uint32_t prv_unit_bps(lan9646_speed_t speed) {
+    return speed == LAN9646_SPEED_1000M ? 10000000UL : 1000000UL;
+}
+
+/* bits/s per sub-unit code step: scales with the link like the unit */
+static uint32_t prv_step_bps(lan9646_speed_t speed) {
+    return (prv_unit_bps(speed) / 1000000UL) * LAN9646_RATE_MIN_BPS;
+}
+
+/**
+ * \brief           Encode, counting requests that had to be rounded down
+ */
+static lan9646r_t prv_encode(lan9646_rate_t* rl, uint32_t bps, lan9646_speed_t speed,
+                             uint8_t* code) {
+    uint32_t actual;
+    lan9646r_t res;
+
+    res = lan9646_rate_encode(bps, speed, code, &actual);
+    if (res == lan9646OK && actual != 0 && actual != bps) {
+        rl->stats.rounded++;
+    }
+    return res;
+}
+
+static lan9646r_t prv_write_ingress(lan9646_rate_t* rl, uint8_t port) {
+    lan9646_rate_port_t* p = &rl->port[port - 1U];
+    uint8_t codes[LAN9646_RATE_PRIOS];
+    lan9646r_t res;
+    uint8_t i;
+
+    for (i = 0; i < LAN9646_RATE_PRIOS; i++) {
+        /* Port-based: every limiter carries the same code */
+        res = prv_encode(rl, p->in_bps[p->port_based ? 0 : i], p->speed, &codes[i]);
+        if (res != lan9646OK) return res;
+    }
+
+    res = lan9646_modify_reg8(rl->dev, LAN9646_REG_PORT_RATE_CTRL(port), LAN9646_RATE_IN_PORT_BASED,
+                              p->port_based ? LAN9646_RATE_IN_PORT_BASED : 0);
+    if (res != lan9646OK) return res;
+
+    rl->stats.updates++;
+    return lan9646_write_burst(rl->dev, LAN9646_REG_PORT_IN_RATE(port, 0), codes, sizeof(codes));
+}
+
+static lan9646r_t prv_write_egress(lan9646_rate_t* rl, uint8_t port) {
+    lan9646_rate_port_t* p = &rl->port[port - 1U];
+    uint8_t codes[LAN9646_RATE_QUEUES];
+    lan9646r_t res;
+    uint8_t i;
+
+    for (i = 0; i < LAN9646_RATE_QUEUES; i++) {
+        res = prv_encode(rl, p->out_bps[i], p->speed, &codes[i]);
+        if (res != lan9646OK) return res;
+    }
+
+    rl->stats.updates++;
+    return lan9646_write_burst(rl->dev, LAN9646_REG_PORT_OUT_RATE(port, 0), codes, sizeof(codes));
+}
+
+/**
+ * \brief           Program the credit-based shaper of one queue
+ */
+static lan9646r_t prv_write_shaper(lan9646_rate_t* rl, uint8_t port, uint8_t queue) {
+    const lan9646_rate_port_t* p = &rl->port[port - 1U];
+    uint32_t idle = p->cbs_bps[queue];
+    uint64_t inc;
+    uint8_t credits[4];
+    lan9646r_t res;
+
+    res = lan9646_write_reg32(rl->dev, LAN9646_REG_PORT_MTI_QUEUE_INDEX(port), queue);
+    if (res != lan9646OK) return res;
+
+    if (idle != 0) {
+        inc = ((uint64_t)idle << RATE_CBS_INC_SHIFT) / prv_link_bps(p->speed);
+        if (inc > RATE_CBS_INC_MAX) inc = RATE_CBS_INC_MAX;
+
+        credits[0] = (uint8_t)(LAN9646_RATE_CBS_HI_CREDIT >> 8);
+        credits[1] = (uint8_t)LAN9646_RATE_CBS_HI_CREDIT;
+        credits[2] = (uint8_t)(LAN9646_RATE_CBS_LO_CREDIT >> 8);
+        credits[3] = (uint8_t)LAN9646_RATE_CBS_LO_CREDIT;
+        res = lan9646_write_burst(rl->dev, LAN9646_REG_PORT_MTI_HI_CREDIT(port), credits,
+                                  sizeof(credits));
+        if (res != lan9646OK) return res;
+        res = lan9646_write_reg32(rl->dev, LAN9646_REG_PORT_MTI_CREDIT_INC(port), (uint32_t)inc);
+        if (res != lan9646OK) return res;
+    }
+
+    rl->stats.updates++;
+    return lan9646_modify_reg8(rl->dev, LAN9646_REG_PORT_MTI_QUEUE_CTRL0(port),
+                               LAN9646_MTI_SHAPING_MASK,
+                               (uint8_t)((idle != 0 ? LAN9646_MTI_SHAPING_CBS : LAN9646_MTI_SHAPING_OFF)
+                                         << LAN9646_MTI_SHAPING_SHIFT));
+}
+
+/* Sum of the limits, 0 if any of them is unlimited */
+static uint32_t prv_total(const uint8_t* codes, uint8_t n, lan9646_speed_t speed) {
+    uint32_t total = 0;
+    uint32_t bps;
+    uint8_t i;
+
+    for (i = 0; i < n; i++) {
+        bps = lan9646_rate_decode(codes[i], speed);
+        if (bps == 0) return 0;
+        total += bps;
+    }
+    return total;
+}
+
+/*===========================================================================*/
+/*                              API FUNCTIONS                                 */
+/*===========================================================================*/
+
+lan9646r_t lan9646_rate_encode(uint32_t bps, lan9646_speed_t speed, uint8_t* code,
+                               uint32_t* actual_bps) {
+    uint32_t unit = prv_unit_bps(speed);
+    uint32_t step = prv_step_bps(speed);
+    uint32_t n;
+
+    if (code == NULL) return lan9646INVPARAM;
+
+    if (bps == 0 || bps >= prv_link_bps(speed)) {
+        *code = LAN9646_RATE_CODE_UNLIMITED;
+        n = 0;
+    } else if (bps >= unit) {
+        n = bps / unit;
+        *code = (uint8_t)n;
+        n *= unit;
+    } else if (bps >= LAN9646_RATE_MIN_BPS) {
+        /* Below one unit: 15 steps of 64 kbps, 640 kbps at 1000 */
+        n = bps / step;
+        if (n == 0) n = 1;              /* Under 640 kbps at 1000: the smallest step */
+        if (n > LAN9646_RATE_CODE_KBPS_STEPS) n = LAN9646_RATE_CODE_KBPS_STEPS;
+        *code = (uint8_t)(LAN9646_RATE_CODE_KBPS_BASE + n);
+        n *= step;
+    } else {
+        return lan9646INVPARAM;
+    }
+
+    if (actual_bps != NULL) {
+        *actual_bps = n;
+    }
+    return lan9646OK;
+}
+
+uint32_t lan9646_rate_decode(uint8_t code, lan9646_speed_t speed) {
+    if (code == LAN9646_RATE_CODE_UNLIMITED) return 0;
+    if (code <= LAN9646_RATE_CODE_MBPS_MAX) return code * prv_unit_bps(speed);
+    if (code <= LAN9646_RATE_CODE_KBPS_BASE + LAN9646_RATE_CODE_KBPS_STEPS) {
+        return (code - LAN9646_RATE_CODE_KBPS_BASE) * prv_step_bps(speed);
+    }
+    return 0;
+}
+
+lan9646r_t lan9646_rate_init(lan9646_rate_t* rl, lan9646_t* dev) {
+    uint8_t i;
+
+    if (rl == NULL || dev == NULL) return lan9646INVPARAM;
+
+    memset(rl, 0, sizeof(*rl));
+    rl->dev = dev;
+    for (i = 0; i < LAN9646_RATE_PORTS; i++) {
+        rl->port[i].speed = LAN9646_SPEED_1000M;
+    }
+    return lan9646OK;
+}
+
+lan9646r_t lan9646_rate_set_ingress(lan9646_rate_t* rl, uint8_t port, uint8_t prio,
+                                    uint32_t bps) {
+    lan9646_rate_port_t* p;
+    bool port_based = (prio == LAN9646_RATE_ALL_PRIO);
+    uint8_t code;
+
+    if (rl == NULL || rl->dev == NULL || !prv_is_valid_port(port)
+        || (!port_based && prio >= LAN9646_RATE_PRIOS)) {
+        return lan9646INVPARAM;
+    }
+
+    p = &rl->port[port - 1U];
+    if (lan9646_rate_encode(bps, p->speed, &code, NULL) != lan9646OK) return lan9646INVPARAM;
+
+    if (p->port_based != port_based) {
+        memset(p->in_bps, 0, sizeof(p->in_bps));
+        p->port_based = port_based;
+    }
+    p->in_bps[port_based ? 0 : prio] = bps;
+    return prv_write_ingress(rl, port);
+}
+
+lan9646r_t lan9646_rate_set_egress(lan9646_rate_t* rl, uint8_t port, uint8_t queue,
+                                   uint32_t bps) {
+    lan9646_rate_port_t* p;
+    uint8_t code;
+
+    if (rl == NULL || rl->dev == NULL || !prv_is_valid_port(port)
+        || queue >= LAN9646_RATE_QUEUES) {
+        return lan9646INVPARAM;
+    }
+
+    p = &rl->port[port - 1U];
+    if (lan9646_rate_encode(bps, p->speed, &code, NULL) != lan9646OK) return lan9646INVPARAM;
+
+    p->out_bps[queue] = bps;
+    return prv_write_egress(rl, port);
+}
+
+lan9646r_t lan9646_rate_set_shaper(lan9646_rate_t* rl, uint8_t port, uint8_t queue,
+                                   uint32_t idle_bps) {
+    if (rl == NULL || rl->dev == NULL || !prv_is_valid_port(port)
+        || queue >= LAN9646_RATE_QUEUES) {
+        return lan9646INVPARAM;
+    }
+
+    rl->port[port - 1U].cbs_bps[queue] = idle_bps;
+    return prv_write_shaper(rl, port, queue);
+}
+
+lan9646r_t lan9646_rate_set_link_speed(lan9646_rate_t* rl, uint8_t port, lan9646_speed_t speed) {
+    lan9646_rate_port_t* p;
+    lan9646r_t res;
+    uint8_t q;
+
+    if (rl == NULL || rl->dev == NULL || !prv_is_valid_port(port)) return lan9646INVPARAM;
+
+    p = &rl->port[port - 1U];
+    if (speed == LAN9646_SPEED_DOWN || speed == p->speed) return lan9646OK;
+
+    p->speed = speed;
+    rl->stats.reencodes++;
+
+    res = prv_write_ingress(rl, port);
+    if (res != lan9646OK) return res;
+    res = prv_write_egress(rl, port);
+    if (res != lan9646OK) return res;
+    for (q = 0; q < LAN9646_RATE_QUEUES; q++) {
+        if (p->cbs_bps[q] == 0) continue;
+        res = prv_write_shaper(rl, port, q);
+        if (res != lan9646OK) return res;
+    }
+    return lan9646OK;
+}
+
+lan9646r_t lan9646_rate_set_storm(lan9646_rate_t* rl, uint8_t pct, bool mcast,
+                                  uint8_t port_mask) {
+    uint32_t rate = (RATE_STORM_FULL * pct) / 100UL;
+    uint8_t buf[2];
+    uint8_t port;
+    lan9646r_t res;
+
+    if (rl == NULL || rl->dev == NULL || pct > 100U) return lan9646INVPARAM;
+
+    if (rate > LAN9646_SW_STORM_RATE_MAX) rate = LAN9646_SW_STORM_RATE_MAX;
+
+    if (pct != 0) {
+        /* Threshold and multicast flag share 0x0332: one read, one 2-byte burst */
+        res = lan9646_read_reg8(rl->dev, LAN9646_REG_SW_MAC_CTRL2, &buf[0]);
+        if (res != lan9646OK) return res;
+        buf[0] &= (uint8_t)~(LAN9646_SW_MCAST_STORM_DIS | LAN9646_SW_STORM_RATE_HI_MASK);
+        buf[0] |= (uint8_t)(rate >> 8) & LAN9646_SW_STORM_RATE_HI_MASK;
+        if (!mcast) buf[0] |= LAN9646_SW_MCAST_STORM_DIS;
+        buf[1] = (uint8_t)rate;
+        res = lan9646_write_burst(rl->dev, LAN9646_REG_SW_MAC_CTRL2, buf, sizeof(buf));
+        if (res != lan9646OK) return res;
+    }
+
+    for (port = 1; port <= LAN9646_RATE_PORTS; port++) {
+        if (!prv_is_valid_port(port)) continue;
+        res = lan9646_modify_reg8(rl->dev, LAN9646_REG_PORT_MAC_CTRL0(port),
+                                  LAN9646_PORT_BCAST_STORM_EN,
+                                  (pct != 0 && (port_mask & (1U << (port - 1U))))
+                                      ? LAN9646_PORT_BCAST_STORM_EN : 0);
+        if (res != lan9646OK) return res;
+    }
+    return lan9646OK;
+}
+
+lan9646r_t lan9646_rate_get_status(const lan9646_rate_t* rl, const lan9646_mib_engine_t* mib,
+                                   uint8_t port, lan9646_rate_status_t* st) {
+    const lan9646_rate_port_t* p;
+    uint8_t in[LAN9646_RATE_PRIOS];
+    uint8_t out[LAN9646_RATE_QUEUES];
+    lan9646_mib_rate_t rate;
+    uint8_t i;
+
+    if (rl == NULL || st == NULL || !prv_is_valid_port(port)) return lan9646INVPARAM;
+
+    p = &rl->port[port - 1U];
+    memset(st, 0, sizeof(*st));
+
+    /* Requests were validated when set, so they encode */
+    for (i = 0; i < LAN9646_RATE_PRIOS; i++) {
+        lan9646_rate_encode(p->in_bps[i], p->speed, &in[i], NULL);
+    }
+    for (i = 0; i < LAN9646_RATE_QUEUES; i++) {
+        lan9646_rate_encode(p->out_bps[i], p->speed, &out[i], NULL);
+    }
+    st->in_limit_bps = prv_total(in, p->port_based ? 1U : LAN9646_RATE_PRIOS, p->speed);
+    st->out_limit_bps = prv_total(out, LAN9646_RATE_QUEUES, p->speed);
+
+    if (mib == NULL || !lan9646_mib_get_rate(mib, port, &rate)) return lan9646ERR;
+    st->rx_bps = rate.rx_bps;
+    st->tx_bps = rate.tx_bps;
+    return lan9646OK;
+}
+
+void lan9646_rate_get_stats(const lan9646_rate_t* rl, lan9646_rate_stats_t* stats) {
+    if (rl == NULL || stats == NULL) return;
+    *stats = rl->stats;
+}
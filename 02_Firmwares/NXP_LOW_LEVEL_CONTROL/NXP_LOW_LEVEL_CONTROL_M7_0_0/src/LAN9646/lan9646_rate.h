@@ -0,0 +1,182 @@
+/**
+ * \file            lan9646_rate.h
+ * \brief           LAN9646 ingress policing, egress shaping and storm control
+ *
+ * Limits are given in bits/s and encoded into the 7-bit rate code the
+ * switch uses for its 8 ingress (per priority) and 4 egress (per queue)
+ * limiters. The code means Mbps on a 10/100 link and tens of Mbps on a
+ * 1000 link, and the 15 sub-unit codes step by 64 kbps or 640 kbps
+ * alike, so the engine keeps the requested rates and re-encodes a port
+ * when its link speed changes. Encoding rounds down: the limit actually
+ * programmed never exceeds the request, except that a request under
+ * 640 kbps gets the smallest 640 kbps step on a 1000 link.
+ *
+ * A port's ingress codes go out as one 8-byte burst and its egress codes
+ * as one 4-byte burst.
+ *
+ * Storm control uses one switch-wide threshold; each port only chooses
+ * whether it applies. Multicast is counted together with broadcast unless
+ * excluded.
+ */
+
+#ifndef LAN9646_RATE_HDR_H
+#define LAN9646_RATE_HDR_H
+
+#include "lan9646.h"
+#include "lan9646_switch.h"
+#include "lan9646_mib.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/*===========================================================================*/
+/*                              CONFIGURATION                                 */
+/*===========================================================================*/
+
+#ifndef LAN9646_RATE_CBS_HI_CREDIT
+#define LAN9646_RATE_CBS_HI_CREDIT  1536U   /*!< Credit-based shaper high credit, bytes */
+#endif
+
+#ifndef LAN9646_RATE_CBS_LO_CREDIT
+#define LAN9646_RATE_CBS_LO_CREDIT  1536U   /*!< Credit-based shaper low credit, bytes */
+#endif
+
+#define LAN9646_RATE_PRIOS          8U      /*!< Ingress limiters per port */
+#define LAN9646_RATE_QUEUES         4U      /*!< Egress limiters per port */
+#define LAN9646_RATE_PORTS          7U      /*!< Ports 1-7 (5 does not exist) */
+
+#define LAN9646_RATE_ALL_PRIO       0xFFU   /*!< One ingress limit for the whole port */
+#define LAN9646_RATE_MIN_BPS        64000UL /*!< Smallest limit the switch can apply (10/100) */
+
+/*===========================================================================*/
+/*                              DATA TYPES                                    */
+/*===========================================================================*/
+
+/**
+ * \brief           Requested limits of one port, bits/s, 0 = unlimited
+ */
+typedef struct {
+    uint32_t in_bps[LAN9646_RATE_PRIOS];
+    uint32_t out_bps[LAN9646_RATE_QUEUES];
+    uint32_t cbs_bps[LAN9646_RATE_QUEUES];  /*!< Credit-based shaper idle slope */
+    bool port_based;            /*!< in_bps[0] covers all priorities */
+    lan9646_speed_t speed;      /*!< Speed the codes are encoded for */
+} lan9646_rate_port_t;
+
+/**
+ * \brief           Configured against measured rates of a port
+ */
+typedef struct {
+    uint32_t in_limit_bps;      /*!< Programmed ingress limit, 0 = unlimited */
+    uint32_t out_limit_bps;     /*!< Programmed egress limit, 0 = unlimited */
+    uint32_t rx_bps;            /*!< Measured over the last MIB interval */
+    uint32_t tx_bps;
+} lan9646_rate_status_t;
+
+/**
+ * \brief           Rate engine counters
+ */
+typedef struct {
+    uint32_t updates;           /*!< Limiter bursts written */
+    uint32_t reencodes;         /*!< Ports re-encoded for a new link speed */
+    uint32_t rounded;           /*!< Requests programmed other than the asked rate */
+} lan9646_rate_stats_t;
+
+/**
+ * \brief           Rate engine
+ */
+typedef struct {
+    lan9646_t* dev;
+    lan9646_rate_port_t port[LAN9646_RATE_PORTS];   /*!< Index = port - 1 */
+    lan9646_rate_stats_t stats;
+} lan9646_rate_t;
+
+/*===========================================================================*/
+/*                              API FUNCTIONS                                 */
+/*===========================================================================*/
+
+/**
+ * \brief           Encode a rate for a link speed
+ * \param[in]       bps: Requested rate, 0 = unlimited
+ * \param[out]      code: Rate code
+ * \param[out]      actual_bps: Rate the code applies (0 = unlimited), may be NULL
+ * \return          \ref lan9646OK, \ref lan9646INVPARAM below LAN9646_RATE_MIN_BPS
+ * \note            Rates at or above the link speed encode as unlimited
+ */
+lan9646r_t lan9646_rate_encode(uint32_t bps, lan9646_speed_t speed, uint8_t* code,
+                               uint32_t* actual_bps);
+
+/**
+ * \brief           Rate a code applies at a link speed
+ * \return          bits/s, 0 for unlimited or an invalid code
+ */
+uint32_t lan9646_rate_decode(uint8_t code, lan9646_speed_t speed);
+
+/**
+ * \brief           Set up the engine, all ports unlimited at 1000 Mbps
+ * \note            The device is not touched
+ */
+lan9646r_t lan9646_rate_init(lan9646_rate_t* rl, lan9646_t* dev);
+
+/**
+ * \brief           Limit the traffic a port accepts
+ * \param[in]       port: Port (1-4, 6, 7)
+ * \param[in]       prio: Priority 0-7, or LAN9646_RATE_ALL_PRIO for the whole port
+ * \param[in]       bps: Limit, 0 = unlimited
+ * \note            Switching between per-port and per-priority mode clears
+ *                  the other mode's limits
+ */
+lan9646r_t lan9646_rate_set_ingress(lan9646_rate_t* rl, uint8_t port, uint8_t prio,
+                                    uint32_t bps);
+
+/**
+ * \brief           Limit the traffic a port sends from one queue
+ * \param[in]       queue: Queue 0-3
+ * \param[in]       bps: Limit, 0 = unlimited
+ */
+lan9646r_t lan9646_rate_set_egress(lan9646_rate_t* rl, uint8_t port, uint8_t queue,
+                                   uint32_t bps);
+
+/**
+ * \brief           Shape a queue with the credit-based shaper
+ * \param[in]       idle_bps: Idle slope, 0 = shaper off
+ */
+lan9646r_t lan9646_rate_set_shaper(lan9646_rate_t* rl, uint8_t port, uint8_t queue,
+                                   uint32_t idle_bps);
+
+/**
+ * \brief           Re-encode a port's limits for a new link speed
+ * \note            Call from the link change callback; a down link keeps
+ *                  the current codes
+ */
+lan9646r_t lan9646_rate_set_link_speed(lan9646_rate_t* rl, uint8_t port, lan9646_speed_t speed);
+
+/**
+ * \brief           Set broadcast (and multicast) storm control
+ * \param[in]       pct: Threshold in percent of the link rate, 0 = off
+ * \param[in]       mcast: Count multicast frames too
+ * \param[in]       port_mask: Ports that apply it, bit 0 = port 1
+ */
+lan9646r_t lan9646_rate_set_storm(lan9646_rate_t* rl, uint8_t pct, bool mcast,
+                                  uint8_t port_mask);
+
+/**
+ * \brief           Compare a port's programmed limits with its measured rates
+ * \param[in]       mib: MIB engine with the port selected
+ * \return          \ref lan9646OK, \ref lan9646ERR before the MIB engine has
+ *                  a rate (limits are filled in anyway)
+ */
+lan9646r_t lan9646_rate_get_status(const lan9646_rate_t* rl, const lan9646_mib_engine_t* mib,
+                                   uint8_t port, lan9646_rate_status_t* st);
+
+/**
+ * \brief           Get rate engine counters
+ */
+void lan9646_rate_get_stats(const lan9646_rate_t* rl, lan9646_rate_stats_t* stats);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* LAN9646_RATE_HDR_H */
@@ -0,0 +1,269 @@
+/**
+ * \file            lan9646_snap.c
+ * \brief           LAN9646 binary register snapshot
+ */
+
+#include "lan9646_snap.h"
+#include <stddef.h>
+
+/*===========================================================================*/
+/*                          PRIVATE TYPES / DATA                              */
+/*===========================================================================*/
+
+typedef struct {
+    uint8_t* buf;
+    uint16_t size;
+    uint16_t off;               /* End of the blob so far */
+    uint16_t records;
+    uint8_t flags;
+} blob_t;
+
+/* Same blocks as the dump functions; interrupt status bits are
+ * write-1-to-clear, so reading them changes nothing. The PHY registers
+ * that clear on read are left out: basic status (0xN102, latched
+ * link-down bit the link monitor relies on), autonegotiation expansion
+ * (0xN10C, latched page received) and 1000BASE-T status (0xN114, idle
+ * error count) */
+static const lan9646_snap_range_t g_default[] = {
+    {0x0000, 0x08, 0},          /* Chip ID, PME */
+    {0x0010, 0x10, 0},          /* Global and port interrupt status/mask */
+    {0x0100, 0x01, 0},          /* IO control */
+    {0x0120, 0x08, 0},          /* LED override/output */
+    {0x0201, 0x01, 0},          /* PHY power */
+    {0x0300, 0x60, 0},          /* Switch op, MAC, LUE, unknown ctrl, storm, MIB ctrl, DSCP map */
+    {0x0370, 0x10, 0},          /* Mirroring */
+    {0x0390, 0x04, 0},          /* Queue management */
+    {0x0000, 0x40, 0x6F},       /* Default tag, PME, interrupts, operation control, status */
+    {0x0100, 0x02, 0x0F},       /* PHY basic control */
+    {0x0104, 0x08, 0x0F},       /* PHY ID, autonegotiation advertisement, link partner */
+    {0x010E, 0x06, 0x0F},       /* Next pages, 1000BASE-T control */
+    {0x0300, 0x02, 0x60},       /* XMII control */
+    {0x0400, 0x30, 0x6F},       /* MAC control, rate limiting */
+    {0x0800, 0x10, 0x6F},       /* Ingress classification, mirroring, priority */
+    {0x0900, 0x10, 0x6F},       /* Scheduling of the selected queue */
+    {0x0A00, 0x10, 0x6F},       /* Queue control, membership */
+    {0x0B00, 0x08, 0x6F},       /* Address lookup, MSTP */
+};
+
+/*===========================================================================*/
+/*                          PRIVATE FUNCTIONS                                 */
+/*===========================================================================*/
+
+static void prv_le16(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void prv_le32(uint8_t* p, uint32_t v) {
+    prv_le16(p, (uint16_t)v);
+    prv_le16(&p[2], (uint16_t)(v >> 16));
+}
+
+/**
+ * \brief           Open a record of len payload bytes
+ * \return          Payload pointer, NULL if it does not fit
+ */
+static uint8_t* prv_rec_open(blob_t* b, lan9646_snap_rec_t type, uint8_t port, uint16_t addr,
+                             uint16_t len) {
+    uint8_t* p;
+
+    if ((uint32_t)b->off + LAN9646_SNAP_REC_HDR_LEN + len > b->size) {
+        b->flags |= LAN9646_SNAP_F_TRUNC;
+        return NULL;
+    }
+
+    p = &b->buf[b->off];
+    p[0] = (uint8_t)type;
+    p[1] = port;
+    prv_le16(&p[2], addr);
+    prv_le16(&p[4], len);
+    return &p[LAN9646_SNAP_REC_HDR_LEN];
+}
+
+static void prv_rec_close(blob_t* b, uint16_t len) {
+    prv_le16(&b->buf[b->off + 4U], len);
+    b->off = (uint16_t)(b->off + LAN9646_SNAP_REC_HDR_LEN + len);
+    b->records++;
+}
+
+static lan9646r_t prv_regs(lan9646_t* dev, blob_t* b, uint16_t addr, uint16_t len) {
+    uint8_t* p = prv_rec_open(b, LAN9646_SNAP_REC_REGS, 0, addr, len);
+    lan9646r_t res = lan9646OK;
+    uint16_t done, n;
+
+    if (p == NULL) return lan9646ERR;
+
+    for (done = 0; done < len && res == lan9646OK; done = (uint16_t)(done + n)) {
+        n = (uint16_t)(len - done);
+        if (n > LAN9646_SNAP_BURST_MAX) {
+            n = LAN9646_SNAP_BURST_MAX;
+        }
+        res = lan9646_read_burst(dev, (uint16_t)(addr + done), &p[done], n);
+    }
+
+    if (res != lan9646OK) {
+        /* Leave the record out rather than store bytes that were not read */
+        b->flags |= LAN9646_SNAP_F_BUSERR;
+        return res;
+    }
+    prv_rec_close(b, len);
+    return lan9646OK;
+}
+
+static lan9646r_t prv_mib(blob_t* b, const lan9646_mib_engine_t* mib) {
+    const uint16_t len = LAN9646_MIB_COUNTERS * 8U;
+    uint8_t* p;
+    uint8_t port, i;
+
+    if (lan9646_mib_busy(mib)) {
+        b->flags |= LAN9646_SNAP_F_MIB_BUSY;
+    }
+
+    for (port = 1; port <= LAN9646_MIB_PORTS; port++) {
+        if ((mib->port_mask & (1U << port)) == 0) continue;
+
+        p = prv_rec_open(b, LAN9646_SNAP_REC_MIB, port, 0, len);
+        if (p == NULL) return lan9646ERR;
+
+        for (i = 0; i < LAN9646_MIB_COUNTERS; i++) {
+            uint64_t v = mib->port[port - 1U].cnt[i];
+
+            prv_le32(&p[i * 8U], (uint32_t)v);
+            prv_le32(&p[i * 8U + 4U], (uint32_t)(v >> 32));
+        }
+        prv_rec_close(b, len);
+    }
+    return lan9646OK;
+}
+
+typedef struct {
+    blob_t* b;
+    uint8_t* p;
+    uint16_t len;
+    uint16_t room;
+} vlan_rec_t;
+
+static bool prv_vlan_cb(const lan9646_vlan_entry_t* e, void* arg) {
+    vlan_rec_t* r = arg;
+    uint8_t* q;
+
+    if (r->len + LAN9646_SNAP_VLAN_LEN > r->room) {
+        r->b->flags |= LAN9646_SNAP_F_TRUNC;
+        return false;
+    }
+
+    q = &r->p[r->len];
+    prv_le16(q, e->vid);
+    q[2] = e->members;
+    q[3] = e->untag;
+    q[4] = e->fid;
+    q[5] = 0;
+    r->len = (uint16_t)(r->len + LAN9646_SNAP_VLAN_LEN);
+    return true;
+}
+
+static lan9646r_t prv_vlan(blob_t* b, lan9646_vlan_t* vlan) {
+    vlan_rec_t r;
+    lan9646r_t res;
+
+    /* Open with what is left of the buffer; the length is set on close */
+    r.b = b;
+    r.len = 0;
+    r.room = 0;
+    if ((uint32_t)b->off + LAN9646_SNAP_REC_HDR_LEN <= b->size) {
+        r.room = (uint16_t)(b->size - b->off - LAN9646_SNAP_REC_HDR_LEN);
+    }
+    r.room = (uint16_t)(r.room - r.room % LAN9646_SNAP_VLAN_LEN);
+    r.p = prv_rec_open(b, LAN9646_SNAP_REC_VLAN, 0, 0, r.room);
+    if (r.p == NULL) return lan9646ERR;
+
+    res = lan9646_vlan_readback(vlan, prv_vlan_cb, &r, NULL);
+    if (res != lan9646OK) {
+        b->flags |= LAN9646_SNAP_F_BUSERR;
+    }
+    prv_rec_close(b, r.len);
+    return res;
+}
+
+/*===========================================================================*/
+/*                              API FUNCTIONS                                 */
+/*===========================================================================*/
+
+const lan9646_snap_range_t* lan9646_snap_default_ranges(uint8_t* count) {
+    if (count != NULL) {
+        *count = (uint8_t)(sizeof(g_default) / sizeof(g_default[0]));
+    }
+    return g_default;
+}
+
+lan9646r_t lan9646_snap_capture(lan9646_t* dev, const lan9646_snap_cfg_t* cfg, uint8_t* buf,
+                                uint16_t size, uint16_t* len) {
+    lan9646r_t res = lan9646OK, r;
+    uint16_t chip_id = 0;
+    uint8_t revision = 0;
+    uint8_t i, port;
+    blob_t b;
+
+    if (dev == NULL || cfg == NULL || buf == NULL || len == NULL || size < LAN9646_SNAP_HDR_LEN
+        || (cfg->ranges == NULL && cfg->range_count > 0)) {
+        return lan9646INVPARAM;
+    }
+
+    b.buf = buf;
+    b.size = size;
+    b.off = LAN9646_SNAP_HDR_LEN;
+    b.records = 0;
+    b.flags = 0;
+
+    if (lan9646_get_chip_id(dev, &chip_id, &revision) != lan9646OK) {
+        b.flags |= LAN9646_SNAP_F_BUSERR;
+    }
+
+    /* A full buffer stops the capture; a bus error only loses its record */
+    for (i = 0; i < cfg->range_count && (b.flags & LAN9646_SNAP_F_TRUNC) == 0; i++) {
+        const lan9646_snap_range_t* rg = &cfg->ranges[i];
+
+        if (rg->ports == 0) {
+            r = prv_regs(dev, &b, rg->addr, rg->len);
+            if (r != lan9646OK && res == lan9646OK) {
+                res = r;
+            }
+            continue;
+        }
+        for (port = 1; port <= 7U && (b.flags & LAN9646_SNAP_F_TRUNC) == 0; port++) {
+            if ((rg->ports & (1U << (port - 1U))) == 0) continue;
+            r = prv_regs(dev, &b, (uint16_t)(LAN9646_PORT_BASE(port) | rg->addr), rg->len);
+            if (r != lan9646OK && res == lan9646OK) {
+                res = r;
+            }
+        }
+    }
+    if (cfg->mib != NULL && (b.flags & LAN9646_SNAP_F_TRUNC) == 0) {
+        r = prv_mib(&b, cfg->mib);
+        if (r != lan9646OK && res == lan9646OK) {
+            res = r;
+        }
+    }
+    if (cfg->vlan != NULL && (b.flags & LAN9646_SNAP_F_TRUNC) == 0) {
+        r = prv_vlan(&b, cfg->vlan);
+        if (r != lan9646OK && res == lan9646OK) {
+            res = r;
+        }
+    }
+
+    prv_le32(&buf[0], LAN9646_SNAP_MAGIC);
+    buf[4] = LAN9646_SNAP_VERSION;
+    buf[5] = b.flags;
+    prv_le16(&buf[6], b.records);
+    prv_le32(&buf[8], b.off);
+    prv_le32(&buf[12], cfg->time_ms);
+    prv_le16(&buf[16], chip_id);
+    buf[18] = revision;
+    buf[19] = 0;
+
+    *len = b.off;
+    if (res == lan9646OK && (b.flags & LAN9646_SNAP_F_TRUNC)) {
+        res = lan9646ERR;
+    }
+    return res;
+}
@@ -0,0 +1,123 @@
+/**
+ * \file            lan9646_snap.h
+ * \brief           LAN9646 binary register snapshot
+ *
+ * A snapshot is one self-describing blob: a header and a list of records,
+ * each a run of consecutive register bytes captured with burst reads, MIB
+ * totals of a port, or the VLAN entries. Register bytes are read straight
+ * into the blob, so the cost on the device is the bus time and nothing
+ * else; formatting and diffing happen on the host
+ * (03_Softwares/lan9646_snap/snapdec.py).
+ *
+ * Blob format (multi-byte header fields little-endian, register bytes as
+ * on the bus, i.e. big-endian registers):
+ *
+ *      header (20):  u32 magic "LSNP", u8 version, u8 flags, u16 records,
+ *                    u32 length (whole blob), u32 time_ms, u16 chip_id,
+ *                    u8 revision, u8 reserved
+ *      record (6+n): u8 type, u8 port, u16 addr, u16 len, then len bytes
+ *
+ *      LAN9646_SNAP_REC_REGS:  addr = first register, len register bytes
+ *      LAN9646_SNAP_REC_MIB:   port, LAN9646_MIB_COUNTERS u64 totals in
+ *                              LAN9646_MIB_SLOT() order
+ *      LAN9646_SNAP_REC_VLAN:  6 bytes per VID: u16 vid, members, untag,
+ *                              fid, reserved
+ *
+ * \note            Register reads have their side effects. The default
+ *                  ranges leave out the PHY registers that clear on read
+ *                  (basic status 0xN102 with its latched link-down bit,
+ *                  0xN10C, 0xN114); a caller's range that covers them
+ *                  clears them. Shadowed bytes come from the shadow.
+ */
+
+#ifndef LAN9646_SNAP_HDR_H
+#define LAN9646_SNAP_HDR_H
+
+#include "lan9646.h"
+#include "lan9646_mib.h"
+#include "lan9646_vlan.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/*===========================================================================*/
+/*                              CONFIGURATION                                 */
+/*===========================================================================*/
+
+#ifndef LAN9646_SNAP_BURST_MAX
+#define LAN9646_SNAP_BURST_MAX      64U     /*!< Bytes per burst read, even */
+#endif
+
+#define LAN9646_SNAP_MAGIC          0x504E534CUL    /*!< "LSNP" */
+#define LAN9646_SNAP_VERSION        1U
+#define LAN9646_SNAP_HDR_LEN        20U
+#define LAN9646_SNAP_REC_HDR_LEN    6U
+#define LAN9646_SNAP_VLAN_LEN       6U      /*!< Bytes per VID in a VLAN record */
+
+/* Header flags */
+#define LAN9646_SNAP_F_TRUNC        0x01U   /*!< Buffer full, records missing */
+#define LAN9646_SNAP_F_BUSERR       0x02U   /*!< A range failed to read, its record is missing */
+#define LAN9646_SNAP_F_MIB_BUSY     0x04U   /*!< MIB totals taken while a snapshot ran */
+
+/*===========================================================================*/
+/*                              DATA TYPES                                    */
+/*===========================================================================*/
+
+/**
+ * \brief           Record types
+ */
+typedef enum {
+    LAN9646_SNAP_REC_REGS = 1,
+    LAN9646_SNAP_REC_MIB,
+    LAN9646_SNAP_REC_VLAN,
+} lan9646_snap_rec_t;
+
+/**
+ * \brief           Register range to capture (also the element of const tables)
+ */
+typedef struct {
+    uint16_t addr;              /*!< Absolute address, or offset in the port block */
+    uint16_t len;               /*!< Bytes */
+    uint8_t ports;              /*!< 0: global, else per port, bit 0 = port 1 */
+} lan9646_snap_range_t;
+
+/**
+ * \brief           What to capture
+ */
+typedef struct {
+    const lan9646_snap_range_t* ranges;
+    uint8_t range_count;
+    const lan9646_mib_engine_t* mib;        /*!< Totals of its ports, NULL for none */
+    lan9646_vlan_t* vlan;                   /*!< VIDs it has written, NULL for none */
+    uint32_t time_ms;                       /*!< Stored in the header */
+} lan9646_snap_cfg_t;
+
+/*===========================================================================*/
+/*                              API FUNCTIONS                                 */
+/*===========================================================================*/
+
+/**
+ * \brief           Default ranges: global, switch and per-port blocks
+ *                  (what lan9646_dump_all_registers() prints)
+ * \param[out]      count: Number of ranges
+ */
+const lan9646_snap_range_t* lan9646_snap_default_ranges(uint8_t* count);
+
+/**
+ * \brief           Capture a snapshot
+ * \param[out]      buf: Blob
+ * \param[in]       size: Buffer size
+ * \param[out]      len: Blob length
+ * \return          \ref lan9646OK, \ref lan9646ERR if records did not fit,
+ *                  or the first bus error; the blob is valid in every case
+ *                  and its flags tell what is missing
+ */
+lan9646r_t lan9646_snap_capture(lan9646_t* dev, const lan9646_snap_cfg_t* cfg, uint8_t* buf,
+                                uint16_t size, uint16_t* len);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* LAN9646_SNAP_HDR_H */
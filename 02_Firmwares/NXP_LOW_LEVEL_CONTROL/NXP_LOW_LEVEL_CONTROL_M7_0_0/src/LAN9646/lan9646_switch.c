@@ -4,6 +4,7 @@
  */
 
 #include "lan9646_switch.h"
+#include "lan9646_mib.h"
 #include <string.h>
 
 /*===========================================================================*/
@@ -13,6 +14,13 @@
 static lan9646_link_cb_t g_link_callback = NULL;
 static lan9646_port_status_t g_last_status[8];
 
+/* Interrupt-driven link monitor */
+static volatile bool g_link_notified;
+static uint8_t g_link_mask;                 /* Monitored ports, bit 0 = port 1 */
+static uint8_t g_link_pending;              /* Ports inside their debounce window */
+static uint32_t g_link_due[8];              /* End of the debounce window */
+static lan9646_link_stats_t g_link_stats;
+
 /*===========================================================================*/
 /*                          PRIVATE FUNCTIONS                                 */
 /*===========================================================================*/
@@ -25,29 +33,10 @@ static bool prv_is_phy_port(uint8_t port) {
     return (port >= 1 && port <= 4);
 }
 
-/**
- * \brief           Read MIB counter - CORRECTED per datasheet
- * \note            MIB Index goes in bits [23:16], Read Enable is bit 25
- */
-static uint32_t prv_read_mib_counter(lan9646_t* h, uint8_t port, uint8_t index) {
-    uint16_t base = (uint16_t)port << 12;
-    uint32_t ctrl;
-    uint32_t data = 0;
-    uint32_t timeout = 1000;
-
-    /* Set MIB Index [23:16] and Read Enable [25] */
-    ctrl = ((uint32_t)index << 16) | LAN9646_MIB_READ_EN;
-    lan9646_write_reg32(h, base | 0x0500, ctrl);
-
-    /* Poll until bit 25 (Read Enable) auto-clears */
-    do {
-        lan9646_read_reg32(h, base | 0x0500, &ctrl);
-        if (--timeout == 0) break;
-    } while (ctrl & LAN9646_MIB_READ_EN);
-
-    /* Read 32-bit counter data */
-    lan9646_read_reg32(h, base | 0x0504, &data);
+static uint64_t prv_read_mib_counter(lan9646_t* h, uint8_t port, uint8_t index) {
+    uint64_t data = 0;
 
+    lan9646_mib_read(h, port, index, &data);
     return data;
 }
 
@@ -262,7 +251,7 @@ lan9646r_t lan9646_switch_read_mib(lan9646_t* h, uint8_t port, lan9646_mib_t* mi
     mib->rx_unicast   = prv_read_mib_counter(h, port, LAN9646_MIB_RX_UNICAST);
     mib->rx_broadcast = prv_read_mib_counter(h, port, LAN9646_MIB_RX_BROADCAST);
     mib->rx_multicast = prv_read_mib_counter(h, port, LAN9646_MIB_RX_MULTICAST);
-    mib->rx_bytes     = prv_read_mib_counter(h, port, LAN9646_MIB_RX_HI_PRIO_BYTE);
+    mib->rx_bytes     = prv_read_mib_counter(h, port, LAN9646_MIB_RX_BYTE_CNT);
     mib->rx_crc_err   = prv_read_mib_counter(h, port, LAN9646_MIB_RX_CRC_ERR);
     mib->rx_undersize = prv_read_mib_counter(h, port, LAN9646_MIB_RX_UNDERSIZE);
     mib->rx_oversize  = prv_read_mib_counter(h, port, LAN9646_MIB_RX_OVERSIZE);
@@ -272,7 +261,7 @@ lan9646r_t lan9646_switch_read_mib(lan9646_t* h, uint8_t port, lan9646_mib_t* mi
     mib->tx_unicast   = prv_read_mib_counter(h, port, LAN9646_MIB_TX_UNICAST);
     mib->tx_broadcast = prv_read_mib_counter(h, port, LAN9646_MIB_TX_BROADCAST);
     mib->tx_multicast = prv_read_mib_counter(h, port, LAN9646_MIB_TX_MULTICAST);
-    mib->tx_bytes     = prv_read_mib_counter(h, port, LAN9646_MIB_TX_TOTAL);
+    mib->tx_bytes     = prv_read_mib_counter(h, port, LAN9646_MIB_TX_BYTE_CNT);
     mib->tx_collisions= prv_read_mib_counter(h, port, LAN9646_MIB_TX_TOTAL_COL);
     mib->tx_discard   = prv_read_mib_counter(h, port, LAN9646_MIB_TX_DROP);
 
@@ -287,16 +276,32 @@ lan9646r_t lan9646_switch_read_mib_simple(lan9646_t* h, uint8_t port,
 
     memset(mib, 0, sizeof(lan9646_mib_simple_t));
 
-    mib->rx_packets = prv_read_mib_counter(h, port, LAN9646_MIB_RX_TOTAL);
-    mib->tx_packets = prv_read_mib_counter(h, port, LAN9646_MIB_TX_UNICAST) +
-                      prv_read_mib_counter(h, port, LAN9646_MIB_TX_BROADCAST) +
-                      prv_read_mib_counter(h, port, LAN9646_MIB_TX_MULTICAST);
-    mib->rx_bytes = prv_read_mib_counter(h, port, LAN9646_MIB_RX_HI_PRIO_BYTE);
-    mib->tx_bytes = prv_read_mib_counter(h, port, LAN9646_MIB_TX_HI_PRIO_BYTE);
+    mib->rx_packets = (uint32_t)(prv_read_mib_counter(h, port, LAN9646_MIB_RX_UNICAST) +
+                                 prv_read_mib_counter(h, port, LAN9646_MIB_RX_BROADCAST) +
+                                 prv_read_mib_counter(h, port, LAN9646_MIB_RX_MULTICAST));
+    mib->tx_packets = (uint32_t)(prv_read_mib_counter(h, port, LAN9646_MIB_TX_UNICAST) +
+                                 prv_read_mib_counter(h, port, LAN9646_MIB_TX_BROADCAST) +
+                                 prv_read_mib_counter(h, port, LAN9646_MIB_TX_MULTICAST));
+    mib->rx_bytes = (uint32_t)prv_read_mib_counter(h, port, LAN9646_MIB_RX_BYTE_CNT);
+    mib->tx_bytes = (uint32_t)prv_read_mib_counter(h, port, LAN9646_MIB_TX_BYTE_CNT);
 
     return lan9646OK;
 }
 
+lan9646r_t lan9646_switch_read_mib_counter(lan9646_t* h, uint8_t port, uint8_t index,
+                                           uint32_t* value) {
+    uint64_t data = 0;
+    lan9646r_t res;
+
+    if (!h || !value || !prv_is_valid_port(port)) {
+        return lan9646INVPARAM;
+    }
+
+    res = lan9646_mib_read(h, port, index, &data);
+    *value = (uint32_t)data;
+    return res;
+}
+
 lan9646r_t lan9646_switch_flush_mib(lan9646_t* h, uint8_t port) {
     uint32_t ctrl;
 
@@ -401,6 +406,27 @@ lan9646r_t lan9646_switch_get_port_membership(lan9646_t* h, uint8_t port,
 /*                         LINK CALLBACK                                      */
 /*===========================================================================*/
 
+/**
+ * \brief           Report a port whose state differs from the last report
+ */
+static void prv_link_report(lan9646_t* h, uint8_t port) {
+    lan9646_port_status_t status;
+
+    if (lan9646_switch_get_port_status(h, port, &status) != lan9646OK) return;
+
+    if (status.link_up != g_last_status[port].link_up ||
+        status.speed != g_last_status[port].speed ||
+        status.duplex != g_last_status[port].duplex) {
+
+        g_last_status[port] = status;
+        g_link_stats.changes++;
+
+        if (g_link_callback) {
+            g_link_callback(port, status.link_up, status.speed, status.duplex);
+        }
+    }
+}
+
 void lan9646_switch_set_link_callback(lan9646_t* h, lan9646_link_cb_t callback) {
     (void)h;
     g_link_callback = callback;
@@ -409,25 +435,113 @@ void lan9646_switch_set_link_callback(lan9646_t* h, lan9646_link_cb_t callback)
 void lan9646_switch_poll_link(lan9646_t* h) {
     if (!h) return;
 
-    lan9646_port_status_t status;
     uint8_t ports[] = {1, 2, 3, 4, 6, 7};
 
     for (int i = 0; i < 6; i++) {
-        uint8_t port = ports[i];
+        prv_link_report(h, ports[i]);
+    }
+}
 
-        if (lan9646_switch_get_port_status(h, port, &status) == lan9646OK) {
-            if (status.link_up != g_last_status[port].link_up ||
-                status.speed != g_last_status[port].speed ||
-                status.duplex != g_last_status[port].duplex) {
+lan9646r_t lan9646_switch_link_irq_init(lan9646_t* h, uint8_t port_mask) {
+    uint32_t gmask;
+    uint16_t phy_int;
+    lan9646r_t res;
+
+    if (!h) return lan9646INVPARAM;
+
+    g_link_mask = port_mask & LAN9646_PORT_MASK_PHY;
+    g_link_pending = 0;
 
-                g_last_status[port] = status;
+    for (uint8_t port = 1; port <= 4; port++) {
+        if (!(g_link_mask & (1 << (port - 1)))) continue;
 
-                if (g_link_callback) {
-                    g_link_callback(port, status.link_up, status.speed, status.duplex);
-                }
+        /* PHY: interrupt on link up and down, drop anything latched */
+        res = lan9646_write_reg16(h, LAN9646_REG_PORT_PHY_INT_CTRL(port),
+                                  LAN9646_PHY_INT_LINK_UP_EN | LAN9646_PHY_INT_LINK_DOWN_EN);
+        if (res != lan9646OK) return res;
+        lan9646_read_reg16(h, LAN9646_REG_PORT_PHY_INT_CTRL(port), &phy_int);
+
+        /* Port: pass the PHY interrupt, keep ACL (and SGMII) masked */
+        res = lan9646_write_reg8(h, LAN9646_REG_PORT_INT_MASK(port),
+                                 (uint8_t)~LAN9646_PORT_INT_PHY);
+        if (res != lan9646OK) return res;
+    }
+
+    /* Global: unmask the monitored ports only */
+    res = lan9646_read_reg32(h, LAN9646_REG_GPORT_INT_MASK, &gmask);
+    if (res != lan9646OK) return res;
+    gmask = (gmask | LAN9646_PORT_MASK_ALL) & ~(uint32_t)g_link_mask;
+    res = lan9646_write_reg32(h, LAN9646_REG_GPORT_INT_MASK, gmask);
+    if (res != lan9646OK) return res;
+
+    /* Reference state: later callbacks only report differences */
+    for (uint8_t port = 1; port <= 4; port++) {
+        if (g_link_mask & (1 << (port - 1))) {
+            lan9646_switch_get_port_status(h, port, &g_last_status[port]);
+        }
+    }
+
+    g_link_notified = false;
+    return lan9646OK;
+}
+
+void lan9646_switch_link_notify(void) {
+    g_link_notified = true;
+    g_link_stats.notifies++;
+}
+
+void lan9646_switch_link_service(lan9646_t* h, uint32_t now_ms) {
+    uint32_t summary;
+    uint8_t port_int;
+    uint16_t phy_int;
+
+    if (!h || !g_link_mask) return;
+
+    if (g_link_notified) {
+        g_link_notified = false;
+        g_link_stats.summary_reads++;
+
+        if (lan9646_read_reg32(h, LAN9646_REG_GPORT_INT_STAT, &summary) != lan9646OK) {
+            g_link_notified = true;     /* Retry on the next pass */
+            return;
+        }
+
+        for (uint8_t port = 1; port <= 4; port++) {
+            uint8_t bit = (uint8_t)(1 << (port - 1));
+
+            if (!(summary & g_link_mask & bit)) continue;
+
+            /* Reading the PHY interrupt status clears the interrupt chain */
+            if (lan9646_read_reg8(h, LAN9646_REG_PORT_INT_STATUS(port), &port_int) != lan9646OK) {
+                continue;
+            }
+            if (port_int & LAN9646_PORT_INT_PHY) {
+                lan9646_read_reg16(h, LAN9646_REG_PORT_PHY_INT_CTRL(port), &phy_int);
             }
+            g_link_stats.port_events++;
+
+            /* Every event restarts the window, a flapping link reports once settled */
+            g_link_pending |= bit;
+            g_link_due[port] = now_ms + LAN9646_LINK_DEBOUNCE_MS;
         }
     }
+
+    if (!g_link_pending) return;
+
+    for (uint8_t port = 1; port <= 4; port++) {
+        uint8_t bit = (uint8_t)(1 << (port - 1));
+
+        if ((g_link_pending & bit) && (int32_t)(now_ms - g_link_due[port]) >= 0) {
+            g_link_pending &= (uint8_t)~bit;
+            prv_link_report(h, port);
+        }
+    }
+}
+
+void lan9646_switch_link_get_stats(lan9646_link_stats_t* stats) {
+    if (stats) {
+        *stats = g_link_stats;
+    }
 }
 
 /*===========================================================================*/
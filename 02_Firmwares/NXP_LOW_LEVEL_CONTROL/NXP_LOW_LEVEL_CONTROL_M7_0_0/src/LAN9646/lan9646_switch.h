@@ -55,6 +55,10 @@ extern "C" {
 #define LAN9646_PORT_MASK_PHY       0x0F    /*!< PHY ports (1-4) mask */
 #define LAN9646_PORT_MASK_RGMII     0x60    /*!< RGMII ports (6-7) mask */
 
+#ifndef LAN9646_LINK_DEBOUNCE_MS
+#define LAN9646_LINK_DEBOUNCE_MS    50U     /*!< Link must be stable this long before a callback */
+#endif
+
 /*===========================================================================*/
 /*                              DATA TYPES                                    */
 /*===========================================================================*/
@@ -135,6 +139,16 @@ typedef struct {
 typedef void (*lan9646_link_cb_t)(uint8_t port, bool link_up,
                                   lan9646_speed_t speed, lan9646_duplex_t duplex);
 
+/**
+ * \brief           Interrupt-driven link monitor statistics
+ */
+typedef struct {
+    uint32_t notifies;              /*!< lan9646_switch_link_notify() calls */
+    uint32_t summary_reads;         /*!< Global port interrupt status reads */
+    uint32_t port_events;           /*!< Port PHY interrupts serviced */
+    uint32_t changes;               /*!< Callbacks fired (debounced changes) */
+} lan9646_link_stats_t;
+
 /**
  * \brief           SYNCLKO clock source
  */
@@ -274,6 +288,19 @@ lan9646r_t lan9646_switch_read_mib(lan9646_t* handle, uint8_t port, lan9646_mib_
 lan9646r_t lan9646_switch_read_mib_simple(lan9646_t* handle, uint8_t port,
                                           lan9646_mib_simple_t* mib);
 
+/**
+ * \brief           Read one MIB counter
+ * \note            MIB counters are READ-CLEAR!
+ * \param[in]       handle: Pointer to device handle
+ * \param[in]       port: Port number
+ * \param[in]       index: Counter index (LAN9646_MIB_xxx)
+ * \param[out]      value: Counter value
+ * \return          \ref lan9646OK on success, \ref lan9646TIMEOUT if the
+ *                  read never completed
+ */
+lan9646r_t lan9646_switch_read_mib_counter(lan9646_t* handle, uint8_t port, uint8_t index,
+                                           uint32_t* value);
+
 /**
  * \brief           Flush (clear) MIB counters for a port
  * \param[in]       handle: Pointer to device handle
@@ -348,6 +375,38 @@ void lan9646_switch_set_link_callback(lan9646_t* handle, lan9646_link_cb_t callb
  */
 void lan9646_switch_poll_link(lan9646_t* handle);
 
+/**
+ * \brief           Enable link up/down interrupts and take the current link state
+ *                  as the reference for later callbacks
+ * \param[in]       handle: Pointer to device handle
+ * \param[in]       port_mask: PHY ports to monitor (bit 0 = port 1, see LAN9646_PORT_MASK_PHY)
+ * \return          \ref lan9646OK on success
+ */
+lan9646r_t lan9646_switch_link_irq_init(lan9646_t* handle, uint8_t port_mask);
+
+/**
+ * \brief           Flag that the switch interrupt line was asserted
+ * \note            Safe to call from the GPIO interrupt. Without an interrupt
+ *                  line, call it periodically: each call costs one bus read
+ *                  in lan9646_switch_link_service().
+ */
+void lan9646_switch_link_notify(void);
+
+/**
+ * \brief           Service link interrupts and fire debounced callbacks
+ * \note            Call from the main loop. No bus access unless notified or a
+ *                  debounce window has expired: one summary read decides which
+ *                  ports are read at all.
+ * \param[in]       handle: Pointer to device handle
+ * \param[in]       now_ms: Current time in ms
+ */
+void lan9646_switch_link_service(lan9646_t* handle, uint32_t now_ms);
+
+/**
+ * \brief           Get link monitor statistics
+ */
+void lan9646_switch_link_get_stats(lan9646_link_stats_t* stats);
+
 /*===========================================================================*/
 /*                           DEBUG FUNCTIONS                                  */
 /*===========================================================================*/
@@ -6,63 +6,19 @@
  * 1. MIB Counter monitoring - verify counters increment with traffic
  * 2. MAC Loopback - internal loopback at MAC level
  * 3. PHY Loopback - external loopback (requires cable)
+ * 4. Traffic generator - GMAC frames through the remote MAC loopback,
+ *    checked on return (lan9646_tgen_xxx)
  */
 
 #include "lan9646.h"
 #include "lan9646_switch.h"
+#include "lan9646_mib.h"
+#include "lan9646_traffic_test.h"
 #include "log_debug.h"
 #include <string.h>
 
 #define TAG "TRAFFIC"
 
-/*===========================================================================*/
-/*                          MIB COUNTER DEFINITIONS                          */
-/*===========================================================================*/
-
-/* MIB Counter indices per datasheet Table 5-6 */
-#define MIB_RX_HI_PRIO_BYTE     0x00    /* 30-bit: RX high priority bytes only */
-#define MIB_RX_UNDERSIZE        0x01
-#define MIB_RX_FRAGMENT         0x02
-#define MIB_RX_OVERSIZE         0x03
-#define MIB_RX_JABBER           0x04
-#define MIB_RX_SYMBOL_ERR       0x05
-#define MIB_RX_CRC_ERR          0x06
-#define MIB_RX_ALIGN_ERR        0x07
-#define MIB_RX_CTRL_8808        0x08
-#define MIB_RX_PAUSE            0x09
-#define MIB_RX_BROADCAST        0x0A
-#define MIB_RX_MULTICAST        0x0B
-#define MIB_RX_UNICAST          0x0C
-#define MIB_RX_64_BYTE          0x0D
-#define MIB_RX_65_127           0x0E
-#define MIB_RX_128_255          0x0F
-#define MIB_RX_256_511          0x10
-#define MIB_RX_512_1023         0x11
-#define MIB_RX_1024_1522        0x12
-#define MIB_RX_1523_2000        0x13
-#define MIB_RX_2001             0x14
-
-#define MIB_TX_HI_PRIO_BYTE     0x15    /* 30-bit: TX high priority bytes only */
-#define MIB_TX_LATE_COL         0x16
-#define MIB_TX_PAUSE            0x17
-#define MIB_TX_BROADCAST        0x18
-#define MIB_TX_MULTICAST        0x19
-#define MIB_TX_UNICAST          0x1A
-#define MIB_TX_DEFERRED         0x1B
-#define MIB_TX_TOTAL_COL        0x1C
-#define MIB_TX_EXCESS_COL       0x1D
-#define MIB_TX_SINGLE_COL       0x1E
-#define MIB_TX_MULTI_COL        0x1F
-
-/* 36-bit counters - need special handling */
-#define MIB_RX_BYTE_CNT         0x80    /* 36-bit: Total RX bytes */
-#define MIB_TX_BYTE_CNT         0x81    /* 36-bit: Total TX bytes */
-#define MIB_RX_DROP             0x82
-#define MIB_TX_DROP             0x83
-
-/* Note: MIB_RX_TOTAL and MIB_TX_TOTAL don't exist per datasheet!
- * Use sum of unicast + multicast + broadcast instead */
-
 /*===========================================================================*/
 /*                          PRIVATE FUNCTIONS                                */
 /*===========================================================================*/
@@ -72,51 +28,20 @@
  * \note            All MIB counters are READ-CLEAR!
  */
 static uint32_t read_mib(lan9646_t* h, uint8_t port, uint8_t index) {
-    uint16_t base = (uint16_t)port << 12;
-    uint32_t ctrl, data = 0;
-    uint32_t timeout = 1000;
-
-    /* Set MIB Index [23:16] and Read Enable [25] */
-    ctrl = ((uint32_t)index << 16) | 0x02000000UL;
-    lan9646_write_reg32(h, base | 0x0500, ctrl);
-
-    /* Poll until bit 25 auto-clears */
-    do {
-        lan9646_read_reg32(h, base | 0x0500, &ctrl);
-        if (--timeout == 0) break;
-    } while (ctrl & 0x02000000UL);
+    uint64_t data = 0;
 
-    /* Read counter data (32-bit) */
-    lan9646_read_reg32(h, base | 0x0504, &data);
-    return data;
+    lan9646_mib_read(h, port, index, &data);
+    return (uint32_t)data;
 }
 
 /**
  * \brief           Read 36-bit MIB counter (for RxByteCnt/TxByteCnt)
- * \note            Bits [35:32] are in Control Register bits [3:0]
  */
 static uint64_t read_mib_36bit(lan9646_t* h, uint8_t port, uint8_t index) {
-    uint16_t base = (uint16_t)port << 12;
-    uint32_t ctrl, data_lo = 0;
-    uint32_t timeout = 1000;
+    uint64_t data = 0;
 
-    /* Set MIB Index [23:16] and Read Enable [25] */
-    ctrl = ((uint32_t)index << 16) | 0x02000000UL;
-    lan9646_write_reg32(h, base | 0x0500, ctrl);
-
-    /* Poll until bit 25 auto-clears */
-    do {
-        lan9646_read_reg32(h, base | 0x0500, &ctrl);
-        if (--timeout == 0) break;
-    } while (ctrl & 0x02000000UL);
-
-    /* Read counter data low 32 bits */
-    lan9646_read_reg32(h, base | 0x0504, &data_lo);
-
-    /* Extract high 4 bits [35:32] from Control Register bits [3:0] */
-    uint64_t data_hi = (uint64_t)(ctrl & 0x0F) << 32;
-
-    return data_hi | data_lo;
+    lan9646_mib_read(h, port, index, &data);
+    return data;
 }
 
 /**
@@ -128,25 +53,25 @@ static void flush_mib(lan9646_t* h, uint8_t port) {
     uint32_t ctrl;
 
     /* Step 1: Enable flush/freeze for this port (bit 24) */
-    ctrl = 0x01000000UL;  /* MIB Flush and Freeze Enable */
+    ctrl = LAN9646_MIB_FLUSH_FREEZE_EN;
     lan9646_write_reg32(h, base | 0x0500, ctrl);
 
     /* Step 2: Write 0xC0 to Switch MIB Control Register (0x0336)
      * to flush counters for enabled ports
      * Bit 7 = Flush, Bit 6 = Freeze (freeze while flushing) */
-    lan9646_write_reg8(h, 0x0336, 0xC0);
+    lan9646_write_reg8(h, LAN9646_REG_SWITCH_MIB_CTRL,
+                       LAN9646_SW_MIB_FLUSH | LAN9646_SW_MIB_FREEZE);
 
     /* Step 3: Wait for flush to complete (bit 7 self-clears) */
     uint8_t mib_ctrl;
     uint32_t timeout = 1000;
     do {
-        lan9646_read_reg8(h, 0x0336, &mib_ctrl);
+        lan9646_read_reg8(h, LAN9646_REG_SWITCH_MIB_CTRL, &mib_ctrl);
         if (--timeout == 0) break;
-    } while (mib_ctrl & 0x80);
+    } while (mib_ctrl & LAN9646_SW_MIB_FLUSH);
 
-    /* Step 4: Clear freeze and disable flush/freeze for this port */
-    lan9646_write_reg8(h, 0x0336, 0x00);
-    lan9646_write_reg32(h, base | 0x0500, 0x00);
+    /* Step 4: Clear freeze (the port stays enabled for the MIB engine's freeze) */
+    lan9646_write_reg8(h, LAN9646_REG_SWITCH_MIB_CTRL, 0x00);
 }
 
 /*===========================================================================*/
@@ -180,24 +105,24 @@ static void read_traffic_stats(lan9646_t* h, uint8_t port, traffic_stats_t* stat
     memset(stats, 0, sizeof(traffic_stats_t));
 
     /* RX counters (30-bit) */
-    stats->rx_unicast   = read_mib(h, port, MIB_RX_UNICAST);
-    stats->rx_broadcast = read_mib(h, port, MIB_RX_BROADCAST);
-    stats->rx_multicast = read_mib(h, port, MIB_RX_MULTICAST);
-    stats->rx_crc_err   = read_mib(h, port, MIB_RX_CRC_ERR);
-    stats->rx_drop      = read_mib(h, port, MIB_RX_DROP);
+    stats->rx_unicast   = read_mib(h, port, LAN9646_MIB_RX_UNICAST);
+    stats->rx_broadcast = read_mib(h, port, LAN9646_MIB_RX_BROADCAST);
+    stats->rx_multicast = read_mib(h, port, LAN9646_MIB_RX_MULTICAST);
+    stats->rx_crc_err   = read_mib(h, port, LAN9646_MIB_RX_CRC_ERR);
+    stats->rx_drop      = read_mib(h, port, LAN9646_MIB_RX_DROP);
 
     /* RX bytes (36-bit) */
-    stats->rx_bytes     = read_mib_36bit(h, port, MIB_RX_BYTE_CNT);
+    stats->rx_bytes     = read_mib_36bit(h, port, LAN9646_MIB_RX_BYTE_CNT);
 
     /* TX counters (30-bit) */
-    stats->tx_unicast   = read_mib(h, port, MIB_TX_UNICAST);
-    stats->tx_broadcast = read_mib(h, port, MIB_TX_BROADCAST);
-    stats->tx_multicast = read_mib(h, port, MIB_TX_MULTICAST);
-    stats->tx_drop      = read_mib(h, port, MIB_TX_DROP);
-    stats->tx_collision = read_mib(h, port, MIB_TX_TOTAL_COL);
+    stats->tx_unicast   = read_mib(h, port, LAN9646_MIB_TX_UNICAST);
+    stats->tx_broadcast = read_mib(h, port, LAN9646_MIB_TX_BROADCAST);
+    stats->tx_multicast = read_mib(h, port, LAN9646_MIB_TX_MULTICAST);
+    stats->tx_drop      = read_mib(h, port, LAN9646_MIB_TX_DROP);
+    stats->tx_collision = read_mib(h, port, LAN9646_MIB_TX_TOTAL_COL);
 
     /* TX bytes (36-bit) */
-    stats->tx_bytes     = read_mib_36bit(h, port, MIB_TX_BYTE_CNT);
+    stats->tx_bytes     = read_mib_36bit(h, port, LAN9646_MIB_TX_BYTE_CNT);
 }
 
 /**
@@ -510,17 +435,17 @@ void lan9646_traffic_test_errors(lan9646_t* h, uint8_t port) {
     LOG_I(TAG, "#         ERROR CHECK - Port %d                         #", port);
     LOG_I(TAG, "########################################################");
 
-    uint32_t crc_err    = read_mib(h, port, MIB_RX_CRC_ERR);
-    uint32_t align_err  = read_mib(h, port, MIB_RX_ALIGN_ERR);
-    uint32_t symbol_err = read_mib(h, port, MIB_RX_SYMBOL_ERR);
-    uint32_t undersize  = read_mib(h, port, MIB_RX_UNDERSIZE);
-    uint32_t oversize   = read_mib(h, port, MIB_RX_OVERSIZE);
-    uint32_t fragment   = read_mib(h, port, MIB_RX_FRAGMENT);
-    uint32_t jabber     = read_mib(h, port, MIB_RX_JABBER);
-    uint32_t rx_drop    = read_mib(h, port, MIB_RX_DROP);
-    uint32_t tx_drop    = read_mib(h, port, MIB_TX_DROP);
-    uint32_t late_col   = read_mib(h, port, MIB_TX_LATE_COL);
-    uint32_t excess_col = read_mib(h, port, MIB_TX_EXCESS_COL);
+    uint32_t crc_err    = read_mib(h, port, LAN9646_MIB_RX_CRC_ERR);
+    uint32_t align_err  = read_mib(h, port, LAN9646_MIB_RX_ALIGN_ERR);
+    uint32_t symbol_err = read_mib(h, port, LAN9646_MIB_RX_SYMBOL_ERR);
+    uint32_t undersize  = read_mib(h, port, LAN9646_MIB_RX_UNDERSIZE);
+    uint32_t oversize   = read_mib(h, port, LAN9646_MIB_RX_OVERSIZE);
+    uint32_t fragment   = read_mib(h, port, LAN9646_MIB_RX_FRAGMENT);
+    uint32_t jabber     = read_mib(h, port, LAN9646_MIB_RX_JABBER);
+    uint32_t rx_drop    = read_mib(h, port, LAN9646_MIB_RX_DROP);
+    uint32_t tx_drop    = read_mib(h, port, LAN9646_MIB_TX_DROP);
+    uint32_t late_col   = read_mib(h, port, LAN9646_MIB_TX_LATE_COL);
+    uint32_t excess_col = read_mib(h, port, LAN9646_MIB_TX_EXCESS_COL);
 
     LOG_I(TAG, "");
     LOG_I(TAG, "RX Errors:");
@@ -584,3 +509,374 @@ void lan9646_traffic_test_all(lan9646_t* h, void (*delay_fn)(uint32_t)) {
     LOG_I(TAG, "########################################################");
 }
 
+
+/*===========================================================================*/
+/*                          TRAFFIC GENERATOR                                */
+/*===========================================================================*/
+
+enum {
+    TGEN_IDLE = 0,
+    TGEN_BASE,                  /* Waiting for the MIB baseline */
+    TGEN_TX,
+    TGEN_DRAIN,                 /* TX stopped, late frames still counted */
+};
+
+#define TGEN_ETH_HDR_LEN        14U
+#define TGEN_FCS_LEN            4U
+#define TGEN_WIRE_OVERHEAD      20U     /* Preamble, SFD and IFG per frame */
+
+/* Sums of port counters taken around a step */
+enum {
+    TGEN_MIB_RX = 0,
+    TGEN_MIB_TX,
+    TGEN_MIB_RX_DROP,
+    TGEN_MIB_TX_DROP,
+    TGEN_MIB_RX_ERR,
+};
+
+static const struct {
+    uint8_t index;
+    uint8_t sum;
+} g_tgen_mib[] = {
+    {LAN9646_MIB_RX_UNICAST, TGEN_MIB_RX},
+    {LAN9646_MIB_RX_MULTICAST, TGEN_MIB_RX},
+    {LAN9646_MIB_RX_BROADCAST, TGEN_MIB_RX},
+    {LAN9646_MIB_TX_UNICAST, TGEN_MIB_TX},
+    {LAN9646_MIB_TX_MULTICAST, TGEN_MIB_TX},
+    {LAN9646_MIB_TX_BROADCAST, TGEN_MIB_TX},
+    {LAN9646_MIB_RX_DROP, TGEN_MIB_RX_DROP},
+    {LAN9646_MIB_TX_DROP, TGEN_MIB_TX_DROP},
+    {LAN9646_MIB_RX_CRC_ERR, TGEN_MIB_RX_ERR},
+    {LAN9646_MIB_RX_ALIGN_ERR, TGEN_MIB_RX_ERR},
+    {LAN9646_MIB_RX_SYMBOL_ERR, TGEN_MIB_RX_ERR},
+};
+
+/**
+ * \brief           Next payload byte
+ * \param[in,out]   lfsr: PRBS state, start at 0xFF for every frame
+ */
+static uint8_t tgen_pattern(lan9646_tgen_pattern_t pat, uint16_t i, uint8_t* lfsr) {
+    switch (pat) {
+        case LAN9646_TGEN_PAT_ALT:
+            return (i & 1U) ? 0xAAU : 0x55U;
+        case LAN9646_TGEN_PAT_PRBS:
+            *lfsr = (uint8_t)((*lfsr >> 1) ^ ((*lfsr & 1U) ? 0xB8U : 0U));
+            return *lfsr;
+        default:
+            return (uint8_t)i;
+    }
+}
+
+static void tgen_put16(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t)(v >> 8);
+    p[1] = (uint8_t)v;
+}
+
+static void tgen_put32(uint8_t* p, uint32_t v) {
+    tgen_put16(p, (uint16_t)(v >> 16));
+    tgen_put16(&p[2], (uint16_t)v);
+}
+
+static uint32_t tgen_get32(const uint8_t* p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+/**
+ * \brief           Write the whole frame of the current step into every slot
+ */
+static void tgen_build(lan9646_tgen_t* gen) {
+    const lan9646_tgen_cfg_t* c = &gen->cfg;
+    uint8_t* f = c->ring;
+    uint16_t i, n = (uint16_t)(gen->len - TGEN_ETH_HDR_LEN - LAN9646_TGEN_HDR_LEN);
+    uint8_t slot, lfsr = 0xFFU;
+    uint8_t* p;
+
+    memcpy(&f[0], c->mac, 6);
+    memcpy(&f[6], c->mac, 6);
+    tgen_put16(&f[12], LAN9646_TGEN_ETHERTYPE);
+    p = &f[TGEN_ETH_HDR_LEN];
+    tgen_put16(&p[0], gen->run);
+    p[2] = gen->step;
+    p[3] = (uint8_t)c->pattern;
+    tgen_put32(&p[4], 0);
+    tgen_put16(&p[8], c->sizes[gen->step]);
+    tgen_put16(&p[10], 0);
+    p += LAN9646_TGEN_HDR_LEN;
+    for (i = 0; i < n; i++) {
+        p[i] = tgen_pattern(c->pattern, i, &lfsr);
+    }
+
+    for (slot = 1; slot < c->ring_len; slot++) {
+        memcpy(&f[(uint32_t)slot * c->stride], f, gen->len);
+    }
+}
+
+/**
+ * \brief           Read the port counters of a step
+ * \return          false while a queued snapshot is running
+ */
+static bool tgen_mib(lan9646_tgen_t* gen, uint32_t now_ms, uint64_t out[5]) {
+    lan9646_mib_engine_t* mib = gen->cfg.mib;
+    uint8_t i;
+
+    if (mib == NULL) return true;
+    if (lan9646_mib_busy(mib)) return false;
+
+    lan9646_mib_snapshot(mib, now_ms);
+    memset(out, 0, 5U * sizeof(out[0]));
+    for (i = 0; i < sizeof(g_tgen_mib) / sizeof(g_tgen_mib[0]); i++) {
+        out[g_tgen_mib[i].sum] += lan9646_mib_get(mib, gen->cfg.port, g_tgen_mib[i].index);
+    }
+    return true;
+}
+
+static void tgen_finish_step(lan9646_tgen_t* gen, const uint64_t mib[5]) {
+    lan9646_tgen_result_t* r = &gen->res[gen->step];
+    uint32_t ms = (r->elapsed_ms > 0U) ? r->elapsed_ms : 1U;
+    uint64_t line_pps;
+
+    r->lost = (r->tx > r->rx) ? (r->tx - r->rx) : 0U;
+    r->rx_pps = (uint32_t)((uint64_t)r->rx * 1000U / ms);
+    r->rx_kbps = (uint32_t)((uint64_t)r->rx * r->size * 8U / ms);
+    line_pps = (uint64_t)gen->cfg.link_mbps * 1000000U / ((r->size + TGEN_WIRE_OVERHEAD) * 8U);
+    r->line_pct = (line_pps > 0U) ? (uint16_t)((uint64_t)r->rx_pps * 1000U / line_pps) : 0U;
+
+    if (gen->cfg.mib != NULL) {
+        r->mib_rx = (uint32_t)(mib[TGEN_MIB_RX] - gen->mib_base[TGEN_MIB_RX]);
+        r->mib_tx = (uint32_t)(mib[TGEN_MIB_TX] - gen->mib_base[TGEN_MIB_TX]);
+        r->mib_rx_drop = (uint32_t)(mib[TGEN_MIB_RX_DROP] - gen->mib_base[TGEN_MIB_RX_DROP]);
+        r->mib_tx_drop = (uint32_t)(mib[TGEN_MIB_TX_DROP] - gen->mib_base[TGEN_MIB_TX_DROP]);
+        r->mib_rx_err = (uint32_t)(mib[TGEN_MIB_RX_ERR] - gen->mib_base[TGEN_MIB_RX_ERR]);
+    }
+}
+
+static void tgen_start_step(lan9646_tgen_t* gen) {
+    lan9646_tgen_result_t* r = &gen->res[gen->step];
+
+    memset(r, 0, sizeof(*r));
+    r->size = gen->cfg.sizes[gen->step];
+    gen->len = (uint16_t)(r->size - TGEN_FCS_LEN);
+    gen->seq = 0;
+    gen->expect = 0;
+    gen->state = TGEN_BASE;
+}
+
+/**
+ * \brief           Keep the ring full
+ */
+static void tgen_send(lan9646_tgen_t* gen) {
+    const lan9646_tgen_cfg_t* c = &gen->cfg;
+    lan9646_tgen_result_t* r = &gen->res[gen->step];
+    uint8_t* f;
+
+    /* Completions come in send order, so the next slot is the oldest */
+    while (!gen->owned[gen->next]) {
+        f = &c->ring[(uint32_t)gen->next * c->stride];
+        tgen_put32(&f[TGEN_ETH_HDR_LEN + 4U], gen->seq);
+        gen->owned[gen->next] = true;
+        gen->inflight++;
+        if (!c->send_fn(f, gen->len, c->send_arg)) {
+            gen->owned[gen->next] = false;
+            gen->inflight--;
+            r->busy++;
+            break;
+        }
+        gen->seq++;
+        r->tx++;
+        gen->next = (uint8_t)((gen->next + 1U) % c->ring_len);
+    }
+}
+
+lan9646r_t lan9646_tgen_start(lan9646_tgen_t* gen, const lan9646_tgen_cfg_t* cfg,
+                              uint32_t now_ms) {
+    uint16_t run;
+    uint8_t i;
+
+    if (gen == NULL || cfg == NULL || cfg->mac == NULL || cfg->ring == NULL
+        || cfg->ring_len == 0 || cfg->ring_len > LAN9646_TGEN_RING_MAX
+        || cfg->sizes == NULL || cfg->size_count == 0 || cfg->size_count > LAN9646_TGEN_SIZES_MAX
+        || cfg->send_fn == NULL || cfg->duration_ms == 0) {
+        return lan9646INVPARAM;
+    }
+    for (i = 0; i < cfg->size_count; i++) {
+        if (cfg->sizes[i] < LAN9646_TGEN_SIZE_MIN || cfg->sizes[i] > LAN9646_TGEN_SIZE_MAX
+            || cfg->sizes[i] - TGEN_FCS_LEN > cfg->stride) {
+            return lan9646INVPARAM;
+        }
+    }
+    if (gen->state != TGEN_IDLE) return lan9646ERR;
+
+    if (cfg->dev != NULL) {
+        /* Remote loopback returns what the port receives from the GMAC;
+         * local loopback would turn switch traffic around instead */
+        lan9646r_t res = lan9646_set_remote_loopback(cfg->dev, cfg->port, true);
+        if (res != lan9646OK) return res;
+    }
+
+    run = (uint16_t)(gen->run + 1U);
+    memset(gen, 0, sizeof(*gen));
+    gen->cfg = *cfg;
+    gen->run = run;
+    gen->t0 = now_ms;
+    tgen_start_step(gen);
+
+    LOG_I(TAG, "Traffic generator: %u sizes x %lu ms, port %u remote loopback, run %u",
+          cfg->size_count, (unsigned long)cfg->duration_ms, cfg->port, run);
+    return lan9646OK;
+}
+
+bool lan9646_tgen_poll(lan9646_tgen_t* gen, uint32_t now_ms) {
+    lan9646_tgen_result_t* r;
+    uint64_t mib[5];
+
+    if (gen == NULL || gen->state == TGEN_IDLE) return false;
+    r = &gen->res[gen->step];
+
+    switch (gen->state) {
+        case TGEN_BASE:
+            /* Frames of the last step still owned by the MAC keep their slots */
+            if (gen->inflight > 0U || !tgen_mib(gen, now_ms, gen->mib_base)) break;
+            tgen_build(gen);
+            gen->t0 = now_ms;
+            gen->state = TGEN_TX;
+            tgen_send(gen);
+            break;
+
+        case TGEN_TX:
+            if ((uint32_t)(now_ms - gen->t0) >= gen->cfg.duration_ms) {
+                r->elapsed_ms = now_ms - gen->t0;
+                gen->t0 = now_ms;
+                gen->state = TGEN_DRAIN;
+                break;
+            }
+            tgen_send(gen);
+            break;
+
+        case TGEN_DRAIN:
+            if ((uint32_t)(now_ms - gen->t0) < gen->cfg.drain_ms || gen->inflight > 0U
+                || !tgen_mib(gen, now_ms, mib)) {
+                break;
+            }
+            tgen_finish_step(gen, mib);
+            LOG_I(TAG, "  %4u bytes: %lu pps, lost %lu", r->size, (unsigned long)r->rx_pps,
+                  (unsigned long)r->lost);
+
+            if (gen->step + 1U < gen->cfg.size_count) {
+                gen->step++;
+                tgen_start_step(gen);
+                break;
+            }
+            gen->step++;
+            gen->state = TGEN_IDLE;
+            if (gen->cfg.dev != NULL) {
+                lan9646_set_remote_loopback(gen->cfg.dev, gen->cfg.port, false);
+            }
+            lan9646_tgen_print(gen);
+            break;
+
+        default:
+            break;
+    }
+    return gen->state != TGEN_IDLE;
+}
+
+void lan9646_tgen_tx_done(lan9646_tgen_t* gen, const uint8_t* frame) {
+    uint32_t off;
+    uint8_t slot;
+
+    if (gen == NULL || frame < gen->cfg.ring) return;
+
+    off = (uint32_t)(frame - gen->cfg.ring);
+    slot = (uint8_t)(off / gen->cfg.stride);
+    if (off % gen->cfg.stride != 0U || slot >= gen->cfg.ring_len || !gen->owned[slot]) return;
+
+    gen->owned[slot] = false;
+    gen->inflight--;
+}
+
+bool lan9646_tgen_rx(lan9646_tgen_t* gen, const uint8_t* l2_payload, uint16_t len) {
+    lan9646_tgen_result_t* r;
+    uint16_t i, n;
+    uint32_t seq;
+    uint8_t lfsr = 0xFFU;
+
+    if (gen == NULL || l2_payload == NULL) return false;
+    if (gen->state != TGEN_TX && gen->state != TGEN_DRAIN) {
+        return true;            /* Late frames after the run, nothing to count them in */
+    }
+    r = &gen->res[gen->step];
+
+    if (len < LAN9646_TGEN_HDR_LEN) {
+        r->bad++;
+        return true;
+    }
+    if (((uint16_t)(l2_payload[0] << 8) | l2_payload[1]) != gen->run || l2_payload[2] != gen->step) {
+        r->stale++;
+        return true;
+    }
+    /* len may include padding and the FCS */
+    n = (uint16_t)(gen->len - TGEN_ETH_HDR_LEN);
+    if (((uint16_t)(l2_payload[8] << 8) | l2_payload[9]) != r->size || len < n
+        || l2_payload[3] != (uint8_t)gen->cfg.pattern) {
+        r->bad++;
+        return true;
+    }
+    if (gen->cfg.verify) {
+        const uint8_t* p = &l2_payload[LAN9646_TGEN_HDR_LEN];
+
+        for (i = 0; i < n - LAN9646_TGEN_HDR_LEN; i++) {
+            if (p[i] != tgen_pattern(gen->cfg.pattern, i, &lfsr)) {
+                r->bad++;
+                return true;
+            }
+        }
+    }
+
+    seq = tgen_get32(&l2_payload[4]);
+    if (seq >= gen->expect) {
+        gen->expect = seq + 1U;     /* A gap is loss until the frame turns up */
+    } else {
+        r->reordered++;
+    }
+    r->rx++;
+    return true;
+}
+
+bool lan9646_tgen_running(const lan9646_tgen_t* gen) {
+    return gen != NULL && gen->state != TGEN_IDLE;
+}
+
+const lan9646_tgen_result_t* lan9646_tgen_results(const lan9646_tgen_t* gen, uint8_t* count) {
+    if (gen == NULL) return NULL;
+    if (count != NULL) {
+        *count = (gen->state == TGEN_IDLE) ? gen->step : 0U;
+    }
+    return gen->res;
+}
+
+void lan9646_tgen_print(const lan9646_tgen_t* gen) {
+    const lan9646_tgen_result_t* r;
+    uint8_t i, count;
+
+    r = lan9646_tgen_results(gen, &count);
+    if (r == NULL) return;
+
+    LOG_I(TAG, "");
+    LOG_I(TAG, "=== Traffic Generator (Port %d, run %u, %s) ===", gen->cfg.port, gen->run,
+          gen->cfg.verify ? "payload checked" : "header checked");
+    LOG_I(TAG, "size      tx_pps      rx_pps     Mbps  line%%      lost   reord     bad"
+               "   mib_rx_drop mib_tx_drop mib_err");
+    for (i = 0; i < count; i++, r++) {
+        uint32_t ms = (r->elapsed_ms > 0U) ? r->elapsed_ms : 1U;
+
+        LOG_I(TAG, "%4u  %10lu  %10lu  %4lu.%01lu  %3u.%01u  %8lu  %6lu  %6lu   %11lu %11lu %7lu",
+              r->size, (unsigned long)((uint64_t)r->tx * 1000U / ms), (unsigned long)r->rx_pps,
+              (unsigned long)(r->rx_kbps / 1000U), (unsigned long)(r->rx_kbps % 1000U / 100U),
+              r->line_pct / 10U, r->line_pct % 10U, (unsigned long)r->lost,
+              (unsigned long)r->reordered, (unsigned long)r->bad, (unsigned long)r->mib_rx_drop,
+              (unsigned long)r->mib_tx_drop, (unsigned long)r->mib_rx_err);
+        LOG_I(TAG, "      switch rx/tx %lu/%lu, stale %lu, MAC busy %lu",
+              (unsigned long)r->mib_rx, (unsigned long)r->mib_tx, (unsigned long)r->stale,
+              (unsigned long)r->busy);
+    }
+}
@@ -1,12 +1,33 @@
 /**
  * \file            lan9646_traffic_test.h
  * \brief           LAN9646 Port 6 Traffic Test Header
+ *
+ * Besides the MIB-watching tests, a traffic generator (lan9646_tgen_xxx)
+ * measures GMAC/RGMII throughput on its own: frames go out of the GMAC,
+ * are turned around by the remote MAC loopback of the CPU port and come
+ * back to the GMAC, where sequence numbers and payload are checked.
+ *
+ * The generator is platform free. Frames are built once per frame size in
+ * a caller-provided ring of DMA-reachable buffers; sending only patches
+ * the sequence number and hands the buffer to the send callback (on the
+ * board eth_tx_send_ext(), i.e. Gmac_Ip_SendFrame()). The ring is kept as
+ * full as the descriptors allow, so the rate reached is what the GMAC,
+ * the RGMII link and the superloop together sustain.
+ *
+ *      frame (size - 4 bytes, FCS added by the MAC):
+ *          dst MAC, src MAC (both ours), LAN9646_TGEN_ETHERTYPE,
+ *          u16 run, u8 step, u8 pattern, u32 seq, u16 size, u16 reserved
+ *          (big-endian), then the payload pattern up to the frame end
+ *
+ * Every size runs for duration_ms, then the generator waits drain_ms for
+ * frames still on their way and takes the MIB deltas of the port.
  */
 
 #ifndef LAN9646_TRAFFIC_TEST_H
 #define LAN9646_TRAFFIC_TEST_H
 
 #include "lan9646.h"
+#include "lan9646_mib.h"
 #include <stdbool.h>
 #include <stdint.h>
 
@@ -75,6 +96,158 @@ void lan9646_traffic_test_errors(lan9646_t* h, uint8_t port);
  */
 void lan9646_traffic_test_all(lan9646_t* h, void (*delay_fn)(uint32_t));
 
+/*===========================================================================*/
+/*                          TRAFFIC GENERATOR                                */
+/*===========================================================================*/
+
+#ifndef LAN9646_TGEN_RING_MAX
+#define LAN9646_TGEN_RING_MAX       16U     /*!< Frame buffers, keep <= TX descriptors */
+#endif
+
+#ifndef LAN9646_TGEN_SIZES_MAX
+#define LAN9646_TGEN_SIZES_MAX      8U      /*!< Frame sizes per run */
+#endif
+
+#ifndef LAN9646_TGEN_ETHERTYPE
+#define LAN9646_TGEN_ETHERTYPE      0x88B5U /*!< IEEE 802 local experimental */
+#endif
+
+#define LAN9646_TGEN_HDR_LEN        12U     /*!< Test header after the EtherType */
+#define LAN9646_TGEN_SIZE_MIN       64U     /*!< Frame size with FCS */
+#define LAN9646_TGEN_SIZE_MAX       1518U
+
+/**
+ * \brief           Payload pattern
+ */
+typedef enum {
+    LAN9646_TGEN_PAT_INCR = 0,      /*!< Byte n = n */
+    LAN9646_TGEN_PAT_ALT,           /*!< 0x55, 0xAA, ... */
+    LAN9646_TGEN_PAT_PRBS,          /*!< 8-bit LFSR, period 255 */
+} lan9646_tgen_pattern_t;
+
+/**
+ * \brief           Hand one frame to the MAC
+ * \param[in]       frame: Ring buffer, owned by the MAC until lan9646_tgen_tx_done()
+ * \param[in]       len: Frame length without FCS
+ * \return          false if the MAC is busy, the frame is retried later
+ */
+typedef bool (*lan9646_tgen_send_fn)(uint8_t* frame, uint16_t len, void* arg);
+
+/**
+ * \brief           Generator setup
+ */
+typedef struct {
+    lan9646_t* dev;             /*!< Sets the loopback, NULL if set up externally */
+    lan9646_mib_engine_t* mib;  /*!< Port counters, NULL for none; must cover port */
+    uint8_t port;               /*!< Switch port of the GMAC (6) */
+    const uint8_t* mac;         /*!< Our MAC, source and destination of the frames */
+    uint8_t* ring;              /*!< ring_len buffers of stride bytes, DMA-reachable */
+    uint8_t ring_len;
+    uint16_t stride;            /*!< Buffer size, at least the largest size - 4 */
+    const uint16_t* sizes;      /*!< Frame sizes with FCS, 64-1518 */
+    uint8_t size_count;
+    lan9646_tgen_pattern_t pattern;
+    bool verify;                /*!< Compare every payload byte, else the header only */
+    uint32_t duration_ms;       /*!< TX time per size */
+    uint32_t drain_ms;          /*!< Wait for late frames after TX */
+    uint16_t link_mbps;         /*!< Link speed, for the line-rate figure */
+    lan9646_tgen_send_fn send_fn;
+    void* send_arg;
+} lan9646_tgen_cfg_t;
+
+/**
+ * \brief           Result of one frame size
+ */
+typedef struct {
+    uint16_t size;
+    uint32_t elapsed_ms;        /*!< TX time */
+    uint32_t tx;                /*!< Frames accepted by the MAC */
+    uint32_t rx;                /*!< Frames back with a valid header and payload */
+    uint32_t lost;              /*!< tx - rx after the drain time */
+    uint32_t reordered;         /*!< Frames older than one already received */
+    uint32_t bad;               /*!< Short frames, wrong size or payload */
+    uint32_t stale;             /*!< Frames of an earlier size or run */
+    uint32_t busy;              /*!< Sends refused by the MAC */
+    uint32_t rx_pps;
+    uint32_t rx_kbps;           /*!< Frame bits with FCS, no preamble/IFG */
+    uint16_t line_pct;          /*!< rx_pps against the line rate, 0.1 % */
+    uint32_t mib_rx;            /*!< Switch counters of the port over the step */
+    uint32_t mib_tx;
+    uint32_t mib_rx_drop;
+    uint32_t mib_tx_drop;
+    uint32_t mib_rx_err;        /*!< CRC, alignment and symbol errors */
+} lan9646_tgen_result_t;
+
+/**
+ * \brief           Generator state
+ * \note            Treat as opaque
+ */
+typedef struct {
+    lan9646_tgen_cfg_t cfg;
+    uint8_t state;
+    uint8_t step;               /*!< Index in cfg.sizes */
+    uint16_t run;               /*!< Stamped in every frame, stale-frame filter */
+    uint16_t len;               /*!< Frame length of the step, no FCS */
+    uint32_t seq;               /*!< Next sequence number to send */
+    uint32_t expect;            /*!< Next sequence number expected back */
+    uint32_t t0;                /*!< Start of the current phase */
+    uint8_t next;               /*!< Next ring slot to send */
+    uint8_t inflight;
+    bool owned[LAN9646_TGEN_RING_MAX];
+    uint64_t mib_base[5];       /*!< Port counter sums at the step start */
+    lan9646_tgen_result_t res[LAN9646_TGEN_SIZES_MAX];
+} lan9646_tgen_t;
+
+/**
+ * \brief           Check a setup, enable the loopback and start the first size
+ * \param[out]      gen: Generator
+ * \param[in]       cfg: Setup, copied; ring and sizes must stay valid
+ * \param[in]       now_ms: Current time in ms
+ * \return          \ref lan9646OK, \ref lan9646INVPARAM for a bad setup,
+ *                  \ref lan9646ERR while a run is going on, or the bus error
+ *                  of the loopback write
+ */
+lan9646r_t lan9646_tgen_start(lan9646_tgen_t* gen, const lan9646_tgen_cfg_t* cfg,
+                              uint32_t now_ms);
+
+/**
+ * \brief           Send, change sizes and collect results; call every loop pass
+ * \param[in]       now_ms: Current time in ms
+ * \return          true while the run goes on
+ * \note            Takes a blocking MIB snapshot at every size change, and
+ *                  waits for a queued one to finish first
+ */
+bool lan9646_tgen_poll(lan9646_tgen_t* gen, uint32_t now_ms);
+
+/**
+ * \brief           TX completion of a ring buffer
+ */
+void lan9646_tgen_tx_done(lan9646_tgen_t* gen, const uint8_t* frame);
+
+/**
+ * \brief           Check a received frame
+ * \param[in]       l2_payload: Frame after the EtherType
+ * \param[in]       len: Bytes from l2_payload to the end of the frame
+ * \return          false if the frame is not from the generator
+ */
+bool lan9646_tgen_rx(lan9646_tgen_t* gen, const uint8_t* l2_payload, uint16_t len);
+
+/**
+ * \brief           Check if a run is going on
+ */
+bool lan9646_tgen_running(const lan9646_tgen_t* gen);
+
+/**
+ * \brief           Get the results of the last run
+ * \param[out]      count: Sizes done
+ */
+const lan9646_tgen_result_t* lan9646_tgen_results(const lan9646_tgen_t* gen, uint8_t* count);
+
+/**
+ * \brief           Print the results of the last run
+ */
+void lan9646_tgen_print(const lan9646_tgen_t* gen);
+
 #ifdef __cplusplus
 }
 #endif
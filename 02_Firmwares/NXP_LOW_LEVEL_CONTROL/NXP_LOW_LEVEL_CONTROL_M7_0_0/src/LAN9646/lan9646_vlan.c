@@ -0,0 +1,278 @@
+/**
+ * \file            lan9646_vlan.c
+ * \brief           LAN9646 802.1Q VLAN table
+ */
+
+#include "lan9646_vlan.h"
+#include <string.h>
+
+/* Entry (12) + index (2) + control (1) */
+#define VLAN_REGS_LEN               15U
+#define VLAN_CTRL_OFS               14U
+
+/*===========================================================================*/
+/*                          PRIVATE FUNCTIONS                                 */
+/*===========================================================================*/
+
+static bool prv_is_valid_port(uint8_t port) {
+    return (port >= 1 && port <= 4) || (port == 6) || (port == 7);
+}
+
+static bool prv_is_valid_vid(uint16_t vid) {
+    return vid >= 1U && vid <= LAN9646_VLAN_VID_MAX;
+}
+
+static uint32_t prv_be32(const uint8_t* p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static void prv_put_be32(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+static bool prv_is_used(const lan9646_vlan_t* vlan, uint16_t vid) {
+    return (vlan->used[vid >> 5] & (1UL << (vid & 31U))) != 0;
+}
+
+static void prv_set_used(lan9646_vlan_t* vlan, uint16_t vid, bool used) {
+    if (used) {
+        vlan->used[vid >> 5] |= 1UL << (vid & 31U);
+    } else {
+        vlan->used[vid >> 5] &= ~(1UL << (vid & 31U));
+    }
+}
+
+/**
+ * \brief           Read one VID, counting busy re-reads in polls
+ */
+static lan9646r_t prv_read(lan9646_t* dev, uint16_t vid, lan9646_vlan_entry_t* e, bool* valid,
+                           uint32_t* polls) {
+    uint8_t buf[VLAN_REGS_LEN];
+    uint8_t tries = 0;
+    uint32_t w0;
+    lan9646r_t res;
+
+    buf[0] = (uint8_t)(vid >> 8);
+    buf[1] = (uint8_t)vid;
+    buf[2] = LAN9646_VLAN_START | LAN9646_VLAN_ACTION_READ;
+    res = lan9646_write_burst(dev, LAN9646_REG_VLAN_INDEX, buf, 3);
+    if (res != lan9646OK) return res;
+
+    /* Entry and control in one burst: the entry is current once START clears */
+    for (;;) {
+        res = lan9646_read_burst(dev, LAN9646_REG_VLAN_ENTRY, buf, sizeof(buf));
+        if (res != lan9646OK) return res;
+        if ((buf[VLAN_CTRL_OFS] & LAN9646_VLAN_START) == 0) break;
+        if (++tries > LAN9646_VLAN_POLL_MAX) return lan9646TIMEOUT;
+        (*polls)++;
+    }
+
+    w0 = prv_be32(&buf[0]);
+    e->vid = vid;
+    e->fid = (uint8_t)(w0 & LAN9646_VLAN_FID_MASK);
+    e->untag = buf[7] & LAN9646_VLAN_MEMBERSHIP_MASK;
+    e->members = buf[11] & LAN9646_VLAN_MEMBERSHIP_MASK;
+    *valid = (w0 & LAN9646_VLAN_VALID) != 0;
+    return lan9646OK;
+}
+
+/**
+ * \brief           Write one VID: entry, index and START in one burst, then confirm
+ * \param[in]       e: Entry, NULL to invalidate
+ */
+static lan9646r_t prv_write(lan9646_vlan_t* vlan, uint16_t vid, const lan9646_vlan_entry_t* e) {
+    uint8_t buf[VLAN_REGS_LEN];
+    uint8_t tries = 0;
+    uint8_t ctrl;
+    lan9646r_t res;
+
+    memset(buf, 0, sizeof(buf));
+    if (e != NULL) {
+        prv_put_be32(&buf[0], LAN9646_VLAN_VALID | (e->fid & LAN9646_VLAN_FID_MASK));
+        buf[7] = e->untag & LAN9646_VLAN_MEMBERSHIP_MASK;
+        buf[11] = e->members & LAN9646_VLAN_MEMBERSHIP_MASK;
+    }
+    buf[12] = (uint8_t)(vid >> 8);
+    buf[13] = (uint8_t)vid;
+    buf[VLAN_CTRL_OFS] = LAN9646_VLAN_START | LAN9646_VLAN_ACTION_WRITE;
+
+    vlan->stats.writes++;
+    res = lan9646_write_burst(vlan->dev, LAN9646_REG_VLAN_ENTRY, buf, sizeof(buf));
+    if (res != lan9646OK) return res;
+
+    for (;;) {
+        res = lan9646_read_reg8(vlan->dev, LAN9646_REG_VLAN_CTRL, &ctrl);
+        if (res != lan9646OK) return res;
+        if ((ctrl & LAN9646_VLAN_START) == 0) break;
+        if (++tries > LAN9646_VLAN_POLL_MAX) {
+            vlan->stats.timeouts++;
+            return lan9646TIMEOUT;
+        }
+        vlan->stats.polls++;
+    }
+
+    prv_set_used(vlan, vid, e != NULL);
+    return lan9646OK;
+}
+
+static lan9646r_t prv_engine_read(lan9646_vlan_t* vlan, uint16_t vid, lan9646_vlan_entry_t* e,
+                                  bool* valid) {
+    lan9646r_t res;
+
+    vlan->stats.reads++;
+    res = prv_read(vlan->dev, vid, e, valid, &vlan->stats.polls);
+    if (res == lan9646TIMEOUT) {
+        vlan->stats.timeouts++;
+    }
+    return res;
+}
+
+/*===========================================================================*/
+/*                              API FUNCTIONS                                 */
+/*===========================================================================*/
+
+lan9646r_t lan9646_vlan_read(lan9646_t* dev, uint16_t vid, lan9646_vlan_entry_t* entry,
+                             bool* valid) {
+    uint32_t polls = 0;
+
+    if (dev == NULL || entry == NULL || valid == NULL || vid > LAN9646_VLAN_VID_MASK) {
+        return lan9646INVPARAM;
+    }
+    return prv_read(dev, vid, entry, valid, &polls);
+}
+
+lan9646r_t lan9646_vlan_init(lan9646_vlan_t* vlan, lan9646_t* dev) {
+    if (vlan == NULL || dev == NULL) return lan9646INVPARAM;
+
+    memset(vlan, 0, sizeof(*vlan));
+    vlan->dev = dev;
+    return lan9646OK;
+}
+
+lan9646r_t lan9646_vlan_add(lan9646_vlan_t* vlan, const lan9646_vlan_entry_t* entry) {
+    if (vlan == NULL || vlan->dev == NULL || entry == NULL || !prv_is_valid_vid(entry->vid)) {
+        return lan9646INVPARAM;
+    }
+    return prv_write(vlan, entry->vid, entry);
+}
+
+lan9646r_t lan9646_vlan_track(lan9646_vlan_t* vlan, uint16_t vid) {
+    if (vlan == NULL || !prv_is_valid_vid(vid)) return lan9646INVPARAM;
+
+    prv_set_used(vlan, vid, true);
+    return lan9646OK;
+}
+
+lan9646r_t lan9646_vlan_remove(lan9646_vlan_t* vlan, uint16_t vid) {
+    if (vlan == NULL || vlan->dev == NULL || !prv_is_valid_vid(vid)) {
+        return lan9646INVPARAM;
+    }
+    return prv_write(vlan, vid, NULL);
+}
+
+lan9646r_t lan9646_vlan_apply(lan9646_vlan_t* vlan, const lan9646_vlan_entry_t* table,
+                              uint16_t count) {
+    lan9646r_t res;
+    uint16_t i;
+
+    if (vlan == NULL || vlan->dev == NULL || (table == NULL && count > 0)) {
+        return lan9646INVPARAM;
+    }
+
+    for (i = 0; i < count; i++) {
+        if (!prv_is_valid_vid(table[i].vid)) return lan9646INVPARAM;
+        res = prv_write(vlan, table[i].vid, &table[i]);
+        if (res != lan9646OK) return res;
+    }
+    return lan9646OK;
+}
+
+lan9646r_t lan9646_vlan_readback(lan9646_vlan_t* vlan, lan9646_vlan_fn fn, void* arg,
+                                 uint16_t* count) {
+    lan9646_vlan_entry_t e;
+    lan9646r_t res = lan9646OK;
+    uint16_t n = 0;
+    uint16_t vid;
+    bool valid;
+
+    if (vlan == NULL || vlan->dev == NULL) return lan9646INVPARAM;
+
+    for (vid = 1; vid <= LAN9646_VLAN_VID_MAX; vid++) {
+        /* Skip 32 unused VIDs at a time */
+        if ((vid & 31U) == 0 && vlan->used[vid >> 5] == 0) {
+            vid += 31U;
+            continue;
+        }
+        if (!prv_is_used(vlan, vid)) continue;
+
+        res = prv_engine_read(vlan, vid, &e, &valid);
+        if (res != lan9646OK) break;
+        if (!valid) continue;
+
+        n++;
+        if (fn != NULL && !fn(&e, arg)) break;
+    }
+
+    if (count != NULL) {
+        *count = n;
+    }
+    return res;
+}
+
+lan9646r_t lan9646_vlan_scan(lan9646_vlan_t* vlan, uint16_t first, uint16_t last,
+                             lan9646_vlan_fn fn, void* arg, uint16_t* count) {
+    lan9646_vlan_entry_t e;
+    lan9646r_t res = lan9646OK;
+    uint16_t n = 0;
+    uint16_t vid;
+    bool valid;
+
+    if (vlan == NULL || vlan->dev == NULL || first > last || last > LAN9646_VLAN_VID_MASK) {
+        return lan9646INVPARAM;
+    }
+
+    for (vid = first; vid <= last; vid++) {
+        res = prv_engine_read(vlan, vid, &e, &valid);
+        if (res != lan9646OK) break;
+        if (!valid) continue;
+
+        n++;
+        if (fn != NULL && !fn(&e, arg)) break;
+    }
+
+    if (count != NULL) {
+        *count = n;
+    }
+    return res;
+}
+
+lan9646r_t lan9646_vlan_set_pvid(lan9646_vlan_t* vlan, uint8_t port, uint16_t vid) {
+    if (vlan == NULL || vlan->dev == NULL || !prv_is_valid_port(port) || !prv_is_valid_vid(vid)) {
+        return lan9646INVPARAM;
+    }
+    return lan9646_modify_reg16(vlan->dev, LAN9646_REG_PORT_DEFAULT_TAG0(port),
+                                LAN9646_PORT_PVID_MASK, vid);
+}
+
+lan9646r_t lan9646_vlan_set_ingress_filter(lan9646_vlan_t* vlan, uint8_t port, bool enable) {
+    if (vlan == NULL || vlan->dev == NULL || !prv_is_valid_port(port)) return lan9646INVPARAM;
+
+    return lan9646_modify_reg8(vlan->dev, LAN9646_REG_PORT_CTRL2(port),
+                               LAN9646_PORT_LUE_INGRESS_FILTER,
+                               enable ? LAN9646_PORT_LUE_INGRESS_FILTER : 0);
+}
+
+lan9646r_t lan9646_vlan_enable(lan9646_vlan_t* vlan, bool enable) {
+    if (vlan == NULL || vlan->dev == NULL) return lan9646INVPARAM;
+
+    return lan9646_modify_reg8(vlan->dev, LAN9646_REG_LUE_CTRL0, LAN9646_LUE_VLAN_EN,
+                               enable ? LAN9646_LUE_VLAN_EN : 0);
+}
+
+void lan9646_vlan_get_stats(const lan9646_vlan_t* vlan, lan9646_vlan_stats_t* stats) {
+    if (vlan == NULL || stats == NULL) return;
+    *stats = vlan->stats;
+}
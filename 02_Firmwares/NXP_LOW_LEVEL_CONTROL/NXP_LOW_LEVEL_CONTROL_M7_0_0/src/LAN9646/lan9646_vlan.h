@@ -0,0 +1,159 @@
+/**
+ * \file            lan9646_vlan.h
+ * \brief           LAN9646 802.1Q VLAN table
+ *
+ * The VLAN entry, index and control registers are contiguous
+ * (0x0400-0x040E), so one VID is written with a single 15-byte burst that
+ * ends with the START bit, then confirmed with a 1-byte control read.
+ * A read is a 3-byte index/control write and one 15-byte burst returning
+ * the entry together with the control register.
+ *
+ * The engine remembers which VIDs it has written, so a readback visits
+ * only those instead of all 4094.
+ *
+ * Port maps use bit 0 = port 1, like LAN9646_PORT_MASK_xxx.
+ */
+
+#ifndef LAN9646_VLAN_HDR_H
+#define LAN9646_VLAN_HDR_H
+
+#include "lan9646.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/*===========================================================================*/
+/*                              CONFIGURATION                                 */
+/*===========================================================================*/
+
+#ifndef LAN9646_VLAN_POLL_MAX
+#define LAN9646_VLAN_POLL_MAX       16U     /*!< Control reads while an access is busy */
+#endif
+
+#define LAN9646_VLAN_VIDS           4096U
+#define LAN9646_VLAN_VID_MAX        4094U   /*!< 0 and 4095 are reserved */
+
+/*===========================================================================*/
+/*                              DATA TYPES                                    */
+/*===========================================================================*/
+
+/**
+ * \brief           One VLAN table entry (also the element of const tables)
+ */
+typedef struct {
+    uint16_t vid;
+    uint8_t members;            /*!< Member ports, bit 0 = port 1 */
+    uint8_t untag;              /*!< Ports that send the VID untagged */
+    uint8_t fid;                /*!< Filter ID (0-127) */
+} lan9646_vlan_entry_t;
+
+/**
+ * \brief           Readback callback
+ * \return          false to stop
+ */
+typedef bool (*lan9646_vlan_fn)(const lan9646_vlan_entry_t* entry, void* arg);
+
+/**
+ * \brief           VLAN counters
+ */
+typedef struct {
+    uint32_t writes;            /*!< VIDs written */
+    uint32_t reads;             /*!< VIDs read */
+    uint32_t polls;             /*!< Extra control reads (access still busy) */
+    uint32_t timeouts;
+} lan9646_vlan_stats_t;
+
+/**
+ * \brief           VLAN engine
+ */
+typedef struct {
+    lan9646_t* dev;
+    uint32_t used[LAN9646_VLAN_VIDS / 32U];     /*!< VIDs written valid, bit n = VID n */
+    lan9646_vlan_stats_t stats;
+} lan9646_vlan_t;
+
+/*===========================================================================*/
+/*                              API FUNCTIONS                                 */
+/*===========================================================================*/
+
+/**
+ * \brief           Read one VID from the device
+ * \param[out]      entry: Entry (vid filled in)
+ * \param[out]      valid: The VID is in the table
+ * \return          \ref lan9646OK on success
+ */
+lan9646r_t lan9646_vlan_read(lan9646_t* dev, uint16_t vid, lan9646_vlan_entry_t* entry,
+                             bool* valid);
+
+/**
+ * \brief           Set up the engine (the device table is not touched)
+ */
+lan9646r_t lan9646_vlan_init(lan9646_vlan_t* vlan, lan9646_t* dev);
+
+/**
+ * \brief           Add or replace a VID
+ */
+lan9646r_t lan9646_vlan_add(lan9646_vlan_t* vlan, const lan9646_vlan_entry_t* entry);
+
+/**
+ * \brief           Count a VID found valid in the device as written by this
+ *                  engine, so readback visits it
+ */
+lan9646r_t lan9646_vlan_track(lan9646_vlan_t* vlan, uint16_t vid);
+
+/**
+ * \brief           Remove a VID
+ */
+lan9646r_t lan9646_vlan_remove(lan9646_vlan_t* vlan, uint16_t vid);
+
+/**
+ * \brief           Write a table of VIDs, two bus transactions each
+ * \return          \ref lan9646OK, or the first error (the remaining VIDs
+ *                  are not written)
+ */
+lan9646r_t lan9646_vlan_apply(lan9646_vlan_t* vlan, const lan9646_vlan_entry_t* table,
+                              uint16_t count);
+
+/**
+ * \brief           Read back the VIDs this engine has written
+ * \param[in]       fn: Called for every VID still valid, may be NULL to count only
+ * \param[out]      count: Valid VIDs found, may be NULL
+ */
+lan9646r_t lan9646_vlan_readback(lan9646_vlan_t* vlan, lan9646_vlan_fn fn, void* arg,
+                                 uint16_t* count);
+
+/**
+ * \brief           Read a VID range from the device, reporting valid VIDs only
+ * \note            Two bus transactions per VID, empty or not
+ */
+lan9646r_t lan9646_vlan_scan(lan9646_vlan_t* vlan, uint16_t first, uint16_t last,
+                             lan9646_vlan_fn fn, void* arg, uint16_t* count);
+
+/**
+ * \brief           Set the VID given to untagged frames received on a port
+ * \param[in]       port: Port (1-4, 6, 7)
+ */
+lan9646r_t lan9646_vlan_set_pvid(lan9646_vlan_t* vlan, uint8_t port, uint16_t vid);
+
+/**
+ * \brief           Drop frames whose VID does not include the receiving port
+ */
+lan9646r_t lan9646_vlan_set_ingress_filter(lan9646_vlan_t* vlan, uint8_t port, bool enable);
+
+/**
+ * \brief           Switch between port-based and 802.1Q forwarding
+ * \note            Add the VIDs first: with the table empty every frame is dropped
+ */
+lan9646r_t lan9646_vlan_enable(lan9646_vlan_t* vlan, bool enable);
+
+/**
+ * \brief           Get VLAN counters
+ */
+void lan9646_vlan_get_stats(const lan9646_vlan_t* vlan, lan9646_vlan_stats_t* stats);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* LAN9646_VLAN_HDR_H */
@@ -0,0 +1,433 @@
+/**
+ * \file            arp_cache.c
+ * \brief           ARP neighbor cache and unicast next-hop resolution
+ *
+ * Entries are hashed by IPv4 address into ARP_CACHE_SIZE slots and probed
+ * linearly over a window of ARP_PROBE_MAX slots, so a lookup touches at
+ * most a few entries even with a full table. When the window is full the
+ * oldest entry in it is replaced. Addresses are kept as 32-bit words in
+ * memory order, compared without byte swapping.
+ */
+
+#include "arp_cache.h"
+#include "eth_tx.h"
+#include "sys_timer.h"
+#include <stddef.h>
+#include <string.h>
+
+#define ARP_PKT_LEN                 28U
+#define ARP_FRAME_LEN               60U     /* Untagged, padded to the minimum */
+#define ARP_OP_REQUEST              1U
+#define ARP_OP_REPLY                2U
+
+/*===========================================================================*/
+/*                              PRIVATE TYPES                                 */
+/*===========================================================================*/
+
+typedef enum {
+    ENT_FREE = 0,
+    ENT_PENDING,                /* Request sent, waiting for the reply */
+    ENT_VALID,
+} ent_state_t;
+
+typedef struct {
+    uint32_t ip;
+    uint32_t stamp_ms;          /* VALID: time resolved, PENDING: last request */
+    uint8_t mac[6];
+    uint8_t state;
+    uint8_t tries;
+} arp_entry_t;
+
+typedef struct {
+    uint8_t* buf;               /* NULL = free slot */
+    uint16_t len;
+    uint32_t ip;                /* Next hop being resolved */
+} pending_t;
+
+/*===========================================================================*/
+/*                              PRIVATE DATA                                  */
+/*===========================================================================*/
+
+static const uint8_t g_bcast_mac[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+static const uint8_t g_zero_mac[6] = {0};
+
+static uint8_t g_mac[6];
+static uint32_t g_ip;
+static uint32_t g_netmask;
+static uint32_t g_gateway;
+
+/* Request/reply frame prebuilt at init, only op and target are patched */
+static uint8_t g_arp_tpl[ARP_FRAME_LEN];
+
+static arp_entry_t g_cache[ARP_CACHE_SIZE];
+static pending_t g_pending[ARP_PENDING_MAX];
+
+static arp_stats_t g_stats;
+
+/*===========================================================================*/
+/*                          PRIVATE FUNCTIONS                                 */
+/*===========================================================================*/
+
+static inline uint32_t prv_ip(const uint8_t* p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint32_t prv_hash(uint32_t ip) {
+    uint32_t h = ip ^ (ip >> 16);
+    return (h ^ (h >> 8)) & (ARP_CACHE_SIZE - 1U);
+}
+
+static arp_entry_t* prv_find(uint32_t ip) {
+    uint32_t slot = prv_hash(ip);
+    uint32_t n;
+
+    for (n = 0; n < ARP_PROBE_MAX; n++) {
+        arp_entry_t* e = &g_cache[(slot + n) & (ARP_CACHE_SIZE - 1U)];
+        if (e->state != ENT_FREE && e->ip == ip) {
+            return e;
+        }
+    }
+    return NULL;
+}
+
+static void prv_drop_pending(uint32_t ip) {
+    uint8_t i;
+
+    for (i = 0; i < ARP_PENDING_MAX; i++) {
+        if (g_pending[i].buf != NULL && g_pending[i].ip == ip) {
+            eth_tx_release(g_pending[i].buf);
+            g_pending[i].buf = NULL;
+            g_stats.queue_drops++;
+        }
+    }
+}
+
+/**
+ * \brief           Take a slot for a new entry: first free one in the probe
+ *                  window, otherwise the oldest (resolved entries first)
+ */
+static arp_entry_t* prv_alloc(uint32_t ip, uint32_t now) {
+    uint32_t slot = prv_hash(ip);
+    arp_entry_t* victim = NULL;
+    uint32_t n;
+
+    for (n = 0; n < ARP_PROBE_MAX; n++) {
+        arp_entry_t* e = &g_cache[(slot + n) & (ARP_CACHE_SIZE - 1U)];
+
+        if (e->state == ENT_FREE) {
+            victim = e;
+            break;
+        }
+        if (victim == NULL
+            || (e->state == ENT_VALID && victim->state == ENT_PENDING)
+            || (e->state == victim->state
+                && (now - e->stamp_ms) > (now - victim->stamp_ms))) {
+            victim = e;
+        }
+    }
+
+    if (victim->state != ENT_FREE) {
+        if (victim->state == ENT_PENDING) {
+            prv_drop_pending(victim->ip);
+        }
+        g_stats.evicted++;
+    }
+
+    memset(victim, 0, sizeof(*victim));
+    victim->ip = ip;
+    victim->stamp_ms = now;
+    return victim;
+}
+
+/**
+ * \brief           Next hop for a destination
+ * \return          false for a broadcast destination (no resolution needed)
+ */
+static bool prv_next_hop(uint32_t dst, uint32_t* nh) {
+    bool local = ((dst ^ g_ip) & g_netmask) == 0U;
+
+    /* Limited broadcast, or our own subnet's broadcast (a /32 has none);
+     * an all-ones host part on another network is routed like any host */
+    if (dst == 0xFFFFFFFFU
+        || (local && (dst | g_netmask) == 0xFFFFFFFFU && g_netmask != 0xFFFFFFFFU)) {
+        return false;
+    }
+    *nh = local ? dst : g_gateway;
+    return true;
+}
+
+static arpr_t prv_send(uint8_t* buf, uint16_t len) {
+    if (eth_tx_send(buf, len) != ethtxOK) {
+        eth_tx_release(buf);
+        return arpDROP;
+    }
+    return arpOK;
+}
+
+/**
+ * \brief           Build and send one ARP packet
+ * \param[in]       eth_dst: Ethernet destination
+ * \param[in]       op: ARP_OP_REQUEST or ARP_OP_REPLY
+ * \param[in]       tha: Target hardware address
+ * \param[in]       tpa: Target protocol address (memory order)
+ * \param[in]       req: Request being answered (keeps its VLAN tag), may be NULL
+ */
+static void prv_send_arp(const uint8_t* eth_dst, uint16_t op, const uint8_t* tha,
+                         uint32_t tpa, const net_frame_t* req) {
+    uint8_t* buf = eth_tx_alloc();
+    uint8_t* p;
+    uint16_t len = ARP_FRAME_LEN;
+
+    if (buf == NULL) return;
+
+    if (req != NULL && req->has_vlan) {
+        memcpy(buf, g_arp_tpl, 12);
+        buf[12] = NET_ETHERTYPE_VLAN >> 8; buf[13] = NET_ETHERTYPE_VLAN & 0xFF;
+        buf[14] = req->vlan_tci >> 8;      buf[15] = req->vlan_tci & 0xFF;
+        memcpy(&buf[16], &g_arp_tpl[12], ARP_FRAME_LEN - 12U);
+        len += NET_VLAN_TAG_LEN;
+    } else {
+        memcpy(buf, g_arp_tpl, ARP_FRAME_LEN);
+    }
+    p = &buf[len - 46U];
+
+    memcpy(&buf[0], eth_dst, 6);
+    p[7] = (uint8_t)op;                 /* Opcode */
+    memcpy(&p[18], tha, 6);             /* Target MAC */
+    memcpy(&p[24], &tpa, 4);            /* Target IP */
+
+    if (prv_send(buf, len) == arpOK) {
+        if (op == ARP_OP_REQUEST) {
+            g_stats.requests_tx++;
+        } else {
+            g_stats.replies_tx++;
+        }
+    }
+}
+
+static void prv_request(uint32_t ip) {
+    prv_send_arp(g_bcast_mac, ARP_OP_REQUEST, g_zero_mac, ip, NULL);
+}
+
+/* Send every frame parked for a now resolved next hop */
+static void prv_flush_pending(const arp_entry_t* e) {
+    uint8_t i;
+
+    for (i = 0; i < ARP_PENDING_MAX; i++) {
+        pending_t* q = &g_pending[i];
+
+        if (q->buf != NULL && q->ip == e->ip) {
+            memcpy(q->buf, e->mac, 6);
+            if (prv_send(q->buf, q->len) != arpOK) {
+                g_stats.queue_drops++;
+            }
+            q->buf = NULL;
+        }
+    }
+}
+
+static void prv_update(arp_entry_t* e, const uint8_t* mac, uint32_t now) {
+    bool was_pending = (e->state == ENT_PENDING);
+
+    memcpy(e->mac, mac, 6);
+    e->state = ENT_VALID;
+    e->stamp_ms = now;
+    e->tries = 0;
+
+    if (was_pending) {
+        g_stats.resolved++;
+        prv_flush_pending(e);
+    }
+}
+
+/*===========================================================================*/
+/*                          PUBLIC FUNCTIONS                                  */
+/*===========================================================================*/
+
+void arp_init(const uint8_t mac[6], const uint8_t ip[4],
+              const uint8_t netmask[4], const uint8_t gateway[4]) {
+    uint8_t* p = &g_arp_tpl[NET_ETH_HDR_LEN];
+    uint8_t i;
+
+    memcpy(g_mac, mac, 6);
+    g_ip = prv_ip(ip);
+    g_netmask = prv_ip(netmask);
+    g_gateway = prv_ip(gateway);
+
+    /* Fixed part of every ARP frame we send, zero padded to 60 bytes */
+    memset(g_arp_tpl, 0, sizeof(g_arp_tpl));
+    memcpy(&g_arp_tpl[0], g_bcast_mac, 6);
+    memcpy(&g_arp_tpl[6], g_mac, 6);
+    g_arp_tpl[12] = NET_ETHERTYPE_ARP >> 8; g_arp_tpl[13] = NET_ETHERTYPE_ARP & 0xFF;
+    p[0] = 0x00; p[1] = 0x01;           /* Hardware type: Ethernet */
+    p[2] = 0x08; p[3] = 0x00;           /* Protocol type: IP */
+    p[4] = 6;                           /* Hardware size */
+    p[5] = 4;                           /* Protocol size */
+    p[6] = 0x00; p[7] = ARP_OP_REQUEST; /* Opcode */
+    memcpy(&p[8], g_mac, 6);            /* Sender MAC */
+    memcpy(&p[14], &g_ip, 4);           /* Sender IP */
+
+    memset(g_cache, 0, sizeof(g_cache));
+    for (i = 0; i < ARP_PENDING_MAX; i++) {
+        if (g_pending[i].buf != NULL) {
+            eth_tx_release(g_pending[i].buf);
+        }
+        g_pending[i].buf = NULL;
+    }
+    memset(&g_stats, 0, sizeof(g_stats));
+}
+
+arpr_t arp_output(uint8_t* buf, uint16_t len, const uint8_t dst_ip[4]) {
+    uint32_t dst;
+    uint32_t nh;
+    uint32_t now;
+    arp_entry_t* e;
+    uint8_t i;
+
+    if (buf == NULL || dst_ip == NULL) return arpINVPARAM;
+
+    dst = prv_ip(dst_ip);
+    if (!prv_next_hop(dst, &nh)) {
+        memcpy(buf, g_bcast_mac, 6);
+        return prv_send(buf, len);
+    }
+
+    e = prv_find(nh);
+    if (e != NULL && e->state == ENT_VALID) {
+        g_stats.hits++;
+        memcpy(buf, e->mac, 6);
+        return prv_send(buf, len);
+    }
+
+    g_stats.misses++;
+    if (e == NULL) {
+        /* First miss: one request, later frames only join the queue */
+        now = sys_timer_now_ms();
+        e = prv_alloc(nh, now);
+        e->state = ENT_PENDING;
+        e->tries = 1;
+        prv_request(nh);
+    }
+
+    for (i = 0; i < ARP_PENDING_MAX; i++) {
+        if (g_pending[i].buf == NULL) {
+            g_pending[i].buf = buf;
+            g_pending[i].len = len;
+            g_pending[i].ip = nh;
+            return arpQUEUED;
+        }
+    }
+
+    eth_tx_release(buf);
+    g_stats.queue_drops++;
+    return arpDROP;
+}
+
+bool arp_lookup(const uint8_t ip[4], uint8_t mac[6]) {
+    const arp_entry_t* e = prv_find(prv_ip(ip));
+
+    if (e == NULL || e->state != ENT_VALID) return false;
+    if (mac != NULL) {
+        memcpy(mac, e->mac, 6);
+    }
+    return true;
+}
+
+bool arp_resolve(const uint8_t dst_ip[4], uint8_t mac[6]) {
+    const arp_entry_t* e;
+    uint32_t nh;
+
+    if (!prv_next_hop(prv_ip(dst_ip), &nh)) {
+        memcpy(mac, g_bcast_mac, 6);
+        return true;
+    }
+
+    e = prv_find(nh);
+    if (e == NULL || e->state != ENT_VALID) return false;
+
+    g_stats.hits++;
+    memcpy(mac, e->mac, 6);
+    return true;
+}
+
+bool arp_input(net_frame_t* f) {
+    const uint8_t* arp = f->l3;
+    uint16_t op;
+    uint32_t spa;
+    uint32_t tpa;
+    uint32_t now;
+    arp_entry_t* e;
+    bool for_us;
+
+    if (f->l3_len < ARP_PKT_LEN) return false;
+
+    /* Ethernet / IPv4 only */
+    if (arp[0] != 0x00 || arp[1] != 0x01 || arp[2] != 0x08 || arp[3] != 0x00
+        || arp[4] != 6 || arp[5] != 4) {
+        return false;
+    }
+
+    g_stats.rx++;
+    op = (uint16_t)(((uint16_t)arp[6] << 8) | arp[7]);
+    spa = prv_ip(&arp[14]);
+    tpa = prv_ip(&arp[24]);
+    for_us = (tpa == g_ip);
+    now = sys_timer_now_ms();
+
+    /* RFC 826: refresh a known sender, learn it if it talks to us
+     * (address probes with sender 0.0.0.0 are never learned) */
+    if (spa != 0U && spa != g_ip) {
+        e = prv_find(spa);
+        if (e == NULL && for_us) {
+            e = prv_alloc(spa, now);
+        }
+        if (e != NULL) {
+            prv_update(e, &arp[8], now);
+        }
+    }
+
+    if (op == ARP_OP_REQUEST && for_us) {
+        prv_send_arp(&arp[8], ARP_OP_REPLY, &arp[8], spa, f);
+    }
+
+    return for_us;
+}
+
+void arp_tick(void) {
+    uint32_t now = sys_timer_now_ms();
+    uint8_t i;
+
+    for (i = 0; i < ARP_CACHE_SIZE; i++) {
+        arp_entry_t* e = &g_cache[i];
+
+        if (e->state == ENT_PENDING) {
+            if ((now - e->stamp_ms) < ARP_RETRY_MS) continue;
+            if (e->tries >= ARP_MAX_TRIES) {
+                g_stats.timeouts++;
+                prv_drop_pending(e->ip);
+                e->state = ENT_FREE;
+            } else {
+                e->tries++;
+                e->stamp_ms = now;
+                prv_request(e->ip);
+            }
+        } else if (e->state == ENT_VALID) {
+            if ((now - e->stamp_ms) >= ARP_ENTRY_TTL_MS) {
+                g_stats.expired++;
+                e->state = ENT_FREE;
+            }
+        }
+    }
+}
+
+void arp_announce(void) {
+    /* Gratuitous ARP: request for our own address */
+    prv_send_arp(g_bcast_mac, ARP_OP_REQUEST, g_zero_mac, g_ip, NULL);
+}
+
+void arp_get_stats(arp_stats_t* stats) {
+    if (stats == NULL) return;
+    *stats = g_stats;
+}
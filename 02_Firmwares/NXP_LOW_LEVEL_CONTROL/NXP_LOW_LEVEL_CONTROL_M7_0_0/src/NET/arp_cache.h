@@ -0,0 +1,141 @@
+/**
+ * \file            arp_cache.h
+ * \brief           ARP neighbor cache and unicast next-hop resolution
+ *
+ * Outbound IPv4 frames go through arp_output(), which fills in the
+ * destination MAC from a small hashed cache. On a miss the frame is parked
+ * on a pending queue and one ARP request is sent; further frames for the
+ * same address join the queue without sending another request. The queue
+ * is flushed when the reply arrives and dropped when resolution gives up.
+ */
+
+#ifndef ARP_CACHE_HDR_H
+#define ARP_CACHE_HDR_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "net_dispatch.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*===========================================================================*/
+/*                          CONFIGURATION                                     */
+/*===========================================================================*/
+
+#ifndef ARP_CACHE_SIZE
+#define ARP_CACHE_SIZE                  16U     /*!< Entries, power of two */
+#endif
+
+#ifndef ARP_PROBE_MAX
+#define ARP_PROBE_MAX                   4U      /*!< Slots searched per lookup */
+#endif
+
+#ifndef ARP_PENDING_MAX
+#define ARP_PENDING_MAX                 4U      /*!< Frames parked while resolving */
+#endif
+
+#define ARP_ENTRY_TTL_MS                300000U /*!< Lifetime of a resolved entry */
+#define ARP_RETRY_MS                    1000U   /*!< Request retransmit interval */
+#define ARP_MAX_TRIES                   3U      /*!< Requests before giving up */
+#define ARP_TICK_MS                     100U    /*!< arp_tick() call period */
+
+/*===========================================================================*/
+/*                              TYPES                                         */
+/*===========================================================================*/
+
+/**
+ * \brief           Status return codes
+ */
+typedef enum {
+    arpOK = 0,          /*!< Frame sent */
+    arpQUEUED,          /*!< Frame parked until the address resolves */
+    arpDROP,            /*!< Frame dropped (queue full, TX busy) */
+    arpINVPARAM,        /*!< Invalid parameter */
+} arpr_t;
+
+/**
+ * \brief           ARP statistics
+ */
+typedef struct {
+    uint32_t hits;              /*!< Lookups served from the cache */
+    uint32_t misses;            /*!< Lookups that started or joined a resolution */
+    uint32_t requests_tx;       /*!< ARP requests sent (incl. retries, gratuitous) */
+    uint32_t replies_tx;        /*!< ARP replies sent */
+    uint32_t rx;                /*!< ARP frames received */
+    uint32_t resolved;          /*!< Resolutions completed */
+    uint32_t timeouts;          /*!< Resolutions given up */
+    uint32_t expired;           /*!< Entries aged out */
+    uint32_t evicted;           /*!< Entries replaced because the probe window was full */
+    uint32_t queue_drops;       /*!< Frames dropped (queue full or resolution failed) */
+} arp_stats_t;
+
+/*===========================================================================*/
+/*                          PUBLIC FUNCTIONS                                  */
+/*===========================================================================*/
+
+/**
+ * \brief           Initialize the cache
+ * \param[in]       mac: Our MAC address
+ * \param[in]       ip: Our IPv4 address
+ * \param[in]       netmask: Subnet mask
+ * \param[in]       gateway: Default gateway, off-subnet traffic is sent there
+ */
+void arp_init(const uint8_t mac[6], const uint8_t ip[4],
+              const uint8_t netmask[4], const uint8_t gateway[4]);
+
+/**
+ * \brief           Send an IPv4 frame to its next hop
+ * \param[in]       buf: Frame in a pool buffer (eth_tx_alloc()); the
+ *                  destination MAC (bytes 0..5) is filled in here
+ * \param[in]       len: Frame length
+ * \param[in]       dst_ip: IPv4 destination of the frame
+ * \return          arpOK, arpQUEUED or arpDROP. The buffer is owned by
+ *                  the ARP layer afterwards in every case.
+ */
+arpr_t arp_output(uint8_t* buf, uint16_t len, const uint8_t dst_ip[4]);
+
+/**
+ * \brief           Look up a resolved address (no request is sent)
+ * \param[in]       ip: IPv4 address
+ * \param[out]      mac: MAC address, may be NULL
+ * \return          true on a hit
+ */
+bool arp_lookup(const uint8_t ip[4], uint8_t mac[6]);
+
+/**
+ * \brief           Next-hop MAC for a destination, without queueing or requesting
+ * \param[in]       dst_ip: IPv4 destination (broadcast and off-subnet handled)
+ * \param[out]      mac: Next-hop MAC address
+ * \return          true if the MAC is known now; on false use arp_output()
+ *                  to start resolution
+ */
+bool arp_resolve(const uint8_t dst_ip[4], uint8_t mac[6]);
+
+/**
+ * \brief           ARP frame handler (register for NET_ETHERTYPE_ARP)
+ */
+bool arp_input(net_frame_t* f);
+
+/**
+ * \brief           Retransmit requests, give up stale resolutions, age entries
+ * \note            Call every ARP_TICK_MS
+ */
+void arp_tick(void);
+
+/**
+ * \brief           Send a gratuitous ARP (call on link-up / address change)
+ */
+void arp_announce(void);
+
+/**
+ * \brief           Get ARP statistics
+ */
+void arp_get_stats(arp_stats_t* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ARP_CACHE_HDR_H */
@@ -0,0 +1,215 @@
+/**
+ * \file            eth_rx.c
+ * \brief           GMAC RX ring drain with interrupt wake-up and adaptive polling
+ *
+ * The RX interrupt only raises a wake flag; all descriptor work is done by
+ * eth_rx_drain() from the main loop. While bursts keep exhausting the budget
+ * the RI interrupt is masked and the ring is polled on every loop pass; once
+ * a drain empties the ring the interrupt is re-armed.
+ *
+ * A handler may keep its frame buffer (eth_rx_hold()), e.g. to transmit a
+ * reply from it. The descriptor is then refilled by eth_rx_release();
+ * Gmac_Ip_ProvideRxBuff() refills descriptors in ring order, so buffers may
+ * come back in any order.
+ */
+
+#include "eth_rx.h"
+#include "Gmac_Ip_Hw_Access.h"
+#include <string.h>
+
+/*===========================================================================*/
+/*                              PRIVATE DATA                                  */
+/*===========================================================================*/
+
+static uint8_t g_inst;
+static uint8_t g_ring;
+static eth_rx_handler_t g_handler = NULL;
+static uint16_t g_budget = ETH_RX_BUDGET_DEFAULT;
+
+static volatile bool g_wake = false;
+static bool g_polling = false;
+static uint8_t g_exhausted_streak = 0;
+
+static bool g_hold_current = false;
+static uint8_t g_held_count = 0;
+
+static eth_rx_stats_t g_stats;
+
+/*===========================================================================*/
+/*                          PRIVATE FUNCTIONS                                 */
+/*===========================================================================*/
+
+static void prv_rx_irq_disable(void) {
+    Gmac_apxChBases[g_inst][g_ring]->DMA_INTERRUPT_ENABLE &= ~GMAC_DMA_CH0_INTERRUPT_ENABLE_RIE_MASK;
+}
+
+static void prv_rx_irq_enable(void) {
+    Gmac_Ip_ChannelType* ch = Gmac_apxChBases[g_inst][g_ring];
+
+    /* Drop the stale RI event collected while masked, then re-arm */
+    ch->DMA_STATUS = GMAC_DMA_CH0_STATUS_RI_MASK;
+    ch->DMA_INTERRUPT_ENABLE |= GMAC_DMA_CH0_INTERRUPT_ENABLE_RIE_MASK;
+}
+
+/**
+ * \brief           Latch ring-full events
+ * \note            RBU is not an enabled interrupt source, it is only sampled
+ *                  here and cleared (write-1-to-clear)
+ */
+static void prv_check_overflow(void) {
+    Gmac_Ip_ChannelType* ch = Gmac_apxChBases[g_inst][g_ring];
+
+    if ((ch->DMA_STATUS & GMAC_DMA_CH0_STATUS_RBU_MASK) != 0U) {
+        ch->DMA_STATUS = GMAC_DMA_CH0_STATUS_RBU_MASK;
+        g_stats.rbu_events++;
+    }
+}
+
+/*===========================================================================*/
+/*                          PUBLIC FUNCTIONS                                  */
+/*===========================================================================*/
+
+void eth_rx_init(uint8_t inst, uint8_t ring, eth_rx_handler_t handler, uint16_t budget) {
+    g_inst = inst;
+    g_ring = ring;
+    g_handler = handler;
+    eth_rx_set_budget(budget);
+
+    g_polling = false;
+    g_exhausted_streak = 0;
+    g_hold_current = false;
+    g_held_count = 0;
+    memset(&g_stats, 0, sizeof(g_stats));
+
+    /* Frames may already be waiting from before the handler was installed */
+    g_wake = true;
+}
+
+uint16_t eth_rx_drain(void) {
+    Gmac_Ip_BufferType buf;
+    Gmac_Ip_RxInfoType rx_info;
+    uint16_t count = 0;
+
+    g_wake = false;
+
+    while (count < g_budget) {
+        if (Gmac_Ip_ReadFrame(g_inst, g_ring, &buf, &rx_info) != GMAC_STATUS_SUCCESS) {
+            break;
+        }
+        count++;
+
+        g_hold_current = false;
+        if (rx_info.ErrMask != 0U) {
+            g_stats.err_frames++;
+        } else if (g_handler != NULL) {
+            g_handler(buf.Data, rx_info.PktLen);
+        }
+
+        if (g_hold_current) {
+            /* Handler owns it now - refilled by eth_rx_release() */
+            g_held_count++;
+            g_stats.held++;
+            if (g_held_count > g_stats.max_held) {
+                g_stats.max_held = g_held_count;
+            }
+        } else {
+            /* Return buffer to driver */
+            Gmac_Ip_ProvideRxBuff(g_inst, g_ring, &buf);
+        }
+    }
+
+    prv_check_overflow();
+
+    if (count == 0U) {
+        if (g_polling) {
+            /* Load is gone - back to interrupt mode */
+            g_polling = false;
+            g_exhausted_streak = 0;
+            prv_rx_irq_enable();
+
+            /* Close the window between the empty check and re-arming */
+            if (Gmac_Ip_IsFrameAvailable(g_inst, g_ring)) {
+                g_wake = true;
+            }
+        }
+        return 0;
+    }
+
+    g_stats.wakeups++;
+    g_stats.frames += count;
+    if (count > g_stats.max_burst) {
+        g_stats.max_burst = count;
+    }
+
+    if (count >= g_budget) {
+        g_stats.budget_hits++;
+        if (!g_polling && ++g_exhausted_streak >= ETH_RX_POLL_ENTER_THRESHOLD) {
+            /* Sustained load - stop taking one interrupt per frame */
+            g_polling = true;
+            g_stats.poll_entries++;
+            prv_rx_irq_disable();
+        }
+        g_wake = true;
+    } else {
+        g_exhausted_streak = 0;
+    }
+
+    return count;
+}
+
+void eth_rx_hold(void) {
+    if (g_held_count < ETH_RX_HOLD_MAX) {
+        g_hold_current = true;
+    }
+}
+
+bool eth_rx_can_hold(void) {
+    return g_held_count < ETH_RX_HOLD_MAX;
+}
+
+void eth_rx_release(uint8_t* frame) {
+    Gmac_Ip_BufferType buf;
+
+    if (frame == NULL || g_held_count == 0U) return;
+
+    buf.Data = frame;
+    buf.Length = 0;
+    Gmac_Ip_ProvideRxBuff(g_inst, g_ring, &buf);
+    g_held_count--;
+}
+
+bool eth_rx_pending(void) {
+    return g_wake || g_polling;
+}
+
+bool eth_rx_is_polling(void) {
+    return g_polling;
+}
+
+void eth_rx_set_budget(uint16_t budget) {
+    g_budget = (budget == 0U) ? ETH_RX_BUDGET_DEFAULT : budget;
+}
+
+void eth_rx_get_stats(eth_rx_stats_t* stats) {
+    if (stats == NULL) return;
+
+    g_stats.fifo_overflows = Gmac_Ip_GetCounter(g_inst, GMAC_CTR_RX_FIFO_OVERFLOW_PACKETS);
+    *stats = g_stats;
+}
+
+void eth_rx_reset_stats(void) {
+    memset(&g_stats, 0, sizeof(g_stats));
+    g_stats.max_held = g_held_count;
+}
+
+/*===========================================================================*/
+/*                          INTERRUPT CALLBACK                                */
+/*===========================================================================*/
+
+void eth_rx_irq_callback(const uint8 Instance, const uint8 Channel) {
+    (void)Instance;
+    (void)Channel;
+
+    g_stats.irqs++;
+    g_wake = true;
+}
@@ -0,0 +1,159 @@
+/**
+ * \file            eth_rx.h
+ * \brief           GMAC RX ring drain with interrupt wake-up and adaptive polling
+ */
+
+#ifndef ETH_RX_HDR_H
+#define ETH_RX_HDR_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "Gmac_Ip.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*===========================================================================*/
+/*                          CONFIGURATION                                     */
+/*===========================================================================*/
+
+/**
+ * \brief           Default number of frames handled per drain call
+ * \note            Keep below the RX ring size (32) so TX and timers still get
+ *                  CPU time during a burst, but large enough that one wake-up
+ *                  empties a typical burst.
+ */
+#ifndef ETH_RX_BUDGET_DEFAULT
+#define ETH_RX_BUDGET_DEFAULT           16U
+#endif
+
+/**
+ * \brief           Consecutive budget-exhausted drains before switching to polling
+ */
+#ifndef ETH_RX_POLL_ENTER_THRESHOLD
+#define ETH_RX_POLL_ENTER_THRESHOLD     2U
+#endif
+
+/**
+ * \brief           Max RX buffers kept by handlers (eth_rx_hold()) at once
+ * \note            Every held buffer is one descriptor missing from the ring
+ *                  until eth_rx_release(), keep well below the ring size (32)
+ */
+#ifndef ETH_RX_HOLD_MAX
+#define ETH_RX_HOLD_MAX                 8U
+#endif
+
+/*===========================================================================*/
+/*                              TYPES                                         */
+/*===========================================================================*/
+
+/**
+ * \brief           Frame handler called for every received frame
+ * \note            The buffer belongs to the RX ring and is given back to the
+ *                  driver when the handler returns, unless the handler calls
+ *                  eth_rx_hold() to keep it.
+ */
+typedef void (*eth_rx_handler_t)(uint8_t* frame, uint16_t len);
+
+/**
+ * \brief           RX path statistics
+ */
+typedef struct {
+    uint32_t wakeups;           /*!< Drain calls that found at least one frame */
+    uint32_t irqs;              /*!< RX interrupts taken */
+    uint32_t frames;            /*!< Frames handed to the handler */
+    uint32_t err_frames;        /*!< Frames dropped because of descriptor errors */
+    uint32_t max_burst;         /*!< Largest number of frames in one drain call */
+    uint32_t budget_hits;       /*!< Drain calls that stopped on the budget */
+    uint32_t poll_entries;      /*!< Switches from interrupt to polling mode */
+    uint32_t rbu_events;        /*!< Receive buffer unavailable (ring full) events */
+    uint32_t fifo_overflows;    /*!< MAC RX FIFO overflow counter (GMAC MMC) */
+    uint32_t held;              /*!< Buffers kept by handlers (zero-copy) */
+    uint32_t max_held;          /*!< High-water mark of buffers held at once */
+} eth_rx_stats_t;
+
+/*===========================================================================*/
+/*                          PUBLIC FUNCTIONS                                  */
+/*===========================================================================*/
+
+/**
+ * \brief           Initialize RX drain for one GMAC ring
+ * \param[in]       inst: GMAC instance
+ * \param[in]       ring: RX ring index
+ * \param[in]       handler: Frame handler
+ * \param[in]       budget: Max frames per drain call, 0 = ETH_RX_BUDGET_DEFAULT
+ * \note            Call after the GMAC driver has been initialized
+ */
+void eth_rx_init(uint8_t inst, uint8_t ring, eth_rx_handler_t handler, uint16_t budget);
+
+/**
+ * \brief           Process ready frames, up to the configured budget
+ * \return          Number of frames processed
+ */
+uint16_t eth_rx_drain(void);
+
+/**
+ * \brief           Keep the frame currently being handled
+ * \note            Only valid from inside the frame handler and only if
+ *                  eth_rx_can_hold() returned true. The buffer stays valid
+ *                  (and out of the ring) until eth_rx_release().
+ */
+void eth_rx_hold(void);
+
+/**
+ * \brief           Check if the handler may keep one more buffer
+ */
+bool eth_rx_can_hold(void);
+
+/**
+ * \brief           Give a held buffer back to the RX ring
+ * \param[in]       frame: Frame pointer passed to the handler
+ * \note            Main context only (same context as eth_rx_drain())
+ */
+void eth_rx_release(uint8_t* frame);
+
+/**
+ * \brief           Check if the RX path wants another drain
+ * \return          true if an RX interrupt fired or the ring is being polled
+ */
+bool eth_rx_pending(void);
+
+/**
+ * \brief           Check if the RX path is currently in polling mode
+ * \return          true while the RX interrupt is masked under load
+ */
+bool eth_rx_is_polling(void);
+
+/**
+ * \brief           Change the per-drain budget
+ * \param[in]       budget: Max frames per drain call, 0 = ETH_RX_BUDGET_DEFAULT
+ */
+void eth_rx_set_budget(uint16_t budget);
+
+/**
+ * \brief           Get RX statistics
+ * \param[out]      stats: Statistics output
+ */
+void eth_rx_get_stats(eth_rx_stats_t* stats);
+
+/**
+ * \brief           Clear RX statistics
+ */
+void eth_rx_reset_stats(void);
+
+/**
+ * \brief           GMAC RX channel callback (EthCtrlConfigIngressFifoCallback in the .mex)
+ * \note            Until the configuration is regenerated the ring keeps the
+ *                  RTD callback; the main loop drains on every pass anyway,
+ *                  only the irqs counter stays at 0
+ * \param[in]       Instance: GMAC instance
+ * \param[in]       Channel: DMA channel
+ */
+void eth_rx_irq_callback(const uint8 Instance, const uint8 Channel);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ETH_RX_HDR_H */
@@ -0,0 +1,291 @@
+/**
+ * \file            eth_tx.c
+ * \brief           GMAC TX buffer pool with completion reclaim
+ *
+ * Every pool buffer is either FREE, held by the application (APP) or owned
+ * by the DMA (DMA). Frames owned by the DMA - pool buffers and external
+ * buffers from eth_tx_send_ext() - sit in an in-flight FIFO in submission
+ * order; a single ring completes in order, so reclaim only has to look at
+ * the FIFO head. A buffer is never handed out again (or given back to its
+ * owner) before Gmac_Ip_GetTransmitStatus() reports its descriptor done.
+ */
+
+#include "eth_tx.h"
+#include <string.h>
+
+/*===========================================================================*/
+/*                              PRIVATE TYPES                                 */
+/*===========================================================================*/
+
+typedef enum {
+    BUF_FREE = 0,
+    BUF_APP,
+    BUF_DMA,
+} buf_state_t;
+
+typedef struct {
+    uint8_t* data;              /* Frame buffer */
+    eth_tx_done_cb_t done_cb;   /* External buffers only */
+    void* ctx;
+    int8_t pool_idx;            /* Pool index, -1 for external buffers */
+} inflight_t;
+
+/*===========================================================================*/
+/*                              PRIVATE DATA                                  */
+/*===========================================================================*/
+
+/* TX buffers - place in non-cacheable section for DMA access */
+#define ETH_43_GMAC_START_SEC_VAR_CLEARED_UNSPECIFIED_NO_CACHEABLE
+#include "Eth_43_GMAC_MemMap.h"
+static uint8_t g_pool[ETH_TX_POOL_SIZE][ETH_TX_BUF_SIZE] __attribute__((aligned(8)));
+#define ETH_43_GMAC_STOP_SEC_VAR_CLEARED_UNSPECIFIED_NO_CACHEABLE
+#include "Eth_43_GMAC_MemMap.h"
+
+static uint8_t g_inst;
+static uint8_t g_ring;
+
+static const Gmac_Ip_TxOptionsType g_tx_opts = {
+    .NoInt = FALSE,                             /* Completion IRQ wakes reclaim */
+    .CrcPadIns = GMAC_CRC_AND_PAD_INSERTION,
+#if ETH_TX_CSUM_OFFLOAD
+    .ChecksumIns = GMAC_CHECKSUM_INSERTION_PROTO_PSEUDOH,
+#else
+    .ChecksumIns = GMAC_CHECKSUM_INSERTION_DISABLE,
+#endif
+};
+
+static buf_state_t g_state[ETH_TX_POOL_SIZE];
+
+/* In-flight FIFO, oldest first */
+static inflight_t g_fifo[ETH_TX_INFLIGHT_MAX];
+static uint8_t g_fifo_head;
+static uint8_t g_fifo_count;
+
+static uint16_t g_free_count;
+static volatile bool g_tx_done = false;
+
+static eth_tx_stats_t g_stats;
+
+/*===========================================================================*/
+/*                          PRIVATE FUNCTIONS                                 */
+/*===========================================================================*/
+
+/**
+ * \brief           Map a buffer pointer to its pool index
+ * \return          Index, or -1 if the pointer is not the start of a pool buffer
+ */
+static int32_t prv_index_of(const uint8_t* buf) {
+    uintptr_t off;
+
+    if (buf < &g_pool[0][0] || buf > &g_pool[ETH_TX_POOL_SIZE - 1U][0]) {
+        return -1;
+    }
+    off = (uintptr_t)(buf - &g_pool[0][0]);
+    if ((off % ETH_TX_BUF_SIZE) != 0U) {
+        return -1;
+    }
+    return (int32_t)(off / ETH_TX_BUF_SIZE);
+}
+
+static void prv_fifo_push(uint8_t* data, int8_t pool_idx,
+                          eth_tx_done_cb_t done_cb, void* ctx) {
+    inflight_t* e = &g_fifo[(g_fifo_head + g_fifo_count) % ETH_TX_INFLIGHT_MAX];
+
+    e->data = data;
+    e->pool_idx = pool_idx;
+    e->done_cb = done_cb;
+    e->ctx = ctx;
+    g_fifo_count++;
+    if (g_fifo_count > g_stats.max_inflight) {
+        g_stats.max_inflight = g_fifo_count;
+    }
+}
+
+/*===========================================================================*/
+/*                          PUBLIC FUNCTIONS                                  */
+/*===========================================================================*/
+
+void eth_tx_init(uint8_t inst, uint8_t ring) {
+    g_inst = inst;
+    g_ring = ring;
+
+#if ETH_TX_CSUM_OFFLOAD
+    /* Checksum insertion only works on fully buffered frames */
+    Gmac_Ip_EnableTxStoreAndForward(inst, ring);
+#endif
+
+    memset(g_state, 0, sizeof(g_state));
+    g_fifo_head = 0;
+    g_fifo_count = 0;
+    g_free_count = ETH_TX_POOL_SIZE;
+    g_tx_done = false;
+    memset(&g_stats, 0, sizeof(g_stats));
+}
+
+uint8_t* eth_tx_alloc(void) {
+    uint8_t i;
+
+    if (g_free_count == 0U) {
+        eth_tx_reclaim();
+    }
+
+    for (i = 0; i < ETH_TX_POOL_SIZE; i++) {
+        if (g_state[i] == BUF_FREE) {
+            g_state[i] = BUF_APP;
+            g_free_count--;
+            return g_pool[i];
+        }
+    }
+
+    g_stats.would_block++;
+    return NULL;
+}
+
+void eth_tx_release(uint8_t* buf) {
+    int32_t idx = prv_index_of(buf);
+
+    if (idx < 0 || g_state[idx] != BUF_APP) return;
+
+    g_state[idx] = BUF_FREE;
+    g_free_count++;
+}
+
+/**
+ * \brief           Hand one frame to the DMA
+ */
+static ethtxr_t prv_submit(uint8_t* buf, uint16_t len) {
+    Gmac_Ip_BufferType gbuf;
+    Gmac_Ip_StatusType status;
+
+    if (g_fifo_count >= ETH_TX_INFLIGHT_MAX) {
+        g_stats.would_block++;
+        return ethtxBUSY;
+    }
+
+    gbuf.Data = buf;
+    gbuf.Length = len;
+
+    status = Gmac_Ip_SendFrame(g_inst, g_ring, &gbuf, &g_tx_opts);
+    if (status == GMAC_STATUS_TX_QUEUE_FULL) {
+        g_stats.would_block++;
+        return ethtxBUSY;
+    }
+    if (status != GMAC_STATUS_SUCCESS) {
+        g_stats.drv_errors++;
+        return ethtxERR;
+    }
+
+    g_stats.queued++;
+    return ethtxOK;
+}
+
+ethtxr_t eth_tx_send(uint8_t* buf, uint16_t len) {
+    ethtxr_t res;
+    int32_t idx = prv_index_of(buf);
+
+    if (idx < 0 || g_state[idx] != BUF_APP) return ethtxINVPARAM;
+    if (len == 0U || len > ETH_TX_BUF_SIZE) return ethtxINVPARAM;
+
+    res = prv_submit(buf, len);
+    if (res == ethtxOK) {
+        g_state[idx] = BUF_DMA;
+        prv_fifo_push(buf, (int8_t)idx, NULL, NULL);
+    }
+    return res;
+}
+
+ethtxr_t eth_tx_send_ext(uint8_t* buf, uint16_t len, eth_tx_done_cb_t done_cb, void* ctx) {
+    ethtxr_t res;
+
+    if (buf == NULL || len == 0U || len > ETH_TX_BUF_SIZE) return ethtxINVPARAM;
+
+    res = prv_submit(buf, len);
+    if (res == ethtxOK) {
+        prv_fifo_push(buf, -1, done_cb, ctx);
+    }
+    return res;
+}
+
+ethtxr_t eth_tx_send_copy(const uint8_t* data, uint16_t len) {
+    uint8_t* buf;
+    ethtxr_t res;
+
+    if (data == NULL || len == 0U || len > ETH_TX_BUF_SIZE) return ethtxINVPARAM;
+
+    buf = eth_tx_alloc();
+    if (buf == NULL) return ethtxBUSY;
+
+    memcpy(buf, data, len);
+    res = eth_tx_send(buf, len);
+    if (res != ethtxOK) {
+        eth_tx_release(buf);
+    }
+    return res;
+}
+
+uint16_t eth_tx_reclaim(void) {
+    Gmac_Ip_BufferType gbuf;
+    Gmac_Ip_TxInfoType info;
+    Gmac_Ip_StatusType status;
+    uint16_t count = 0;
+    inflight_t e;
+
+    g_tx_done = false;
+
+    while (g_fifo_count > 0U) {
+        e = g_fifo[g_fifo_head];
+        gbuf.Data = e.data;
+        gbuf.Length = 0;
+
+        status = Gmac_Ip_GetTransmitStatus(g_inst, g_ring, &gbuf, &info);
+        if (status == GMAC_STATUS_BUSY) {
+            /* Head still owned by DMA - later frames cannot be done either */
+            break;
+        }
+        if (status == GMAC_STATUS_SUCCESS && info.ErrMask != 0U) {
+            g_stats.tx_errors++;
+        }
+        /* BUFF_NOT_FOUND: descriptor already recycled by a later send, so
+         * the DMA is past this frame */
+
+        g_fifo_head = (uint8_t)((g_fifo_head + 1U) % ETH_TX_INFLIGHT_MAX);
+        g_fifo_count--;
+        g_stats.completed++;
+        count++;
+
+        if (e.pool_idx >= 0) {
+            g_state[e.pool_idx] = BUF_FREE;
+            g_free_count++;
+        } else if (e.done_cb != NULL) {
+            /* Entry already popped: the callback may queue new frames */
+            e.done_cb(e.data, e.ctx);
+        }
+    }
+
+    return count;
+}
+
+uint16_t eth_tx_free_count(void) {
+    return g_free_count;
+}
+
+bool eth_tx_pending(void) {
+    return g_tx_done;
+}
+
+void eth_tx_get_stats(eth_tx_stats_t* stats) {
+    if (stats == NULL) return;
+    *stats = g_stats;
+}
+
+/*===========================================================================*/
+/*                          INTERRUPT CALLBACK                                */
+/*===========================================================================*/
+
+void eth_tx_irq_callback(const uint8 Instance, const uint8 Channel) {
+    (void)Instance;
+    (void)Channel;
+
+    g_stats.irqs++;
+    g_tx_done = true;
+}
@@ -0,0 +1,179 @@
+/**
+ * \file            eth_tx.h
+ * \brief           GMAC TX buffer pool with completion reclaim
+ */
+
+#ifndef ETH_TX_HDR_H
+#define ETH_TX_HDR_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "Gmac_Ip.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*===========================================================================*/
+/*                          CONFIGURATION                                     */
+/*===========================================================================*/
+
+/**
+ * \brief           Number of DMA-safe TX buffers
+ * \note            Must not exceed the TX descriptor ring size (16). Frame
+ *                  templates (frame_tpl.h) keep some buffers for good.
+ */
+#ifndef ETH_TX_POOL_SIZE
+#define ETH_TX_POOL_SIZE                12U
+#endif
+
+/**
+ * \brief           Max frames owned by the DMA at once (pool + external)
+ * \note            Must not exceed the TX descriptor ring size (16)
+ */
+#ifndef ETH_TX_INFLIGHT_MAX
+#define ETH_TX_INFLIGHT_MAX             16U
+#endif
+
+/**
+ * \brief           Size of one TX buffer (matches GMAC_0_MAX_TXBUFFLEN_SUPPORTED)
+ */
+#ifndef ETH_TX_BUF_SIZE
+#define ETH_TX_BUF_SIZE                 1536U
+#endif
+
+/**
+ * \brief           Let the GMAC insert IPv4 header and TCP/UDP/ICMP checksums
+ * \note            When 1, senders leave checksum fields at 0 and the MAC
+ *                  fills them (full mode, pseudo-header included). Non-IP
+ *                  frames pass through unchanged. Needs TX store-and-forward.
+ */
+#ifndef ETH_TX_CSUM_OFFLOAD
+#define ETH_TX_CSUM_OFFLOAD             1
+#endif
+
+/*===========================================================================*/
+/*                              TYPES                                         */
+/*===========================================================================*/
+
+/**
+ * \brief           Status return codes
+ */
+typedef enum {
+    ethtxOK = 0,        /*!< Frame queued for transmission */
+    ethtxBUSY,          /*!< Would block: no free buffer or descriptor */
+    ethtxERR,           /*!< Driver error */
+    ethtxINVPARAM,      /*!< Invalid parameter */
+} ethtxr_t;
+
+/**
+ * \brief           Completion callback for frames sent from external buffers
+ * \param[in]       buf: The buffer passed to eth_tx_send_ext()
+ * \param[in]       ctx: User context
+ */
+typedef void (*eth_tx_done_cb_t)(uint8_t* buf, void* ctx);
+
+/**
+ * \brief           TX path statistics
+ */
+typedef struct {
+    uint32_t queued;            /*!< Frames handed to the DMA */
+    uint32_t completed;         /*!< Frames reclaimed after transmission */
+    uint32_t tx_errors;         /*!< Completed frames reporting a TX error */
+    uint32_t would_block;       /*!< Sends/allocations refused (pool or ring full) */
+    uint32_t drv_errors;        /*!< Unexpected driver return codes */
+    uint32_t max_inflight;      /*!< High-water mark of frames owned by the DMA */
+    uint32_t irqs;              /*!< TX complete interrupts taken */
+} eth_tx_stats_t;
+
+/*===========================================================================*/
+/*                          PUBLIC FUNCTIONS                                  */
+/*===========================================================================*/
+
+/**
+ * \brief           Initialize the TX pool for one GMAC ring
+ * \param[in]       inst: GMAC instance
+ * \param[in]       ring: TX ring index
+ */
+void eth_tx_init(uint8_t inst, uint8_t ring);
+
+/**
+ * \brief           Take a free TX buffer
+ * \return          Pointer to ETH_TX_BUF_SIZE bytes, NULL if all buffers are in flight
+ * \note            The caller owns the buffer until eth_tx_send() or eth_tx_release()
+ */
+uint8_t* eth_tx_alloc(void);
+
+/**
+ * \brief           Give an unused buffer back to the pool
+ * \param[in]       buf: Buffer from eth_tx_alloc()
+ */
+void eth_tx_release(uint8_t* buf);
+
+/**
+ * \brief           Queue a pool buffer for transmission (non-blocking)
+ * \param[in]       buf: Buffer from eth_tx_alloc()
+ * \param[in]       len: Frame length in bytes
+ * \return          ethtxOK: ownership moved to the DMA, buffer returns to the
+ *                      pool when transmission completes
+ *                  ethtxBUSY: descriptor ring full, caller still owns buf
+ */
+ethtxr_t eth_tx_send(uint8_t* buf, uint16_t len);
+
+/**
+ * \brief           Copy a frame into a pool buffer and queue it (non-blocking)
+ * \param[in]       data: Frame data
+ * \param[in]       len: Frame length in bytes
+ * \return          ethtxOK or ethtxBUSY, nothing is queued on failure
+ */
+ethtxr_t eth_tx_send_copy(const uint8_t* data, uint16_t len);
+
+/**
+ * \brief           Queue a frame from a caller-owned buffer (zero-copy, non-blocking)
+ * \param[in]       buf: DMA-reachable frame buffer (non-cacheable section)
+ * \param[in]       len: Frame length in bytes
+ * \param[in]       done_cb: Called from eth_tx_reclaim() once the DMA is
+ *                  done with buf (may be NULL)
+ * \param[in]       ctx: User context for done_cb
+ * \return          ethtxOK: buf must not be touched until done_cb runs
+ *                  ethtxBUSY: ring full, nothing queued
+ */
+ethtxr_t eth_tx_send_ext(uint8_t* buf, uint16_t len, eth_tx_done_cb_t done_cb, void* ctx);
+
+/**
+ * \brief           Return completed buffers to the pool / their owners
+ * \return          Number of frames reclaimed
+ */
+uint16_t eth_tx_reclaim(void);
+
+/**
+ * \brief           Number of buffers currently available
+ */
+uint16_t eth_tx_free_count(void);
+
+/**
+ * \brief           Check if a TX completion is waiting to be reclaimed
+ */
+bool eth_tx_pending(void);
+
+/**
+ * \brief           Get TX statistics
+ * \param[out]      stats: Statistics output
+ */
+void eth_tx_get_stats(eth_tx_stats_t* stats);
+
+/**
+ * \brief           GMAC TX channel callback (EthCtrlConfigEgressFifoCallback in the .mex)
+ * \note            Until the configuration is regenerated the ring keeps the
+ *                  RTD callback; eth_tx_reclaim() polls the descriptors from
+ *                  the main loop, eth_tx_pending() then never reports work
+ * \param[in]       Instance: GMAC instance
+ * \param[in]       Channel: DMA channel
+ */
+void eth_tx_irq_callback(const uint8 Instance, const uint8 Channel);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ETH_TX_HDR_H */
@@ -0,0 +1,206 @@
+/**
+ * \file            frame_tpl.c
+ * \brief           Precomputed Ethernet/IPv4/UDP frame templates
+ *
+ * Own buffers are sent with eth_tx_send_ext() and come back to the template
+ * through the completion callback, so their header bytes are never
+ * rewritten. When the next hop is not resolved yet the frame is copied to a
+ * shared pool buffer and parked on the ARP queue, the own buffer is free
+ * again right away.
+ */
+
+#include "frame_tpl.h"
+#include "arp_cache.h"
+#include "inet_csum.h"
+#include "net_dispatch.h"
+#include <stddef.h>
+#include <string.h>
+
+#define IP_OFS                      NET_ETH_HDR_LEN
+#define UDP_OFS                     (NET_ETH_HDR_LEN + 20U)
+#define ETH_MIN_FRAME               60U
+
+/*===========================================================================*/
+/*                          PRIVATE FUNCTIONS                                 */
+/*===========================================================================*/
+
+static inline void prv_wr16be(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t)(v >> 8);
+    p[1] = (uint8_t)v;
+}
+
+/* TX completion of an own buffer */
+static void prv_done(uint8_t* buf, void* ctx) {
+    (void)buf;
+    *(volatile uint8_t*)ctx = 0U;
+}
+
+/* Hand a shared pool buffer to ARP (takes ownership in every case) */
+static ethtxr_t prv_output_pool(frame_tpl_t* tpl, uint8_t* buf, uint16_t len) {
+    arpr_t res = arp_output(buf, len, tpl->dst_ip);
+
+    if (res == arpDROP) {
+        tpl->stats.drops++;
+        return ethtxBUSY;
+    }
+    if (res == arpQUEUED) {
+        tpl->stats.resolving++;
+    }
+    tpl->stats.sent++;
+    return ethtxOK;
+}
+
+/*===========================================================================*/
+/*                          PUBLIC FUNCTIONS                                  */
+/*===========================================================================*/
+
+uint8_t frame_tpl_udp_init(frame_tpl_t* tpl, const uint8_t src_mac[6],
+                           const uint8_t src_ip[4], const uint8_t dst_ip[4],
+                           uint16_t src_port, uint16_t dst_port, uint8_t nbufs) {
+    uint8_t* ip;
+    uint8_t* udp;
+    uint8_t i;
+
+    if (tpl == NULL) return 0;
+
+    memset(tpl, 0, sizeof(*tpl));
+    tpl->cur_idx = -1;
+    ip = &tpl->hdr[IP_OFS];
+    udp = &tpl->hdr[UDP_OFS];
+
+    /* Dest MAC, IP length/ID/checksum and UDP length are patched per frame */
+    memcpy(&tpl->hdr[6], src_mac, 6);
+    prv_wr16be(&tpl->hdr[12], NET_ETHERTYPE_IPV4);
+
+    ip[0] = 0x45;                       /* Version 4, IHL 5, flags/fragment 0 */
+    ip[8] = 64;                         /* TTL */
+    ip[9] = NET_IP_PROTO_UDP;
+    memcpy(&ip[12], src_ip, 4);
+    memcpy(&ip[16], dst_ip, 4);
+
+    prv_wr16be(&udp[0], src_port);
+    prv_wr16be(&udp[2], dst_port);
+
+    memcpy(tpl->dst_ip, dst_ip, 4);
+    tpl->base_csum = inet_csum(ip, 20);
+
+    if (nbufs > FRAME_TPL_MAX_BUFS) {
+        nbufs = FRAME_TPL_MAX_BUFS;
+    }
+    for (i = 0; i < nbufs; i++) {
+        uint8_t* buf = eth_tx_alloc();
+        if (buf == NULL) break;
+        memcpy(buf, tpl->hdr, FRAME_TPL_HDR_LEN);
+        tpl->bufs[i] = buf;
+    }
+    tpl->nbufs = i;
+    return i;
+}
+
+uint8_t* frame_tpl_begin(frame_tpl_t* tpl) {
+    uint8_t* buf;
+    uint8_t i;
+
+    if (tpl == NULL) return NULL;
+    if (tpl->cur != NULL) return &tpl->cur[FRAME_TPL_HDR_LEN];
+
+    for (i = 0; i < tpl->nbufs; i++) {
+        if (tpl->busy[i] == 0U) {
+            tpl->busy[i] = 1U;
+            tpl->cur_idx = (int8_t)i;
+            tpl->cur = tpl->bufs[i];
+            return &tpl->cur[FRAME_TPL_HDR_LEN];
+        }
+    }
+
+    /* All own buffers in flight: header copy into a shared one */
+    buf = eth_tx_alloc();
+    if (buf == NULL) {
+        tpl->stats.drops++;
+        return NULL;
+    }
+    memcpy(buf, tpl->hdr, FRAME_TPL_HDR_LEN);
+    tpl->stats.fallback++;
+    tpl->cur_idx = -1;
+    tpl->cur = buf;
+    return &buf[FRAME_TPL_HDR_LEN];
+}
+
+ethtxr_t frame_tpl_send(frame_tpl_t* tpl, uint16_t payload_len) {
+    uint8_t* buf;
+    uint8_t* ip;
+    uint8_t* copy;
+    uint16_t len;
+    int8_t idx;
+
+    if (tpl == NULL || tpl->cur == NULL) return ethtxINVPARAM;
+    if (payload_len > FRAME_TPL_MAX_PAYLOAD) return ethtxINVPARAM;
+
+    buf = tpl->cur;
+    idx = tpl->cur_idx;
+    tpl->cur = NULL;
+    ip = &buf[IP_OFS];
+
+    prv_wr16be(&ip[2], (uint16_t)(28U + payload_len));
+    prv_wr16be(&ip[4], tpl->ip_id++);
+    prv_wr16be(&buf[UDP_OFS + 4U], (uint16_t)(8U + payload_len));
+#if !ETH_TX_CSUM_OFFLOAD
+    {
+        /* Both fields are 0 in the base checksum */
+        uint16_t csum = tpl->base_csum;
+        uint16_t w;
+
+        memcpy(&w, &ip[2], 2);
+        csum = inet_csum_update16(csum, 0U, w);
+        memcpy(&w, &ip[4], 2);
+        csum = inet_csum_update16(csum, 0U, w);
+        memcpy(&ip[10], &csum, 2);
+    }
+#endif
+
+    len = (uint16_t)(FRAME_TPL_HDR_LEN + payload_len);
+    if (len < ETH_MIN_FRAME) {
+        memset(&buf[len], 0, ETH_MIN_FRAME - len);
+        len = ETH_MIN_FRAME;
+    }
+
+    if (idx < 0) {
+        return prv_output_pool(tpl, buf, len);
+    }
+
+    if (!arp_resolve(tpl->dst_ip, buf)) {
+        /* Resolution can take seconds: park a copy, keep the own buffer */
+        tpl->busy[idx] = 0U;
+        copy = eth_tx_alloc();
+        if (copy == NULL) {
+            tpl->stats.drops++;
+            return ethtxBUSY;
+        }
+        memcpy(copy, buf, len);
+        return prv_output_pool(tpl, copy, len);
+    }
+
+    if (eth_tx_send_ext(buf, len, prv_done, (void*)&tpl->busy[idx]) != ethtxOK) {
+        tpl->busy[idx] = 0U;
+        tpl->stats.drops++;
+        return ethtxBUSY;
+    }
+    tpl->stats.sent++;
+    return ethtxOK;
+}
+
+void frame_tpl_abort(frame_tpl_t* tpl) {
+    if (tpl == NULL || tpl->cur == NULL) return;
+
+    if (tpl->cur_idx < 0) {
+        eth_tx_release(tpl->cur);
+    } else {
+        tpl->busy[tpl->cur_idx] = 0U;
+    }
+    tpl->cur = NULL;
+}
+
+void frame_tpl_get_stats(const frame_tpl_t* tpl, frame_tpl_stats_t* stats) {
+    if (tpl == NULL || stats == NULL) return;
+    *stats = tpl->stats;
+}
@@ -0,0 +1,124 @@
+/**
+ * \file            frame_tpl.h
+ * \brief           Precomputed Ethernet/IPv4/UDP frame templates
+ *
+ * A template holds the header of a fixed-format UDP stream. It is built
+ * once at init and pre-written into TX pool buffers that the template keeps
+ * for its whole life. Sending only patches the destination MAC, the IP
+ * total length, the IP ID and the UDP length; without checksum offload the
+ * IP header checksum is updated incrementally from a precomputed base.
+ *
+ *      uint8_t* p = frame_tpl_begin(&tpl);     payload pointer
+ *      ... write n payload bytes at p ...
+ *      frame_tpl_send(&tpl, n);
+ */
+
+#ifndef FRAME_TPL_HDR_H
+#define FRAME_TPL_HDR_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "eth_tx.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*===========================================================================*/
+/*                          CONFIGURATION                                     */
+/*===========================================================================*/
+
+/**
+ * \brief           Max pool buffers kept by one template
+ * \note            The buffers stay out of the shared pool, size
+ *                  ETH_TX_POOL_SIZE accordingly
+ */
+#ifndef FRAME_TPL_MAX_BUFS
+#define FRAME_TPL_MAX_BUFS              2U
+#endif
+
+#define FRAME_TPL_HDR_LEN               42U     /*!< Ethernet + IPv4 + UDP */
+#define FRAME_TPL_MAX_PAYLOAD           1472U   /*!< 1500 MTU - IP - UDP */
+
+/*===========================================================================*/
+/*                              TYPES                                         */
+/*===========================================================================*/
+
+/**
+ * \brief           Template statistics
+ */
+typedef struct {
+    uint32_t sent;              /*!< Frames handed to TX or ARP */
+    uint32_t resolving;         /*!< Frames copied to the ARP queue (next hop unknown) */
+    uint32_t fallback;          /*!< Sends from a shared pool buffer (own buffers busy) */
+    uint32_t drops;             /*!< Frames not sent (no buffer, TX busy) */
+} frame_tpl_stats_t;
+
+/**
+ * \brief           UDP frame template
+ * \note            Treat as opaque
+ */
+typedef struct {
+    uint8_t hdr[FRAME_TPL_HDR_LEN];         /*!< Header with variable fields at 0 */
+    uint8_t dst_ip[4];
+    uint16_t base_csum;                     /*!< IP checksum of hdr (memory order) */
+    uint16_t ip_id;
+    uint8_t* bufs[FRAME_TPL_MAX_BUFS];      /*!< Own pool buffers, header pre-written */
+    volatile uint8_t busy[FRAME_TPL_MAX_BUFS];
+    uint8_t nbufs;
+    int8_t cur_idx;                         /*!< Open frame: own buffer index, -1 = pool */
+    uint8_t* cur;                           /*!< Open frame, NULL if none */
+    frame_tpl_stats_t stats;
+} frame_tpl_t;
+
+/*===========================================================================*/
+/*                          PUBLIC FUNCTIONS                                  */
+/*===========================================================================*/
+
+/**
+ * \brief           Build a UDP template and take its buffers from the TX pool
+ * \param[out]      tpl: Template
+ * \param[in]       src_mac: Our MAC address
+ * \param[in]       src_ip: Our IPv4 address
+ * \param[in]       dst_ip: Destination (resolved by ARP on every send)
+ * \param[in]       src_port: UDP source port
+ * \param[in]       dst_port: UDP destination port
+ * \param[in]       nbufs: Buffers to keep (0..FRAME_TPL_MAX_BUFS)
+ * \return          Number of buffers actually taken
+ * \note            Call after eth_tx_init(). With 0 buffers every frame is
+ *                  a pool buffer plus a header copy.
+ */
+uint8_t frame_tpl_udp_init(frame_tpl_t* tpl, const uint8_t src_mac[6],
+                           const uint8_t src_ip[4], const uint8_t dst_ip[4],
+                           uint16_t src_port, uint16_t dst_port, uint8_t nbufs);
+
+/**
+ * \brief           Open a frame
+ * \return          Payload pointer (FRAME_TPL_MAX_PAYLOAD bytes), NULL if no
+ *                  buffer is free. Returns the same frame while one is open.
+ */
+uint8_t* frame_tpl_begin(frame_tpl_t* tpl);
+
+/**
+ * \brief           Patch the header of the open frame and send it
+ * \param[in]       payload_len: Payload bytes written after frame_tpl_begin()
+ * \return          ethtxOK (sent or queued for ARP), ethtxBUSY (dropped),
+ *                  ethtxINVPARAM (no open frame, payload too long)
+ */
+ethtxr_t frame_tpl_send(frame_tpl_t* tpl, uint16_t payload_len);
+
+/**
+ * \brief           Discard the open frame
+ */
+void frame_tpl_abort(frame_tpl_t* tpl);
+
+/**
+ * \brief           Get template statistics
+ */
+void frame_tpl_get_stats(const frame_tpl_t* tpl, frame_tpl_stats_t* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FRAME_TPL_HDR_H */
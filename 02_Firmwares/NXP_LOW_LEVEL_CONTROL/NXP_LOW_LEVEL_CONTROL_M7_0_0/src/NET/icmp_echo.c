@@ -0,0 +1,60 @@
+/**
+ * \file            icmp_echo.c
+ * \brief           In-place ICMP echo reply for the raw Ethernet path
+ */
+
+#include "icmp_echo.h"
+#include "inet_csum.h"
+#include "eth_tx.h"
+#include <string.h>
+
+/*===========================================================================*/
+/*                          PUBLIC FUNCTIONS                                  */
+/*===========================================================================*/
+
+uint16_t icmp_echo_reply_in_place(net_frame_t* f, const uint8_t* our_mac) {
+    uint8_t* pkt = f->frame;
+    uint8_t* ip = f->l3;
+    uint8_t* icmp = f->l4;
+    uint16_t total_len;
+    uint16_t min_len;
+    uint8_t tmp[4];
+#if !ETH_TX_CSUM_OFFLOAD
+    uint16_t icmp_csum;
+#endif
+
+    /* First fragment with at least the 8-byte echo header */
+    if (icmp == NULL || f->l4_len < 8U) return 0;
+    if (icmp[0] != ICMP_ECHO_REQUEST || icmp[1] != 0U) return 0;
+
+    /* Frame length from the IP header: PktLen may include FCS / padding */
+    total_len = f->l2_len + f->l3_len;
+    min_len = f->l2_len + 46U;
+    if (total_len < min_len) {
+        total_len = min_len;    /* Keep the request's own padding */
+    }
+    if (total_len > f->len) return 0;
+
+    /* Swap addresses; see the header for why no checksum is summed */
+    memcpy(&pkt[0], &pkt[6], 6);
+    memcpy(&pkt[6], our_mac, 6);
+
+    memcpy(tmp, &ip[12], 4);
+    memcpy(&ip[12], &ip[16], 4);
+    memcpy(&ip[16], tmp, 4);
+
+#if ETH_TX_CSUM_OFFLOAD
+    icmp[0] = ICMP_ECHO_REPLY;
+    icmp[2] = 0;
+    icmp[3] = 0;
+#else
+    icmp_csum = ((uint16_t)icmp[2] << 8) | icmp[3];
+    icmp_csum = inet_csum_update16(icmp_csum, (uint16_t)ICMP_ECHO_REQUEST << 8,
+                                   (uint16_t)ICMP_ECHO_REPLY << 8);
+    icmp[0] = ICMP_ECHO_REPLY;
+    icmp[2] = (uint8_t)(icmp_csum >> 8);
+    icmp[3] = (uint8_t)(icmp_csum & 0xFFU);
+#endif
+
+    return total_len;
+}
@@ -0,0 +1,47 @@
+/**
+ * \file            icmp_echo.h
+ * \brief           In-place ICMP echo reply for the raw Ethernet path
+ */
+
+#ifndef ICMP_ECHO_HDR_H
+#define ICMP_ECHO_HDR_H
+
+#include <stdint.h>
+#include "net_dispatch.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*===========================================================================*/
+/*                              CONSTANTS                                     */
+/*===========================================================================*/
+
+#define ICMP_ECHO_REQUEST               8U
+#define ICMP_ECHO_REPLY                 0U
+
+/*===========================================================================*/
+/*                          PUBLIC FUNCTIONS                                  */
+/*===========================================================================*/
+
+/**
+ * \brief           Turn an ICMP echo request into its reply, in the RX buffer
+ * \param[in,out]   f: Parsed frame, already checked to be addressed to us
+ * \param[in]       our_mac: Source MAC of the reply
+ * \return          Reply length in bytes (IP total length plus L2 header,
+ *                  at least the Ethernet minimum), 0 if the frame is not a
+ *                  well-formed echo request (frame left untouched)
+ * \note            MACs and IPs are swapped; swapping two words does not
+ *                  change the one's complement sum, so the IP checksum stays
+ *                  valid. Only the ICMP type word changes: with
+ *                  ETH_TX_CSUM_OFFLOAD the checksum field is zeroed for the
+ *                  GMAC, otherwise it is patched incrementally (RFC 1624)
+ *                  instead of summing the payload.
+ */
+uint16_t icmp_echo_reply_in_place(net_frame_t* f, const uint8_t* our_mac);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ICMP_ECHO_HDR_H */
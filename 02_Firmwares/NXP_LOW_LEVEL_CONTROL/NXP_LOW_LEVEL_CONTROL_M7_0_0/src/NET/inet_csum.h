@@ -0,0 +1,73 @@
+/**
+ * \file            inet_csum.h
+ * \brief           Internet checksum (RFC 1071) kernel shared by the raw
+ *                  Ethernet path and lwIP (LWIP_CHKSUM)
+ *
+ * All sums are kept in memory byte order: a checksum returned by
+ * inet_csum() is stored into the header as-is (memcpy), without a byte
+ * swap. Partial sums are not inverted and may be chained with
+ * inet_csum_partial() or combined with inet_csum_combine().
+ */
+
+#ifndef INET_CSUM_HDR_H
+#define INET_CSUM_HDR_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*===========================================================================*/
+/*                          PUBLIC FUNCTIONS                                  */
+/*===========================================================================*/
+
+/**
+ * \brief           Add a block to a running one's complement sum
+ * \param[in]       data: Data, any alignment
+ * \param[in]       len: Length in bytes
+ * \param[in]       sum: Running sum (0 to start), from a block starting at
+ *                  the same data offset parity
+ * \return          New running sum (folded to 16 bits, not inverted)
+ */
+uint32_t inet_csum_partial(const void* data, uint32_t len, uint32_t sum);
+
+/**
+ * \brief           Combine the sums of two adjacent blocks
+ * \param[in]       sum_a: Sum of the first block
+ * \param[in]       sum_b: Sum of the second block (computed on its own)
+ * \param[in]       offset_b: Offset of the second block in the message;
+ *                  an odd offset shifts its bytes to the other lane
+ * \return          Sum of both blocks (folded to 16 bits, not inverted)
+ */
+uint32_t inet_csum_combine(uint32_t sum_a, uint32_t sum_b, uint32_t offset_b);
+
+/**
+ * \brief           Fold and invert a running sum into the final checksum
+ */
+uint16_t inet_csum_finish(uint32_t sum);
+
+/**
+ * \brief           Checksum of one block, ready to store (memory byte order)
+ */
+uint16_t inet_csum(const void* data, uint32_t len);
+
+/**
+ * \brief           Incremental update for one changed 16-bit word
+ *                  (RFC 1624, eqn. 3: HC' = ~(~HC + ~m + m'))
+ * \note            All three values must use the same byte order
+ */
+uint16_t inet_csum_update16(uint16_t csum, uint16_t old_word, uint16_t new_word);
+
+/**
+ * \brief           lwIP hook (LWIP_CHKSUM, set in lwip_hooks.h)
+ * \return          Folded, non-inverted sum in memory byte order, as
+ *                  lwip_standard_chksum()
+ */
+uint16_t inet_csum_lwip(const void* dataptr, int len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INET_CSUM_HDR_H */
@@ -0,0 +1,19 @@
+/**
+ * \file            lwip_hooks.h
+ * \brief           Project overrides for lwIP options that the generated
+ *                  lwipopts.h does not expose
+ *
+ * Force-included into every C file (C compiler "Include files (-include)"
+ * in .cproject) so it is seen before lwipopts.h and survives regeneration
+ * of the tcpip component.
+ */
+
+#ifndef LWIP_HOOKS_HDR_H
+#define LWIP_HOOKS_HDR_H
+
+#include "inet_csum.h"
+
+/* Word-wide checksum kernel instead of lwip_standard_chksum() */
+#define LWIP_CHKSUM                 inet_csum_lwip
+
+#endif /* LWIP_HOOKS_HDR_H */
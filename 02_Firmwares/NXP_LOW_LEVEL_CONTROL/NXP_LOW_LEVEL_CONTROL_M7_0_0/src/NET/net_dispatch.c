@@ -0,0 +1,312 @@
+/**
+ * \file            net_dispatch.c
+ * \brief           Table-driven protocol dispatch for the raw Ethernet path
+ *
+ * Lookup is O(1): IP protocols index a 256-entry table directly, EtherTypes
+ * and UDP ports go through small open-addressed hash tables (linear probing,
+ * a handful of entries in tables sized well above that). Tables hold handler
+ * indices, the handlers and their counters live in one flat array.
+ */
+
+#include "net_dispatch.h"
+#include "log_debug.h"
+#include <stddef.h>
+#include <string.h>
+
+#define TAG "NET"
+
+#define NO_HANDLER                  0xFFU
+
+/*===========================================================================*/
+/*                              PRIVATE TYPES                                 */
+/*===========================================================================*/
+
+typedef struct {
+    const char* name;
+    net_handler_t fn;
+    net_handler_stats_t stats;
+} handler_entry_t;
+
+typedef struct {
+    uint16_t key;
+    uint8_t idx;                /* NO_HANDLER = empty slot */
+} hash_slot_t;
+
+/*===========================================================================*/
+/*                              PRIVATE DATA                                  */
+/*===========================================================================*/
+
+static handler_entry_t g_handlers[NET_MAX_HANDLERS];
+static uint8_t g_handler_count;
+
+static uint8_t g_ip_proto_tbl[256];
+static hash_slot_t g_ethertype_tbl[NET_ETHERTYPE_SLOTS];
+static hash_slot_t g_udp_port_tbl[NET_UDP_PORT_SLOTS];
+
+static net_dispatch_stats_t g_stats;
+
+/*===========================================================================*/
+/*                          PRIVATE FUNCTIONS                                 */
+/*===========================================================================*/
+
+static inline uint16_t prv_rd16(const uint8_t* p) {
+    return (uint16_t)(((uint16_t)p[0] << 8) | p[1]);
+}
+
+static inline uint32_t prv_hash16(uint16_t key) {
+    return (uint32_t)(key ^ (key >> 8) ^ (key >> 4));
+}
+
+static uint8_t prv_hash_find(const hash_slot_t* tbl, uint32_t slots, uint16_t key) {
+    uint32_t i = prv_hash16(key) & (slots - 1U);
+    uint32_t n;
+
+    for (n = 0; n < slots; n++) {
+        if (tbl[i].idx == NO_HANDLER) return NO_HANDLER;
+        if (tbl[i].key == key) return tbl[i].idx;
+        i = (i + 1U) & (slots - 1U);
+    }
+    return NO_HANDLER;
+}
+
+static bool prv_hash_insert(hash_slot_t* tbl, uint32_t slots, uint16_t key, uint8_t idx) {
+    uint32_t i = prv_hash16(key) & (slots - 1U);
+    uint32_t n;
+
+    for (n = 0; n < slots; n++) {
+        if (tbl[i].idx == NO_HANDLER) {
+            tbl[i].key = key;
+            tbl[i].idx = idx;
+            return true;
+        }
+        if (tbl[i].key == key) return false;
+        i = (i + 1U) & (slots - 1U);
+    }
+    return false;
+}
+
+static int32_t prv_add_handler(const char* name, net_handler_t fn) {
+    handler_entry_t* h;
+
+    if (fn == NULL || g_handler_count >= NET_MAX_HANDLERS) return -1;
+
+    h = &g_handlers[g_handler_count];
+    h->name = name;
+    h->fn = fn;
+    memset(&h->stats, 0, sizeof(h->stats));
+    return (int32_t)g_handler_count++;
+}
+
+static void prv_call(uint8_t idx, net_frame_t* f) {
+    handler_entry_t* h = &g_handlers[idx];
+
+    h->stats.packets++;
+    h->stats.bytes += f->len;
+    if (!h->fn(f)) {
+        h->stats.drops++;
+    }
+}
+
+/**
+ * \brief           Parse the IPv4 header and, for the first fragment of a
+ *                  UDP datagram, the UDP header
+ * \return          false if the headers are truncated or inconsistent
+ */
+static bool prv_parse_ipv4(net_frame_t* f) {
+    uint8_t* ip = f->l3;
+    uint16_t avail = (uint16_t)(f->len - f->l2_len);
+    uint16_t total_len;
+    uint16_t frag;
+
+    if (avail < 20U || (ip[0] >> 4) != 4U) return false;
+
+    f->ip_hdr_len = (uint8_t)((ip[0] & 0x0FU) * 4U);
+    total_len = prv_rd16(&ip[2]);
+
+    /* PktLen may include padding / FCS, trust the IP total length */
+    if (f->ip_hdr_len < 20U || total_len < f->ip_hdr_len || total_len > avail) {
+        return false;
+    }
+
+    f->has_ip = true;
+    f->l3_len = total_len;
+    f->ip_proto = ip[9];
+    f->src_ip = &ip[12];
+    f->dst_ip = &ip[16];
+    f->l4_len = (uint16_t)(total_len - f->ip_hdr_len);
+
+    /* Transport header only exists in the first fragment */
+    frag = prv_rd16(&ip[6]);
+    if ((frag & 0x1FFFU) != 0U) {
+        return true;
+    }
+    f->l4 = ip + f->ip_hdr_len;
+
+    if (f->ip_proto == NET_IP_PROTO_UDP && f->l4_len >= 8U) {
+        uint16_t udp_len = prv_rd16(&f->l4[4]);
+
+        if (udp_len < 8U || udp_len > f->l4_len) return false;
+
+        f->has_udp = true;
+        f->src_port = prv_rd16(&f->l4[0]);
+        f->dst_port = prv_rd16(&f->l4[2]);
+        f->payload = f->l4 + 8;
+        f->payload_len = (uint16_t)(udp_len - 8U);
+    }
+    return true;
+}
+
+/*===========================================================================*/
+/*                          PUBLIC FUNCTIONS                                  */
+/*===========================================================================*/
+
+void net_dispatch_init(void) {
+    uint32_t i;
+
+    memset(g_handlers, 0, sizeof(g_handlers));
+    g_handler_count = 0;
+
+    memset(g_ip_proto_tbl, NO_HANDLER, sizeof(g_ip_proto_tbl));
+    for (i = 0; i < NET_ETHERTYPE_SLOTS; i++) {
+        g_ethertype_tbl[i].idx = NO_HANDLER;
+    }
+    for (i = 0; i < NET_UDP_PORT_SLOTS; i++) {
+        g_udp_port_tbl[i].idx = NO_HANDLER;
+    }
+
+    memset(&g_stats, 0, sizeof(g_stats));
+}
+
+bool net_register_ethertype(uint16_t ethertype, const char* name, net_handler_t fn) {
+    int32_t idx;
+
+    if (prv_hash_find(g_ethertype_tbl, NET_ETHERTYPE_SLOTS, ethertype) != NO_HANDLER) {
+        return false;
+    }
+    idx = prv_add_handler(name, fn);
+    if (idx < 0) return false;
+    if (!prv_hash_insert(g_ethertype_tbl, NET_ETHERTYPE_SLOTS, ethertype, (uint8_t)idx)) {
+        g_handler_count--;
+        return false;
+    }
+    return true;
+}
+
+bool net_register_ip_proto(uint8_t proto, const char* name, net_handler_t fn) {
+    int32_t idx;
+
+    if (g_ip_proto_tbl[proto] != NO_HANDLER) return false;
+    idx = prv_add_handler(name, fn);
+    if (idx < 0) return false;
+    g_ip_proto_tbl[proto] = (uint8_t)idx;
+    return true;
+}
+
+bool net_register_udp_port(uint16_t port, const char* name, net_handler_t fn) {
+    int32_t idx;
+
+    if (prv_hash_find(g_udp_port_tbl, NET_UDP_PORT_SLOTS, port) != NO_HANDLER) {
+        return false;
+    }
+    idx = prv_add_handler(name, fn);
+    if (idx < 0) return false;
+    if (!prv_hash_insert(g_udp_port_tbl, NET_UDP_PORT_SLOTS, port, (uint8_t)idx)) {
+        g_handler_count--;
+        return false;
+    }
+    return true;
+}
+
+void net_dispatch(uint8_t* frame, uint16_t len) {
+    net_frame_t f;
+    uint8_t idx = NO_HANDLER;
+
+    g_stats.frames++;
+    if (len < NET_ETH_HDR_LEN) {
+        g_stats.malformed++;
+        return;
+    }
+
+    memset(&f, 0, sizeof(f));
+    f.frame = frame;
+    f.len = len;
+    f.dst_mac = &frame[0];
+    f.src_mac = &frame[6];
+    f.ethertype = prv_rd16(&frame[12]);
+    f.l2_len = NET_ETH_HDR_LEN;
+
+    if (f.ethertype == NET_ETHERTYPE_VLAN) {
+        if (len < NET_ETH_HDR_LEN + NET_VLAN_TAG_LEN) {
+            g_stats.malformed++;
+            return;
+        }
+        f.has_vlan = true;
+        f.vlan_tci = prv_rd16(&frame[14]);
+        f.ethertype = prv_rd16(&frame[16]);
+        f.l2_len = NET_ETH_HDR_LEN + NET_VLAN_TAG_LEN;
+        g_stats.vlan_frames++;
+    }
+
+    f.l3 = &frame[f.l2_len];
+    f.l3_len = (uint16_t)(len - f.l2_len);
+
+    if (f.ethertype == NET_ETHERTYPE_IPV4) {
+        if (!prv_parse_ipv4(&f)) {
+            g_stats.malformed++;
+            return;
+        }
+        if (f.has_udp) {
+            idx = prv_hash_find(g_udp_port_tbl, NET_UDP_PORT_SLOTS, f.dst_port);
+        }
+        if (idx == NO_HANDLER) {
+            idx = g_ip_proto_tbl[f.ip_proto];
+        }
+    }
+    if (idx == NO_HANDLER) {
+        idx = prv_hash_find(g_ethertype_tbl, NET_ETHERTYPE_SLOTS, f.ethertype);
+    }
+
+    if (idx == NO_HANDLER) {
+        g_stats.unhandled++;
+        return;
+    }
+    prv_call(idx, &f);
+}
+
+void net_dispatch_get_stats(net_dispatch_stats_t* stats) {
+    if (stats == NULL) return;
+    *stats = g_stats;
+}
+
+bool net_handler_get_stats(const char* name, net_handler_stats_t* stats) {
+    uint8_t i;
+
+    if (name == NULL || stats == NULL) return false;
+
+    for (i = 0; i < g_handler_count; i++) {
+        if (g_handlers[i].name != NULL && strcmp(g_handlers[i].name, name) == 0) {
+            *stats = g_handlers[i].stats;
+            return true;
+        }
+    }
+    return false;
+}
+
+void net_dispatch_print_stats(void) {
+    uint8_t i;
+
+    LOG_I(TAG, "Dispatch: frames=%lu vlan=%lu malformed=%lu unhandled=%lu",
+          (unsigned long)g_stats.frames,
+          (unsigned long)g_stats.vlan_frames,
+          (unsigned long)g_stats.malformed,
+          (unsigned long)g_stats.unhandled);
+
+    for (i = 0; i < g_handler_count; i++) {
+        const handler_entry_t* h = &g_handlers[i];
+        LOG_I(TAG, "  %-10s pkts=%lu bytes=%lu drops=%lu",
+              h->name ? h->name : "?",
+              (unsigned long)h->stats.packets,
+              (unsigned long)h->stats.bytes,
+              (unsigned long)h->stats.drops);
+    }
+}
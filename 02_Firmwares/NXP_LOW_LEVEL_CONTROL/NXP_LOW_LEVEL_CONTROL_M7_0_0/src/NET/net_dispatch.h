@@ -0,0 +1,168 @@
+/**
+ * \file            net_dispatch.h
+ * \brief           Table-driven protocol dispatch for the raw Ethernet path
+ *
+ * Every received frame is parsed once (Ethernet, optional 802.1Q tag, IPv4,
+ * UDP) into a net_frame_t which is then handed to the handler registered
+ * for its UDP port, IP protocol or EtherType - the most specific match wins.
+ * Handlers never re-parse headers, they work on the descriptor.
+ */
+
+#ifndef NET_DISPATCH_HDR_H
+#define NET_DISPATCH_HDR_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*===========================================================================*/
+/*                          CONFIGURATION                                     */
+/*===========================================================================*/
+
+#ifndef NET_MAX_HANDLERS
+#define NET_MAX_HANDLERS                16U     /*!< Registered handlers, all kinds */
+#endif
+
+#ifndef NET_ETHERTYPE_SLOTS
+#define NET_ETHERTYPE_SLOTS             16U     /*!< EtherType hash slots, power of two */
+#endif
+
+#ifndef NET_UDP_PORT_SLOTS
+#define NET_UDP_PORT_SLOTS              32U     /*!< UDP port hash slots, power of two */
+#endif
+
+/*===========================================================================*/
+/*                              CONSTANTS                                     */
+/*===========================================================================*/
+
+#define NET_ETH_HDR_LEN                 14U
+#define NET_VLAN_TAG_LEN                4U
+
+#define NET_ETHERTYPE_IPV4              0x0800U
+#define NET_ETHERTYPE_ARP               0x0806U
+#define NET_ETHERTYPE_VLAN              0x8100U
+
+#define NET_IP_PROTO_ICMP               1U
+#define NET_IP_PROTO_UDP                17U
+
+/*===========================================================================*/
+/*                              TYPES                                         */
+/*===========================================================================*/
+
+/**
+ * \brief           Parsed frame, shared by all handlers
+ * \note            Pointers point into the RX buffer. Layer fields are only
+ *                  valid if the matching has_* flag is set.
+ */
+typedef struct {
+    uint8_t* frame;             /*!< Start of the Ethernet frame */
+    uint16_t len;               /*!< Frame length as received */
+
+    /* Layer 2 */
+    const uint8_t* dst_mac;
+    const uint8_t* src_mac;
+    uint16_t ethertype;         /*!< Inner EtherType (after a VLAN tag) */
+    uint16_t vlan_tci;          /*!< 802.1Q TCI (PCP/DEI/VID) */
+    bool has_vlan;
+    uint8_t l2_len;             /*!< 14, or 18 with a VLAN tag */
+
+    /* Layer 3 (IPv4) */
+    uint8_t* l3;                /*!< IPv4 header (or L2 payload for other EtherTypes) */
+    uint16_t l3_len;            /*!< IPv4 total length (or L2 payload length) */
+    bool has_ip;
+    uint8_t ip_hdr_len;         /*!< IHL * 4 */
+    uint8_t ip_proto;
+    const uint8_t* src_ip;
+    const uint8_t* dst_ip;
+
+    /* Layer 4 */
+    uint8_t* l4;                /*!< Transport header (first fragment only) */
+    uint16_t l4_len;            /*!< IP payload length */
+    bool has_udp;
+    uint16_t src_port;
+    uint16_t dst_port;
+    uint8_t* payload;           /*!< UDP payload */
+    uint16_t payload_len;
+} net_frame_t;
+
+/**
+ * \brief           Protocol handler
+ * \param[in]       f: Parsed frame
+ * \return          true if the frame was used, false if it was dropped
+ *                  (counted in the handler's drop counter)
+ */
+typedef bool (*net_handler_t)(net_frame_t* f);
+
+/**
+ * \brief           Per-handler counters
+ */
+typedef struct {
+    uint32_t packets;           /*!< Frames handed to the handler */
+    uint32_t bytes;             /*!< Bytes of those frames */
+    uint32_t drops;             /*!< Frames the handler rejected */
+} net_handler_stats_t;
+
+/**
+ * \brief           Dispatcher counters
+ */
+typedef struct {
+    uint32_t frames;            /*!< Frames seen */
+    uint32_t vlan_frames;       /*!< Frames with an 802.1Q tag */
+    uint32_t malformed;         /*!< Truncated or inconsistent headers */
+    uint32_t unhandled;         /*!< No handler registered */
+} net_dispatch_stats_t;
+
+/*===========================================================================*/
+/*                          PUBLIC FUNCTIONS                                  */
+/*===========================================================================*/
+
+/**
+ * \brief           Clear all tables and counters
+ */
+void net_dispatch_init(void);
+
+/**
+ * \brief           Register a handler for an EtherType (non-IPv4 frames)
+ * \return          true on success, false if the type is taken or tables are full
+ */
+bool net_register_ethertype(uint16_t ethertype, const char* name, net_handler_t fn);
+
+/**
+ * \brief           Register a handler for an IPv4 protocol number
+ */
+bool net_register_ip_proto(uint8_t proto, const char* name, net_handler_t fn);
+
+/**
+ * \brief           Register a handler for a UDP destination port
+ */
+bool net_register_udp_port(uint16_t port, const char* name, net_handler_t fn);
+
+/**
+ * \brief           Parse and dispatch one frame (eth_rx_handler_t)
+ */
+void net_dispatch(uint8_t* frame, uint16_t len);
+
+/**
+ * \brief           Get dispatcher counters
+ */
+void net_dispatch_get_stats(net_dispatch_stats_t* stats);
+
+/**
+ * \brief           Get the counters of a registered handler
+ * \return          false if no handler with that name exists
+ */
+bool net_handler_get_stats(const char* name, net_handler_stats_t* stats);
+
+/**
+ * \brief           Log dispatcher and per-handler counters
+ */
+void net_dispatch_print_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* NET_DISPATCH_HDR_H */
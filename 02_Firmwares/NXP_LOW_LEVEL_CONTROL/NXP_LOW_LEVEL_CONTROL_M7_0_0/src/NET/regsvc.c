@@ -0,0 +1,441 @@
+/**
+ * \file            regsvc.c
+ * \brief           UDP remote register access for the LAN9646
+ *
+ * A request is validated completely before the first op runs, so a
+ * malformed batch never executes half-way. Results are written straight
+ * into the reply's TX buffer; a copy of the reply payload is kept in the
+ * cache for retries.
+ */
+
+#include "regsvc.h"
+#include "eth_tx.h"
+#include "inet_csum.h"
+#include "lan9646_switch.h"
+#include <stddef.h>
+#include <string.h>
+
+#define UDP_HDRS_LEN                28U     /* IPv4 + UDP */
+#define REPLY_MAX                   1472U   /* 1500 MTU - IPv4 - UDP */
+#define ETH_MIN_FRAME               60U
+
+#define PAD4(n)                     (((n) + 3U) & ~3U)
+
+/*===========================================================================*/
+/*                              PRIVATE TYPES                                 */
+/*===========================================================================*/
+
+typedef struct {
+    bool valid;
+    uint8_t ip[4];
+    uint16_t port;
+    uint32_t req_id;
+    uint16_t len;
+    uint8_t data[REPLY_MAX];
+} cache_entry_t;
+
+/*===========================================================================*/
+/*                              PRIVATE DATA                                  */
+/*===========================================================================*/
+
+static lan9646_t* g_sw = NULL;
+static regsvc_snap_fn g_snap_fn = NULL;
+static uint8_t g_mac[6];
+static uint8_t g_allow_ip[4];
+static uint8_t g_allow_mask[4];
+static bool g_allow_set;            /* false until regsvc_allow() */
+static uint16_t g_ip_id;
+
+static cache_entry_t g_cache[REGSVC_CACHE_SLOTS];
+static uint8_t g_cache_next;
+
+static regsvc_stats_t g_stats;
+
+/*===========================================================================*/
+/*                          PRIVATE FUNCTIONS                                 */
+/*===========================================================================*/
+
+static inline void prv_wr16be(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t)(v >> 8);
+    p[1] = (uint8_t)v;
+}
+
+static bool prv_allowed(const uint8_t ip[4]) {
+    uint8_t i;
+
+    if (!g_allow_set) return false;
+    for (i = 0; i < 4U; i++) {
+        if ((ip[i] & g_allow_mask[i]) != g_allow_ip[i]) return false;
+    }
+    return true;
+}
+
+static cache_entry_t* prv_cache_find(const net_frame_t* f, uint32_t req_id) {
+    uint8_t i;
+
+    for (i = 0; i < REGSVC_CACHE_SLOTS; i++) {
+        cache_entry_t* c = &g_cache[i];
+        if (c->valid && c->req_id == req_id && c->port == f->src_port
+            && memcmp(c->ip, f->src_ip, 4) == 0) {
+            return c;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * \brief           Start a reply to the request in f
+ * \return          Reply payload pointer, NULL if no TX buffer is free
+ */
+static uint8_t* prv_reply_begin(const net_frame_t* f, uint8_t** frame) {
+    uint8_t* buf = eth_tx_alloc();
+
+    if (buf == NULL) {
+        g_stats.tx_drops++;
+        return NULL;
+    }
+
+    /* Same L2 header (VLAN tag included), addresses swapped */
+    memcpy(buf, f->frame, f->l2_len);
+    memcpy(&buf[0], f->src_mac, 6);
+    memcpy(&buf[6], g_mac, 6);
+
+    *frame = buf;
+    return &buf[f->l2_len + UDP_HDRS_LEN];
+}
+
+static void prv_reply_send(const net_frame_t* f, uint8_t* buf, uint16_t payload_len) {
+    uint8_t* ip = &buf[f->l2_len];
+    uint8_t* udp = &ip[20];
+    uint16_t len = (uint16_t)(f->l2_len + UDP_HDRS_LEN + payload_len);
+
+    memset(ip, 0, UDP_HDRS_LEN);
+    ip[0] = 0x45;                       /* Version 4, IHL 5, flags/fragment 0 */
+    prv_wr16be(&ip[2], (uint16_t)(UDP_HDRS_LEN + payload_len));
+    prv_wr16be(&ip[4], g_ip_id++);
+    ip[8] = 64;                         /* TTL */
+    ip[9] = NET_IP_PROTO_UDP;
+    memcpy(&ip[12], f->dst_ip, 4);
+    memcpy(&ip[16], f->src_ip, 4);
+#if !ETH_TX_CSUM_OFFLOAD
+    {
+        uint16_t csum = inet_csum(ip, 20);
+        memcpy(&ip[10], &csum, 2);
+    }
+#endif
+
+    prv_wr16be(&udp[0], REGSVC_UDP_PORT);
+    prv_wr16be(&udp[2], f->src_port);
+    prv_wr16be(&udp[4], (uint16_t)(8U + payload_len));
+
+    if (len < ETH_MIN_FRAME) {
+        memset(&buf[len], 0, ETH_MIN_FRAME - len);
+        len = ETH_MIN_FRAME;
+    }
+    if (eth_tx_send(buf, len) != ethtxOK) {
+        eth_tx_release(buf);
+        g_stats.tx_drops++;
+    }
+}
+
+/* Resend a cached reply */
+static void prv_reply_cached(const net_frame_t* f, const cache_entry_t* c) {
+    uint8_t* frame;
+    uint8_t* p = prv_reply_begin(f, &frame);
+
+    if (p == NULL) return;
+    memcpy(p, c->data, c->len);
+    prv_reply_send(f, frame, c->len);
+}
+
+/**
+ * \brief           Check every op before running any
+ * \return          true if the whole batch is well-formed
+ */
+static bool prv_validate(const uint8_t* p, uint16_t len, uint8_t count) {
+    uint16_t off = 0;
+    regsvc_op_t op;
+    uint8_t i;
+
+    for (i = 0; i < count; i++) {
+        if ((uint32_t)off + sizeof(op) > len) return false;
+        memcpy(&op, &p[off], sizeof(op));
+        off += sizeof(op);
+
+        switch (op.code) {
+            case REGSVC_OP_READ:
+            case REGSVC_OP_WRITE:
+            case REGSVC_OP_MODIFY:
+                if (op.size != 1U && op.size != 2U && op.size != 4U) return false;
+                break;
+            case REGSVC_OP_READ_BURST:
+                if (op.value == 0U || op.value > REGSVC_BURST_MAX) return false;
+                break;
+            case REGSVC_OP_WRITE_BURST:
+                if (op.value == 0U || op.value > REGSVC_BURST_MAX) return false;
+                if ((uint32_t)off + PAD4(op.value) > len) return false;
+                off += (uint16_t)PAD4(op.value);
+                break;
+            case REGSVC_OP_MIB:
+                if (op.size == 0U || op.size > REGSVC_MIB_MAX
+                    || op.value > 0xFFU || op.value + op.size > 0x100U) {
+                    return false;
+                }
+                break;
+            case REGSVC_OP_SNAPSHOT:
+                if (op.mask == 0U || op.mask > REGSVC_SNAP_CHUNK_MAX || op.value > 0xFFFFU) {
+                    return false;
+                }
+                break;
+            default:
+                return false;
+        }
+    }
+    return true;
+}
+
+static lan9646r_t prv_read(uint16_t addr, uint8_t size, uint32_t* val) {
+    lan9646r_t res;
+
+    *val = 0;
+    if (size == 1U) {
+        uint8_t v8 = 0;
+        res = lan9646_read_reg8(g_sw, addr, &v8);
+        *val = v8;
+    } else if (size == 2U) {
+        uint16_t v16 = 0;
+        res = lan9646_read_reg16(g_sw, addr, &v16);
+        *val = v16;
+    } else {
+        res = lan9646_read_reg32(g_sw, addr, val);
+    }
+    return res;
+}
+
+static lan9646r_t prv_write(uint16_t addr, uint8_t size, uint32_t val) {
+    if (size == 1U) return lan9646_write_reg8(g_sw, addr, (uint8_t)val);
+    if (size == 2U) return lan9646_write_reg16(g_sw, addr, (uint16_t)val);
+    return lan9646_write_reg32(g_sw, addr, val);
+}
+
+/**
+ * \brief           Copy a piece of the snapshot blob, capturing it at offset 0
+ * \return          Bytes copied
+ */
+static uint16_t prv_snapshot(const regsvc_op_t* op, uint8_t* out, lan9646r_t* res) {
+    const uint8_t* blob;
+    uint16_t len = 0;
+
+    if (g_snap_fn == NULL) {
+        *res = lan9646INVPARAM;
+        return 0U;
+    }
+
+    /* A retry of offset 0 is answered from the cache: no second capture */
+    blob = g_snap_fn(op->value == 0U, &len);
+    *res = (blob != NULL) ? lan9646OK : lan9646ERR;
+    if (blob == NULL || op->value >= len) return 0U;
+
+    len = (uint16_t)(len - op->value);
+    if (len > op->mask) {
+        len = (uint16_t)op->mask;
+    }
+    memcpy(out, &blob[op->value], len);
+    return len;
+}
+
+/**
+ * \brief           Run one op, write its result at out
+ * \return          Result data length
+ */
+static uint16_t prv_execute(const regsvc_op_t* op, const uint8_t* wdata,
+                            uint8_t* out, lan9646r_t* res) {
+    uint32_t val = 0;
+    uint8_t i;
+
+    switch (op->code) {
+        case REGSVC_OP_READ:
+            *res = prv_read(op->addr, op->size, &val);
+            memcpy(out, &val, 4);
+            return 4U;
+
+        case REGSVC_OP_WRITE:
+            *res = prv_write(op->addr, op->size, op->value);
+            return 0U;
+
+        case REGSVC_OP_MODIFY:
+            *res = prv_read(op->addr, op->size, &val);
+            if (*res == lan9646OK) {
+                *res = prv_write(op->addr, op->size, (val & ~op->mask) | (op->value & op->mask));
+            }
+            memcpy(out, &val, 4);
+            return 4U;
+
+        case REGSVC_OP_READ_BURST:
+            *res = lan9646_read_burst(g_sw, op->addr, out, (uint16_t)op->value);
+            return (uint16_t)op->value;
+
+        case REGSVC_OP_WRITE_BURST:
+            *res = lan9646_write_burst(g_sw, op->addr, wdata, (uint16_t)op->value);
+            return 0U;
+
+        case REGSVC_OP_MIB:
+            *res = lan9646OK;
+            for (i = 0; i < op->size; i++) {
+                lan9646r_t r = lan9646_switch_read_mib_counter(g_sw, (uint8_t)op->addr,
+                                                               (uint8_t)(op->value + i), &val);
+                if (r != lan9646OK) {
+                    *res = r;
+                }
+                memcpy(&out[(uint16_t)i * 4U], &val, 4);
+            }
+            return (uint16_t)(op->size * 4U);
+
+        case REGSVC_OP_SNAPSHOT:
+            return prv_snapshot(op, out, res);
+
+        default:
+            *res = lan9646INVPARAM;
+            return 0U;
+    }
+}
+
+/* Result bytes an op adds to the reply (header included) */
+static uint16_t prv_result_size(const regsvc_op_t* op) {
+    switch (op->code) {
+        case REGSVC_OP_READ:
+        case REGSVC_OP_MODIFY:      return sizeof(regsvc_res_t) + 4U;
+        case REGSVC_OP_READ_BURST:  return (uint16_t)(sizeof(regsvc_res_t) + PAD4(op->value));
+        case REGSVC_OP_MIB:         return (uint16_t)(sizeof(regsvc_res_t) + op->size * 4U);
+        case REGSVC_OP_SNAPSHOT:    return (uint16_t)(sizeof(regsvc_res_t) + PAD4(op->mask));
+        default:                    return sizeof(regsvc_res_t);
+    }
+}
+
+/*===========================================================================*/
+/*                          PUBLIC FUNCTIONS                                  */
+/*===========================================================================*/
+
+void regsvc_init(lan9646_t* sw, const uint8_t our_mac[6]) {
+    g_sw = sw;
+    memcpy(g_mac, our_mac, 6);
+    memset(g_cache, 0, sizeof(g_cache));
+    g_cache_next = 0;
+    memset(&g_stats, 0, sizeof(g_stats));
+    g_allow_set = false;
+}
+
+void regsvc_allow(const uint8_t ip[4], const uint8_t mask[4]) {
+    uint8_t i;
+
+    for (i = 0; i < 4U; i++) {
+        g_allow_mask[i] = mask[i];
+        g_allow_ip[i] = (uint8_t)(ip[i] & mask[i]);
+    }
+    g_allow_set = true;
+}
+
+void regsvc_set_snapshot(regsvc_snap_fn fn) {
+    g_snap_fn = fn;
+}
+
+bool regsvc_input(net_frame_t* f) {
+    regsvc_hdr_t req;
+    regsvc_hdr_t rep;
+    regsvc_op_t op;
+    cache_entry_t* c;
+    const uint8_t* ops;
+    uint8_t* frame;
+    uint8_t* out;
+    uint16_t in_off = 0;
+    uint16_t out_off = sizeof(regsvc_hdr_t);
+    uint16_t ops_len;
+    uint8_t i;
+
+    if (g_sw == NULL || f->payload_len < sizeof(req)) return false;
+    if (!prv_allowed(f->src_ip)) {
+        g_stats.denied++;
+        return false;
+    }
+
+    memcpy(&req, f->payload, sizeof(req));
+    if (req.magic != REGSVC_MAGIC || req.version != REGSVC_VERSION) {
+        g_stats.bad++;
+        return false;
+    }
+
+    /* Retry of an answered request: same reply, nothing executed */
+    c = prv_cache_find(f, req.req_id);
+    if (c != NULL) {
+        g_stats.retries++;
+        prv_reply_cached(f, c);
+        return true;
+    }
+
+    out = prv_reply_begin(f, &frame);
+    if (out == NULL) return true;       /* Client retries */
+
+    ops = &f->payload[sizeof(req)];
+    ops_len = (uint16_t)(f->payload_len - sizeof(req));
+
+    rep = req;
+    rep.count = 0;
+    rep.status = REGSVC_OK;
+    memset(rep.reserved, 0, sizeof(rep.reserved));
+
+    if (!prv_validate(ops, ops_len, req.count)) {
+        g_stats.bad++;
+        rep.status = REGSVC_BADREQ;
+    } else {
+        for (i = 0; i < req.count; i++) {
+            regsvc_res_t r;
+            lan9646r_t res = lan9646OK;
+            const uint8_t* wdata;
+
+            memcpy(&op, &ops[in_off], sizeof(op));
+            in_off += sizeof(op);
+            wdata = &ops[in_off];
+            if (op.code == REGSVC_OP_WRITE_BURST) {
+                in_off += (uint16_t)PAD4(op.value);
+            }
+
+            if ((uint32_t)out_off + prv_result_size(&op) > REPLY_MAX) {
+                rep.status = REGSVC_TRUNC;
+                break;
+            }
+
+            r.code = op.code;
+            r.len = prv_execute(&op, wdata, &out[out_off + sizeof(r)], &res);
+            r.status = (uint8_t)res;
+            memcpy(&out[out_off], &r, sizeof(r));
+            memset(&out[out_off + sizeof(r) + r.len], 0, PAD4(r.len) - r.len);
+            out_off += (uint16_t)(sizeof(r) + PAD4(r.len));
+
+            rep.count++;
+            g_stats.ops++;
+            if (res != lan9646OK) {
+                g_stats.op_errors++;
+            }
+        }
+        g_stats.requests++;
+    }
+    memcpy(out, &rep, sizeof(rep));
+
+    /* Keep the reply for retries (round-robin replacement) */
+    c = &g_cache[g_cache_next];
+    g_cache_next = (uint8_t)((g_cache_next + 1U) % REGSVC_CACHE_SLOTS);
+    c->valid = true;
+    memcpy(c->ip, f->src_ip, 4);
+    c->port = f->src_port;
+    c->req_id = req.req_id;
+    c->len = out_off;
+    memcpy(c->data, out, out_off);
+
+    prv_reply_send(f, frame, out_off);
+    return true;
+}
+
+void regsvc_get_stats(regsvc_stats_t* stats) {
+    if (stats == NULL) return;
+    *stats = g_stats;
+}
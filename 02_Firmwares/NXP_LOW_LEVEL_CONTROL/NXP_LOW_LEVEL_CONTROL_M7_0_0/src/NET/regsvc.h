@@ -0,0 +1,184 @@
+/**
+ * \file            regsvc.h
+ * \brief           UDP remote register access for the LAN9646
+ *
+ * One request datagram carries a batch of operations; they are run in
+ * order through the lan9646_t driver and all results come back in a
+ * single reply. Every request has an ID chosen by the client. A retry with
+ * the same ID from the same client is answered from a small reply cache
+ * without running the operations again, so lost replies never repeat
+ * writes or read-clear MIB reads.
+ *
+ * Wire format (little-endian, 4-byte aligned):
+ *
+ *      request:  regsvc_hdr_t, regsvc_op_t ops[count]
+ *                (REGSVC_OP_WRITE_BURST: op.value data bytes follow the op,
+ *                 padded to 4)
+ *      reply:    regsvc_hdr_t (count = ops executed), then per op
+ *                regsvc_res_t followed by res.len data bytes, padded to 4
+ *
+ * If the results do not fit in one datagram the reply stops at the last
+ * op that fits and has status REGSVC_TRUNC; the client sends the rest
+ * in a new request.
+ *
+ * \note            Operations run from the RX handler and block the main
+ *                  loop on the switch bus. At 100 kHz I2C one access costs
+ *                  about 0.5 ms (8-bit) to 0.75 ms (32-bit), a MODIFY
+ *                  1.4 ms, a MIB counter 1.8 ms and a 256-byte burst
+ *                  23 ms. A full request blocks for up to about 170 ms
+ *                  (121 MODIFY ops), 120 ms (5 bursts) or 620 ms
+ *                  (11 MIB ops of 32 counters); RX frames queue in the DMA
+ *                  ring meanwhile. Figures from tests/test_regsvc.c.
+ */
+
+#ifndef REGSVC_HDR_H
+#define REGSVC_HDR_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "lan9646.h"
+#include "net_dispatch.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*===========================================================================*/
+/*                          CONFIGURATION                                     */
+/*===========================================================================*/
+
+#define REGSVC_UDP_PORT                 5002U   /*!< Service port */
+#define REGSVC_MAGIC                    0x5252U /*!< "RR" */
+#define REGSVC_VERSION                  1U
+
+#ifndef REGSVC_CACHE_SLOTS
+#define REGSVC_CACHE_SLOTS              2U      /*!< Replies kept for retries */
+#endif
+
+#define REGSVC_BURST_MAX                256U    /*!< Max bytes per burst op */
+#define REGSVC_MIB_MAX                  32U     /*!< Max counters per MIB op */
+#define REGSVC_SNAP_CHUNK_MAX           1440U   /*!< Max snapshot bytes per op */
+
+/*===========================================================================*/
+/*                              TYPES                                         */
+/*===========================================================================*/
+
+/**
+ * \brief           Operation codes
+ */
+typedef enum {
+    REGSVC_OP_READ = 1,         /*!< size = 1/2/4, result: 4-byte value */
+    REGSVC_OP_WRITE = 2,        /*!< size = 1/2/4, value */
+    REGSVC_OP_MODIFY = 3,       /*!< size = 1/2/4, reg = (reg & ~mask) | (value & mask),
+                                     result: 4-byte previous value */
+    REGSVC_OP_READ_BURST = 4,   /*!< value = length, result: the bytes */
+    REGSVC_OP_WRITE_BURST = 5,  /*!< value = length, data follows the op */
+    REGSVC_OP_MIB = 6,          /*!< addr = port, value = first index, size = count,
+                                     result: count 4-byte counters (read-clear) */
+    REGSVC_OP_SNAPSHOT = 7,     /*!< value = offset, mask = max length; offset 0 captures
+                                     a new snapshot, result: blob bytes from offset
+                                     (lan9646_snap.h), none past its end */
+} regsvc_opcode_t;
+
+/**
+ * \brief           Reply status (regsvc_hdr_t.status)
+ */
+typedef enum {
+    REGSVC_OK = 0,              /*!< All ops executed */
+    REGSVC_TRUNC,               /*!< Reply full, only count ops executed */
+    REGSVC_BADREQ,              /*!< Malformed request, nothing executed */
+} regsvc_status_t;
+
+/**
+ * \brief           Request/reply header (12 bytes)
+ */
+typedef struct {
+    uint16_t magic;             /*!< REGSVC_MAGIC */
+    uint8_t version;            /*!< REGSVC_VERSION */
+    uint8_t count;              /*!< Ops in the request / executed in the reply */
+    uint32_t req_id;            /*!< Chosen by the client, echoed back */
+    uint8_t status;             /*!< Reply: regsvc_status_t, request: 0 */
+    uint8_t reserved[3];
+} regsvc_hdr_t;
+
+/**
+ * \brief           Operation (12 bytes)
+ */
+typedef struct {
+    uint8_t code;               /*!< regsvc_opcode_t */
+    uint8_t size;               /*!< Register width or MIB counter count */
+    uint16_t addr;              /*!< Register address or port */
+    uint32_t value;
+    uint32_t mask;
+} regsvc_op_t;
+
+/**
+ * \brief           Per-op result header (4 bytes)
+ */
+typedef struct {
+    uint8_t code;               /*!< Op code echoed */
+    uint8_t status;             /*!< lan9646r_t */
+    uint16_t len;               /*!< Data bytes following (before padding) */
+} regsvc_res_t;
+
+/**
+ * \brief           Snapshot source
+ * \param[in]       capture: Take a new snapshot, else return the last one
+ * \param[out]      len: Blob length
+ * \return          Blob, NULL if none
+ */
+typedef const uint8_t* (*regsvc_snap_fn)(bool capture, uint16_t* len);
+
+/**
+ * \brief           Service statistics
+ */
+typedef struct {
+    uint32_t requests;          /*!< Requests executed */
+    uint32_t retries;           /*!< Requests answered from the cache */
+    uint32_t ops;               /*!< Ops executed */
+    uint32_t op_errors;         /*!< Ops with a driver error */
+    uint32_t bad;               /*!< Malformed requests */
+    uint32_t denied;            /*!< Requests from a source not allowed */
+    uint32_t tx_drops;          /*!< Replies not sent (no buffer) */
+} regsvc_stats_t;
+
+/*===========================================================================*/
+/*                          PUBLIC FUNCTIONS                                  */
+/*===========================================================================*/
+
+/**
+ * \brief           Initialize the service
+ * \param[in]       sw: Switch handle used for all operations
+ * \param[in]       our_mac: Our MAC address (reply source)
+ */
+void regsvc_init(lan9646_t* sw, const uint8_t our_mac[6]);
+
+/**
+ * \brief           Allow requests from the sources in ip/mask
+ * \param[in]       ip: Client address or network
+ * \param[in]       mask: 255.255.255.255 for a single host, 0.0.0.0 for any
+ * \note            After regsvc_init() no source is allowed. Requests from
+ *                  other sources are dropped without a reply.
+ */
+void regsvc_allow(const uint8_t ip[4], const uint8_t mask[4]);
+
+/**
+ * \brief           Set the source of REGSVC_OP_SNAPSHOT, NULL to refuse the op
+ */
+void regsvc_set_snapshot(regsvc_snap_fn fn);
+
+/**
+ * \brief           UDP handler (register for REGSVC_UDP_PORT)
+ */
+bool regsvc_input(net_frame_t* f);
+
+/**
+ * \brief           Get service statistics
+ */
+void regsvc_get_stats(regsvc_stats_t* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* REGSVC_HDR_H */
@@ -0,0 +1,165 @@
+/**
+ * \file            telemetry.h
+ * \brief           Batched binary UDP telemetry publisher
+ *
+ * Registered sources are sampled at a fixed rate (up to TLM_MAX_RATE_HZ)
+ * and append fixed-size records straight into a DMA-safe TX buffer. A
+ * datagram is sent when it is full or its oldest record is TLM_FLUSH_US
+ * old, so the per-record cost is a few stores.
+ *
+ * Datagram payload (little-endian):
+ *
+ *      tlm_hdr_t   header
+ *      tlm_rec_t   records[count]
+ *
+ * Records are numbered consecutively (first_rec + index), so a collector
+ * can detect lost records as well as lost datagrams.
+ */
+
+#ifndef TELEMETRY_HDR_H
+#define TELEMETRY_HDR_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*===========================================================================*/
+/*                          CONFIGURATION                                     */
+/*===========================================================================*/
+
+#define TLM_UDP_PORT                    5001U   /*!< Default collector port */
+#define TLM_MAX_RATE_HZ                 10000U  /*!< Upper sampling rate limit */
+
+#ifndef TLM_FLUSH_US
+#define TLM_FLUSH_US                    20000U  /*!< Max age of a buffered record */
+#endif
+
+#ifndef TLM_MAX_SOURCES
+#define TLM_MAX_SOURCES                 8U
+#endif
+
+#define TLM_MAGIC                       0x544CU /*!< "TL" */
+#define TLM_VERSION                     1U
+#define TLM_REC_VALUES                  6U
+
+/*===========================================================================*/
+/*                              TYPES                                         */
+/*===========================================================================*/
+
+/**
+ * \brief           Record types
+ */
+typedef enum {
+    TLM_REC_GMAC_RX = 1,        /*!< frames, err_frames, rbu, fifo_ovf, held, max_burst */
+    TLM_REC_GMAC_TX = 2,        /*!< queued, completed, tx_errors, would_block, max_inflight, free */
+    TLM_REC_LOOP = 3,           /*!< loops, avg_us, max_us, jobs_run, - , - */
+    TLM_REC_NET = 4,            /*!< frames, vlan, malformed, unhandled, arp_hits, arp_misses */
+    TLM_REC_PORT = 5,           /*!< rx_pps, tx_pps, rx_bps, tx_bps, rx_crc_err, drops (source = port) */
+} tlm_rec_type_t;
+
+/**
+ * \brief           Datagram header (16 bytes)
+ */
+typedef struct {
+    uint16_t magic;             /*!< TLM_MAGIC */
+    uint8_t version;            /*!< TLM_VERSION */
+    uint8_t count;              /*!< Records in this datagram */
+    uint32_t seq;               /*!< Datagram sequence number */
+    uint32_t first_rec;         /*!< Sequence number of the first record */
+    uint32_t lost;              /*!< Records dropped on the device so far */
+} tlm_hdr_t;
+
+/**
+ * \brief           Record (32 bytes)
+ */
+typedef struct {
+    uint16_t type;              /*!< tlm_rec_type_t */
+    uint16_t source;            /*!< Instance (port, ring, ...) */
+    uint32_t t_us;              /*!< Sample time, sys_timer_now_us() */
+    uint32_t v[TLM_REC_VALUES]; /*!< Values, meaning depends on type */
+} tlm_rec_t;
+
+/**
+ * \brief           Sampling callback, appends records with tlm_record()
+ */
+typedef void (*tlm_source_fn)(void* arg);
+
+/**
+ * \brief           Publisher statistics
+ */
+typedef struct {
+    uint32_t samples;           /*!< Sampling rounds */
+    uint32_t records;           /*!< Records written */
+    uint32_t datagrams;         /*!< Datagrams handed to ARP/TX */
+    uint32_t lost;              /*!< Records dropped (no TX buffer, send failed) */
+    uint32_t late;              /*!< Sampling rounds skipped because the loop was late */
+} tlm_stats_t;
+
+/*===========================================================================*/
+/*                          PUBLIC FUNCTIONS                                  */
+/*===========================================================================*/
+
+/**
+ * \brief           Initialize the publisher (rate 0 = stopped)
+ * \param[in]       src_mac: Our MAC address
+ * \param[in]       src_ip: Our IPv4 address
+ * \param[in]       dst_ip: Collector address (unicast, resolved by ARP)
+ * \param[in]       port: Collector UDP port (also used as source port)
+ * \note            Call after eth_tx_init(). Takes two TX pool buffers for
+ *                  good; addresses and port are fixed by the first call.
+ */
+void tlm_init(const uint8_t src_mac[6], const uint8_t src_ip[4],
+              const uint8_t dst_ip[4], uint16_t port);
+
+/**
+ * \brief           Set the sampling rate
+ * \param[in]       hz: Sampling rounds per second, 0 stops sampling
+ * \return          false if hz exceeds TLM_MAX_RATE_HZ
+ */
+bool tlm_set_rate_hz(uint32_t hz);
+
+/**
+ * \brief           Register a sampling callback
+ */
+bool tlm_add_source(tlm_source_fn fn, void* arg);
+
+/**
+ * \brief           Append one record to the current datagram
+ * \param[in]       type: Record type
+ * \param[in]       source: Instance
+ * \param[in]       values: Up to TLM_REC_VALUES values, missing ones are 0
+ * \param[in]       n: Number of values
+ * \return          false if the record was dropped
+ */
+bool tlm_record(uint16_t type, uint16_t source, const uint32_t* values, uint8_t n);
+
+/**
+ * \brief           Sample if due and send a full or aged datagram
+ * \note            Call from the main loop on every pass
+ */
+void tlm_poll(void);
+
+/**
+ * \brief           Check if the main loop must not sleep for the next sample
+ * \return          true if a sample is due or the rate exceeds the 1 ms tick
+ */
+bool tlm_pending(void);
+
+/**
+ * \brief           Send the current datagram now (if it holds records)
+ */
+void tlm_flush(void);
+
+/**
+ * \brief           Get publisher statistics
+ */
+void tlm_get_stats(tlm_stats_t* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TELEMETRY_HDR_H */
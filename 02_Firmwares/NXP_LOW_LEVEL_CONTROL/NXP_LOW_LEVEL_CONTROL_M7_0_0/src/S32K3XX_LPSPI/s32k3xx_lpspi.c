@@ -0,0 +1,368 @@
+/**
+ * \file            s32k3xx_lpspi.c
+ * \brief           LPSPI master with eDMA bursts for S32K3XX
+ */
+
+#include "s32k3xx_lpspi.h"
+#include <string.h>
+
+/* 8-bit frames; PCS held from header to the end of the payload */
+#define LPSPI_FRAME_BITS            8U
+
+/* DMAMUX channel configuration registers are byte-reversed within each word */
+#define LPSPI_DMAMUX_IDX(ch)        (((ch) & 15U) ^ 3U)
+
+/*===========================================================================*/
+/*                              PRIVATE DATA                                  */
+/*===========================================================================*/
+
+/* eDMA reads and writes memory behind the D-cache: bounce through SRAM that is not cached */
+static uint8_t g_tx_buf[LPSPI_DMA_BUF_SIZE] __attribute__((section(".mcal_bss_no_cacheable"), aligned(4)));
+static uint8_t g_rx_buf[LPSPI_DMA_BUF_SIZE] __attribute__((section(".mcal_bss_no_cacheable"), aligned(4)));
+static uint8_t g_zero __attribute__((section(".mcal_bss_no_cacheable")));
+
+/*===========================================================================*/
+/*                          PRIVATE FUNCTIONS                                 */
+/*===========================================================================*/
+
+static uint32_t prv_tcr(const lpspi_t* handle) {
+    uint32_t tcr = LPSPI_TCR_FRAMESZ(LPSPI_FRAME_BITS - 1U) | LPSPI_TCR_PCS(handle->cfg.pcs)
+                   | LPSPI_TCR_PRESCALE(handle->prescale);
+
+    if (handle->cfg.cpol) tcr |= LPSPI_TCR_CPOL_MASK;
+    if (handle->cfg.cpha) tcr |= LPSPI_TCR_CPHA_MASK;
+    return tcr;
+}
+
+static uint32_t prv_tx_count(const LPSPI_Type* base) {
+    return (base->FSR & LPSPI_FSR_TXCOUNT_MASK) >> LPSPI_FSR_TXCOUNT_SHIFT;
+}
+
+static uint32_t prv_rx_count(const LPSPI_Type* base) {
+    return (base->FSR & LPSPI_FSR_RXCOUNT_MASK) >> LPSPI_FSR_RXCOUNT_SHIFT;
+}
+
+/**
+ * \brief           Queue a data or command word once the TX FIFO has room
+ */
+static lpspir_t prv_push(lpspi_t* handle, volatile uint32_t* reg, uint32_t word) {
+    LPSPI_Type* base = handle->cfg.base;
+    uint32_t depth = 1UL << (base->PARAM & LPSPI_PARAM_TXFIFO_MASK);
+    uint32_t tries = 0;
+
+    while (prv_tx_count(base) >= depth) {
+        if (++tries > LPSPI_TIMEOUT_CNT) {
+            handle->stats.timeouts++;
+            return lpspiTIMEOUT;
+        }
+    }
+    *reg = word;
+    return lpspiOK;
+}
+
+/**
+ * \brief           Calculate prescaler and SCK divider for the wanted rate
+ */
+static bool prv_sck(uint32_t src, uint32_t want, uint8_t* prescale, uint8_t* div,
+                    uint32_t* actual) {
+    uint32_t clk, d;
+    uint8_t p;
+
+    if (src == 0 || want == 0) return false;
+
+    for (p = 0; p < 8U; p++) {
+        clk = src >> p;
+        d = (clk + want - 1U) / want;       /* Round the rate down */
+        if (d < 2U) d = 2U;
+        if (d - 2U <= 0xFFU) {
+            *prescale = p;
+            *div = (uint8_t)(d - 2U);
+            *actual = clk / d;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void prv_dma_mux(uint8_t ch, uint8_t src) {
+    DMAMUX_Type* mux = (ch < 16U) ? IP_DMAMUX_0 : IP_DMAMUX_1;
+
+    mux->CHCFG[LPSPI_DMAMUX_IDX(ch)] = 0;
+    mux->CHCFG[LPSPI_DMAMUX_IDX(ch)] = DMAMUX_CHCFG_ENBL_MASK | DMAMUX_CHCFG_SOURCE(src);
+}
+
+/**
+ * \brief           Program a byte-wide channel for count requests
+ */
+static void prv_dma_setup(uint8_t ch, uint32_t saddr, int16_t soff, uint32_t daddr,
+                          int16_t doff, uint16_t count, bool irq) {
+    IP_TCD->TCD[ch].CH_CSR = DMA_TCD_CH_CSR_DONE_MASK;
+    IP_TCD->TCD[ch].CH_ES = DMA_TCD_CH_ES_ERR_MASK;
+    IP_TCD->TCD[ch].CH_INT = DMA_TCD_CH_INT_INT_MASK;
+
+    IP_TCD->TCD[ch].TCD_SADDR = saddr;
+    IP_TCD->TCD[ch].TCD_SOFF = (uint16_t)soff;
+    IP_TCD->TCD[ch].TCD_ATTR = DMA_TCD_TCD_ATTR_SSIZE(0) | DMA_TCD_TCD_ATTR_DSIZE(0);
+    IP_TCD->TCD[ch].TCD_NBYTES_MLOFFNO = 1U;
+    IP_TCD->TCD[ch].TCD_SLAST_SDA = 0;
+    IP_TCD->TCD[ch].TCD_DADDR = daddr;
+    IP_TCD->TCD[ch].TCD_DOFF = (uint16_t)doff;
+    IP_TCD->TCD[ch].TCD_CITER_ELINKNO = count;
+    IP_TCD->TCD[ch].TCD_DLAST_SGA = 0;
+    /* Requests stop by themselves after the last byte */
+    IP_TCD->TCD[ch].TCD_CSR = DMA_TCD_TCD_CSR_DREQ_MASK | (irq ? DMA_TCD_TCD_CSR_INTMAJOR_MASK : 0U);
+    IP_TCD->TCD[ch].TCD_BITER_ELINKNO = count;
+}
+
+static void prv_dma_start(uint8_t ch) {
+    IP_TCD->TCD[ch].CH_CSR = DMA_TCD_CH_CSR_ERQ_MASK;
+}
+
+static void prv_dma_stop(uint8_t ch) {
+    IP_TCD->TCD[ch].CH_CSR = DMA_TCD_CH_CSR_DONE_MASK;
+    IP_TCD->TCD[ch].CH_INT = DMA_TCD_CH_INT_INT_MASK;
+}
+
+static bool prv_dma_done(uint8_t ch) {
+    return (IP_TCD->TCD[ch].CH_CSR & DMA_TCD_CH_CSR_DONE_MASK) != 0;
+}
+
+static bool prv_dma_error(uint8_t ch) {
+    return (IP_TCD->TCD[ch].CH_ES & DMA_TCD_CH_ES_ERR_MASK) != 0;
+}
+
+/**
+ * \brief           Move a short payload with the CPU
+ */
+static lpspir_t prv_pio(lpspi_t* handle, const uint8_t* tx, uint8_t* rx, uint16_t len) {
+    LPSPI_Type* base = handle->cfg.base;
+    uint32_t tries = 0;
+    uint16_t sent = 0, recv = 0;
+    lpspir_t res;
+
+    while (sent < len || (rx != NULL && recv < len)) {
+        if (sent < len) {
+            res = prv_push(handle, &base->TDR, tx != NULL ? tx[sent] : 0U);
+            if (res != lpspiOK) return res;
+            sent++;
+        }
+        if (rx != NULL) {
+            while (recv < len && prv_rx_count(base) > 0) {
+                rx[recv++] = (uint8_t)base->RDR;
+                tries = 0;
+            }
+            if (sent == len && recv < len && ++tries > LPSPI_TIMEOUT_CNT) {
+                handle->stats.timeouts++;
+                return lpspiTIMEOUT;
+            }
+        }
+    }
+    return lpspiOK;
+}
+
+/**
+ * \brief           Release PCS, collect DMA data and report
+ */
+static void prv_finish(lpspi_t* handle, lpspir_t res) {
+    LPSPI_Type* base = handle->cfg.base;
+    lpspi_done_fn done = handle->done;
+    uint32_t tries = 0;
+
+    /* A command without CONT ends the frame */
+    if (prv_push(handle, &base->TCR, prv_tcr(handle)) != lpspiOK && res == lpspiOK) {
+        res = lpspiTIMEOUT;
+    }
+    while ((base->SR & LPSPI_SR_MBF_MASK) && ++tries < LPSPI_TIMEOUT_CNT) {
+    }
+
+    if (handle->dma) {
+        base->DER = 0;
+        prv_dma_stop(handle->cfg.dma_tx_ch);
+        prv_dma_stop(handle->cfg.dma_rx_ch);
+        if (res == lpspiOK && handle->rx != NULL) {
+            memcpy(handle->rx, g_rx_buf, handle->len);
+        }
+    }
+
+    if (res == lpspiOK) {
+        handle->stats.frames++;
+        handle->stats.bytes += handle->len;
+        if (handle->dma) handle->stats.dma_frames++;
+    }
+
+    handle->busy = 0;
+    if (done != NULL) {
+        done(res, handle->arg);
+    }
+}
+
+/*===========================================================================*/
+/*                              API FUNCTIONS                                 */
+/*===========================================================================*/
+
+lpspir_t lpspi_init(lpspi_t* handle, const lpspi_cfg_t* cfg) {
+    LPSPI_Type* base;
+    uint8_t prescale, div;
+    uint32_t actual;
+
+    if (handle == NULL || cfg == NULL || cfg->base == NULL || cfg->pcs > 3U
+        || cfg->dma_tx_ch >= 32U || cfg->dma_rx_ch >= 32U || cfg->dma_tx_ch == cfg->dma_rx_ch
+        || cfg->dma_min_len > LPSPI_DMA_BUF_SIZE) {
+        return lpspiINVPARAM;
+    }
+    if (!prv_sck(cfg->src_clk_hz, cfg->sck_hz, &prescale, &div, &actual)) return lpspiINVPARAM;
+
+    memset(handle, 0, sizeof(*handle));
+    handle->cfg = *cfg;
+    handle->sck_hz = actual;
+    handle->prescale = prescale;
+    base = cfg->base;
+
+    base->CR = LPSPI_CR_RST_MASK;
+    base->CR = 0;
+    base->CFGR1 = LPSPI_CFGR1_MASTER_MASK;
+    /* Half a clock from PCS to SCK and back, one clock between frames */
+    base->CCR = LPSPI_CCR_SCKDIV(div) | LPSPI_CCR_DBT(div) | LPSPI_CCR_PCSSCK(div / 2U)
+                | LPSPI_CCR_SCKPCS(div / 2U);
+    base->FCR = LPSPI_FCR_TXWATER(0) | LPSPI_FCR_RXWATER(0);
+    base->DER = 0;
+    base->CR = LPSPI_CR_MEN_MASK;
+    base->TCR = prv_tcr(handle);
+
+    if (cfg->dma_min_len > 0) {
+        prv_dma_mux(cfg->dma_tx_ch, cfg->dmamux_tx_src);
+        prv_dma_mux(cfg->dma_rx_ch, cfg->dmamux_rx_src);
+        prv_dma_stop(cfg->dma_tx_ch);
+        prv_dma_stop(cfg->dma_rx_ch);
+    }
+
+    handle->is_init = 1;
+    return lpspiOK;
+}
+
+lpspir_t lpspi_xfer_async(lpspi_t* handle, const uint8_t* hdr, uint8_t hdr_len,
+                          const uint8_t* tx, uint8_t* rx, uint16_t len,
+                          lpspi_done_fn done, void* arg) {
+    LPSPI_Type* base;
+    uint32_t tcr;
+    lpspir_t res = lpspiOK;
+    uint8_t i;
+
+    if (handle == NULL || !handle->is_init || hdr_len > LPSPI_HDR_MAX
+        || (hdr == NULL && hdr_len > 0)) {
+        return lpspiINVPARAM;
+    }
+    if (handle->busy) return lpspiBUSY;
+
+    base = handle->cfg.base;
+    handle->busy = 1;
+    handle->dma = handle->cfg.dma_min_len > 0 && len >= handle->cfg.dma_min_len
+                  && len <= LPSPI_DMA_BUF_SIZE;
+    handle->rx = rx;
+    handle->len = len;
+    handle->done = done;
+    handle->arg = arg;
+
+    base->CR |= LPSPI_CR_RTF_MASK | LPSPI_CR_RRF_MASK;
+    base->SR = LPSPI_SR_TCF_MASK | LPSPI_SR_FCF_MASK | LPSPI_SR_WCF_MASK
+               | LPSPI_SR_TEF_MASK | LPSPI_SR_REF_MASK;
+
+    tcr = prv_tcr(handle) | LPSPI_TCR_CONT_MASK;
+
+    /* Header: receiver masked, nothing to drain */
+    if (hdr_len > 0) {
+        res = prv_push(handle, &base->TCR, tcr | LPSPI_TCR_RXMSK_MASK);
+        for (i = 0; i < hdr_len && res == lpspiOK; i++) {
+            res = prv_push(handle, &base->TDR, hdr[i]);
+        }
+        tcr |= LPSPI_TCR_CONTC_MASK;
+    }
+
+    /* Payload continues the same frame */
+    if (res == lpspiOK) {
+        res = prv_push(handle, &base->TCR, tcr | (rx == NULL ? LPSPI_TCR_RXMSK_MASK : 0U));
+    }
+    if (res != lpspiOK || len == 0) {
+        prv_finish(handle, res);
+        return res;
+    }
+
+    if (!handle->dma) {
+        res = prv_pio(handle, tx, rx, len);
+        if (res != lpspiOK) {
+            prv_finish(handle, res);
+        }
+        return res;
+    }
+
+    if (tx != NULL) {
+        memcpy(g_tx_buf, tx, len);
+    }
+    if (rx != NULL) {
+        prv_dma_setup(handle->cfg.dma_rx_ch, (uint32_t)&base->RDR, 0, (uint32_t)g_rx_buf, 1,
+                      len, true);
+        prv_dma_start(handle->cfg.dma_rx_ch);
+    }
+    prv_dma_setup(handle->cfg.dma_tx_ch, tx != NULL ? (uint32_t)g_tx_buf : (uint32_t)&g_zero,
+                  tx != NULL ? 1 : 0, (uint32_t)&base->TDR, 0, len, rx == NULL);
+    prv_dma_start(handle->cfg.dma_tx_ch);
+    base->DER = LPSPI_DER_TDDE_MASK | (rx != NULL ? LPSPI_DER_RDDE_MASK : 0U);
+    return lpspiOK;
+}
+
+lpspir_t lpspi_xfer(lpspi_t* handle, const uint8_t* hdr, uint8_t hdr_len,
+                    const uint8_t* tx, uint8_t* rx, uint16_t len) {
+    uint32_t tries = 0;
+    lpspir_t res;
+
+    res = lpspi_xfer_async(handle, hdr, hdr_len, tx, rx, len, NULL, NULL);
+    if (res != lpspiOK) return res;
+
+    while (lpspi_poll(handle)) {
+        if (++tries > LPSPI_TIMEOUT_CNT) {
+            handle->stats.timeouts++;
+            prv_finish(handle, lpspiTIMEOUT);
+            return lpspiTIMEOUT;
+        }
+    }
+    return lpspiOK;
+}
+
+bool lpspi_poll(lpspi_t* handle) {
+    LPSPI_Type* base;
+    uint8_t tx_ch, rx_ch;
+
+    if (handle == NULL || !handle->busy) return false;
+
+    base = handle->cfg.base;
+    if (handle->dma) {
+        tx_ch = handle->cfg.dma_tx_ch;
+        rx_ch = handle->cfg.dma_rx_ch;
+        if (prv_dma_error(tx_ch) || prv_dma_error(rx_ch)) {
+            handle->stats.errors++;
+            prv_finish(handle, lpspiERR);
+            return false;
+        }
+        if (handle->rx != NULL ? !prv_dma_done(rx_ch) : !prv_dma_done(tx_ch)) return true;
+    }
+    /* Written frames are done once the last byte has left the FIFO */
+    if (handle->rx == NULL && (prv_tx_count(base) > 0 || (base->SR & LPSPI_SR_MBF_MASK))) {
+        return true;
+    }
+
+    prv_finish(handle, lpspiOK);
+    return false;
+}
+
+void lpspi_dma_irq(lpspi_t* handle) {
+    if (handle == NULL) return;
+
+    IP_TCD->TCD[handle->cfg.dma_rx_ch].CH_INT = DMA_TCD_CH_INT_INT_MASK;
+    IP_TCD->TCD[handle->cfg.dma_tx_ch].CH_INT = DMA_TCD_CH_INT_INT_MASK;
+    lpspi_poll(handle);
+}
+
+void lpspi_get_stats(const lpspi_t* handle, lpspi_stats_t* stats) {
+    if (handle == NULL || stats == NULL) return;
+    *stats = handle->stats;
+}
@@ -0,0 +1,162 @@
+/**
+ * \file            s32k3xx_lpspi.h
+ * \brief           LPSPI master with eDMA bursts for S32K3XX
+ *
+ * One transfer is one chip-select frame: a short command header followed
+ * by the payload, both queued through the TX FIFO with PCS held by the
+ * continuous-transfer bit, so there is no gap between command and data.
+ * Header bytes are always pushed by the CPU with the receiver masked.
+ * Payloads from dma_min_len bytes up are moved by two eDMA channels (TX
+ * and RX) through a non-cacheable bounce buffer; shorter ones are moved
+ * by the CPU.
+ *
+ * lpspi_xfer_async() returns as soon as the frame is running. Completion
+ * is detected by lpspi_poll(), called from the superloop or from the RX
+ * DMA channel interrupt; it releases PCS and calls the callback.
+ *
+ * \note            The LPSPI instance needs its clock and pins enabled in
+ *                  the Mcu/Port configuration. The DMAMUX request sources
+ *                  come from the reference manual's DMAMUX table.
+ */
+
+#ifndef S32K3XX_LPSPI_HDR_H
+#define S32K3XX_LPSPI_HDR_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "S32K388.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/*===========================================================================*/
+/*                              CONFIGURATION                                 */
+/*===========================================================================*/
+
+#ifndef LPSPI_DMA_BUF_SIZE
+#define LPSPI_DMA_BUF_SIZE          512U    /*!< Largest DMA payload, bytes */
+#endif
+
+#ifndef LPSPI_TIMEOUT_CNT
+#define LPSPI_TIMEOUT_CNT           100000UL    /*!< Status polls before a blocking call gives up */
+#endif
+
+#define LPSPI_HDR_MAX               4U      /*!< Command header bytes */
+
+/*===========================================================================*/
+/*                              DATA TYPES                                    */
+/*===========================================================================*/
+
+/**
+ * \brief           Status return codes
+ */
+typedef enum {
+    lpspiOK = 0,
+    lpspiERR,
+    lpspiTIMEOUT,
+    lpspiBUSY,                  /*!< A frame is still running */
+    lpspiINVPARAM,
+} lpspir_t;
+
+/**
+ * \brief           Completion callback, called from lpspi_poll()
+ */
+typedef void (*lpspi_done_fn)(lpspir_t res, void* arg);
+
+/**
+ * \brief           Instance configuration
+ */
+typedef struct {
+    LPSPI_Type* base;           /*!< IP_LPSPI_n */
+    uint8_t pcs;                /*!< Chip select 0-3 */
+    bool cpol;
+    bool cpha;
+    uint32_t src_clk_hz;        /*!< LPSPI functional clock */
+    uint32_t sck_hz;            /*!< Wanted SCK, rounded down */
+    uint8_t dma_tx_ch;          /*!< eDMA channels 0-31 */
+    uint8_t dma_rx_ch;
+    uint8_t dmamux_tx_src;      /*!< DMAMUX request sources of the instance */
+    uint8_t dmamux_rx_src;
+    uint16_t dma_min_len;       /*!< Shorter payloads are moved by the CPU, 0 = never DMA */
+} lpspi_cfg_t;
+
+/**
+ * \brief           Transfer counters
+ */
+typedef struct {
+    uint32_t frames;
+    uint32_t dma_frames;        /*!< Payload moved by eDMA */
+    uint32_t bytes;             /*!< Payload bytes */
+    uint32_t timeouts;
+    uint32_t errors;            /*!< eDMA errors */
+} lpspi_stats_t;
+
+/**
+ * \brief           LPSPI handle
+ */
+typedef struct {
+    lpspi_cfg_t cfg;
+    uint32_t sck_hz;            /*!< SCK actually set */
+    uint8_t prescale;
+    uint8_t is_init;
+    volatile uint8_t busy;
+    bool dma;                   /*!< Running frame uses eDMA */
+    uint8_t* rx;                /*!< Caller's RX buffer of the running frame */
+    uint16_t len;
+    lpspi_done_fn done;
+    void* arg;
+    lpspi_stats_t stats;
+} lpspi_t;
+
+/*===========================================================================*/
+/*                              API FUNCTIONS                                 */
+/*===========================================================================*/
+
+/**
+ * \brief           Reset the instance, set master mode, SCK and the DMA channels
+ */
+lpspir_t lpspi_init(lpspi_t* handle, const lpspi_cfg_t* cfg);
+
+/**
+ * \brief           Start one chip-select frame
+ * \param[in]       hdr: Command header, sent first, its RX bytes discarded
+ * \param[in]       hdr_len: 0 to LPSPI_HDR_MAX
+ * \param[in]       tx: Payload to send, NULL to clock out zeros
+ * \param[out]      rx: Payload received, NULL to discard
+ * \param[in]       len: Payload bytes
+ * \param[in]       done: Completion callback, may be NULL
+ * \return          \ref lpspiOK once running, \ref lpspiBUSY if a frame is running
+ * \note            tx and rx may be released after the callback only
+ */
+lpspir_t lpspi_xfer_async(lpspi_t* handle, const uint8_t* hdr, uint8_t hdr_len,
+                          const uint8_t* tx, uint8_t* rx, uint16_t len,
+                          lpspi_done_fn done, void* arg);
+
+/**
+ * \brief           Run one chip-select frame to completion
+ */
+lpspir_t lpspi_xfer(lpspi_t* handle, const uint8_t* hdr, uint8_t hdr_len,
+                    const uint8_t* tx, uint8_t* rx, uint16_t len);
+
+/**
+ * \brief           Finish the running frame if it is done
+ * \return          true while a frame is still running
+ */
+bool lpspi_poll(lpspi_t* handle);
+
+/**
+ * \brief           RX DMA channel interrupt handler body
+ */
+void lpspi_dma_irq(lpspi_t* handle);
+
+/**
+ * \brief           Get transfer counters
+ */
+void lpspi_get_stats(const lpspi_t* handle, lpspi_stats_t* stats);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* S32K3XX_LPSPI_HDR_H */
@@ -47,6 +47,25 @@
 /* Each NOP takes ~1 cycle, with loop overhead we use factor of 0.25 */
 #define S32K3XX_SOFTI2C_CYCLES_PER_US ((S32K3XX_SOFTI2C_CPU_FREQ_HZ / 1000000UL) / 4UL)
 
+/* Stretch limit of a stepped transfer, in phases */
+#ifndef S32K3XX_SOFTI2C_STRETCH_PHASES
+#define S32K3XX_SOFTI2C_STRETCH_PHASES 200U
+#endif
+
+/* Bus symbols of a stepped transfer */
+enum {
+    XFER_IDLE = 0,
+    XFER_START,
+    XFER_DEV_W,
+    XFER_MEM_H,
+    XFER_MEM_L,
+    XFER_RESTART,
+    XFER_DEV_R,
+    XFER_WDATA,
+    XFER_RDATA,
+    XFER_STOP,
+};
+
 /* Private function prototypes */
 static void prv_delay_us(uint32_t us);
 static void prv_scl_high(softi2c_t* handle);
@@ -155,6 +174,7 @@ softi2c_init(softi2c_t* handle, const softi2c_pins_t* pins) {
     handle->pins.scl_channel = pins->scl_channel;
     handle->pins.sda_channel = pins->sda_channel;
     handle->pins.delay_us = pins->delay_us;
+    handle->xfer.sym = XFER_IDLE;
 
     /* Initialize pins to idle state (both high) */
     prv_scl_high(handle);
@@ -640,3 +660,251 @@ softi2c_is_device_ready(softi2c_t* handle, uint8_t dev_addr, uint8_t trials) {
     return softi2cNACK;
 }
 
+/**
+ * \brief           Load the shift register for a byte symbol
+ */
+static void
+prv_xfer_load(softi2c_t* handle) {
+    softi2c_xfer_t* x = &handle->xfer;
+
+    switch (x->sym) {
+        case XFER_DEV_W: x->byte = (uint8_t)(x->dev_addr << 1); break;
+        case XFER_DEV_R: x->byte = (uint8_t)((x->dev_addr << 1) | 0x01); break;
+        case XFER_MEM_H: x->byte = (uint8_t)(x->mem_addr >> 8); break;
+        case XFER_MEM_L: x->byte = (uint8_t)(x->mem_addr & 0xFF); break;
+        case XFER_WDATA: x->byte = x->data[x->idx]; break;
+        default: x->byte = 0; break;
+    }
+    x->bit = 0;
+    x->phase = 0;
+}
+
+/**
+ * \brief           Move to the symbol after the current one
+ */
+static void
+prv_xfer_next(softi2c_t* handle) {
+    softi2c_xfer_t* x = &handle->xfer;
+
+    switch (x->sym) {
+        case XFER_START:
+            x->sym = XFER_DEV_W;
+            break;
+        case XFER_DEV_W:
+            x->sym = (x->mem_addr_size == 2) ? XFER_MEM_H : XFER_MEM_L;
+            break;
+        case XFER_MEM_H:
+            x->sym = XFER_MEM_L;
+            break;
+        case XFER_MEM_L:
+            x->sym = x->read ? XFER_RESTART : XFER_WDATA;
+            break;
+        case XFER_RESTART:
+            x->sym = XFER_DEV_R;
+            break;
+        case XFER_DEV_R:
+            x->sym = XFER_RDATA;
+            break;
+        case XFER_WDATA:
+        case XFER_RDATA:
+            if (++x->idx >= x->len) {
+                x->sym = XFER_STOP;
+            }
+            break;
+        default:
+            x->sym = XFER_IDLE;
+            break;
+    }
+    prv_xfer_load(handle);
+}
+
+/**
+ * \brief           Abort: release the bus with a STOP, keep the error
+ */
+static void
+prv_xfer_fail(softi2c_t* handle, softi2cr_t res) {
+    handle->xfer.res = res;
+    handle->xfer.sym = XFER_STOP;
+    prv_xfer_load(handle);
+}
+
+/**
+ * \brief           Run one half-clock phase of the current symbol
+ */
+static void
+prv_xfer_phase(softi2c_t* handle) {
+    softi2c_xfer_t* x = &handle->xfer;
+
+    /* Phase 2 of every symbol follows SCL high: wait for the slave to release it */
+    if (x->phase == 2) {
+        if (Dio_ReadChannel(handle->pins.scl_channel) == STD_LOW) {
+            if (++x->stretch > S32K3XX_SOFTI2C_STRETCH_PHASES) {
+                /* Give up: lines released, no STOP possible */
+                prv_scl_high(handle);
+                prv_sda_high(handle);
+                x->res = softi2cTIMEOUT;
+                x->sym = XFER_IDLE;
+            }
+            return;
+        }
+        x->stretch = 0;
+    }
+
+    switch (x->sym) {
+        case XFER_START:
+        case XFER_RESTART:
+            switch (x->phase++) {
+                case 0: prv_sda_high(handle); break;
+                case 1: prv_scl_high(handle); break;
+                case 2: prv_sda_low(handle); break;
+                default: prv_scl_low(handle); prv_xfer_next(handle); break;
+            }
+            break;
+
+        case XFER_STOP:
+            switch (x->phase++) {
+                case 0: prv_sda_low(handle); break;
+                case 1: prv_scl_high(handle); break;
+                default: prv_sda_high(handle); x->sym = XFER_IDLE; break;
+            }
+            break;
+
+        case XFER_RDATA:
+            switch (x->phase++) {
+                case 0:
+                    if (x->bit < 8) {
+                        prv_sda_high(handle);
+                    } else if (x->idx + 1U < x->len) {
+                        prv_sda_low(handle);        /* ACK */
+                    } else {
+                        prv_sda_high(handle);       /* NACK the last byte */
+                    }
+                    break;
+                case 1:
+                    prv_scl_high(handle);
+                    break;
+                default:
+                    if (x->bit < 8) {
+                        x->byte = (uint8_t)((x->byte << 1) | (prv_sda_read(handle) != 0 ? 1U : 0U));
+                    }
+                    prv_scl_low(handle);
+                    x->phase = 0;
+                    if (++x->bit > 8) {
+                        prv_sda_high(handle);
+                        x->data[x->idx] = x->byte;
+                        prv_xfer_next(handle);
+                    }
+                    break;
+            }
+            break;
+
+        default:    /* Byte written by us: address, memory address, data */
+            switch (x->phase++) {
+                case 0:
+                    if (x->bit < 8 && (x->byte & 0x80) == 0) {
+                        prv_sda_low(handle);
+                    } else {
+                        prv_sda_high(handle);       /* 1 bit, or released for ACK */
+                    }
+                    break;
+                case 1:
+                    prv_scl_high(handle);
+                    break;
+                default: {
+                    uint8_t nack = (x->bit == 8) ? prv_sda_read(handle) : 0U;
+
+                    prv_scl_low(handle);
+                    x->byte <<= 1;
+                    x->phase = 0;
+                    if (++x->bit > 8) {
+                        if (nack != 0) {
+                            prv_xfer_fail(handle, softi2cNACK);
+                        } else {
+                            prv_xfer_next(handle);
+                        }
+                    }
+                    break;
+                }
+            }
+            break;
+    }
+}
+
+/**
+ * \brief           Start a stepped memory read or write
+ * \param[in]       handle: Pointer to I2C handle
+ * \param[in]       dev_addr: Device address (7-bit)
+ * \param[in]       mem_addr: Memory address
+ * \param[in]       mem_addr_size: Memory address size (1 or 2 bytes)
+ * \param[in]       read: true to read into data, false to write it
+ * \param[in,out]   data: Buffer, must stay valid until the transfer ends
+ * \param[in]       len: Number of bytes
+ * \return          \ref softi2cOK once started, \ref softi2cBUSBUSY if one runs
+ * \note            Nothing happens on the bus before softi2c_xfer_step()
+ */
+softi2cr_t
+softi2c_xfer_start(softi2c_t* handle, uint8_t dev_addr, uint16_t mem_addr, uint8_t mem_addr_size,
+                   bool read, uint8_t* data, uint16_t len) {
+    softi2c_xfer_t* x;
+
+    if (handle == NULL || data == NULL || len == 0 || !handle->is_init
+        || (mem_addr_size != 1 && mem_addr_size != 2)) {
+        return softi2cINVPARAM;
+    }
+
+    x = &handle->xfer;
+    if (x->sym != XFER_IDLE) {
+        return softi2cBUSBUSY;
+    }
+
+    x->data = data;
+    x->len = len;
+    x->idx = 0;
+    x->mem_addr = mem_addr;
+    x->mem_addr_size = mem_addr_size;
+    x->dev_addr = dev_addr;
+    x->read = read ? 1U : 0U;
+    x->stretch = 0;
+    x->res = softi2cOK;
+    x->sym = XFER_START;
+    prv_xfer_load(handle);
+
+    return softi2cOK;
+}
+
+/**
+ * \brief           Advance the stepped transfer
+ * \param[in]       handle: Pointer to I2C handle
+ * \param[in]       max_phases: Most half-clock phases to run in this call
+ * \param[out]      used: Phases run, may be NULL
+ * \return          \ref softi2cPENDING while running, then the transfer result
+ * \note            A byte takes 27 phases, a 2-byte-address register read
+ *                  about 4 * 27 + 11 plus 27 per data byte
+ */
+softi2cr_t
+softi2c_xfer_step(softi2c_t* handle, uint16_t max_phases, uint16_t* used) {
+    uint16_t n = 0;
+
+    if (handle == NULL || !handle->is_init) {
+        return softi2cINVPARAM;
+    }
+
+    while (n < max_phases && handle->xfer.sym != XFER_IDLE) {
+        prv_xfer_phase(handle);
+        prv_delay_us(handle->pins.delay_us);
+        n++;
+    }
+
+    if (used != NULL) {
+        *used = n;
+    }
+    return (handle->xfer.sym != XFER_IDLE) ? softi2cPENDING : handle->xfer.res;
+}
+
+/**
+ * \brief           Check for a running stepped transfer
+ */
+bool
+softi2c_xfer_busy(const softi2c_t* handle) {
+    return handle != NULL && handle->xfer.sym != XFER_IDLE;
+}
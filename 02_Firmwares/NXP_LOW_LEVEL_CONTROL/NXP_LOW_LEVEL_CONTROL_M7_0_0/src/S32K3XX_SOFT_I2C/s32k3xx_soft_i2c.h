@@ -54,6 +54,7 @@ typedef enum {
     softi2cNACK,        /*!< NACK received */
     softi2cINVPARAM,    /*!< Invalid parameter */
     softi2cBUSBUSY,     /*!< Bus is busy */
+    softi2cPENDING,     /*!< Stepped transfer still running */
 } softi2cr_t;
 
 /**
@@ -71,12 +72,32 @@ typedef struct {
     uint32_t delay_us;                	/*!< Half clock period in microseconds (for speed control) */
 } softi2c_pins_t;
 
+/**
+ * \brief           Stepped (non-blocking) memory transfer state
+ */
+typedef struct {
+    uint8_t* data;          /*!< Caller's buffer */
+    uint16_t len;
+    uint16_t idx;           /*!< Data byte in progress */
+    uint16_t mem_addr;
+    uint16_t stretch;       /*!< Phases spent waiting for SCL */
+    uint8_t dev_addr;
+    uint8_t mem_addr_size;
+    uint8_t read;
+    uint8_t sym;            /*!< Bus symbol in progress (START, byte, STOP) */
+    uint8_t bit;            /*!< Bit of the byte, 8 = ACK */
+    uint8_t phase;          /*!< Half-period step of the symbol */
+    uint8_t byte;           /*!< Shift register */
+    softi2cr_t res;
+} softi2c_xfer_t;
+
 /**
  * \brief           I2C handle structure
  */
 typedef struct {
     softi2c_pins_t pins;    /*!< Pin configuration */
     uint8_t is_init;        /*!< Initialization flag */
+    softi2c_xfer_t xfer;    /*!< Stepped transfer, sym = idle when none */
 } softi2c_t;
 
 softi2cr_t softi2c_init(softi2c_t* handle, const softi2c_pins_t* pins);
@@ -97,6 +118,18 @@ softi2cr_t softi2c_mem_read(softi2c_t* handle, uint8_t dev_addr, uint16_t mem_ad
 
 softi2cr_t softi2c_is_device_ready(softi2c_t* handle, uint8_t dev_addr, uint8_t trials);
 
+/*
+ * Stepped memory transfers: the same bus sequence as softi2c_mem_read/write,
+ * cut into half-clock phases. Each softi2c_xfer_step() call runs at most
+ * max_phases of them (one delay_us each), so the caller decides how long it
+ * gives the bus. A clock-stretching slave costs phases, not a busy wait.
+ * The blocking functions must not be used while a stepped transfer runs.
+ */
+softi2cr_t softi2c_xfer_start(softi2c_t* handle, uint8_t dev_addr, uint16_t mem_addr, uint8_t mem_addr_size,
+                              bool read, uint8_t* data, uint16_t len);
+softi2cr_t softi2c_xfer_step(softi2c_t* handle, uint16_t max_phases, uint16_t* used);
+bool softi2c_xfer_busy(const softi2c_t* handle);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
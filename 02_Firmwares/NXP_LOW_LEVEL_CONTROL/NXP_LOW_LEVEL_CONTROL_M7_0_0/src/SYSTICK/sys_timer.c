@@ -0,0 +1,146 @@
+/**
+ * \file            sys_timer.c
+ * \brief           Monotonic microsecond time base on STM_0
+ */
+
+#include "sys_timer.h"
+#include "Mcu.h"
+#include "Clock_Ip.h"
+#include "Stm_Ip.h"
+#include "OsIf_Cfg.h"
+#include "OsIf_Timer_Custom.h"
+#include <stddef.h>
+
+/*===========================================================================*/
+/*                              PRIVATE DATA                                  */
+/*===========================================================================*/
+
+static bool g_running = false;
+
+/* 64-bit extension of the 32-bit hardware counter (main context only) */
+static uint32_t g_last_cnt = 0;
+static uint64_t g_high = 0;
+
+/*===========================================================================*/
+/*                          PUBLIC FUNCTIONS                                  */
+/*===========================================================================*/
+
+bool sys_timer_init(void) {
+    Stm_Ip_InstanceConfigType cfg;
+    uint64 clk_hz;
+    uint32_t div;
+
+    /* STM_0 is gated off by the generated mode config (COFB REQ29) */
+    Clock_Ip_EnableModuleClock(STM0_CLK);
+
+    clk_hz = Mcu_GetClockFrequency(STM0_CLK);
+    if (clk_hz < SYS_TIMER_TICK_HZ || (clk_hz % SYS_TIMER_TICK_HZ) != 0U) {
+        return false;
+    }
+    div = (uint32_t)(clk_hz / SYS_TIMER_TICK_HZ);
+    if (div > 256U) {
+        return false;   /* CPS is 8 bits: divide by 1..256 */
+    }
+
+    cfg.stopInDebugMode = TRUE;     /* Keep timeouts sane while halted */
+#if (STM_IP_SET_CLOCK_MODE == STD_ON)
+    cfg.clockAlternatePrescaler = (uint8)(div - 1U);
+#endif
+    cfg.clockPrescaler = (uint8)(div - 1U);
+
+    /* Resets CNT to 0 and enables the counter */
+    Stm_Ip_Init(SYS_TIMER_STM_INSTANCE, &cfg);
+
+    g_last_cnt = 0;
+    g_high = 0;
+    g_running = true;
+    return true;
+}
+
+uint32_t sys_timer_now_us(void) {
+    return g_running ? Stm_Ip_GetCounterValue(SYS_TIMER_STM_INSTANCE) : 0U;
+}
+
+uint64_t sys_timer_now_us64(void) {
+    uint32_t cnt = sys_timer_now_us();
+
+    if (cnt < g_last_cnt) {
+        g_high += 0x100000000ULL;
+    }
+    g_last_cnt = cnt;
+    return g_high | cnt;
+}
+
+uint32_t sys_timer_now_ms(void) {
+    return (uint32_t)(sys_timer_now_us64() / 1000U);
+}
+
+uint32_t sys_timer_elapsed_us(uint32_t since_us) {
+    return sys_timer_now_us() - since_us;
+}
+
+void sys_timer_delay_us(uint32_t us) {
+    uint32_t start = sys_timer_now_us();
+
+    if (!g_running) return;
+    while ((sys_timer_now_us() - start) < us) {}
+}
+
+void sys_timer_delay_ms(uint32_t ms) {
+    while (ms > 0) {
+        sys_timer_delay_us(1000U);
+        ms--;
+    }
+}
+
+void sys_timer_idle(bool (*work_pending)(void)) {
+    /* Mask interrupts so an IRQ between the check and WFI still wakes us:
+     * WFI returns on a pending interrupt even with PRIMASK set, the ISR
+     * then runs once interrupts are re-enabled. */
+    __asm("cpsid i");
+    if (work_pending == NULL || !work_pending()) {
+        __asm("dsb");
+        __asm("wfi");
+    }
+    __asm("cpsie i");
+}
+
+/*===========================================================================*/
+/*                      OSIF CUSTOM TIMER (OSIF_COUNTER_CUSTOM)               */
+/*===========================================================================*/
+
+#if (OSIF_USE_CUSTOM_TIMER == STD_ON)
+
+void OsIf_Timer_Custom_Init(void) {
+    /* Called from OsIf_Init() before clocks are up - the counter is started
+     * later by sys_timer_init() */
+}
+
+uint32 OsIf_Timer_Custom_GetCounter(void) {
+    return sys_timer_now_us();
+}
+
+uint32 OsIf_Timer_Custom_GetElapsed(uint32 * const CurrentRef) {
+    uint32 now = sys_timer_now_us();
+    uint32 elapsed = now - *CurrentRef;
+
+    if (!g_running) {
+        /* Not started yet: behave like OSIF_COUNTER_DUMMY (one tick per
+         * call) so driver timeouts still expire */
+        return 1U;
+    }
+
+    *CurrentRef = now;
+    return elapsed;
+}
+
+void OsIf_Timer_Custom_SetTimerFrequency(uint32 Freq) {
+    /* Tick rate is fixed at 1 MHz by the STM prescaler */
+    (void)Freq;
+}
+
+uint32 OsIf_Timer_Custom_MicrosToTicks(uint32 Micros) {
+    return Micros;
+}
+
+#endif /* (OSIF_USE_CUSTOM_TIMER == STD_ON) */
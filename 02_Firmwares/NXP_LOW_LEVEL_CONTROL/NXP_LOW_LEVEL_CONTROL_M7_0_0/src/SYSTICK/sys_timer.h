@@ -0,0 +1,91 @@
+/**
+ * \file            sys_timer.h
+ * \brief           Monotonic microsecond time base on STM_0
+ *
+ * The STM_0 counter is prescaled to 1 MHz so one tick is one microsecond.
+ * The same counter backs the RTD OsIf custom timer (OSIF_COUNTER_CUSTOM),
+ * which replaces the loop-count based OSIF_COUNTER_DUMMY timeouts. The
+ * custom timer and the GMAC timeout method are selected in the .mex (OsIf
+ * "Use Custom Timer", Eth "Timeout Method"); generate/ picks them up on the
+ * next code update.
+ */
+
+#ifndef SYS_TIMER_HDR_H
+#define SYS_TIMER_HDR_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*===========================================================================*/
+/*                          CONFIGURATION                                     */
+/*===========================================================================*/
+
+#define SYS_TIMER_STM_INSTANCE      0U          /*!< STM instance used as time base */
+#define SYS_TIMER_TICK_HZ           1000000U    /*!< Counter rate after prescaler */
+
+/*===========================================================================*/
+/*                          PUBLIC FUNCTIONS                                  */
+/*===========================================================================*/
+
+/**
+ * \brief           Start the time base
+ * \note            Call after Mcu_SetMode(): the STM_0 module clock is
+ *                  enabled here, and the prescaler is derived from the
+ *                  current STM0_CLK frequency
+ * \return          true on success, false if STM0_CLK is not a whole
+ *                  multiple of 1 MHz in the prescaler range
+ */
+bool sys_timer_init(void);
+
+/**
+ * \brief           Microseconds since sys_timer_init(), wraps every ~71 minutes
+ */
+uint32_t sys_timer_now_us(void);
+
+/**
+ * \brief           Microseconds since sys_timer_init(), 64-bit (never wraps)
+ * \note            Must be called at least once per 32-bit wrap (~71 minutes);
+ *                  the main loop does this through the timer wheel
+ */
+uint64_t sys_timer_now_us64(void);
+
+/**
+ * \brief           Milliseconds since sys_timer_init()
+ */
+uint32_t sys_timer_now_ms(void);
+
+/**
+ * \brief           Microseconds elapsed since a previous sys_timer_now_us() value
+ */
+uint32_t sys_timer_elapsed_us(uint32_t since_us);
+
+/**
+ * \brief           Busy-wait delay (init code and blocking test helpers only)
+ * \param[in]       us: Delay in microseconds
+ */
+void sys_timer_delay_us(uint32_t us);
+
+/**
+ * \brief           Busy-wait delay (init code and blocking test helpers only)
+ * \param[in]       ms: Delay in milliseconds
+ */
+void sys_timer_delay_ms(uint32_t ms);
+
+/**
+ * \brief           Sleep (WFI) until the next interrupt
+ * \param[in]       work_pending: Checked with interrupts masked right before
+ *                  sleeping, the CPU does not sleep if it returns true.
+ *                  May be NULL.
+ * \note            The 1 ms PIT tick bounds the sleep time
+ */
+void sys_timer_idle(bool (*work_pending)(void));
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SYS_TIMER_HDR_H */
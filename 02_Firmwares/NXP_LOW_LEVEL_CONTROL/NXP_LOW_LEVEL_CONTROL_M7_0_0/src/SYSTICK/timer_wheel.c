@@ -0,0 +1,224 @@
+/**
+ * \file            timer_wheel.c
+ * \brief           Hashed timer wheel for periodic and one-shot jobs
+ */
+
+#include "timer_wheel.h"
+#include "sys_timer.h"
+#include "log_debug.h"
+#include <stddef.h>
+
+#define TAG "TW"
+
+#define TW_MASK                     (TW_SLOTS - 1U)
+#define TW_SLOT_DUE                 0xFFFFU     /* On g_due, not in a bucket */
+
+#if (TW_SLOTS & TW_MASK) != 0U
+#error "TW_SLOTS must be a power of two"
+#endif
+
+/*===========================================================================*/
+/*                              PRIVATE DATA                                  */
+/*===========================================================================*/
+
+static tw_job_t* g_slots[TW_SLOTS];
+static tw_job_t* g_due;                 /* Collected by tw_run(), not yet fired */
+static uint32_t g_cur_tick;             /* Last tick processed */
+
+/* Jobs are kept on a registry only for tw_print_stats() */
+#define TW_MAX_REGISTERED           16U
+static tw_job_t* g_registry[TW_MAX_REGISTERED];
+static uint8_t g_registry_count;
+
+/*===========================================================================*/
+/*                          PRIVATE FUNCTIONS                                 */
+/*===========================================================================*/
+
+static uint32_t prv_now_tick(void) {
+    return (uint32_t)(sys_timer_now_us64() / TW_TICK_US);
+}
+
+static bool prv_before_eq(uint32_t a, uint32_t b) {
+    return (int32_t)(a - b) <= 0;
+}
+
+static void prv_register(tw_job_t* job) {
+    uint8_t i;
+
+    for (i = 0; i < g_registry_count; i++) {
+        if (g_registry[i] == job) return;
+    }
+    if (g_registry_count < TW_MAX_REGISTERED) {
+        g_registry[g_registry_count++] = job;
+    }
+}
+
+static void prv_insert(tw_job_t* job) {
+    uint32_t bucket_tick = job->expiry;
+
+    /* Already due: park it in the next bucket that will be visited */
+    if (prv_before_eq(bucket_tick, g_cur_tick)) {
+        bucket_tick = g_cur_tick + 1U;
+    }
+
+    job->slot = (uint16_t)(bucket_tick & TW_MASK);
+    job->next = g_slots[job->slot];
+    g_slots[job->slot] = job;
+    job->active = true;
+}
+
+static void prv_unlink(tw_job_t* job) {
+    tw_job_t** pp = (job->slot == TW_SLOT_DUE) ? &g_due : &g_slots[job->slot];
+
+    while (*pp != NULL) {
+        if (*pp == job) {
+            *pp = job->next;
+            break;
+        }
+        pp = &(*pp)->next;
+    }
+    job->next = NULL;
+    job->active = false;
+}
+
+static void prv_start(tw_job_t* job, const char* name, uint32_t delay_ticks,
+                      uint32_t period_ticks, tw_cb_t cb, void* arg) {
+    if (job == NULL || cb == NULL) return;
+
+    if (job->active) {
+        prv_unlink(job);
+    }
+
+    job->cb = cb;
+    job->arg = arg;
+    job->name = name;
+    job->period = period_ticks;
+    job->expiry = prv_now_tick() + delay_ticks;
+    job->runs = 0;
+    job->skipped = 0;
+    job->max_late_us = 0;
+
+    prv_insert(job);
+    prv_register(job);
+}
+
+/**
+ * \brief           Run one job that is due
+ */
+static void prv_fire(tw_job_t* job, uint64_t now_us, uint32_t now_tick) {
+    uint64_t ideal_us = (uint64_t)job->expiry * TW_TICK_US;
+    uint32_t late_us = (now_us > ideal_us) ? (uint32_t)(now_us - ideal_us) : 0U;
+
+    if (late_us > job->max_late_us) {
+        job->max_late_us = late_us;
+    }
+    job->runs++;
+
+    if (job->period != 0U) {
+        /* Next deadline from the ideal one - no drift under load */
+        job->expiry += job->period;
+        if (prv_before_eq(job->expiry, now_tick)) {
+            uint32_t missed = (now_tick - job->expiry) / job->period + 1U;
+            job->skipped += missed;
+            job->expiry += missed * job->period;
+        }
+        prv_insert(job);
+    } else {
+        job->active = false;
+    }
+
+    /* Callback last: it may stop or re-arm its own job */
+    job->cb(job->arg);
+}
+
+/*===========================================================================*/
+/*                          PUBLIC FUNCTIONS                                  */
+/*===========================================================================*/
+
+void tw_init(void) {
+    uint32_t i;
+
+    for (i = 0; i < TW_SLOTS; i++) {
+        g_slots[i] = NULL;
+    }
+    g_due = NULL;
+    g_registry_count = 0;
+    g_cur_tick = prv_now_tick();
+}
+
+void tw_start_periodic(tw_job_t* job, const char* name, uint32_t period_ms,
+                       tw_cb_t cb, void* arg) {
+    if (period_ms == 0U) {
+        period_ms = 1U;
+    }
+    prv_start(job, name, period_ms, period_ms, cb, arg);
+}
+
+void tw_start_oneshot(tw_job_t* job, const char* name, uint32_t delay_ms,
+                      tw_cb_t cb, void* arg) {
+    prv_start(job, name, delay_ms, 0U, cb, arg);
+}
+
+void tw_stop(tw_job_t* job) {
+    if (job == NULL || !job->active) return;
+    prv_unlink(job);
+}
+
+uint32_t tw_run(void) {
+    uint64_t now_us = sys_timer_now_us64();
+    uint32_t now_tick = (uint32_t)(now_us / TW_TICK_US);
+    uint32_t count = 0;
+
+    /* More than one lap behind: every bucket gets visited once anyway */
+    if ((now_tick - g_cur_tick) > TW_SLOTS) {
+        g_cur_tick = now_tick - TW_SLOTS;
+    }
+
+    while (g_cur_tick != now_tick) {
+        tw_job_t** pp;
+
+        g_cur_tick++;
+
+        /* Collect due jobs first so callbacks can freely re-arm/stop. A
+         * callback that stops or re-arms a collected job unlinks it from
+         * g_due, so it is neither lost nor fired. */
+        pp = &g_slots[g_cur_tick & TW_MASK];
+        while (*pp != NULL) {
+            tw_job_t* job = *pp;
+            if (prv_before_eq(job->expiry, g_cur_tick)) {
+                *pp = job->next;
+                job->next = g_due;
+                job->slot = TW_SLOT_DUE;
+                g_due = job;
+            } else {
+                pp = &job->next;
+            }
+        }
+
+        while (g_due != NULL) {
+            tw_job_t* job = g_due;
+            g_due = job->next;
+            job->next = NULL;
+            if (!job->active) {
+                continue;
+            }
+            prv_fire(job, now_us, now_tick);
+            count++;
+        }
+    }
+
+    return count;
+}
+
+void tw_print_stats(void) {
+    uint8_t i;
+
+    for (i = 0; i < g_registry_count; i++) {
+        const tw_job_t* job = g_registry[i];
+        LOG_I(TAG, "  %-10s runs=%lu skipped=%lu max_late=%luus",
+              job->name ? job->name : "?",
+              (unsigned long)job->runs,
+              (unsigned long)job->skipped,
+              (unsigned long)job->max_late_us);
+    }
+}
@@ -0,0 +1,110 @@
+/**
+ * \file            timer_wheel.h
+ * \brief           Hashed timer wheel for periodic and one-shot jobs
+ *
+ * Jobs are hashed into TW_SLOTS buckets by expiry tick (1 ms). Running the
+ * wheel only visits the buckets of the ticks that passed since the last
+ * run, so the cost does not grow with the number of idle jobs. Periodic
+ * jobs are re-armed from their ideal deadline, not from the time they
+ * actually ran, so load delays a single run but never makes the period
+ * drift.
+ */
+
+#ifndef TIMER_WHEEL_HDR_H
+#define TIMER_WHEEL_HDR_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*===========================================================================*/
+/*                          CONFIGURATION                                     */
+/*===========================================================================*/
+
+#ifndef TW_SLOTS
+#define TW_SLOTS                    64U     /*!< Wheel size, power of two */
+#endif
+
+#define TW_TICK_US                  1000U   /*!< Wheel resolution */
+
+/*===========================================================================*/
+/*                              TYPES                                         */
+/*===========================================================================*/
+
+typedef void (*tw_cb_t)(void* arg);
+
+/**
+ * \brief           Job control block, owned by the caller (usually static)
+ */
+typedef struct tw_job {
+    struct tw_job* next;        /*!< Bucket list link (internal) */
+    tw_cb_t cb;                 /*!< Job function */
+    void* arg;                  /*!< Job argument */
+    const char* name;           /*!< Name for status output */
+    uint32_t expiry;            /*!< Absolute expiry tick (internal) */
+    uint32_t period;            /*!< Period in ticks, 0 = one-shot */
+    uint16_t slot;              /*!< Bucket index (internal) */
+    bool active;                /*!< Armed */
+
+    /* Statistics */
+    uint32_t runs;              /*!< Times the job ran */
+    uint32_t skipped;           /*!< Periods skipped because the loop was late */
+    uint32_t max_late_us;       /*!< Worst lateness vs. ideal deadline (jitter) */
+} tw_job_t;
+
+/*===========================================================================*/
+/*                          PUBLIC FUNCTIONS                                  */
+/*===========================================================================*/
+
+/**
+ * \brief           Initialize the wheel
+ * \note            Requires sys_timer_init()
+ */
+void tw_init(void);
+
+/**
+ * \brief           Arm a periodic job
+ * \param[in]       job: Job control block
+ * \param[in]       name: Job name (may be NULL)
+ * \param[in]       period_ms: Period in milliseconds (>= 1)
+ * \param[in]       cb: Job function
+ * \param[in]       arg: Job argument
+ */
+void tw_start_periodic(tw_job_t* job, const char* name, uint32_t period_ms,
+                       tw_cb_t cb, void* arg);
+
+/**
+ * \brief           Arm a one-shot job
+ * \param[in]       job: Job control block
+ * \param[in]       name: Job name (may be NULL)
+ * \param[in]       delay_ms: Delay in milliseconds
+ * \param[in]       cb: Job function
+ * \param[in]       arg: Job argument
+ */
+void tw_start_oneshot(tw_job_t* job, const char* name, uint32_t delay_ms,
+                      tw_cb_t cb, void* arg);
+
+/**
+ * \brief           Disarm a job (safe to call from its own callback)
+ */
+void tw_stop(tw_job_t* job);
+
+/**
+ * \brief           Run all jobs that are due
+ * \return          Number of jobs run
+ */
+uint32_t tw_run(void);
+
+/**
+ * \brief           Log per-job statistics
+ */
+void tw_print_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TIMER_WHEEL_HDR_H */
@@ -1,12 +1,14 @@
 /**
  * @file    main.c
  * @brief   RGMII Network Application - S32K388 GMAC + LAN9646 Port 6
- *          - Broadcast every 5 seconds
+ *          - UDP hello to the collectors every 5 seconds (unicast via ARP)
  *          - Respond to ICMP ping
+ *          - LAN9646 register access over UDP (regsvc.h)
  */
 
 #include <string.h>
 #include <stdint.h>
+#include <stdbool.h>
 
 #include "S32K388.h"
 #include "Mcal.h"
@@ -21,15 +23,41 @@
 #include "Eth_43_GMAC.h"
 #include "Eth_43_GMAC_Cfg.h"
 #include "Gmac_Ip.h"
+#include "EthTrcv.h"
 
 #include "lan9646.h"
+#include "lan9646_acl.h"
+#include "lan9646_alu.h"
+#include "lan9646_async.h"
+#include "lan9646_config.h"
+#include "lan9646_mib.h"
+#include "lan9646_qos.h"
+#include "lan9646_rate.h"
+#include "lan9646_snap.h"
+#include "lan9646_switch.h"
+#include "lan9646_traffic_test.h"
+#include "lan9646_vlan.h"
 #include "s32k3xx_soft_i2c.h"
+#include "s32k3xx_lpspi.h"
 #include "CDD_Uart.h"
 #include "log_debug.h"
+#include "eth_rx.h"
+#include "eth_tx.h"
+#include "icmp_echo.h"
+#include "arp_cache.h"
+#include "telemetry.h"
+#include "frame_tpl.h"
+#include "regsvc.h"
+#include "net_dispatch.h"
+#include "sys_timer.h"
+#include "timer_wheel.h"
 
 /* External config symbols from generated PBcfg files */
 extern const Eth_43_GMAC_ConfigType Eth_43_GMAC_xPredefinedConfig;
 
+/* Link state reported by the EthTrcv stub */
+extern EthTrcv_LinkStateType TrcvLinkStateGlobal;
+
 /* GPT notification stub - required by Gpt_PBcfg.c */
 void SysTick_Custom_Handler(void) {
     /* Not used in baremetal mode */
@@ -47,11 +75,21 @@ static const uint8_t g_our_mac[6] = {0x10, 0x11, 0x22, 0x77, 0x77, 0x77};
 /* Our IP address: 192.168.1.200 (as configured in EB Tresos tcp_stack_1) */
 static const uint8_t g_our_ip[4] = {192, 168, 1, 200};
 
-/* Broadcast MAC */
-static const uint8_t g_bcast_mac[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+/* Subnet and default gateway (as configured in netifcfg.c) */
+static const uint8_t g_netmask[4] = {255, 255, 255, 0};
+static const uint8_t g_gateway[4] = {192, 168, 1, 1};
+
+/* Collectors receiving the periodic UDP datagrams (unicast, resolved by ARP) */
+static const uint8_t g_collectors[][4] = {
+    {192, 168, 1, 100},
+};
+#define NUM_COLLECTORS          (sizeof(g_collectors) / sizeof(g_collectors[0]))
+
+/* Only host allowed to use the register service (the first collector) */
+static const uint8_t g_regsvc_mask[4] = {255, 255, 255, 255};
 
-/* Broadcast IP */
-static const uint8_t g_bcast_ip[4] = {255, 255, 255, 255};
+/* UDP port of the hello datagrams (source and destination) */
+#define HELLO_UDP_PORT          5000U
 
 /*===========================================================================*/
 /*                          HARDWARE CONFIGURATION                            */
@@ -62,17 +100,58 @@ static const uint8_t g_bcast_ip[4] = {255, 255, 255, 255};
 #define LAN9646_I2C_SPEED       5U
 #define ETH_CTRL_IDX            0U
 
-/* Ethernet frame types */
-#define ETH_TYPE_ARP            0x0806
-#define ETH_TYPE_IP             0x0800
-
-/* IP protocols */
-#define IP_PROTO_ICMP           1
-#define IP_PROTO_UDP            17
+/*
+ * Switch management over LPSPI instead of the bit-banged I2C. Needs the
+ * LPSPI clock and pins in the Mcu/Port configuration first.
+ */
+#ifndef LAN9646_USE_SPI
+#define LAN9646_USE_SPI         0
+#endif
+#define LAN9646_SPI_BASE        IP_LPSPI_1
+#define LAN9646_SPI_PCS         0U
+#define LAN9646_SPI_SRC_HZ      40000000UL
+#define LAN9646_SPI_SCK_HZ      20000000UL
+#define LAN9646_SPI_DMA_TX_CH   4U
+#define LAN9646_SPI_DMA_RX_CH   5U
+#define LAN9646_SPI_DMAMUX_TX   40U     /* DMAMUX_0 request sources of LPSPI1 */
+#define LAN9646_SPI_DMAMUX_RX   39U
+#define LAN9646_SPI_DMA_MIN     16U     /* Shorter payloads are cheaper by CPU */
+
+/* Switch bus time the superloop gives the queued register engine per pass:
+ * half-clock phases on I2C (32 = 160 us at 100 kHz) */
+#define LAN_ASYNC_BUDGET        32U
+
+/*
+ * Switch INTRP_N (active low, held while a link interrupt is pending) on a
+ * Dio input channel, e.g. DioConf_DioChannel_LAN_INT_CH once the pin is in
+ * the Port/Dio configuration. Not routed on this board: without it every
+ * link check reads the interrupt summary over I2C (0.75 ms at 100 kHz,
+ * 7.5 ms of bus time per second at LINK_CHECK_MS).
+ */
+/* #define LAN9646_INTRP_N_CHANNEL  DioConf_DioChannel_LAN_INT_CH */
 
-/* ICMP types */
-#define ICMP_ECHO_REQUEST       8
-#define ICMP_ECHO_REPLY         0
+/*
+ * PHY registers of ports 1-4 over the GMAC MDIO bus, port n at base + n - 1.
+ * Not on this board: PTD16/PTD17 are the soft-I2C GPIOs and no PHY sits on
+ * MDIO, so the PHYs stay on the switch bus unless a board routes MDC/MDIO.
+ */
+#ifndef LAN9646_PHY_MDIO
+#define LAN9646_PHY_MDIO        0
+#endif
+#define LAN9646_MDIO_PHY_BASE   1U
+#define LAN9646_MDIO_TIMEOUT_MS 1U
+
+/*
+ * GMAC/RGMII throughput benchmark after init: frames through the port 6
+ * remote loopback, one step per size. Normal traffic does not reach the
+ * network while it runs.
+ */
+#ifndef LAN_TGEN_AT_BOOT
+#define LAN_TGEN_AT_BOOT        0
+#endif
+#define LAN_TGEN_RING           12U     /* Leaves TX descriptors for other senders */
+#define LAN_TGEN_STEP_MS        2000U
+#define LAN_TGEN_DRAIN_MS       20U
 
 /*===========================================================================*/
 /*                          GLOBAL VARIABLES                                  */
@@ -80,34 +159,67 @@ static const uint8_t g_bcast_ip[4] = {255, 255, 255, 255};
 
 static lan9646_t g_lan9646;
 static softi2c_t g_i2c;
-
-/* TX buffer - place in non-cacheable section for DMA access */
+#if LAN9646_USE_SPI
+static lpspi_t g_spi;
+#endif
+
+/* Switch registers only this firmware changes: reads and RMW skip the I2C bus */
+static const lan9646_reg_range_t g_lan_shadow_ranges[] = {
+    {LAN9646_REG_CHIP_ID0, 3, LAN9646_REG_CACHEABLE},          /* Chip ID (0x0003 has reset) */
+    {LAN9646_REG_SWITCH_OP, 1, LAN9646_REG_CACHEABLE},
+    {LAN9646_REG_PORT_XMII_CTRL0(6), 2, LAN9646_REG_CACHEABLE},
+    {LAN9646_REG_PORT_XMII_CTRL0(7), 2, LAN9646_REG_CACHEABLE},
+    {LAN9646_REG_PORT_MEMBERSHIP(1), 4, LAN9646_REG_CACHEABLE},
+    {LAN9646_REG_PORT_MEMBERSHIP(2), 4, LAN9646_REG_CACHEABLE},
+    {LAN9646_REG_PORT_MEMBERSHIP(3), 4, LAN9646_REG_CACHEABLE},
+    {LAN9646_REG_PORT_MEMBERSHIP(4), 4, LAN9646_REG_CACHEABLE},
+    {LAN9646_REG_PORT_MEMBERSHIP(6), 4, LAN9646_REG_CACHEABLE},
+    {LAN9646_REG_PORT_MEMBERSHIP(7), 4, LAN9646_REG_CACHEABLE},
+};
+static lan9646_shadow_t g_lan_shadow;
+
+/* MIB totals and rates of all switch ports, one frozen snapshot per MIB_PERIOD_MS */
+#define MIB_PORT_MASK           0xDEU   /* Ports 1-4, 6, 7 */
+static lan9646_mib_engine_t g_lan_mib;
+
+/* Queued switch register access, serviced a slice per superloop pass */
+static lan9646_async_t g_lan_async;
+
+/* 802.1Q VLAN table */
+static lan9646_vlan_t g_lan_vlan;
+
+/* Static MAC table; the GMAC only gets frames for us and broadcast/multicast */
+static lan9646_alu_t g_lan_alu;
+
+/* Ingress policing and storm control */
+static lan9646_rate_t g_lan_rate;
+
+/* Binary register snapshot, fetched over regsvc (03_Softwares/lan9646_snap) */
+#define LAN_SNAP_SIZE           4096U
+static uint8_t g_lan_snap[LAN_SNAP_SIZE];
+static uint16_t g_lan_snap_len;
+
+/* Traffic generator, idle unless LAN_TGEN_AT_BOOT starts it */
+static lan9646_tgen_t g_tgen;
+
+#if LAN_TGEN_AT_BOOT
 #define ETH_43_GMAC_START_SEC_VAR_CLEARED_UNSPECIFIED_NO_CACHEABLE
 #include "Eth_43_GMAC_MemMap.h"
-static uint8_t g_tx_buffer[1536] __attribute__((aligned(8)));
+static uint8_t g_tgen_ring[LAN_TGEN_RING][ETH_TX_BUF_SIZE] __attribute__((aligned(8)));
 #define ETH_43_GMAC_STOP_SEC_VAR_CLEARED_UNSPECIFIED_NO_CACHEABLE
 #include "Eth_43_GMAC_MemMap.h"
+#endif
+
+/* PHY ports with link up, bit 0 = port 1 */
+static uint8_t g_links_up;
 
 /* Statistics */
-static uint32_t g_rx_count = 0;
 static uint32_t g_tx_count = 0;
 static uint32_t g_ping_count = 0;
-static uint32_t g_arp_count = 0;
-
-/*===========================================================================*/
-/*                          DELAY FUNCTIONS                                   */
-/*===========================================================================*/
+static uint32_t g_tx_drop = 0;
 
-static void delay_ms(uint32_t ms) {
-    volatile uint32_t count;
-    while (ms > 0) {
-        count = 40000U;
-        while (count > 0) {
-            count--;
-        }
-        ms--;
-    }
-}
+/* Prebuilt hello frame per collector */
+static frame_tpl_t g_hello_tpl[NUM_COLLECTORS];
 
 /*===========================================================================*/
 /*                          I2C CALLBACKS                                     */
@@ -122,348 +234,856 @@ static lan9646r_t i2c_init_cb(void) {
     return (softi2c_init(&g_i2c, &pins) == softi2cOK) ? lan9646OK : lan9646ERR;
 }
 
+/* Blocking accesses first let the queued engine finish its transaction */
 static lan9646r_t i2c_write_cb(uint8_t dev_addr, const uint8_t* data, uint16_t len) {
+    lan9646_async_quiesce(&g_lan_async);
     return (softi2c_write(&g_i2c, dev_addr, data, len) == softi2cOK) ? lan9646OK : lan9646ERR;
 }
 
 static lan9646r_t i2c_read_cb(uint8_t dev_addr, uint8_t* data, uint16_t len) {
+    lan9646_async_quiesce(&g_lan_async);
     return (softi2c_read(&g_i2c, dev_addr, data, len) == softi2cOK) ? lan9646OK : lan9646ERR;
 }
 
 static lan9646r_t i2c_mem_write_cb(uint8_t dev_addr, uint16_t mem_addr,
                                    const uint8_t* data, uint16_t len) {
+    lan9646_async_quiesce(&g_lan_async);
     return (softi2c_mem_write(&g_i2c, dev_addr, mem_addr, 2, data, len) == softi2cOK)
            ? lan9646OK : lan9646ERR;
 }
 
 static lan9646r_t i2c_mem_read_cb(uint8_t dev_addr, uint16_t mem_addr,
                                   uint8_t* data, uint16_t len) {
+    lan9646_async_quiesce(&g_lan_async);
     return (softi2c_mem_read(&g_i2c, dev_addr, mem_addr, 2, data, len) == softi2cOK)
            ? lan9646OK : lan9646ERR;
 }
 
+#if !LAN9646_USE_SPI
+/* Queued engine backend: stepped I2C transfers */
+static lan9646r_t i2c_async_start_cb(bool read, uint16_t reg_addr, uint8_t* data, uint16_t len) {
+    return (softi2c_xfer_start(&g_i2c, LAN9646_I2C_ADDR_DEFAULT, reg_addr, 2, read, data, len)
+            == softi2cOK) ? lan9646OK : lan9646ERR;
+}
+
+static bool i2c_async_step_cb(uint16_t budget, uint16_t* used, lan9646r_t* res) {
+    softi2cr_t r = softi2c_xfer_step(&g_i2c, budget, used);
+
+    if (r == softi2cPENDING) {
+        return true;
+    }
+    *res = (r == softi2cOK) ? lan9646OK : lan9646ERR;
+    return false;
+}
+
+static const lan9646_async_bus_t g_lan_async_bus = {
+    .start_fn = i2c_async_start_cb,
+    .step_fn = i2c_async_step_cb,
+};
+#endif /* !LAN9646_USE_SPI */
+
+#if LAN9646_PHY_MDIO
 /*===========================================================================*/
-/*                          LAN9646 HELPERS                                   */
+/*                          MDIO CALLBACKS                                    */
 /*===========================================================================*/
 
-static void lan_write8(uint16_t addr, uint8_t val) {
-    lan9646_write_reg8(&g_lan9646, addr, val);
+static lan9646r_t mdio_init_cb(void) {
+    return lan9646OK;       /* Enabled by Eth_43_GMAC_Init() */
+}
+
+static lan9646r_t mdio_write_cb(uint8_t phy_addr, uint8_t reg_addr, uint16_t data) {
+    switch (Gmac_Ip_MDIOWrite(ETH_CTRL_IDX, phy_addr, reg_addr, data, LAN9646_MDIO_TIMEOUT_MS)) {
+        case GMAC_STATUS_SUCCESS: return lan9646OK;
+        case GMAC_STATUS_TIMEOUT: return lan9646TIMEOUT;
+        default: return lan9646BUSERR;
+    }
 }
 
-static void lan_write32(uint16_t addr, uint32_t val) {
-    lan9646_write_reg32(&g_lan9646, addr, val);
+static lan9646r_t mdio_read_cb(uint8_t phy_addr, uint8_t reg_addr, uint16_t* data) {
+    switch (Gmac_Ip_MDIORead(ETH_CTRL_IDX, phy_addr, reg_addr, data, LAN9646_MDIO_TIMEOUT_MS)) {
+        case GMAC_STATUS_SUCCESS: return lan9646OK;
+        case GMAC_STATUS_TIMEOUT: return lan9646TIMEOUT;
+        default: return lan9646BUSERR;
+    }
 }
 
+/* The PHYs decode Clause 22 only: MMD goes through registers 13/14 */
+static const lan9646_miim_t g_lan_mdio = {
+    .init_fn = mdio_init_cb,
+    .write_fn = mdio_write_cb,
+    .read_fn = mdio_read_cb,
+};
+#endif /* LAN9646_PHY_MDIO */
+
+#if LAN9646_USE_SPI
 /*===========================================================================*/
-/*                          CHECKSUM HELPERS                                  */
+/*                          SPI CALLBACKS                                     */
 /*===========================================================================*/
 
-static uint16_t ip_checksum(const uint8_t* data, uint16_t len) {
-    uint32_t sum = 0;
+static lan9646r_t spi_init_cb(void) {
+    static const lpspi_cfg_t cfg = {
+        .base = LAN9646_SPI_BASE,
+        .pcs = LAN9646_SPI_PCS,
+        .cpol = true,                   /* KSZ SPI mode 3 */
+        .cpha = true,
+        .src_clk_hz = LAN9646_SPI_SRC_HZ,
+        .sck_hz = LAN9646_SPI_SCK_HZ,
+        .dma_tx_ch = LAN9646_SPI_DMA_TX_CH,
+        .dma_rx_ch = LAN9646_SPI_DMA_RX_CH,
+        .dmamux_tx_src = LAN9646_SPI_DMAMUX_TX,
+        .dmamux_rx_src = LAN9646_SPI_DMAMUX_RX,
+        .dma_min_len = LAN9646_SPI_DMA_MIN,
+    };
+    return (lpspi_init(&g_spi, &cfg) == lpspiOK) ? lan9646OK : lan9646ERR;
+}
 
-    while (len > 1) {
-        sum += ((uint16_t)data[0] << 8) | data[1];
-        data += 2;
-        len -= 2;
+/* Command and payload in one chip-select frame, bursts moved by eDMA */
+static lan9646r_t spi_frame_cb(const uint8_t* cmd, uint8_t cmd_len,
+                               const uint8_t* tx, uint8_t* rx, uint16_t len) {
+    lan9646_async_quiesce(&g_lan_async);
+    switch (lpspi_xfer(&g_spi, cmd, cmd_len, tx, rx, len)) {
+        case lpspiOK: return lan9646OK;
+        case lpspiTIMEOUT: return lan9646TIMEOUT;
+        case lpspiINVPARAM: return lan9646INVPARAM;
+        default: return lan9646BUSERR;
     }
+}
+
+/* Queued engine backend: a frame takes microseconds, so it runs whole in start */
+static lan9646r_t spi_async_start_cb(bool read, uint16_t reg_addr, uint8_t* data, uint16_t len) {
+    uint8_t cmd[LAN9646_SPI_CMD_LEN];
+    uint32_t w = LAN9646_SPI_CMD(read ? LAN9646_SPI_CMD_READ : LAN9646_SPI_CMD_WRITE, reg_addr);
+
+    cmd[0] = (uint8_t)(w >> 24);
+    cmd[1] = (uint8_t)(w >> 16);
+    cmd[2] = (uint8_t)(w >> 8);
+    cmd[3] = (uint8_t)w;
+    return (lpspi_xfer(&g_spi, cmd, sizeof(cmd), read ? NULL : data, read ? data : NULL, len)
+            == lpspiOK) ? lan9646OK : lan9646BUSERR;
+}
+
+static bool spi_async_step_cb(uint16_t budget, uint16_t* used, lan9646r_t* res) {
+    (void)budget;
+    *used = 1;
+    *res = lan9646OK;
+    return false;
+}
 
-    if (len == 1) {
-        sum += (uint16_t)data[0] << 8;
+static const lan9646_async_bus_t g_lan_async_bus = {
+    .start_fn = spi_async_start_cb,
+    .step_fn = spi_async_step_cb,
+};
+#endif /* LAN9646_USE_SPI */
+
+/*===========================================================================*/
+/*                          LAN9646 HELPERS                                   */
+/*===========================================================================*/
+
+#define LAN_TABLE_LEN(t)        ((uint16_t)(sizeof(t) / sizeof((t)[0])))
+
+/* VLANs, applied before 802.1Q mode is enabled. VID 1 (the default PVID)
+ * keeps untagged traffic flowing as with port-based forwarding alone */
+static const lan9646_vlan_entry_t g_lan_vlans[] = {
+    {1, 0x6F, 0x6F, 0},                             /* Ports 1-4, 6, 7 untagged */
+};
+
+/* Ingress rules of the PHY ports: traffic the firmware has no handler for
+ * is kept away from port 6 but still switched between the other ports */
+static const lan9646_acl_rule_t g_lan_acl[] = {
+    {.match = LAN9646_ACL_MATCH_ETHERTYPE, .ethertype = 0x86DD,     /* IPv6 */
+     .action = LAN9646_ACL_MASK, .port_map = 0x5F},                 /* All but port 6 */
+    /* Control traffic rides in port 6's strict-priority queue */
+    {.match = LAN9646_ACL_MATCH_ETHERTYPE, .ethertype = 0x0806,     /* ARP */
+     .action = LAN9646_ACL_PRIORITY, .prio = 7},
+    {.match = LAN9646_ACL_MATCH_UDP_PORT, .port_min = REGSVC_UDP_PORT,
+     .port_max = REGSVC_UDP_PORT, .action = LAN9646_ACL_PRIORITY, .prio = 7},
+};
+
+/* Priority from the tag, the DSCP or the ACL; port 6 gets four queues:
+ * priorities 6-7 in strict queue 3, the rest shared by weight */
+#define LAN_QOS_SOURCES         (LAN9646_QOS_SRC_PCP | LAN9646_QOS_SRC_DSCP | LAN9646_QOS_SRC_ACL)
+#define LAN_QOS_PHY_PORT(n)     {(n), LAN_QOS_SOURCES, 1, {0}, {{LAN9646_QOS_STRICT, 0}}}
+
+static const lan9646_qos_port_cfg_t g_lan_qos[] = {
+    LAN_QOS_PHY_PORT(1),
+    LAN_QOS_PHY_PORT(2),
+    LAN_QOS_PHY_PORT(3),
+    LAN_QOS_PHY_PORT(4),
+    {6, LAN_QOS_SOURCES, 4, {0, 0, 1, 1, 2, 2, 3, 3},
+     {{LAN9646_QOS_WRR, 1}, {LAN9646_QOS_WRR, 2}, {LAN9646_QOS_WRR, 4}, {LAN9646_QOS_STRICT, 0}}},
+};
+
+/* DSCP to priority: the class selector (DSCP >> 3), except expedited
+ * forwarding (46) which is promoted to 6 */
+static const uint8_t g_lan_dscp_prio[LAN9646_QOS_DSCPS] = {
+    0, 0, 0, 0, 0, 0, 0, 0,  1, 1, 1, 1, 1, 1, 1, 1,
+    2, 2, 2, 2, 2, 2, 2, 2,  3, 3, 3, 3, 3, 3, 3, 3,
+    4, 4, 4, 4, 4, 4, 4, 4,  5, 5, 5, 5, 5, 5, 6, 5,
+    6, 6, 6, 6, 6, 6, 6, 6,  7, 7, 7, 7, 7, 7, 7, 7,
+};
+
+/* Port 6 RGMII 1Gbps, port-based membership (each PHY port reaches the
+ * others, port 6 and port 7), QoS as above */
+static const lan9646_config_port_t g_lan_ports[] = {
+    {6, LAN9646_CONFIG_XMII | LAN9646_CONFIG_MEMBERS,
+     0x68, 0x18, 0x4F, 0, &g_lan_qos[4]},           /* Full duplex; 1Gbps + TX_ID + RX_ID */
+    {1, LAN9646_CONFIG_MEMBERS, 0, 0, 0x6E, 0, &g_lan_qos[0]},
+    {2, LAN9646_CONFIG_MEMBERS, 0, 0, 0x6D, 0, &g_lan_qos[1]},
+    {3, LAN9646_CONFIG_MEMBERS, 0, 0, 0x6B, 0, &g_lan_qos[2]},
+    {4, LAN9646_CONFIG_MEMBERS, 0, 0, 0x67, 0, &g_lan_qos[3]},
+};
+
+/* The whole switch setup: applied at boot by writing only what differs,
+ * then compared with the device every CFG_DRIFT_PERIOD_MS */
+static const lan9646_config_t g_lan_cfg = {
+    .ports = g_lan_ports,
+    .port_count = (uint8_t)LAN_TABLE_LEN(g_lan_ports),
+    .dscp_prio = g_lan_dscp_prio,
+    .vlans = g_lan_vlans,
+    .vlan_count = LAN_TABLE_LEN(g_lan_vlans),
+    .vlan_enable = true,
+    .start = true,
+};
+
+/* Each PHY port may use at most this much of port 6, so one host flooding
+ * the switch cannot starve the firmware's own traffic */
+#define LAN_INGRESS_LIMIT_BPS   200000000UL
+#define LAN_STORM_PCT           1U              /* Broadcast + multicast */
+
+/*===========================================================================*/
+/*                          PACKET SEND FUNCTIONS                             */
+/*===========================================================================*/
+
+/* Write v in decimal, return the number of digits */
+static uint8_t u32_to_dec(uint8_t* out, uint32_t v) {
+    uint8_t tmp[10];
+    uint8_t n = 0;
+    uint8_t i;
+
+    do {
+        tmp[n++] = (uint8_t)('0' + (v % 10U));
+        v /= 10U;
+    } while (v != 0U);
+
+    for (i = 0; i < n; i++) {
+        out[i] = tmp[n - 1U - i];
     }
+    return n;
+}
 
-    while (sum >> 16) {
-        sum = (sum & 0xFFFF) + (sum >> 16);
+/* Send UDP hello datagram to one collector */
+static void send_hello(uint32_t idx, uint32_t seq) {
+    static const char prefix[] = "S32K388 Hello #";
+    const uint8_t* dst_ip = g_collectors[idx];
+    uint8_t* payload = frame_tpl_begin(&g_hello_tpl[idx]);
+    uint16_t payload_len;
+
+    if (payload == NULL) {
+        g_tx_drop++;
+        LOG_D(TAG, "TX: no free buffer");
+        return;
     }
 
-    return (uint16_t)(~sum);
+    /* Header is prebuilt, only the payload is written here */
+    memcpy(payload, prefix, sizeof(prefix) - 1U);
+    payload_len = (uint16_t)(sizeof(prefix) - 1U);
+    payload_len += u32_to_dec(&payload[payload_len], seq);
+
+    if (frame_tpl_send(&g_hello_tpl[idx], payload_len) != ethtxOK) {
+        g_tx_drop++;
+    } else {
+        g_tx_count++;
+    }
+    LOG_I(TAG, "TX Hello #%lu to %d.%d.%d.%d%s", (unsigned long)seq,
+          dst_ip[0], dst_ip[1], dst_ip[2], dst_ip[3],
+          arp_lookup(dst_ip, NULL) ? "" : " (resolving)");
 }
 
 /*===========================================================================*/
-/*                          PACKET SEND FUNCTIONS                             */
+/*                          ICMP PING HANDLER                                 */
 /*===========================================================================*/
 
-/* Send packet using static buffer directly (driver has no internal TX buffers) */
-static Gmac_Ip_StatusType send_packet_data(const uint8_t* data, uint16_t len) {
-    Gmac_Ip_BufferType buf;
-    Gmac_Ip_StatusType status;
-    int retries = 20;
+/* TX completion of an in-place reply: the RX descriptor can be refilled */
+static void icmp_reply_done(uint8_t* buf, void* ctx) {
+    (void)ctx;
+    eth_rx_release(buf);
+}
 
-    /* Copy data to our DMA-accessible buffer if not already there */
-    if (data != g_tx_buffer) {
-        memcpy(g_tx_buffer, data, len);
-    }
+static bool handle_icmp(net_frame_t* f) {
+    uint8_t* pkt = f->frame;
+    const uint8_t* ip = f->l3;
 
-    buf.Data = g_tx_buffer;
-    buf.Length = len;
+    /* Check if destination is our IP */
+    if (f->l4 == NULL || memcmp(f->dst_ip, g_our_ip, 4) != 0) return false;
 
-    /* Retry loop in case TX queue is full */
-    while (retries > 0) {
-        status = Gmac_Ip_SendFrame(0, 0, &buf, NULL);
+    /* Request becomes the reply in the RX buffer, no payload copy or sum */
+    uint16_t total_len = icmp_echo_reply_in_place(f, g_our_mac);
+    if (total_len == 0U) return false;
 
-        if (status == GMAC_STATUS_SUCCESS) {
-            g_tx_count++;
-            LOG_D(TAG, "TX: sent %u bytes OK", (unsigned)len);
-            return status;
-        }
+    g_ping_count++;
 
-        if (status != GMAC_STATUS_TX_QUEUE_FULL) {
-            /* Other error - don't retry */
-            LOG_E(TAG, "TX: SendFrame error %d", (int)status);
-            return status;
+    /* Addresses are swapped now: the requester is the destination */
+    LOG_D(TAG, "PING from %d.%d.%d.%d (len=%u, ip_hdr=%u)",
+          ip[16], ip[17], ip[18], ip[19],
+          (unsigned)f->len, (unsigned)f->ip_hdr_len);
+
+    /* Zero-copy: transmit straight from the RX buffer, the descriptor is
+     * given back to the ring once the frame has left */
+    ethtxr_t res = ethtxBUSY;
+    if (eth_rx_can_hold()) {
+        res = eth_tx_send_ext(pkt, total_len, icmp_reply_done, NULL);
+        if (res == ethtxOK) {
+            eth_rx_hold();
         }
+    }
+    if (res != ethtxOK) {
+        /* Too many buffers held or ring full - fall back to a copy */
+        res = eth_tx_send_copy(pkt, total_len);
+    }
 
-        /* Queue full - wait and retry */
-        LOG_D(TAG, "TX: queue full, retry...");
-        delay_ms(1);
-        retries--;
+    if (res == ethtxOK) {
+        g_tx_count++;
+    } else {
+        g_tx_drop++;
+        LOG_E(TAG, "PONG failed: %d", (int)res);
     }
+    return true;
+}
+
+/*===========================================================================*/
+/*                          PROTOCOL REGISTRATION                             */
+/*===========================================================================*/
 
-    LOG_E(TAG, "TX: Failed after retries (queue full)");
-    return GMAC_STATUS_TX_QUEUE_FULL;
+/* Register ranges, MIB totals and VIDs in one blob; costs the bus reads only */
+static const uint8_t* lan_snap_cb(bool capture, uint16_t* len) {
+    lan9646_snap_cfg_t cfg = {
+        .mib = &g_lan_mib,
+        .vlan = &g_lan_vlan,
+    };
+
+    if (capture) {
+        cfg.ranges = lan9646_snap_default_ranges(&cfg.range_count);
+        cfg.time_ms = sys_timer_now_ms();
+        if (lan9646_snap_capture(&g_lan9646, &cfg, g_lan_snap, sizeof(g_lan_snap),
+                                 &g_lan_snap_len) == lan9646INVPARAM) {
+            g_lan_snap_len = 0;
+        }
+    }
+    *len = g_lan_snap_len;
+    return (g_lan_snap_len > 0U) ? g_lan_snap : NULL;
 }
 
-/* Send UDP broadcast packet */
-static void send_broadcast(void) {
-    static uint32_t seq = 0;
-    uint8_t* pkt = g_tx_buffer;
+/* Generator frames: zero-copy from its ring, back through the dispatcher */
+static void tgen_tx_done(uint8_t* buf, void* ctx) {
+    (void)ctx;
+    lan9646_tgen_tx_done(&g_tgen, buf);
+}
 
-    seq++;
+static bool tgen_send(uint8_t* frame, uint16_t len, void* arg) {
+    (void)arg;
+    return eth_tx_send_ext(frame, len, tgen_tx_done, NULL) == ethtxOK;
+}
 
-    /* Build payload first to know the length */
-    uint8_t* payload = &pkt[42];
-    int payload_len = snprintf((char*)payload, 100, "S32K388 Hello #%lu", (unsigned long)seq);
-
-    uint16_t udp_len = 8 + payload_len;
-    uint16_t ip_total_len = 20 + udp_len;
-    uint16_t eth_len = 14 + ip_total_len;
-
-    /* Ethernet header (14 bytes) */
-    memcpy(&pkt[0], g_bcast_mac, 6);      /* Dest MAC: broadcast */
-    memcpy(&pkt[6], g_our_mac, 6);        /* Src MAC: our MAC */
-    pkt[12] = 0x08; pkt[13] = 0x00;       /* EtherType: IP */
-
-    /* IP header (20 bytes) */
-    uint8_t* ip = &pkt[14];
-    ip[0] = 0x45;                         /* Version 4, IHL 5 */
-    ip[1] = 0x00;                         /* DSCP/ECN */
-    ip[2] = (ip_total_len >> 8) & 0xFF;
-    ip[3] = ip_total_len & 0xFF;          /* Total length */
-    ip[4] = (seq >> 8); ip[5] = seq;      /* ID */
-    ip[6] = 0x00; ip[7] = 0x00;           /* Flags/Fragment */
-    ip[8] = 64;                           /* TTL */
-    ip[9] = IP_PROTO_UDP;                 /* Protocol: UDP */
-    ip[10] = 0; ip[11] = 0;               /* Checksum (calculate later) */
-    memcpy(&ip[12], g_our_ip, 4);         /* Src IP */
-    memcpy(&ip[16], g_bcast_ip, 4);       /* Dst IP: broadcast */
-
-    /* IP checksum */
-    uint16_t ip_csum = ip_checksum(ip, 20);
-    ip[10] = ip_csum >> 8;
-    ip[11] = ip_csum & 0xFF;
-
-    /* UDP header (8 bytes) */
-    uint8_t* udp = &pkt[34];
-    udp[0] = 0x13; udp[1] = 0x88;         /* Src port: 5000 */
-    udp[2] = 0x13; udp[3] = 0x88;         /* Dst port: 5000 */
-    udp[4] = (udp_len >> 8) & 0xFF;
-    udp[5] = udp_len & 0xFF;              /* UDP Length */
-    udp[6] = 0x00; udp[7] = 0x00;         /* Checksum: 0 (optional for IPv4) */
-
-    /* Pad to minimum 60 bytes for Ethernet */
-    while (eth_len < 60) {
-        pkt[eth_len++] = 0;
-    }
-
-    send_packet_data(pkt, eth_len);
-    LOG_I(TAG, "TX Broadcast #%lu", (unsigned long)seq);
+static bool tgen_input(net_frame_t* f) {
+    return lan9646_tgen_rx(&g_tgen, f->l3, f->l3_len);
+}
+
+static void net_services_init(void) {
+    uint32_t i;
+
+    net_dispatch_init();
+    arp_init(g_our_mac, g_our_ip, g_netmask, g_gateway);
+    net_register_ethertype(NET_ETHERTYPE_ARP, "arp", arp_input);
+    net_register_ip_proto(NET_IP_PROTO_ICMP, "icmp", handle_icmp);
+    net_register_ethertype(LAN9646_TGEN_ETHERTYPE, "tgen", tgen_input);
+
+    /* Remote switch register access */
+    regsvc_init(&g_lan9646, g_our_mac);
+    regsvc_allow(g_collectors[0], g_regsvc_mask);
+    regsvc_set_snapshot(lan_snap_cb);
+    net_register_udp_port(REGSVC_UDP_PORT, "regsvc", regsvc_input);
+
+    for (i = 0; i < NUM_COLLECTORS; i++) {
+        frame_tpl_udp_init(&g_hello_tpl[i], g_our_mac, g_our_ip, g_collectors[i],
+                           HELLO_UDP_PORT, HELLO_UDP_PORT, 1U);
+    }
+}
+
+/* Checked with interrupts masked before the main loop sleeps */
+static bool net_work_pending(void) {
+    return eth_rx_pending() || eth_tx_pending() || tlm_pending()
+           || lan9646_async_pending(&g_lan_async) || lan9646_tgen_running(&g_tgen);
 }
 
 /*===========================================================================*/
-/*                          ARP HANDLER                                       */
+/*                          TELEMETRY SOURCES                                 */
 /*===========================================================================*/
 
-static void handle_arp(uint8_t* pkt, uint16_t len) {
-    if (len < 42) return;
+#define TELEMETRY_RATE_HZ       1000U
 
-    uint8_t* arp = &pkt[14];
-    uint16_t opcode = ((uint16_t)arp[6] << 8) | arp[7];
+/* Main loop timing, busy time only (sleep excluded), reset on every sample */
+static uint32_t g_loop_count;
+static uint32_t g_loop_busy_sum_us;
+static uint32_t g_loop_busy_max_us;
+static uint32_t g_loop_jobs;
 
-    /* Only handle ARP request (opcode 1) */
-    if (opcode != 1) return;
+static void tlm_src_gmac(void* arg) {
+    eth_rx_stats_t rx;
+    eth_tx_stats_t tx;
 
-    /* Check if target IP is our IP */
-    if (memcmp(&arp[24], g_our_ip, 4) != 0) return;
+    (void)arg;
+    eth_rx_get_stats(&rx);
+    eth_tx_get_stats(&tx);
 
-    g_arp_count++;
+    uint32_t rx_v[] = {rx.frames, rx.err_frames, rx.rbu_events,
+                       rx.fifo_overflows, rx.held, rx.max_burst};
+    uint32_t tx_v[] = {tx.queued, tx.completed, tx.tx_errors,
+                       tx.would_block, tx.max_inflight, eth_tx_free_count()};
+    tlm_record(TLM_REC_GMAC_RX, 0, rx_v, 6);
+    tlm_record(TLM_REC_GMAC_TX, 0, tx_v, 6);
+}
 
-    /* Get sender info */
-    uint8_t sender_mac[6];
-    uint8_t sender_ip[4];
-    memcpy(sender_mac, &arp[8], 6);
-    memcpy(sender_ip, &arp[14], 4);
+static void tlm_src_loop(void* arg) {
+    (void)arg;
 
-    LOG_I(TAG, "ARP Request from %d.%d.%d.%d",
-          sender_ip[0], sender_ip[1], sender_ip[2], sender_ip[3]);
+    uint32_t v[] = {g_loop_count,
+                    g_loop_count ? (g_loop_busy_sum_us / g_loop_count) : 0U,
+                    g_loop_busy_max_us,
+                    g_loop_jobs};
+    tlm_record(TLM_REC_LOOP, 0, v, 4);
 
-    /* Build ARP reply */
-    uint8_t* reply = g_tx_buffer;
+    g_loop_count = 0;
+    g_loop_busy_sum_us = 0;
+    g_loop_busy_max_us = 0;
+    g_loop_jobs = 0;
+}
 
-    /* Ethernet header */
-    memcpy(&reply[0], sender_mac, 6);     /* Dest MAC */
-    memcpy(&reply[6], g_our_mac, 6);      /* Src MAC */
-    reply[12] = 0x08; reply[13] = 0x06;   /* EtherType: ARP */
+static void tlm_src_net(void* arg) {
+    net_dispatch_stats_t net;
+    arp_stats_t arp;
 
-    /* ARP header */
-    reply[14] = 0x00; reply[15] = 0x01;   /* Hardware type: Ethernet */
-    reply[16] = 0x08; reply[17] = 0x00;   /* Protocol type: IP */
-    reply[18] = 6;                         /* Hardware size */
-    reply[19] = 4;                         /* Protocol size */
-    reply[20] = 0x00; reply[21] = 0x02;   /* Opcode: Reply */
-    memcpy(&reply[22], g_our_mac, 6);     /* Sender MAC (our MAC) */
-    memcpy(&reply[28], g_our_ip, 4);      /* Sender IP (our IP) */
-    memcpy(&reply[32], sender_mac, 6);    /* Target MAC */
-    memcpy(&reply[38], sender_ip, 4);     /* Target IP */
+    (void)arg;
+    net_dispatch_get_stats(&net);
+    arp_get_stats(&arp);
 
-    /* Pad to 60 bytes */
-    memset(&reply[42], 0, 18);
+    uint32_t v[] = {net.frames, net.vlan_frames, net.malformed,
+                    net.unhandled, arp.hits, arp.misses};
+    tlm_record(TLM_REC_NET, 0, v, 6);
+}
 
-    send_packet_data(reply, 60);
-    LOG_I(TAG, "ARP Reply sent");
+/* One record per switch port after every MIB snapshot */
+static void tlm_src_port(void* arg) {
+    static uint32_t last_snapshot;
+    lan9646_mib_stats_t st;
+    lan9646_mib_rate_t rate;
+    uint8_t port;
+
+    (void)arg;
+    lan9646_mib_get_stats(&g_lan_mib, &st);
+    if (st.snapshots == last_snapshot) return;
+    last_snapshot = st.snapshots;
+
+    for (port = 1; port <= LAN9646_MIB_PORTS; port++) {
+        if (!lan9646_mib_get_rate(&g_lan_mib, port, &rate)) continue;
+
+        uint32_t v[] = {rate.rx_pps, rate.tx_pps, rate.rx_bps, rate.tx_bps,
+                        (uint32_t)lan9646_mib_get(&g_lan_mib, port, LAN9646_MIB_RX_CRC_ERR),
+                        (uint32_t)(lan9646_mib_get(&g_lan_mib, port, LAN9646_MIB_RX_DROP)
+                                   + lan9646_mib_get(&g_lan_mib, port, LAN9646_MIB_TX_DROP))};
+        tlm_record(TLM_REC_PORT, port, v, 6);
+    }
+}
+
+static void telemetry_init(void) {
+    tlm_init(g_our_mac, g_our_ip, g_collectors[0], TLM_UDP_PORT);
+    tlm_add_source(tlm_src_gmac, NULL);
+    tlm_add_source(tlm_src_loop, NULL);
+    tlm_add_source(tlm_src_net, NULL);
+    tlm_add_source(tlm_src_port, NULL);
+    tlm_set_rate_hz(TELEMETRY_RATE_HZ);
 }
 
 /*===========================================================================*/
-/*                          ICMP PING HANDLER                                 */
+/*                          PERIODIC JOBS                                     */
 /*===========================================================================*/
 
-static void handle_icmp(uint8_t* pkt, uint16_t len) {
-    if (len < 42) return;  /* Min: 14 eth + 20 ip + 8 icmp */
+#define HELLO_PERIOD_MS         5000U
+#define STATUS_PERIOD_MS        5000U
+#define MIB_PERIOD_MS           5000U
+#define LINK_CHECK_MS           100U
+#define CFG_DRIFT_PERIOD_MS     60000U
 
-    uint8_t* ip = &pkt[14];
-    uint8_t ip_hdr_len = (ip[0] & 0x0F) * 4;
-    uint8_t* icmp = &pkt[14 + ip_hdr_len];
+static tw_job_t g_job_hello;
+static tw_job_t g_job_status;
+static tw_job_t g_job_arp;
+static tw_job_t g_job_mib;
+static tw_job_t g_job_link;
+static tw_job_t g_job_cfg;
 
-    /* Check ICMP type */
-    if (icmp[0] != ICMP_ECHO_REQUEST) return;
+static void job_hello(void* arg) {
+    static uint32_t seq = 0;
+    uint32_t i;
 
-    /* Check if destination is our IP */
-    if (memcmp(&ip[16], g_our_ip, 4) != 0) return;
+    (void)arg;
+    seq++;
+    for (i = 0; i < NUM_COLLECTORS; i++) {
+        send_hello(i, seq);
+    }
+}
 
-    g_ping_count++;
+static void job_arp(void* arg) {
+    (void)arg;
+    arp_tick();
+}
 
-    /* Get source info */
-    uint8_t src_mac[6];
-    uint8_t src_ip[4];
-    memcpy(src_mac, &pkt[6], 6);
-    memcpy(src_ip, &ip[12], 4);
-
-    LOG_I(TAG, "PING from %d.%d.%d.%d (len=%u, ip_hdr=%u)",
-          src_ip[0], src_ip[1], src_ip[2], src_ip[3],
-          (unsigned)len, (unsigned)ip_hdr_len);
-
-    /* Build ICMP echo reply - use same structure as received packet */
-    uint8_t* reply = g_tx_buffer;
-    uint16_t total_len = len;
-
-    /* Copy original packet */
-    memcpy(reply, pkt, len);
-
-    /* Swap MAC addresses */
-    memcpy(&reply[0], src_mac, 6);
-    memcpy(&reply[6], g_our_mac, 6);
-
-    /* Swap IP addresses */
-    uint8_t* reply_ip = &reply[14];
-    memcpy(&reply_ip[12], g_our_ip, 4);   /* Src IP: our IP */
-    memcpy(&reply_ip[16], src_ip, 4);     /* Dst IP: sender's IP */
-
-    /* Recalculate IP checksum */
-    reply_ip[10] = 0;
-    reply_ip[11] = 0;
-    uint16_t ip_csum = ip_checksum(reply_ip, ip_hdr_len);
-    reply_ip[10] = ip_csum >> 8;
-    reply_ip[11] = ip_csum & 0xFF;
-
-    /* Change ICMP type to echo reply */
-    uint8_t* reply_icmp = &reply[14 + ip_hdr_len];
-    reply_icmp[0] = ICMP_ECHO_REPLY;
-
-    /* Recalculate ICMP checksum */
-    uint16_t icmp_len = len - 14 - ip_hdr_len;
-    reply_icmp[2] = 0;
-    reply_icmp[3] = 0;
-    uint16_t icmp_csum = ip_checksum(reply_icmp, icmp_len);
-    reply_icmp[2] = icmp_csum >> 8;
-    reply_icmp[3] = icmp_csum & 0xFF;
-
-    LOG_I(TAG, "Sending PONG len=%u", (unsigned)total_len);
-    Gmac_Ip_StatusType status = send_packet_data(reply, total_len);
-    if (status == GMAC_STATUS_SUCCESS) {
-        LOG_I(TAG, "PONG sent OK");
-    } else {
-        LOG_E(TAG, "PONG failed: %d", (int)status);
+/* Check for link interrupts: the INTRP_N level when it is wired, else
+ * the interrupt summary (one I2C read when nothing changed) */
+static void job_link(void* arg) {
+    (void)arg;
+#ifdef LAN9646_INTRP_N_CHANNEL
+    if (Dio_ReadChannel(LAN9646_INTRP_N_CHANNEL) != STD_LOW) return;
+#endif
+    lan9646_switch_link_notify();
+}
+
+static void job_mib(void* arg) {
+    (void)arg;
+    /* The generator takes its own snapshots; a frozen pass would stop the
+     * switch counting its frames */
+    if (lan9646_tgen_running(&g_tgen)) return;
+    /* Runs in the background; a pass still going just skips this period */
+    lan9646_mib_snapshot_async(&g_lan_mib, &g_lan_async, sys_timer_now_ms());
+}
+
+static void lan_cfg_change_cb(const lan9646_config_change_t* chg, void* arg) {
+    (void)arg;
+    switch (chg->kind) {
+        case LAN9646_CONFIG_CHG_QUEUE:
+            LOG_I(TAG, "  cfg 0x%04X q%u: 0x%02lX -> 0x%02lX", chg->addr, chg->index,
+                  (unsigned long)chg->old_val, (unsigned long)chg->new_val);
+            break;
+        case LAN9646_CONFIG_CHG_VLAN:
+            LOG_I(TAG, "  cfg VID %u: 0x%08lX -> 0x%08lX", chg->addr,
+                  (unsigned long)chg->old_val, (unsigned long)chg->new_val);
+            break;
+        default:
+            LOG_I(TAG, "  cfg 0x%04X: 0x%02lX -> 0x%02lX", chg->addr,
+                  (unsigned long)chg->old_val, (unsigned long)chg->new_val);
+            break;
+    }
+}
+
+/* Compare the switch with g_lan_cfg; anything that drifted is logged and
+ * put back. Costs about 30 burst reads when nothing changed */
+static void job_cfg(void* arg) {
+    lan9646_config_report_t rep;
+
+    (void)arg;
+    if (lan9646_config_apply(&g_lan9646, &g_lan_vlan, &g_lan_cfg, true, NULL, NULL,
+                             &rep) != lan9646OK
+        || (rep.changed + rep.queues_changed + rep.vlans_changed) == 0) {
+        return;
     }
+    LOG_W(TAG, "Switch config drift: %u bytes, %u queues, %u VIDs, restoring",
+          rep.changed, rep.queues_changed, rep.vlans_changed);
+    lan9646_config_apply(&g_lan9646, &g_lan_vlan, &g_lan_cfg, false, lan_cfg_change_cb, NULL,
+                         &rep);
+}
+
+static void job_status(void* arg) {
+    eth_rx_stats_t rx_stats;
+    net_dispatch_stats_t net_stats;
+    arp_stats_t arp_stats;
+    tlm_stats_t tlm_stats;
+    regsvc_stats_t reg_stats;
+    lan9646_shadow_stats_t sh_stats;
+    lan9646_mib_stats_t mib_stats;
+    lan9646_async_stats_t async_stats;
+    lan9646_link_stats_t link_stats;
+    lan9646_alu_stats_t alu_stats;
+    lan9646_mib_rate_t p6;
+    lan9646_rate_status_t rs;
+    lan9646_qos_drops_t drops;
+    uint16_t alu_dyn = 0;
+    uint8_t port;
+#if LAN9646_USE_SPI
+    lpspi_stats_t spi_stats;
+#endif
+
+    (void)arg;
+    eth_rx_get_stats(&rx_stats);
+    net_dispatch_get_stats(&net_stats);
+    arp_get_stats(&arp_stats);
+    tlm_get_stats(&tlm_stats);
+    regsvc_get_stats(&reg_stats);
+    lan9646_shadow_get_stats(&g_lan9646, &sh_stats);
+    lan9646_mib_get_stats(&g_lan_mib, &mib_stats);
+    lan9646_async_get_stats(&g_lan_async, &async_stats);
+    lan9646_switch_link_get_stats(&link_stats);
+    lan9646_alu_dump(&g_lan_alu, NULL, NULL, &alu_dyn);
+    lan9646_alu_get_stats(&g_lan_alu, &alu_stats);
+
+    LOG_I(TAG, "Status: RX=%lu TX=%lu DROP=%lu PING=%lu ARP=%lu",
+          (unsigned long)net_stats.frames,
+          (unsigned long)g_tx_count,
+          (unsigned long)g_tx_drop,
+          (unsigned long)g_ping_count,
+          (unsigned long)arp_stats.replies_tx);
+    LOG_I(TAG, "RX path: wake=%lu max/wake=%lu budget_hit=%lu poll=%lu rbu=%lu ovf=%lu held=%lu",
+          (unsigned long)rx_stats.wakeups,
+          (unsigned long)rx_stats.max_burst,
+          (unsigned long)rx_stats.budget_hits,
+          (unsigned long)rx_stats.poll_entries,
+          (unsigned long)rx_stats.rbu_events,
+          (unsigned long)rx_stats.fifo_overflows,
+          (unsigned long)rx_stats.held);
+    net_dispatch_print_stats();
+    LOG_I(TAG, "ARP: hit=%lu miss=%lu req=%lu resolved=%lu timeout=%lu expired=%lu qdrop=%lu",
+          (unsigned long)arp_stats.hits,
+          (unsigned long)arp_stats.misses,
+          (unsigned long)arp_stats.requests_tx,
+          (unsigned long)arp_stats.resolved,
+          (unsigned long)arp_stats.timeouts,
+          (unsigned long)arp_stats.expired,
+          (unsigned long)arp_stats.queue_drops);
+    LOG_I(TAG, "TLM: samples=%lu records=%lu dgrams=%lu lost=%lu late=%lu",
+          (unsigned long)tlm_stats.samples,
+          (unsigned long)tlm_stats.records,
+          (unsigned long)tlm_stats.datagrams,
+          (unsigned long)tlm_stats.lost,
+          (unsigned long)tlm_stats.late);
+    LOG_I(TAG, "REGSVC: req=%lu retry=%lu ops=%lu err=%lu bad=%lu denied=%lu txdrop=%lu",
+          (unsigned long)reg_stats.requests,
+          (unsigned long)reg_stats.retries,
+          (unsigned long)reg_stats.ops,
+          (unsigned long)reg_stats.op_errors,
+          (unsigned long)reg_stats.bad,
+          (unsigned long)reg_stats.denied,
+          (unsigned long)reg_stats.tx_drops);
+#if LAN9646_USE_SPI
+    lpspi_get_stats(&g_spi, &spi_stats);
+    LOG_I(TAG, "LAN SPI: frames=%lu dma=%lu bytes=%lu timeout=%lu err=%lu",
+          (unsigned long)spi_stats.frames,
+          (unsigned long)spi_stats.dma_frames,
+          (unsigned long)spi_stats.bytes,
+          (unsigned long)spi_stats.timeouts,
+          (unsigned long)spi_stats.errors);
+#endif
+    LOG_I(TAG, "LAN shadow: hit=%lu miss=%lu bus_rd=%lu bus_wr=%lu mdio=%lu",
+          (unsigned long)sh_stats.hits,
+          (unsigned long)sh_stats.misses,
+          (unsigned long)sh_stats.bus_reads,
+          (unsigned long)sh_stats.bus_writes,
+          (unsigned long)g_lan9646.phy_bus_ops);
+    LOG_I(TAG, "MIB: snap=%lu counters=%lu txn=%lu polls=%lu err=%lu",
+          (unsigned long)mib_stats.snapshots,
+          (unsigned long)mib_stats.counters,
+          (unsigned long)mib_stats.transactions,
+          (unsigned long)mib_stats.polls,
+          (unsigned long)mib_stats.errors);
+    LOG_I(TAG, "LAN async: done=%lu err=%lu full=%lu jumps=%lu depth=%u slice=%u quiesce=%lu",
+          (unsigned long)async_stats.completed,
+          (unsigned long)async_stats.errors,
+          (unsigned long)async_stats.full,
+          (unsigned long)async_stats.jumps,
+          (unsigned)async_stats.max_depth,
+          (unsigned)async_stats.max_used,
+          (unsigned long)async_stats.quiesced);
+    LOG_I(TAG, "LINK: up=0x%02X notify=%lu summary=%lu events=%lu changes=%lu",
+          g_links_up,
+          (unsigned long)link_stats.notifies,
+          (unsigned long)link_stats.summary_reads,
+          (unsigned long)link_stats.port_events,
+          (unsigned long)link_stats.changes);
+    LOG_I(TAG, "ALU: static=0x%04X dynamic=%u ops=%lu polls=%lu timeout=%lu",
+          g_lan_alu.used, alu_dyn,
+          (unsigned long)alu_stats.table_ops,
+          (unsigned long)alu_stats.polls,
+          (unsigned long)alu_stats.timeouts);
+    if (lan9646_mib_get_rate(&g_lan_mib, 6, &p6)) {
+        LOG_I(TAG, "Port 6: rx %lu pps %lu bps, tx %lu pps %lu bps",
+              (unsigned long)p6.rx_pps, (unsigned long)p6.rx_bps,
+              (unsigned long)p6.tx_pps, (unsigned long)p6.tx_bps);
+    }
+    if (lan9646_qos_get_drops(&g_lan_mib, 6, &drops) == lan9646OK) {
+        LOG_I(TAG, "QOS p6: rxdrop=%lu txdrop=%lu hi_bytes=%lu",
+              (unsigned long)drops.rx_drop, (unsigned long)drops.tx_drop,
+              (unsigned long)drops.tx_hi_prio_bytes);
+    }
+    for (port = 1; port <= 4; port++) {
+        if (lan9646_rate_get_status(&g_lan_rate, &g_lan_mib, port, &rs) != lan9646OK) continue;
+        LOG_I(TAG, "RATE p%u: rx %lu of %lu bps", port,
+              (unsigned long)rs.rx_bps, (unsigned long)rs.in_limit_bps);
+    }
+    tw_print_stats();
 }
 
 /*===========================================================================*/
-/*                          PACKET RECEIVE HANDLER                            */
+/*                          LAN9646 INIT                                      */
 /*===========================================================================*/
 
-static void process_rx_packet(uint8_t* pkt, uint16_t len) {
-    if (len < 14) return;
+static void on_link_change(uint8_t port, bool link_up, lan9646_speed_t speed,
+                           lan9646_duplex_t duplex) {
+    static const char* const speed_str[] = {"10M", "100M", "1000M", "-"};
+    uint8_t bit = (uint8_t)(1U << (port - 1U));
 
-    g_rx_count++;
+    if (link_up) {
+        g_links_up |= bit;
+    } else {
+        g_links_up &= (uint8_t)~bit;
+    }
+    LOG_I(TAG, "Port %u link %s %s %s", port, link_up ? "UP" : "DOWN",
+          speed_str[speed], link_up ? (duplex == LAN9646_DUPLEX_FULL ? "FD" : "HD") : "");
 
-    /* Get EtherType */
-    uint16_t eth_type = ((uint16_t)pkt[12] << 8) | pkt[13];
+    TrcvLinkStateGlobal = g_links_up ? ETHTRCV_LINK_STATE_ACTIVE : ETHTRCV_LINK_STATE_DOWN;
 
-    switch (eth_type) {
-        case ETH_TYPE_ARP:
-            handle_arp(pkt, len);
-            break;
+    /* Rate codes are in units of the link speed */
+    if (link_up) {
+        lan9646_rate_set_link_speed(&g_lan_rate, port, speed);
+    }
 
-        case ETH_TYPE_IP:
-            /* Check IP protocol */
-            if (len >= 34) {
-                uint8_t proto = pkt[23];  /* IP protocol field */
-                if (proto == IP_PROTO_ICMP) {
-                    handle_icmp(pkt, len);
-                }
-            }
-            break;
+    /* Peers behind the new link may hold a stale entry for us */
+    if (link_up) {
+        arp_announce();
+    }
+}
 
-        default:
-            /* Ignore other packet types */
-            break;
+/* Warm restarts find most of the setup in place: only the differences are
+ * written, and every one of them is logged */
+static void init_switch_cfg(void) {
+    lan9646_config_report_t rep;
+    uint32_t t0 = sys_timer_now_ms();
+    lan9646r_t res;
+
+    lan9646_vlan_init(&g_lan_vlan, &g_lan9646);
+    res = lan9646_config_apply(&g_lan9646, &g_lan_vlan, &g_lan_cfg, false, lan_cfg_change_cb,
+                               NULL, &rep);
+    if (res != lan9646OK) {
+        LOG_W(TAG, "  Switch config not fully applied (res=%d, verify errors=%u)",
+              (int)res, rep.verify_errors);
+    }
+    LOG_I(TAG, "  CFG: %u/%u bytes, %u/%u queues, %u/%u VIDs changed, %u reads %u writes, %lu ms",
+          rep.changed, rep.checked, rep.queues_changed, rep.queues_checked,
+          rep.vlans_changed, rep.vlans_checked, rep.reads, rep.writes,
+          (unsigned long)(sys_timer_now_ms() - t0));
+}
+
+/*
+ * Frames to our MAC always go to port 6 through a static entry, and
+ * unicast to unknown MACs is flooded to the PHY ports only, so the GMAC
+ * no longer sees traffic between hosts on the other ports.
+ */
+static void init_alu(void) {
+    lan9646_alu_entry_t cpu = {
+        .port_map = 0x20U,     /* Port 6 */
+    };
+
+    memcpy(cpu.mac, g_our_mac, sizeof(cpu.mac));
+
+    if (lan9646_alu_init(&g_lan_alu, &g_lan9646) != lan9646OK
+        || lan9646_alu_static_add(&g_lan_alu, &cpu) != lan9646OK) {
+        LOG_W(TAG, "  CPU MAC static entry not set");
+        return;
     }
+    /* The static entry covers our MAC: nothing on port 6 needs learning */
+    lan9646_alu_set_learning(&g_lan_alu, 6, false);
+    lan9646_alu_set_unknown_unicast(&g_lan_alu, LAN9646_PORT_MASK_PHY);
+    LOG_I(TAG, "  ALU: CPU MAC pinned to port 6, static=0x%04X", g_lan_alu.used);
 }
 
-static void poll_rx(void) {
-    Gmac_Ip_BufferType buf;
-    Gmac_Ip_RxInfoType rx_info;
-    Gmac_Ip_StatusType status;
+static void init_acl(void) {
+    uint8_t port;
 
-    /* Try to read a frame - driver returns buffer from internal ring */
-    status = Gmac_Ip_ReadFrame(0, 0, &buf, &rx_info);
+    for (port = 1; port <= 4; port++) {
+        if (lan9646_acl_program(&g_lan9646, port, g_lan_acl, LAN_TABLE_LEN(g_lan_acl)) != lan9646OK
+            || lan9646_acl_verify(&g_lan9646, port, g_lan_acl, LAN_TABLE_LEN(g_lan_acl),
+                                  NULL) != lan9646OK) {
+            LOG_W(TAG, "  ACL on port %u not applied", port);
+        }
+    }
+    LOG_I(TAG, "  ACL: %u rule(s) on ports 1-4", LAN_TABLE_LEN(g_lan_acl));
+}
 
-    if (status == GMAC_STATUS_SUCCESS) {
-        /* Process the received packet */
-        process_rx_packet(buf.Data, rx_info.PktLen);
+static void init_rate(void) {
+    uint8_t port;
 
-        /* Return buffer to driver */
-        Gmac_Ip_ProvideRxBuff(0, 0, &buf);
+    lan9646_rate_init(&g_lan_rate, &g_lan9646);
+    for (port = 1; port <= 4; port++) {
+        if (lan9646_rate_set_ingress(&g_lan_rate, port, LAN9646_RATE_ALL_PRIO,
+                                     LAN_INGRESS_LIMIT_BPS) != lan9646OK) {
+            LOG_W(TAG, "  Ingress limit on port %u not set", port);
+        }
+    }
+    if (lan9646_rate_set_storm(&g_lan_rate, LAN_STORM_PCT, true,
+                               LAN9646_PORT_MASK_PHY) != lan9646OK) {
+        LOG_W(TAG, "  Storm control not set");
     }
+    LOG_I(TAG, "  RATE: ports 1-4 ingress %lu bps, storm %u%%",
+          (unsigned long)LAN_INGRESS_LIMIT_BPS, LAN_STORM_PCT);
 }
 
-/*===========================================================================*/
-/*                          LAN9646 INIT                                      */
-/*===========================================================================*/
+static void init_link_monitor(void) {
+    lan9646_port_status_t st[4];
+    uint8_t i;
+
+    lan9646_switch_set_link_callback(&g_lan9646, on_link_change);
+    if (lan9646_switch_link_irq_init(&g_lan9646, LAN9646_PORT_MASK_PHY) != lan9646OK) {
+        LOG_W(TAG, "LAN9646 link interrupts not enabled");
+    }
+    g_links_up = lan9646_switch_get_all_phy_status(&g_lan9646, st);
+    for (i = 0; i < 4; i++) {
+        if (st[i].link_up) {
+            lan9646_rate_set_link_speed(&g_lan_rate, st[i].port, st[i].speed);
+        }
+    }
+    TrcvLinkStateGlobal = g_links_up ? ETHTRCV_LINK_STATE_ACTIVE : ETHTRCV_LINK_STATE_DOWN;
+    LOG_I(TAG, "  PHY links up: 0x%02X", g_links_up);
+}
+
+#if LAN_TGEN_AT_BOOT
+static void init_tgen(void) {
+    static const uint16_t sizes[] = {64, 128, 256, 512, 1024, 1280, 1518};
+    lan9646_tgen_cfg_t cfg = {
+        .dev = &g_lan9646,
+        .mib = &g_lan_mib,
+        .port = 6,
+        .mac = g_our_mac,
+        .ring = &g_tgen_ring[0][0],
+        .ring_len = LAN_TGEN_RING,
+        .stride = ETH_TX_BUF_SIZE,
+        .sizes = sizes,
+        .size_count = (uint8_t)LAN_TABLE_LEN(sizes),
+        .pattern = LAN9646_TGEN_PAT_PRBS,
+        .verify = true,
+        .duration_ms = LAN_TGEN_STEP_MS,
+        .drain_ms = LAN_TGEN_DRAIN_MS,
+        .link_mbps = 1000,
+        .send_fn = tgen_send,
+    };
+
+    if (lan9646_tgen_start(&g_tgen, &cfg, sys_timer_now_ms()) != lan9646OK) {
+        LOG_W(TAG, "Traffic generator not started");
+    }
+}
+#endif
 
 static lan9646r_t init_lan9646(void) {
     LOG_I(TAG, "Initializing LAN9646...");
 
+#if LAN9646_USE_SPI
+    lan9646_cfg_t cfg = {
+        .if_type = LAN9646_IF_SPI,
+        .phy_addr = LAN9646_MDIO_PHY_BASE,
+        .ops.spi = {
+            .init_fn = spi_init_cb,
+            .frame_fn = spi_frame_cb,
+        },
+    };
+#else
     lan9646_cfg_t cfg = {
         .if_type = LAN9646_IF_I2C,
         .i2c_addr = 0x5F,
+        .phy_addr = LAN9646_MDIO_PHY_BASE,
         .ops.i2c = {
             .init_fn = i2c_init_cb,
             .write_fn = i2c_write_cb,
@@ -472,30 +1092,33 @@ static lan9646r_t init_lan9646(void) {
             .mem_read_fn = i2c_mem_read_cb,
         },
     };
+#endif
 
     if (lan9646_init(&g_lan9646, &cfg) != lan9646OK) {
         LOG_E(TAG, "LAN9646 init FAILED!");
         return lan9646ERR;
     }
 
+    lan9646_async_init(&g_lan_async, &g_lan_async_bus);
+
+    lan9646_shadow_attach(&g_lan9646, &g_lan_shadow, g_lan_shadow_ranges,
+                          (uint8_t)(sizeof(g_lan_shadow_ranges) / sizeof(g_lan_shadow_ranges[0])));
+
     uint16_t chip_id;
     uint8_t revision;
     lan9646_get_chip_id(&g_lan9646, &chip_id, &revision);
     LOG_I(TAG, "  Chip ID: 0x%04X", chip_id);
 
-    /* Configure Port 6 for RGMII 1Gbps */
-    lan_write8(0x6300, 0x68);  /* XMII_CTRL0: Full duplex */
-    lan_write8(0x6301, 0x18);  /* XMII_CTRL1: 1Gbps + TX_ID + RX_ID */
+    /* Ports, QoS and VLANs, then 802.1Q mode and switch start */
+    init_switch_cfg();
 
-    /* Enable switch */
-    lan_write8(0x0300, 0x01);
+    /* Snapshots run frozen so all ports are sampled at the same instant */
+    lan9646_mib_init(&g_lan_mib, &g_lan9646, MIB_PORT_MASK, true);
 
-    /* Port membership */
-    lan_write32(0x6A04, 0x4F);
-    lan_write32(0x1A04, 0x6E);
-    lan_write32(0x2A04, 0x6D);
-    lan_write32(0x3A04, 0x6B);
-    lan_write32(0x4A04, 0x67);
+    init_alu();
+    init_acl();
+    init_rate();
+    init_link_monitor();
 
     LOG_I(TAG, "LAN9646 OK");
     return lan9646OK;
@@ -544,6 +1167,9 @@ int main(void) {
     Mcu_DistributePllClock();
     Mcu_SetMode(McuModeSettingConf_0);
 
+    /* Microsecond time base (STM_0), also backs OSIF_COUNTER_CUSTOM */
+    bool timer_ok = sys_timer_init();
+
     Platform_Init(NULL_PTR);
 
     /* GPT for OsIf timing */
@@ -567,10 +1193,14 @@ int main(void) {
     LOG_I(TAG, "============================================");
     LOG_I(TAG, "");
 
+    if (!timer_ok) {
+        LOG_E(TAG, "STM0 clock is not a multiple of 1MHz - time base stopped!");
+    }
+
     /* LAN9646 Init */
     if (init_lan9646() != lan9646OK) {
         LOG_E(TAG, "FATAL: LAN9646 init failed!");
-        while (1) { delay_ms(1000); }
+        while (1) { sys_timer_idle(NULL); }
     }
 
     /* GMAC Init */
@@ -581,40 +1211,83 @@ int main(void) {
     configure_s32k388_rgmii();
     LOG_I(TAG, "GMAC OK");
 
+#if LAN9646_PHY_MDIO
+    /* MDIO is up now: link polling and PHY diagnostics leave the I2C bus */
+    if (lan9646_set_phy_bus(&g_lan9646, &g_lan_mdio) != lan9646OK) {
+        LOG_W(TAG, "PHY MDIO route failed, PHYs stay on the switch bus");
+    }
+#endif
+
+    /* TX: buffer pool, RX: drain ring on interrupt wake-up */
+    eth_tx_init(ETH_CTRL_IDX, 0U);
+    net_services_init();
+    eth_rx_init(ETH_CTRL_IDX, 0U, net_dispatch, ETH_RX_BUDGET_DEFAULT);
+
     /* Wait for link */
-    delay_ms(100);
+    sys_timer_delay_ms(100);
+
+    /* Link is up: announce our address so peers refresh their caches */
+    arp_announce();
+
+    /* Periodic jobs */
+    tw_init();
+    tw_start_periodic(&g_job_hello, "hello", HELLO_PERIOD_MS, job_hello, NULL);
+    tw_start_periodic(&g_job_status, "status", STATUS_PERIOD_MS, job_status, NULL);
+    tw_start_periodic(&g_job_arp, "arp", ARP_TICK_MS, job_arp, NULL);
+    tw_start_periodic(&g_job_mib, "mib", MIB_PERIOD_MS, job_mib, NULL);
+    tw_start_periodic(&g_job_link, "link", LINK_CHECK_MS, job_link, NULL);
+    tw_start_periodic(&g_job_cfg, "cfg", CFG_DRIFT_PERIOD_MS, job_cfg, NULL);
+
+    /* Binary telemetry to the first collector */
+    telemetry_init();
 
     LOG_I(TAG, "");
-    LOG_I(TAG, "Ready! Broadcast every 5s, responding to ping...");
+    LOG_I(TAG, "Ready! Hello to collectors every 5s, responding to ping...");
     LOG_I(TAG, "");
 
+#if LAN_TGEN_AT_BOOT
+    init_tgen();
+#endif
+
     /*=======================================================================*/
     /*                          MAIN LOOP                                    */
     /*=======================================================================*/
 
-    uint32_t loop = 0;
-    uint32_t last_bcast = 0;
-
     for (;;) {
-        /* Poll for received packets */
-        poll_rx();
-
-        /* Broadcast every 5 seconds (5000 iterations * ~1ms delay = 5s) */
-        loop++;
-        if (loop - last_bcast >= 5000) {
-            send_broadcast();
-            last_bcast = loop;
-
-            /* Print status */
-            LOG_I(TAG, "Status: RX=%lu TX=%lu PING=%lu ARP=%lu",
-                  (unsigned long)g_rx_count,
-                  (unsigned long)g_tx_count,
-                  (unsigned long)g_ping_count,
-                  (unsigned long)g_arp_count);
+        uint32_t loop_start = sys_timer_now_us();
+
+        /* Drain every ready descriptor (up to the budget) */
+        eth_rx_drain();
+
+        /* Return transmitted buffers to the pool */
+        eth_tx_reclaim();
+
+        /* Run due jobs (hello, status, ARP aging, ...) */
+        g_loop_jobs += tw_run();
+
+        /* Switch link interrupts, debounced callbacks; waits at most for
+         * the one queued transaction on the bus */
+        lan9646_switch_link_service(&g_lan9646, sys_timer_now_ms());
+
+        /* Background switch traffic (MIB), one bounded slice */
+        lan9646_async_service(&g_lan_async, LAN_ASYNC_BUDGET);
+
+        /* Sample telemetry sources, send full/aged datagrams */
+        tlm_poll();
+
+        /* Throughput benchmark, refills its ring when running */
+        lan9646_tgen_poll(&g_tgen, sys_timer_now_ms());
+
+        uint32_t busy = sys_timer_elapsed_us(loop_start);
+        g_loop_count++;
+        g_loop_busy_sum_us += busy;
+        if (busy > g_loop_busy_max_us) {
+            g_loop_busy_max_us = busy;
         }
 
-        /* Small delay to prevent tight loop */
-        delay_ms(1);
+        /* Sleep until the next RX/TX interrupt or 1ms PIT tick
+         * (never while the RX ring is being polled) */
+        sys_timer_idle(net_work_pending);
     }
 
     return 0;
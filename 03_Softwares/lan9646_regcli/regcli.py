@@ -0,0 +1,236 @@
+#!/usr/bin/env python3
+"""
+Client for the S32K388 LAN9646 register service (src/NET/regsvc.h).
+
+Every command is sent as one batched request; retries reuse the request
+ID, so the board answers them from its reply cache without repeating
+writes or read-clear MIB reads.
+
+The board answers only the source allowed by regsvc_allow() in main.c
+(the first collector, 192.168.1.100); requests from any other address
+are dropped without a reply and look like a timeout here.
+
+    python3 regcli.py [--host 192.168.1.200] read 0x6300 -w 1
+    python3 regcli.py write 0x6301 0x18 -w 1
+    python3 regcli.py modify 0x6301 0x18 0x08 -w 1
+    python3 regcli.py burst 0x6000 64
+    python3 regcli.py mib 6
+    python3 regcli.py port 6
+    python3 regcli.py ops r1:0x0001 r1:0x0002 w1:0x6301=0x18 m1:0x6301/0x18=0x08
+"""
+
+import argparse
+import os
+import random
+import socket
+import struct
+import sys
+
+HDR = struct.Struct("<HBBIB3x")     # magic, version, count, req_id, status
+OP = struct.Struct("<BBHII")        # code, size, addr, value, mask
+RES = struct.Struct("<BBH")         # code, status, len
+
+REGSVC_PORT = 5002
+REGSVC_MAGIC = 0x5252
+REGSVC_VERSION = 1
+
+OP_READ, OP_WRITE, OP_MODIFY, OP_READ_BURST, OP_WRITE_BURST, OP_MIB, OP_SNAPSHOT = range(1, 8)
+STATUS_NAMES = {0: "OK", 1: "TRUNC", 2: "BADREQ"}
+DRV_STATUS = {0: "OK", 1: "ERR", 2: "TIMEOUT", 3: "INVPARAM", 4: "BUSERR"}
+
+# Port register blocks pulled by the "port" command (offset, length)
+PORT_BLOCKS = [
+    (0x000, 0x40),      # Default tag, PME, interrupts, operation control, status
+    (0x100, 0x40),      # PHY registers (ports 1-4 only)
+    (0x300, 0x02),      # XMII control (ports 6-7)
+    (0x400, 0x30),      # MAC control, rate limiting
+    (0x800, 0x10),      # Ingress classification, mirroring, priority
+    (0x900, 0x10),      # Scheduling, shaping
+    (0xA00, 0x10),      # Queue control, membership
+    (0xB00, 0x08),      # Address lookup, MSTP
+]
+
+# MIB index ranges (datasheet table 5-6)
+MIB_RANGES = [(0x00, 0x20), (0x80, 0x04)]
+
+
+class Op:
+    def __init__(self, code, addr, size=4, value=0, mask=0, data=b""):
+        self.code, self.addr, self.size = code, addr, size
+        self.value, self.mask, self.data = value, mask, data
+
+    def encode(self):
+        out = OP.pack(self.code, self.size, self.addr, self.value, self.mask)
+        if self.code == OP_WRITE_BURST:
+            out += self.data + b"\0" * (-len(self.data) % 4)
+        return out
+
+
+class RegClient:
+    def __init__(self, host, port, timeout, retries):
+        self.addr = (host, port)
+        self.retries = retries
+        self.sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        self.sock.settimeout(timeout)
+        self.req_id = random.getrandbits(32)
+
+    def _transact(self, ops):
+        self.req_id = (self.req_id + 1) & 0xFFFFFFFF
+        req = HDR.pack(REGSVC_MAGIC, REGSVC_VERSION, len(ops), self.req_id, 0)
+        req += b"".join(op.encode() for op in ops)
+
+        for _ in range(self.retries + 1):
+            self.sock.sendto(req, self.addr)
+            try:
+                while True:
+                    data, _ = self.sock.recvfrom(2048)
+                    if len(data) < HDR.size:
+                        continue
+                    magic, ver, count, req_id, status = HDR.unpack_from(data, 0)
+                    if magic == REGSVC_MAGIC and req_id == self.req_id:
+                        return status, count, data
+            except socket.timeout:
+                continue
+        raise TimeoutError(f"no reply from {self.addr[0]}:{self.addr[1]}")
+
+    def run(self, ops):
+        """Run ops, split over several requests if a reply is truncated.
+        Returns a list of (op, driver_status, data)."""
+        results = []
+        pending = list(ops)
+        while pending:
+            status, count, data = self._transact(pending[:255])
+            if status == 2:
+                raise ValueError("board rejected the request as malformed")
+            if count == 0:
+                raise RuntimeError(f"no progress, status {STATUS_NAMES.get(status, status)}")
+            off = HDR.size
+            for op in pending[:count]:
+                code, drv, n = RES.unpack_from(data, off)
+                off += RES.size
+                results.append((op, drv, data[off:off + n]))
+                off += n + (-n % 4)
+            pending = pending[count:]
+        return results
+
+
+def parse_int(s):
+    return int(s, 0)
+
+
+def parse_token(tok):
+    """r4:ADDR  w2:ADDR=VAL  m1:ADDR/MASK=VAL  b:ADDR+LEN  mib:PORT[+FIRST[+COUNT]]"""
+    kind, _, rest = tok.partition(":")
+    if kind == "b":
+        addr, _, n = rest.partition("+")
+        return Op(OP_READ_BURST, parse_int(addr), value=parse_int(n))
+    if kind == "mib":
+        parts = rest.split("+")
+        first = parse_int(parts[1]) if len(parts) > 1 else 0
+        count = parse_int(parts[2]) if len(parts) > 2 else 1
+        return Op(OP_MIB, parse_int(parts[0]), size=count, value=first)
+    size = int(kind[1:] or "4")
+    if kind[0] == "r":
+        return Op(OP_READ, parse_int(rest), size)
+    if kind[0] == "w":
+        addr, _, val = rest.partition("=")
+        return Op(OP_WRITE, parse_int(addr), size, value=parse_int(val))
+    if kind[0] == "m":
+        lhs, _, val = rest.partition("=")
+        addr, _, mask = lhs.partition("/")
+        return Op(OP_MODIFY, parse_int(addr), size, value=parse_int(val), mask=parse_int(mask))
+    raise ValueError(f"bad op token: {tok}")
+
+
+def hexdump(base, data):
+    for i in range(0, len(data), 16):
+        chunk = data[i:i + 16]
+        print(f"  {base + i:04X}: " + " ".join(f"{b:02X}" for b in chunk))
+
+
+def print_results(results):
+    errors = 0
+    for op, drv, data in results:
+        st = "" if drv == 0 else f"  [{DRV_STATUS.get(drv, drv)}]"
+        errors += drv != 0
+        w = op.size * 2
+        if op.code == OP_READ:
+            print(f"R{op.size * 8:<2} {op.addr:04X} = 0x{struct.unpack('<I', data)[0]:0{w}X}{st}")
+        elif op.code == OP_WRITE:
+            print(f"W{op.size * 8:<2} {op.addr:04X} <- 0x{op.value:0{w}X}{st}")
+        elif op.code == OP_MODIFY:
+            old = struct.unpack("<I", data)[0]
+            new = (old & ~op.mask) | (op.value & op.mask)
+            print(f"M{op.size * 8:<2} {op.addr:04X} 0x{old:0{w}X} -> 0x{new:0{w}X}{st}")
+        elif op.code == OP_READ_BURST:
+            print(f"burst {op.addr:04X}+{op.value}{st}")
+            hexdump(op.addr, data)
+        elif op.code == OP_WRITE_BURST:
+            print(f"burst write {op.addr:04X}+{op.value}{st}")
+        elif op.code == OP_MIB:
+            vals = struct.unpack(f"<{len(data) // 4}I", data)
+            for i, v in enumerate(vals):
+                print(f"MIB port {op.addr} [0x{op.value + i:02X}] = {v}{st}")
+    return errors
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("--host", default=os.environ.get("REGSVC_HOST", "192.168.1.200"))
+    ap.add_argument("--port", type=int, default=REGSVC_PORT)
+    ap.add_argument("--timeout", type=float, default=0.5)
+    ap.add_argument("--retries", type=int, default=3)
+    sub = ap.add_subparsers(dest="cmd", required=True)
+
+    p = sub.add_parser("read")
+    p.add_argument("addr", type=parse_int)
+    p.add_argument("-w", "--width", type=int, choices=[1, 2, 4], default=4)
+    p = sub.add_parser("write")
+    p.add_argument("addr", type=parse_int)
+    p.add_argument("value", type=parse_int)
+    p.add_argument("-w", "--width", type=int, choices=[1, 2, 4], default=4)
+    p = sub.add_parser("modify")
+    p.add_argument("addr", type=parse_int)
+    p.add_argument("mask", type=parse_int)
+    p.add_argument("value", type=parse_int)
+    p.add_argument("-w", "--width", type=int, choices=[1, 2, 4], default=4)
+    p = sub.add_parser("burst")
+    p.add_argument("addr", type=parse_int)
+    p.add_argument("length", type=parse_int)
+    p = sub.add_parser("mib", help="read all MIB counters of a port (read-clear)")
+    p.add_argument("sw_port", metavar="port", type=int)
+    p = sub.add_parser("port", help="pull a port's register blocks in one round trip")
+    p.add_argument("sw_port", metavar="port", type=int)
+    p = sub.add_parser("ops", help="free-form batch, see parse_token()")
+    p.add_argument("tokens", nargs="+")
+    args = ap.parse_args()
+
+    if args.cmd == "read":
+        ops = [Op(OP_READ, args.addr, args.width)]
+    elif args.cmd == "write":
+        ops = [Op(OP_WRITE, args.addr, args.width, value=args.value)]
+    elif args.cmd == "modify":
+        ops = [Op(OP_MODIFY, args.addr, args.width, value=args.value, mask=args.mask)]
+    elif args.cmd == "burst":
+        ops = [Op(OP_READ_BURST, args.addr + off, value=min(256, args.length - off))
+               for off in range(0, args.length, 256)]
+    elif args.cmd == "mib":
+        ops = [Op(OP_MIB, args.sw_port, size=n, value=first) for first, n in MIB_RANGES]
+    elif args.cmd == "port":
+        base = args.sw_port << 12
+        ops = [Op(OP_READ_BURST, base | off, value=n) for off, n in PORT_BLOCKS
+               if off != 0x100 or 1 <= args.sw_port <= 4]
+    else:
+        ops = [parse_token(t) for t in args.tokens]
+
+    client = RegClient(args.host, args.port, args.timeout, args.retries)
+    try:
+        results = client.run(ops)
+    except (TimeoutError, ValueError, RuntimeError) as e:
+        print(f"error: {e}", file=sys.stderr)
+        return 2
+    return 1 if print_results(results) else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
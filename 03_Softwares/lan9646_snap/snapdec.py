@@ -0,0 +1,262 @@
+#!/usr/bin/env python3
+"""
+Fetch and decode LAN9646 binary register snapshots (src/LAN9646/lan9646_snap.h).
+
+The board captures the snapshot at offset 0 of REGSVC_OP_SNAPSHOT and
+sends it in pieces; everything else (naming fields, diffing two
+snapshots) happens here.
+
+    python3 snapdec.py [--host 192.168.1.200] fetch -o before.snap
+    python3 snapdec.py show before.snap [--view port]
+    python3 snapdec.py diff before.snap after.snap
+"""
+
+import argparse
+import os
+import struct
+import sys
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "lan9646_regcli"))
+from regcli import DRV_STATUS, OP_SNAPSHOT, REGSVC_PORT, Op, RegClient  # noqa: E402
+
+HDR = struct.Struct("<IBBHIIHBx")   # magic, version, flags, records, length, time_ms, chip_id, rev
+REC = struct.Struct("<BBHH")        # type, port, addr, len
+VID = struct.Struct("<HBBBx")       # vid, members, untag, fid
+
+SNAP_MAGIC = 0x504E534C
+SNAP_VERSION = 1
+CHUNK = 1440
+
+REC_REGS, REC_MIB, REC_VLAN = 1, 2, 3
+FLAG_NAMES = {0x01: "TRUNC", 0x02: "BUSERR", 0x04: "MIB_BUSY"}
+
+PORTS = [1, 2, 3, 4, 6, 7]
+SPEEDS = {0: "10M", 1: "100M", 2: "1G", 3: "?"}
+
+# Counter names in LAN9646_MIB_SLOT() order (lan9646.h)
+MIB_NAMES = [
+    "rx_hi_prio_byte", "rx_undersize", "rx_fragment", "rx_oversize", "rx_jabber",
+    "rx_symbol_err", "rx_crc_err", "rx_align_err", "rx_ctrl_8808", "rx_pause",
+    "rx_broadcast", "rx_multicast", "rx_unicast", "rx_64", "rx_65_127", "rx_128_255",
+    "rx_256_511", "rx_512_1023", "rx_1024_1522", "rx_1523_2000", "rx_2001_plus",
+    "tx_hi_prio_byte", "tx_late_col", "tx_pause", "tx_broadcast", "tx_multicast",
+    "tx_unicast", "tx_deferred", "tx_total_col", "tx_excess_col", "tx_single_col",
+    "tx_multi_col", "rx_byte_cnt", "tx_byte_cnt", "rx_drop", "tx_drop",
+]
+
+
+class Snapshot:
+    def __init__(self, blob):
+        if len(blob) < HDR.size:
+            raise ValueError("blob shorter than its header")
+        (magic, ver, self.flags, self.records, length, self.time_ms,
+         self.chip_id, self.revision) = HDR.unpack_from(blob, 0)
+        if magic != SNAP_MAGIC or ver != SNAP_VERSION:
+            raise ValueError(f"not a version {SNAP_VERSION} snapshot")
+        if length > len(blob):
+            raise ValueError(f"blob is {len(blob)} bytes, header says {length}")
+
+        self.regs = {}      # addr -> byte
+        self.mib = {}       # port -> [totals]
+        self.vlans = []     # (vid, members, untag, fid)
+        off = HDR.size
+        for _ in range(self.records):
+            rtype, port, addr, n = REC.unpack_from(blob, off)
+            off += REC.size
+            data = blob[off:off + n]
+            off += n
+            if rtype == REC_REGS:
+                for i, b in enumerate(data):
+                    self.regs[addr + i] = b
+            elif rtype == REC_MIB:
+                self.mib[port] = list(struct.unpack(f"<{n // 8}Q", data))
+            elif rtype == REC_VLAN:
+                self.vlans += [VID.unpack_from(data, i) for i in range(0, n, VID.size)]
+
+    def flag_text(self):
+        names = [v for k, v in FLAG_NAMES.items() if self.flags & k]
+        return ",".join(names) if names else "-"
+
+    def u8(self, addr):
+        return self.regs.get(addr)
+
+    def be(self, addr, size):
+        """Big-endian register, None if any byte is missing"""
+        val = 0
+        for i in range(size):
+            b = self.regs.get(addr + i)
+            if b is None:
+                return None
+            val = (val << 8) | b
+        return val
+
+
+def fmt(val, width):
+    return "--" if val is None else f"0x{val:0{width * 2}X}"
+
+
+def ports_text(mask):
+    return "--" if mask is None else ",".join(str(p) for p in PORTS if mask & (1 << (p - 1))) or "-"
+
+
+def show_global(s):
+    print(f"chip id 0x{s.chip_id:04X} rev {s.revision}, t={s.time_ms} ms, "
+          f"{s.records} records, flags {s.flag_text()}")
+    print(f"  switch op   {fmt(s.u8(0x0300), 1)}")
+    print(f"  switch mac  " + ("--" if s.be(0x0302, 6) is None
+                               else ":".join(f"{s.u8(0x0302 + i):02X}" for i in range(6))))
+    print(f"  lue ctrl    {fmt(s.u8(0x0310), 1)} {fmt(s.u8(0x0311), 1)}")
+    print(f"  unknown fwd {fmt(s.be(0x0320, 4), 4)} {fmt(s.be(0x0324, 4), 4)}")
+    print(f"  mirroring   {fmt(s.u8(0x0370), 1)}")
+    print(f"  queue mgmt  {fmt(s.be(0x0390, 4), 4)}")
+
+
+def show_ports(s):
+    print("port  status  op_ctrl  pvid  members  mstp   phy_lpa")
+    for p in PORTS:
+        base = p << 12
+        st = s.u8(base | 0x030)
+        if st is None:
+            link = "--"
+        else:
+            link = (f"{SPEEDS[(st >> 3) & 3]}/{'FD' if st & 0x04 else 'HD'}"
+                    f"{' txfc' if st & 0x02 else ''}{' rxfc' if st & 0x01 else ''}")
+        pvid = s.be(base | 0x000, 2)
+        # Basic status is not captured (clear on read), the partner's abilities are
+        lpa = s.be(base | 0x10A, 2)
+        print(f"{p:>4}  {link:<14}  {fmt(s.u8(base | 0x020), 1)}  "
+              f"{'--' if pvid is None else pvid & 0xFFF:>4}  "
+              f"{ports_text(s.be(base | 0xA04, 4)):<10}  {fmt(s.u8(base | 0xB04), 1)}  "
+              f"{'' if lpa is None else fmt(lpa, 2)}")
+
+
+def show_xmii(s):
+    for p in (6, 7):
+        base = p << 12
+        print(f"port {p} xmii ctrl0 {fmt(s.u8(base | 0x300), 1)} ctrl1 {fmt(s.u8(base | 0x301), 1)}")
+
+
+def show_mib(s):
+    ports = sorted(s.mib)
+    if not ports:
+        print("no MIB records")
+        return
+    print(f"{'counter':<16}" + "".join(f"{'port ' + str(p):>14}" for p in ports))
+    for i, name in enumerate(MIB_NAMES):
+        vals = [s.mib[p][i] for p in ports]
+        if any(vals):
+            print(f"{name:<16}" + "".join(f"{v:>14}" for v in vals))
+
+
+def show_vlan(s):
+    print(" vid  fid  members     untagged")
+    for vid, members, untag, fid in s.vlans:
+        print(f"{vid:>4}  {fid:>3}  {ports_text(members):<10}  {ports_text(untag)}")
+
+
+def show_regs(s):
+    rows = sorted({addr & ~0xF for addr in s.regs})
+    for row in rows:
+        cells = (s.regs.get(row + i) for i in range(16))
+        print(f"  {row:04X}: " + " ".join("--" if b is None else f"{b:02X}" for b in cells))
+
+
+VIEWS = {
+    "global": show_global,
+    "port": show_ports,
+    "xmii": show_xmii,
+    "mib": show_mib,
+    "vlan": show_vlan,
+    "regs": show_regs,
+}
+
+
+def cmd_fetch(args):
+    client = RegClient(args.host, args.port, args.timeout, args.retries)
+    blob = b""
+    total = None
+    while total is None or len(blob) < total:
+        (_, drv, data), = client.run([Op(OP_SNAPSHOT, 0, value=len(blob), mask=CHUNK)])
+        if len(blob) == 0 and drv != 0:
+            # The blob is still usable: its flags tell what is missing
+            print(f"capture: {DRV_STATUS.get(drv, drv)}", file=sys.stderr)
+        if not data:
+            break
+        blob += data
+        if total is None:
+            total = HDR.unpack_from(blob, 0)[4]
+    with open(args.output, "wb") as f:
+        f.write(blob)
+    snap = Snapshot(blob)
+    print(f"{len(blob)} bytes, {snap.records} records, flags {snap.flag_text()} -> {args.output}")
+    return 0
+
+
+def load(path):
+    with open(path, "rb") as f:
+        return Snapshot(f.read())
+
+
+def cmd_show(args):
+    snap = load(args.file)
+    views = list(VIEWS) if args.view == "all" else [args.view]
+    for v in views:
+        VIEWS[v](snap)
+        print()
+    return 0
+
+
+def cmd_diff(args):
+    a, b = load(args.a), load(args.b)
+    print(f"{args.a}: t={a.time_ms} ms, flags {a.flag_text()}")
+    print(f"{args.b}: t={b.time_ms} ms, flags {b.flag_text()} (+{b.time_ms - a.time_ms} ms)")
+
+    changed = 0
+    for addr in sorted(set(a.regs) | set(b.regs)):
+        va, vb = a.regs.get(addr), b.regs.get(addr)
+        if va != vb:
+            changed += 1
+            print(f"  {addr:04X}: {fmt(va, 1)} -> {fmt(vb, 1)}")
+    print(f"{changed} register bytes differ")
+
+    for p in sorted(set(a.mib) & set(b.mib)):
+        for i, name in enumerate(MIB_NAMES):
+            d = b.mib[p][i] - a.mib[p][i]
+            if d:
+                print(f"  port {p} {name:<16} +{d}")
+
+    va = {v[0]: v[1:] for v in a.vlans}
+    vb = {v[0]: v[1:] for v in b.vlans}
+    for vid in sorted(set(va) | set(vb)):
+        if va.get(vid) != vb.get(vid):
+            print(f"  vid {vid}: {va.get(vid, '--')} -> {vb.get(vid, '--')}")
+    return 1 if changed else 0
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("--host", default=os.environ.get("REGSVC_HOST", "192.168.1.200"))
+    ap.add_argument("--port", type=int, default=REGSVC_PORT)
+    ap.add_argument("--timeout", type=float, default=2.0, help="capture blocks the board on the bus")
+    ap.add_argument("--retries", type=int, default=3)
+    sub = ap.add_subparsers(dest="cmd", required=True)
+
+    p = sub.add_parser("fetch", help="capture a snapshot on the board and save it")
+    p.add_argument("-o", "--output", required=True)
+    p = sub.add_parser("show", help="decode a saved snapshot")
+    p.add_argument("file")
+    p.add_argument("--view", choices=list(VIEWS) + ["all"], default="all")
+    p = sub.add_parser("diff", help="register, MIB and VLAN differences of two snapshots")
+    p.add_argument("a")
+    p.add_argument("b")
+    args = ap.parse_args()
+
+    try:
+        return {"fetch": cmd_fetch, "show": cmd_show, "diff": cmd_diff}[args.cmd](args)
+    except (TimeoutError, ValueError, RuntimeError, OSError) as e:
+        print(f"error: {e}", file=sys.stderr)
+        return 2
+
+
+if __name__ == "__main__":
+    sys.exit(main())
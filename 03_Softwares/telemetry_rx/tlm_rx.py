@@ -0,0 +1,170 @@
+#!/usr/bin/env python3
+"""
+Receiver for the S32K388 binary UDP telemetry (src/NET/telemetry.h).
+
+Decodes datagrams, checks datagram and record sequence numbers for gaps,
+and prints a rate / loss summary once per interval. Optionally writes
+every record to a CSV file for later time-series analysis.
+
+    python3 tlm_rx.py [--port 5001] [--csv out.csv] [--interval 1.0] [--duration 0]
+
+The exit code is 1 if anything was lost, so a timed run (--duration) can
+gate a soak test.
+"""
+
+import argparse
+import socket
+import struct
+import sys
+import time
+
+HDR = struct.Struct("<HBBIII")      # magic, version, count, seq, first_rec, lost
+REC = struct.Struct("<HHI6I")       # type, source, t_us, v[6]
+
+TLM_MAGIC = 0x544C
+TLM_VERSION = 1
+
+REC_NAMES = {
+    1: ("gmac_rx", ["frames", "err_frames", "rbu", "fifo_ovf", "held", "max_burst"]),
+    2: ("gmac_tx", ["queued", "completed", "tx_errors", "would_block", "max_inflight", "free"]),
+    3: ("loop",    ["loops", "avg_us", "max_us", "jobs", "-", "-"]),
+    4: ("net",     ["frames", "vlan", "malformed", "unhandled", "arp_hits", "arp_misses"]),
+    5: ("port",    ["rx_bytes", "tx_bytes", "rx_drop", "tx_drop", "rx_crc", "-"]),
+}
+
+
+class SeqTracker:
+    """Counts missing, late and duplicate numbers in a 32-bit sequence.
+
+    A number that arrives after a later one fills its hole: it stops being
+    missing and is counted as reordered. Anything behind the expected
+    number that fills no hole is a duplicate. Only the MAX_HOLES most
+    recent gaps are remembered.
+    """
+
+    MAX_HOLES = 256
+
+    def __init__(self):
+        self.expected = None
+        self.received = 0
+        self.missing = 0
+        self.reordered = 0
+        self.duplicates = 0
+        self.holes = []             # [start, length], oldest first
+
+    def _fill(self, seq, count):
+        for i, (start, length) in enumerate(self.holes):
+            off = (seq - start) & 0xFFFFFFFF
+            if off >= length:
+                continue
+            n = min(count, length - off)
+            tail = length - off - n
+            repl = []
+            if off:
+                repl.append([start, off])
+            if tail:
+                repl.append([(seq + n) & 0xFFFFFFFF, tail])
+            self.holes[i:i + 1] = repl
+            return n
+        return 0
+
+    def feed(self, seq, count=1):
+        self.received += count
+        if self.expected is not None:
+            delta = (seq - self.expected) & 0xFFFFFFFF
+            if delta >= 0x80000000:
+                filled = self._fill(seq, count)
+                self.missing -= filled
+                self.reordered += filled
+                self.duplicates += count - filled
+                return
+            if delta:
+                self.missing += delta
+                self.holes.append([self.expected, delta])
+                del self.holes[:-self.MAX_HOLES]
+        self.expected = (seq + count) & 0xFFFFFFFF
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("--port", type=int, default=5001)
+    ap.add_argument("--bind", default="0.0.0.0")
+    ap.add_argument("--csv", help="write all records to this file")
+    ap.add_argument("--interval", type=float, default=1.0, help="summary period in seconds")
+    ap.add_argument("--duration", type=float, default=0.0,
+                    help="stop after this many seconds (0 = until Ctrl-C)")
+    args = ap.parse_args()
+
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.setsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF, 4 * 1024 * 1024)
+    sock.bind((args.bind, args.port))
+    sock.settimeout(args.interval)
+
+    csv = open(args.csv, "w") if args.csv else None
+    if csv:
+        csv.write("rec_seq,type,source,t_us,v0,v1,v2,v3,v4,v5\n")
+
+    dgrams = SeqTracker()
+    records = SeqTracker()
+    dev_lost = 0
+    bad = 0
+    n_rec = 0
+    n_bytes = 0
+    latest = {}
+    t_last = time.monotonic()
+    t_end = t_last + args.duration if args.duration > 0 else None
+
+    print(f"listening on {args.bind}:{args.port}", flush=True)
+    while t_end is None or time.monotonic() < t_end:
+        try:
+            data, addr = sock.recvfrom(2048)
+        except socket.timeout:
+            data = None
+        except KeyboardInterrupt:
+            break
+
+        if data is not None:
+            if len(data) < HDR.size:
+                bad += 1
+                continue
+            magic, ver, count, seq, first_rec, lost = HDR.unpack_from(data, 0)
+            if magic != TLM_MAGIC or ver != TLM_VERSION or len(data) < HDR.size + count * REC.size:
+                bad += 1
+                continue
+
+            dgrams.feed(seq)
+            records.feed(first_rec, count)
+            dev_lost = lost
+            n_bytes += len(data)
+
+            for i in range(count):
+                rtype, src, t_us, *v = REC.unpack_from(data, HDR.size + i * REC.size)
+                latest[(rtype, src)] = (t_us, v)
+                if csv:
+                    csv.write(f"{(first_rec + i) & 0xFFFFFFFF},{rtype},{src},{t_us},"
+                              + ",".join(str(x) for x in v) + "\n")
+            n_rec += count
+
+        now = time.monotonic()
+        if now - t_last >= args.interval or (t_end is not None and now >= t_end):
+            dt = max(now - t_last, 1e-6)
+            print(f"[{time.strftime('%H:%M:%S')}] {n_rec / dt:8.0f} rec/s {n_bytes * 8 / dt / 1e6:6.2f} Mbit/s | "
+                  f"dgram miss={dgrams.missing} reorder={dgrams.reordered} dup={dgrams.duplicates} | "
+                  f"rec miss={records.missing} dev_lost={dev_lost} bad={bad}")
+            for (rtype, src), (t_us, v) in sorted(latest.items()):
+                name, fields = REC_NAMES.get(rtype, (f"type{rtype}", [f"v{k}" for k in range(6)]))
+                vals = " ".join(f"{f}={x}" for f, x in zip(fields, v) if f != "-")
+                print(f"    {name}[{src}] t={t_us}us {vals}")
+            sys.stdout.flush()
+            n_rec = 0
+            n_bytes = 0
+            t_last = now
+
+    if csv:
+        csv.close()
+    # Non-zero exit if anything was lost, so the tool can gate a soak test
+    return 1 if (dgrams.missing or records.missing or dev_lost) else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
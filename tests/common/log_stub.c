@@ -0,0 +1,44 @@
+/**
+ * \file            log_stub.c
+ * \brief           Host replacement for log_debug.c (UART driver not available)
+ *
+ * Messages go to stdout when TEST_VERBOSE is set in the environment, and are
+ * dropped otherwise so benchmarks are not dominated by printf.
+ */
+
+#include "log_debug.h"
+#include <stdlib.h>
+
+static int g_verbose = -1;
+static log_level_t g_level = LOG_LEVEL_VERBOSE;
+
+void log_init(void) {
+}
+
+void log_set_level(log_level_t level) {
+    g_level = level;
+}
+
+void log_write(log_level_t level, const char* tag, const char* format, ...) {
+    va_list args;
+
+    if (g_verbose < 0) {
+        g_verbose = (getenv("TEST_VERBOSE") != NULL) ? 1 : 0;
+    }
+    if (!g_verbose || level > g_level) return;
+
+    printf("[%s] ", tag);
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+    printf("\n");
+}
+
+void log_start_flush_timer(void) {
+}
+
+void log_flush(void) {
+}
+
+void log_flush_blocking(void) {
+}
@@ -0,0 +1,102 @@
+/**
+ * \file            pcap_util.c
+ * \brief           Classic libpcap capture files (Ethernet link type) for host tests
+ */
+
+#include "pcap_util.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define PCAP_MAGIC                  0xA1B2C3D4U
+#define PCAP_MAGIC_SWAPPED          0xD4C3B2A1U
+#define PCAP_LINKTYPE_ETHERNET      1U
+
+static uint32_t prv_swap32(uint32_t v) {
+    return (v >> 24) | ((v >> 8) & 0xFF00U) | ((v << 8) & 0xFF0000U) | (v << 24);
+}
+
+static void prv_put32(FILE* fp, uint32_t v) {
+    (void)fwrite(&v, sizeof(v), 1, fp);
+}
+
+static void prv_put16(FILE* fp, uint16_t v) {
+    (void)fwrite(&v, sizeof(v), 1, fp);
+}
+
+void pcap_trace_add(pcap_trace_t* t, const uint8_t* frame, uint16_t len) {
+    if (t->count == t->cap) {
+        t->cap = (t->cap != 0U) ? t->cap * 2U : 256U;
+        t->offset = realloc(t->offset, t->cap * sizeof(*t->offset));
+        t->len = realloc(t->len, t->cap * sizeof(*t->len));
+        t->data = realloc(t->data, (size_t)t->cap * PCAP_MAX_FRAME);
+    }
+    t->offset[t->count] = t->bytes;
+    t->len[t->count] = len;
+    memcpy(&t->data[t->bytes], frame, len);
+    t->bytes += len;
+    t->count++;
+}
+
+void pcap_trace_free(pcap_trace_t* t) {
+    free(t->data);
+    free(t->offset);
+    free(t->len);
+    memset(t, 0, sizeof(*t));
+}
+
+int pcap_write(const char* path, const pcap_trace_t* t) {
+    FILE* fp = fopen(path, "wb");
+    uint32_t i;
+
+    if (fp == NULL) return -1;
+
+    prv_put32(fp, PCAP_MAGIC);
+    prv_put16(fp, 2U);
+    prv_put16(fp, 4U);
+    prv_put32(fp, 0U);
+    prv_put32(fp, 0U);
+    prv_put32(fp, 65535U);
+    prv_put32(fp, PCAP_LINKTYPE_ETHERNET);
+
+    for (i = 0; i < t->count; i++) {
+        prv_put32(fp, 0U);
+        prv_put32(fp, i);
+        prv_put32(fp, t->len[i]);
+        prv_put32(fp, t->len[i]);
+        (void)fwrite(&t->data[t->offset[i]], 1, t->len[i], fp);
+    }
+    return (fclose(fp) == 0) ? 0 : -1;
+}
+
+int pcap_read(const char* path, pcap_trace_t* t) {
+    FILE* fp = fopen(path, "rb");
+    uint32_t hdr[6];
+    uint32_t rec[4];
+    uint8_t frame[65536];
+    int swap;
+
+    memset(t, 0, sizeof(*t));
+    if (fp == NULL) return -1;
+
+    if (fread(hdr, sizeof(hdr), 1, fp) != 1U ||
+        (hdr[0] != PCAP_MAGIC && hdr[0] != PCAP_MAGIC_SWAPPED)) {
+        fclose(fp);
+        return -1;
+    }
+    swap = (hdr[0] == PCAP_MAGIC_SWAPPED);
+    if ((swap ? prv_swap32(hdr[5]) : hdr[5]) != PCAP_LINKTYPE_ETHERNET) {
+        fclose(fp);
+        return -1;
+    }
+
+    while (fread(rec, sizeof(rec), 1, fp) == 1U) {
+        uint32_t incl = swap ? prv_swap32(rec[2]) : rec[2];
+
+        if (incl > sizeof(frame) || fread(frame, 1, incl, fp) != incl) break;
+        if (incl <= PCAP_MAX_FRAME) {
+            pcap_trace_add(t, frame, (uint16_t)incl);
+        }
+    }
+    fclose(fp);
+    return 0;
+}
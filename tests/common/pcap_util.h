@@ -0,0 +1,48 @@
+/**
+ * \file            pcap_util.h
+ * \brief           Classic libpcap capture files (Ethernet link type) for host tests
+ */
+
+#ifndef PCAP_UTIL_HDR_H
+#define PCAP_UTIL_HDR_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define PCAP_MAX_FRAME              1536U
+
+/**
+ * \brief           Capture loaded into memory
+ */
+typedef struct {
+    uint8_t* data;              /*!< Frames back to back */
+    uint32_t* offset;           /*!< Start of frame i in data */
+    uint16_t* len;              /*!< Length of frame i */
+    uint32_t count;
+    uint32_t cap;
+    uint32_t bytes;
+} pcap_trace_t;
+
+/**
+ * \brief           Append a frame to an in-memory trace
+ */
+void pcap_trace_add(pcap_trace_t* t, const uint8_t* frame, uint16_t len);
+
+/**
+ * \brief           Release a trace
+ */
+void pcap_trace_free(pcap_trace_t* t);
+
+/**
+ * \brief           Write a trace as a microsecond pcap file, frames 1 us apart
+ * \return          0 on success
+ */
+int pcap_write(const char* path, const pcap_trace_t* t);
+
+/**
+ * \brief           Load a pcap file (either byte order, Ethernet only)
+ * \return          0 on success; frames longer than PCAP_MAX_FRAME are skipped
+ */
+int pcap_read(const char* path, pcap_trace_t* t);
+
+#endif /* PCAP_UTIL_HDR_H */
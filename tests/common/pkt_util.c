@@ -0,0 +1,148 @@
+/**
+ * \file            pkt_util.c
+ * \brief           Reference frame builders and RFC 1071 checksum for host tests
+ */
+
+#include "pkt_util.h"
+#include "test_util.h"
+#include <string.h>
+
+static uint32_t prv_sum(const uint8_t* data, uint32_t len, uint32_t sum) {
+    uint32_t i;
+
+    for (i = 0; i + 1U < len; i += 2U) {
+        sum += ((uint32_t)data[i] << 8) | data[i + 1U];
+    }
+    if ((len & 1U) != 0U) {
+        sum += (uint32_t)data[len - 1U] << 8;
+    }
+    return sum;
+}
+
+static uint16_t prv_finish(uint32_t sum) {
+    while ((sum >> 16) != 0U) {
+        sum = (sum & 0xFFFFU) + (sum >> 16);
+    }
+    return (uint16_t)~sum;
+}
+
+uint16_t pkt_ref_csum(const uint8_t* data, uint32_t len) {
+    return prv_finish(prv_sum(data, len, 0));
+}
+
+uint16_t pkt_build_ipv4(uint8_t* buf, const uint8_t* dst_mac, const uint8_t* src_mac,
+                        const uint8_t* src_ip, const uint8_t* dst_ip, uint8_t proto,
+                        uint8_t ihl, const uint8_t* l4, uint16_t l4_len) {
+    uint8_t* ip = &buf[14];
+    uint16_t hlen = (uint16_t)(ihl * 4U);
+    uint16_t tot = (uint16_t)(hlen + l4_len);
+    uint16_t csum;
+    uint16_t len;
+
+    memcpy(&buf[0], dst_mac, 6);
+    memcpy(&buf[6], src_mac, 6);
+    buf[12] = 0x08;
+    buf[13] = 0x00;
+
+    memset(ip, 0, hlen);
+    ip[0] = (uint8_t)(0x40U | ihl);
+    ip[2] = (uint8_t)(tot >> 8);
+    ip[3] = (uint8_t)tot;
+    ip[4] = 0x12;
+    ip[5] = 0x34;
+    ip[8] = 64;
+    ip[9] = proto;
+    memcpy(&ip[12], src_ip, 4);
+    memcpy(&ip[16], dst_ip, 4);
+    csum = pkt_ref_csum(ip, hlen);
+    ip[10] = (uint8_t)(csum >> 8);
+    ip[11] = (uint8_t)csum;
+
+    memcpy(&ip[hlen], l4, l4_len);
+    len = (uint16_t)(14U + tot);
+    if (len < PKT_ETH_MIN) {
+        memset(&buf[len], 0, PKT_ETH_MIN - len);
+        len = PKT_ETH_MIN;
+    }
+    return len;
+}
+
+uint16_t pkt_build_echo_request(uint8_t* buf, const uint8_t* dst_mac, const uint8_t* src_mac,
+                                const uint8_t* src_ip, const uint8_t* dst_ip, uint8_t ihl,
+                                uint16_t payload_len, uint16_t seq) {
+    uint8_t icmp[1500];
+    uint16_t csum;
+    uint16_t i;
+
+    icmp[0] = 8;
+    icmp[1] = 0;
+    icmp[2] = 0;
+    icmp[3] = 0;
+    icmp[4] = 0x12;
+    icmp[5] = 0x34;
+    icmp[6] = (uint8_t)(seq >> 8);
+    icmp[7] = (uint8_t)seq;
+    for (i = 0; i < payload_len; i++) {
+        icmp[8U + i] = (uint8_t)test_rand();
+    }
+    csum = pkt_ref_csum(icmp, 8U + payload_len);
+    icmp[2] = (uint8_t)(csum >> 8);
+    icmp[3] = (uint8_t)csum;
+
+    return pkt_build_ipv4(buf, dst_mac, src_mac, src_ip, dst_ip, 1U, ihl,
+                          icmp, (uint16_t)(8U + payload_len));
+}
+
+static uint32_t prv_pseudo_sum(const uint8_t* ip, uint16_t l4_len) {
+    uint32_t sum = prv_sum(&ip[12], 8U, 0);
+
+    sum += ip[9];
+    sum += l4_len;
+    return sum;
+}
+
+uint16_t pkt_build_udp(uint8_t* buf, const uint8_t* dst_mac, const uint8_t* src_mac,
+                       const uint8_t* src_ip, const uint8_t* dst_ip,
+                       uint16_t src_port, uint16_t dst_port,
+                       const uint8_t* payload, uint16_t payload_len) {
+    uint8_t udp[1500];
+    uint16_t ulen = (uint16_t)(8U + payload_len);
+    uint16_t len;
+    uint16_t csum;
+    uint8_t* l4;
+
+    udp[0] = (uint8_t)(src_port >> 8);
+    udp[1] = (uint8_t)src_port;
+    udp[2] = (uint8_t)(dst_port >> 8);
+    udp[3] = (uint8_t)dst_port;
+    udp[4] = (uint8_t)(ulen >> 8);
+    udp[5] = (uint8_t)ulen;
+    udp[6] = 0;
+    udp[7] = 0;
+    memcpy(&udp[8], payload, payload_len);
+
+    len = pkt_build_ipv4(buf, dst_mac, src_mac, src_ip, dst_ip, 17U, 5U, udp, ulen);
+    l4 = &buf[14 + 20];
+    csum = prv_finish(prv_sum(l4, ulen, prv_pseudo_sum(&buf[14], ulen)));
+    if (csum == 0U) {
+        csum = 0xFFFFU;
+    }
+    l4[6] = (uint8_t)(csum >> 8);
+    l4[7] = (uint8_t)csum;
+    return len;
+}
+
+int pkt_ipv4_csum_ok(const uint8_t* frame) {
+    const uint8_t* ip = &frame[14];
+
+    return pkt_ref_csum(ip, (uint32_t)(ip[0] & 0x0FU) * 4U) == 0U;
+}
+
+int pkt_udp_csum_ok(const uint8_t* frame) {
+    const uint8_t* ip = &frame[14];
+    const uint8_t* l4 = &ip[(ip[0] & 0x0FU) * 4U];
+    uint16_t ulen = (uint16_t)(((uint16_t)l4[4] << 8) | l4[5]);
+
+    if (l4[6] == 0U && l4[7] == 0U) return 1;
+    return prv_finish(prv_sum(l4, ulen, prv_pseudo_sum(ip, ulen))) == 0U;
+}
@@ -0,0 +1,59 @@
+/**
+ * \file            pkt_util.h
+ * \brief           Reference frame builders and RFC 1071 checksum for host tests
+ *
+ * Deliberately plain byte-by-byte code, independent of the firmware's
+ * inet_csum.c, so it can serve as the reference the firmware is checked
+ * against.
+ */
+
+#ifndef PKT_UTIL_HDR_H
+#define PKT_UTIL_HDR_H
+
+#include <stdint.h>
+
+#define PKT_ETH_MIN                 60U         /* Without FCS */
+
+/**
+ * \brief           RFC 1071 checksum, big-endian value (byte 0 is the high byte)
+ */
+uint16_t pkt_ref_csum(const uint8_t* data, uint32_t len);
+
+/**
+ * \brief           Build Ethernet + IPv4 header around an L4 payload
+ * \param[out]      buf: Frame buffer (>= 14 + ihl * 4 + l4_len, >= PKT_ETH_MIN)
+ * \param[in]       ihl: IPv4 header length in 32-bit words (5..15, options zeroed)
+ * \param[in]       l4: L4 header and payload, copied after the IP header
+ * \return          Frame length, padded to PKT_ETH_MIN
+ */
+uint16_t pkt_build_ipv4(uint8_t* buf, const uint8_t* dst_mac, const uint8_t* src_mac,
+                        const uint8_t* src_ip, const uint8_t* dst_ip, uint8_t proto,
+                        uint8_t ihl, const uint8_t* l4, uint16_t l4_len);
+
+/**
+ * \brief           Build an ICMP echo request with a pseudo-random payload
+ */
+uint16_t pkt_build_echo_request(uint8_t* buf, const uint8_t* dst_mac, const uint8_t* src_mac,
+                                const uint8_t* src_ip, const uint8_t* dst_ip, uint8_t ihl,
+                                uint16_t payload_len, uint16_t seq);
+
+/**
+ * \brief           Build a UDP datagram (checksum filled in)
+ */
+uint16_t pkt_build_udp(uint8_t* buf, const uint8_t* dst_mac, const uint8_t* src_mac,
+                       const uint8_t* src_ip, const uint8_t* dst_ip,
+                       uint16_t src_port, uint16_t dst_port,
+                       const uint8_t* payload, uint16_t payload_len);
+
+/**
+ * \brief           Check the IPv4 header checksum of a frame
+ */
+int pkt_ipv4_csum_ok(const uint8_t* frame);
+
+/**
+ * \brief           Check the UDP checksum (pseudo-header included) of a frame
+ * \return          1 if valid or absent (0), 0 otherwise
+ */
+int pkt_udp_csum_ok(const uint8_t* frame);
+
+#endif /* PKT_UTIL_HDR_H */
@@ -0,0 +1,54 @@
+/**
+ * \file            test_util.c
+ * \brief           Minimal check macros and host timing for the firmware host tests
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include "test_util.h"
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+int test_failures = 0;
+
+static uint32_t g_rand_state = 0x12345678U;
+
+int test_done(const char* name) {
+    if (test_failures != 0) {
+        printf("%s: %d check(s) FAILED\n", name, test_failures);
+        return 1;
+    }
+    printf("%s: all checks passed\n", name);
+    return 0;
+}
+
+uint64_t test_host_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+uint64_t test_cycles(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return test_host_ns();
+#endif
+}
+
+uint32_t test_rand(void) {
+    uint32_t x = g_rand_state;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    g_rand_state = x;
+    return x;
+}
+
+void test_srand(uint32_t seed) {
+    g_rand_state = (seed != 0U) ? seed : 0x12345678U;
+}
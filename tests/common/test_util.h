@@ -0,0 +1,65 @@
+/**
+ * \file            test_util.h
+ * \brief           Minimal check macros and host timing for the firmware host tests
+ */
+
+#ifndef TEST_UTIL_HDR_H
+#define TEST_UTIL_HDR_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * \brief           Record a failed condition and continue
+ */
+#define CHECK(cond)                                                         \
+    do {                                                                    \
+        if (!(cond)) {                                                      \
+            fprintf(stderr, "%s:%d: CHECK failed: %s\n",                    \
+                    __FILE__, __LINE__, #cond);                             \
+            test_failures++;                                                \
+        }                                                                   \
+    } while (0)
+
+/**
+ * \brief           Check two integers for equality, printing both on failure
+ */
+#define CHECK_EQ(a, b)                                                      \
+    do {                                                                    \
+        long long va_ = (long long)(a);                                     \
+        long long vb_ = (long long)(b);                                     \
+        if (va_ != vb_) {                                                   \
+            fprintf(stderr, "%s:%d: CHECK_EQ failed: %s (%lld) != %s (%lld)\n", \
+                    __FILE__, __LINE__, #a, va_, #b, vb_);                  \
+            test_failures++;                                                \
+        }                                                                   \
+    } while (0)
+
+extern int test_failures;
+
+/**
+ * \brief           Print the summary line and return the process exit code
+ */
+int test_done(const char* name);
+
+/**
+ * \brief           Host monotonic time in nanoseconds (benchmarks only)
+ */
+uint64_t test_host_ns(void);
+
+/**
+ * \brief           CPU cycle counter (TSC on x86, host ns elsewhere)
+ */
+uint64_t test_cycles(void);
+
+/**
+ * \brief           Deterministic pseudo-random number (xorshift32)
+ */
+uint32_t test_rand(void);
+
+/**
+ * \brief           Reseed test_rand()
+ */
+void test_srand(uint32_t seed);
+
+#endif /* TEST_UTIL_HDR_H */
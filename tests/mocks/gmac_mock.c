@@ -0,0 +1,374 @@
+/**
+ * \file            gmac_mock.c
+ * \brief           Simulated GMAC descriptor rings for host tests
+ */
+
+#include "gmac_mock.h"
+#include "mock_clock.h"
+#include "Gmac_Ip_Hw_Access.h"
+#include <string.h>
+
+/* Always set in the published DMA_STATUS so a firmware write-1-to-clear
+ * store can be told apart from the value the mock left there */
+#define STATUS_TAG                  0x80000000U
+
+typedef enum {
+    RXD_EMPTY = 0,              /* Owned by the DMA, has a buffer */
+    RXD_FULL,                   /* Frame written, waiting for ReadFrame */
+    RXD_OUT,                    /* Buffer handed to software */
+} rxd_state_t;
+
+typedef enum {
+    TXD_FREE = 0,
+    TXD_OWNED,                  /* Queued, DMA not finished */
+    TXD_DONE,                   /* Finished, descriptor reusable */
+} txd_state_t;
+
+typedef struct {
+    rxd_state_t state;
+    uint8_t* buf;
+    uint16_t len;
+} rxd_t;
+
+typedef struct {
+    txd_state_t state;
+    const uint8_t* data;
+    uint16_t len;
+    uint32_t hash;
+    uint64_t done_at;
+    boolean no_int;
+} txd_t;
+
+static Gmac_Ip_ChannelType g_ch[2];
+Gmac_Ip_ChannelType* const Gmac_apxChBases[1][2] = {{&g_ch[0], &g_ch[1]}};
+static uint32_t g_status_pub[2];
+
+static uint8_t g_rx_mem[GMAC_MOCK_RX_RING][GMAC_MOCK_BUF_SIZE];
+static rxd_t g_rxd[GMAC_MOCK_RX_RING];
+static uint32_t g_rx_dma_idx;
+static uint32_t g_rx_sw_idx;
+static uint32_t g_rx_refill_idx;
+static uint32_t g_rx_fifo_overflows;
+
+static uint8_t g_src_frame[GMAC_MOCK_BUF_SIZE];
+static uint16_t g_src_len;
+static uint64_t g_src_period_ns;
+static uint64_t g_src_next_ns;
+static uint32_t g_src_left;             /* 0 = unlimited */
+
+static txd_t g_txd[GMAC_MOCK_TX_RING];
+static uint32_t g_tx_idx;
+static uint32_t g_tx_done_idx;
+static uint64_t g_tx_last_done_ns;
+static uint64_t g_link_bps;
+
+static gmac_mock_irq_t g_rx_irq;
+static gmac_mock_irq_t g_tx_irq;
+static gmac_mock_sink_t g_sink;
+static gmac_mock_stats_t g_stats;
+
+/*===========================================================================*/
+/*                          PRIVATE FUNCTIONS                                 */
+/*===========================================================================*/
+
+static uint32_t prv_hash(const uint8_t* p, uint16_t len) {
+    uint32_t h = 2166136261U;
+    uint16_t i;
+
+    for (i = 0; i < len; i++) {
+        h = (h ^ p[i]) * 16777619U;
+    }
+    return h;
+}
+
+/**
+ * \brief           Apply a write-1-to-clear store the firmware made since the last call
+ */
+static void prv_status_sync(uint32_t ch) {
+    uint32_t reg = g_ch[ch].DMA_STATUS;
+
+    if (reg != g_status_pub[ch]) {
+        g_status_pub[ch] = (g_status_pub[ch] & ~reg) | STATUS_TAG;
+        g_ch[ch].DMA_STATUS = g_status_pub[ch];
+    }
+}
+
+static void prv_status_set(uint32_t ch, uint32_t bits) {
+    prv_status_sync(ch);
+    g_status_pub[ch] |= bits | STATUS_TAG;
+    g_ch[ch].DMA_STATUS = g_status_pub[ch];
+}
+
+static int prv_rx_offer(const uint8_t* frame, uint16_t len) {
+    rxd_t* d = &g_rxd[g_rx_dma_idx];
+
+    g_stats.rx_offered++;
+    if (d->state != RXD_EMPTY) {
+        /* Ring full: the DMA suspends with RBU, the MAC FIFO overflows */
+        g_stats.rx_dropped++;
+        g_rx_fifo_overflows++;
+        prv_status_set(0, GMAC_DMA_CH0_STATUS_RBU_MASK);
+        return 0;
+    }
+
+    memcpy(d->buf, frame, len);
+    d->len = len;
+    d->state = RXD_FULL;
+    g_rx_dma_idx = (g_rx_dma_idx + 1U) % GMAC_MOCK_RX_RING;
+    g_stats.rx_accepted++;
+
+    prv_status_set(0, GMAC_DMA_CH0_STATUS_RI_MASK);
+    if ((g_ch[0].DMA_INTERRUPT_ENABLE & GMAC_DMA_CH0_INTERRUPT_ENABLE_RIE_MASK) != 0U) {
+        /* The RTD ISR acknowledges RI before calling the channel callback */
+        g_status_pub[0] &= ~GMAC_DMA_CH0_STATUS_RI_MASK;
+        g_ch[0].DMA_STATUS = g_status_pub[0];
+        g_stats.rx_irqs++;
+        if (g_rx_irq != NULL) {
+            g_rx_irq(0U, 0U);
+        }
+    }
+    return 1;
+}
+
+static uint64_t prv_wire_ns(uint16_t len) {
+    uint64_t bytes = ((len < 60U) ? 60U : len) + 4U + 20U;   /* FCS, preamble, IFG */
+
+    return (bytes * 8U * 1000000000ULL) / g_link_bps;
+}
+
+static void prv_tx_complete(uint64_t now) {
+    while (g_txd[g_tx_done_idx].state == TXD_OWNED && g_txd[g_tx_done_idx].done_at <= now) {
+        txd_t* d = &g_txd[g_tx_done_idx];
+
+        if (prv_hash(d->data, d->len) != d->hash) {
+            g_stats.tx_corrupt++;
+        }
+        d->state = TXD_DONE;
+        g_stats.tx_completed++;
+        g_stats.tx_bytes += d->len;
+        g_tx_done_idx = (g_tx_done_idx + 1U) % GMAC_MOCK_TX_RING;
+
+        if (g_sink != NULL) {
+            g_sink(d->data, d->len);
+        }
+        if (!d->no_int) {
+            g_stats.tx_irqs++;
+            if (g_tx_irq != NULL) {
+                g_tx_irq(0U, 0U);
+            }
+        }
+    }
+}
+
+static void prv_hook(uint64_t now) {
+    while (g_src_period_ns != 0U && g_src_next_ns <= now) {
+        uint64_t due = g_src_next_ns;
+
+        /* Completions that happened before this arrival go first */
+        prv_tx_complete(due);
+        g_src_next_ns += g_src_period_ns;
+        (void)prv_rx_offer(g_src_frame, g_src_len);
+        if (g_src_left != 0U && --g_src_left == 0U) {
+            g_src_period_ns = 0;
+        }
+    }
+    prv_tx_complete(now);
+}
+
+/*===========================================================================*/
+/*                          MOCK CONTROL                                      */
+/*===========================================================================*/
+
+void gmac_mock_reset(uint64_t link_bps) {
+    uint32_t i;
+
+    memset(g_ch, 0, sizeof(g_ch));
+    g_status_pub[0] = g_status_pub[1] = STATUS_TAG;
+    g_ch[0].DMA_STATUS = g_ch[1].DMA_STATUS = STATUS_TAG;
+    g_ch[0].DMA_INTERRUPT_ENABLE = GMAC_DMA_CH0_INTERRUPT_ENABLE_RIE_MASK;
+
+    for (i = 0; i < GMAC_MOCK_RX_RING; i++) {
+        g_rxd[i].state = RXD_EMPTY;
+        g_rxd[i].buf = g_rx_mem[i];
+        g_rxd[i].len = 0;
+    }
+    g_rx_dma_idx = g_rx_sw_idx = g_rx_refill_idx = 0;
+    g_rx_fifo_overflows = 0;
+    g_src_period_ns = 0;
+
+    memset(g_txd, 0, sizeof(g_txd));
+    g_tx_idx = g_tx_done_idx = 0;
+    g_tx_last_done_ns = 0;
+    g_link_bps = (link_bps != 0U) ? link_bps : 1000000000ULL;
+
+    g_rx_irq = NULL;
+    g_tx_irq = NULL;
+    g_sink = NULL;
+    memset(&g_stats, 0, sizeof(g_stats));
+    mock_clock_add_hook(prv_hook);
+}
+
+void gmac_mock_set_irq(gmac_mock_irq_t rx, gmac_mock_irq_t tx) {
+    g_rx_irq = rx;
+    g_tx_irq = tx;
+}
+
+void gmac_mock_set_tx_sink(gmac_mock_sink_t sink) {
+    g_sink = sink;
+}
+
+void gmac_mock_rx_source(uint32_t rate_fps, const uint8_t* frame, uint16_t len, uint32_t count) {
+    if (rate_fps == 0U || frame == NULL) {
+        g_src_period_ns = 0;
+        return;
+    }
+    memcpy(g_src_frame, frame, len);
+    g_src_len = len;
+    g_src_period_ns = 1000000000ULL / rate_fps;
+    g_src_next_ns = mock_clock_ns() + g_src_period_ns;
+    g_src_left = count;
+}
+
+int gmac_mock_rx_inject(const uint8_t* frame, uint16_t len) {
+    return prv_rx_offer(frame, len);
+}
+
+uint32_t gmac_mock_rx_ready(void) {
+    uint32_t n = 0;
+    uint32_t i;
+
+    for (i = 0; i < GMAC_MOCK_RX_RING; i++) {
+        if (g_rxd[i].state == RXD_FULL) n++;
+    }
+    return n;
+}
+
+uint32_t gmac_mock_tx_inflight(void) {
+    uint32_t n = 0;
+    uint32_t i;
+
+    for (i = 0; i < GMAC_MOCK_TX_RING; i++) {
+        if (g_txd[i].state == TXD_OWNED) n++;
+    }
+    return n;
+}
+
+const gmac_mock_stats_t* gmac_mock_stats(void) {
+    return &g_stats;
+}
+
+/*===========================================================================*/
+/*                          Gmac_Ip.h                                         */
+/*===========================================================================*/
+
+Gmac_Ip_StatusType Gmac_Ip_ReadFrame(uint8 Instance, uint8 Ring,
+                                     Gmac_Ip_BufferType* Buff, Gmac_Ip_RxInfoType* Info) {
+    rxd_t* d = &g_rxd[g_rx_sw_idx];
+
+    (void)Instance;
+    (void)Ring;
+    prv_status_sync(0);
+
+    if (d->state != RXD_FULL) {
+        return GMAC_STATUS_RX_QUEUE_EMPTY;
+    }
+    Buff->Data = d->buf;
+    Buff->Length = d->len;
+    if (Info != NULL) {
+        Info->ErrMask = 0;
+        Info->PktLen = d->len;
+    }
+    d->state = RXD_OUT;
+    d->buf = NULL;
+    g_rx_sw_idx = (g_rx_sw_idx + 1U) % GMAC_MOCK_RX_RING;
+    g_stats.rx_read++;
+    return GMAC_STATUS_SUCCESS;
+}
+
+void Gmac_Ip_ProvideRxBuff(uint8 Instance, uint8 Ring, const Gmac_Ip_BufferType* Buff) {
+    rxd_t* d = &g_rxd[g_rx_refill_idx];
+
+    (void)Instance;
+    (void)Ring;
+    if (d->state != RXD_OUT || Buff == NULL || Buff->Data == NULL) {
+        return;
+    }
+    d->buf = Buff->Data;
+    d->state = RXD_EMPTY;
+    g_rx_refill_idx = (g_rx_refill_idx + 1U) % GMAC_MOCK_RX_RING;
+}
+
+boolean Gmac_Ip_IsFrameAvailable(uint8 Instance, uint8 Ring) {
+    (void)Instance;
+    (void)Ring;
+    return (g_rxd[g_rx_sw_idx].state == RXD_FULL) ? TRUE : FALSE;
+}
+
+Gmac_Ip_StatusType Gmac_Ip_SendFrame(uint8 Instance, uint8 Ring, const Gmac_Ip_BufferType* Buff,
+                                     const Gmac_Ip_TxOptionsType* Options) {
+    txd_t* d = &g_txd[g_tx_idx];
+    uint64_t now = mock_clock_ns();
+    uint64_t start;
+    uint32_t inflight;
+
+    (void)Instance;
+    (void)Ring;
+    prv_tx_complete(now);
+
+    if (d->state == TXD_OWNED) {
+        g_stats.tx_ring_full++;
+        return GMAC_STATUS_TX_QUEUE_FULL;
+    }
+
+    d->data = Buff->Data;
+    d->len = Buff->Length;
+    d->hash = prv_hash(Buff->Data, Buff->Length);
+    d->no_int = (Options != NULL) ? Options->NoInt : FALSE;
+    start = (g_tx_last_done_ns > now) ? g_tx_last_done_ns : now;
+    d->done_at = start + prv_wire_ns(Buff->Length);
+    g_tx_last_done_ns = d->done_at;
+    d->state = TXD_OWNED;
+    g_tx_idx = (g_tx_idx + 1U) % GMAC_MOCK_TX_RING;
+    g_stats.tx_sent++;
+
+    inflight = gmac_mock_tx_inflight();
+    if (inflight > g_stats.tx_max_inflight) {
+        g_stats.tx_max_inflight = inflight;
+    }
+    return GMAC_STATUS_SUCCESS;
+}
+
+Gmac_Ip_StatusType Gmac_Ip_GetTransmitStatus(uint8 Instance, uint8 Ring,
+                                             const Gmac_Ip_BufferType* Buff,
+                                             Gmac_Ip_TxInfoType* Info) {
+    uint32_t i;
+
+    (void)Instance;
+    (void)Ring;
+    prv_tx_complete(mock_clock_ns());
+
+    for (i = 0; i < GMAC_MOCK_TX_RING; i++) {
+        if (g_txd[i].state == TXD_OWNED && g_txd[i].data == Buff->Data) {
+            return GMAC_STATUS_BUSY;
+        }
+    }
+    for (i = 0; i < GMAC_MOCK_TX_RING; i++) {
+        if (g_txd[i].state == TXD_DONE && g_txd[i].data == Buff->Data) {
+            if (Info != NULL) {
+                Info->ErrMask = 0;
+            }
+            return GMAC_STATUS_SUCCESS;
+        }
+    }
+    return GMAC_STATUS_BUFF_NOT_FOUND;
+}
+
+uint32 Gmac_Ip_GetCounter(uint8 Instance, Gmac_Ip_CounterType Counter) {
+    (void)Instance;
+    return (Counter == GMAC_CTR_RX_FIFO_OVERFLOW_PACKETS) ? g_rx_fifo_overflows : 0U;
+}
+
+void Gmac_Ip_EnableTxStoreAndForward(uint8 Instance, uint8 Ring) {
+    (void)Instance;
+    (void)Ring;
+}
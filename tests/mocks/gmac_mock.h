@@ -0,0 +1,90 @@
+/**
+ * \file            gmac_mock.h
+ * \brief           Simulated GMAC descriptor rings for host tests
+ *
+ * RX: a ring of GMAC_MOCK_RX_RING descriptors filled by a frame source
+ * (fixed rate or explicit injection) on virtual time. A frame that finds
+ * no empty descriptor is dropped and raises RBU, like the real DMA.
+ * Buffers are refilled in ring order by Gmac_Ip_ProvideRxBuff().
+ *
+ * TX: a ring of GMAC_MOCK_TX_RING descriptors consumed in order at link
+ * rate. The frame bytes are fingerprinted at Gmac_Ip_SendFrame() and
+ * checked again when the simulated DMA finishes, so a buffer reused before
+ * its completion shows up as tx_corrupt.
+ */
+
+#ifndef GMAC_MOCK_HDR_H
+#define GMAC_MOCK_HDR_H
+
+#include <stdint.h>
+#include "Gmac_Ip.h"
+
+#define GMAC_MOCK_RX_RING           32U
+#define GMAC_MOCK_TX_RING           16U
+#define GMAC_MOCK_BUF_SIZE          1536U
+
+typedef void (*gmac_mock_irq_t)(const uint8 Instance, const uint8 Channel);
+typedef void (*gmac_mock_sink_t)(const uint8_t* frame, uint16_t len);
+
+typedef struct {
+    uint32_t rx_offered;        /*!< Frames presented to the MAC */
+    uint32_t rx_accepted;       /*!< Frames written into a descriptor */
+    uint32_t rx_dropped;        /*!< Frames lost because the ring was full */
+    uint32_t rx_read;           /*!< Gmac_Ip_ReadFrame() successes */
+    uint32_t rx_irqs;           /*!< RX interrupts raised */
+    uint32_t tx_sent;           /*!< Gmac_Ip_SendFrame() successes */
+    uint32_t tx_ring_full;      /*!< Gmac_Ip_SendFrame() refusals */
+    uint32_t tx_completed;      /*!< Frames the simulated DMA finished */
+    uint32_t tx_corrupt;        /*!< Frames whose buffer changed before completion */
+    uint32_t tx_irqs;           /*!< TX interrupts raised */
+    uint32_t tx_max_inflight;   /*!< High-water mark of DMA-owned TX descriptors */
+    uint64_t tx_bytes;          /*!< Bytes completed */
+} gmac_mock_stats_t;
+
+/**
+ * \brief           Reset both rings and statistics, hook into mock_clock
+ * \param[in]       link_bps: Link rate for TX wire time (0 = 1 Gbit/s)
+ */
+void gmac_mock_reset(uint64_t link_bps);
+
+/**
+ * \brief           Install the interrupt handlers (either may be NULL)
+ */
+void gmac_mock_set_irq(gmac_mock_irq_t rx, gmac_mock_irq_t tx);
+
+/**
+ * \brief           Called with every frame the TX DMA finishes (may be NULL)
+ */
+void gmac_mock_set_tx_sink(gmac_mock_sink_t sink);
+
+/**
+ * \brief           Offer one frame every 1e9 / rate ns, starting one period from now
+ * \param[in]       rate_fps: Frames per second, 0 stops the source
+ * \param[in]       frame: Frame bytes (copied)
+ * \param[in]       len: Frame length
+ * \param[in]       count: Frames to offer, 0 = until stopped
+ */
+void gmac_mock_rx_source(uint32_t rate_fps, const uint8_t* frame, uint16_t len, uint32_t count);
+
+/**
+ * \brief           Offer one frame right now
+ * \return          1 if accepted, 0 if dropped
+ */
+int gmac_mock_rx_inject(const uint8_t* frame, uint16_t len);
+
+/**
+ * \brief           Number of received frames waiting for Gmac_Ip_ReadFrame()
+ */
+uint32_t gmac_mock_rx_ready(void);
+
+/**
+ * \brief           Number of TX descriptors still owned by the DMA
+ */
+uint32_t gmac_mock_tx_inflight(void);
+
+/**
+ * \brief           Statistics
+ */
+const gmac_mock_stats_t* gmac_mock_stats(void);
+
+#endif /* GMAC_MOCK_HDR_H */
@@ -0,0 +1,228 @@
+/**
+ * \file            lan9646_model.c
+ * \brief           LAN9646 register model behind a mocked lan9646_i2c_t
+ */
+
+#include "lan9646_model.h"
+#include "mock_clock.h"
+#include <stddef.h>
+#include <string.h>
+
+#define MIB_PORTS                   8U      /* Index by port number, 0 unused */
+
+static uint8_t g_regs[0x10000];
+static uint64_t g_mib[MIB_PORTS][256];
+static uint64_t g_mib_last[MIB_PORTS][256];     /* Free-running: total at the last latch */
+static bool g_mib_read_clear = true;
+static lan9646_model_hook_t g_hook;
+static uint32_t g_bus_hz;
+static uint32_t g_fail;
+static lan9646_model_stats_t g_stats;
+
+/*===========================================================================*/
+/*                          PRIVATE FUNCTIONS                                 */
+/*===========================================================================*/
+
+static bool prv_is_wide(uint8_t index) {
+    return index == LAN9646_MIB_RX_BYTE_CNT || index == LAN9646_MIB_TX_BYTE_CNT;
+}
+
+/* Control write with READ_EN: counter into 0xN500 [3:0] / 0xN504, READ_EN cleared */
+static void prv_mib_latch(uint8_t port) {
+    uint16_t base = LAN9646_PORT_BASE(port);
+    uint32_t ctrl = lan9646_model_get(base | 0x0500U, 4);
+    uint8_t index = (uint8_t)((ctrl & LAN9646_MIB_INDEX_MASK) >> LAN9646_MIB_INDEX_SHIFT);
+    uint64_t range = prv_is_wide(index) ? (1ULL << 36) : (1ULL << 30);
+    uint64_t total = g_mib[port][index];
+    uint64_t val = total & (range - 1U);
+    bool ovf;
+
+    if (g_mib_read_clear) {
+        ovf = total >= range;
+        g_mib[port][index] = 0;
+    } else {
+        ovf = (total / range) != (g_mib_last[port][index] / range);
+        g_mib_last[port][index] = total;
+    }
+
+    ctrl &= ~(LAN9646_MIB_READ_EN | LAN9646_MIB_OVERFLOW | LAN9646_MIB_DATA_HI_MASK);
+    if (ovf) {
+        ctrl |= LAN9646_MIB_OVERFLOW;
+    }
+    if (prv_is_wide(index)) {
+        ctrl |= (uint32_t)(val >> 32) & LAN9646_MIB_DATA_HI_MASK;
+        lan9646_model_set(base | 0x0504U, 4, (uint32_t)val);
+    } else {
+        lan9646_model_set(base | 0x0504U, 4, (uint32_t)val & LAN9646_MIB_CNT_MASK);
+    }
+    lan9646_model_set(base | 0x0500U, 4, ctrl);
+    g_stats.mib_latches++;
+}
+
+/**
+ * \brief           Count one transaction, advance the clock by its bus time
+ * \return          false if it is to fail
+ */
+static bool prv_transaction(uint8_t dev_addr, uint16_t len, bool write) {
+    /* START, device + 2 address bytes, [Sr, device], data, STOP; 9 SCL per byte */
+    uint64_t bits = write ? (9U * (3U + (uint32_t)len) + 2U) : (9U * (4U + (uint32_t)len) + 3U);
+
+    g_stats.bits += bits;
+    if (g_bus_hz != 0U) {
+        mock_clock_advance(bits * 1000000000ULL / g_bus_hz);
+    }
+    if (dev_addr != LAN9646_I2C_ADDR_DEFAULT) {
+        g_stats.nacks++;
+        return false;
+    }
+    if (write) {
+        g_stats.writes++;
+        g_stats.write_bytes += len;
+    } else {
+        g_stats.reads++;
+        g_stats.read_bytes += len;
+    }
+    if (g_fail != 0U) {
+        g_fail--;
+        return false;
+    }
+    return true;
+}
+
+static lan9646r_t prv_init(void) {
+    return lan9646OK;
+}
+
+static lan9646r_t prv_mem_write(uint8_t dev_addr, uint16_t mem_addr, const uint8_t* data,
+                                uint16_t len) {
+    uint32_t i;
+
+    if (!prv_transaction(dev_addr, len, true)) return lan9646BUSERR;
+
+    for (i = 0; i < len; i++) {
+        uint16_t a = (uint16_t)(mem_addr + i);
+
+        g_regs[a] = data[i];
+        /* Last byte of the MIB control register completes the write */
+        if ((a & 0x0FFFU) == 0x0503U && (a >> 12) < MIB_PORTS
+            && (lan9646_model_get((uint16_t)(a & 0xF000U) | 0x0500U, 4) & LAN9646_MIB_READ_EN)) {
+            prv_mib_latch((uint8_t)(a >> 12));
+        }
+    }
+    if (g_hook != NULL) {
+        g_hook(mem_addr, len, true);
+    }
+    return lan9646OK;
+}
+
+static lan9646r_t prv_mem_read(uint8_t dev_addr, uint16_t mem_addr, uint8_t* data, uint16_t len) {
+    uint32_t i;
+
+    if (!prv_transaction(dev_addr, len, false)) return lan9646BUSERR;
+
+    if (g_hook != NULL) {
+        g_hook(mem_addr, len, false);
+    }
+    for (i = 0; i < len; i++) {
+        data[i] = g_regs[(uint16_t)(mem_addr + i)];
+    }
+    return lan9646OK;
+}
+
+static const lan9646_i2c_t g_i2c = {
+    .init_fn = prv_init,
+    .mem_write_fn = prv_mem_write,
+    .mem_read_fn = prv_mem_read,
+};
+
+/*===========================================================================*/
+/*                          PUBLIC FUNCTIONS                                  */
+/*===========================================================================*/
+
+void lan9646_model_reset(void) {
+    memset(g_regs, 0, sizeof(g_regs));
+    memset(g_mib, 0, sizeof(g_mib));
+    memset(g_mib_last, 0, sizeof(g_mib_last));
+    g_mib_read_clear = true;
+    g_hook = NULL;
+    g_bus_hz = 0;
+    g_fail = 0;
+    memset(&g_stats, 0, sizeof(g_stats));
+    g_regs[LAN9646_REG_CHIP_ID1] = LAN9646_CHIP_ID_MSB;
+    g_regs[LAN9646_REG_CHIP_ID2] = LAN9646_CHIP_ID_LSB;
+}
+
+lan9646r_t lan9646_model_attach(lan9646_t* dev) {
+    lan9646_cfg_t cfg;
+
+    memset(dev, 0, sizeof(*dev));
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.if_type = LAN9646_IF_I2C;
+    cfg.ops.i2c = g_i2c;
+    cfg.i2c_addr = LAN9646_I2C_ADDR_DEFAULT;
+    return lan9646_init(dev, &cfg);
+}
+
+const lan9646_i2c_t* lan9646_model_i2c(void) {
+    return &g_i2c;
+}
+
+uint8_t* lan9646_model_regs(void) {
+    return g_regs;
+}
+
+uint32_t lan9646_model_get(uint16_t addr, uint8_t size) {
+    uint32_t v = 0;
+    uint8_t i;
+
+    for (i = 0; i < size; i++) {
+        v = (v << 8) | g_regs[(uint16_t)(addr + i)];
+    }
+    return v;
+}
+
+void lan9646_model_set(uint16_t addr, uint8_t size, uint32_t val) {
+    uint8_t i;
+
+    for (i = 0; i < size; i++) {
+        g_regs[(uint16_t)(addr + i)] = (uint8_t)(val >> (8U * (size - 1U - i)));
+    }
+}
+
+void lan9646_model_set_hook(lan9646_model_hook_t hook) {
+    g_hook = hook;
+}
+
+void lan9646_model_set_bus_hz(uint32_t hz) {
+    g_bus_hz = hz;
+}
+
+void lan9646_model_fail_next(uint32_t n) {
+    g_fail = n;
+}
+
+void lan9646_model_set_mib(uint8_t port, uint8_t index, uint64_t val) {
+    if (port < MIB_PORTS) {
+        g_mib[port][index] = val;
+    }
+}
+
+uint64_t lan9646_model_get_mib(uint8_t port, uint8_t index) {
+    return (port < MIB_PORTS) ? g_mib[port][index] : 0U;
+}
+
+void lan9646_model_set_mib_read_clear(bool read_clear) {
+    g_mib_read_clear = read_clear;
+}
+
+const lan9646_model_stats_t* lan9646_model_stats(void) {
+    return &g_stats;
+}
+
+void lan9646_model_clear_stats(void) {
+    memset(&g_stats, 0, sizeof(g_stats));
+}
+
+uint64_t lan9646_model_bus_ns(uint32_t hz) {
+    return g_stats.bits * 1000000000ULL / hz;
+}
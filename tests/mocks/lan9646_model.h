@@ -0,0 +1,104 @@
+/**
+ * \file            lan9646_model.h
+ * \brief           LAN9646 register model behind a mocked lan9646_i2c_t
+ *
+ * A flat 64 KiB big-endian register space answers the I2C memory read and
+ * write callbacks at LAN9646_I2C_ADDR_DEFAULT. Every transaction is
+ * counted together with its SCL periods (address and data bytes with
+ * their ACK, START, repeated START and STOP), so a test can turn a
+ * register sequence into bus time at any I2C speed.
+ *
+ * The indirect MIB counters (0xN500 / 0xN504) are emulated: a write of
+ * the control register with READ_EN latches the selected counter into
+ * the control and data registers and, in read-clear mode, zeroes it.
+ * Other indirect tables are left to the test through the access hook.
+ */
+
+#ifndef LAN9646_MODEL_HDR_H
+#define LAN9646_MODEL_HDR_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "lan9646.h"
+
+#define LAN9646_MODEL_I2C_HZ        100000U     /* main.c: LAN9646_I2C_SPEED 5 us half period */
+
+typedef struct {
+    uint32_t reads;             /*!< Read transactions */
+    uint32_t writes;            /*!< Write transactions */
+    uint32_t read_bytes;        /*!< Data bytes read */
+    uint32_t write_bytes;       /*!< Data bytes written */
+    uint64_t bits;              /*!< SCL periods of all transactions */
+    uint32_t nacks;             /*!< Transactions to another device address */
+    uint32_t mib_latches;       /*!< MIB counters latched */
+} lan9646_model_stats_t;
+
+/**
+ * \brief           Called for every transaction: after the bytes are
+ *                  stored (write) or before they are returned (read)
+ */
+typedef void (*lan9646_model_hook_t)(uint16_t addr, uint16_t len, bool write);
+
+/**
+ * \brief           Clear registers, counters, hook and failures
+ * \note            Chip ID 0x9477 is preset at 0x0001
+ */
+void lan9646_model_reset(void);
+
+/**
+ * \brief           Initialize a driver handle on the model (I2C memory callbacks)
+ */
+lan9646r_t lan9646_model_attach(lan9646_t* dev);
+
+/**
+ * \brief           The I2C callbacks the model answers, for tests that wrap them
+ */
+const lan9646_i2c_t* lan9646_model_i2c(void);
+
+/**
+ * \brief           Raw register space (test setup and checks, not counted)
+ */
+uint8_t* lan9646_model_regs(void);
+
+/**
+ * \brief           Big-endian register value of 1, 2 or 4 bytes (not counted)
+ */
+uint32_t lan9646_model_get(uint16_t addr, uint8_t size);
+void lan9646_model_set(uint16_t addr, uint8_t size, uint32_t val);
+
+/**
+ * \brief           Install the access hook (NULL to remove)
+ */
+void lan9646_model_set_hook(lan9646_model_hook_t hook);
+
+/**
+ * \brief           Advance mock_clock by the SCL time of every transaction
+ * \param[in]       hz: Bus clock, 0 = time does not move (default)
+ */
+void lan9646_model_set_bus_hz(uint32_t hz);
+
+/**
+ * \brief           Make the next n transactions fail with lan9646BUSERR
+ */
+void lan9646_model_fail_next(uint32_t n);
+
+/**
+ * \brief           MIB counter of a port (1..7) and index, as the switch counts it
+ */
+void lan9646_model_set_mib(uint8_t port, uint8_t index, uint64_t val);
+uint64_t lan9646_model_get_mib(uint8_t port, uint8_t index);
+
+/**
+ * \brief           Select read-clear (default) or free-running MIB counters
+ */
+void lan9646_model_set_mib_read_clear(bool read_clear);
+
+const lan9646_model_stats_t* lan9646_model_stats(void);
+void lan9646_model_clear_stats(void);
+
+/**
+ * \brief           Bus time of the counted transactions at hz
+ */
+uint64_t lan9646_model_bus_ns(uint32_t hz);
+
+#endif /* LAN9646_MODEL_HDR_H */
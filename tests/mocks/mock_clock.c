@@ -0,0 +1,82 @@
+/**
+ * \file            mock_clock.c
+ * \brief           Virtual time base shared by the host mocks, plus sys_timer.h on top of it
+ */
+
+#include "mock_clock.h"
+#include "sys_timer.h"
+#include <stddef.h>
+
+#define MOCK_CLOCK_HOOKS_MAX        4U
+
+static uint64_t g_now_ns;
+static mock_clock_hook_t g_hooks[MOCK_CLOCK_HOOKS_MAX];
+static uint32_t g_hook_count;
+
+void mock_clock_reset(void) {
+    g_now_ns = 0;
+    g_hook_count = 0;
+}
+
+uint64_t mock_clock_ns(void) {
+    return g_now_ns;
+}
+
+void mock_clock_advance(uint64_t ns) {
+    uint32_t i;
+
+    g_now_ns += ns;
+    for (i = 0; i < g_hook_count; i++) {
+        g_hooks[i](g_now_ns);
+    }
+}
+
+void mock_clock_add_hook(mock_clock_hook_t hook) {
+    uint32_t i;
+
+    for (i = 0; i < g_hook_count; i++) {
+        if (g_hooks[i] == hook) return;
+    }
+    if (g_hook_count < MOCK_CLOCK_HOOKS_MAX) {
+        g_hooks[g_hook_count++] = hook;
+    }
+}
+
+/*===========================================================================*/
+/*                          sys_timer.h ON VIRTUAL TIME                       */
+/*===========================================================================*/
+
+bool sys_timer_init(void) {
+    return true;
+}
+
+uint32_t sys_timer_now_us(void) {
+    return (uint32_t)(g_now_ns / 1000U);
+}
+
+uint64_t sys_timer_now_us64(void) {
+    return g_now_ns / 1000U;
+}
+
+uint32_t sys_timer_now_ms(void) {
+    return (uint32_t)(g_now_ns / 1000000U);
+}
+
+uint32_t sys_timer_elapsed_us(uint32_t since_us) {
+    return sys_timer_now_us() - since_us;
+}
+
+void sys_timer_delay_us(uint32_t us) {
+    mock_clock_advance((uint64_t)us * 1000U);
+}
+
+void sys_timer_delay_ms(uint32_t ms) {
+    mock_clock_advance((uint64_t)ms * 1000000U);
+}
+
+void sys_timer_idle(bool (*work_pending)(void)) {
+    /* WFI stand-in: let one microsecond of simulated hardware happen */
+    if (work_pending == NULL || !work_pending()) {
+        mock_clock_advance(1000U);
+    }
+}
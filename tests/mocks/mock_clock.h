@@ -0,0 +1,37 @@
+/**
+ * \file            mock_clock.h
+ * \brief           Virtual time base shared by the host mocks
+ *
+ * Nothing moves unless a test (or a mocked busy-wait) advances the clock.
+ * Advancing runs the registered hooks, which is where simulated hardware
+ * (frame arrivals, DMA completions) catches up with the new time.
+ */
+
+#ifndef MOCK_CLOCK_HDR_H
+#define MOCK_CLOCK_HDR_H
+
+#include <stdint.h>
+
+typedef void (*mock_clock_hook_t)(uint64_t now_ns);
+
+/**
+ * \brief           Reset time to 0 and drop all hooks
+ */
+void mock_clock_reset(void);
+
+/**
+ * \brief           Current virtual time in nanoseconds
+ */
+uint64_t mock_clock_ns(void);
+
+/**
+ * \brief           Move time forward and run the hooks
+ */
+void mock_clock_advance(uint64_t ns);
+
+/**
+ * \brief           Register a hook called after every advance (max 4)
+ */
+void mock_clock_add_hook(mock_clock_hook_t hook);
+
+#endif /* MOCK_CLOCK_HDR_H */
@@ -0,0 +1,4 @@
+/**
+ * \file            Eth_43_GMAC_MemMap.h
+ * \brief           Host stand-in for the RTD memory map header (no sections on the host)
+ */
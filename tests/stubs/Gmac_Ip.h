@@ -0,0 +1,84 @@
+/**
+ * \file            Gmac_Ip.h
+ * \brief           Host stand-in for the RTD GMAC IP driver header
+ *
+ * Only the types and calls used by the firmware modules under test. The
+ * implementation is tests/mocks/gmac_mock.c.
+ */
+
+#ifndef GMAC_IP_H
+#define GMAC_IP_H
+
+#include <stdint.h>
+
+#ifndef TRUE
+#define TRUE                        1U
+#define FALSE                       0U
+#endif
+
+#define NULL_PTR                    ((void*)0)
+#define STD_ON                      1U
+#define STD_OFF                     0U
+
+typedef uint8_t uint8;
+typedef uint16_t uint16;
+typedef uint32_t uint32;
+typedef uint64_t uint64;
+typedef unsigned char boolean;
+
+typedef enum {
+    GMAC_STATUS_SUCCESS = 0,
+    GMAC_STATUS_BUSY = 2,
+    GMAC_STATUS_RX_QUEUE_EMPTY = 0xA01,
+    GMAC_STATUS_TX_QUEUE_FULL,
+    GMAC_STATUS_BUFF_NOT_FOUND,
+} Gmac_Ip_StatusType;
+
+typedef struct {
+    uint8* Data;
+    uint16 Length;
+} Gmac_Ip_BufferType;
+
+typedef struct {
+    uint32 ErrMask;
+    uint16 PktLen;
+} Gmac_Ip_RxInfoType;
+
+typedef struct {
+    uint32 ErrMask;
+} Gmac_Ip_TxInfoType;
+
+typedef enum {
+    GMAC_CRC_AND_PAD_INSERTION = 0,
+} Gmac_Ip_CrcPadControlType;
+
+typedef enum {
+    GMAC_CHECKSUM_INSERTION_DISABLE = 0,
+    GMAC_CHECKSUM_INSERTION_IP,
+    GMAC_CHECKSUM_INSERTION_PROTO_NO_PSEUDOH,
+    GMAC_CHECKSUM_INSERTION_PROTO_PSEUDOH,
+} Gmac_Ip_ChecksumInsControlType;
+
+typedef struct {
+    boolean NoInt;
+    Gmac_Ip_CrcPadControlType CrcPadIns;
+    Gmac_Ip_ChecksumInsControlType ChecksumIns;
+} Gmac_Ip_TxOptionsType;
+
+typedef enum {
+    GMAC_CTR_RX_FIFO_OVERFLOW_PACKETS = 0,
+} Gmac_Ip_CounterType;
+
+Gmac_Ip_StatusType Gmac_Ip_ReadFrame(uint8 Instance, uint8 Ring,
+                                     Gmac_Ip_BufferType* Buff, Gmac_Ip_RxInfoType* Info);
+void Gmac_Ip_ProvideRxBuff(uint8 Instance, uint8 Ring, const Gmac_Ip_BufferType* Buff);
+boolean Gmac_Ip_IsFrameAvailable(uint8 Instance, uint8 Ring);
+Gmac_Ip_StatusType Gmac_Ip_SendFrame(uint8 Instance, uint8 Ring, const Gmac_Ip_BufferType* Buff,
+                                     const Gmac_Ip_TxOptionsType* Options);
+Gmac_Ip_StatusType Gmac_Ip_GetTransmitStatus(uint8 Instance, uint8 Ring,
+                                             const Gmac_Ip_BufferType* Buff,
+                                             Gmac_Ip_TxInfoType* Info);
+uint32 Gmac_Ip_GetCounter(uint8 Instance, Gmac_Ip_CounterType Counter);
+void Gmac_Ip_EnableTxStoreAndForward(uint8 Instance, uint8 Ring);
+
+#endif /* GMAC_IP_H */
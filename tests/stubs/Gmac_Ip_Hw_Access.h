@@ -0,0 +1,25 @@
+/**
+ * \file            Gmac_Ip_Hw_Access.h
+ * \brief           Host stand-in for the RTD GMAC register access header
+ *
+ * DMA_STATUS is write-1-to-clear on the real part; tests/mocks/gmac_mock.c
+ * emulates that on its next call.
+ */
+
+#ifndef GMAC_IP_HW_ACCESS_H
+#define GMAC_IP_HW_ACCESS_H
+
+#include "Gmac_Ip.h"
+
+typedef struct {
+    volatile uint32 DMA_STATUS;
+    volatile uint32 DMA_INTERRUPT_ENABLE;
+} Gmac_Ip_ChannelType;
+
+extern Gmac_Ip_ChannelType* const Gmac_apxChBases[1][2];
+
+#define GMAC_DMA_CH0_INTERRUPT_ENABLE_RIE_MASK  0x00000040U
+#define GMAC_DMA_CH0_STATUS_RI_MASK             0x00000040U
+#define GMAC_DMA_CH0_STATUS_RBU_MASK            0x00000080U
+
+#endif /* GMAC_IP_HW_ACCESS_H */
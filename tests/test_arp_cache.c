@@ -0,0 +1,416 @@
+/**
+ * \file            test_arp_cache.c
+ * \brief           ARP cache: hit, miss and queueing, retries, aging, and lookup cost at a full table
+ *
+ * Frames go out through the real eth_tx pool into the simulated DMA; ARP
+ * replies and requests come back in through net_dispatch(). Time is the
+ * virtual clock, arp_tick() is called every ARP_TICK_MS as main.c does.
+ */
+
+#include "arp_cache.h"
+#include "eth_tx.h"
+#include "net_dispatch.h"
+#include "gmac_mock.h"
+#include "mock_clock.h"
+#include "test_util.h"
+#include <string.h>
+
+#define MAX_SEEN                    64U
+
+typedef struct {
+    uint8_t dst[6];
+    uint16_t ethertype;
+    uint16_t op;                /* ARP opcode, 0 for other frames */
+    uint8_t tpa[4];             /* ARP target IP */
+    uint8_t tha[6];             /* ARP target MAC */
+} seen_t;
+
+static const uint8_t g_our_mac[6] = {0x02, 0x00, 0x00, 0x00, 0x00, 0x01};
+static const uint8_t g_our_ip[4] = {192, 168, 1, 100};
+static const uint8_t g_netmask[4] = {255, 255, 255, 0};
+static const uint8_t g_gateway[4] = {192, 168, 1, 1};
+static const uint8_t g_peer_ip[4] = {192, 168, 1, 10};
+static const uint8_t g_peer_mac[6] = {0x00, 0x11, 0x22, 0x33, 0x44, 0x55};
+static const uint8_t g_gw_mac[6] = {0x00, 0x11, 0x22, 0x33, 0x44, 0x01};
+static const uint8_t g_bcast[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+
+static seen_t g_seen[MAX_SEEN];
+static uint32_t g_seen_count;
+
+static void prv_sink(const uint8_t* frame, uint16_t len) {
+    seen_t* s;
+
+    if (g_seen_count >= MAX_SEEN) return;
+    s = &g_seen[g_seen_count++];
+    memset(s, 0, sizeof(*s));
+    memcpy(s->dst, frame, 6);
+    s->ethertype = (uint16_t)(((uint16_t)frame[12] << 8) | frame[13]);
+    if (s->ethertype == NET_ETHERTYPE_ARP && len >= 42U) {
+        s->op = (uint16_t)(((uint16_t)frame[20] << 8) | frame[21]);
+        memcpy(s->tha, &frame[32], 6);
+        memcpy(s->tpa, &frame[38], 4);
+    }
+}
+
+/* Let queued frames leave and give the buffers back */
+static void prv_pump(void) {
+    mock_clock_advance(20000U);
+    (void)eth_tx_reclaim();
+}
+
+static void prv_setup(void) {
+    mock_clock_reset();
+    gmac_mock_reset(0);
+    gmac_mock_set_irq(NULL, eth_tx_irq_callback);
+    gmac_mock_set_tx_sink(prv_sink);
+    eth_tx_init(0, 0);
+    arp_init(g_our_mac, g_our_ip, g_netmask, g_gateway);
+    net_dispatch_init();
+    CHECK(net_register_ethertype(NET_ETHERTYPE_ARP, "arp", arp_input));
+    g_seen_count = 0;
+}
+
+/* Advance in ARP_TICK_MS steps, ticking like the status job in main.c */
+static void prv_run_ms(uint32_t ms) {
+    uint32_t t;
+
+    for (t = 0; t < ms; t += ARP_TICK_MS) {
+        mock_clock_advance((uint64_t)ARP_TICK_MS * 1000000U);
+        arp_tick();
+        (void)eth_tx_reclaim();
+    }
+}
+
+static void prv_rx_arp(uint16_t op, const uint8_t* sha, const uint8_t* spa, const uint8_t* tpa) {
+    uint8_t f[60];
+
+    memset(f, 0, sizeof(f));
+    memcpy(&f[0], (op == 1U) ? g_bcast : g_our_mac, 6);
+    memcpy(&f[6], sha, 6);
+    f[12] = 0x08; f[13] = 0x06;
+    f[14] = 0x00; f[15] = 0x01;
+    f[16] = 0x08; f[17] = 0x00;
+    f[18] = 6; f[19] = 4;
+    f[20] = 0x00; f[21] = (uint8_t)op;
+    memcpy(&f[22], sha, 6);
+    memcpy(&f[28], spa, 4);
+    if (op == 2U) {
+        memcpy(&f[32], g_our_mac, 6);
+    }
+    memcpy(&f[38], tpa, 4);
+    net_dispatch(f, sizeof(f));
+}
+
+/* An IPv4 frame in a pool buffer, only the destination MAC is ARP's business */
+static uint8_t* prv_data_frame(uint16_t* len) {
+    uint8_t* buf = eth_tx_alloc();
+
+    if (buf != NULL) {
+        memset(buf, 0, 64);
+        memcpy(&buf[6], g_our_mac, 6);
+        buf[12] = 0x08; buf[13] = 0x00;
+        *len = 64U;
+    }
+    return buf;
+}
+
+static uint32_t prv_count(uint16_t ethertype, uint16_t op) {
+    uint32_t i;
+    uint32_t n = 0;
+
+    for (i = 0; i < g_seen_count; i++) {
+        if (g_seen[i].ethertype == ethertype && g_seen[i].op == op) n++;
+    }
+    return n;
+}
+
+static void prv_test_miss_then_hit(void) {
+    arp_stats_t st;
+    uint8_t* buf;
+    uint16_t len;
+    uint8_t mac[6];
+    uint32_t i;
+
+    prv_setup();
+
+    /* Miss: one request, frames wait */
+    CHECK(!arp_resolve(g_peer_ip, mac));
+    buf = prv_data_frame(&len);
+    CHECK_EQ(arp_output(buf, len, g_peer_ip), arpQUEUED);
+    buf = prv_data_frame(&len);
+    CHECK_EQ(arp_output(buf, len, g_peer_ip), arpQUEUED);
+    prv_pump();
+    CHECK_EQ(prv_count(NET_ETHERTYPE_ARP, 1U), 1);
+    CHECK(memcmp(g_seen[0].dst, g_bcast, 6) == 0);
+    CHECK(memcmp(g_seen[0].tpa, g_peer_ip, 4) == 0);
+    CHECK_EQ(prv_count(NET_ETHERTYPE_IPV4, 0U), 0);
+
+    /* Reply flushes the queue to the learned MAC */
+    prv_rx_arp(2U, g_peer_mac, g_peer_ip, g_our_ip);
+    prv_pump();
+    CHECK_EQ(prv_count(NET_ETHERTYPE_IPV4, 0U), 2);
+    for (i = 0; i < g_seen_count; i++) {
+        if (g_seen[i].ethertype == NET_ETHERTYPE_IPV4) {
+            CHECK(memcmp(g_seen[i].dst, g_peer_mac, 6) == 0);
+        }
+    }
+
+    /* Hit: sent right away, no request */
+    g_seen_count = 0;
+    CHECK(arp_lookup(g_peer_ip, mac));
+    CHECK(memcmp(mac, g_peer_mac, 6) == 0);
+    buf = prv_data_frame(&len);
+    CHECK_EQ(arp_output(buf, len, g_peer_ip), arpOK);
+    prv_pump();
+    CHECK_EQ(g_seen_count, 1);
+    CHECK(memcmp(g_seen[0].dst, g_peer_mac, 6) == 0);
+
+    /* Off-subnet goes through the gateway, broadcast needs no resolution */
+    g_seen_count = 0;
+    {
+        static const uint8_t far_ip[4] = {10, 0, 0, 5};
+        static const uint8_t subnet_bcast[4] = {192, 168, 1, 255};
+
+        buf = prv_data_frame(&len);
+        CHECK_EQ(arp_output(buf, len, far_ip), arpQUEUED);
+        buf = prv_data_frame(&len);
+        CHECK_EQ(arp_output(buf, len, subnet_bcast), arpOK);
+        prv_pump();
+        CHECK_EQ(prv_count(NET_ETHERTYPE_ARP, 1U), 1);
+        CHECK(memcmp(g_seen[0].tpa, g_gateway, 4) == 0);
+        CHECK_EQ(prv_count(NET_ETHERTYPE_IPV4, 0U), 1);
+        CHECK(memcmp(g_seen[1].dst, g_bcast, 6) == 0);
+
+        prv_rx_arp(2U, g_gw_mac, g_gateway, g_our_ip);
+        prv_pump();
+        CHECK(arp_resolve(far_ip, mac));
+        CHECK(memcmp(mac, g_gw_mac, 6) == 0);
+    }
+
+    arp_get_stats(&st);
+    CHECK_EQ(st.hits, 2);
+    CHECK_EQ(st.misses, 3);
+    CHECK_EQ(st.resolved, 2);
+    CHECK_EQ(st.requests_tx, 2);
+    CHECK_EQ(st.queue_drops, 0);
+    CHECK_EQ(eth_tx_free_count(), ETH_TX_POOL_SIZE);
+}
+
+static void prv_test_queue_and_timeout(void) {
+    arp_stats_t st;
+    uint8_t* buf;
+    uint16_t len;
+    uint32_t i;
+
+    prv_setup();
+
+    /* The pending queue holds ARP_PENDING_MAX frames, the next one is dropped */
+    for (i = 0; i < ARP_PENDING_MAX; i++) {
+        buf = prv_data_frame(&len);
+        CHECK_EQ(arp_output(buf, len, g_peer_ip), arpQUEUED);
+    }
+    buf = prv_data_frame(&len);
+    CHECK_EQ(arp_output(buf, len, g_peer_ip), arpDROP);
+    prv_pump();
+    CHECK_EQ(eth_tx_free_count(), ETH_TX_POOL_SIZE - ARP_PENDING_MAX);
+
+    /* Retransmit every ARP_RETRY_MS, give up after ARP_MAX_TRIES */
+    prv_run_ms(ARP_RETRY_MS * ARP_MAX_TRIES - ARP_TICK_MS);
+    CHECK_EQ(prv_count(NET_ETHERTYPE_ARP, 1U), ARP_MAX_TRIES);
+    arp_get_stats(&st);
+    CHECK_EQ(st.timeouts, 0);
+
+    prv_run_ms(ARP_TICK_MS);
+    arp_get_stats(&st);
+    CHECK_EQ(st.timeouts, 1);
+    CHECK_EQ(st.queue_drops, ARP_PENDING_MAX + 1U);
+    CHECK_EQ(eth_tx_free_count(), ETH_TX_POOL_SIZE);
+    CHECK_EQ(prv_count(NET_ETHERTYPE_ARP, 1U), ARP_MAX_TRIES);
+
+    /* A late reply addressed to us is still learned */
+    prv_rx_arp(2U, g_peer_mac, g_peer_ip, g_our_ip);
+    CHECK(arp_lookup(g_peer_ip, NULL));
+}
+
+static void prv_test_aging_and_reply(void) {
+    arp_stats_t st;
+
+    prv_setup();
+
+    /* A request for us is answered and teaches us the sender */
+    prv_rx_arp(1U, g_peer_mac, g_peer_ip, g_our_ip);
+    prv_pump();
+    CHECK_EQ(prv_count(NET_ETHERTYPE_ARP, 2U), 1);
+    CHECK(memcmp(g_seen[0].dst, g_peer_mac, 6) == 0);
+    CHECK(memcmp(g_seen[0].tha, g_peer_mac, 6) == 0);
+    CHECK(memcmp(g_seen[0].tpa, g_peer_ip, 4) == 0);
+    CHECK(arp_lookup(g_peer_ip, NULL));
+
+    /* Requests for someone else: not answered, sender not learned */
+    {
+        static const uint8_t other_ip[4] = {192, 168, 1, 20};
+        static const uint8_t other_mac[6] = {0x00, 0x11, 0x22, 0x33, 0x44, 0x66};
+        static const uint8_t third_ip[4] = {192, 168, 1, 30};
+
+        prv_rx_arp(1U, other_mac, other_ip, third_ip);
+        prv_pump();
+        CHECK_EQ(prv_count(NET_ETHERTYPE_ARP, 2U), 1);
+        CHECK(!arp_lookup(other_ip, NULL));
+    }
+
+    /* Entries live ARP_ENTRY_TTL_MS from the last refresh */
+    prv_run_ms(ARP_ENTRY_TTL_MS / 2U);
+    prv_rx_arp(1U, g_peer_mac, g_peer_ip, g_our_ip);        /* Refresh */
+    prv_run_ms(ARP_ENTRY_TTL_MS - ARP_TICK_MS);
+    CHECK(arp_lookup(g_peer_ip, NULL));
+    prv_run_ms(2U * ARP_TICK_MS);
+    CHECK(!arp_lookup(g_peer_ip, NULL));
+
+    arp_get_stats(&st);
+    CHECK_EQ(st.expired, 1);
+    CHECK_EQ(st.replies_tx, 2);
+}
+
+/*===========================================================================*/
+/*                          FULL TABLE                                        */
+/*===========================================================================*/
+
+static void prv_host_ip(uint32_t n, uint8_t ip[4]) {
+    ip[0] = 192;
+    ip[1] = 168;
+    ip[2] = (uint8_t)(2U + (n >> 8));     /* Never our own 192.168.1.x */
+    ip[3] = (uint8_t)n;
+}
+
+static double prv_lookup_cycles(const uint8_t (*ips)[4], uint32_t n_ips) {
+    const uint32_t loops = 2000000U;
+    volatile uint32_t found = 0;
+    uint64_t t0;
+    uint32_t i;
+
+    t0 = test_cycles();
+    for (i = 0; i < loops; i++) {
+        found += arp_lookup(ips[i % n_ips], NULL) ? 1U : 0U;
+    }
+    return (double)(test_cycles() - t0) / loops;
+}
+
+/* Only our own subnet's all-ones address is a broadcast */
+static void prv_test_directed_broadcast(void) {
+    static const uint8_t host32_mask[4] = {255, 255, 255, 255};
+    static const uint8_t far_bcast[4] = {10, 0, 0, 255};
+    static const uint8_t peer_bcast[4] = {192, 168, 1, 255};
+    uint8_t mac[6];
+    uint8_t* buf;
+    uint16_t len;
+
+    /* 10.0.0.255 from 192.168.1.100/24 is a host behind the gateway */
+    prv_setup();
+    CHECK(!arp_resolve(far_bcast, mac));
+    buf = prv_data_frame(&len);
+    CHECK_EQ(arp_output(buf, len, far_bcast), arpQUEUED);
+    prv_pump();
+    CHECK_EQ(g_seen_count, 1);
+    CHECK_EQ(prv_count(NET_ETHERTYPE_ARP, 1U), 1);
+    CHECK(memcmp(g_seen[0].tpa, g_gateway, 4) == 0);
+
+    prv_rx_arp(2U, g_gw_mac, g_gateway, g_our_ip);
+    prv_pump();
+    CHECK_EQ(g_seen_count, 2);
+    CHECK_EQ(g_seen[1].ethertype, NET_ETHERTYPE_IPV4);
+    CHECK(memcmp(g_seen[1].dst, g_gw_mac, 6) == 0);
+    CHECK(arp_resolve(far_bcast, mac));
+    CHECK(memcmp(mac, g_gw_mac, 6) == 0);
+
+    /* A /32 has no broadcast address: everything but 255.255.255.255 is routed */
+    prv_setup();
+    arp_init(g_our_mac, g_our_ip, host32_mask, g_gateway);
+    CHECK(!arp_resolve(peer_bcast, mac));
+    buf = prv_data_frame(&len);
+    CHECK_EQ(arp_output(buf, len, peer_bcast), arpQUEUED);
+    prv_pump();
+    CHECK_EQ(prv_count(NET_ETHERTYPE_ARP, 1U), 1);
+    CHECK(memcmp(g_seen[0].tpa, g_gateway, 4) == 0);
+    CHECK_EQ(prv_count(NET_ETHERTYPE_IPV4, 0U), 0);
+    CHECK(arp_resolve(g_bcast, mac));
+    CHECK(memcmp(mac, g_bcast, 6) == 0);
+
+    prv_rx_arp(2U, g_gw_mac, g_gateway, g_our_ip);
+    prv_pump();
+    CHECK_EQ(eth_tx_free_count(), ETH_TX_POOL_SIZE);
+}
+
+static void prv_test_full_table(void) {
+    static const uint8_t wide_mask[4] = {255, 255, 0, 0};
+    uint8_t learned[256][4];
+    uint8_t missing[64][4];
+    uint8_t mac[6];
+    arp_stats_t st;
+    uint32_t present = 0;
+    uint32_t i;
+    double c_one_hit;
+    double c_one_miss;
+    double c_full_hit;
+    double c_full_miss;
+    uint8_t hits[ARP_CACHE_SIZE][4];
+    uint32_t n_hits = 0;
+
+    prv_setup();
+    arp_init(g_our_mac, g_our_ip, wide_mask, g_gateway);
+
+    /* One entry */
+    prv_host_ip(2U, learned[0]);
+    prv_rx_arp(1U, g_peer_mac, learned[0], g_our_ip);
+    for (i = 0; i < 64U; i++) {
+        prv_host_ip(1000U + i, missing[i]);
+    }
+    c_one_hit = prv_lookup_cycles((const uint8_t (*)[4])learned, 1U);
+    c_one_miss = prv_lookup_cycles((const uint8_t (*)[4])missing, 64U);
+
+    /* 256 hosts talk to us: the table fills, probe windows overflow and
+     * the oldest entries are replaced */
+    for (i = 0; i < 256U; i++) {
+        prv_host_ip(2U + i, learned[i]);
+        mac[0] = 0x00; mac[1] = 0x11; mac[2] = 0x22; mac[3] = 0x33;
+        mac[4] = (uint8_t)(i >> 8); mac[5] = (uint8_t)i;
+        prv_rx_arp(1U, mac, learned[i], g_our_ip);
+        mock_clock_advance(1000000U);
+        (void)eth_tx_reclaim();
+    }
+    for (i = 0; i < 256U; i++) {
+        if (arp_lookup(learned[i], mac)) {
+            present++;
+            CHECK_EQ(mac[5], (uint8_t)i);
+            if (n_hits < ARP_CACHE_SIZE) {
+                memcpy(hits[n_hits++], learned[i], 4);
+            }
+        }
+    }
+    arp_get_stats(&st);
+    CHECK_EQ(present, ARP_CACHE_SIZE);
+    CHECK_EQ(st.evicted, 256U - ARP_CACHE_SIZE);
+
+    /* The newest host is always kept */
+    CHECK(arp_lookup(learned[255], NULL));
+
+    c_full_hit = prv_lookup_cycles((const uint8_t (*)[4])hits, n_hits);
+    c_full_miss = prv_lookup_cycles((const uint8_t (*)[4])missing, 64U);
+
+    printf("arp_lookup host cycles: 1 entry hit %.1f miss %.1f, "
+           "%u entries (full) hit %.1f miss %.1f\n",
+           c_one_hit, c_one_miss, (unsigned)ARP_CACHE_SIZE, c_full_hit, c_full_miss);
+
+    /* Bounded probe window: a full table costs at most a few more compares */
+    CHECK(c_full_hit < 3.0 * c_one_hit + 10.0);
+    CHECK(c_full_miss < 3.0 * c_one_miss + 10.0);
+}
+
+int main(void) {
+    prv_test_miss_then_hit();
+    prv_test_queue_and_timeout();
+    prv_test_aging_and_reply();
+    prv_test_directed_broadcast();
+    prv_test_full_table();
+
+    return test_done("test_arp_cache");
+}
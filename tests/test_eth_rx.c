@@ -0,0 +1,196 @@
+/**
+ * \file            test_eth_rx.c
+ * \brief           Replay frames into a simulated RX ring: baseline poll vs eth_rx_drain()
+ *
+ * Before: the original main loop read one frame per pass and then slept
+ * delay_ms(1), so the ring was emptied at most ~1000 frames/s.
+ * After: eth_rx_drain() empties up to the budget per wake-up, woken by the
+ * RX interrupt and switching to polling under sustained load.
+ *
+ * Both run on virtual time with the same per-frame handler cost, so the
+ * numbers compare the loop structure, not the host CPU.
+ */
+
+#include "eth_rx.h"
+#include "gmac_mock.h"
+#include "mock_clock.h"
+#include "test_util.h"
+#include <string.h>
+
+#define FRAME_COST_NS               2000U       /* Handler work per frame on the M7 */
+#define LOOP_COST_NS                500U        /* One superloop pass without RX work */
+#define RUN_NS                      500000000ULL
+
+typedef struct {
+    uint32_t offered;
+    uint32_t handled;
+    uint32_t dropped;
+    uint32_t pending;           /* Still in the ring at the end of the run */
+    eth_rx_stats_t rx;
+} run_result_t;
+
+static uint8_t g_frame[64];
+static uint32_t g_handled;
+
+static void prv_handler(uint8_t* frame, uint16_t len) {
+    (void)frame;
+    (void)len;
+    g_handled++;
+    mock_clock_advance(FRAME_COST_NS);
+}
+
+static void prv_setup(void) {
+    uint32_t i;
+
+    for (i = 0; i < sizeof(g_frame); i++) {
+        g_frame[i] = (uint8_t)i;
+    }
+    mock_clock_reset();
+    gmac_mock_reset(0);
+    g_handled = 0;
+}
+
+static void prv_collect(run_result_t* r) {
+    const gmac_mock_stats_t* s = gmac_mock_stats();
+
+    r->offered = s->rx_offered;
+    r->handled = g_handled;
+    r->dropped = s->rx_dropped;
+    r->pending = gmac_mock_rx_ready();
+}
+
+/**
+ * \brief           Baseline loop (poll_rx() + delay_ms(1) in the original main.c)
+ */
+static void prv_run_before(uint32_t rate_fps, run_result_t* r) {
+    Gmac_Ip_BufferType buf;
+    Gmac_Ip_RxInfoType info;
+
+    prv_setup();
+    gmac_mock_rx_source(rate_fps, g_frame, sizeof(g_frame), 0);
+
+    while (mock_clock_ns() < RUN_NS) {
+        if (Gmac_Ip_ReadFrame(0, 0, &buf, &info) == GMAC_STATUS_SUCCESS) {
+            prv_handler(buf.Data, info.PktLen);
+            Gmac_Ip_ProvideRxBuff(0, 0, &buf);
+        }
+        mock_clock_advance(LOOP_COST_NS + 1000000U);
+    }
+    prv_collect(r);
+    memset(&r->rx, 0, sizeof(r->rx));
+}
+
+/**
+ * \brief           Current loop: eth_rx_drain() whenever eth_rx_pending()
+ */
+static void prv_run_after(uint32_t rate_fps, run_result_t* r) {
+    prv_setup();
+    gmac_mock_set_irq(eth_rx_irq_callback, NULL);
+    eth_rx_init(0, 0, prv_handler, 0);
+    gmac_mock_rx_source(rate_fps, g_frame, sizeof(g_frame), 0);
+
+    while (mock_clock_ns() < RUN_NS) {
+        if (eth_rx_pending()) {
+            (void)eth_rx_drain();
+        }
+        mock_clock_advance(LOOP_COST_NS);
+    }
+    prv_collect(r);
+    eth_rx_get_stats(&r->rx);
+}
+
+static uint32_t prv_fps(uint32_t frames) {
+    return (uint32_t)((uint64_t)frames * 1000000000ULL / RUN_NS);
+}
+
+/**
+ * \brief           Offer a burst at 1 Gbit/s line rate after an idle period
+ */
+static uint32_t prv_burst_drops(int after, uint32_t burst) {
+    Gmac_Ip_BufferType buf;
+    Gmac_Ip_RxInfoType info;
+
+    prv_setup();
+    if (after) {
+        gmac_mock_set_irq(eth_rx_irq_callback, NULL);
+        eth_rx_init(0, 0, prv_handler, 0);
+    }
+    /* 64-byte frames back to back at 1 Gbit/s */
+    gmac_mock_rx_source(1488095U, g_frame, sizeof(g_frame), burst);
+
+    while (mock_clock_ns() < 50000000ULL) {
+        if (after) {
+            if (eth_rx_pending()) {
+                (void)eth_rx_drain();
+            }
+            mock_clock_advance(LOOP_COST_NS);
+        } else {
+            if (Gmac_Ip_ReadFrame(0, 0, &buf, &info) == GMAC_STATUS_SUCCESS) {
+                prv_handler(buf.Data, info.PktLen);
+                Gmac_Ip_ProvideRxBuff(0, 0, &buf);
+            }
+            mock_clock_advance(LOOP_COST_NS + 1000000U);
+        }
+    }
+    CHECK_EQ(g_handled + gmac_mock_stats()->rx_dropped, burst);
+    return gmac_mock_stats()->rx_dropped;
+}
+
+int main(void) {
+    static const uint32_t rates[] = {500U, 1000U, 2000U, 10000U, 100000U, 300000U, 1000000U};
+    run_result_t before[sizeof(rates) / sizeof(rates[0])];
+    run_result_t after[sizeof(rates) / sizeof(rates[0])];
+    uint32_t i;
+    uint32_t burst_before;
+    uint32_t burst_after;
+
+    printf("RX replay, %u ns/frame handler, %u ns/loop pass, %llu ms per point\n",
+           FRAME_COST_NS, LOOP_COST_NS, (unsigned long long)(RUN_NS / 1000000U));
+    printf("%10s | %12s %10s | %12s %10s %8s %8s\n",
+           "offered/s", "before fr/s", "dropped", "after fr/s", "dropped", "irqs", "polling");
+
+    for (i = 0; i < sizeof(rates) / sizeof(rates[0]); i++) {
+        prv_run_before(rates[i], &before[i]);
+        prv_run_after(rates[i], &after[i]);
+        printf("%10lu | %12lu %10lu | %12lu %10lu %8lu %8lu\n",
+               (unsigned long)rates[i],
+               (unsigned long)prv_fps(before[i].handled), (unsigned long)before[i].dropped,
+               (unsigned long)prv_fps(after[i].handled), (unsigned long)after[i].dropped,
+               (unsigned long)after[i].rx.irqs, (unsigned long)after[i].rx.poll_entries);
+
+        /* Nothing goes missing between the ring and the handler */
+        CHECK_EQ(before[i].handled + before[i].dropped + before[i].pending, before[i].offered);
+        CHECK_EQ(after[i].handled + after[i].dropped + after[i].pending, after[i].offered);
+        CHECK_EQ(after[i].rx.rbu_events > 0U, after[i].dropped > 0U);
+    }
+
+    /* Baseline: one frame per millisecond is the ceiling */
+    CHECK_EQ(before[0].dropped, 0);
+    CHECK(before[2].dropped > 0U);
+    CHECK(prv_fps(before[6].handled) <= 1000U);
+
+    /* Drain: light load stays in interrupt mode, one IRQ per frame */
+    CHECK_EQ(after[0].dropped, 0);
+    CHECK_EQ(after[0].rx.poll_entries, 0);
+    CHECK_EQ(after[0].rx.irqs, after[0].offered);
+
+    /* Lossless far past the old ceiling */
+    CHECK_EQ(after[4].dropped, 0);
+    CHECK_EQ(after[5].dropped, 0);
+
+    /* Saturated: polling instead of one IRQ per frame, throughput bounded by
+     * the handler cost rather than the loop */
+    CHECK(after[6].rx.poll_entries > 0U);
+    CHECK(after[6].rx.irqs < after[6].handled / 100U);
+    CHECK(prv_fps(after[6].handled) > 100U * prv_fps(before[6].handled));
+    CHECK(prv_fps(after[6].handled) > (uint32_t)(900000000ULL / FRAME_COST_NS) / 2U);
+
+    burst_before = prv_burst_drops(0, 64U);
+    burst_after = prv_burst_drops(1, 64U);
+    printf("64-frame line-rate burst: before dropped %lu, after dropped %lu\n",
+           (unsigned long)burst_before, (unsigned long)burst_after);
+    CHECK_EQ(burst_before, 64U - GMAC_MOCK_RX_RING);
+    CHECK(burst_after < burst_before);
+
+    return test_done("test_eth_rx");
+}
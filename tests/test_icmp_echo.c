@@ -0,0 +1,290 @@
+/**
+ * \file            test_icmp_echo.c
+ * \brief           ICMP echo reply: correctness and cycles per packet, old vs in-place
+ *
+ * Before: the original handle_icmp() copied the request into g_tx_buffer
+ * and recomputed the IP header and the full ICMP checksum.
+ * After: net_dispatch() parses the frame once and icmp_echo_reply_in_place()
+ * swaps addresses in the RX buffer and patches the ICMP checksum
+ * incrementally (built with ETH_TX_CSUM_OFFLOAD=0 so the patch is exercised).
+ *
+ * Every reply is checked against the reference RFC 1071 checksum and
+ * against the reply the old code built.
+ */
+
+#include "icmp_echo.h"
+#include "net_dispatch.h"
+#include "pkt_util.h"
+#include "test_util.h"
+#include <string.h>
+
+static const uint8_t g_our_mac[6] = {0x02, 0x00, 0x00, 0x00, 0x00, 0x01};
+static const uint8_t g_our_ip[4] = {192, 168, 1, 100};
+static const uint8_t g_peer_mac[6] = {0x00, 0x11, 0x22, 0x33, 0x44, 0x55};
+static const uint8_t g_peer_ip[4] = {192, 168, 1, 10};
+
+static uint8_t g_tx_buffer[1536];
+static uint16_t g_reply_len;
+
+/*===========================================================================*/
+/*                  BASELINE (original main.c, logging removed)               */
+/*===========================================================================*/
+
+static uint16_t old_ip_checksum(const uint8_t* data, uint16_t len) {
+    uint32_t sum = 0;
+
+    while (len > 1) {
+        sum += ((uint16_t)data[0] << 8) | data[1];
+        data += 2;
+        len -= 2;
+    }
+    if (len == 1) {
+        sum += (uint16_t)data[0] << 8;
+    }
+    while (sum >> 16) {
+        sum = (sum & 0xFFFF) + (sum >> 16);
+    }
+    return (uint16_t)(~sum);
+}
+
+static uint16_t old_handle_icmp(uint8_t* pkt, uint16_t len) {
+    uint8_t* ip;
+    uint8_t ip_hdr_len;
+    uint8_t* icmp;
+    uint8_t src_mac[6];
+    uint8_t src_ip[4];
+    uint8_t* reply = g_tx_buffer;
+    uint8_t* reply_ip;
+    uint8_t* reply_icmp;
+    uint16_t ip_csum;
+    uint16_t icmp_len;
+    uint16_t icmp_csum;
+
+    if (len < 42) return 0;
+    ip = &pkt[14];
+    ip_hdr_len = (ip[0] & 0x0F) * 4;
+    icmp = &pkt[14 + ip_hdr_len];
+    if (icmp[0] != 8) return 0;
+    if (memcmp(&ip[16], g_our_ip, 4) != 0) return 0;
+
+    memcpy(src_mac, &pkt[6], 6);
+    memcpy(src_ip, &ip[12], 4);
+
+    memcpy(reply, pkt, len);
+    memcpy(&reply[0], src_mac, 6);
+    memcpy(&reply[6], g_our_mac, 6);
+
+    reply_ip = &reply[14];
+    memcpy(&reply_ip[12], g_our_ip, 4);
+    memcpy(&reply_ip[16], src_ip, 4);
+    reply_ip[10] = 0;
+    reply_ip[11] = 0;
+    ip_csum = old_ip_checksum(reply_ip, ip_hdr_len);
+    reply_ip[10] = ip_csum >> 8;
+    reply_ip[11] = ip_csum & 0xFF;
+
+    reply_icmp = &reply[14 + ip_hdr_len];
+    reply_icmp[0] = 0;
+    icmp_len = len - 14 - ip_hdr_len;
+    reply_icmp[2] = 0;
+    reply_icmp[3] = 0;
+    icmp_csum = old_ip_checksum(reply_icmp, icmp_len);
+    reply_icmp[2] = icmp_csum >> 8;
+    reply_icmp[3] = icmp_csum & 0xFF;
+    return len;
+}
+
+/*===========================================================================*/
+/*                  CURRENT (handle_icmp() in main.c, without TX)             */
+/*===========================================================================*/
+
+static bool new_handle_icmp(net_frame_t* f) {
+    if (f->l4 == NULL || memcmp(f->dst_ip, g_our_ip, 4) != 0) return false;
+    g_reply_len = icmp_echo_reply_in_place(f, g_our_mac);
+    return g_reply_len != 0U;
+}
+
+/*===========================================================================*/
+/*                              TESTS                                         */
+/*===========================================================================*/
+
+static void prv_check_reply(const uint8_t* req, const uint8_t* rep, uint16_t len) {
+    const uint8_t* ip = &rep[14];
+    uint16_t hlen = (uint16_t)((ip[0] & 0x0FU) * 4U);
+    uint16_t tot = (uint16_t)(((uint16_t)ip[2] << 8) | ip[3]);
+
+    CHECK(memcmp(&rep[0], g_peer_mac, 6) == 0);
+    CHECK(memcmp(&rep[6], g_our_mac, 6) == 0);
+    CHECK(memcmp(&ip[12], g_our_ip, 4) == 0);
+    CHECK(memcmp(&ip[16], g_peer_ip, 4) == 0);
+    CHECK(pkt_ipv4_csum_ok(rep));
+    CHECK_EQ(ip[hlen], 0);
+    CHECK_EQ(pkt_ref_csum(&ip[hlen], (uint32_t)(tot - hlen)), 0);
+    /* Identifier, sequence and payload are echoed unchanged */
+    CHECK(memcmp(&ip[hlen + 4U], &req[14U + hlen + 4U], (size_t)(tot - hlen - 4U)) == 0);
+    CHECK(len >= PKT_ETH_MIN);
+}
+
+/* Request checksums around the 0x0000 / 0xFFFF representations, where an
+ * incremental update and a full recompute could disagree */
+static const uint16_t g_edge_csums[] = {
+    0xF7FFU, 0xF800U, 0xF7FEU, 0x0000U, 0xFFFFU, 0x0800U, 0x07FFU, 0x0001U,
+};
+
+/**
+ * \brief           Rewrite a 64-byte echo payload's last word so the request checksum is csum
+ */
+static void prv_force_csum(uint8_t* frame, uint16_t payload, uint16_t csum) {
+    uint8_t* icmp = &frame[14 + 20];
+    uint16_t icmp_len = (uint16_t)(8U + payload);
+    uint32_t s;
+
+    frame[14 + 2] = (uint8_t)((20U + icmp_len) >> 8);
+    frame[14 + 3] = (uint8_t)(20U + icmp_len);
+    frame[14 + 10] = 0;
+    frame[14 + 11] = 0;
+    s = pkt_ref_csum(&frame[14], 20U);
+    frame[14 + 10] = (uint8_t)(s >> 8);
+    frame[14 + 11] = (uint8_t)s;
+
+    icmp[2] = (uint8_t)(csum >> 8);
+    icmp[3] = (uint8_t)csum;
+    icmp[icmp_len - 2U] = 0;
+    icmp[icmp_len - 1U] = 0;
+    /* The whole message must sum to 0xFFFF: the missing word is the
+     * checksum of everything else */
+    s = pkt_ref_csum(icmp, icmp_len);
+    icmp[icmp_len - 2U] = (uint8_t)(s >> 8);
+    icmp[icmp_len - 1U] = (uint8_t)s;
+    CHECK_EQ(pkt_ref_csum(icmp, icmp_len), 0);
+}
+
+static void prv_test_correctness(void) {
+    uint8_t req[1536];
+    uint8_t frame[1536];
+    uint16_t len;
+    uint16_t csum;
+    uint32_t i;
+    net_handler_stats_t hs;
+
+    for (i = 0; i < 2000U; i++) {
+        uint8_t ihl = (i % 7U == 0U) ? 6U : 5U;
+        uint16_t payload = (uint16_t)(test_rand() % (1472U - (ihl - 5U) * 4U));
+
+        if (i < sizeof(g_edge_csums) / sizeof(g_edge_csums[0])) {
+            ihl = 5U;
+            payload = 64U;
+        }
+
+        len = pkt_build_echo_request(req, g_our_mac, g_peer_mac, g_peer_ip, g_our_ip,
+                                     ihl, payload, (uint16_t)i);
+        if (i < sizeof(g_edge_csums) / sizeof(g_edge_csums[0])) {
+            prv_force_csum(req, 64U, g_edge_csums[i]);
+            len = (uint16_t)(14U + 20U + 8U + 64U);
+        }
+
+        CHECK_EQ(old_handle_icmp(req, len), len);
+
+        memcpy(frame, req, len);
+        g_reply_len = 0;
+        net_dispatch(frame, len);
+        CHECK(g_reply_len == len);
+        prv_check_reply(req, frame, g_reply_len);
+
+        /* Same bytes on the wire as the old copy-and-recompute path */
+        CHECK(memcmp(frame, g_tx_buffer, g_reply_len) == 0);
+    }
+
+    /* Not for us, not a request, truncated: frame untouched */
+    len = pkt_build_echo_request(req, g_our_mac, g_peer_mac, g_peer_ip, g_peer_ip, 5U, 32U, 1U);
+    memcpy(frame, req, len);
+    g_reply_len = 0;
+    net_dispatch(frame, len);
+    CHECK_EQ(g_reply_len, 0);
+    CHECK(memcmp(frame, req, len) == 0);
+
+    len = pkt_build_echo_request(req, g_our_mac, g_peer_mac, g_peer_ip, g_our_ip, 5U, 32U, 1U);
+    req[14 + 20] = 0;                               /* Echo reply */
+    memcpy(frame, req, len);
+    net_dispatch(frame, len);
+    CHECK_EQ(g_reply_len, 0);
+    CHECK(memcmp(frame, req, len) == 0);
+
+    len = pkt_build_echo_request(req, g_our_mac, g_peer_mac, g_peer_ip, g_our_ip, 5U, 32U, 1U);
+    req[14 + 3] = 24U;                              /* ICMP header cut to 4 bytes */
+    req[14 + 10] = 0;
+    req[14 + 11] = 0;
+    csum = pkt_ref_csum(&req[14], 20U);
+    req[14 + 10] = (uint8_t)(csum >> 8);
+    req[14 + 11] = (uint8_t)csum;
+    memcpy(frame, req, len);
+    net_dispatch(frame, len);
+    CHECK_EQ(g_reply_len, 0);
+    CHECK(memcmp(frame, req, len) == 0);
+
+    CHECK(net_handler_get_stats("icmp", &hs));
+    CHECK_EQ(hs.drops, 3);
+}
+
+static void prv_bench(uint16_t payload) {
+    static uint8_t req[1536];
+    static uint8_t frame[1536];
+    const uint32_t n = 200000U;
+    uint16_t len;
+    uint16_t hdr;
+    uint64_t t0;
+    uint64_t c_old;
+    uint64_t c_new;
+    uint64_t c_restore;
+    uint32_t i;
+
+    len = pkt_build_echo_request(req, g_our_mac, g_peer_mac, g_peer_ip, g_our_ip, 5U, payload, 7U);
+    hdr = 14U + 20U + 8U;   /* What the in-place reply touches */
+    memcpy(frame, req, len);
+
+    t0 = test_cycles();
+    for (i = 0; i < n; i++) {
+        (void)old_handle_icmp(req, len);
+    }
+    c_old = test_cycles() - t0;
+
+    /* In-place modifies the request: restore its headers every time and
+     * take the restore cost back out */
+    t0 = test_cycles();
+    for (i = 0; i < n; i++) {
+        memcpy(frame, req, hdr);
+        net_dispatch(frame, len);
+    }
+    c_new = test_cycles() - t0;
+
+    t0 = test_cycles();
+    for (i = 0; i < n; i++) {
+        memcpy(frame, req, hdr);
+        __asm__ __volatile__("" : : "r"(frame) : "memory");
+    }
+    c_restore = test_cycles() - t0;
+    c_new = (c_new > c_restore) ? c_new - c_restore : 0U;
+
+    printf("%8u | %12.1f | %12.1f | %6.1fx\n", (unsigned)len,
+           (double)c_old / n, (double)c_new / n,
+           (c_new != 0U) ? (double)c_old / (double)c_new : 0.0);
+    CHECK(g_reply_len == len);
+}
+
+int main(void) {
+    static const uint16_t payloads[] = {18U, 56U, 512U, 1472U};
+    uint32_t i;
+
+    net_dispatch_init();
+    CHECK(net_register_ip_proto(NET_IP_PROTO_ICMP, "icmp", new_handle_icmp));
+
+    prv_test_correctness();
+
+    printf("ICMP echo reply, host cycles per packet (TSC)\n");
+    printf("%8s | %12s | %12s | %7s\n", "frame", "old copy+sum", "in-place", "speedup");
+    for (i = 0; i < sizeof(payloads) / sizeof(payloads[0]); i++) {
+        prv_bench(payloads[i]);
+    }
+
+    return test_done("test_icmp_echo");
+}
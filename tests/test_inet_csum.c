@@ -0,0 +1,191 @@
+/**
+ * \file            test_inet_csum.c
+ * \brief           inet_csum kernel: bit-exact against RFC 1071 and bytes per cycle
+ *
+ * Random lengths, data and start alignments are summed by inet_csum() and
+ * by the byte-pair reference loop in pkt_util.c; chained partial sums,
+ * inet_csum_combine() at odd and even split points, inet_csum_update16()
+ * and the lwIP hook are checked against the same reference.
+ *
+ * The benchmark compares inet_csum() with the ip_checksum() loop the
+ * original main.c used for every header and ICMP payload.
+ */
+
+#include "inet_csum.h"
+#include "pkt_util.h"
+#include "test_util.h"
+#include <string.h>
+
+#define MAX_LEN                     2048U
+
+static uint8_t g_buf[MAX_LEN + 16U];
+
+/*===========================================================================*/
+/*                  BASELINE (ip_checksum() in the original main.c)           */
+/*===========================================================================*/
+
+static uint16_t old_ip_checksum(const uint8_t* data, uint16_t len) {
+    uint32_t sum = 0;
+
+    while (len > 1) {
+        sum += ((uint16_t)data[0] << 8) | data[1];
+        data += 2;
+        len -= 2;
+    }
+    if (len == 1) {
+        sum += (uint16_t)data[0] << 8;
+    }
+    while (sum >> 16) {
+        sum = (sum & 0xFFFF) + (sum >> 16);
+    }
+    return (uint16_t)(~sum);
+}
+
+/*===========================================================================*/
+/*                              TESTS                                         */
+/*===========================================================================*/
+
+/**
+ * \brief           Value of a memory-order 16-bit result as the header bytes read
+ */
+static uint16_t prv_wire(uint16_t mem) {
+    uint8_t b[2];
+
+    memcpy(b, &mem, sizeof(b));
+    return (uint16_t)(((uint16_t)b[0] << 8) | b[1]);
+}
+
+static void prv_fill(uint8_t* p, uint32_t len, uint32_t pattern) {
+    uint32_t i;
+
+    for (i = 0; i < len; i++) {
+        switch (pattern) {
+            case 0:  p[i] = (uint8_t)test_rand(); break;
+            case 1:  p[i] = 0xFFU; break;               /* Maximum carries */
+            case 2:  p[i] = 0x00U; break;
+            default: p[i] = (i & 1U) ? 0x00U : 0xFFU; break;
+        }
+    }
+}
+
+static void prv_test_random(void) {
+    uint32_t iter;
+    uint32_t mismatches = 0;
+
+    for (iter = 0; iter < 200000U; iter++) {
+        uint32_t len = (iter < 4096U) ? (iter % 80U) : test_rand() % (MAX_LEN + 1U);
+        uint32_t off = test_rand() % 8U;
+        uint8_t* p = &g_buf[off];
+        uint16_t ref;
+        uint32_t split;
+        uint32_t sum;
+
+        prv_fill(p, len, (iter % 64U == 0U) ? (iter / 64U) % 4U : 0U);
+        ref = pkt_ref_csum(p, len);
+
+        if (prv_wire(inet_csum(p, len)) != ref) {
+            mismatches++;
+        }
+
+        /* lwIP wants the folded sum, not inverted */
+        CHECK_EQ(prv_wire(inet_csum_lwip(p, (int)len)), (uint16_t)~ref);
+
+        /* Split anywhere: chained partials only across an even offset,
+         * combine() for any offset */
+        split = (len != 0U) ? test_rand() % (len + 1U) : 0U;
+        sum = inet_csum_combine(inet_csum_partial(p, split, 0),
+                                inet_csum_partial(p + split, len - split, 0), split);
+        CHECK_EQ(prv_wire(inet_csum_finish(sum)), ref);
+        split &= ~1U;
+        sum = inet_csum_partial(p + split, len - split, inet_csum_partial(p, split, 0));
+        CHECK_EQ(prv_wire(inet_csum_finish(sum)), ref);
+    }
+    CHECK_EQ(mismatches, 0);
+    CHECK_EQ(inet_csum_lwip(g_buf, 0), 0);
+    CHECK_EQ(inet_csum_lwip(g_buf, -1), 0);
+}
+
+static void prv_test_update16(void) {
+    uint32_t iter;
+
+    for (iter = 0; iter < 100000U; iter++) {
+        uint32_t len = 2U + (test_rand() % 64U) * 2U;
+        uint32_t at = (test_rand() % (len / 2U)) * 2U;
+        uint16_t old_word;
+        uint16_t new_word;
+        uint16_t csum;
+        uint16_t ref;
+
+        prv_fill(g_buf, len, (iter % 16U == 0U) ? 1U : 0U);
+        csum = inet_csum(g_buf, len);
+        memcpy(&old_word, &g_buf[at], 2);
+        new_word = (iter & 1U) ? (uint16_t)test_rand() : (uint16_t)~old_word;
+        memcpy(&g_buf[at], &new_word, 2);
+
+        csum = inet_csum_update16(csum, old_word, new_word);
+        ref = pkt_ref_csum(g_buf, len);
+        /* RFC 1624 eqn. 3 may give 0xFFFF where a full sum gives 0x0000
+         * (the same value in one's complement); both verify */
+        if (prv_wire(csum) != ref) {
+            CHECK((prv_wire(csum) == 0xFFFFU && ref == 0U) ||
+                  (prv_wire(csum) == 0U && ref == 0xFFFFU));
+        }
+    }
+}
+
+static void prv_bench(uint32_t len, uint32_t off) {
+    const uint32_t n = 2000000U / (len / 16U + 1U);
+    const uint8_t* p = &g_buf[off];
+    volatile uint16_t sink = 0;
+    uint64_t t0;
+    uint64_t c_old;
+    uint64_t c_new;
+    uint32_t i;
+
+    prv_fill(g_buf, MAX_LEN, 0);
+
+    t0 = test_cycles();
+    for (i = 0; i < n; i++) {
+        sink = (uint16_t)(sink + old_ip_checksum(p, (uint16_t)len));
+        __asm__ __volatile__("" : : : "memory");
+    }
+    c_old = test_cycles() - t0;
+
+    t0 = test_cycles();
+    for (i = 0; i < n; i++) {
+        sink = (uint16_t)(sink + inet_csum(p, len));
+        __asm__ __volatile__("" : : : "memory");
+    }
+    c_new = test_cycles() - t0;
+
+    printf("%6lu %4lu | %10.2f | %10.2f | %6.1fx\n", (unsigned long)len, (unsigned long)off,
+           (double)len * n / (double)c_old, (double)len * n / (double)c_new,
+           (double)c_old / (double)c_new);
+    (void)sink;
+
+    /* Word-wide sum must not lose to the byte-pair loop on real payloads */
+    if (len >= 64U) {
+        CHECK(c_new < c_old);
+    }
+}
+
+int main(void) {
+    static const uint32_t lens[] = {20U, 64U, 576U, 1500U};
+    static const uint32_t offs[] = {0U, 1U, 2U};
+    uint32_t i;
+    uint32_t j;
+
+    test_srand(0x1071U);
+    prv_test_random();
+    prv_test_update16();
+
+    printf("Internet checksum, host bytes per cycle (TSC)\n");
+    printf("%6s %4s | %10s | %10s | %7s\n", "len", "off", "byte-pair", "inet_csum", "speedup");
+    for (i = 0; i < sizeof(lens) / sizeof(lens[0]); i++) {
+        for (j = 0; j < sizeof(offs) / sizeof(offs[0]); j++) {
+            prv_bench(lens[i], offs[j]);
+        }
+    }
+
+    return test_done("test_inet_csum");
+}
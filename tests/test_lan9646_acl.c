@@ -0,0 +1,292 @@
+/**
+ * \file            test_lan9646_acl.c
+ * \brief           ACL rule compiler: entry encoding and per-port programming on the register model
+ *
+ * Every match and action kind is compiled and compared byte for byte with
+ * an entry encoded by hand from the ACL entry format (byte 0 MD/ENB/S-D/EQ,
+ * byte 1 PM/P, byte 2 MM, byte 3 forward map, 0x04-0x0D the match fields,
+ * 0x0E-0x0F the rule set).
+ *
+ * The hook emulates the 16 entries of each port behind 0xN612: a write
+ * reaching the control register with WRITE set stores 0xN600-0xN60F, one
+ * without it loads them, and WRITE_DONE / READ_DONE can be held off for
+ * a number of control reads. Entry writes are checked to happen only
+ * while the port's ACL is off.
+ */
+
+#include "lan9646.h"
+#include "lan9646_acl.h"
+#include "lan9646_model.h"
+#include "test_util.h"
+#include <stdio.h>
+#include <string.h>
+
+static lan9646_t g_dev;
+
+static uint8_t g_tbl[8][LAN9646_ACL_ENTRIES][LAN9646_ACL_ENTRY_LEN];
+static uint8_t g_done[8];               /* Done bit to raise once the access completes */
+static uint32_t g_busy;                 /* Control reads before the done bit shows */
+static uint32_t g_busy_left;
+static uint32_t g_live_writes;          /* Entries written while the port's ACL was on */
+static uint8_t g_corrupt;               /* Port whose entry 1 reads back altered, 0 = none */
+
+/* Known-good entries */
+static const uint8_t k_ipv6_mask[16] = {
+    0x15, 0x00, 0x40, 0x5F, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x86, 0xDD, 0x00, 0x00, 0x00, 0x01,
+};
+static const uint8_t k_stp_redirect[16] = {
+    0x18, 0x00, 0x60, 0x20, 0x01, 0x80, 0xC2, 0x00,
+    0x00, 0x0E, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02,
+};
+static const uint8_t k_udp_permit[16] = {
+    0x31, 0x00, 0x20, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x11, 0x00, 0x00, 0x00, 0x00, 0x00, 0x04,
+};
+static const uint8_t k_subnet_drop[16] = {
+    0x27, 0x00, 0x60, 0x00, 0xC0, 0xA8, 0x01, 0x00,
+    0xFF, 0xFF, 0xFF, 0x00, 0x00, 0x00, 0x00, 0x08,
+};
+static const uint8_t k_tlm_prio[16] = {
+    0x39, 0xF0, 0x20, 0x00, 0x13, 0x8A, 0x13, 0x88,
+    0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10,
+};
+static const uint8_t k_tcp_src_ne[16] = {
+    0x36, 0x00, 0x60, 0x00, 0x00, 0x50, 0x00, 0x50,
+    0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x20,
+};
+static const uint8_t k_mac_type[16] = {
+    0x1F, 0x00, 0x60, 0x40, 0x10, 0x11, 0x22, 0x77,
+    0x77, 0x77, 0x08, 0x06, 0x00, 0x00, 0x00, 0x40,
+};
+
+/*===========================================================================*/
+/*                          TABLE MODEL                                       */
+/*===========================================================================*/
+
+static void prv_hook(uint16_t addr, uint16_t len, bool write) {
+    uint8_t* regs = lan9646_model_regs();
+    uint8_t port = (uint8_t)(addr >> 12);
+    uint16_t base = (uint16_t)(addr & 0xF000U);
+    uint16_t ctrl_addr = (uint16_t)(base | 0x0612U);
+    uint8_t ctrl;
+    uint8_t idx;
+
+    if (port > 7U || addr > ctrl_addr || addr + len <= ctrl_addr) return;
+
+    ctrl = regs[ctrl_addr];
+    idx = ctrl & LAN9646_ACL_INDEX_MASK;
+    if (write) {
+        if (ctrl & LAN9646_ACL_WRITE) {
+            memcpy(g_tbl[port][idx], &regs[base | 0x0600U], LAN9646_ACL_ENTRY_LEN);
+            if (regs[LAN9646_REG_PORT_AUTH_CTRL(port)] & LAN9646_PORT_ACL_EN) {
+                g_live_writes++;
+            }
+            g_done[port] = LAN9646_ACL_WRITE_DONE;
+        } else {
+            memcpy(&regs[base | 0x0600U], g_tbl[port][idx], LAN9646_ACL_ENTRY_LEN);
+            if (port == g_corrupt && idx == 1U) {
+                regs[base | 0x0605U] ^= 0x01U;
+            }
+            g_done[port] = LAN9646_ACL_READ_DONE;
+        }
+        regs[ctrl_addr] = idx;
+        g_busy_left = g_busy;
+    } else if (g_busy_left > 0U) {
+        g_busy_left--;
+    } else {
+        regs[ctrl_addr] |= g_done[port];
+    }
+}
+
+static void prv_setup(void) {
+    lan9646_model_reset();
+    CHECK_EQ(lan9646_model_attach(&g_dev), lan9646OK);
+    lan9646_model_set_hook(prv_hook);
+    memset(g_tbl, 0xEE, sizeof(g_tbl));
+    memset(g_done, 0, sizeof(g_done));
+    g_busy = 0;
+    g_busy_left = 0;
+    g_live_writes = 0;
+    g_corrupt = 0;
+}
+
+static uint32_t prv_txn(void) {
+    return lan9646_model_stats()->reads + lan9646_model_stats()->writes;
+}
+
+static void prv_rules(lan9646_acl_rule_t* r) {
+    memset(r, 0, 7U * sizeof(*r));
+
+    /* 0: IPv6 only to ports 1-4 and 7 */
+    r[0].match = LAN9646_ACL_MATCH_ETHERTYPE;
+    r[0].ethertype = 0x86DD;
+    r[0].action = LAN9646_ACL_MASK;
+    r[0].port_map = 0x5F;
+
+    /* 1: Anything not for the STP group address goes to port 6 only */
+    r[1].match = LAN9646_ACL_MATCH_MAC;
+    r[1].not_equal = true;
+    r[1].mac[0] = 0x01;
+    r[1].mac[1] = 0x80;
+    r[1].mac[2] = 0xC2;
+    r[1].mac[5] = 0x0E;
+    r[1].action = LAN9646_ACL_REDIRECT;
+    r[1].port_map = 0x20;
+
+    /* 2: UDP passes untouched */
+    r[2].match = LAN9646_ACL_MATCH_IP_PROTO;
+    r[2].proto = 17;
+    r[2].action = LAN9646_ACL_PERMIT;
+
+    /* 3: Drop a source subnet */
+    r[3].match = LAN9646_ACL_MATCH_IPV4;
+    r[3].src = true;
+    r[3].ip[0] = 192;
+    r[3].ip[1] = 168;
+    r[3].ip[2] = 1;
+    r[3].ip_mask[0] = 255;
+    r[3].ip_mask[1] = 255;
+    r[3].ip_mask[2] = 255;
+    r[3].action = LAN9646_ACL_DROP;
+
+    /* 4: Telemetry ports at priority 6 */
+    r[4].match = LAN9646_ACL_MATCH_UDP_PORT;
+    r[4].port_min = 5000;
+    r[4].port_max = 5002;
+    r[4].action = LAN9646_ACL_PRIORITY;
+    r[4].prio = 6;
+
+    /* 5: TCP from any source port but 80 dropped */
+    r[5].match = LAN9646_ACL_MATCH_TCP_PORT;
+    r[5].src = true;
+    r[5].not_equal = true;
+    r[5].port_min = 80;
+    r[5].port_max = 80;
+    r[5].action = LAN9646_ACL_DROP;
+
+    /* 6: ARP from the CPU MAC only to port 7 */
+    r[6].match = LAN9646_ACL_MATCH_MAC_ETHERTYPE;
+    r[6].src = true;
+    r[6].mac[0] = 0x10;
+    r[6].mac[1] = 0x11;
+    r[6].mac[2] = 0x22;
+    r[6].mac[3] = 0x77;
+    r[6].mac[4] = 0x77;
+    r[6].mac[5] = 0x77;
+    r[6].ethertype = 0x0806;
+    r[6].action = LAN9646_ACL_REDIRECT;
+    r[6].port_map = 0x40;
+}
+
+/*===========================================================================*/
+/*                              TESTS                                         */
+/*===========================================================================*/
+
+static void prv_test_encoding(void) {
+    static const uint8_t* const known[7] = {
+        k_ipv6_mask, k_stp_redirect, k_udp_permit, k_subnet_drop,
+        k_tlm_prio, k_tcp_src_ne, k_mac_type,
+    };
+    lan9646_acl_rule_t r[7];
+    lan9646_acl_entry_t e;
+    uint8_t i;
+
+    prv_rules(r);
+    for (i = 0; i < 7U; i++) {
+        CHECK_EQ(lan9646_acl_compile(&r[i], i, &e), lan9646OK);
+        CHECK(memcmp(e.b, known[i], LAN9646_ACL_ENTRY_LEN) == 0);
+    }
+
+    /* The rule set follows the index */
+    CHECK_EQ(lan9646_acl_compile(&r[4], 15, &e), lan9646OK);
+    CHECK_EQ(e.b[14], 0x80);
+    CHECK_EQ(e.b[15], 0x00);
+    CHECK_EQ(lan9646_acl_compile(&r[4], 16, &e), lan9646INVPARAM);
+
+    /* Out of range fields are refused */
+    r[4].port_min = 6000;
+    CHECK_EQ(lan9646_acl_compile(&r[4], 0, &e), lan9646INVPARAM);
+    r[4].port_min = 5000;
+    r[4].prio = 8;
+    CHECK_EQ(lan9646_acl_compile(&r[4], 0, &e), lan9646INVPARAM);
+    r[4].prio = 6;
+    r[4].match = (lan9646_acl_match_t)7;
+    CHECK_EQ(lan9646_acl_compile(&r[4], 0, &e), lan9646INVPARAM);
+    r[4].match = LAN9646_ACL_MATCH_UDP_PORT;
+    r[4].action = (lan9646_acl_action_t)5;
+    CHECK_EQ(lan9646_acl_compile(&r[4], 0, &e), lan9646INVPARAM);
+}
+
+static void prv_test_program(void) {
+    lan9646_acl_rule_t r[7];
+    lan9646_acl_entry_t e;
+    uint16_t bad;
+    uint8_t i;
+
+    prv_rules(r);
+    prv_setup();
+    lan9646_model_set(LAN9646_REG_PORT_AUTH_CTRL(2), 1, 0x03);
+
+    /* ACL off (read + write), 16 x (burst, control read), ACL on (read + write) */
+    CHECK_EQ(lan9646_acl_program(&g_dev, 2, r, 7), lan9646OK);
+    CHECK_EQ(prv_txn(), 2U + 2U * LAN9646_ACL_ENTRIES + 2U);
+    CHECK_EQ(lan9646_model_stats()->write_bytes, 2U + 19U * LAN9646_ACL_ENTRIES);
+    printf("ACL program, 7 rules on port 2: %lu transactions, %.1f ms at 100 kHz\n",
+           (unsigned long)prv_txn(), (double)lan9646_model_bus_ns(LAN9646_MODEL_I2C_HZ) / 1e6);
+    CHECK_EQ(g_live_writes, 0);
+    CHECK_EQ(lan9646_model_get(LAN9646_REG_PORT_AUTH_CTRL(2), 1), 0x07);
+    CHECK(memcmp(g_tbl[2][0], k_ipv6_mask, 16) == 0);
+    CHECK(memcmp(g_tbl[2][6], k_mac_type, 16) == 0);
+    for (i = 7; i < LAN9646_ACL_ENTRIES; i++) {
+        CHECK_EQ(g_tbl[2][i][0], 0);            /* Mode 0: disabled */
+        CHECK_EQ(g_tbl[2][i][15], 0);
+    }
+    CHECK_EQ(g_tbl[3][0][0], 0xEE);             /* Other ports untouched */
+
+    /* Readback matches, a short list flags the entries it no longer has */
+    CHECK_EQ(lan9646_acl_read_entry(&g_dev, 2, 3, &e), lan9646OK);
+    CHECK(memcmp(e.b, k_subnet_drop, 16) == 0);
+    CHECK_EQ(lan9646_acl_verify(&g_dev, 2, r, 7, &bad), lan9646OK);
+    CHECK_EQ(bad, 0);
+    CHECK_EQ(lan9646_acl_verify(&g_dev, 2, r, 5, &bad), lan9646ERR);
+    CHECK_EQ(bad, 0x0060);
+    g_corrupt = 2;
+    CHECK_EQ(lan9646_acl_verify(&g_dev, 2, r, 7, &bad), lan9646ERR);
+    CHECK_EQ(bad, 0x0002);
+    g_corrupt = 0;
+
+    /* A rule that does not compile leaves the port alone */
+    r[3].action = LAN9646_ACL_PRIORITY;
+    r[3].prio = 9;
+    lan9646_model_clear_stats();
+    CHECK_EQ(lan9646_acl_program(&g_dev, 2, r, 7), lan9646INVPARAM);
+    CHECK_EQ(prv_txn(), 0);
+    CHECK_EQ(lan9646_acl_program(&g_dev, 5, r, 1), lan9646INVPARAM);
+    CHECK_EQ(lan9646_acl_program(&g_dev, 2, r, LAN9646_ACL_ENTRIES + 1U), lan9646INVPARAM);
+
+    /* Clearing leaves the ACL off with every entry disabled */
+    CHECK_EQ(lan9646_acl_program(&g_dev, 2, NULL, 0), lan9646OK);
+    CHECK_EQ(lan9646_model_get(LAN9646_REG_PORT_AUTH_CTRL(2), 1), 0x03);
+    for (i = 0; i < LAN9646_ACL_ENTRIES; i++) {
+        CHECK_EQ(g_tbl[2][i][0], 0);
+    }
+
+    /* Slow accesses are polled, one that never finishes times out */
+    prv_rules(r);
+    g_busy = 2;
+    CHECK_EQ(lan9646_acl_program(&g_dev, 6, r, 2), lan9646OK);
+    CHECK(memcmp(g_tbl[6][1], k_stp_redirect, 16) == 0);
+    CHECK_EQ(lan9646_acl_read_entry(&g_dev, 6, 0, &e), lan9646OK);
+    CHECK(memcmp(e.b, k_ipv6_mask, 16) == 0);
+    g_busy = LAN9646_ACL_POLL_MAX + 1U;
+    CHECK_EQ(lan9646_acl_program(&g_dev, 6, r, 2), lan9646TIMEOUT);
+    CHECK_EQ(lan9646_acl_read_entry(&g_dev, 6, 0, &e), lan9646TIMEOUT);
+}
+
+int main(void) {
+    prv_test_encoding();
+    prv_test_program();
+
+    return test_done("test_lan9646_acl");
+}
@@ -0,0 +1,306 @@
+/**
+ * \file            test_lan9646_alu.c
+ * \brief           ALU table management: indirect access sequences on the register model
+ *
+ * The hook emulates the static address table behind 0x041C (16 slots of
+ * four entry words at 0x0420) and the dynamic table search behind 0x0418:
+ * after START with the search action every valid entry is presented with
+ * VALID set, and reading the last entry register moves the search on.
+ * START can be held for a number of control reads to exercise polling.
+ *
+ * Entry word layouts are checked against hand-encoded values of the
+ * static table format (valid, filters, priority, MSTP / override, FID
+ * match, port map / FID, MAC[47:32] / MAC[31:0]).
+ */
+
+#include "lan9646.h"
+#include "lan9646_alu.h"
+#include "lan9646_model.h"
+#include "test_util.h"
+#include <stdio.h>
+#include <string.h>
+
+#define DYN_MAX                     8U
+
+static lan9646_t g_dev;
+static lan9646_alu_t g_alu;
+
+static uint8_t g_sta[LAN9646_ALU_STATIC_ENTRIES][16];
+static uint8_t g_dyn[DYN_MAX][16];
+static uint8_t g_dyn_n;
+static int g_pos;                       /* Search position, -1 = idle */
+static bool g_advance;                  /* Entry read: next one on the following access */
+static uint32_t g_busy;                 /* Control reads with START still set */
+static uint32_t g_busy_left;
+static bool g_stuck;                    /* START never clears */
+
+/*===========================================================================*/
+/*                          TABLE MODEL                                       */
+/*===========================================================================*/
+
+static void prv_present(void) {
+    if (g_pos < (int)g_dyn_n) {
+        memcpy(&lan9646_model_regs()[LAN9646_REG_ALU_TABLE_ENTRY0], g_dyn[g_pos], 16);
+        lan9646_model_set(LAN9646_REG_ALU_TABLE_CTRL, 4,
+                          LAN9646_ALU_START | LAN9646_ALU_VALID | LAN9646_ALU_ACTION_SEARCH
+                          | ((uint32_t)g_dyn_n << LAN9646_ALU_VALID_CNT_SHIFT));
+    } else {
+        lan9646_model_set(LAN9646_REG_ALU_TABLE_CTRL, 4, LAN9646_ALU_SEARCH_END);
+        g_pos = -1;
+    }
+}
+
+static void prv_hook(uint16_t addr, uint16_t len, bool write) {
+    uint8_t* regs = lan9646_model_regs();
+    uint32_t ctrl;
+    uint8_t idx;
+
+    /* A control write decides for itself what comes next */
+    if (write && addr == LAN9646_REG_ALU_TABLE_CTRL) {
+        g_advance = false;
+    }
+    if (g_advance) {
+        g_advance = false;
+        g_pos++;
+        prv_present();
+    }
+
+    if (write && addr == LAN9646_REG_STATIC_TABLE_CTRL && len == 4U) {
+        ctrl = lan9646_model_get(addr, 4);
+        idx = (uint8_t)((ctrl & LAN9646_STA_INDEX_MASK) >> LAN9646_STA_INDEX_SHIFT);
+        if ((ctrl & LAN9646_STA_START) && idx < LAN9646_ALU_STATIC_ENTRIES) {
+            if (ctrl & LAN9646_STA_READ) {
+                memcpy(&regs[LAN9646_REG_ALU_TABLE_ENTRY0], g_sta[idx], 16);
+            } else {
+                memcpy(g_sta[idx], &regs[LAN9646_REG_ALU_TABLE_ENTRY0], 16);
+            }
+            g_busy_left = g_busy;
+        }
+    } else if (!write && addr == LAN9646_REG_STATIC_TABLE_CTRL) {
+        if (g_busy_left > 0U || g_stuck) {
+            g_busy_left -= (g_busy_left > 0U) ? 1U : 0U;
+        } else {
+            regs[addr + 3U] &= (uint8_t)~LAN9646_STA_START;
+        }
+    } else if (write && addr == LAN9646_REG_ALU_TABLE_CTRL && len == 4U) {
+        ctrl = lan9646_model_get(addr, 4);
+        if ((ctrl & 0x83U) == (LAN9646_ALU_START | LAN9646_ALU_ACTION_SEARCH)) {
+            g_pos = 0;
+            prv_present();
+        } else if (ctrl == 0U) {
+            g_pos = -1;
+        }
+    } else if (!write && addr == LAN9646_REG_ALU_TABLE_ENTRY0 && len == 16U && g_pos >= 0) {
+        g_advance = true;
+    }
+}
+
+static void prv_word(uint8_t* e, uint8_t w, uint32_t v) {
+    e[4U * w + 0U] = (uint8_t)(v >> 24);
+    e[4U * w + 1U] = (uint8_t)(v >> 16);
+    e[4U * w + 2U] = (uint8_t)(v >> 8);
+    e[4U * w + 3U] = (uint8_t)v;
+}
+
+static uint32_t prv_get_word(const uint8_t* e, uint8_t w) {
+    return ((uint32_t)e[4U * w] << 24) | ((uint32_t)e[4U * w + 1U] << 16)
+           | ((uint32_t)e[4U * w + 2U] << 8) | e[4U * w + 3U];
+}
+
+static void prv_setup(void) {
+    lan9646_model_reset();
+    CHECK_EQ(lan9646_model_attach(&g_dev), lan9646OK);
+    lan9646_model_set_hook(prv_hook);
+    memset(g_sta, 0, sizeof(g_sta));
+    memset(g_dyn, 0, sizeof(g_dyn));
+    g_dyn_n = 0;
+    g_pos = -1;
+    g_advance = false;
+    g_busy = 0;
+    g_busy_left = 0;
+    g_stuck = false;
+}
+
+static uint32_t prv_txn(void) {
+    return lan9646_model_stats()->reads + lan9646_model_stats()->writes;
+}
+
+/*===========================================================================*/
+/*                              TESTS                                         */
+/*===========================================================================*/
+
+static void prv_test_static(void) {
+    static const uint8_t cpu_mac[6] = {0x10, 0x11, 0x22, 0x77, 0x77, 0x77};
+    static const uint8_t other[6] = {0x01, 0x80, 0xC2, 0x00, 0x00, 0x0E};
+    lan9646_alu_entry_t e;
+    lan9646_alu_entry_t f;
+    lan9646_alu_t again;
+    uint8_t i;
+
+    prv_setup();
+
+    /* An entry already in slot 3 is picked up by init: 16 x (start, poll, burst) */
+    prv_word(g_sta[3], 0, LAN9646_ALU_E0_VALID);
+    prv_word(g_sta[3], 1, 0x01);
+    prv_word(g_sta[3], 2, 0x0180);
+    prv_word(g_sta[3], 3, 0xC200000EU);
+    CHECK_EQ(lan9646_alu_init(&g_alu, &g_dev), lan9646OK);
+    CHECK_EQ(g_alu.used, 0x0008);
+    CHECK_EQ(prv_txn(), 3U * LAN9646_ALU_STATIC_ENTRIES);
+    CHECK(lan9646_alu_static_find(&g_alu, other, 0, &f));
+    CHECK_EQ(f.port_map, 0x01);
+
+    /* main.c: CPU MAC to port 6, first free slot, one burst + start + poll */
+    memset(&e, 0, sizeof(e));
+    memcpy(e.mac, cpu_mac, 6);
+    e.port_map = 0x20;
+    lan9646_model_clear_stats();
+    CHECK_EQ(lan9646_alu_static_add(&g_alu, &e), lan9646OK);
+    CHECK_EQ(prv_txn(), 3);
+    CHECK_EQ(g_alu.used, 0x0009);
+    CHECK_EQ(prv_get_word(g_sta[0], 0), 0x80000000U);
+    CHECK_EQ(prv_get_word(g_sta[0], 1), 0x00000020U);
+    CHECK_EQ(prv_get_word(g_sta[0], 2), 0x00001011U);
+    CHECK_EQ(prv_get_word(g_sta[0], 3), 0x22777777U);
+    CHECK_EQ(lan9646_model_get(LAN9646_REG_STATIC_TABLE_CTRL, 4), 0x00000000U);
+
+    /* Same MAC updates in place, lookups never touch the bus */
+    e.port_map = 0x21;
+    CHECK_EQ(lan9646_alu_static_add(&g_alu, &e), lan9646OK);
+    CHECK_EQ(g_alu.used, 0x0009);
+    CHECK_EQ(prv_get_word(g_sta[0], 1), 0x00000021U);
+    lan9646_model_clear_stats();
+    CHECK(lan9646_alu_static_find(&g_alu, cpu_mac, 0, &f));
+    CHECK_EQ(f.port_map, 0x21);
+    CHECK(!lan9646_alu_static_find(&g_alu, cpu_mac, 1, NULL));
+    CHECK_EQ(prv_txn(), 0);
+
+    /* Every field in its place */
+    memset(&f, 0, sizeof(f));
+    memcpy(f.mac, cpu_mac, 6);
+    f.mac[5] = 0x78;
+    f.port_map = 0x4F;
+    f.fid = 5;
+    f.prio = 3;
+    f.mstp = 2;
+    f.flags = LAN9646_ALU_F_SRC_FILTER | LAN9646_ALU_F_OVERRIDE | LAN9646_ALU_F_USE_FID;
+    CHECK_EQ(lan9646_alu_static_add(&g_alu, &f), lan9646OK);
+    CHECK_EQ(prv_get_word(g_sta[1], 0), 0xCC000002U);
+    CHECK_EQ(prv_get_word(g_sta[1], 1), 0xC000004FU);
+    CHECK_EQ(prv_get_word(g_sta[1], 2), 0x00051011U);
+    CHECK_EQ(prv_get_word(g_sta[1], 3), 0x22777778U);
+
+    /* A fresh context reads back what was written */
+    CHECK_EQ(lan9646_alu_init(&again, &g_dev), lan9646OK);
+    CHECK_EQ(again.used, g_alu.used);
+    CHECK_EQ(memcmp(&again.sta[1], &f, sizeof(f)), 0);
+
+    /* Remove clears the valid bit of that slot only */
+    CHECK_EQ(lan9646_alu_static_remove(&g_alu, cpu_mac, 0), lan9646OK);
+    CHECK_EQ(g_alu.used, 0x000A);
+    CHECK_EQ(prv_get_word(g_sta[0], 0) & LAN9646_ALU_E0_VALID, 0);
+    CHECK_EQ(lan9646_alu_static_remove(&g_alu, cpu_mac, 0), lan9646ERR);
+
+    /* Fill up: 16 slots, then full */
+    for (i = 0; i < LAN9646_ALU_STATIC_ENTRIES; i++) {
+        e.mac[5] = (uint8_t)(0xA0U + i);
+        CHECK_EQ(lan9646_alu_static_add(&g_alu, &e), (i < 14U) ? lan9646OK : lan9646ERR);
+    }
+    CHECK_EQ(g_alu.used, 0xFFFF);
+
+    /* Slow access is polled, a stuck one times out */
+    g_busy = 3;
+    CHECK_EQ(lan9646_alu_static_remove(&g_alu, other, 0), lan9646OK);
+    CHECK_EQ(g_alu.stats.polls, 3);
+    g_stuck = true;
+    e.mac[5] = 0xA0U + 13U;
+    CHECK_EQ(lan9646_alu_static_remove(&g_alu, e.mac, 0), lan9646TIMEOUT);
+    CHECK_EQ(g_alu.stats.timeouts, 1);
+    CHECK(lan9646_alu_static_find(&g_alu, e.mac, 0, NULL));
+}
+
+static uint32_t g_seen;
+static uint8_t g_seen_static;
+static uint32_t g_stop_after;
+
+static bool prv_dump_cb(const lan9646_alu_entry_t* e, void* arg) {
+    (void)arg;
+    g_seen++;
+    if (e->flags & LAN9646_ALU_F_STATIC) {
+        g_seen_static++;
+    }
+    CHECK_EQ(e->mac[5], 0x10U + g_seen - 1U);
+    CHECK_EQ(e->port_map, 1U << (g_seen - 1U));
+    return g_stop_after == 0U || g_seen < g_stop_after;
+}
+
+static void prv_test_dump(void) {
+    uint16_t n;
+    uint8_t i;
+
+    prv_setup();
+    CHECK_EQ(lan9646_alu_init(&g_alu, &g_dev), lan9646OK);
+    g_dyn_n = 5;
+    for (i = 0; i < g_dyn_n; i++) {
+        prv_word(g_dyn[i], 0, (i == 1U) ? LAN9646_ALU_E0_VALID : 0U);
+        prv_word(g_dyn[i], 1, 1U << i);
+        prv_word(g_dyn[i], 2, 0x0002);
+        prv_word(g_dyn[i], 3, 0x00000010U + i);
+    }
+
+    /* One search: start, then control + 16-byte burst per entry, final control read */
+    g_seen = 0;
+    g_seen_static = 0;
+    g_stop_after = 0;
+    lan9646_model_clear_stats();
+    CHECK_EQ(lan9646_alu_dump(&g_alu, prv_dump_cb, NULL, &n), lan9646OK);
+    CHECK_EQ(n, 5);
+    CHECK_EQ(g_seen, 5);
+    CHECK_EQ(g_seen_static, 1);
+    CHECK_EQ(prv_txn(), 1U + 2U * 5U + 1U);
+    CHECK_EQ(lan9646_model_stats()->read_bytes, 16U * 5U + 4U * 6U);
+    printf("Dynamic table dump: %u entries in %lu transactions\n", n, (unsigned long)prv_txn());
+
+    /* Stopping early ends the search on the device */
+    g_seen = 0;
+    g_stop_after = 2;
+    CHECK_EQ(lan9646_alu_dump(&g_alu, prv_dump_cb, NULL, &n), lan9646OK);
+    CHECK_EQ(n, 2);
+    CHECK_EQ(g_pos, -1);
+    CHECK_EQ(lan9646_model_get(LAN9646_REG_ALU_TABLE_CTRL, 4), 0);
+
+    /* Empty table */
+    g_dyn_n = 0;
+    CHECK_EQ(lan9646_alu_dump(&g_alu, NULL, NULL, &n), lan9646OK);
+    CHECK_EQ(n, 0);
+    CHECK_EQ(g_alu.stats.searches, 3);
+}
+
+static void prv_test_port_controls(void) {
+    prv_setup();
+    CHECK_EQ(lan9646_alu_init(&g_alu, &g_dev), lan9646OK);
+    lan9646_model_set(LAN9646_REG_LUE_CTRL1, 1, 0x20);
+    lan9646_model_set(LAN9646_REG_PORT_MSTP_STATE(6), 1, 0x06);
+
+    CHECK_EQ(lan9646_alu_set_aging(&g_alu, true, 120), lan9646OK);
+    CHECK_EQ(lan9646_model_get(LAN9646_REG_AGE_PERIOD, 1), 120);
+    CHECK_EQ(lan9646_model_get(LAN9646_REG_LUE_CTRL1, 1), 0x24);
+    CHECK_EQ(lan9646_alu_set_aging(&g_alu, false, 120), lan9646OK);
+    CHECK_EQ(lan9646_model_get(LAN9646_REG_LUE_CTRL1, 1), 0x20);
+    CHECK_EQ(lan9646_alu_set_aging(&g_alu, true, 0), lan9646INVPARAM);
+
+    /* main.c: no learning on port 6, unknown unicast to the PHY ports only */
+    CHECK_EQ(lan9646_alu_set_learning(&g_alu, 6, false), lan9646OK);
+    CHECK_EQ(lan9646_model_get(LAN9646_REG_PORT_MSTP_STATE(6), 1), 0x07);
+    CHECK_EQ(lan9646_alu_set_learning(&g_alu, 5, false), lan9646INVPARAM);
+    CHECK_EQ(lan9646_alu_set_unknown_unicast(&g_alu, 0x0F), lan9646OK);
+    CHECK_EQ(lan9646_model_get(LAN9646_REG_UNKNOWN_UCAST, 4), 0x8000000FU);
+}
+
+int main(void) {
+    prv_test_static();
+    prv_test_dump();
+    prv_test_port_controls();
+
+    return test_done("test_lan9646_alu");
+}
@@ -0,0 +1,323 @@
+/**
+ * \file            test_lan9646_async.c
+ * \brief           Queued register engine: time per service slice and MIB latch/fetch atomicity
+ *
+ * The engine runs on a simulated stepped I2C bus: a transaction costs two
+ * half-clock phases per SCL period of the model's bit count, a step spends
+ * at most the budget it is given, and the register model is accessed when
+ * the last phase is spent. main.c gives the engine LAN_ASYNC_BUDGET phases
+ * per superloop pass; no service call may spend more.
+ *
+ * The blocking device uses I2C callbacks that quiesce the engine first, as
+ * main.c does. An async MIB snapshot runs while blocking lan9646_mib_read()
+ * calls hit the same ports between slices. Before, the latch write and the
+ * 8-byte fetch were two queued requests: a blocking read in between latched
+ * another counter, the fetch returned that one and the latched counter was
+ * lost (read-clear). With the pair, every count ends up exactly once in
+ * either the snapshot totals or the blocking reads.
+ */
+
+#include "lan9646.h"
+#include "lan9646_async.h"
+#include "lan9646_mib.h"
+#include "lan9646_model.h"
+#include "test_util.h"
+#include <stdio.h>
+#include <string.h>
+
+#define BUDGET                      32U         /* main.c: LAN_ASYNC_BUDGET */
+#define PORT_MASK                   0xDEU       /* main.c: MIB_PORT_MASK */
+#define PHASE_NS                    (1000000000ULL / (2ULL * LAN9646_MODEL_I2C_HZ))
+
+static lan9646_t g_dev;
+static lan9646_mib_engine_t g_mib;
+static lan9646_async_t g_async;
+
+/*===========================================================================*/
+/*                          SIMULATED STEPPED BUS                             */
+/*===========================================================================*/
+
+static struct {
+    bool read;
+    uint16_t addr;
+    uint8_t* data;
+    uint16_t len;
+    uint32_t left;              /* Phases still to run */
+} g_xfer;
+static bool g_on_bus;
+static uint32_t g_slice;        /* Phases spent by the current service call */
+static uint32_t g_quiesce;      /* Phases spent finishing for a blocking access */
+static uint32_t g_quiesce_max;
+
+static uint32_t prv_phases(bool read, uint16_t len) {
+    /* lan9646_model.c bit count, two phases per SCL period */
+    return 2U * (read ? (9U * (4U + (uint32_t)len) + 3U) : (9U * (3U + (uint32_t)len) + 2U));
+}
+
+static lan9646r_t prv_start(bool read, uint16_t reg_addr, uint8_t* data, uint16_t len) {
+    CHECK(!g_on_bus);
+    g_xfer.read = read;
+    g_xfer.addr = reg_addr;
+    g_xfer.data = data;
+    g_xfer.len = len;
+    g_xfer.left = prv_phases(read, len);
+    g_on_bus = true;
+    return lan9646OK;
+}
+
+static bool prv_step(uint16_t budget, uint16_t* used, lan9646r_t* res) {
+    const lan9646_i2c_t* i2c = lan9646_model_i2c();
+    uint32_t n = (g_xfer.left < budget) ? g_xfer.left : budget;
+
+    g_xfer.left -= n;
+    *used = (uint16_t)n;
+    if (budget == 0xFFFFU) {
+        g_quiesce += n;
+    } else {
+        g_slice += n;
+    }
+    if (g_xfer.left > 0U) return true;
+
+    g_on_bus = false;
+    *res = g_xfer.read ? i2c->mem_read_fn(LAN9646_I2C_ADDR_DEFAULT, g_xfer.addr, g_xfer.data, g_xfer.len)
+                       : i2c->mem_write_fn(LAN9646_I2C_ADDR_DEFAULT, g_xfer.addr, g_xfer.data, g_xfer.len);
+    return false;
+}
+
+static const lan9646_async_bus_t g_bus = {
+    .start_fn = prv_start,
+    .step_fn = prv_step,
+};
+
+/* main.c: blocking accesses first let the engine finish its request */
+static void prv_quiesce(void) {
+    g_quiesce = 0;
+    lan9646_async_quiesce(&g_async);
+    if (g_quiesce > g_quiesce_max) g_quiesce_max = g_quiesce;
+    CHECK(!g_on_bus);
+}
+
+static lan9646r_t prv_init(void) {
+    return lan9646OK;
+}
+
+static lan9646r_t prv_mem_write(uint8_t dev_addr, uint16_t mem_addr, const uint8_t* data,
+                                uint16_t len) {
+    prv_quiesce();
+    return lan9646_model_i2c()->mem_write_fn(dev_addr, mem_addr, data, len);
+}
+
+static lan9646r_t prv_mem_read(uint8_t dev_addr, uint16_t mem_addr, uint8_t* data, uint16_t len) {
+    prv_quiesce();
+    return lan9646_model_i2c()->mem_read_fn(dev_addr, mem_addr, data, len);
+}
+
+/*===========================================================================*/
+/*                              TESTS                                         */
+/*===========================================================================*/
+
+static uint8_t prv_index(uint8_t slot) {
+    return (slot < 0x20U) ? slot : (uint8_t)(slot + 0x60U);
+}
+
+static void prv_setup(void) {
+    lan9646_cfg_t cfg;
+    uint8_t port, slot;
+
+    lan9646_model_reset();
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.if_type = LAN9646_IF_I2C;
+    cfg.i2c_addr = LAN9646_I2C_ADDR_DEFAULT;
+    cfg.ops.i2c.init_fn = prv_init;
+    cfg.ops.i2c.mem_write_fn = prv_mem_write;
+    cfg.ops.i2c.mem_read_fn = prv_mem_read;
+    CHECK_EQ(lan9646_init(&g_dev, &cfg), lan9646OK);
+    CHECK_EQ(lan9646_async_init(&g_async, &g_bus), lan9646OK);
+    CHECK_EQ(lan9646_mib_init(&g_mib, &g_dev, PORT_MASK, true), lan9646OK);
+
+    for (port = 1; port <= LAN9646_MIB_PORTS; port++) {
+        if ((PORT_MASK & (1U << port)) == 0) continue;
+        for (slot = 0; slot < LAN9646_MIB_COUNTERS; slot++) {
+            lan9646_model_set_mib(port, prv_index(slot), 1000U * port + slot + 1U);
+        }
+    }
+    g_on_bus = false;
+    g_quiesce_max = 0;
+    lan9646_model_clear_stats();
+}
+
+/**
+ * \brief           Run a snapshot to the end; every blocking_every-th slice is
+ *                  followed by a blocking MIB read on the same ports
+ * \param[out]      taken: Counts returned by the blocking reads, [port][slot]
+ * \return          Service calls
+ */
+static uint32_t prv_run(uint32_t blocking_every, uint64_t taken[8][LAN9646_MIB_COUNTERS],
+                        uint32_t* slice_max, uint32_t* blocking) {
+    static const uint8_t ports[] = {1, 2, 3, 4, 6, 7};
+    uint32_t calls = 0, k = 0;
+    uint64_t v;
+    uint8_t port, slot;
+
+    *slice_max = 0;
+    *blocking = 0;
+    CHECK_EQ(lan9646_mib_snapshot_async(&g_mib, &g_async, 1000), lan9646OK);
+    while (lan9646_mib_busy(&g_mib) && calls < 100000U) {
+        g_slice = 0;
+        (void)lan9646_async_service(&g_async, BUDGET);
+        calls++;
+        CHECK(g_slice <= BUDGET);
+        if (g_slice > *slice_max) *slice_max = g_slice;
+
+        if (blocking_every != 0 && (calls % blocking_every) == 0 && lan9646_mib_busy(&g_mib)) {
+            port = ports[k % sizeof(ports)];
+            slot = (uint8_t)((k * 7U) % LAN9646_MIB_COUNTERS);
+            k++;
+            CHECK_EQ(lan9646_mib_read(&g_dev, port, prv_index(slot), &v), lan9646OK);
+            taken[port][slot] += v;
+            (*blocking)++;
+        }
+    }
+    CHECK(!lan9646_mib_busy(&g_mib));
+    CHECK(!lan9646_async_pending(&g_async));
+    return calls;
+}
+
+/**
+ * \brief           Every count is in the snapshot or in a blocking read, once
+ */
+static uint32_t prv_check_totals(uint64_t taken[8][LAN9646_MIB_COUNTERS]) {
+    uint32_t wrong = 0;
+    uint8_t port, slot;
+
+    for (port = 1; port <= LAN9646_MIB_PORTS; port++) {
+        if ((PORT_MASK & (1U << port)) == 0) continue;
+        for (slot = 0; slot < LAN9646_MIB_COUNTERS; slot++) {
+            if (lan9646_mib_get(&g_mib, port, prv_index(slot)) + taken[port][slot]
+                != 1000U * port + slot + 1U) {
+                wrong++;
+            }
+        }
+    }
+    return wrong;
+}
+
+static void prv_test_slices(void) {
+    static const uint32_t every[] = {0, 1, 2, 5};
+    static uint64_t taken[8][LAN9646_MIB_COUNTERS];
+    lan9646_async_stats_t st;
+    lan9646_mib_stats_t ms;
+    uint32_t calls, slice_max, blocking, wrong;
+    uint32_t pair = prv_phases(false, 4) + prv_phases(true, 8);
+    size_t i;
+
+    printf("\n  Async MIB snapshot, %u ports x %u counters, budget %u phases (%llu us)\n",
+           6U, (unsigned)LAN9646_MIB_COUNTERS, (unsigned)BUDGET,
+           (unsigned long long)(BUDGET * PHASE_NS / 1000U));
+    printf("  %-16s %8s %10s %10s %10s %12s %8s\n", "blocking reads", "calls", "slice max",
+           "slice us", "reads", "quiesce us", "wrong");
+
+    for (i = 0; i < sizeof(every) / sizeof(every[0]); i++) {
+        prv_setup();
+        memset(taken, 0, sizeof(taken));
+        calls = prv_run(every[i], taken, &slice_max, &blocking);
+        wrong = prv_check_totals(taken);
+        lan9646_async_get_stats(&g_async, &st);
+        lan9646_mib_get_stats(&g_mib, &ms);
+
+        CHECK(slice_max <= BUDGET);
+        CHECK(st.max_used <= BUDGET);
+        CHECK_EQ(wrong, 0);
+        CHECK_EQ(ms.errors, 0);
+        CHECK_EQ(ms.counters, 6U * LAN9646_MIB_COUNTERS);
+        CHECK_EQ(ms.transactions, 2U + 2U * 6U * LAN9646_MIB_COUNTERS);
+        /* A blocking reader waits for at most one latch/fetch pair */
+        CHECK(g_quiesce_max <= pair);
+        if (every[i] == 0) {
+            CHECK_EQ(st.quiesced, 0);
+        } else {
+            CHECK(st.quiesced > 0);
+        }
+
+        if (every[i] == 0) {
+            printf("  %-16s", "none");
+        } else {
+            printf("  every %-3u call ", (unsigned)every[i]);
+        }
+        printf(" %8u %10u %10llu %10u %12llu %8u\n", (unsigned)calls, (unsigned)slice_max,
+               (unsigned long long)(slice_max * PHASE_NS / 1000U), (unsigned)blocking,
+               (unsigned long long)(g_quiesce_max * PHASE_NS / 1000U), (unsigned)wrong);
+    }
+}
+
+static lan9646r_t g_done_res;
+static uint32_t g_done_n;
+
+static void prv_done(lan9646r_t res, void* arg) {
+    (void)arg;
+    g_done_res = res;
+    g_done_n++;
+}
+
+static void prv_test_pair(void) {
+    static const uint8_t cmd[4] = {0x12, 0x34, 0x56, 0x78};
+    uint8_t back[4], big[LAN9646_ASYNC_INLINE + 1U];
+    uint32_t calls = 0;
+
+    prv_setup();
+    memset(big, 0, sizeof(big));
+
+    /* The read follows the write without a high request in between */
+    g_done_n = 0;
+    CHECK_EQ(lan9646_async_write_read(&g_async, LAN9646_ASYNC_NORMAL, 0x0400, cmd, sizeof(cmd),
+                                      0x0400, back, sizeof(back), prv_done, NULL), lan9646OK);
+    CHECK_EQ(lan9646_async_write8(&g_async, LAN9646_ASYNC_NORMAL, 0x0300, 0x01, NULL, NULL), lan9646OK);
+    g_slice = 0;
+    (void)lan9646_async_service(&g_async, 1);
+    CHECK_EQ(lan9646_async_write8(&g_async, LAN9646_ASYNC_HIGH, 0x0400, 0xEE, NULL, NULL), lan9646OK);
+    while (g_done_n == 0 && calls++ < 1000U) {
+        (void)lan9646_async_service(&g_async, BUDGET);
+    }
+    CHECK_EQ(g_done_res, lan9646OK);
+    CHECK_EQ(memcmp(back, cmd, sizeof(cmd)), 0);
+    while (lan9646_async_service(&g_async, BUDGET) && calls++ < 1000U) {
+    }
+    CHECK_EQ(lan9646_model_get(0x0400, 1), 0xEE);
+
+    /* Quiesce between the halves finishes the read too */
+    g_done_n = 0;
+    CHECK_EQ(lan9646_async_write_read(&g_async, LAN9646_ASYNC_NORMAL, 0x0410, cmd, sizeof(cmd),
+                                      0x0410, back, sizeof(back), prv_done, NULL), lan9646OK);
+    memset(back, 0, sizeof(back));
+    (void)lan9646_async_service(&g_async, (uint16_t)prv_phases(false, 4));
+    CHECK(g_on_bus);
+    CHECK_EQ(g_xfer.read, true);
+    lan9646_async_quiesce(&g_async);
+    CHECK(!g_on_bus);
+    CHECK_EQ(memcmp(back, cmd, sizeof(cmd)), 0);
+    (void)lan9646_async_service(&g_async, BUDGET);
+    CHECK_EQ(g_done_n, 1);
+
+    /* A failed write skips the read */
+    g_done_n = 0;
+    lan9646_model_clear_stats();
+    lan9646_model_fail_next(1);
+    CHECK_EQ(lan9646_async_write_read(&g_async, LAN9646_ASYNC_NORMAL, 0x0420, cmd, sizeof(cmd),
+                                      0x0420, back, sizeof(back), prv_done, NULL), lan9646OK);
+    while (lan9646_async_service(&g_async, BUDGET) && calls++ < 1000U) {
+    }
+    CHECK_EQ(g_done_res, lan9646BUSERR);
+    CHECK_EQ(lan9646_model_stats()->reads, 0);
+
+    CHECK_EQ(lan9646_async_write_read(&g_async, LAN9646_ASYNC_NORMAL, 0x0420, big, sizeof(big),
+                                      0x0420, back, sizeof(back), NULL, NULL), lan9646INVPARAM);
+    CHECK_EQ(lan9646_async_write_read(&g_async, LAN9646_ASYNC_NORMAL, 0x0420, cmd, sizeof(cmd),
+                                      0x0420, NULL, sizeof(back), NULL, NULL), lan9646INVPARAM);
+}
+
+int main(void) {
+    prv_test_pair();
+    prv_test_slices();
+
+    return test_done("test_lan9646_async");
+}
@@ -0,0 +1,224 @@
+/**
+ * \file            test_lan9646_batch.c
+ * \brief           LAN9646 batched writes: merging rules and init bus time, old vs batch
+ *
+ * Before: init_lan9646() issued the switch setup as eight single
+ * lan9646_write_reg8 / lan9646_write_reg32 calls, one I2C transaction each.
+ * After: the same writes as two const tables (port setup verified, then
+ * switch start) through lan9646_batch_write_table().
+ *
+ * Both run against the register model; the transactions and SCL periods
+ * each one puts on the bus are printed with the bus time at 100 kHz and
+ * the final register images must be identical.
+ */
+
+#include "lan9646.h"
+#include "lan9646_batch.h"
+#include "lan9646_model.h"
+#include "test_util.h"
+#include <stdio.h>
+#include <string.h>
+
+#define TABLE_LEN(t)                ((uint16_t)(sizeof(t) / sizeof((t)[0])))
+
+static lan9646_t g_dev;
+
+/* g_lan_port_cfg / g_lan_start in main.c */
+static const lan9646_batch_entry_t g_port_cfg[] = {
+    {LAN9646_REG_PORT_XMII_CTRL0(6), 1, 0x68},
+    {LAN9646_REG_PORT_XMII_CTRL1(6), 1, 0x18},
+    {LAN9646_REG_PORT_MEMBERSHIP(6), 4, 0x4F},
+    {LAN9646_REG_PORT_MEMBERSHIP(1), 4, 0x6E},
+    {LAN9646_REG_PORT_MEMBERSHIP(2), 4, 0x6D},
+    {LAN9646_REG_PORT_MEMBERSHIP(3), 4, 0x6B},
+    {LAN9646_REG_PORT_MEMBERSHIP(4), 4, 0x67},
+};
+
+static const lan9646_batch_entry_t g_start[] = {
+    {LAN9646_REG_SWITCH_OP, 1, 0x01},
+};
+
+/*===========================================================================*/
+/*                  BASELINE (init_lan9646() before the batch API)            */
+/*===========================================================================*/
+
+static void old_init(void) {
+    lan9646_write_reg8(&g_dev, 0x6300, 0x68);
+    lan9646_write_reg8(&g_dev, 0x6301, 0x18);
+    lan9646_write_reg8(&g_dev, 0x0300, 0x01);
+    lan9646_write_reg32(&g_dev, 0x6A04, 0x4F);
+    lan9646_write_reg32(&g_dev, 0x1A04, 0x6E);
+    lan9646_write_reg32(&g_dev, 0x2A04, 0x6D);
+    lan9646_write_reg32(&g_dev, 0x3A04, 0x6B);
+    lan9646_write_reg32(&g_dev, 0x4A04, 0x67);
+}
+
+static void new_init(void) {
+    CHECK_EQ(lan9646_batch_write_table(&g_dev, g_port_cfg, TABLE_LEN(g_port_cfg), true), lan9646OK);
+    CHECK_EQ(lan9646_batch_write_table(&g_dev, g_start, TABLE_LEN(g_start), false), lan9646OK);
+}
+
+/*===========================================================================*/
+/*                              TESTS                                         */
+/*===========================================================================*/
+
+static uint16_t g_order[16];
+static uint8_t g_order_n;
+static uint16_t g_corrupt_addr;
+
+static void prv_hook(uint16_t addr, uint16_t len, bool write) {
+    (void)len;
+    if (write && g_order_n < 16U) {
+        g_order[g_order_n++] = addr;
+    }
+    /* A register that does not keep what was written */
+    if (write && g_corrupt_addr >= addr && g_corrupt_addr < addr + len) {
+        lan9646_model_regs()[g_corrupt_addr] ^= 0x01U;
+    }
+}
+
+static void prv_setup(void) {
+    lan9646_model_reset();
+    CHECK_EQ(lan9646_model_attach(&g_dev), lan9646OK);
+    g_order_n = 0;
+    g_corrupt_addr = 0;
+    lan9646_model_set_hook(prv_hook);
+}
+
+static void prv_test_merge(void) {
+    lan9646_batch_t b;
+    uint16_t i;
+
+    /* Out of order and overlapping: sorted, last write wins, gaps kept */
+    prv_setup();
+    lan9646_batch_init(&b, &g_dev, true);
+    CHECK_EQ(lan9646_batch_add(&b, 0x1004, 4, 0x01020304U), lan9646OK);
+    CHECK_EQ(lan9646_batch_add(&b, 0x1000, 4, 0xA0A1A2A3U), lan9646OK);
+    CHECK_EQ(lan9646_batch_add(&b, 0x1002, 2, 0xBBCCU), lan9646OK);
+    CHECK_EQ(lan9646_batch_add(&b, 0x100A, 1, 0x55), lan9646OK);
+    CHECK_EQ(lan9646_batch_add(&b, 0x1000, 3, 0), lan9646INVPARAM);
+    CHECK_EQ(lan9646_batch_commit(&b), lan9646OK);
+    CHECK_EQ(b.stats.transactions, 2);
+    CHECK_EQ(b.stats.verify_reads, 2);
+    CHECK_EQ(g_order_n, 2);
+    CHECK_EQ(g_order[0], 0x1000);
+    CHECK_EQ(g_order[1], 0x100A);
+    CHECK_EQ(lan9646_model_get(0x1000, 4), 0xA0A1BBCCU);
+    CHECK_EQ(lan9646_model_get(0x1004, 4), 0x01020304U);
+    CHECK_EQ(lan9646_model_get(0x1008, 2), 0);
+    CHECK_EQ(lan9646_model_get(0x100A, 1), 0x55);
+    CHECK_EQ(lan9646_model_stats()->write_bytes, 9);
+    CHECK_EQ(b.count, 0);
+
+    /* A long run is split at the burst limit */
+    prv_setup();
+    lan9646_batch_init(&b, &g_dev, false);
+    for (i = 0; i < 12U; i++) {
+        CHECK_EQ(lan9646_batch_add(&b, (uint16_t)(0x2000U + 4U * i), 4, i), lan9646OK);
+    }
+    CHECK_EQ(lan9646_batch_commit(&b), lan9646OK);
+    CHECK_EQ(b.stats.transactions, (48U + LAN9646_BATCH_BURST_MAX - 1U) / LAN9646_BATCH_BURST_MAX);
+    CHECK_EQ(lan9646_model_get(0x202C, 4), 11);
+
+    /* Full batch refuses, tables longer than a batch are chunked */
+    lan9646_batch_init(&b, &g_dev, false);
+    for (i = 0; i < LAN9646_BATCH_MAX; i++) {
+        CHECK_EQ(lan9646_batch_add(&b, (uint16_t)(0x3000U + i), 1, 0), lan9646OK);
+    }
+    CHECK_EQ(lan9646_batch_add(&b, 0x3100, 1, 0), lan9646ERR);
+
+    {
+        static lan9646_batch_entry_t big[LAN9646_BATCH_MAX + 8U];
+
+        for (i = 0; i < TABLE_LEN(big); i++) {
+            big[i].addr = (uint16_t)(0x4000U + 0x10U * i);
+            big[i].width = 1;
+            big[i].value = (uint8_t)(i + 1U);
+        }
+        prv_setup();
+        CHECK_EQ(lan9646_batch_write_table(&g_dev, big, TABLE_LEN(big), true), lan9646OK);
+        CHECK_EQ(lan9646_model_stats()->writes, TABLE_LEN(big));
+        CHECK_EQ(lan9646_model_get((uint16_t)(0x4000U + 0x10U * (TABLE_LEN(big) - 1U)), 1),
+                 TABLE_LEN(big));
+    }
+}
+
+static void prv_test_verify(void) {
+    lan9646_batch_t b;
+
+    /* A byte that reads back differently fails the commit and is counted */
+    prv_setup();
+    g_corrupt_addr = LAN9646_REG_PORT_XMII_CTRL1(6);
+    lan9646_batch_init(&b, &g_dev, true);
+    CHECK_EQ(lan9646_batch_add_table(&b, g_port_cfg, TABLE_LEN(g_port_cfg)), lan9646OK);
+    CHECK_EQ(lan9646_batch_commit(&b), lan9646ERR);
+    CHECK_EQ(b.stats.verify_errors, 1);
+
+    /* Bus error stops the commit */
+    prv_setup();
+    lan9646_model_fail_next(1);
+    CHECK_EQ(lan9646_batch_write_table(&g_dev, g_port_cfg, TABLE_LEN(g_port_cfg), false),
+             lan9646BUSERR);
+    CHECK_EQ(lan9646_model_stats()->writes, 1);
+}
+
+static void prv_test_init(void) {
+    static uint8_t image[0x10000];
+    lan9646_model_stats_t s_old;
+    lan9646_model_stats_t s_new;
+    lan9646_model_stats_t s_nov;
+    uint32_t w;
+
+    prv_setup();
+    old_init();
+    s_old = *lan9646_model_stats();
+    memcpy(image, lan9646_model_regs(), sizeof(image));
+
+    prv_setup();
+    new_init();
+    s_new = *lan9646_model_stats();
+    CHECK(memcmp(image, lan9646_model_regs(), sizeof(image)) == 0);
+
+    /* Same tables without the read-back */
+    prv_setup();
+    CHECK_EQ(lan9646_batch_write_table(&g_dev, g_port_cfg, TABLE_LEN(g_port_cfg), false), lan9646OK);
+    CHECK_EQ(lan9646_batch_write_table(&g_dev, g_start, TABLE_LEN(g_start), false), lan9646OK);
+    s_nov = *lan9646_model_stats();
+    CHECK(memcmp(image, lan9646_model_regs(), sizeof(image)) == 0);
+
+    printf("Switch init, I2C at 100 kHz\n");
+    printf("%-24s | %6s | %5s | %6s | %7s\n", "", "writes", "reads", "SCL", "bus us");
+    printf("%-24s | %6lu | %5lu | %6lu | %7.0f\n", "old single writes",
+           (unsigned long)s_old.writes, (unsigned long)s_old.reads, (unsigned long)s_old.bits,
+           s_old.bits * 1e6 / LAN9646_MODEL_I2C_HZ);
+    printf("%-24s | %6lu | %5lu | %6lu | %7.0f\n", "batch",
+           (unsigned long)s_nov.writes, (unsigned long)s_nov.reads, (unsigned long)s_nov.bits,
+           s_nov.bits * 1e6 / LAN9646_MODEL_I2C_HZ);
+    printf("%-24s | %6lu | %5lu | %6lu | %7.0f\n", "batch + verify",
+           (unsigned long)s_new.writes, (unsigned long)s_new.reads, (unsigned long)s_new.bits,
+           s_new.bits * 1e6 / LAN9646_MODEL_I2C_HZ);
+
+    /* XMII_CTRL0/1 merge into one burst: one transaction less, 3 address bytes + STOP */
+    CHECK_EQ(s_old.writes, 8);
+    CHECK_EQ(s_old.reads, 0);
+    CHECK_EQ(s_nov.writes, 7);
+    CHECK_EQ(s_nov.bits, s_old.bits - (9U * 3U + 2U));
+    CHECK_EQ(s_new.writes, 7);
+    CHECK_EQ(s_new.reads, 6);
+    CHECK_EQ(s_new.write_bytes, s_old.write_bytes);
+
+    /* Verified readback against the old per-register one (a read per write) */
+    w = s_old.bits;
+    w += 9U * (4U + 1U) + 3U;                       /* The two 8-bit reads */
+    w += 9U * (4U + 1U) + 3U;
+    w += 5U * (9U * (4U + 4U) + 3U);                /* The five 32-bit reads */
+    CHECK(s_new.bits < w);
+}
+
+int main(void) {
+    prv_test_merge();
+    prv_test_verify();
+    prv_test_init();
+
+    return test_done("test_lan9646_batch");
+}
@@ -0,0 +1,303 @@
+/**
+ * \file            test_lan9646_config.c
+ * \brief           Declarative switch configuration: cold, warm and dry-run applies on the register model
+ *
+ * The hook keeps the queue scheduling registers (0xN914-0xN915) per queue
+ * behind the queue index (0xN900) and the VLAN table behind 0x040E, like
+ * the switch does. The description is main.c's g_lan_cfg with a second
+ * VID.
+ *
+ * A cold apply on a reset device writes what differs and nothing else; a
+ * warm apply finds nothing to do; a dry run reports injected drift and
+ * leaves it in place for the next apply to repair. A bad VID is refused
+ * before the bus is touched, and a dry run must not lose bytes still
+ * pending in a write-back shadow.
+ */
+
+#include "lan9646.h"
+#include "lan9646_config.h"
+#include "lan9646_qos.h"
+#include "lan9646_vlan.h"
+#include "lan9646_model.h"
+#include "test_util.h"
+#include <stdio.h>
+#include <string.h>
+
+#define SOURCES                     (LAN9646_QOS_SRC_PCP | LAN9646_QOS_SRC_DSCP | LAN9646_QOS_SRC_ACL)
+#define PHY_PORT_QOS(n)             {(n), SOURCES, 1, {0}, {{LAN9646_QOS_STRICT, 0}}}
+
+static lan9646_t g_dev;
+static lan9646_vlan_t g_vlan;
+static lan9646_shadow_t g_shadow;
+
+static uint8_t g_mti[8][LAN9646_QOS_QUEUES][2];     /* CTRL0, CTRL1 of each queue */
+static uint8_t g_table[LAN9646_VLAN_VIDS][12];
+
+/* g_lan_cfg in main.c, plus VID 100 on ports 1 and 6 */
+static const lan9646_qos_port_cfg_t g_qos[] = {
+    PHY_PORT_QOS(1), PHY_PORT_QOS(2), PHY_PORT_QOS(3), PHY_PORT_QOS(4),
+    {6, SOURCES, 4, {0, 0, 1, 1, 2, 2, 3, 3},
+     {{LAN9646_QOS_WRR, 1}, {LAN9646_QOS_WRR, 2}, {LAN9646_QOS_WRR, 4}, {LAN9646_QOS_STRICT, 0}}},
+};
+
+static const uint8_t g_dscp_prio[LAN9646_QOS_DSCPS] = {
+    0, 0, 0, 0, 0, 0, 0, 0,  1, 1, 1, 1, 1, 1, 1, 1,
+    2, 2, 2, 2, 2, 2, 2, 2,  3, 3, 3, 3, 3, 3, 3, 3,
+    4, 4, 4, 4, 4, 4, 4, 4,  5, 5, 5, 5, 5, 5, 6, 5,
+    6, 6, 6, 6, 6, 6, 6, 6,  7, 7, 7, 7, 7, 7, 7, 7,
+};
+
+static const lan9646_config_port_t g_ports[] = {
+    {6, LAN9646_CONFIG_XMII | LAN9646_CONFIG_MEMBERS, 0x68, 0x18, 0x4F, 0, &g_qos[4]},
+    {1, LAN9646_CONFIG_MEMBERS, 0, 0, 0x6E, 0, &g_qos[0]},
+    {2, LAN9646_CONFIG_MEMBERS, 0, 0, 0x6D, 0, &g_qos[1]},
+    {3, LAN9646_CONFIG_MEMBERS, 0, 0, 0x6B, 0, &g_qos[2]},
+    {4, LAN9646_CONFIG_MEMBERS, 0, 0, 0x67, 0, &g_qos[3]},
+};
+
+static lan9646_vlan_entry_t g_vids[] = {
+    {1, 0x6F, 0x6F, 0},
+    {100, 0x21, 0x01, 1},
+};
+
+static const lan9646_config_t g_cfg = {
+    .ports = g_ports,
+    .port_count = (uint8_t)(sizeof(g_ports) / sizeof(g_ports[0])),
+    .dscp_prio = g_dscp_prio,
+    .vlans = g_vids,
+    .vlan_count = (uint16_t)(sizeof(g_vids) / sizeof(g_vids[0])),
+    .vlan_enable = true,
+    .start = true,
+};
+
+/*===========================================================================*/
+/*                          QUEUE AND TABLE MODEL                             */
+/*===========================================================================*/
+
+static void prv_hook_mti(uint16_t addr, uint16_t len, bool write) {
+    uint8_t* regs = lan9646_model_regs();
+    uint8_t port = (uint8_t)(addr >> 12);
+    uint16_t ctrl0 = (uint16_t)((addr & 0xF000U) | 0x0914U);
+    uint8_t q;
+
+    if (port < 1U || port > 7U) return;
+    q = regs[(addr & 0xF000U) | 0x0903U] & 0x03U;
+
+    /* Selecting a queue brings its registers in */
+    if (write && (addr & 0x0FFFU) == 0x0900U && len == 4U) {
+        memcpy(&regs[ctrl0], g_mti[port][q], 2);
+    } else if (write && addr <= ctrl0 + 1U && addr + len > ctrl0) {
+        memcpy(g_mti[port][q], &regs[ctrl0], 2);
+    }
+}
+
+static void prv_hook_vlan(uint16_t addr, uint16_t len, bool write) {
+    uint8_t* regs = lan9646_model_regs();
+    uint16_t vid;
+    uint8_t ctrl;
+
+    if (addr > LAN9646_REG_VLAN_CTRL || addr + len <= LAN9646_REG_VLAN_CTRL) return;
+
+    ctrl = regs[LAN9646_REG_VLAN_CTRL];
+    if (write && (ctrl & LAN9646_VLAN_START)) {
+        vid = (uint16_t)(lan9646_model_get(LAN9646_REG_VLAN_INDEX, 2) & LAN9646_VLAN_VID_MASK);
+        switch (ctrl & 0x03U) {
+            case LAN9646_VLAN_ACTION_WRITE:
+                memcpy(g_table[vid], &regs[LAN9646_REG_VLAN_ENTRY], 12);
+                break;
+            case LAN9646_VLAN_ACTION_READ:
+                memcpy(&regs[LAN9646_REG_VLAN_ENTRY], g_table[vid], 12);
+                break;
+            case LAN9646_VLAN_ACTION_CLEAR:
+                memset(g_table, 0, sizeof(g_table));
+                break;
+            default:
+                break;
+        }
+    } else if (!write) {
+        regs[LAN9646_REG_VLAN_CTRL] &= (uint8_t)~LAN9646_VLAN_START;
+    }
+}
+
+static void prv_hook(uint16_t addr, uint16_t len, bool write) {
+    prv_hook_mti(addr, len, write);
+    prv_hook_vlan(addr, len, write);
+}
+
+static void prv_setup(void) {
+    lan9646_model_reset();
+    CHECK_EQ(lan9646_model_attach(&g_dev), lan9646OK);
+    lan9646_model_set_hook(prv_hook);
+    memset(g_mti, 0, sizeof(g_mti));
+    memset(g_table, 0, sizeof(g_table));
+    CHECK_EQ(lan9646_vlan_init(&g_vlan, &g_dev), lan9646OK);
+}
+
+static uint32_t prv_txn(void) {
+    return lan9646_model_stats()->reads + lan9646_model_stats()->writes;
+}
+
+/*===========================================================================*/
+/*                              TESTS                                         */
+/*===========================================================================*/
+
+static uint32_t g_chg[3];               /* Reported changes by kind */
+static uint16_t g_chg_vid;
+
+static void prv_change_cb(const lan9646_config_change_t* chg, void* arg) {
+    (void)arg;
+    g_chg[chg->kind]++;
+    if (chg->kind == LAN9646_CONFIG_CHG_VLAN) {
+        g_chg_vid = chg->addr;
+    }
+}
+
+static void prv_test_cold_warm(void) {
+    static uint8_t before[0x10000];
+    lan9646_config_report_t rep;
+    lan9646_vlan_entry_t e;
+    bool valid;
+
+    prv_setup();
+
+    /* Cold: everything that differs from reset goes out once */
+    memset(g_chg, 0, sizeof(g_chg));
+    CHECK_EQ(lan9646_config_apply(&g_dev, &g_vlan, &g_cfg, false, prv_change_cb, NULL, &rep),
+             lan9646OK);
+    printf("  cold: %u/%u bytes changed in %u reads + %u writes, %u/%u queues, %u/%u VIDs, %lu txn\n",
+           rep.changed, rep.checked, rep.reads, rep.writes, rep.queues_changed, rep.queues_checked,
+           rep.vlans_changed, rep.vlans_checked, (unsigned long)prv_txn());
+    CHECK_EQ(rep.changed, 46);
+    CHECK_EQ(rep.queues_checked, 8);
+    CHECK_EQ(rep.queues_changed, 3);           /* The WRR queues of port 6 */
+    CHECK_EQ(rep.vlans_checked, 2);
+    CHECK_EQ(rep.vlans_changed, 2);
+    CHECK_EQ(rep.verify_errors, 0);
+    CHECK_EQ(g_chg[LAN9646_CONFIG_CHG_REG], rep.changed);
+    CHECK_EQ(g_chg[LAN9646_CONFIG_CHG_VLAN], 2);
+
+    CHECK_EQ(lan9646_model_get(LAN9646_REG_PORT_XMII_CTRL0(6), 2), 0x6818);
+    CHECK_EQ(lan9646_model_get(LAN9646_REG_PORT_MEMBERSHIP(6), 4), 0x4F);
+    CHECK_EQ(lan9646_model_get(LAN9646_REG_PORT_MEMBERSHIP(3), 4), 0x6B);
+    CHECK_EQ(lan9646_model_get(LAN9646_REG_PORT_TC_MAP(6), 4), 0x33221100UL);
+    CHECK_EQ(g_mti[6][2][0], LAN9646_MTI_SCHED_WRR << LAN9646_MTI_SCHED_SHIFT);
+    CHECK_EQ(g_mti[6][2][1], 4);
+    CHECK_EQ(g_mti[6][3][0], 0);
+    CHECK_EQ(lan9646_model_get(LAN9646_REG_LUE_CTRL0, 1) & LAN9646_LUE_VLAN_EN, LAN9646_LUE_VLAN_EN);
+    CHECK_EQ(lan9646_model_get(LAN9646_REG_SWITCH_OP, 1) & LAN9646_SWITCH_START, LAN9646_SWITCH_START);
+    CHECK_EQ(lan9646_vlan_read(&g_dev, 100, &e, &valid), lan9646OK);
+    CHECK(valid);
+    CHECK_EQ(e.members, 0x21);
+    CHECK_EQ(e.untag, 0x01);
+    CHECK_EQ(e.fid, 1);
+
+    /* Warm: nothing differs, no direct register is written */
+    memset(g_chg, 0, sizeof(g_chg));
+    CHECK_EQ(lan9646_config_apply(&g_dev, &g_vlan, &g_cfg, false, prv_change_cb, NULL, &rep),
+             lan9646OK);
+    CHECK_EQ(rep.changed, 0);
+    CHECK_EQ(rep.writes, 0);
+    CHECK_EQ(rep.queues_changed, 0);
+    CHECK_EQ(rep.vlans_changed, 0);
+    CHECK_EQ(g_chg[0] + g_chg[1] + g_chg[2], 0);
+
+    /* A second warm apply leaves the device byte for byte as it was */
+    memcpy(before, lan9646_model_regs(), sizeof(before));
+    CHECK_EQ(lan9646_config_apply(&g_dev, &g_vlan, &g_cfg, false, NULL, NULL, &rep), lan9646OK);
+    CHECK(memcmp(before, lan9646_model_regs(), sizeof(before)) == 0);
+}
+
+static void prv_test_dry_run(void) {
+    lan9646_config_report_t rep;
+    lan9646_vlan_entry_t e;
+    uint32_t writes;
+    bool valid;
+
+    prv_setup();
+    CHECK_EQ(lan9646_config_apply(&g_dev, &g_vlan, &g_cfg, false, NULL, NULL, &rep), lan9646OK);
+
+    /* Drift: a membership byte, a WRR weight, a lost VID */
+    lan9646_model_set(LAN9646_REG_PORT_MEMBERSHIP(2), 4, 0x7F);
+    g_mti[6][1][1] = 9;
+    memset(g_table[100], 0, sizeof(g_table[100]));
+
+    /* Reported, not repaired; only the queue index is selected */
+    memset(g_chg, 0, sizeof(g_chg));
+    g_chg_vid = 0;
+    writes = lan9646_model_stats()->writes;
+    CHECK_EQ(lan9646_config_apply(&g_dev, &g_vlan, &g_cfg, true, prv_change_cb, NULL, &rep),
+             lan9646OK);
+    CHECK_EQ(rep.changed, 1);
+    CHECK_EQ(rep.writes, 0);
+    CHECK_EQ(rep.queues_changed, 1);
+    CHECK_EQ(rep.vlans_changed, 1);
+    CHECK_EQ(g_chg[LAN9646_CONFIG_CHG_REG], 1);
+    CHECK_EQ(g_chg[LAN9646_CONFIG_CHG_QUEUE], 1);
+    CHECK_EQ(g_chg_vid, 100);
+    CHECK_EQ(lan9646_model_get(LAN9646_REG_PORT_MEMBERSHIP(2), 4), 0x7F);
+    CHECK_EQ(g_mti[6][1][1], 9);
+    CHECK_EQ(g_table[100][0], 0);
+    /* 8 queue selects and 2 VLAN read commands */
+    CHECK_EQ(lan9646_model_stats()->writes - writes, 8 + 2);
+
+    /* The next apply repairs exactly that */
+    CHECK_EQ(lan9646_config_apply(&g_dev, &g_vlan, &g_cfg, false, NULL, NULL, &rep), lan9646OK);
+    CHECK_EQ(rep.changed, 1);
+    CHECK_EQ(rep.queues_changed, 1);
+    CHECK_EQ(rep.vlans_changed, 1);
+    CHECK_EQ(lan9646_model_get(LAN9646_REG_PORT_MEMBERSHIP(2), 4), 0x6D);
+    CHECK_EQ(g_mti[6][1][1], 2);
+    CHECK_EQ(lan9646_vlan_read(&g_dev, 100, &e, &valid), lan9646OK);
+    CHECK(valid);
+    CHECK_EQ(e.members, 0x21);
+}
+
+static void prv_test_bad_vid(void) {
+    static const uint16_t bad[] = {0, LAN9646_VLAN_VID_MAX + 1U};
+    lan9646_config_report_t rep;
+    uint8_t i;
+
+    for (i = 0; i < 2U; i++) {
+        prv_setup();
+        g_vids[1].vid = bad[i];
+        CHECK_EQ(lan9646_config_apply(&g_dev, &g_vlan, &g_cfg, false, NULL, NULL, &rep),
+                 lan9646INVPARAM);
+        CHECK_EQ(prv_txn(), 0);
+        CHECK_EQ(g_dev.is_init, 1);
+    }
+    g_vids[1].vid = 100;
+}
+
+static void prv_test_shadow_dirty(void) {
+    static const lan9646_reg_range_t ranges[] = {
+        {LAN9646_REG_PORT_PRIO_CTRL(1), 1, LAN9646_REG_CACHEABLE},
+    };
+    lan9646_config_report_t rep;
+    uint8_t v8;
+
+    prv_setup();
+    CHECK_EQ(lan9646_shadow_attach(&g_dev, &g_shadow, ranges, 1), lan9646OK);
+    CHECK_EQ(lan9646_shadow_set_write_back(&g_dev, true), lan9646OK);
+
+    /* Bit 5 is not owned by the description: a pending write of it must
+     * reach the device even though the dry run re-reads the byte */
+    CHECK_EQ(lan9646_write_reg8(&g_dev, LAN9646_REG_PORT_PRIO_CTRL(1), 0x20), lan9646OK);
+    CHECK_EQ(lan9646_model_get(LAN9646_REG_PORT_PRIO_CTRL(1), 1), 0);
+
+    CHECK_EQ(lan9646_config_apply(&g_dev, &g_vlan, &g_cfg, true, NULL, NULL, &rep), lan9646OK);
+    CHECK_EQ(lan9646_model_get(LAN9646_REG_PORT_PRIO_CTRL(1), 1), 0x20);
+
+    CHECK_EQ(lan9646_config_apply(&g_dev, &g_vlan, &g_cfg, false, NULL, NULL, &rep), lan9646OK);
+    CHECK_EQ(lan9646_read_reg8(&g_dev, LAN9646_REG_PORT_PRIO_CTRL(1), &v8), lan9646OK);
+    CHECK_EQ(v8, 0x20 | LAN9646_PORT_PRIO_HIGHEST | SOURCES);
+    CHECK_EQ(lan9646_shadow_set_write_back(&g_dev, false), lan9646OK);
+    CHECK_EQ(lan9646_model_get(LAN9646_REG_PORT_PRIO_CTRL(1), 1), 0x20 | LAN9646_PORT_PRIO_HIGHEST | SOURCES);
+}
+
+int main(void) {
+    prv_test_cold_warm();
+    prv_test_dry_run();
+    prv_test_bad_vid();
+    prv_test_shadow_dirty();
+    return test_done("test_lan9646_config");
+}
@@ -0,0 +1,231 @@
+/**
+ * \file            test_lan9646_link.c
+ * \brief           Link monitoring: steady-state bus traffic of polling vs interrupts
+ *
+ * The register model carries the interrupt chain of ports 1-4: PHY
+ * interrupt status (0xN136, cleared on read) -> port interrupt status
+ * (0xN01B) -> global port interrupt status (0x0018), with INTRP_N low
+ * while an unmasked port bit is set, and the latch-low link bit of the
+ * PHY basic status (0xN102).
+ *
+ * One minute of the superloop (1 ms per pass) with four links up is run
+ * three ways: lan9646_switch_poll_link() from the 100 ms job, job_link in
+ * main.c without the interrupt line (summary read every 100 ms) and with
+ * INTRP_N on a Dio input. A link that drops and bounces must give one
+ * down and one up callback in every mode, debounced in the interrupt modes.
+ */
+
+#include "lan9646.h"
+#include "lan9646_switch.h"
+#include "lan9646_model.h"
+#include "test_util.h"
+#include <stdio.h>
+
+#define LINK_CHECK_MS               100U    /* main.c */
+#define RUN_MS                      60000U
+
+typedef enum {
+    MODE_POLL = 0,
+    MODE_SUMMARY,
+    MODE_INTRP_N,
+} mode_t;
+
+static lan9646_t g_dev;
+static bool g_link[5];
+static bool g_latched_low[5];
+static uint16_t g_phy_int_clear;        /* 0xN136 read: clear its status on the next access */
+
+static uint32_t g_cb_count;
+static uint8_t g_cb_port;
+static bool g_cb_up;
+
+/*===========================================================================*/
+/*                          INTERRUPT CHAIN MODEL                             */
+/*===========================================================================*/
+
+static void prv_set_status(uint8_t port) {
+    lan9646_model_set(LAN9646_REG_PORT_STATUS(port), 1, g_link[port] ? 0x14 : 0x00);
+}
+
+static void prv_hook(uint16_t addr, uint16_t len, bool write) {
+    uint8_t* regs = lan9646_model_regs();
+    uint8_t port = (uint8_t)(addr >> 12);
+
+    (void)len;
+    if (g_phy_int_clear != 0U) {
+        regs[g_phy_int_clear + 1U] = 0;
+        g_phy_int_clear = 0;
+    }
+    if (write || port < 1U || port > 4U) return;
+
+    /* Latch-low: the first read after a drop shows it, then the current state */
+    if ((addr & 0x0FFFU) == 0x0102U) {
+        bool up = g_link[port] && !g_latched_low[port];
+
+        regs[addr + 1U] = (uint8_t)((regs[addr + 1U] & ~LAN9646_PHY_LINK_STATUS)
+                                    | (up ? LAN9646_PHY_LINK_STATUS : 0U));
+        g_latched_low[port] = false;
+    }
+    /* Reading the PHY interrupt status clears the whole chain */
+    if ((addr & 0x0FFFU) == 0x0136U) {
+        g_phy_int_clear = addr;
+        regs[LAN9646_REG_PORT_INT_STATUS(port)] &= (uint8_t)~LAN9646_PORT_INT_PHY;
+        regs[LAN9646_REG_GPORT_INT_STAT + 3U] &= (uint8_t)~(1U << (port - 1U));
+    }
+}
+
+static void prv_link_event(uint8_t port, bool up) {
+    uint8_t* regs = lan9646_model_regs();
+    uint16_t en = (uint16_t)lan9646_model_get(LAN9646_REG_PORT_PHY_INT_CTRL(port), 2);
+
+    g_link[port] = up;
+    if (!up) {
+        g_latched_low[port] = true;
+    }
+    prv_set_status(port);
+    if ((up && (en & LAN9646_PHY_INT_LINK_UP_EN)) || (!up && (en & LAN9646_PHY_INT_LINK_DOWN_EN))) {
+        regs[LAN9646_REG_PORT_PHY_INT_CTRL(port) + 1U] |= up ? LAN9646_PHY_INT_LINK_UP
+                                                             : LAN9646_PHY_INT_LINK_DOWN;
+        if ((regs[LAN9646_REG_PORT_INT_MASK(port)] & LAN9646_PORT_INT_PHY) == 0) {
+            regs[LAN9646_REG_PORT_INT_STATUS(port)] |= LAN9646_PORT_INT_PHY;
+            regs[LAN9646_REG_GPORT_INT_STAT + 3U] |= (uint8_t)(1U << (port - 1U));
+        }
+    }
+}
+
+/* INTRP_N as a Dio read would see it: low while an unmasked port interrupt is set */
+static bool prv_intrp_n_low(void) {
+    uint32_t st = lan9646_model_get(LAN9646_REG_GPORT_INT_STAT, 4);
+    uint32_t mask = lan9646_model_get(LAN9646_REG_GPORT_INT_MASK, 4);
+
+    return (st & ~mask & 0x7FU) != 0U;
+}
+
+/*===========================================================================*/
+/*                              TESTS                                         */
+/*===========================================================================*/
+
+static void prv_link_cb(uint8_t port, bool link_up, lan9646_speed_t speed,
+                        lan9646_duplex_t duplex) {
+    (void)speed;
+    (void)duplex;
+    g_cb_count++;
+    g_cb_port = port;
+    g_cb_up = link_up;
+}
+
+static void prv_setup(mode_t mode) {
+    uint8_t port;
+
+    lan9646_model_reset();
+    CHECK_EQ(lan9646_model_attach(&g_dev), lan9646OK);
+    lan9646_model_set_hook(prv_hook);
+    lan9646_model_set(LAN9646_REG_GPORT_INT_MASK, 4, 0x7F);
+    for (port = 1; port <= 4U; port++) {
+        g_link[port] = true;
+        g_latched_low[port] = false;
+        lan9646_model_set(LAN9646_REG_PORT_INT_MASK(port), 1, 0xFF);
+        prv_set_status(port);
+    }
+    lan9646_model_set(LAN9646_REG_PORT_STATUS(6), 1, 0x14);
+    g_phy_int_clear = 0;
+
+    /* Reference state: the first poll reports every port */
+    lan9646_switch_set_link_callback(&g_dev, prv_link_cb);
+    if (mode == MODE_POLL) {
+        lan9646_switch_poll_link(&g_dev);
+    } else {
+        CHECK_EQ(lan9646_switch_link_irq_init(&g_dev, LAN9646_PORT_MASK_PHY), lan9646OK);
+    }
+    g_cb_count = 0;
+    lan9646_model_clear_stats();
+}
+
+/* One superloop pass at now_ms: the 100 ms job, then the service */
+static void prv_pass(mode_t mode, uint32_t now_ms) {
+    if (now_ms % LINK_CHECK_MS == 0U) {
+        if (mode == MODE_POLL) {
+            lan9646_switch_poll_link(&g_dev);
+        } else if (mode == MODE_SUMMARY || prv_intrp_n_low()) {
+            lan9646_switch_link_notify();
+        }
+    }
+    if (mode != MODE_POLL) {
+        lan9646_switch_link_service(&g_dev, now_ms);
+    }
+}
+
+static void prv_run(mode_t mode, uint32_t* txn, double* bus_ms) {
+    uint32_t t;
+
+    prv_setup(mode);
+    for (t = 1; t <= RUN_MS; t++) {
+        prv_pass(mode, t);
+    }
+    *txn = lan9646_model_stats()->reads + lan9646_model_stats()->writes;
+    *bus_ms = (double)lan9646_model_bus_ns(LAN9646_MODEL_I2C_HZ) / 1e6;
+    CHECK_EQ(g_cb_count, 0);
+}
+
+static void prv_test_flap(mode_t mode) {
+    uint32_t t;
+    uint32_t down_cb_at = 0;
+
+    prv_setup(mode);
+    for (t = 1; t <= 2000U; t++) {
+        /* Port 2 drops at 500 ms and bounces twice within 30 ms */
+        if (t == 500U || t == 515U) prv_link_event(2, false);
+        if (t == 510U) prv_link_event(2, true);
+        prv_pass(mode, t);
+        if (g_cb_count == 1U && down_cb_at == 0U) {
+            down_cb_at = t;
+        }
+        /* And comes back for good at 1200 ms */
+        if (t == 1200U) prv_link_event(2, true);
+    }
+
+    CHECK_EQ(g_cb_count, 2);
+    CHECK_EQ(g_cb_port, 2);
+    CHECK(g_cb_up);
+    /* Seen at the 500 ms check, reported once the window has passed */
+    if (mode == MODE_POLL) {
+        CHECK_EQ(down_cb_at, 500);
+    } else {
+        CHECK_EQ(down_cb_at, 500U + LAN9646_LINK_DEBOUNCE_MS);
+    }
+    CHECK(!prv_intrp_n_low());
+}
+
+static void prv_test_steady(void) {
+    static const char* const names[] = {
+        "poll_link every 100 ms", "summary every 100 ms", "INTRP_N on a Dio pin",
+    };
+    uint32_t txn[3];
+    double ms[3];
+    uint32_t i;
+
+    printf("Link monitoring, 4 links up, no change for %u s, I2C at 100 kHz\n", RUN_MS / 1000U);
+    printf("%-24s | %7s | %11s | %6s\n", "", "txn/s", "bus ms/s", "busy %");
+    for (i = 0; i < 3U; i++) {
+        prv_run((mode_t)i, &txn[i], &ms[i]);
+        printf("%-24s | %7.1f | %11.2f | %6.2f\n", names[i], txn[i] * 1000.0 / RUN_MS,
+               ms[i] * 1000.0 / RUN_MS, ms[i] * 100.0 / RUN_MS);
+    }
+
+    /* Polling: port status + PHY status twice on ports 1-4, status on 6 and 7 */
+    CHECK_EQ(txn[MODE_POLL], (RUN_MS / LINK_CHECK_MS) * (4U * 3U + 2U));
+    /* Summary only: one 32-bit read per check, 0.75 ms */
+    CHECK_EQ(txn[MODE_SUMMARY], RUN_MS / LINK_CHECK_MS);
+    CHECK_EQ((uint32_t)(ms[MODE_SUMMARY] * 1000.0 / RUN_MS * 100.0 + 0.5), 750);
+    /* Line wired: nothing at all */
+    CHECK_EQ(txn[MODE_INTRP_N], 0);
+}
+
+int main(void) {
+    prv_test_steady();
+    prv_test_flap(MODE_POLL);
+    prv_test_flap(MODE_SUMMARY);
+    prv_test_flap(MODE_INTRP_N);
+
+    return test_done("test_lan9646_link");
+}
@@ -0,0 +1,233 @@
+/**
+ * \file            test_lan9646_mib.c
+ * \brief           MIB snapshot engine: 30/36-bit wrap, rates and bus transactions per snapshot
+ *
+ * The register model latches counters like the switch does, 30 bits wide
+ * with 36 bits for the byte counters and an overflow flag. Built twice:
+ * with read-clear counters (default) and free-running (LAN9646_MIB_READ_CLEAR=0).
+ *
+ * Before: prv_read_mib_counter() in the original lan9646_switch.c wrote the
+ * index, polled the control register with 32-bit reads and read the data
+ * register, three transactions per counter at best, 32 bits only.
+ * After: lan9646_mib_read() writes the index and fetches control + data
+ * in one 8-byte burst.
+ */
+
+#include "lan9646.h"
+#include "lan9646_mib.h"
+#include "lan9646_model.h"
+#include "test_util.h"
+#include <stdio.h>
+
+#define PORT_MASK                   0xDEU       /* Ports 1-4, 6, 7 */
+#define RANGE30                     (1ULL << 30)
+#define RANGE36                     (1ULL << 36)
+
+static lan9646_t g_dev;
+static lan9646_mib_engine_t g_eng;
+
+/* Hook state */
+static uint32_t g_busy_reads;           /* Control reads that still show READ_EN */
+static uint32_t g_freeze_on;            /* Latches seen while the freeze is set */
+static uint32_t g_freeze_off;           /* ... and while it is not */
+
+/*===========================================================================*/
+/*          BASELINE (prv_read_mib_counter() in the original lan9646_switch.c) */
+/*===========================================================================*/
+
+static uint32_t old_read_mib_counter(lan9646_t* h, uint8_t port, uint8_t index) {
+    uint16_t base = (uint16_t)port << 12;
+    uint32_t ctrl;
+    uint32_t data = 0;
+    uint32_t timeout = 1000;
+
+    ctrl = ((uint32_t)index << 16) | LAN9646_MIB_READ_EN;
+    lan9646_write_reg32(h, base | 0x0500, ctrl);
+
+    do {
+        lan9646_read_reg32(h, base | 0x0500, &ctrl);
+        if (--timeout == 0) break;
+    } while (ctrl & LAN9646_MIB_READ_EN);
+
+    lan9646_read_reg32(h, base | 0x0504, &data);
+    return data;
+}
+
+/*===========================================================================*/
+/*                              TESTS                                         */
+/*===========================================================================*/
+
+static void prv_hook(uint16_t addr, uint16_t len, bool write) {
+    uint8_t* regs = lan9646_model_regs();
+
+    if (write && (addr & 0x0FFFU) == 0x0500U && len == 4U) {
+        if (regs[LAN9646_REG_SWITCH_MIB_CTRL] & LAN9646_SW_MIB_FREEZE) {
+            g_freeze_on++;
+        } else {
+            g_freeze_off++;
+        }
+    }
+    /* A latch that takes longer than one transaction: READ_EN still set */
+    if (!write && (addr & 0x0FFFU) == 0x0500U && g_busy_reads > 0U) {
+        g_busy_reads--;
+        regs[addr] |= (uint8_t)(LAN9646_MIB_READ_EN >> 24);
+    } else if (!write && (addr & 0x0FFFU) == 0x0500U) {
+        regs[addr] &= (uint8_t)~(LAN9646_MIB_READ_EN >> 24);
+    }
+}
+
+static void prv_setup(void) {
+    lan9646_model_reset();
+    CHECK_EQ(lan9646_model_attach(&g_dev), lan9646OK);
+#if !LAN9646_MIB_READ_CLEAR
+    lan9646_model_set_mib_read_clear(false);
+#endif
+    lan9646_model_set_hook(prv_hook);
+    CHECK_EQ(lan9646_mib_init(&g_eng, &g_dev, PORT_MASK, true), lan9646OK);
+    g_busy_reads = 0;
+    g_freeze_on = 0;
+    g_freeze_off = 0;
+    lan9646_model_clear_stats();
+}
+
+/* Count traffic on the model; in read-clear mode it is what the next latch returns */
+static void prv_count(uint8_t port, uint8_t index, uint64_t n) {
+    lan9646_model_set_mib(port, index, lan9646_model_get_mib(port, index) + n);
+}
+
+static void prv_test_wrap(void) {
+    lan9646_mib_rate_t r;
+    uint64_t expect_rx = 0;
+    uint64_t expect_bytes = 0;
+    uint64_t step;
+    uint32_t i;
+
+    prv_setup();
+
+    /* First snapshot primes, no rates yet */
+    prv_count(6, LAN9646_MIB_RX_UNICAST, 100);
+    prv_count(6, LAN9646_MIB_RX_BYTE_CNT, RANGE36 - 64U);
+    expect_rx += 100;
+    expect_bytes += RANGE36 - 64U;
+    CHECK_EQ(lan9646_mib_snapshot(&g_eng, 1000), lan9646OK);
+    CHECK_EQ(lan9646_mib_get(&g_eng, 6, LAN9646_MIB_RX_UNICAST), expect_rx);
+    CHECK_EQ(lan9646_mib_get(&g_eng, 6, LAN9646_MIB_RX_BYTE_CNT), expect_bytes);
+    CHECK(!lan9646_mib_get_rate(&g_eng, 6, &r));
+
+    /*
+     * Both widths wrap once between snapshots. Read-clear: the 30-bit
+     * counter went past its range since the last read (overflow flag), and
+     * so did the byte counter. Free-running: the hardware values roll over,
+     * a step must stay below the range to be told apart.
+     */
+#if LAN9646_MIB_READ_CLEAR
+    step = RANGE30 + 50U;
+    prv_count(6, LAN9646_MIB_RX_BYTE_CNT, RANGE36);
+    expect_bytes += RANGE36;
+#else
+    step = RANGE30 - 50U;
+#endif
+    prv_count(6, LAN9646_MIB_RX_UNICAST, step);
+    prv_count(6, LAN9646_MIB_RX_BYTE_CNT, 64U + 1000U);
+    expect_rx += step;
+    expect_bytes += 64U + 1000U;
+    CHECK_EQ(lan9646_mib_snapshot(&g_eng, 2000), lan9646OK);
+    CHECK_EQ(lan9646_mib_get(&g_eng, 6, LAN9646_MIB_RX_UNICAST), expect_rx);
+    CHECK_EQ(lan9646_mib_get(&g_eng, 6, LAN9646_MIB_RX_BYTE_CNT), expect_bytes);
+    CHECK(expect_rx > RANGE30);
+    CHECK(expect_bytes > RANGE36);
+    CHECK(lan9646_mib_get_rate(&g_eng, 6, &r));
+    CHECK_EQ(r.rx_pps, (uint32_t)step);
+#if LAN9646_MIB_READ_CLEAR
+    CHECK_EQ(r.rx_bps, 0xFFFFFFFFUL);                   /* Saturates */
+    CHECK_EQ(g_eng.port[5].overflows, 2);
+#else
+    CHECK_EQ(r.rx_bps, (64U + 1000U) * 8U);
+#endif
+
+    /* Many small steps across several 30-bit wraps stay exact */
+    for (i = 0; i < 40U; i++) {
+        prv_count(3, LAN9646_MIB_TX_UNICAST, RANGE30 / 7U);
+        prv_count(3, LAN9646_MIB_TX_BYTE_CNT, RANGE36 / 9U);
+        CHECK_EQ(lan9646_mib_snapshot(&g_eng, 3000U + 100U * i), lan9646OK);
+    }
+    CHECK_EQ(lan9646_mib_get(&g_eng, 3, LAN9646_MIB_TX_UNICAST), 40U * (RANGE30 / 7U));
+    CHECK_EQ(lan9646_mib_get(&g_eng, 3, LAN9646_MIB_TX_BYTE_CNT), 40U * (RANGE36 / 9U));
+    CHECK(lan9646_mib_get_rate(&g_eng, 3, &r));
+    CHECK_EQ(r.tx_pps, (uint32_t)(RANGE30 / 7U * 10U));
+    CHECK_EQ(lan9646_mib_get(&g_eng, 3, 0x40), 0);      /* No such index */
+    CHECK_EQ(g_eng.stats.errors, 0);
+}
+
+static void prv_test_transactions(void) {
+    lan9646_mib_stats_t st;
+    uint64_t v;
+    uint32_t n_old;
+    uint32_t n_new;
+    uint8_t port;
+    uint8_t i;
+    const uint32_t counters = 6U * LAN9646_MIB_COUNTERS;
+
+    /* One full snapshot: two per counter plus freeze and release */
+    prv_setup();
+    CHECK_EQ(lan9646_mib_snapshot(&g_eng, 0), lan9646OK);
+    lan9646_mib_get_stats(&g_eng, &st);
+    CHECK_EQ(st.counters, counters);
+    CHECK_EQ(st.transactions, 2U * counters + 2U);
+    CHECK_EQ(lan9646_model_stats()->reads + lan9646_model_stats()->writes, st.transactions);
+    CHECK_EQ(lan9646_model_stats()->mib_latches, counters);
+    CHECK_EQ(g_freeze_on, counters);
+    CHECK_EQ(g_freeze_off, 0);
+    CHECK_EQ(lan9646_model_get(LAN9646_REG_SWITCH_MIB_CTRL, 1), 0);
+    n_new = st.transactions;
+
+    printf("Full MIB snapshot, 6 ports x %u counters, I2C at 100 kHz\n", LAN9646_MIB_COUNTERS);
+    printf("%-24s | %5s | %7s | %7s\n", "", "txn", "txn/cnt", "bus ms");
+    printf("%-24s | %5lu | %7.2f | %7.1f\n", "lan9646_mib_snapshot", (unsigned long)n_new,
+           (double)n_new / counters, (double)lan9646_model_bus_ns(LAN9646_MODEL_I2C_HZ) / 1e6);
+
+    /* The same counters the old way (no freeze, 32 bits only) */
+    prv_setup();
+    for (port = 1; port <= 7U; port++) {
+        if ((PORT_MASK & (1U << port)) == 0) continue;
+        for (i = 0; i < LAN9646_MIB_COUNTERS; i++) {
+            (void)old_read_mib_counter(&g_dev, port, (uint8_t)(i < 0x20U ? i : i + 0x60U));
+        }
+    }
+    n_old = lan9646_model_stats()->reads + lan9646_model_stats()->writes;
+    printf("%-24s | %5lu | %7.2f | %7.1f\n", "old prv_read_mib_counter", (unsigned long)n_old,
+           (double)n_old / counters, (double)lan9646_model_bus_ns(LAN9646_MODEL_I2C_HZ) / 1e6);
+    CHECK_EQ(n_old, 3U * counters);
+    CHECK(n_new < n_old);
+
+    /* A slow latch costs one extra burst per busy read, up to the limit */
+    prv_setup();
+    lan9646_model_set_mib(2, LAN9646_MIB_RX_BROADCAST, 9);
+    g_busy_reads = 2;
+    CHECK_EQ(lan9646_mib_read(&g_dev, 2, LAN9646_MIB_RX_BROADCAST, &v), lan9646OK);
+    CHECK_EQ(v, 9);
+    CHECK_EQ(lan9646_model_stats()->reads, 3);
+    g_busy_reads = LAN9646_MIB_POLL_MAX + 1U;
+    CHECK_EQ(lan9646_mib_read(&g_dev, 2, LAN9646_MIB_RX_BROADCAST, &v), lan9646TIMEOUT);
+
+    /* A failed counter is skipped, the rest of the pass still counts */
+    prv_setup();
+    prv_count(7, LAN9646_MIB_TX_UNICAST, 5);
+    g_busy_reads = LAN9646_MIB_POLL_MAX + 1U;           /* First counter of port 1 */
+    CHECK_EQ(lan9646_mib_snapshot(&g_eng, 0), lan9646TIMEOUT);
+    CHECK_EQ(g_eng.stats.errors, 1);
+    CHECK_EQ(g_eng.stats.counters, counters - 1U);
+    CHECK_EQ(lan9646_mib_get(&g_eng, 7, LAN9646_MIB_TX_UNICAST), 5);
+    CHECK_EQ(lan9646_model_get(LAN9646_REG_SWITCH_MIB_CTRL, 1), 0);
+}
+
+int main(void) {
+    prv_test_wrap();
+    prv_test_transactions();
+
+#if LAN9646_MIB_READ_CLEAR
+    return test_done("test_lan9646_mib");
+#else
+    return test_done("test_lan9646_mib_free_running");
+#endif
+}
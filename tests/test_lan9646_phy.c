@@ -0,0 +1,263 @@
+/**
+ * \file            test_lan9646_phy.c
+ * \brief           LAN9646 PHY MDIO route: address translation, attach check, routing
+ *
+ * The switch registers are the I2C register model; the PHYs of ports 1-4
+ * are a mocked MDIO bus of 32 Clause 22 register files. A port's PHY
+ * window 0xN100-0xN13F maps to PHY address phy_addr + N - 1, register
+ * (addr & 0x3F) / 2. lan9646_set_phy_bus() must only attach when every
+ * PHY answers on MDIO with the ID the switch window shows over I2C.
+ */
+
+#include "lan9646.h"
+#include "lan9646_model.h"
+#include "test_util.h"
+#include <stdio.h>
+#include <string.h>
+
+#define PHY_BASE                    1U      /* main.c: LAN9646_MDIO_PHY_BASE */
+#define PHY_ID1                     0x0022U
+#define PHY_ID2                     0x1622U
+
+/*===========================================================================*/
+/*                          MOCKED MDIO BUS                                   */
+/*===========================================================================*/
+
+static uint16_t g_mdio[32][32];
+static bool g_present[32];      /* No PHY: the bus floats high */
+static uint32_t g_mdio_reads, g_mdio_writes;
+static uint8_t g_last_phy, g_last_reg;
+static bool g_mdio_timeout;
+
+static lan9646r_t prv_mdio_init(void) {
+    return lan9646OK;
+}
+
+static lan9646r_t prv_mdio_read(uint8_t phy_addr, uint8_t reg_addr, uint16_t* data) {
+    CHECK(phy_addr < 32U && reg_addr < 32U);
+    if (g_mdio_timeout) return lan9646TIMEOUT;
+    g_mdio_reads++;
+    g_last_phy = phy_addr;
+    g_last_reg = reg_addr;
+    *data = g_present[phy_addr & 0x1FU] ? g_mdio[phy_addr & 0x1FU][reg_addr & 0x1FU] : 0xFFFFU;
+    return lan9646OK;
+}
+
+static lan9646r_t prv_mdio_write(uint8_t phy_addr, uint8_t reg_addr, uint16_t data) {
+    CHECK(phy_addr < 32U && reg_addr < 32U);
+    if (g_mdio_timeout) return lan9646TIMEOUT;
+    g_mdio_writes++;
+    g_last_phy = phy_addr;
+    g_last_reg = reg_addr;
+    if (g_present[phy_addr & 0x1FU]) {
+        g_mdio[phy_addr & 0x1FU][reg_addr & 0x1FU] = data;
+    }
+    return lan9646OK;
+}
+
+static const lan9646_miim_t g_bus = {
+    .init_fn = prv_mdio_init,
+    .write_fn = prv_mdio_write,
+    .read_fn = prv_mdio_read,
+};
+
+static lan9646_t g_dev;
+
+/**
+ * \brief           Fresh model and PHYs 1-4 with the same ID on both paths
+ */
+static void prv_setup(void) {
+    uint8_t port;
+
+    lan9646_model_reset();
+    CHECK_EQ(lan9646_model_attach(&g_dev), lan9646OK);
+    g_dev.cfg.phy_addr = PHY_BASE;
+    memset(g_mdio, 0, sizeof(g_mdio));
+    memset(g_present, 0, sizeof(g_present));
+    for (port = 1; port <= 4U; port++) {
+        lan9646_model_set(LAN9646_REG_PORT_PHY_ID_H(port), 2, PHY_ID1);
+        lan9646_model_set(LAN9646_REG_PORT_PHY_ID_L(port), 2, PHY_ID2);
+        g_present[PHY_BASE + port - 1U] = true;
+        g_mdio[PHY_BASE + port - 1U][2] = PHY_ID1;
+        g_mdio[PHY_BASE + port - 1U][3] = PHY_ID2;
+    }
+    g_mdio_reads = 0;
+    g_mdio_writes = 0;
+    g_mdio_timeout = false;
+    lan9646_model_clear_stats();
+}
+
+static uint32_t prv_txn(void) {
+    return lan9646_model_stats()->reads + lan9646_model_stats()->writes;
+}
+
+/*===========================================================================*/
+/*                              TESTS                                         */
+/*===========================================================================*/
+
+static void prv_test_xlate(void) {
+    static const struct {
+        uint16_t addr;
+        uint8_t base;
+        bool ok;
+        uint8_t phy;
+        uint8_t reg;
+    } cases[] = {
+        {0x1100, 1, true, 1, 0},        /* Basic control of port 1 */
+        {0x1102, 1, true, 1, 1},
+        {0x1104, 1, true, 1, 2},        /* PHY ID */
+        {0x113E, 1, true, 1, 31},       /* Last register of the window */
+        {0x2100, 1, true, 2, 0},
+        {0x411A, 1, true, 4, 13},       /* MMD setup */
+        {0x411C, 1, true, 4, 14},       /* MMD data */
+        {0x4100, 30, true, 1, 0},       /* Port 4 at 30 + 3 wraps to 1 */
+        {0x3100, 0, true, 2, 0},
+        {0x1101, 1, false, 0, 0},       /* Odd */
+        {0x1140, 1, false, 0, 0},       /* Past the window */
+        {0x10FE, 1, false, 0, 0},       /* Before the window */
+        {0x0100, 1, false, 0, 0},       /* Global, not a port */
+        {0x5100, 1, false, 0, 0},       /* Port 5 has no PHY */
+        {0x6100, 1, false, 0, 0},
+        {0x7100, 1, false, 0, 0},
+        {0x1000, 1, false, 0, 0},
+    };
+    uint8_t phy, reg;
+    size_t i;
+
+    for (i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        phy = 0xAA;
+        reg = 0xAA;
+        CHECK_EQ(lan9646_miim_xlate(cases[i].addr, cases[i].base, &phy, &reg), cases[i].ok);
+        if (cases[i].ok) {
+            CHECK_EQ(phy, cases[i].phy);
+            CHECK_EQ(reg, cases[i].reg);
+        } else {
+            CHECK_EQ(phy, 0xAA);
+            CHECK_EQ(reg, 0xAA);
+        }
+    }
+    /* Outputs are optional */
+    CHECK(lan9646_miim_xlate(0x2104, 1, NULL, NULL));
+    CHECK_EQ(lan9646_miim_xlate(LAN9646_REG_PORT_PHY_ID_H(3), 1, &phy, &reg), true);
+    CHECK_EQ(phy, 3);
+    CHECK_EQ(reg, 2);
+}
+
+static void prv_test_attach(void) {
+    lan9646_miim_t no_write = g_bus;
+
+    /* Matching IDs: one 4-byte I2C read and two MDIO reads per port */
+    prv_setup();
+    CHECK_EQ(lan9646_set_phy_bus(&g_dev, &g_bus), lan9646OK);
+    CHECK(g_dev.phy_bus == &g_bus);
+    CHECK_EQ(lan9646_model_stats()->reads, 4);
+    CHECK_EQ(lan9646_model_stats()->read_bytes, 16);
+    CHECK_EQ(g_mdio_reads, 8);
+    CHECK_EQ(g_mdio_writes, 0);
+
+    /* One PHY with another ID: not attached */
+    prv_setup();
+    g_mdio[PHY_BASE + 2U][3] = 0x1631;
+    CHECK_EQ(lan9646_set_phy_bus(&g_dev, &g_bus), lan9646ERR);
+    CHECK(g_dev.phy_bus == NULL);
+
+    /* Nothing on MDIO reads all ones, whatever the switch says */
+    prv_setup();
+    memset(g_present, 0, sizeof(g_present));
+    CHECK_EQ(lan9646_set_phy_bus(&g_dev, &g_bus), lan9646ERR);
+    CHECK(g_dev.phy_bus == NULL);
+    CHECK_EQ(g_mdio_reads, 2);
+    prv_setup();
+    memset(g_present, 0, sizeof(g_present));
+    lan9646_model_set(LAN9646_REG_PORT_PHY_ID_H(1), 2, 0xFFFF);
+    lan9646_model_set(LAN9646_REG_PORT_PHY_ID_L(1), 2, 0xFFFF);
+    CHECK_EQ(lan9646_set_phy_bus(&g_dev, &g_bus), lan9646ERR);
+
+    /* PHY base off by one: port 1 is looked for where nothing answers */
+    prv_setup();
+    g_dev.cfg.phy_addr = 0;
+    CHECK_EQ(lan9646_set_phy_bus(&g_dev, &g_bus), lan9646ERR);
+
+    /* Bus errors on either side come back, the route stays detached */
+    prv_setup();
+    g_mdio_timeout = true;
+    CHECK_EQ(lan9646_set_phy_bus(&g_dev, &g_bus), lan9646TIMEOUT);
+    CHECK(g_dev.phy_bus == NULL);
+    prv_setup();
+    lan9646_model_fail_next(1);
+    CHECK_EQ(lan9646_set_phy_bus(&g_dev, &g_bus), lan9646BUSERR);
+    CHECK(g_dev.phy_bus == NULL);
+
+    /* A failed re-attach drops the old route; NULL detaches without a check */
+    prv_setup();
+    CHECK_EQ(lan9646_set_phy_bus(&g_dev, &g_bus), lan9646OK);
+    g_mdio[PHY_BASE][2] = 0x0007;
+    CHECK_EQ(lan9646_set_phy_bus(&g_dev, &g_bus), lan9646ERR);
+    CHECK(g_dev.phy_bus == NULL);
+    lan9646_model_clear_stats();
+    CHECK_EQ(lan9646_set_phy_bus(&g_dev, NULL), lan9646OK);
+    CHECK_EQ(prv_txn(), 0);
+
+    no_write.write_fn = NULL;
+    CHECK_EQ(lan9646_set_phy_bus(&g_dev, &no_write), lan9646INVPARAM);
+}
+
+static void prv_test_routing(void) {
+    uint16_t v16;
+    uint32_t v32;
+    uint8_t v8;
+
+    prv_setup();
+    CHECK_EQ(lan9646_set_phy_bus(&g_dev, &g_bus), lan9646OK);
+    lan9646_model_clear_stats();
+    g_mdio_reads = 0;
+    g_dev.phy_bus_ops = 0;
+
+    /* 16-bit PHY registers over MDIO, nothing on I2C */
+    g_mdio[2][1] = 0x796D;
+    CHECK_EQ(lan9646_read_reg16(&g_dev, LAN9646_REG_PHY_BASIC_STATUS(2), &v16), lan9646OK);
+    CHECK_EQ(v16, 0x796D);
+    CHECK_EQ(g_last_phy, 2);
+    CHECK_EQ(g_last_reg, 1);
+    CHECK_EQ(lan9646_write_reg16(&g_dev, 0x4100, 0x1340), lan9646OK);
+    CHECK_EQ(g_mdio[4][0], 0x1340);
+    CHECK_EQ(lan9646_model_get(0x4100, 2), 0);
+
+    /* A 32-bit read of the window is two MDIO frames, high register first */
+    CHECK_EQ(lan9646_read_reg32(&g_dev, LAN9646_REG_PORT_PHY_ID_H(1), &v32), lan9646OK);
+    CHECK_EQ(v32, (PHY_ID1 << 16) | PHY_ID2);
+    CHECK_EQ(g_dev.phy_bus_ops, 3);
+    CHECK_EQ(prv_txn(), 0);
+
+    /* Byte accesses and other registers stay on the switch bus */
+    lan9646_model_set(0x1102, 1, 0x79);
+    CHECK_EQ(lan9646_read_reg8(&g_dev, 0x1102, &v8), lan9646OK);
+    CHECK_EQ(v8, 0x79);
+    CHECK_EQ(lan9646_read_reg16(&g_dev, LAN9646_REG_PORT_PHY_ID_H(6), &v16), lan9646OK);
+    CHECK_EQ(lan9646_write_reg16(&g_dev, 0x1140, 0x0001), lan9646OK);
+    CHECK_EQ(g_dev.phy_bus_ops, 3);
+    CHECK_EQ(prv_txn(), 3);
+
+    /* MMD indirect: setup, address, setup, data, all over MDIO */
+    g_mdio[3][14] = 0x0000;
+    CHECK_EQ(lan9646_phy_mmd_write(&g_dev, 3, 0x07, 0x003C, 0x0006), lan9646OK);
+    CHECK_EQ(g_mdio[3][13], LAN9646_MMD_FUNC_DATA | 0x07);
+    CHECK_EQ(g_mdio[3][14], 0x0006);
+    CHECK_EQ(g_dev.phy_bus_ops, 7);
+    CHECK_EQ(prv_txn(), 3);
+
+    /* Detached: the same read goes back to I2C */
+    CHECK_EQ(lan9646_set_phy_bus(&g_dev, NULL), lan9646OK);
+    lan9646_model_set(LAN9646_REG_PHY_BASIC_STATUS(2), 2, 0x7949);
+    CHECK_EQ(lan9646_read_reg16(&g_dev, LAN9646_REG_PHY_BASIC_STATUS(2), &v16), lan9646OK);
+    CHECK_EQ(v16, 0x7949);
+    CHECK_EQ(prv_txn(), 4);
+}
+
+int main(void) {
+    prv_test_xlate();
+    prv_test_attach();
+    prv_test_routing();
+
+    return test_done("test_lan9646_phy");
+}
@@ -0,0 +1,235 @@
+/**
+ * \file            test_lan9646_qos.c
+ * \brief           QoS register encoding: TC map, DSCP map, sources, queue split and scheduling
+ *
+ * The encoders are checked against hand-encoded register values for the
+ * setup main.c uses (four WRR/strict queues on port 6, the class selector
+ * DSCP map with EF promoted). The port setup is then applied on the
+ * register model, whose hook keeps the queue scheduling registers
+ * (0xN914-0xN915) per queue behind the queue index (0xN900) like the
+ * switch does.
+ *
+ * A priority mapped to a queue the port does not enable must be refused
+ * before anything is written, by lan9646_qos_port_apply() and by
+ * lan9646_config_apply() alike.
+ */
+
+#include "lan9646.h"
+#include "lan9646_qos.h"
+#include "lan9646_config.h"
+#include "lan9646_mib.h"
+#include "lan9646_model.h"
+#include "test_util.h"
+#include <stdio.h>
+#include <string.h>
+
+#define SOURCES                     (LAN9646_QOS_SRC_PCP | LAN9646_QOS_SRC_DSCP | LAN9646_QOS_SRC_ACL)
+
+static lan9646_t g_dev;
+
+static uint8_t g_mti[8][LAN9646_QOS_QUEUES][2];     /* CTRL0, CTRL1 of each queue */
+
+/* g_lan_qos[4] / g_lan_dscp_prio in main.c */
+static const lan9646_qos_port_cfg_t g_port6 = {
+    6, SOURCES, 4, {0, 0, 1, 1, 2, 2, 3, 3},
+    {{LAN9646_QOS_WRR, 1}, {LAN9646_QOS_WRR, 2}, {LAN9646_QOS_WRR, 4}, {LAN9646_QOS_STRICT, 0}},
+};
+
+static const uint8_t g_dscp_prio[LAN9646_QOS_DSCPS] = {
+    0, 0, 0, 0, 0, 0, 0, 0,  1, 1, 1, 1, 1, 1, 1, 1,
+    2, 2, 2, 2, 2, 2, 2, 2,  3, 3, 3, 3, 3, 3, 3, 3,
+    4, 4, 4, 4, 4, 4, 4, 4,  5, 5, 5, 5, 5, 5, 6, 5,
+    6, 6, 6, 6, 6, 6, 6, 6,  7, 7, 7, 7, 7, 7, 7, 7,
+};
+
+/*===========================================================================*/
+/*                          QUEUE REGISTER MODEL                              */
+/*===========================================================================*/
+
+static void prv_hook(uint16_t addr, uint16_t len, bool write) {
+    uint8_t* regs = lan9646_model_regs();
+    uint8_t port = (uint8_t)(addr >> 12);
+    uint16_t ctrl0 = (uint16_t)((addr & 0xF000U) | 0x0914U);
+    uint8_t q;
+
+    if (port < 1U || port > 7U) return;
+    q = regs[(addr & 0xF000U) | 0x0903U] & 0x03U;
+
+    /* Selecting a queue brings its registers in */
+    if (write && (addr & 0x0FFFU) == 0x0900U && len == 4U) {
+        memcpy(&regs[ctrl0], g_mti[port][q], 2);
+    } else if (write && addr <= ctrl0 + 1U && addr + len > ctrl0) {
+        memcpy(g_mti[port][q], &regs[ctrl0], 2);
+    }
+}
+
+static void prv_setup(void) {
+    lan9646_model_reset();
+    CHECK_EQ(lan9646_model_attach(&g_dev), lan9646OK);
+    lan9646_model_set_hook(prv_hook);
+    memset(g_mti, 0, sizeof(g_mti));
+}
+
+static uint32_t prv_txn(void) {
+    return lan9646_model_stats()->reads + lan9646_model_stats()->writes;
+}
+
+/*===========================================================================*/
+/*                              TESTS                                         */
+/*===========================================================================*/
+
+static void prv_test_encode(void) {
+    uint8_t pq[LAN9646_QOS_PRIOS] = {0, 0, 1, 1, 2, 2, 3, 3};
+    uint8_t dscp[LAN9646_QOS_DSCPS];
+    uint8_t regs[LAN9646_QOS_DSCP_MAP_LEN];
+    uint32_t reg;
+    uint8_t i;
+
+    /* One nibble per priority, priority 0 lowest */
+    CHECK_EQ(lan9646_qos_encode_tc_map(pq, &reg), lan9646OK);
+    CHECK_EQ(reg, 0x33221100UL);
+    memset(pq, 0, sizeof(pq));
+    pq[7] = 3;
+    pq[1] = 2;
+    CHECK_EQ(lan9646_qos_encode_tc_map(pq, &reg), lan9646OK);
+    CHECK_EQ(reg, 0x30000020UL);
+    pq[7] = 4;
+    CHECK_EQ(lan9646_qos_encode_tc_map(pq, &reg), lan9646INVPARAM);
+
+    /* Two DSCPs per byte, the even one in the low nibble */
+    CHECK_EQ(lan9646_qos_encode_dscp_map(g_dscp_prio, regs), lan9646OK);
+    for (i = 0; i < LAN9646_QOS_DSCP_MAP_LEN; i++) {
+        if (i == 23U) {
+            CHECK_EQ(regs[i], 0x56);                /* DSCP 46 (EF) -> 6, 47 -> 5 */
+        } else {
+            CHECK_EQ(regs[i], (uint8_t)((i >> 2) * 0x11U));
+        }
+    }
+    memcpy(dscp, g_dscp_prio, sizeof(dscp));
+    dscp[1] = 8;
+    CHECK_EQ(lan9646_qos_encode_dscp_map(dscp, regs), lan9646INVPARAM);
+}
+
+static void prv_test_apply(void) {
+    lan9646_qos_port_cfg_t cfg;
+    uint8_t i;
+
+    prv_setup();
+    lan9646_model_set(LAN9646_REG_PORT_PRIO_CTRL(6), 1, LAN9646_PORT_PRIO_OR | 0x10U);
+    lan9646_model_set(LAN9646_REG_PORT_OP_CTRL0(6), 1, 0xA0);
+    g_mti[6][1][0] = LAN9646_MTI_SHAPING_CBS << LAN9646_MTI_SHAPING_SHIFT;
+
+    CHECK_EQ(lan9646_qos_port_apply(&g_dev, &g_port6), lan9646OK);
+    printf("QoS port 6 apply: %lu transactions, %.2f ms at 100 kHz\n", (unsigned long)prv_txn(),
+           (double)lan9646_model_bus_ns(LAN9646_MODEL_I2C_HZ) / 1e6);
+
+    /* Highest source wins, OR mode off, the sources replace the old ones */
+    CHECK_EQ(lan9646_model_get(LAN9646_REG_PORT_PRIO_CTRL(6), 1), 0x87);
+    /* Four queues, other bits kept */
+    CHECK_EQ(lan9646_model_get(LAN9646_REG_PORT_OP_CTRL0(6), 1), 0xA2);
+    CHECK_EQ(lan9646_model_get(LAN9646_REG_PORT_TC_MAP(6), 4), 0x33221100UL);
+    /* WRR 1/2/4, queue 3 strict; the shaper of queue 1 survives */
+    CHECK_EQ(g_mti[6][0][0], 0x80);
+    CHECK_EQ(g_mti[6][0][1], 1);
+    CHECK_EQ(g_mti[6][1][0], 0x90);
+    CHECK_EQ(g_mti[6][1][1], 2);
+    CHECK_EQ(g_mti[6][2][0], 0x80);
+    CHECK_EQ(g_mti[6][2][1], 4);
+    CHECK_EQ(g_mti[6][3][0], 0x00);
+    CHECK_EQ(g_mti[6][3][1], 0);
+
+    /* A PHY port: one queue, every priority on it */
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.port = 2;
+    cfg.sources = SOURCES;
+    cfg.queues = 1;
+    CHECK_EQ(lan9646_qos_port_apply(&g_dev, &cfg), lan9646OK);
+    CHECK_EQ(lan9646_model_get(LAN9646_REG_PORT_OP_CTRL0(2), 1), LAN9646_PORT_QUEUE_SPLIT_1);
+    CHECK_EQ(lan9646_model_get(LAN9646_REG_PORT_TC_MAP(2), 4), 0);
+
+    /* A priority on a queue the port does not have: nothing written */
+    lan9646_model_clear_stats();
+    cfg.prio_queue[7] = 1;
+    CHECK_EQ(lan9646_qos_port_apply(&g_dev, &cfg), lan9646INVPARAM);
+    cfg = g_port6;
+    cfg.queues = 2;
+    CHECK_EQ(lan9646_qos_port_apply(&g_dev, &cfg), lan9646INVPARAM);
+    for (i = 0; i < LAN9646_QOS_PRIOS; i++) {
+        cfg.prio_queue[i] = (uint8_t)(i >> 2);
+    }
+    cfg.queues = 3;
+    CHECK_EQ(lan9646_qos_port_apply(&g_dev, &cfg), lan9646INVPARAM);
+    CHECK_EQ(prv_txn(), 0);
+
+    /* Two queues, priorities 4-7 on queue 1 */
+    cfg.queues = 2;
+    cfg.q[1].weight = 8;
+    CHECK_EQ(lan9646_qos_port_apply(&g_dev, &cfg), lan9646OK);
+    CHECK_EQ(lan9646_model_get(LAN9646_REG_PORT_OP_CTRL0(6), 1), 0xA1);
+    CHECK_EQ(lan9646_model_get(LAN9646_REG_PORT_TC_MAP(6), 4), 0x11110000UL);
+    CHECK_EQ(g_mti[6][1][1], 8);
+
+    /* Single DSCP and the whole map */
+    CHECK_EQ(lan9646_qos_set_dscp_map(&g_dev, g_dscp_prio), lan9646OK);
+    CHECK_EQ(lan9646_model_get(LAN9646_REG_DIFFSERV_MAP(23), 1), 0x56);
+    CHECK_EQ(lan9646_qos_set_dscp(&g_dev, 47, 7), lan9646OK);
+    CHECK_EQ(lan9646_model_get(LAN9646_REG_DIFFSERV_MAP(23), 1), 0x76);
+    CHECK_EQ(lan9646_qos_set_dscp(&g_dev, 64, 0), lan9646INVPARAM);
+    CHECK_EQ(lan9646_qos_set_sources(&g_dev, 6, 0x20), lan9646INVPARAM);
+}
+
+static void prv_test_config(void) {
+    lan9646_config_port_t port;
+    lan9646_config_report_t rep;
+    lan9646_config_t cfg;
+    lan9646_qos_port_cfg_t bad;
+
+    /* The same setup through the config engine finds nothing to do */
+    prv_setup();
+    CHECK_EQ(lan9646_qos_port_apply(&g_dev, &g_port6), lan9646OK);
+    memset(&port, 0, sizeof(port));
+    port.port = 6;
+    port.qos = &g_port6;
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.ports = &port;
+    cfg.port_count = 1;
+    CHECK_EQ(lan9646_config_apply(&g_dev, NULL, &cfg, false, NULL, NULL, &rep), lan9646OK);
+    CHECK_EQ(rep.changed, 0);
+    CHECK_EQ(rep.queues_checked, 4);
+    CHECK_EQ(rep.queues_changed, 0);
+
+    /* And refuses a priority on a disabled queue before writing */
+    bad = g_port6;
+    bad.queues = 1;
+    port.qos = &bad;
+    lan9646_model_clear_stats();
+    CHECK_EQ(lan9646_config_apply(&g_dev, NULL, &cfg, false, NULL, NULL, &rep), lan9646INVPARAM);
+    CHECK_EQ(lan9646_model_stats()->writes, 0);
+    CHECK_EQ(lan9646_model_get(LAN9646_REG_PORT_OP_CTRL0(6), 1), LAN9646_PORT_QUEUE_SPLIT_4);
+}
+
+static void prv_test_drops(void) {
+    lan9646_mib_engine_t mib;
+    lan9646_qos_drops_t d;
+
+    prv_setup();
+    CHECK_EQ(lan9646_mib_init(&mib, &g_dev, 0x40, true), lan9646OK);
+    lan9646_model_set_mib(6, LAN9646_MIB_RX_DROP, 3);
+    lan9646_model_set_mib(6, LAN9646_MIB_TX_DROP, 12);
+    lan9646_model_set_mib(6, LAN9646_MIB_TX_HI_PRIO_BYTE, 1500);
+    CHECK_EQ(lan9646_mib_snapshot(&mib, 0), lan9646OK);
+    CHECK_EQ(lan9646_qos_get_drops(&mib, 6, &d), lan9646OK);
+    CHECK_EQ(d.rx_drop, 3);
+    CHECK_EQ(d.tx_drop, 12);
+    CHECK_EQ(d.tx_hi_prio_bytes, 1500);
+    CHECK_EQ(lan9646_qos_get_drops(&mib, 2, &d), lan9646INVPARAM);
+}
+
+int main(void) {
+    prv_test_encode();
+    prv_test_apply();
+    prv_test_config();
+    prv_test_drops();
+
+    return test_done("test_lan9646_qos");
+}
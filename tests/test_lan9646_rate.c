@@ -0,0 +1,234 @@
+/**
+ * \file            test_lan9646_rate.c
+ * \brief           Rate limiter encoding across the whole range of each link speed
+ *
+ * Every rate from LAN9646_RATE_MIN_BPS up to the link speed (every code
+ * boundary, one below it, and a geometric sweep in between) is encoded
+ * for 10, 100 and 1000 Mbps links. The code must decode to the rate
+ * reported, never exceed the request (except the smallest 1000 step) and
+ * be the closest code that does not.
+ *
+ * The limiter registers are then checked on the register model: one
+ * 8-byte ingress burst, one 4-byte egress burst, re-encoding on a link
+ * speed change, the credit-based shaper and storm control.
+ */
+
+#include "lan9646.h"
+#include "lan9646_rate.h"
+#include "lan9646_model.h"
+#include "test_util.h"
+#include <stdio.h>
+
+#define CODE_LAST                   (LAN9646_RATE_CODE_KBPS_BASE + LAN9646_RATE_CODE_KBPS_STEPS)
+
+static lan9646_t g_dev;
+static lan9646_rate_t g_rl;
+
+static const lan9646_speed_t g_speeds[] = {
+    LAN9646_SPEED_10M, LAN9646_SPEED_100M, LAN9646_SPEED_1000M,
+};
+static const uint32_t g_link_bps[] = {
+    10000000UL, 100000000UL, 1000000000UL,
+};
+
+/*===========================================================================*/
+/*                              TESTS                                         */
+/*===========================================================================*/
+
+/* Encode one rate and check it against every code the switch has */
+static uint32_t prv_check_rate(uint32_t bps, lan9646_speed_t speed, uint32_t link) {
+    uint32_t actual = 0xFFFFFFFFUL;
+    uint32_t other;
+    uint8_t code = 0xFF;
+    uint8_t c;
+    uint32_t bad = 0;
+
+    if (lan9646_rate_encode(bps, speed, &code, &actual) != lan9646OK) return 1;
+    if (lan9646_rate_decode(code, speed) != actual) bad++;
+
+    if (bps >= link) {
+        return bad + (code != LAN9646_RATE_CODE_UNLIMITED || actual != 0);
+    }
+    if (code == LAN9646_RATE_CODE_UNLIMITED || code > CODE_LAST) return bad + 1;
+
+    if (actual > bps) {
+        /* Only the first 640 kbps step at 1000 may be above the request */
+        return bad + (speed != LAN9646_SPEED_1000M || code != LAN9646_RATE_CODE_KBPS_BASE + 1U);
+    }
+
+    /* No code lies between the one chosen and the request */
+    for (c = 1; c <= CODE_LAST; c++) {
+        other = lan9646_rate_decode(c, speed);
+        if (other > actual && other <= bps) bad++;
+    }
+    return bad;
+}
+
+static void prv_test_encode_range(void) {
+    uint32_t checked;
+    uint32_t bad;
+    uint32_t link;
+    uint32_t bps;
+    uint32_t r;
+    uint8_t code;
+    uint8_t c;
+    uint8_t s;
+
+    printf("Rate encoding, MIN_BPS..link speed\n");
+    printf("%-6s | %8s | %5s | %12s | %12s\n", "link", "rates", "bad", "5 Mbps ->", "code 1");
+    for (s = 0; s < 3U; s++) {
+        link = g_link_bps[s];
+        checked = 0;
+        bad = 0;
+
+        /* Every code boundary, one below it and one above */
+        for (c = 1; c <= CODE_LAST; c++) {
+            r = lan9646_rate_decode(c, g_speeds[s]);
+            if (r == 0) continue;
+            bad += prv_check_rate(r, g_speeds[s], link);
+            bad += prv_check_rate(r + 1U, g_speeds[s], link);
+            if (r - 1U >= LAN9646_RATE_MIN_BPS) {
+                bad += prv_check_rate(r - 1U, g_speeds[s], link);
+            }
+            checked += 3U;
+
+            /* And every code below the link speed round-trips */
+            if (r < link) {
+                CHECK_EQ(lan9646_rate_encode(r, g_speeds[s], &code, NULL), lan9646OK);
+                CHECK_EQ(code, c);
+            }
+        }
+
+        /* Geometric sweep, about 1 % apart */
+        for (bps = LAN9646_RATE_MIN_BPS; bps < link; bps += bps / 97U + 1U) {
+            bad += prv_check_rate(bps, g_speeds[s], link);
+            checked++;
+        }
+        bad += prv_check_rate(link - 1U, g_speeds[s], link);
+        bad += prv_check_rate(link, g_speeds[s], link);
+        bad += prv_check_rate(0xFFFFFFFFUL, g_speeds[s], link);
+        checked += 3U;
+
+        CHECK_EQ(lan9646_rate_encode(5000000UL, g_speeds[s], &code, &r), lan9646OK);
+        printf("%4lu M | %8lu | %5lu | %9.2f M | %9lu k\n", (unsigned long)(link / 1000000UL),
+               (unsigned long)checked, (unsigned long)bad, r / 1e6,
+               (unsigned long)(lan9646_rate_decode(1, g_speeds[s]) / 1000UL));
+        CHECK_EQ(bad, 0);
+    }
+
+    /* The review case: 5 Mbps on a 1000 link is 7 x 640 kbps, not 960 kbps */
+    CHECK_EQ(lan9646_rate_encode(5000000UL, LAN9646_SPEED_1000M, &code, &r), lan9646OK);
+    CHECK_EQ(code, LAN9646_RATE_CODE_KBPS_BASE + 7U);
+    CHECK_EQ(r, 4480000UL);
+    CHECK_EQ(lan9646_rate_encode(5000000UL, LAN9646_SPEED_100M, &code, &r), lan9646OK);
+    CHECK_EQ(code, 5);
+    CHECK_EQ(r, 5000000UL);
+    CHECK_EQ(lan9646_rate_encode(9999999UL, LAN9646_SPEED_1000M, &code, &r), lan9646OK);
+    CHECK_EQ(r, 9600000UL);
+    CHECK_EQ(lan9646_rate_encode(10000000UL, LAN9646_SPEED_1000M, &code, &r), lan9646OK);
+    CHECK_EQ(code, 1);
+
+    /* Edges */
+    CHECK_EQ(lan9646_rate_encode(0, LAN9646_SPEED_100M, &code, &r), lan9646OK);
+    CHECK_EQ(code, LAN9646_RATE_CODE_UNLIMITED);
+    CHECK_EQ(r, 0);
+    CHECK_EQ(lan9646_rate_encode(LAN9646_RATE_MIN_BPS, LAN9646_SPEED_100M, &code, &r), lan9646OK);
+    CHECK_EQ(code, LAN9646_RATE_CODE_KBPS_BASE + 1U);
+    CHECK_EQ(lan9646_rate_encode(LAN9646_RATE_MIN_BPS, LAN9646_SPEED_1000M, &code, &r), lan9646OK);
+    CHECK_EQ(r, 640000UL);
+    CHECK_EQ(lan9646_rate_encode(LAN9646_RATE_MIN_BPS - 1U, LAN9646_SPEED_100M, &code, &r),
+             lan9646INVPARAM);
+    CHECK_EQ(lan9646_rate_encode(1000, LAN9646_SPEED_100M, NULL, &r), lan9646INVPARAM);
+    CHECK_EQ(lan9646_rate_decode(CODE_LAST + 1U, LAN9646_SPEED_100M), 0);
+    CHECK_EQ(lan9646_rate_decode(0x7F, LAN9646_SPEED_1000M), 0);
+}
+
+static void prv_setup(void) {
+    lan9646_model_reset();
+    CHECK_EQ(lan9646_model_attach(&g_dev), lan9646OK);
+    CHECK_EQ(lan9646_rate_init(&g_rl, &g_dev), lan9646OK);
+}
+
+static void prv_test_registers(void) {
+    lan9646_rate_status_t st;
+    uint8_t i;
+
+    prv_setup();
+
+    /* Port-based: flag, then all eight limiters in one burst */
+    lan9646_model_clear_stats();
+    CHECK_EQ(lan9646_rate_set_ingress(&g_rl, 2, LAN9646_RATE_ALL_PRIO, 5000000UL), lan9646OK);
+    CHECK_EQ(lan9646_model_stats()->writes, 2);
+    CHECK_EQ(lan9646_model_stats()->reads, 1);
+    CHECK_EQ(lan9646_model_get(LAN9646_REG_PORT_RATE_CTRL(2), 1), LAN9646_RATE_IN_PORT_BASED);
+    for (i = 0; i < LAN9646_RATE_PRIOS; i++) {
+        CHECK_EQ(lan9646_model_get(LAN9646_REG_PORT_IN_RATE(2, i), 1), 0x6B);
+    }
+    CHECK_EQ(g_rl.stats.rounded, 8);
+
+    /* Egress per queue */
+    CHECK_EQ(lan9646_rate_set_egress(&g_rl, 2, 1, 200000000UL), lan9646OK);
+    CHECK_EQ(lan9646_model_get(LAN9646_REG_PORT_OUT_RATE(2, 0), 4), 0x00140000UL);
+    CHECK_EQ(lan9646_rate_set_egress(&g_rl, 2, 4, 1), lan9646INVPARAM);
+    CHECK_EQ(lan9646_rate_set_egress(&g_rl, 2, 0, 1000), lan9646INVPARAM);
+
+    /* Programmed limits: one ingress limiter for the port, the egress sum */
+    CHECK_EQ(lan9646_rate_get_status(&g_rl, NULL, 2, &st), lan9646ERR);
+    CHECK_EQ(st.in_limit_bps, 4480000UL);
+    CHECK_EQ(st.out_limit_bps, 0);              /* Queues 0, 2, 3 unlimited */
+
+    /* Link drops to 100: both re-encoded, shaper untouched */
+    lan9646_model_clear_stats();
+    CHECK_EQ(lan9646_rate_set_link_speed(&g_rl, 2, LAN9646_SPEED_100M), lan9646OK);
+    CHECK_EQ(lan9646_model_stats()->writes, 3);
+    for (i = 0; i < LAN9646_RATE_PRIOS; i++) {
+        CHECK_EQ(lan9646_model_get(LAN9646_REG_PORT_IN_RATE(2, i), 1), 5);
+    }
+    CHECK_EQ(lan9646_model_get(LAN9646_REG_PORT_OUT_RATE(2, 1), 1), LAN9646_RATE_CODE_UNLIMITED);
+    CHECK_EQ(lan9646_rate_set_link_speed(&g_rl, 2, LAN9646_SPEED_DOWN), lan9646OK);
+    CHECK_EQ(lan9646_rate_set_link_speed(&g_rl, 2, LAN9646_SPEED_100M), lan9646OK);
+    CHECK_EQ(g_rl.stats.reencodes, 1);
+
+    /* A 100 kbps request survives the link going to 1000 as one 640 kbps step */
+    CHECK_EQ(lan9646_rate_set_ingress(&g_rl, 3, 5, 100000UL), lan9646OK);
+    CHECK_EQ(lan9646_model_get(LAN9646_REG_PORT_RATE_CTRL(3), 1), 0);
+    CHECK_EQ(lan9646_model_get(LAN9646_REG_PORT_IN_RATE(3, 5), 1), 0x65);
+    CHECK_EQ(lan9646_model_get(LAN9646_REG_PORT_IN_RATE(3, 4), 1), 0);
+    CHECK_EQ(lan9646_rate_set_link_speed(&g_rl, 3, LAN9646_SPEED_100M), lan9646OK);
+    CHECK_EQ(lan9646_model_get(LAN9646_REG_PORT_IN_RATE(3, 5), 1), 0x65);
+    CHECK_EQ(lan9646_rate_set_link_speed(&g_rl, 3, LAN9646_SPEED_1000M), lan9646OK);
+    CHECK_EQ(lan9646_model_get(LAN9646_REG_PORT_IN_RATE(3, 5), 1), 0x65);
+
+    /* Credit-based shaper: 100 Mbps of 1000 is 0.1 x 2^24 */
+    CHECK_EQ(lan9646_rate_set_shaper(&g_rl, 6, 2, 100000000UL), lan9646OK);
+    CHECK_EQ(lan9646_model_get(LAN9646_REG_PORT_MTI_QUEUE_INDEX(6), 4), 2);
+    CHECK_EQ(lan9646_model_get(LAN9646_REG_PORT_MTI_HI_CREDIT(6), 2), LAN9646_RATE_CBS_HI_CREDIT);
+    CHECK_EQ(lan9646_model_get(LAN9646_REG_PORT_MTI_LO_CREDIT(6), 2), LAN9646_RATE_CBS_LO_CREDIT);
+    CHECK_EQ(lan9646_model_get(LAN9646_REG_PORT_MTI_CREDIT_INC(6), 4), 1677721UL);
+    CHECK_EQ(lan9646_model_get(LAN9646_REG_PORT_MTI_QUEUE_CTRL0(6), 1),
+             LAN9646_MTI_SHAPING_CBS << LAN9646_MTI_SHAPING_SHIFT);
+    CHECK_EQ(lan9646_rate_set_shaper(&g_rl, 6, 2, 0), lan9646OK);
+    CHECK_EQ(lan9646_model_get(LAN9646_REG_PORT_MTI_QUEUE_CTRL0(6), 1), 0);
+
+    /* Storm control, main.c's 1 % with multicast on the PHY ports */
+    lan9646_model_set(LAN9646_REG_SW_MAC_CTRL2, 1, 0x80 | LAN9646_SW_MCAST_STORM_DIS);
+    CHECK_EQ(lan9646_rate_set_storm(&g_rl, 1, true, LAN9646_PORT_MASK_PHY), lan9646OK);
+    CHECK_EQ(lan9646_model_get(LAN9646_REG_SW_MAC_CTRL2, 2), 0x8063);
+    for (i = 1; i <= 7U; i++) {
+        CHECK_EQ(lan9646_model_get(LAN9646_REG_PORT_MAC_CTRL0(i), 1),
+                 (i <= 4U) ? LAN9646_PORT_BCAST_STORM_EN : 0U);
+    }
+    CHECK_EQ(lan9646_rate_set_storm(&g_rl, 100, false, 0x20), lan9646OK);
+    CHECK_EQ(lan9646_model_get(LAN9646_REG_SW_MAC_CTRL2, 2),             /* Capped */
+             ((0x80U | LAN9646_SW_MCAST_STORM_DIS) << 8) | LAN9646_SW_STORM_RATE_MAX);
+    CHECK_EQ(lan9646_model_get(LAN9646_REG_PORT_MAC_CTRL0(6), 1), LAN9646_PORT_BCAST_STORM_EN);
+    CHECK_EQ(lan9646_model_get(LAN9646_REG_PORT_MAC_CTRL0(1), 1), 0);
+    CHECK_EQ(lan9646_rate_set_storm(&g_rl, 101, false, 0), lan9646INVPARAM);
+}
+
+int main(void) {
+    prv_test_encode_range();
+    prv_test_registers();
+
+    return test_done("test_lan9646_rate");
+}
@@ -0,0 +1,280 @@
+/**
+ * \file            test_lan9646_shadow.c
+ * \brief           LAN9646 register shadow: cache classes and I2C transactions saved
+ *
+ * Unit checks of the cacheable / volatile / read-clear classes, invalidate,
+ * write-back with sync and bus errors, against the register model.
+ *
+ * The configuration run brings the switch up through the driver API the
+ * way main.c does on the registers it shadows: chip ID, port 6 RGMII
+ * (XMII control and delays), switch start and port membership, each set
+ * with read-modify-write and read back to verify, followed by a minute of
+ * once-per-second port 6 link checks. It is run without a shadow,
+ * with main.c's ranges write-through and in write-back mode, and prints
+ * the transactions and bus time of each.
+ */
+
+#include "lan9646.h"
+#include "lan9646_switch.h"
+#include "lan9646_model.h"
+#include "test_util.h"
+#include <string.h>
+
+/* g_lan_shadow_ranges in main.c */
+static const lan9646_reg_range_t g_main_ranges[] = {
+    {LAN9646_REG_CHIP_ID0, 3, LAN9646_REG_CACHEABLE},
+    {LAN9646_REG_SWITCH_OP, 1, LAN9646_REG_CACHEABLE},
+    {LAN9646_REG_PORT_XMII_CTRL0(6), 2, LAN9646_REG_CACHEABLE},
+    {LAN9646_REG_PORT_XMII_CTRL0(7), 2, LAN9646_REG_CACHEABLE},
+    {LAN9646_REG_PORT_MEMBERSHIP(1), 4, LAN9646_REG_CACHEABLE},
+    {LAN9646_REG_PORT_MEMBERSHIP(2), 4, LAN9646_REG_CACHEABLE},
+    {LAN9646_REG_PORT_MEMBERSHIP(3), 4, LAN9646_REG_CACHEABLE},
+    {LAN9646_REG_PORT_MEMBERSHIP(4), 4, LAN9646_REG_CACHEABLE},
+    {LAN9646_REG_PORT_MEMBERSHIP(6), 4, LAN9646_REG_CACHEABLE},
+    {LAN9646_REG_PORT_MEMBERSHIP(7), 4, LAN9646_REG_CACHEABLE},
+};
+
+static const uint8_t g_ports[] = {1, 2, 3, 4, 6, 7};
+static const uint8_t g_members[] = {0x6E, 0x6D, 0x6B, 0x67, 0x4F, 0x3F};
+
+static lan9646_t g_dev;
+static lan9646_shadow_t g_shadow;
+
+static uint32_t prv_txn(void) {
+    return lan9646_model_stats()->reads + lan9646_model_stats()->writes;
+}
+
+/*===========================================================================*/
+/*                              UNIT CHECKS                                   */
+/*===========================================================================*/
+
+static void prv_test_classes(void) {
+    /* 0x1010..0x101F cacheable except a volatile 0x1014 and a read-clear 0x1018 */
+    static const lan9646_reg_range_t ranges[] = {
+        {0x1014, 1, LAN9646_REG_VOLATILE},
+        {0x1018, 1, LAN9646_REG_READ_CLEAR},
+        {0x1010, 16, LAN9646_REG_CACHEABLE},
+    };
+    static lan9646_reg_range_t too_big[] = {
+        {0x2000, LAN9646_SHADOW_BYTES + 1U, LAN9646_REG_CACHEABLE},
+    };
+    lan9646_shadow_stats_t st;
+    uint8_t v8;
+    uint8_t buf[16];
+
+    lan9646_model_reset();
+    CHECK_EQ(lan9646_model_attach(&g_dev), lan9646OK);
+    CHECK_EQ(lan9646_shadow_attach(&g_dev, &g_shadow, too_big, 1), lan9646INVPARAM);
+    CHECK_EQ(lan9646_shadow_attach(&g_dev, &g_shadow, ranges, 3), lan9646OK);
+    lan9646_model_set(0x1010, 4, 0x11223344U);
+    lan9646_model_set(0x1014, 1, 0x55);
+
+    /* First read misses, the second is served from memory */
+    CHECK_EQ(lan9646_read_reg8(&g_dev, 0x1011, &v8), lan9646OK);
+    CHECK_EQ(v8, 0x22);
+    CHECK_EQ(prv_txn(), 1);
+    CHECK_EQ(lan9646_read_reg8(&g_dev, 0x1011, &v8), lan9646OK);
+    CHECK_EQ(prv_txn(), 1);
+
+    /* RMW of a cached register: one write, no read */
+    CHECK_EQ(lan9646_modify_reg8(&g_dev, 0x1011, 0x0F, 0x05), lan9646OK);
+    CHECK_EQ(prv_txn(), 2);
+    CHECK_EQ(lan9646_model_stats()->writes, 1);
+    CHECK_EQ(lan9646_model_get(0x1011, 1), 0x25);
+
+    /* The volatile hole always goes to the bus and sees hardware changes */
+    CHECK_EQ(lan9646_read_reg8(&g_dev, 0x1014, &v8), lan9646OK);
+    lan9646_model_set(0x1014, 1, 0x56);
+    CHECK_EQ(lan9646_read_reg8(&g_dev, 0x1014, &v8), lan9646OK);
+    CHECK_EQ(v8, 0x56);
+    CHECK_EQ(prv_txn(), 4);
+
+    /* Refresh loads the range but skips the read-clear byte */
+    lan9646_model_clear_stats();
+    CHECK_EQ(lan9646_shadow_refresh(&g_dev), lan9646OK);
+    CHECK_EQ(lan9646_model_stats()->reads, 2);                  /* Around 0x1018 */
+    CHECK_EQ(lan9646_model_stats()->read_bytes, 15);
+    lan9646_model_clear_stats();
+    CHECK_EQ(lan9646_read_burst(&g_dev, 0x1019, buf, 7), lan9646OK);
+    CHECK_EQ(prv_txn(), 0);
+    CHECK_EQ(lan9646_read_reg8(&g_dev, 0x1018, &v8), lan9646OK);
+    CHECK_EQ(lan9646_read_reg8(&g_dev, 0x1018, &v8), lan9646OK);
+    CHECK_EQ(prv_txn(), 2);
+
+    /* Changed behind our back: stale until invalidated */
+    lan9646_model_set(0x1012, 1, 0x99);
+    CHECK_EQ(lan9646_read_reg8(&g_dev, 0x1012, &v8), lan9646OK);
+    CHECK_EQ(v8, 0x33);
+    lan9646_shadow_invalidate(&g_dev, 0x1012, 1);
+    CHECK_EQ(lan9646_read_reg8(&g_dev, 0x1012, &v8), lan9646OK);
+    CHECK_EQ(v8, 0x99);
+
+    /* A failed write leaves the device state unknown: next read goes out */
+    lan9646_model_clear_stats();
+    lan9646_model_fail_next(1);
+    CHECK_EQ(lan9646_write_reg8(&g_dev, 0x1013, 0x77), lan9646BUSERR);
+    CHECK_EQ(lan9646_read_reg8(&g_dev, 0x1013, &v8), lan9646OK);
+    CHECK_EQ(v8, 0x44);
+    CHECK_EQ(lan9646_model_stats()->reads, 1);
+
+    lan9646_shadow_get_stats(&g_dev, &st);
+    CHECK(st.hits >= 3U);
+    CHECK(st.misses >= 3U);
+}
+
+static void prv_test_write_back(void) {
+    static const lan9646_reg_range_t ranges[] = {
+        {0x2000, 8, LAN9646_REG_CACHEABLE},
+    };
+    lan9646_shadow_stats_t st;
+    uint32_t v32;
+    uint8_t i;
+
+    lan9646_model_reset();
+    CHECK_EQ(lan9646_model_attach(&g_dev), lan9646OK);
+    CHECK_EQ(lan9646_shadow_attach(&g_dev, &g_shadow, ranges, 1), lan9646OK);
+    CHECK_EQ(lan9646_shadow_set_write_back(&g_dev, true), lan9646OK);
+
+    /* Eight byte writes stay in the shadow and read back from it */
+    for (i = 0; i < 8U; i++) {
+        CHECK_EQ(lan9646_write_reg8(&g_dev, (uint16_t)(0x2000U + i), (uint8_t)(0xA0U + i)), lan9646OK);
+    }
+    CHECK_EQ(lan9646_read_reg32(&g_dev, 0x2004, &v32), lan9646OK);
+    CHECK_EQ(v32, 0xA4A5A6A7U);
+    CHECK_EQ(prv_txn(), 0);
+    CHECK_EQ(lan9646_model_get(0x2000, 4), 0);
+
+    /* One burst on sync, nothing left dirty */
+    CHECK_EQ(lan9646_shadow_sync(&g_dev), lan9646OK);
+    CHECK_EQ(lan9646_model_stats()->writes, 1);
+    CHECK_EQ(lan9646_model_stats()->write_bytes, 8);
+    CHECK_EQ(lan9646_model_get(0x2000, 4), 0xA0A1A2A3U);
+    CHECK_EQ(lan9646_shadow_sync(&g_dev), lan9646OK);
+    CHECK_EQ(lan9646_model_stats()->writes, 1);
+
+    /* Leaving write-back syncs first */
+    CHECK_EQ(lan9646_write_reg8(&g_dev, 0x2007, 0x01), lan9646OK);
+    CHECK_EQ(lan9646_shadow_set_write_back(&g_dev, false), lan9646OK);
+    CHECK_EQ(lan9646_model_get(0x2007, 1), 0x01);
+
+    lan9646_shadow_get_stats(&g_dev, &st);
+    CHECK_EQ(st.deferred, 9);
+    CHECK_EQ(st.flushes, 2);
+}
+
+/*===========================================================================*/
+/*                          FULL CONFIGURATION                                */
+/*===========================================================================*/
+
+typedef enum {
+    MODE_NONE = 0,
+    MODE_WRITE_THROUGH,
+    MODE_WRITE_BACK,
+} mode_t;
+
+static void prv_configure(void) {
+    lan9646_rgmii_delay_t dly = {.rx_delay = true, .tx_delay = true};
+    lan9646_rgmii_delay_t rd;
+    lan9646_speed_t speed;
+    uint16_t chip_id;
+    uint8_t rev;
+    uint8_t m;
+    uint8_t i;
+    uint32_t s;
+
+    CHECK_EQ(lan9646_switch_init(&g_dev), lan9646OK);
+    CHECK_EQ(lan9646_get_chip_id(&g_dev, &chip_id, &rev), lan9646OK);
+    CHECK_EQ(chip_id, LAN9646_CHIP_ID);
+
+    /* Port 6: RGMII full duplex 1G, then delays; switch start */
+    CHECK_EQ(lan9646_modify_reg8(&g_dev, LAN9646_REG_PORT_XMII_CTRL0(6), 0x68, 0x68), lan9646OK);
+    CHECK_EQ(lan9646_modify_reg8(&g_dev, LAN9646_REG_PORT_XMII_CTRL1(6), 0x43, 0x00), lan9646OK);
+    CHECK_EQ(lan9646_switch_set_rgmii_delay(&g_dev, &dly), lan9646OK);
+    CHECK_EQ(lan9646_modify_reg8(&g_dev, LAN9646_REG_SWITCH_OP, 0x01, 0x01), lan9646OK);
+
+    for (i = 0; i < sizeof(g_ports); i++) {
+        CHECK_EQ(lan9646_switch_set_port_membership(&g_dev, g_ports[i], g_members[i]), lan9646OK);
+    }
+
+    /* Read back what was set */
+    CHECK_EQ(lan9646_switch_get_rgmii_delay(&g_dev, &rd), lan9646OK);
+    CHECK(rd.rx_delay && rd.tx_delay);
+    for (i = 0; i < sizeof(g_ports); i++) {
+        CHECK_EQ(lan9646_switch_get_port_membership(&g_dev, g_ports[i], &m), lan9646OK);
+        CHECK_EQ(m, g_members[i]);
+    }
+
+    /* One minute of link checks: port status is volatile, XMII is not */
+    for (s = 0; s < 60U; s++) {
+        (void)lan9646_switch_get_gmac_link(&g_dev, &speed, NULL);
+        CHECK_EQ(lan9646_switch_get_rgmii_delay(&g_dev, &rd), lan9646OK);
+    }
+}
+
+static uint32_t prv_run(mode_t mode, uint8_t* image, uint32_t* reads, uint32_t* writes,
+                        double* ms) {
+    lan9646_model_reset();
+    CHECK_EQ(lan9646_model_attach(&g_dev), lan9646OK);
+    /* Port 6 link up at 1G */
+    lan9646_model_set(LAN9646_REG_PORT_STATUS(6), 1, 0x14);
+
+    if (mode != MODE_NONE) {
+        CHECK_EQ(lan9646_shadow_attach(&g_dev, &g_shadow, g_main_ranges,
+                                       (uint8_t)(sizeof(g_main_ranges) / sizeof(g_main_ranges[0]))),
+                 lan9646OK);
+    }
+    if (mode == MODE_WRITE_BACK) {
+        CHECK_EQ(lan9646_shadow_set_write_back(&g_dev, true), lan9646OK);
+    }
+
+    prv_configure();
+    if (mode == MODE_WRITE_BACK) {
+        CHECK_EQ(lan9646_shadow_set_write_back(&g_dev, false), lan9646OK);
+    }
+
+    memcpy(image, lan9646_model_regs(), 0x10000);
+    *reads = lan9646_model_stats()->reads;
+    *writes = lan9646_model_stats()->writes;
+    *ms = (double)lan9646_model_bus_ns(LAN9646_MODEL_I2C_HZ) / 1e6;
+    return *reads + *writes;
+}
+
+static void prv_test_configuration(void) {
+    static const char* const names[] = {"no shadow", "write-through", "write-back + sync"};
+    static uint8_t images[3][0x10000];
+    uint32_t txn[3];
+    uint32_t rd[3];
+    uint32_t wr[3];
+    double ms[3];
+    uint32_t i;
+
+    printf("Switch bring-up + 60 s of link checks, I2C at 100 kHz\n");
+    printf("%-18s | %5s | %6s | %5s | %8s\n", "", "txn", "reads", "writes", "bus ms");
+    for (i = 0; i < 3U; i++) {
+        txn[i] = prv_run((mode_t)i, images[i], &rd[i], &wr[i], &ms[i]);
+        printf("%-18s | %5lu | %6lu | %6lu | %8.1f\n", names[i], (unsigned long)txn[i],
+               (unsigned long)rd[i], (unsigned long)wr[i], ms[i]);
+    }
+    printf("saved: %lu transactions write-through, %lu write-back\n",
+           (unsigned long)(txn[0] - txn[1]), (unsigned long)(txn[0] - txn[2]));
+
+    /* Same device state whichever way it was written */
+    CHECK(memcmp(images[0], images[1], 0x10000) == 0);
+    CHECK(memcmp(images[0], images[2], 0x10000) == 0);
+    CHECK_EQ(lan9646_model_get(LAN9646_REG_PORT_XMII_CTRL1(6), 1), 0x18);
+
+    /* Every modify and read-back of a shadowed register skipped its read */
+    CHECK(txn[1] < txn[0]);
+    CHECK_EQ(wr[1], wr[0]);
+    CHECK(rd[0] - rd[1] >= 60U);                   /* At least the XMII read-backs */
+    CHECK(wr[2] < wr[1]);
+    CHECK(txn[2] <= txn[1]);
+}
+
+int main(void) {
+    prv_test_classes();
+    prv_test_write_back();
+    prv_test_configuration();
+
+    return test_done("test_lan9646_shadow");
+}
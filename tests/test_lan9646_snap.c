@@ -0,0 +1,245 @@
+/**
+ * \file            test_lan9646_snap.c
+ * \brief           Register snapshot: capture on the register model, blob layout, clear-on-read PHY registers
+ *
+ * Every register byte of the model is set to SNAP_PATTERN(addr), the MIB
+ * engine gets known totals and the VLAN table (emulated behind 0x040E as
+ * in the VLAN test) two VIDs. The blob of the default ranges must hold
+ * each range as one record, fit main.c's 4096-byte buffer, and never read
+ * the PHY registers that clear on read.
+ *
+ * With a directory argument two snapshots are written there, before.snap
+ * and after.snap (one membership byte, one MIB total and one VID changed);
+ * test_snapdec.py decodes and diffs them with snapdec.py.
+ */
+
+#include "lan9646.h"
+#include "lan9646_snap.h"
+#include "lan9646_mib.h"
+#include "lan9646_vlan.h"
+#include "lan9646_model.h"
+#include "test_util.h"
+#include <stdio.h>
+#include <string.h>
+
+/* Same formula in test_snapdec.py */
+#define SNAP_PATTERN(a)             ((uint8_t)(((a) >> 8) ^ ((a) * 3U)))
+#define SNAP_TIME_MS                123456UL
+#define SNAP_SIZE                   4096U   /* LAN_SNAP_SIZE in main.c */
+#define MIB_PORTS                   0xDEU   /* Ports 1-4, 6, 7 */
+
+static lan9646_t g_dev;
+static lan9646_vlan_t g_vlan;
+static lan9646_mib_engine_t g_mib;
+
+static uint8_t g_table[LAN9646_VLAN_VIDS][12];
+static uint32_t g_clear_reads;          /* Reads that touched a clear-on-read PHY register */
+
+static uint8_t g_blob[SNAP_SIZE];
+
+/*===========================================================================*/
+/*                          TABLE MODEL                                       */
+/*===========================================================================*/
+
+static bool prv_overlaps(uint16_t addr, uint16_t len, uint16_t reg) {
+    return addr <= reg + 1U && addr + len > reg;
+}
+
+static void prv_hook(uint16_t addr, uint16_t len, bool write) {
+    uint8_t* regs = lan9646_model_regs();
+    uint8_t port = (uint8_t)(addr >> 12);
+    uint16_t vid;
+    uint8_t ctrl;
+
+    if (!write && port >= 1U && port <= 4U
+        && (prv_overlaps(addr, len, LAN9646_REG_PORT_PHY_BASIC_STAT(port))
+            || prv_overlaps(addr, len, LAN9646_REG_PORT_PHY_AUTONEG_EXP(port))
+            || prv_overlaps(addr, len, LAN9646_REG_PORT_PHY_1000_STAT(port)))) {
+        g_clear_reads++;
+    }
+
+    if (addr > LAN9646_REG_VLAN_CTRL || addr + len <= LAN9646_REG_VLAN_CTRL) return;
+
+    ctrl = regs[LAN9646_REG_VLAN_CTRL];
+    if (write && (ctrl & LAN9646_VLAN_START)) {
+        vid = (uint16_t)(lan9646_model_get(LAN9646_REG_VLAN_INDEX, 2) & LAN9646_VLAN_VID_MASK);
+        switch (ctrl & 0x03U) {
+            case LAN9646_VLAN_ACTION_WRITE:
+                memcpy(g_table[vid], &regs[LAN9646_REG_VLAN_ENTRY], 12);
+                break;
+            case LAN9646_VLAN_ACTION_READ:
+                memcpy(&regs[LAN9646_REG_VLAN_ENTRY], g_table[vid], 12);
+                break;
+            default:
+                break;
+        }
+    } else if (!write) {
+        regs[LAN9646_REG_VLAN_CTRL] &= (uint8_t)~LAN9646_VLAN_START;
+    }
+}
+
+static void prv_setup(void) {
+    static const lan9646_vlan_entry_t vids[] = {
+        {1, 0x6F, 0x6F, 0},
+        {100, 0x21, 0x01, 1},
+    };
+    uint8_t* regs;
+    uint32_t a;
+    uint8_t port, i;
+
+    lan9646_model_reset();
+    CHECK_EQ(lan9646_model_attach(&g_dev), lan9646OK);
+    lan9646_model_set_hook(prv_hook);
+    memset(g_table, 0, sizeof(g_table));
+    CHECK_EQ(lan9646_vlan_init(&g_vlan, &g_dev), lan9646OK);
+    for (i = 0; i < 2U; i++) {
+        CHECK_EQ(lan9646_vlan_add(&g_vlan, &vids[i]), lan9646OK);
+    }
+
+    /* Totals as the engine keeps them, u64 with the high half in use */
+    CHECK_EQ(lan9646_mib_init(&g_mib, &g_dev, MIB_PORTS, true), lan9646OK);
+    for (port = 1; port <= LAN9646_MIB_PORTS; port++) {
+        for (i = 0; i < LAN9646_MIB_COUNTERS; i++) {
+            g_mib.port[port - 1U].cnt[i] = ((uint64_t)port << 40) | ((uint64_t)i << 8) | port;
+        }
+    }
+
+    regs = lan9646_model_regs();
+    for (a = 0; a < 0x10000UL; a++) {
+        if (a != LAN9646_REG_CHIP_ID1 && a != LAN9646_REG_CHIP_ID2) {
+            regs[a] = SNAP_PATTERN(a);
+        }
+    }
+    g_clear_reads = 0;
+    lan9646_model_clear_stats();
+}
+
+static lan9646r_t prv_capture(uint16_t* len) {
+    lan9646_snap_cfg_t cfg = {
+        .mib = &g_mib,
+        .vlan = &g_vlan,
+        .time_ms = SNAP_TIME_MS,
+    };
+
+    cfg.ranges = lan9646_snap_default_ranges(&cfg.range_count);
+    return lan9646_snap_capture(&g_dev, &cfg, g_blob, sizeof(g_blob), len);
+}
+
+static uint16_t prv_le16(const uint8_t* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t prv_le32(const uint8_t* p) {
+    return prv_le16(p) | ((uint32_t)prv_le16(&p[2]) << 16);
+}
+
+static int prv_save(const char* dir, const char* name, uint16_t len) {
+    char path[512];
+    FILE* f;
+    size_t n;
+
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    f = fopen(path, "wb");
+    if (f == NULL) return -1;
+    n = fwrite(g_blob, 1, len, f);
+    fclose(f);
+    return (n == len) ? 0 : -1;
+}
+
+/*===========================================================================*/
+/*                              TESTS                                         */
+/*===========================================================================*/
+
+static void prv_test_layout(void) {
+    const lan9646_snap_range_t* rg;
+    uint16_t len, off, rec, exp_len, exp_recs, k;
+    uint8_t count, i, port, ports;
+    bool pattern_ok = true;
+
+    /* The default ranges stay clear of the clear-on-read PHY registers */
+    rg = lan9646_snap_default_ranges(&count);
+    exp_len = LAN9646_SNAP_HDR_LEN;
+    exp_recs = 0;
+    for (i = 0; i < count; i++) {
+        ports = 0;
+        for (port = 0; port < 7U; port++) {
+            ports = (uint8_t)(ports + ((rg[i].ports >> port) & 1U));
+        }
+        ports = (rg[i].ports == 0) ? 1U : ports;
+        exp_len = (uint16_t)(exp_len + ports * (LAN9646_SNAP_REC_HDR_LEN + rg[i].len));
+        exp_recs = (uint16_t)(exp_recs + ports);
+        if (rg[i].ports != 0 && rg[i].addr >= LAN9646_PHY_WINDOW_FIRST
+            && rg[i].addr < LAN9646_PHY_WINDOW_FIRST + LAN9646_PHY_WINDOW_LEN) {
+            CHECK(!prv_overlaps(rg[i].addr, rg[i].len, 0x0102));
+            CHECK(!prv_overlaps(rg[i].addr, rg[i].len, 0x010C));
+            CHECK(!prv_overlaps(rg[i].addr, rg[i].len, 0x0114));
+        }
+    }
+    /* Six MIB records, one VLAN record of two VIDs */
+    exp_len = (uint16_t)(exp_len + 6U * (LAN9646_SNAP_REC_HDR_LEN + LAN9646_MIB_COUNTERS * 8U)
+                         + LAN9646_SNAP_REC_HDR_LEN + 2U * LAN9646_SNAP_VLAN_LEN);
+    exp_recs = (uint16_t)(exp_recs + 6U + 1U);
+
+    prv_setup();
+    CHECK_EQ(prv_capture(&len), lan9646OK);
+    printf("  %u ranges: %u bytes, %u records, %lu reads, %.2f ms on the bus\n", count, len,
+           prv_le16(&g_blob[6]), (unsigned long)lan9646_model_stats()->reads,
+           (double)lan9646_model_bus_ns(LAN9646_MODEL_I2C_HZ) / 1e6);
+    CHECK_EQ(g_clear_reads, 0);
+    CHECK_EQ(len, exp_len);
+    CHECK(len <= SNAP_SIZE);
+
+    /* Header */
+    CHECK_EQ(prv_le32(&g_blob[0]), LAN9646_SNAP_MAGIC);
+    CHECK_EQ(g_blob[4], LAN9646_SNAP_VERSION);
+    CHECK_EQ(g_blob[5], 0);
+    CHECK_EQ(prv_le16(&g_blob[6]), exp_recs);
+    CHECK_EQ(prv_le32(&g_blob[8]), len);
+    CHECK_EQ(prv_le32(&g_blob[12]), SNAP_TIME_MS);
+    CHECK_EQ(prv_le16(&g_blob[16]), (LAN9646_CHIP_ID_MSB << 8) | LAN9646_CHIP_ID_LSB);
+
+    /* Register records hold the device bytes; walk to the end */
+    off = LAN9646_SNAP_HDR_LEN;
+    for (rec = 0; rec < exp_recs && off < len; rec++) {
+        uint16_t addr = prv_le16(&g_blob[off + 2U]), n = prv_le16(&g_blob[off + 4U]);
+
+        if (g_blob[off] == LAN9646_SNAP_REC_REGS) {
+            for (k = 0; k < n; k++) {
+                uint16_t a = (uint16_t)(addr + k);
+
+                if (a != LAN9646_REG_CHIP_ID1 && a != LAN9646_REG_CHIP_ID2
+                    && g_blob[off + LAN9646_SNAP_REC_HDR_LEN + k] != SNAP_PATTERN(a)) {
+                    pattern_ok = false;
+                }
+            }
+        }
+        off = (uint16_t)(off + LAN9646_SNAP_REC_HDR_LEN + n);
+    }
+    CHECK(pattern_ok);
+    CHECK_EQ(rec, exp_recs);
+    CHECK_EQ(off, len);
+}
+
+static int prv_write_pair(const char* dir) {
+    static const lan9646_vlan_entry_t moved = {100, 0x23, 0x01, 1};
+    uint16_t len;
+
+    prv_setup();
+    CHECK_EQ(prv_capture(&len), lan9646OK);
+    if (prv_save(dir, "before.snap", len) != 0) return -1;
+
+    /* Port 2 joins port 7, 5 more RX high-priority bytes on port 1, VID 100 gains port 2 */
+    lan9646_model_set(LAN9646_REG_PORT_MEMBERSHIP(2) + 3U, 1, 0x4D);
+    g_mib.port[0].cnt[0] += 5U;
+    CHECK_EQ(lan9646_vlan_add(&g_vlan, &moved), lan9646OK);
+    CHECK_EQ(prv_capture(&len), lan9646OK);
+    return prv_save(dir, "after.snap", len);
+}
+
+int main(int argc, char** argv) {
+    prv_test_layout();
+    if (argc > 1) {
+        CHECK_EQ(prv_write_pair(argv[1]), 0);
+    }
+    return test_done("test_lan9646_snap");
+}
@@ -0,0 +1,367 @@
+/**
+ * \file            test_lan9646_spi.c
+ * \brief           LAN9646 SPI framing against a mocked SPI transfer
+ *
+ * The mocked transfer is wire level: every byte the driver clocks out
+ * goes through a KSZ SPI slave that decodes the 32-bit command word
+ * (3-bit opcode, 24-bit address, 5 turnaround bits), then reads or
+ * writes its register space with the address auto-incrementing until
+ * chip select rises. Both transports are run on it:
+ *  - frame_fn, the way main.c hands one frame to lpspi_xfer(): header
+ *    with the receiver masked, then the payload in the same frame, tx
+ *    NULL for reads (zeros clocked out) and rx NULL for writes;
+ *  - the cs_low / transfer / write / cs_high callbacks.
+ *
+ * The same register sequence also runs over I2C on the register model;
+ * the two register images must match. Bus time is printed for I2C at
+ * 100 kHz and SPI at main.c's 20 MHz SCK.
+ */
+
+#include "lan9646.h"
+#include "lan9646_model.h"
+#include "test_util.h"
+#include <stdio.h>
+#include <string.h>
+
+#define SPI_SCK_HZ                  20000000UL  /* main.c: LAN9646_SPI_SCK_HZ */
+#define SPI_REGS                    0x10000UL
+#define FRAMES_MAX                  64U
+
+/*===========================================================================*/
+/*                          MOCKED SPI SLAVE                                  */
+/*===========================================================================*/
+
+typedef struct {
+    uint8_t op;
+    uint32_t addr;
+    uint16_t len;               /*!< Data bytes after the command word */
+} frame_t;
+
+static uint8_t g_regs[SPI_REGS];
+static bool g_cs;               /* Chip select asserted */
+static uint8_t g_cmd[LAN9646_SPI_CMD_LEN];
+static uint8_t g_cmd_n;
+static uint32_t g_addr;
+static frame_t g_frames[FRAMES_MAX];
+static uint32_t g_frame_n;
+static uint64_t g_bits;
+static uint32_t g_errors;       /* Bad opcode, turnaround bits, address range, CS misuse */
+static uint32_t g_calls;        /* Transport callbacks, for fault injection */
+static uint32_t g_fail_call;    /* 1-based callback number that fails, 0 = none */
+
+static void prv_cs_low(void) {
+    if (g_cs) g_errors++;
+    g_cs = true;
+    g_cmd_n = 0;
+}
+
+static void prv_cs_high(void) {
+    if (!g_cs) g_errors++;
+    g_cs = false;
+    if (g_cmd_n == LAN9646_SPI_CMD_LEN) {
+        g_frame_n++;
+    }
+}
+
+/**
+ * \brief           One byte on the wire: MOSI in, MISO out
+ */
+static uint8_t prv_clock(uint8_t mosi) {
+    uint32_t w;
+    frame_t* f;
+    uint8_t miso = 0;
+
+    if (!g_cs) {
+        g_errors++;
+        return 0;
+    }
+    g_bits += 8U;
+    if (g_cmd_n < LAN9646_SPI_CMD_LEN) {
+        g_cmd[g_cmd_n++] = mosi;
+        if (g_cmd_n == LAN9646_SPI_CMD_LEN && g_frame_n < FRAMES_MAX) {
+            w = ((uint32_t)g_cmd[0] << 24) | ((uint32_t)g_cmd[1] << 16)
+                | ((uint32_t)g_cmd[2] << 8) | g_cmd[3];
+            f = &g_frames[g_frame_n];
+            f->op = (uint8_t)(w >> 29);
+            f->addr = (w >> 5) & 0xFFFFFFUL;
+            f->len = 0;
+            g_addr = f->addr;
+            if ((f->op != LAN9646_SPI_CMD_READ && f->op != LAN9646_SPI_CMD_WRITE)
+                || (w & 0x1FU) != 0) {
+                g_errors++;
+            }
+        }
+        return 0;
+    }
+
+    f = &g_frames[g_frame_n];
+    if (g_addr >= SPI_REGS) {
+        g_errors++;
+    } else if (f->op == LAN9646_SPI_CMD_READ) {
+        miso = g_regs[g_addr];
+    } else {
+        g_regs[g_addr] = mosi;
+    }
+    g_addr++;
+    f->len++;
+    return miso;
+}
+
+static bool prv_fail(void) {
+    return ++g_calls == g_fail_call;
+}
+
+static lan9646r_t prv_init(void) {
+    return lan9646OK;
+}
+
+/* main.c spi_frame_cb -> lpspi_xfer(): one frame, header RX masked */
+static lan9646r_t prv_frame(const uint8_t* cmd, uint8_t cmd_len, const uint8_t* tx, uint8_t* rx,
+                            uint16_t len) {
+    uint16_t i;
+
+    if (prv_fail()) return lan9646BUSERR;
+    /* lpspi_xfer() takes at most LPSPI_HDR_MAX header bytes */
+    CHECK_EQ(cmd_len, LAN9646_SPI_CMD_LEN);
+    CHECK(tx == NULL || rx == NULL);
+
+    prv_cs_low();
+    for (i = 0; i < cmd_len; i++) {
+        (void)prv_clock(cmd[i]);
+    }
+    for (i = 0; i < len; i++) {
+        uint8_t miso = prv_clock(tx != NULL ? tx[i] : 0U);
+        if (rx != NULL) rx[i] = miso;
+    }
+    prv_cs_high();
+    return lan9646OK;
+}
+
+static lan9646r_t prv_transfer(const uint8_t* tx, uint8_t* rx, uint16_t len) {
+    uint16_t i;
+
+    if (prv_fail()) return lan9646BUSERR;
+    for (i = 0; i < len; i++) {
+        uint8_t miso = prv_clock(tx != NULL ? tx[i] : 0U);
+        if (rx != NULL) rx[i] = miso;
+    }
+    return lan9646OK;
+}
+
+static lan9646r_t prv_write(const uint8_t* data, uint16_t len) {
+    return prv_transfer(data, NULL, len);
+}
+
+static lan9646r_t prv_read(uint8_t* data, uint16_t len) {
+    return prv_transfer(NULL, data, len);
+}
+
+static void prv_reset(void) {
+    memset(g_regs, 0, sizeof(g_regs));
+    g_regs[LAN9646_REG_CHIP_ID1] = 0x94;
+    g_regs[LAN9646_REG_CHIP_ID2] = 0x77;
+    g_cs = false;
+    g_frame_n = 0;
+    g_bits = 0;
+    g_errors = 0;
+    g_calls = 0;
+    g_fail_call = 0;
+}
+
+static lan9646r_t prv_attach(lan9646_t* dev, bool frame) {
+    lan9646_cfg_t cfg;
+
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.if_type = LAN9646_IF_SPI;
+    cfg.ops.spi.init_fn = prv_init;
+    if (frame) {
+        cfg.ops.spi.frame_fn = prv_frame;
+    } else {
+        cfg.ops.spi.write_fn = prv_write;
+        cfg.ops.spi.read_fn = prv_read;
+        cfg.ops.spi.transfer_fn = prv_transfer;
+        cfg.ops.spi.cs_low_fn = prv_cs_low;
+        cfg.ops.spi.cs_high_fn = prv_cs_high;
+    }
+    return lan9646_init(dev, &cfg);
+}
+
+/*===========================================================================*/
+/*                              TESTS                                         */
+/*===========================================================================*/
+
+static void prv_test_command_word(void) {
+    lan9646_t dev;
+    uint8_t v8;
+    uint16_t id;
+
+    /* Hand-encoded command words */
+    CHECK_EQ(LAN9646_SPI_CMD(LAN9646_SPI_CMD_READ, 0x0000), 0x60000000UL);
+    CHECK_EQ(LAN9646_SPI_CMD(LAN9646_SPI_CMD_WRITE, 0x1234), 0x40024680UL);
+    CHECK_EQ(LAN9646_SPI_CMD(LAN9646_SPI_CMD_READ, 0x6A04), 0x600D4080UL);
+    CHECK_EQ(LAN9646_SPI_CMD(LAN9646_SPI_CMD_WRITE, 0xFFFF), 0x401FFFE0UL);
+
+    /* Chip ID: one frame per byte register, read opcode, no write */
+    prv_reset();
+    CHECK_EQ(prv_attach(&dev, true), lan9646OK);
+    CHECK_EQ(lan9646_get_chip_id(&dev, &id, NULL), lan9646OK);
+    CHECK_EQ(id, 0x9477);
+    CHECK_EQ(g_frame_n, 2);
+    CHECK_EQ(g_frames[0].op, LAN9646_SPI_CMD_READ);
+    CHECK_EQ(g_frames[0].addr, LAN9646_REG_CHIP_ID1);
+    CHECK_EQ(g_frames[0].len, 1);
+    CHECK_EQ(g_frames[1].addr, LAN9646_REG_CHIP_ID2);
+    CHECK_EQ(g_bits, 2U * 8U * (LAN9646_SPI_CMD_LEN + 1U));
+
+    /* Write then read back: opcode, address and length of each frame */
+    CHECK_EQ(lan9646_write_reg8(&dev, 0x0300, 0x01), lan9646OK);
+    CHECK_EQ(g_frames[2].op, LAN9646_SPI_CMD_WRITE);
+    CHECK_EQ(g_frames[2].addr, 0x0300);
+    CHECK_EQ(g_frames[2].len, 1);
+    CHECK_EQ(g_regs[0x0300], 0x01);
+    CHECK_EQ(lan9646_read_reg8(&dev, 0x0300, &v8), lan9646OK);
+    CHECK_EQ(v8, 0x01);
+    CHECK_EQ(g_frames[3].op, LAN9646_SPI_CMD_READ);
+    CHECK_EQ(g_errors, 0);
+    CHECK(!g_cs);
+}
+
+static void prv_test_widths(bool frame) {
+    lan9646_t dev;
+    uint8_t burst[96], back[96];
+    uint32_t v32, i;
+    uint16_t v16;
+
+    prv_reset();
+    CHECK_EQ(prv_attach(&dev, frame), lan9646OK);
+
+    /* Big-endian on the wire, one frame per access */
+    CHECK_EQ(lan9646_write_reg16(&dev, 0x6100, 0x1140), lan9646OK);
+    CHECK_EQ(g_regs[0x6100], 0x11);
+    CHECK_EQ(g_regs[0x6101], 0x40);
+    CHECK_EQ(lan9646_write_reg32(&dev, 0x6A04, 0x0000004FUL), lan9646OK);
+    CHECK_EQ(g_regs[0x6A07], 0x4F);
+    CHECK_EQ(lan9646_read_reg16(&dev, 0x6100, &v16), lan9646OK);
+    CHECK_EQ(v16, 0x1140);
+    CHECK_EQ(lan9646_read_reg32(&dev, 0x6A04, &v32), lan9646OK);
+    CHECK_EQ(v32, 0x4F);
+    CHECK_EQ(g_frame_n, 4);
+    CHECK_EQ(g_frames[1].len, 4);
+    CHECK_EQ(g_frames[3].len, 4);
+
+    /* A burst is one frame; the address auto-increments across it */
+    for (i = 0; i < sizeof(burst); i++) {
+        burst[i] = (uint8_t)(0xA0U + i);
+    }
+    CHECK_EQ(lan9646_write_burst(&dev, 0x0500, burst, sizeof(burst)), lan9646OK);
+    CHECK_EQ(lan9646_read_burst(&dev, 0x0500, back, sizeof(back)), lan9646OK);
+    CHECK_EQ(memcmp(back, burst, sizeof(burst)), 0);
+    CHECK_EQ(memcmp(&g_regs[0x0500], burst, sizeof(burst)), 0);
+    CHECK_EQ(g_frame_n, 6);
+    CHECK_EQ(g_frames[4].addr, 0x0500);
+    CHECK_EQ(g_frames[4].len, sizeof(burst));
+    CHECK_EQ(g_frames[5].op, LAN9646_SPI_CMD_READ);
+    CHECK_EQ(g_frames[5].len, sizeof(back));
+
+    CHECK_EQ(g_errors, 0);
+    CHECK(!g_cs);
+}
+
+static void prv_test_errors(void) {
+    lan9646_t dev;
+    lan9646_cfg_t cfg;
+    uint32_t v32, n;
+
+    /* Frame transport: the error comes back, nothing is stored */
+    prv_reset();
+    CHECK_EQ(prv_attach(&dev, true), lan9646OK);
+    g_fail_call = 1;
+    CHECK_EQ(lan9646_write_reg32(&dev, 0x0400, 0x12345678UL), lan9646BUSERR);
+    CHECK_EQ(g_regs[0x0403], 0);
+    CHECK_EQ(g_frame_n, 0);
+
+    /* Split transport: CS rises on a failed command or payload, and every
+     * CS low has its CS high */
+    for (n = 1; n <= 2; n++) {
+        prv_reset();
+        CHECK_EQ(prv_attach(&dev, false), lan9646OK);
+        g_fail_call = n;
+        CHECK_EQ(lan9646_read_reg32(&dev, 0x0400, &v32), lan9646BUSERR);
+        CHECK(!g_cs);
+        g_calls = 0;
+        CHECK_EQ(lan9646_write_reg32(&dev, 0x0400, 0x12345678UL), lan9646BUSERR);
+        CHECK(!g_cs);
+        CHECK_EQ(g_errors, 0);
+    }
+
+    /* Split transport without its callbacks */
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.if_type = LAN9646_IF_SPI;
+    cfg.ops.spi.init_fn = prv_init;
+    cfg.ops.spi.write_fn = prv_write;
+    CHECK_EQ(lan9646_init(&dev, &cfg), lan9646OK);
+    CHECK_EQ(lan9646_write_reg8(&dev, 0x0300, 0x01), lan9646INVPARAM);
+    CHECK_EQ(lan9646_read_reg32(&dev, 0x0400, &v32), lan9646INVPARAM);
+    cfg.ops.spi.init_fn = NULL;
+    CHECK_EQ(lan9646_init(&dev, &cfg), lan9646INVPARAM);
+}
+
+/**
+ * \brief           The same sequence over I2C (model) and SPI (frame_fn)
+ */
+static void prv_sequence(lan9646_t* dev) {
+    static const uint16_t ports[] = {0x1A04, 0x2A04, 0x3A04, 0x4A04, 0x6A04};
+    uint8_t burst[32];
+    uint32_t i;
+
+    CHECK_EQ(lan9646_write_reg8(dev, 0x6300, 0x68), lan9646OK);
+    CHECK_EQ(lan9646_write_reg8(dev, 0x6301, 0x18), lan9646OK);
+    for (i = 0; i < sizeof(ports) / sizeof(ports[0]); i++) {
+        CHECK_EQ(lan9646_write_reg32(dev, ports[i], 0x60UL | (1UL << i)), lan9646OK);
+    }
+    CHECK_EQ(lan9646_modify_reg8(dev, 0x0300, 0x01, 0x01), lan9646OK);
+    CHECK_EQ(lan9646_modify_reg16(dev, 0x6100, 0x0800, 0x0800), lan9646OK);
+    for (i = 0; i < sizeof(burst); i++) {
+        burst[i] = (uint8_t)(i * 7U);
+    }
+    CHECK_EQ(lan9646_write_burst(dev, 0x0420, burst, sizeof(burst)), lan9646OK);
+}
+
+static void prv_test_against_i2c(void) {
+    lan9646_t i2c, spi;
+    uint64_t i2c_ns, spi_ns;
+
+    lan9646_model_reset();
+    CHECK_EQ(lan9646_model_attach(&i2c), lan9646OK);
+    lan9646_model_clear_stats();
+    prv_sequence(&i2c);
+    i2c_ns = lan9646_model_bus_ns(LAN9646_MODEL_I2C_HZ);
+
+    prv_reset();
+    CHECK_EQ(prv_attach(&spi, true), lan9646OK);
+    prv_sequence(&spi);
+    spi_ns = g_bits * 1000000000ULL / SPI_SCK_HZ;
+
+    CHECK_EQ(memcmp(lan9646_model_regs(), g_regs, SPI_REGS), 0);
+    CHECK_EQ(g_frame_n, lan9646_model_stats()->reads + lan9646_model_stats()->writes);
+    CHECK_EQ(g_errors, 0);
+    CHECK(spi_ns * 50U < i2c_ns);
+
+    printf("\n  Same register sequence, I2C model vs SPI frames\n");
+    printf("  %-18s %6s %8s %10s\n", "transport", "txn", "bits", "bus us");
+    printf("  %-18s %6u %8llu %10.1f\n", "I2C 100 kHz",
+           (unsigned)(lan9646_model_stats()->reads + lan9646_model_stats()->writes),
+           (unsigned long long)lan9646_model_stats()->bits, (double)i2c_ns / 1000.0);
+    printf("  %-18s %6u %8llu %10.1f\n", "SPI 20 MHz", (unsigned)g_frame_n,
+           (unsigned long long)g_bits, (double)spi_ns / 1000.0);
+}
+
+int main(void) {
+    prv_test_command_word();
+    prv_test_widths(true);
+    prv_test_widths(false);
+    prv_test_errors();
+    prv_test_against_i2c();
+
+    return test_done("test_lan9646_spi");
+}
@@ -0,0 +1,431 @@
+/**
+ * \file            test_lan9646_tgen.c
+ * \brief           Traffic generator: frame builder and checker against a simulated loopback
+ *
+ * The loopback stands in for the GMAC, the RGMII link and the remote MAC
+ * loopback of port 6. The MAC takes a frame only while it has a free
+ * descriptor and reads the buffer when the frame goes on the wire, not
+ * when it is handed over, so a buffer touched while owned shows up. The
+ * wire carries 1 Gbit/s including preamble, IFG and FCS, in 400 slices
+ * per millisecond. The switch counts each frame in the port MIB of the
+ * register model and returns it with the FCS, unless an impairment
+ * applies:
+ *      - loss:       frame dropped, counted as RX drop
+ *      - corruption: one payload byte flipped
+ *      - reordering: frame held back behind the next one
+ *      - stale:      the first frame of each size comes back once more
+ *                    stamped with the previous run
+ *
+ * Every frame leaving the MAC is decoded here independently of the driver
+ * (addresses, EtherType, test header, gap-free sequence, payload pattern
+ * with its own PRBS); the generator's results must match what the
+ * loopback did, per size.
+ */
+
+#include "lan9646.h"
+#include "lan9646_mib.h"
+#include "lan9646_traffic_test.h"
+#include "lan9646_model.h"
+#include "test_util.h"
+#include <stdio.h>
+#include <string.h>
+
+#define PORT                        6U
+#define RING                        16U
+#define STRIDE                      1536U
+#define DESCS                       16U         /* TX descriptors of the MAC */
+#define SLICES                      400U        /* Loop passes per ms */
+#define WIRE_BYTES_PER_MS           125000U     /* 1 Gbit/s */
+#define WIRE_OVERHEAD               24U         /* Preamble, SFD, IFG, FCS */
+#define FRAME_MAX                   1514U
+
+#define DROP_EVERY                  97U
+#define CORRUPT_EVERY               89U
+#define HOLD_EVERY                  101U
+
+static lan9646_t g_dev;
+static lan9646_mib_engine_t g_mib;
+static lan9646_tgen_t g_gen;
+
+static const uint8_t g_mac[6] = {0x02, 0x00, 0x00, 0x00, 0x00, 0x01};
+static const uint16_t g_sizes[] = {64, 512, 1518};
+static uint8_t g_ring[RING * STRIDE];
+
+/* What the loopback did per size, to compare with the generator's results */
+typedef struct {
+    uint32_t sent;              /* Frames that left the MAC */
+    uint32_t delivered;         /* Frames handed back intact */
+    uint32_t dropped;
+    uint32_t corrupted;
+    uint32_t reordered;         /* Handed back after a later one */
+    uint32_t stale;
+    uint32_t hdr_errors;        /* Frames that left the MAC wrong */
+    uint32_t next_seq;
+    uint32_t max_seq;
+    bool any;
+} sim_step_t;
+
+static struct {
+    uint8_t* dma[DESCS];        /* Owned by the MAC, in send order */
+    uint16_t dma_len[DESCS];
+    uint8_t head, count;
+    uint32_t budget;            /* Wire bytes that may go out */
+    uint32_t frames;            /* Frame index for the impairment pattern */
+    bool impair;
+    bool held;
+    uint8_t held_buf[FRAME_MAX];
+    uint16_t held_len;
+    uint8_t held_step;
+    uint32_t held_seq;
+    sim_step_t step[LAN9646_TGEN_SIZES_MAX];
+} g_sim;
+
+/*===========================================================================*/
+/*                          LOOPBACK MODEL                                    */
+/*===========================================================================*/
+
+static bool prv_send(uint8_t* frame, uint16_t len, void* arg) {
+    uint8_t slot;
+
+    (void)arg;
+    if (g_sim.count >= DESCS) return false;
+
+    slot = (uint8_t)((g_sim.head + g_sim.count) % DESCS);
+    g_sim.dma[slot] = frame;
+    g_sim.dma_len[slot] = len;
+    g_sim.count++;
+    return true;
+}
+
+static uint16_t prv_be16(const uint8_t* p) {
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static uint32_t prv_be32(const uint8_t* p) {
+    return ((uint32_t)prv_be16(p) << 16) | prv_be16(&p[2]);
+}
+
+static void prv_mib_add(uint8_t index, uint32_t n) {
+    lan9646_model_set_mib(PORT, index, lan9646_model_get_mib(PORT, index) + n);
+}
+
+/**
+ * \brief           Check a frame leaving the MAC against the documented layout
+ */
+static bool prv_check_tx(const uint8_t* f, uint16_t len, sim_step_t* st) {
+    const uint8_t* p = &f[14];
+    uint16_t size = prv_be16(&p[8]);
+    uint8_t lfsr = 0xFFU, want;
+    uint16_t i;
+
+    if (memcmp(f, g_mac, 6) != 0 || memcmp(&f[6], g_mac, 6) != 0
+        || prv_be16(&f[12]) != LAN9646_TGEN_ETHERTYPE || prv_be16(&p[0]) != g_gen.run
+        || p[3] != (uint8_t)g_gen.cfg.pattern || size != len + 4U || prv_be16(&p[10]) != 0
+        || prv_be32(&p[4]) != st->next_seq) {
+        return false;
+    }
+    for (i = 0; i < len - 14U - LAN9646_TGEN_HDR_LEN; i++) {
+        switch (g_gen.cfg.pattern) {
+            case LAN9646_TGEN_PAT_ALT:
+                want = (i & 1U) ? 0xAAU : 0x55U;
+                break;
+            case LAN9646_TGEN_PAT_PRBS:
+                lfsr = (uint8_t)((lfsr & 1U) ? ((lfsr >> 1) ^ 0xB8U) : (lfsr >> 1));
+                want = lfsr;
+                break;
+            default:
+                want = (uint8_t)i;
+                break;
+        }
+        if (p[LAN9646_TGEN_HDR_LEN + i] != want) return false;
+    }
+    return true;
+}
+
+/**
+ * \brief           Hand a frame back
+ * \param[in]       seen: The checker takes its sequence number (not corrupted,
+ *                  or the payload is not checked)
+ */
+static void prv_deliver(uint8_t* f, uint16_t len, uint8_t step, uint32_t seq, bool seen) {
+    sim_step_t* st = &g_sim.step[step];
+
+    if (seen) {
+        if (st->any && seq < st->max_seq) {
+            st->reordered++;
+        }
+        if (!st->any || seq > st->max_seq) {
+            st->max_seq = seq;
+        }
+        st->any = true;
+    }
+    prv_mib_add(LAN9646_MIB_TX_UNICAST, 1);
+    /* The FCS is still on the frame */
+    lan9646_tgen_rx(&g_gen, &f[14], (uint16_t)(len - 14U + 4U));
+}
+
+static void prv_loop(uint8_t* f, uint16_t len) {
+    uint8_t copy[FRAME_MAX];
+    uint8_t step = f[14 + 2];
+    sim_step_t* st = &g_sim.step[step];
+    uint32_t seq = prv_be32(&f[14 + 4]);
+    uint32_t k = g_sim.frames++;
+    bool seen = true;
+
+    if (!prv_check_tx(f, len, st)) {
+        st->hdr_errors++;
+    }
+    st->next_seq = seq + 1U;
+    st->sent++;
+    prv_mib_add(LAN9646_MIB_RX_UNICAST, 1);
+
+    /* The switch has its own copy, the buffer goes back to the generator */
+    memcpy(copy, f, len);
+    lan9646_tgen_tx_done(&g_gen, f);
+
+    if (seq == 0U) {
+        /* A late frame of an earlier run */
+        uint8_t old[FRAME_MAX];
+
+        memcpy(old, copy, len);
+        old[14] = (uint8_t)((g_gen.run - 1U) >> 8);
+        old[15] = (uint8_t)(g_gen.run - 1U);
+        st->stale++;
+        prv_mib_add(LAN9646_MIB_TX_UNICAST, 1);
+        lan9646_tgen_rx(&g_gen, &old[14], (uint16_t)(len - 14U + 4U));
+    }
+
+    if (g_sim.impair && k % DROP_EVERY == DROP_EVERY - 1U) {
+        st->dropped++;
+        prv_mib_add(LAN9646_MIB_RX_DROP, 1);
+        return;
+    }
+    if (g_sim.impair && k % CORRUPT_EVERY == CORRUPT_EVERY - 1U) {
+        copy[len - 1U] ^= 0x10U;
+        st->corrupted++;
+        seen = !g_gen.cfg.verify;
+    } else {
+        st->delivered++;
+    }
+    if (g_sim.impair && seen && !g_sim.held && k % HOLD_EVERY == HOLD_EVERY - 1U) {
+        memcpy(g_sim.held_buf, copy, len);
+        g_sim.held_len = len;
+        g_sim.held_step = step;
+        g_sim.held_seq = seq;
+        g_sim.held = true;
+        return;
+    }
+    prv_deliver(copy, len, step, seq, seen);
+    if (g_sim.held) {
+        g_sim.held = false;
+        prv_deliver(g_sim.held_buf, g_sim.held_len, g_sim.held_step, g_sim.held_seq, true);
+    }
+}
+
+/**
+ * \brief           One slice of wire time: frames whose turn it is leave the MAC
+ */
+static void prv_wire(void) {
+    uint16_t cost;
+    uint8_t* f;
+
+    g_sim.budget += WIRE_BYTES_PER_MS / SLICES;
+    while (g_sim.count > 0U) {
+        cost = (uint16_t)(g_sim.dma_len[g_sim.head] + WIRE_OVERHEAD);
+        if (g_sim.budget < cost) break;
+        g_sim.budget -= cost;
+        f = g_sim.dma[g_sim.head];
+        g_sim.head = (uint8_t)((g_sim.head + 1U) % DESCS);
+        g_sim.count--;
+        prv_loop(f, (uint16_t)(cost - WIRE_OVERHEAD));
+    }
+    if (g_sim.count == 0U) {
+        /* Link idle: no credit builds up */
+        g_sim.budget = 0;
+        if (g_sim.held) {
+            g_sim.held = false;
+            prv_deliver(g_sim.held_buf, g_sim.held_len, g_sim.held_step, g_sim.held_seq, true);
+        }
+    }
+}
+
+/*===========================================================================*/
+/*                              TESTS                                         */
+/*===========================================================================*/
+
+static void prv_setup(void) {
+    lan9646_model_reset();
+    CHECK_EQ(lan9646_model_attach(&g_dev), lan9646OK);
+    CHECK_EQ(lan9646_mib_init(&g_mib, &g_dev, 1U << PORT, true), lan9646OK);
+    memset(&g_sim, 0, sizeof(g_sim));
+}
+
+static lan9646_tgen_cfg_t prv_cfg(lan9646_tgen_pattern_t pattern, bool verify) {
+    lan9646_tgen_cfg_t cfg = {
+        .dev = &g_dev,
+        .mib = &g_mib,
+        .port = PORT,
+        .mac = g_mac,
+        .ring = g_ring,
+        .ring_len = RING,
+        .stride = STRIDE,
+        .sizes = g_sizes,
+        .size_count = (uint8_t)(sizeof(g_sizes) / sizeof(g_sizes[0])),
+        .duration_ms = 20,
+        .drain_ms = 2,
+        .link_mbps = 1000,
+        .send_fn = prv_send,
+    };
+
+    cfg.pattern = pattern;
+    cfg.verify = verify;
+    return cfg;
+}
+
+/**
+ * \brief           Run to the end
+ * \return          Simulated ms
+ */
+static uint32_t prv_run(const lan9646_tgen_cfg_t* cfg) {
+    uint32_t now = 1000, slice = 0;
+
+    CHECK_EQ(lan9646_tgen_start(&g_gen, cfg, now), lan9646OK);
+    CHECK_EQ(lan9646_model_get(0x6020, 1) & 0x40U, 0x40U);     /* Remote MAC loopback */
+    while (lan9646_tgen_poll(&g_gen, now) && now < 2000U) {
+        prv_wire();
+        if (++slice == SLICES) {
+            slice = 0;
+            now++;
+        }
+    }
+    CHECK(!lan9646_tgen_running(&g_gen));
+    CHECK_EQ(lan9646_model_get(0x6020, 1) & 0x40U, 0);
+    return now - 1000U;
+}
+
+static void prv_test_clean(void) {
+    lan9646_tgen_cfg_t cfg = prv_cfg(LAN9646_TGEN_PAT_ALT, true);
+    const lan9646_tgen_result_t* r;
+    uint8_t count, i;
+    uint32_t ms;
+
+    prv_setup();
+    lan9646_model_set(0x6020, 1, 0x83);         /* Other bits are kept */
+    ms = prv_run(&cfg);
+    CHECK_EQ(lan9646_model_get(0x6020, 1), 0x83);
+
+    r = lan9646_tgen_results(&g_gen, &count);
+    CHECK_EQ(count, 3);
+    for (i = 0; i < count; i++, r++) {
+        const sim_step_t* st = &g_sim.step[i];
+
+        printf("  clean %4u bytes: %lu pps (%u.%u %% of line), %lu Mbps, %lu frames\n", r->size,
+               (unsigned long)r->rx_pps, r->line_pct / 10U, r->line_pct % 10U,
+               (unsigned long)(r->rx_kbps / 1000U), (unsigned long)r->rx);
+        CHECK_EQ(r->size, g_sizes[i]);
+        CHECK_EQ(st->hdr_errors, 0);
+        CHECK_EQ(r->tx, st->sent);
+        CHECK_EQ(r->rx, st->sent);
+        CHECK_EQ(r->lost, 0);
+        CHECK_EQ(r->bad, 0);
+        CHECK_EQ(r->reordered, 0);
+        CHECK_EQ(r->stale, 1);
+        CHECK_EQ(r->elapsed_ms, 20);
+        /* The ring keeps the wire busy */
+        CHECK(r->line_pct >= 990U && r->line_pct <= 1010U);
+        CHECK_EQ(r->mib_rx, st->sent);
+        CHECK_EQ(r->mib_tx, st->sent + 1U);
+        CHECK_EQ(r->mib_rx_drop, 0);
+    }
+    CHECK(ms < 3U * 30U);
+}
+
+static void prv_test_impaired(void) {
+    lan9646_tgen_cfg_t cfg = prv_cfg(LAN9646_TGEN_PAT_PRBS, true);
+    const lan9646_tgen_result_t* r;
+    uint8_t count, i;
+
+    prv_setup();
+    g_sim.impair = true;
+    prv_run(&cfg);
+
+    r = lan9646_tgen_results(&g_gen, &count);
+    CHECK_EQ(count, 3);
+    for (i = 0; i < count; i++, r++) {
+        const sim_step_t* st = &g_sim.step[i];
+
+        printf("  impaired %4u bytes: tx %lu rx %lu lost %lu (dropped %lu, corrupted %lu), "
+               "reordered %lu, bad %lu, stale %lu\n", r->size, (unsigned long)r->tx,
+               (unsigned long)r->rx, (unsigned long)r->lost, (unsigned long)st->dropped,
+               (unsigned long)st->corrupted, (unsigned long)r->reordered, (unsigned long)r->bad,
+               (unsigned long)r->stale);
+        CHECK_EQ(st->hdr_errors, 0);
+        CHECK(st->dropped > 0U && st->corrupted > 0U && st->reordered > 0U);
+        CHECK_EQ(r->tx, st->sent);
+        CHECK_EQ(r->rx, st->delivered);
+        CHECK_EQ(r->lost, st->dropped + st->corrupted);
+        CHECK_EQ(r->bad, st->corrupted);
+        CHECK_EQ(r->reordered, st->reordered);
+        CHECK_EQ(r->stale, st->stale);
+        CHECK_EQ(r->mib_rx, st->sent);
+        CHECK_EQ(r->mib_rx_drop, st->dropped);
+        CHECK_EQ(r->mib_tx, st->sent - st->dropped + st->stale);
+    }
+}
+
+static void prv_test_header_only(void) {
+    lan9646_tgen_cfg_t cfg = prv_cfg(LAN9646_TGEN_PAT_INCR, false);
+    const lan9646_tgen_result_t* r;
+    uint8_t count, i;
+
+    /* Without payload checks a flipped payload byte goes unnoticed */
+    prv_setup();
+    g_sim.impair = true;
+    prv_run(&cfg);
+
+    r = lan9646_tgen_results(&g_gen, &count);
+    CHECK_EQ(count, 3);
+    for (i = 0; i < count; i++, r++) {
+        const sim_step_t* st = &g_sim.step[i];
+
+        CHECK_EQ(st->hdr_errors, 0);
+        CHECK_EQ(r->bad, 0);
+        CHECK_EQ(r->rx, st->delivered + st->corrupted);
+        CHECK_EQ(r->lost, st->dropped);
+    }
+}
+
+static void prv_test_setup_checks(void) {
+    static const uint16_t bad_size[] = {63};
+    lan9646_tgen_cfg_t cfg = prv_cfg(LAN9646_TGEN_PAT_INCR, true);
+    lan9646_tgen_t gen;
+    uint16_t big = 1518;
+
+    memset(&gen, 0, sizeof(gen));
+    prv_setup();
+    lan9646_model_clear_stats();
+
+    cfg.sizes = bad_size;
+    cfg.size_count = 1;
+    CHECK_EQ(lan9646_tgen_start(&gen, &cfg, 0), lan9646INVPARAM);
+    cfg.sizes = &big;
+    cfg.stride = 1513;                          /* One byte short of 1518 - 4 */
+    CHECK_EQ(lan9646_tgen_start(&gen, &cfg, 0), lan9646INVPARAM);
+    cfg.stride = STRIDE;
+    cfg.ring_len = LAN9646_TGEN_RING_MAX + 1U;
+    CHECK_EQ(lan9646_tgen_start(&gen, &cfg, 0), lan9646INVPARAM);
+    cfg.ring_len = RING;
+    CHECK_EQ(lan9646_model_stats()->reads + lan9646_model_stats()->writes, 0);
+
+    /* Only one run at a time */
+    CHECK_EQ(lan9646_tgen_start(&gen, &cfg, 0), lan9646OK);
+    CHECK_EQ(lan9646_tgen_start(&gen, &cfg, 0), lan9646ERR);
+}
+
+int main(void) {
+    prv_test_clean();
+    prv_test_impaired();
+    prv_test_header_only();
+    prv_test_setup_checks();
+    return test_done("test_lan9646_tgen");
+}
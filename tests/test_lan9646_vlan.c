@@ -0,0 +1,293 @@
+/**
+ * \file            test_lan9646_vlan.c
+ * \brief           VLAN table engine: 150 VIDs through the indirect access on the register model
+ *
+ * The hook emulates the VLAN table behind 0x040E: a write that reaches the
+ * control register with START set copies the entry registers (0x0400-0x040B)
+ * into the table at the VID in 0x040C, or the table entry into them; the
+ * clear action wipes the whole table. START can be held for a number of
+ * control reads to exercise polling.
+ *
+ * Before: lan9646_dump_vlan_table() read 32-bit words at 0x0480 + (vid-1)*4,
+ * there was no write path and port isolation was raw membership writes.
+ * After: lan9646_vlan_apply() writes each VID as one 15-byte burst and a
+ * control read, and lan9646_vlan_readback() visits only the VIDs written,
+ * compared here with a full-range lan9646_vlan_scan().
+ */
+
+#include "lan9646.h"
+#include "lan9646_vlan.h"
+#include "lan9646_model.h"
+#include "test_util.h"
+#include <stdio.h>
+#include <string.h>
+
+#define VIDS                        150U
+#define VID_FIRST                   10U
+#define VID_STEP                    27U
+
+static lan9646_t g_dev;
+static lan9646_vlan_t g_vlan;
+
+static uint8_t g_table[LAN9646_VLAN_VIDS][12];
+static uint32_t g_busy;                 /* Control reads with START still set */
+static uint32_t g_busy_left;
+static bool g_stuck;                    /* START never clears */
+
+static lan9646_vlan_entry_t g_vids[VIDS];
+
+/*===========================================================================*/
+/*                          TABLE MODEL                                       */
+/*===========================================================================*/
+
+static void prv_hook(uint16_t addr, uint16_t len, bool write) {
+    uint8_t* regs = lan9646_model_regs();
+    uint16_t vid;
+    uint8_t ctrl;
+
+    if (addr > LAN9646_REG_VLAN_CTRL || addr + len <= LAN9646_REG_VLAN_CTRL) return;
+
+    ctrl = regs[LAN9646_REG_VLAN_CTRL];
+    if (write && (ctrl & LAN9646_VLAN_START)) {
+        vid = (uint16_t)(lan9646_model_get(LAN9646_REG_VLAN_INDEX, 2) & LAN9646_VLAN_VID_MASK);
+        switch (ctrl & 0x03U) {
+            case LAN9646_VLAN_ACTION_WRITE:
+                memcpy(g_table[vid], &regs[LAN9646_REG_VLAN_ENTRY], 12);
+                break;
+            case LAN9646_VLAN_ACTION_READ:
+                memcpy(&regs[LAN9646_REG_VLAN_ENTRY], g_table[vid], 12);
+                break;
+            case LAN9646_VLAN_ACTION_CLEAR:
+                memset(g_table, 0, sizeof(g_table));
+                break;
+            default:
+                break;
+        }
+        g_busy_left = g_busy;
+    } else if (!write) {
+        if (g_busy_left > 0U || g_stuck) {
+            g_busy_left -= (g_busy_left > 0U) ? 1U : 0U;
+        } else {
+            regs[LAN9646_REG_VLAN_CTRL] &= (uint8_t)~LAN9646_VLAN_START;
+        }
+    }
+}
+
+static uint32_t prv_get_word(uint16_t vid, uint8_t w) {
+    const uint8_t* e = g_table[vid];
+
+    return ((uint32_t)e[4U * w] << 24) | ((uint32_t)e[4U * w + 1U] << 16)
+           | ((uint32_t)e[4U * w + 2U] << 8) | e[4U * w + 3U];
+}
+
+static void prv_setup(void) {
+    lan9646_model_reset();
+    CHECK_EQ(lan9646_model_attach(&g_dev), lan9646OK);
+    lan9646_model_set_hook(prv_hook);
+    memset(g_table, 0, sizeof(g_table));
+    g_busy = 0;
+    g_busy_left = 0;
+    g_stuck = false;
+    CHECK_EQ(lan9646_vlan_init(&g_vlan, &g_dev), lan9646OK);
+}
+
+static uint32_t prv_txn(void) {
+    return lan9646_model_stats()->reads + lan9646_model_stats()->writes;
+}
+
+static double prv_bus_ms(void) {
+    return (double)lan9646_model_bus_ns(LAN9646_MODEL_I2C_HZ) / 1e6;
+}
+
+/*===========================================================================*/
+/*                              TESTS                                         */
+/*===========================================================================*/
+
+static uint32_t g_seen;
+static uint32_t g_bad;
+static uint32_t g_stop_after;
+
+static bool prv_readback_cb(const lan9646_vlan_entry_t* e, void* arg) {
+    uint32_t i = (e->vid - VID_FIRST) / VID_STEP;
+
+    (void)arg;
+    g_seen++;
+    if (i >= VIDS || g_vids[i].vid != e->vid || g_vids[i].members != e->members
+        || g_vids[i].untag != e->untag || g_vids[i].fid != e->fid) {
+        g_bad++;
+    }
+    return g_stop_after == 0U || g_seen < g_stop_after;
+}
+
+static void prv_test_bulk(void) {
+    lan9646_vlan_entry_t e;
+    uint32_t n_apply;
+    uint32_t n_sparse;
+    uint32_t n_scan;
+    double ms_apply;
+    double ms_sparse;
+    double ms_scan;
+    uint16_t n;
+    uint32_t i;
+    bool valid;
+
+    for (i = 0; i < VIDS; i++) {
+        g_vids[i].vid = (uint16_t)(VID_FIRST + VID_STEP * i);
+        g_vids[i].members = (uint8_t)((i & 0x3FU) | 0x20U);
+        g_vids[i].untag = (uint8_t)(i & 0x0FU);
+        g_vids[i].fid = (uint8_t)(i & 0x7FU);
+    }
+
+    /* Two transactions per VID: 15-byte burst ending in START, control read */
+    prv_setup();
+    lan9646_model_clear_stats();
+    CHECK_EQ(lan9646_vlan_apply(&g_vlan, g_vids, VIDS), lan9646OK);
+    n_apply = prv_txn();
+    ms_apply = prv_bus_ms();
+    CHECK_EQ(n_apply, 2U * VIDS);
+    CHECK_EQ(lan9646_model_stats()->writes, VIDS);
+    CHECK_EQ(lan9646_model_stats()->write_bytes, 15U * VIDS);
+    CHECK_EQ(g_vlan.stats.writes, VIDS);
+    CHECK_EQ(g_vlan.stats.polls, 0);
+
+    /* Every VID landed in the table with the entry layout of the datasheet */
+    for (i = 0; i < VIDS; i++) {
+        CHECK_EQ(prv_get_word(g_vids[i].vid, 0), LAN9646_VLAN_VALID | g_vids[i].fid);
+        CHECK_EQ(prv_get_word(g_vids[i].vid, 1), g_vids[i].untag);
+        CHECK_EQ(prv_get_word(g_vids[i].vid, 2), g_vids[i].members);
+    }
+    CHECK_EQ(prv_get_word(1, 0), 0);
+
+    /* A single VID the way main.c sets up its control VLAN */
+    e.vid = 100;
+    e.members = 0x61;
+    e.untag = 0x01;
+    e.fid = 5;
+    CHECK_EQ(lan9646_vlan_add(&g_vlan, &e), lan9646OK);
+    CHECK_EQ(prv_get_word(100, 0), 0x80000005U);
+    CHECK_EQ(prv_get_word(100, 1), 0x00000001U);
+    CHECK_EQ(prv_get_word(100, 2), 0x00000061U);
+    CHECK_EQ(lan9646_vlan_remove(&g_vlan, 100), lan9646OK);
+    CHECK_EQ(prv_get_word(100, 0), 0);
+
+    /* Direct reads match */
+    CHECK_EQ(lan9646_vlan_read(&g_dev, g_vids[77].vid, &e, &valid), lan9646OK);
+    CHECK(valid);
+    CHECK_EQ(e.members, g_vids[77].members);
+    CHECK_EQ(e.untag, g_vids[77].untag);
+    CHECK_EQ(e.fid, g_vids[77].fid);
+    CHECK_EQ(lan9646_vlan_read(&g_dev, 2, &e, &valid), lan9646OK);
+    CHECK(!valid);
+
+    /* Sparse readback: only the VIDs written, two transactions each */
+    g_seen = 0;
+    g_bad = 0;
+    g_stop_after = 0;
+    lan9646_model_clear_stats();
+    CHECK_EQ(lan9646_vlan_readback(&g_vlan, prv_readback_cb, NULL, &n), lan9646OK);
+    n_sparse = prv_txn();
+    ms_sparse = prv_bus_ms();
+    CHECK_EQ(n, VIDS);
+    CHECK_EQ(g_seen, VIDS);
+    CHECK_EQ(g_bad, 0);
+    CHECK_EQ(n_sparse, 2U * VIDS);
+
+    /* The whole VID range, the only way without the used map */
+    g_seen = 0;
+    lan9646_model_clear_stats();
+    CHECK_EQ(lan9646_vlan_scan(&g_vlan, 1, LAN9646_VLAN_VID_MAX, prv_readback_cb, NULL, &n),
+             lan9646OK);
+    n_scan = prv_txn();
+    ms_scan = prv_bus_ms();
+    CHECK_EQ(n, VIDS);
+    CHECK_EQ(g_bad, 0);
+    CHECK_EQ(n_scan, 2U * LAN9646_VLAN_VID_MAX);
+
+    printf("%u VIDs, I2C at 100 kHz\n", VIDS);
+    printf("%-24s | %5s | %8s\n", "", "txn", "bus ms");
+    printf("%-24s | %5lu | %8.1f\n", "lan9646_vlan_apply", (unsigned long)n_apply, ms_apply);
+    printf("%-24s | %5lu | %8.1f\n", "lan9646_vlan_readback", (unsigned long)n_sparse, ms_sparse);
+    printf("%-24s | %5lu | %8.1f\n", "scan 1-4094", (unsigned long)n_scan, ms_scan);
+    CHECK(ms_sparse * 20.0 < ms_scan);
+
+    /* Removed and externally cleared VIDs drop out, early stop is honoured */
+    CHECK_EQ(lan9646_vlan_remove(&g_vlan, g_vids[5].vid), lan9646OK);
+    memset(g_table[g_vids[6].vid], 0, 12);
+    CHECK_EQ(lan9646_vlan_readback(&g_vlan, NULL, NULL, &n), lan9646OK);
+    CHECK_EQ(n, VIDS - 2U);
+    g_seen = 0;
+    g_stop_after = 10;
+    CHECK_EQ(lan9646_vlan_readback(&g_vlan, prv_readback_cb, NULL, &n), lan9646OK);
+    CHECK_EQ(n, 10);
+
+    /* A VID written by someone else is visited once tracked */
+    g_table[4000][0] = 0x80;
+    g_table[4000][11] = 0x40;
+    CHECK_EQ(lan9646_vlan_track(&g_vlan, 4000), lan9646OK);
+    CHECK_EQ(lan9646_vlan_readback(&g_vlan, NULL, NULL, &n), lan9646OK);
+    CHECK_EQ(n, VIDS - 1U);
+}
+
+static void prv_test_errors(void) {
+    lan9646_vlan_entry_t bad[3];
+    uint16_t n;
+
+    /* Slow access is polled, a stuck one times out and stops the table */
+    prv_setup();
+    g_busy = 2;
+    CHECK_EQ(lan9646_vlan_apply(&g_vlan, g_vids, 4), lan9646OK);
+    CHECK_EQ(g_vlan.stats.polls, 8);
+    CHECK_EQ(lan9646_vlan_readback(&g_vlan, NULL, NULL, &n), lan9646OK);
+    CHECK_EQ(n, 4);
+    CHECK_EQ(g_vlan.stats.polls, 16);
+    g_stuck = true;
+    CHECK_EQ(lan9646_vlan_apply(&g_vlan, &g_vids[4], 4), lan9646TIMEOUT);
+    CHECK_EQ(g_vlan.stats.writes, 5);
+    CHECK_EQ(g_vlan.stats.timeouts, 1);
+    g_stuck = false;
+
+    /* Reserved VIDs are refused before they reach the bus */
+    memcpy(bad, g_vids, sizeof(bad));
+    bad[1].vid = 0;
+    lan9646_model_clear_stats();
+    CHECK_EQ(lan9646_vlan_apply(&g_vlan, &bad[1], 1), lan9646INVPARAM);
+    bad[1].vid = 4095;
+    CHECK_EQ(lan9646_vlan_add(&g_vlan, &bad[1]), lan9646INVPARAM);
+    CHECK_EQ(lan9646_vlan_remove(&g_vlan, 0), lan9646INVPARAM);
+    CHECK_EQ(prv_txn(), 0);
+
+    /* Bus error */
+    lan9646_model_fail_next(1);
+    CHECK_EQ(lan9646_vlan_apply(&g_vlan, g_vids, VIDS), lan9646BUSERR);
+}
+
+static void prv_test_ports(void) {
+    prv_setup();
+    lan9646_model_set(LAN9646_REG_PORT_DEFAULT_TAG0(3), 2, 0xA001);
+    lan9646_model_set(LAN9646_REG_PORT_CTRL2(3), 1, 0x80);
+    lan9646_model_set(LAN9646_REG_LUE_CTRL0, 1, 0x08);
+
+    /* PVID keeps the priority bits */
+    CHECK_EQ(lan9646_vlan_set_pvid(&g_vlan, 3, 100), lan9646OK);
+    CHECK_EQ(lan9646_model_get(LAN9646_REG_PORT_DEFAULT_TAG0(3), 2), 0xA064);
+    CHECK_EQ(lan9646_vlan_set_pvid(&g_vlan, 5, 100), lan9646INVPARAM);
+    CHECK_EQ(lan9646_vlan_set_pvid(&g_vlan, 3, 4095), lan9646INVPARAM);
+
+    CHECK_EQ(lan9646_vlan_set_ingress_filter(&g_vlan, 3, true), lan9646OK);
+    CHECK_EQ(lan9646_model_get(LAN9646_REG_PORT_CTRL2(3), 1), 0xC0);
+    CHECK_EQ(lan9646_vlan_set_ingress_filter(&g_vlan, 3, false), lan9646OK);
+    CHECK_EQ(lan9646_model_get(LAN9646_REG_PORT_CTRL2(3), 1), 0x80);
+
+    CHECK_EQ(lan9646_vlan_enable(&g_vlan, true), lan9646OK);
+    CHECK_EQ(lan9646_model_get(LAN9646_REG_LUE_CTRL0, 1), 0x88);
+    CHECK_EQ(lan9646_vlan_enable(&g_vlan, false), lan9646OK);
+    CHECK_EQ(lan9646_model_get(LAN9646_REG_LUE_CTRL0, 1), 0x08);
+}
+
+int main(void) {
+    prv_test_bulk();
+    prv_test_errors();
+    prv_test_ports();
+
+    return test_done("test_lan9646_vlan");
+}
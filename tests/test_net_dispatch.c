@@ -0,0 +1,409 @@
+/**
+ * \file            test_net_dispatch.c
+ * \brief           pcap replay through net_dispatch(): routing and parse+dispatch cost per frame
+ *
+ * A mixed trace (ARP, ICMP with and without IP options or a VLAN tag, UDP
+ * to the register service and to unknown ports, the traffic generator
+ * EtherType, IPv6, LLDP, truncated and fragmented IPv4) is written as a
+ * pcap file, read back and replayed. Every frame must reach the handler
+ * the generator labelled it for.
+ *
+ * Before: the original process_rx_packet() switch on the EtherType and
+ * byte 23. After: net_dispatch() with the handlers main.c registers, then
+ * with every handler slot in use, to show the lookup does not grow.
+ *
+ * Usage: test_net_dispatch [capture.pcap] replays a real capture instead
+ * (costs and counters only, no labels).
+ */
+
+#include "net_dispatch.h"
+#include "pcap_util.h"
+#include "pkt_util.h"
+#include "test_util.h"
+#include <string.h>
+
+#define TRACE_FRAMES                4000U
+#define TRACE_FILE                  "net_dispatch_trace.pcap"
+#define REGSVC_PORT                 5002U       /* REGSVC_UDP_PORT */
+#define TGEN_ETHERTYPE              0x88B5U     /* LAN9646_TGEN_ETHERTYPE */
+
+enum {
+    CLS_MALFORMED = -2,
+    CLS_UNHANDLED = -1,
+    CLS_ARP = 0,
+    CLS_ICMP,
+    CLS_TGEN,
+    CLS_REGSVC,
+    CLS_EXTRA,                  /* Filler handlers for the full-table run */
+    CLS_COUNT
+};
+
+static const uint8_t g_our_mac[6] = {0x02, 0x00, 0x00, 0x00, 0x00, 0x01};
+static const uint8_t g_our_ip[4] = {192, 168, 1, 100};
+static const uint8_t g_peer_mac[6] = {0x00, 0x11, 0x22, 0x33, 0x44, 0x55};
+static const uint8_t g_peer_ip[4] = {192, 168, 1, 10};
+
+static int g_last;
+static int8_t g_labels[TRACE_FRAMES];
+
+/*===========================================================================*/
+/*                  BASELINE (process_rx_packet() in the original main.c)     */
+/*===========================================================================*/
+
+static void old_handle_arp(uint8_t* pkt, uint16_t len) {
+    (void)pkt;
+    (void)len;
+    g_last = CLS_ARP;
+}
+
+static void old_handle_icmp(uint8_t* pkt, uint16_t len) {
+    (void)pkt;
+    (void)len;
+    g_last = CLS_ICMP;
+}
+
+static void old_process_rx_packet(uint8_t* pkt, uint16_t len) {
+    if (len < 14) return;
+
+    uint16_t eth_type = ((uint16_t)pkt[12] << 8) | pkt[13];
+
+    switch (eth_type) {
+        case 0x0806:
+            old_handle_arp(pkt, len);
+            break;
+        case 0x0800:
+            if (len >= 34) {
+                uint8_t proto = pkt[23];
+                if (proto == 1) {
+                    old_handle_icmp(pkt, len);
+                }
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+/*===========================================================================*/
+/*                          HANDLERS (main.c set)                             */
+/*===========================================================================*/
+
+static bool prv_arp(net_frame_t* f) {
+    (void)f;
+    g_last = CLS_ARP;
+    return true;
+}
+
+static bool prv_icmp(net_frame_t* f) {
+    g_last = CLS_ICMP;
+    return f->l4 != NULL;
+}
+
+static bool prv_tgen(net_frame_t* f) {
+    (void)f;
+    g_last = CLS_TGEN;
+    return true;
+}
+
+static bool prv_regsvc(net_frame_t* f) {
+    g_last = CLS_REGSVC;
+    return f->payload_len > 0U;
+}
+
+static bool prv_extra(net_frame_t* f) {
+    (void)f;
+    g_last = CLS_EXTRA;
+    return true;
+}
+
+static void prv_register(int full) {
+    uint32_t i;
+
+    net_dispatch_init();
+    CHECK(net_register_ethertype(NET_ETHERTYPE_ARP, "arp", prv_arp));
+    CHECK(net_register_ip_proto(NET_IP_PROTO_ICMP, "icmp", prv_icmp));
+    CHECK(net_register_ethertype(TGEN_ETHERTYPE, "tgen", prv_tgen));
+    CHECK(net_register_udp_port(REGSVC_PORT, "regsvc", prv_regsvc));
+    if (!full) return;
+
+    /* Fill the remaining handler slots with ports and EtherTypes that are
+     * not in the trace, so every lookup probes a loaded table */
+    for (i = 0; i < NET_MAX_HANDLERS - 4U; i++) {
+        if ((i & 1U) != 0U) {
+            CHECK(net_register_udp_port((uint16_t)(6000U + i * 32U), "extra", prv_extra));
+        } else {
+            CHECK(net_register_ethertype((uint16_t)(0x9000U + i * 16U), "extra", prv_extra));
+        }
+    }
+    CHECK(!net_register_udp_port(7777U, "over", prv_extra));
+}
+
+/*===========================================================================*/
+/*                          TRACE GENERATION                                  */
+/*===========================================================================*/
+
+static uint16_t prv_build_arp(uint8_t* buf, const uint8_t* target_ip) {
+    memset(buf, 0, PKT_ETH_MIN);
+    memset(&buf[0], 0xFF, 6);
+    memcpy(&buf[6], g_peer_mac, 6);
+    buf[12] = 0x08; buf[13] = 0x06;
+    buf[14] = 0x00; buf[15] = 0x01;
+    buf[16] = 0x08; buf[17] = 0x00;
+    buf[18] = 6; buf[19] = 4;
+    buf[20] = 0x00; buf[21] = 0x01;
+    memcpy(&buf[22], g_peer_mac, 6);
+    memcpy(&buf[28], g_peer_ip, 4);
+    memcpy(&buf[38], target_ip, 4);
+    return PKT_ETH_MIN;
+}
+
+static uint16_t prv_build_l2(uint8_t* buf, uint16_t ethertype, uint16_t len) {
+    uint16_t i;
+
+    memcpy(&buf[0], g_our_mac, 6);
+    memcpy(&buf[6], g_peer_mac, 6);
+    buf[12] = (uint8_t)(ethertype >> 8);
+    buf[13] = (uint8_t)ethertype;
+    for (i = 14; i < len; i++) {
+        buf[i] = (uint8_t)test_rand();
+    }
+    return len;
+}
+
+/* Insert an 802.1Q tag after the MAC addresses */
+static uint16_t prv_add_vlan(uint8_t* buf, uint16_t len, uint16_t vid) {
+    memmove(&buf[16], &buf[12], (size_t)(len - 12U));
+    buf[12] = 0x81; buf[13] = 0x00;
+    buf[14] = (uint8_t)(vid >> 8);
+    buf[15] = (uint8_t)vid;
+    return (uint16_t)(len + 4U);
+}
+
+/**
+ * \brief           One frame of the mix, returns its length and expected class
+ */
+static uint16_t prv_gen(uint8_t* buf, int* cls) {
+    static const uint8_t other_ip[4] = {192, 168, 1, 77};
+    uint8_t payload[64];
+    uint32_t pick = test_rand() % 100U;
+    uint16_t len;
+
+    memset(payload, 0x5A, sizeof(payload));
+    if (pick < 10U) {
+        *cls = CLS_ARP;
+        return prv_build_arp(buf, g_our_ip);
+    } else if (pick < 20U) {
+        *cls = CLS_ARP;                                 /* Handler filters the target */
+        return prv_build_arp(buf, other_ip);
+    } else if (pick < 35U) {
+        *cls = CLS_ICMP;
+        return pkt_build_echo_request(buf, g_our_mac, g_peer_mac, g_peer_ip, g_our_ip,
+                                      5U, (uint16_t)(test_rand() % 1400U), (uint16_t)pick);
+    } else if (pick < 40U) {
+        *cls = CLS_ICMP;
+        return pkt_build_echo_request(buf, g_our_mac, g_peer_mac, g_peer_ip, g_our_ip,
+                                      6U, 56U, (uint16_t)pick);
+    } else if (pick < 55U) {
+        *cls = CLS_REGSVC;
+        return pkt_build_udp(buf, g_our_mac, g_peer_mac, g_peer_ip, g_our_ip,
+                             40000U, REGSVC_PORT, payload, 16U);
+    } else if (pick < 70U) {
+        *cls = CLS_UNHANDLED;                           /* No UDP proto handler */
+        return pkt_build_udp(buf, g_our_mac, g_peer_mac, g_peer_ip, g_our_ip,
+                             40000U, 5000U, payload, sizeof(payload));
+    } else if (pick < 75U) {
+        *cls = CLS_ICMP;
+        len = pkt_build_echo_request(buf, g_our_mac, g_peer_mac, g_peer_ip, g_our_ip,
+                                     5U, 56U, (uint16_t)pick);
+        return prv_add_vlan(buf, len, 10U);
+    } else if (pick < 85U) {
+        *cls = CLS_TGEN;
+        return prv_build_l2(buf, TGEN_ETHERTYPE, 64U);
+    } else if (pick < 90U) {
+        *cls = CLS_UNHANDLED;
+        return prv_build_l2(buf, 0x86DDU, 86U);         /* IPv6 */
+    } else if (pick < 95U) {
+        *cls = CLS_UNHANDLED;
+        return prv_build_l2(buf, 0x88CCU, 60U);         /* LLDP */
+    } else if (pick < 98U) {
+        *cls = CLS_MALFORMED;                           /* Total length past the frame */
+        len = pkt_build_echo_request(buf, g_our_mac, g_peer_mac, g_peer_ip, g_our_ip,
+                                     5U, 200U, (uint16_t)pick);
+        return (uint16_t)(len - 40U);
+    } else {
+        *cls = CLS_ICMP;                                /* Non-first fragment: no L4 */
+        len = pkt_build_echo_request(buf, g_our_mac, g_peer_mac, g_peer_ip, g_our_ip,
+                                     5U, 56U, (uint16_t)pick);
+        buf[14 + 6] = 0x00;
+        buf[14 + 7] = 0x10;
+        buf[14 + 10] = 0;
+        buf[14 + 11] = 0;
+        {
+            uint16_t c = pkt_ref_csum(&buf[14], 20U);
+            buf[14 + 10] = (uint8_t)(c >> 8);
+            buf[14 + 11] = (uint8_t)c;
+        }
+        return len;
+    }
+}
+
+static void prv_make_trace(pcap_trace_t* t) {
+    uint8_t buf[PCAP_MAX_FRAME];
+    uint32_t i;
+    int cls;
+
+    memset(t, 0, sizeof(*t));
+    for (i = 0; i < TRACE_FRAMES; i++) {
+        uint16_t len = prv_gen(buf, &cls);
+        pcap_trace_add(t, buf, len);
+        g_labels[i] = (int8_t)cls;
+    }
+}
+
+/*===========================================================================*/
+/*                              TESTS                                         */
+/*===========================================================================*/
+
+static void prv_test_routing(const pcap_trace_t* t) {
+    static uint8_t frame[PCAP_MAX_FRAME];
+    net_dispatch_stats_t ds;
+    net_handler_stats_t hs;
+    uint32_t expect[CLS_COUNT] = {0};
+    uint32_t unhandled = 0;
+    uint32_t malformed = 0;
+    uint32_t old_missed = 0;
+    uint32_t wrong = 0;
+    uint32_t i;
+
+    prv_register(1);
+    for (i = 0; i < t->count; i++) {
+        int cls = g_labels[i];
+
+        memcpy(frame, &t->data[t->offset[i]], t->len[i]);
+        g_last = CLS_UNHANDLED;
+        net_dispatch(frame, t->len[i]);
+
+        if (cls == CLS_MALFORMED) {
+            malformed++;
+            cls = CLS_UNHANDLED;
+        } else if (cls == CLS_UNHANDLED) {
+            unhandled++;
+        } else {
+            expect[cls]++;
+        }
+        if (g_last != cls) {
+            wrong++;
+        }
+
+        /* What the original switch made of the same frame */
+        g_last = CLS_UNHANDLED;
+        old_process_rx_packet(frame, t->len[i]);
+        if ((cls == CLS_ARP || cls == CLS_ICMP) && g_last != cls) {
+            old_missed++;
+        }
+    }
+
+    CHECK_EQ(wrong, 0);
+    net_dispatch_get_stats(&ds);
+    CHECK_EQ(ds.frames, t->count);
+    CHECK_EQ(ds.malformed, malformed);
+    CHECK_EQ(ds.unhandled, unhandled);
+    CHECK(net_handler_get_stats("arp", &hs));
+    CHECK_EQ(hs.packets, expect[CLS_ARP]);
+    CHECK(net_handler_get_stats("icmp", &hs));
+    CHECK_EQ(hs.packets, expect[CLS_ICMP]);
+    CHECK(hs.drops > 0U);                               /* The fragments */
+    CHECK(net_handler_get_stats("regsvc", &hs));
+    CHECK_EQ(hs.packets, expect[CLS_REGSVC]);
+    CHECK_EQ(hs.drops, 0);
+    CHECK(net_handler_get_stats("tgen", &hs));
+    CHECK_EQ(hs.packets, expect[CLS_TGEN]);
+
+    printf("routing: %lu frames, %lu unhandled, %lu malformed, all as labelled; "
+           "original switch missed %lu ARP/ICMP (VLAN-tagged)\n",
+           (unsigned long)t->count, (unsigned long)unhandled,
+           (unsigned long)malformed, (unsigned long)old_missed);
+    CHECK(old_missed > 0U);
+}
+
+/**
+ * \brief           Host cycles per frame over the whole trace
+ * \param[in]       mode: 0 original switch, 1 net_dispatch(), 2 buffer copy only
+ */
+static double prv_cost(const pcap_trace_t* t, int mode) {
+    static uint8_t frame[PCAP_MAX_FRAME];
+    const uint32_t passes = 200U;
+    uint64_t t0;
+    uint32_t p;
+    uint32_t i;
+
+    t0 = test_cycles();
+    for (p = 0; p < passes; p++) {
+        for (i = 0; i < t->count; i++) {
+            /* Headers only: the ring hands over a filled buffer */
+            memcpy(frame, &t->data[t->offset[i]], 64U < t->len[i] ? 64U : t->len[i]);
+            if (mode == 0) {
+                old_process_rx_packet(frame, t->len[i]);
+            } else if (mode == 1) {
+                net_dispatch(frame, t->len[i]);
+            }
+            __asm__ __volatile__("" : : "r"(frame) : "memory");
+        }
+    }
+    return (double)(test_cycles() - t0) / ((double)passes * t->count);
+}
+
+static void prv_bench(const pcap_trace_t* t, int check) {
+    double c_old;
+    double c_main;
+    double c_full;
+    double c_copy;
+
+    c_copy = prv_cost(t, 2);
+    c_old = prv_cost(t, 0) - c_copy;
+    prv_register(0);
+    c_main = prv_cost(t, 1) - c_copy;
+    prv_register(1);
+    c_full = prv_cost(t, 1) - c_copy;
+
+    printf("host cycles per frame: original switch %.1f, "
+           "net_dispatch %.1f (4 handlers), %.1f (%u handlers)\n",
+           c_old, c_main, c_full, (unsigned)NET_MAX_HANDLERS);
+
+    /* Hash and direct tables: a full handler table costs about the same */
+    if (check) {
+        CHECK(c_full < 1.5 * c_main);
+    }
+}
+
+int main(int argc, char** argv) {
+    pcap_trace_t gen;
+    pcap_trace_t t;
+    uint32_t i;
+
+    test_srand(0x0806U);
+
+    if (argc > 1) {
+        CHECK_EQ(pcap_read(argv[1], &t), 0);
+        printf("replaying %s: %lu frames\n", argv[1], (unsigned long)t.count);
+        prv_bench(&t, 0);
+        pcap_trace_free(&t);
+        return test_done("test_net_dispatch");
+    }
+
+    prv_make_trace(&gen);
+    CHECK_EQ(pcap_write(TRACE_FILE, &gen), 0);
+    CHECK_EQ(pcap_read(TRACE_FILE, &t), 0);
+    CHECK_EQ(t.count, gen.count);
+    for (i = 0; i < t.count && i < gen.count; i++) {
+        CHECK(t.len[i] == gen.len[i] &&
+              memcmp(&t.data[t.offset[i]], &gen.data[gen.offset[i]], t.len[i]) == 0);
+    }
+
+    prv_test_routing(&t);
+    prv_bench(&t, 1);
+
+    pcap_trace_free(&gen);
+    pcap_trace_free(&t);
+    return test_done("test_net_dispatch");
+}
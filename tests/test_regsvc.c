@@ -0,0 +1,377 @@
+/**
+ * \file            test_regsvc.c
+ * \brief           UDP register service against the LAN9646 register model
+ *
+ * Requests go in as UDP frames through net_dispatch(), the operations run
+ * through the real lan9646 driver on the mocked I2C bus and the replies
+ * are taken off the simulated TX DMA. Covered: every register op, MIB
+ * read-clear, malformed batches, retries answered from the cache,
+ * truncation and the source filter.
+ *
+ * The blocking table prints the I2C time each op keeps the RX handler on
+ * the bus at 100 kHz, and the worst full request of each kind.
+ */
+
+#include "regsvc.h"
+#include "eth_tx.h"
+#include "net_dispatch.h"
+#include "gmac_mock.h"
+#include "mock_clock.h"
+#include "lan9646_model.h"
+#include "pkt_util.h"
+#include "test_util.h"
+#include <string.h>
+
+#define REQ_MAX                     1472U
+#define CLIENT_PORT                 40000U
+
+static const uint8_t g_our_mac[6] = {0x10, 0x11, 0x22, 0x77, 0x77, 0x77};
+static const uint8_t g_our_ip[4] = {192, 168, 1, 200};
+static const uint8_t g_cli_mac[6] = {0x00, 0x11, 0x22, 0x33, 0x44, 0x55};
+static const uint8_t g_cli_ip[4] = {192, 168, 1, 100};
+static const uint8_t g_other_ip[4] = {192, 168, 1, 101};
+static const uint8_t g_host_mask[4] = {255, 255, 255, 255};
+
+static lan9646_t g_dev;
+
+/* Request under construction */
+static uint8_t g_req[REQ_MAX];
+static uint16_t g_req_len;
+
+/* Last reply off the wire */
+static uint8_t g_rep[REQ_MAX];
+static uint16_t g_rep_len;
+static uint32_t g_replies;
+static const uint8_t* g_sent_from;
+
+/*===========================================================================*/
+/*                          REQUEST / REPLY HELPERS                           */
+/*===========================================================================*/
+
+static void prv_req_begin(uint32_t req_id) {
+    regsvc_hdr_t h;
+
+    memset(&h, 0, sizeof(h));
+    h.magic = REGSVC_MAGIC;
+    h.version = REGSVC_VERSION;
+    h.req_id = req_id;
+    memcpy(g_req, &h, sizeof(h));
+    g_req_len = sizeof(h);
+}
+
+static void prv_req_op(uint8_t code, uint8_t size, uint16_t addr, uint32_t value, uint32_t mask) {
+    regsvc_op_t op;
+
+    op.code = code;
+    op.size = size;
+    op.addr = addr;
+    op.value = value;
+    op.mask = mask;
+    memcpy(&g_req[g_req_len], &op, sizeof(op));
+    g_req_len += sizeof(op);
+    g_req[3]++;                                     /* hdr.count */
+}
+
+static void prv_req_data(const uint8_t* data, uint16_t len) {
+    memcpy(&g_req[g_req_len], data, len);
+    memset(&g_req[g_req_len + len], 0, ((len + 3U) & ~3U) - len);
+    g_req_len = (uint16_t)(g_req_len + ((len + 3U) & ~3U));
+}
+
+static void prv_sink(const uint8_t* frame, uint16_t len) {
+    uint16_t udp_len;
+
+    if (len < 42U || frame[23] != 17U) return;
+    udp_len = (uint16_t)(((uint16_t)frame[38] << 8) | frame[39]);
+    CHECK(pkt_ipv4_csum_ok(frame));
+    CHECK_EQ(frame[14 + 6], 0);
+    CHECK(memcmp(&frame[30], g_sent_from, 4) == 0);
+    g_rep_len = (uint16_t)(udp_len - 8U);
+    memcpy(g_rep, &frame[42], g_rep_len);
+    g_replies++;
+}
+
+/**
+ * \brief           Send the request from src_ip and wait for the reply
+ * \return          Reply header status, -1 if no reply
+ */
+static int prv_send_from(const uint8_t src_ip[4]) {
+    static uint8_t frame[1536];
+    uint16_t len = pkt_build_udp(frame, g_our_mac, g_cli_mac, src_ip, g_our_ip,
+                                 CLIENT_PORT, REGSVC_UDP_PORT, g_req, g_req_len);
+    uint32_t before = g_replies;
+    regsvc_hdr_t h;
+
+    g_sent_from = src_ip;
+    net_dispatch(frame, len);
+    mock_clock_advance(100000U);
+    (void)eth_tx_reclaim();
+    if (g_replies == before) return -1;
+
+    memcpy(&h, g_rep, sizeof(h));
+    CHECK_EQ(h.magic, REGSVC_MAGIC);
+    CHECK(memcmp(&h.req_id, &g_req[4], 4) == 0);
+    return h.status;
+}
+
+static int prv_send(void) {
+    return prv_send_from(g_cli_ip);
+}
+
+static uint8_t prv_rep_count(void) {
+    return g_rep[3];
+}
+
+/**
+ * \brief           Result n of the last reply
+ * \return          Pointer to its data, NULL if missing
+ */
+static const uint8_t* prv_rep_result(uint8_t n, regsvc_res_t* r) {
+    uint16_t off = sizeof(regsvc_hdr_t);
+    uint8_t i;
+
+    for (i = 0; i <= n; i++) {
+        if ((uint32_t)off + sizeof(*r) > g_rep_len) return NULL;
+        memcpy(r, &g_rep[off], sizeof(*r));
+        if (i == n) return &g_rep[off + sizeof(*r)];
+        off = (uint16_t)(off + sizeof(*r) + ((r->len + 3U) & ~3U));
+    }
+    return NULL;
+}
+
+static uint32_t prv_rep_u32(uint8_t n) {
+    regsvc_res_t r;
+    const uint8_t* p = prv_rep_result(n, &r);
+    uint32_t v = 0;
+
+    CHECK(p != NULL);
+    if (p != NULL) {
+        CHECK_EQ(r.status, lan9646OK);
+        memcpy(&v, p, 4);
+    }
+    return v;
+}
+
+/*===========================================================================*/
+/*                              TESTS                                         */
+/*===========================================================================*/
+
+static void prv_setup(void) {
+    mock_clock_reset();
+    gmac_mock_reset(0);
+    gmac_mock_set_irq(NULL, eth_tx_irq_callback);
+    gmac_mock_set_tx_sink(prv_sink);
+    eth_tx_init(0, 0);
+    net_dispatch_init();
+    CHECK(net_register_udp_port(REGSVC_UDP_PORT, "regsvc", regsvc_input));
+
+    lan9646_model_reset();
+    CHECK_EQ(lan9646_model_attach(&g_dev), lan9646OK);
+    regsvc_init(&g_dev, g_our_mac);
+    regsvc_allow(g_cli_ip, g_host_mask);
+}
+
+static void prv_test_ops(void) {
+    static const uint8_t burst[10] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+    regsvc_res_t r;
+    const uint8_t* p;
+    regsvc_stats_t st;
+
+    prv_setup();
+    lan9646_model_set(0x6300, 1, 0x48);
+    lan9646_model_set(0x1104, 2, 0x1234);
+    lan9646_model_set(0x0010, 4, 0xA5A55A5AU);
+    lan9646_model_set_mib(6, LAN9646_MIB_RX_UNICAST, 1000U);
+    lan9646_model_set_mib(6, LAN9646_MIB_RX_UNICAST + 1U, 7U);
+
+    prv_req_begin(1);
+    prv_req_op(REGSVC_OP_READ, 2, LAN9646_REG_CHIP_ID1, 0, 0);
+    prv_req_op(REGSVC_OP_READ, 1, 0x6300, 0, 0);
+    prv_req_op(REGSVC_OP_READ, 2, 0x1104, 0, 0);
+    prv_req_op(REGSVC_OP_READ, 4, 0x0010, 0, 0);
+    prv_req_op(REGSVC_OP_WRITE, 1, 0x6301, 0x18, 0);
+    prv_req_op(REGSVC_OP_MODIFY, 1, 0x6300, 0x20, 0x60);
+    prv_req_op(REGSVC_OP_WRITE_BURST, 0, 0x2000, sizeof(burst), 0);
+    prv_req_data(burst, sizeof(burst));
+    prv_req_op(REGSVC_OP_READ_BURST, 0, 0x2000, sizeof(burst), 0);
+    prv_req_op(REGSVC_OP_MIB, 2, 6, LAN9646_MIB_RX_UNICAST, 0);
+    CHECK_EQ(prv_send(), REGSVC_OK);
+    CHECK_EQ(prv_rep_count(), 9);
+
+    CHECK_EQ(prv_rep_u32(0), LAN9646_CHIP_ID);
+    CHECK_EQ(prv_rep_u32(1), 0x48);
+    CHECK_EQ(prv_rep_u32(2), 0x1234);
+    CHECK_EQ(prv_rep_u32(3), 0xA5A55A5AU);
+    CHECK_EQ(lan9646_model_get(0x6301, 1), 0x18);
+    CHECK_EQ(prv_rep_u32(5), 0x48);                 /* Previous value */
+    CHECK_EQ(lan9646_model_get(0x6300, 1), 0x28);
+    CHECK(memcmp(&lan9646_model_regs()[0x2000], burst, sizeof(burst)) == 0);
+    p = prv_rep_result(7, &r);
+    CHECK(p != NULL && r.len == sizeof(burst) && memcmp(p, burst, sizeof(burst)) == 0);
+    p = prv_rep_result(8, &r);
+    CHECK(p != NULL && r.len == 8U);
+    if (p != NULL) {
+        uint32_t v[2];
+        memcpy(v, p, sizeof(v));
+        CHECK_EQ(v[0], 1000);
+        CHECK_EQ(v[1], 7);
+    }
+    CHECK_EQ(lan9646_model_get_mib(6, LAN9646_MIB_RX_UNICAST), 0);     /* Read-clear */
+
+    /* Lost reply: the retry is served from the cache, nothing runs again */
+    lan9646_model_clear_stats();
+    lan9646_model_set_mib(6, LAN9646_MIB_RX_UNICAST, 55U);
+    CHECK_EQ(prv_send(), REGSVC_OK);
+    CHECK_EQ(lan9646_model_stats()->reads + lan9646_model_stats()->writes, 0);
+    CHECK_EQ(lan9646_model_get_mib(6, LAN9646_MIB_RX_UNICAST), 55);
+    p = prv_rep_result(8, &r);
+    CHECK(p != NULL && p[0] == (uint8_t)1000U);
+
+    /* Malformed op anywhere: nothing on the bus */
+    prv_req_begin(2);
+    prv_req_op(REGSVC_OP_WRITE, 1, 0x6301, 0x00, 0);
+    prv_req_op(REGSVC_OP_READ, 3, 0x6300, 0, 0);
+    lan9646_model_clear_stats();
+    CHECK_EQ(prv_send(), REGSVC_BADREQ);
+    CHECK_EQ(prv_rep_count(), 0);
+    CHECK_EQ(lan9646_model_stats()->writes, 0);
+    CHECK_EQ(lan9646_model_get(0x6301, 1), 0x18);
+
+    /* Bus error is reported per op, the batch goes on */
+    prv_req_begin(3);
+    prv_req_op(REGSVC_OP_READ, 1, 0x6300, 0, 0);
+    prv_req_op(REGSVC_OP_READ, 1, 0x6301, 0, 0);
+    lan9646_model_fail_next(1);
+    CHECK_EQ(prv_send(), REGSVC_OK);
+    (void)prv_rep_result(0, &r);
+    CHECK_EQ(r.status, lan9646BUSERR);
+    CHECK_EQ(prv_rep_u32(1), 0x18);
+
+    /* Results beyond one datagram: the reply stops at the last op that fits */
+    prv_req_begin(4);
+    prv_req_op(REGSVC_OP_READ_BURST, 0, 0x0000, 256, 0);
+    prv_req_op(REGSVC_OP_READ_BURST, 0, 0x0100, 256, 0);
+    prv_req_op(REGSVC_OP_READ_BURST, 0, 0x0200, 256, 0);
+    prv_req_op(REGSVC_OP_READ_BURST, 0, 0x0300, 256, 0);
+    prv_req_op(REGSVC_OP_READ_BURST, 0, 0x0400, 256, 0);
+    prv_req_op(REGSVC_OP_READ_BURST, 0, 0x0500, 256, 0);
+    CHECK_EQ(prv_send(), REGSVC_TRUNC);
+    CHECK_EQ(prv_rep_count(), 5);
+
+    regsvc_get_stats(&st);
+    CHECK_EQ(st.requests, 3);
+    CHECK_EQ(st.retries, 1);
+    CHECK_EQ(st.bad, 1);
+    CHECK_EQ(st.op_errors, 1);
+    CHECK_EQ(st.denied, 0);
+}
+
+static void prv_test_filter(void) {
+    static const uint8_t net[4] = {192, 168, 1, 0};
+    static const uint8_t mask24[4] = {255, 255, 255, 0};
+    static const uint8_t far_ip[4] = {10, 0, 0, 5};
+    regsvc_stats_t st;
+
+    /* Nothing is allowed before regsvc_allow() */
+    prv_setup();
+    regsvc_init(&g_dev, g_our_mac);
+    prv_req_begin(10);
+    prv_req_op(REGSVC_OP_WRITE, 1, 0x6301, 0x55, 0);
+    CHECK_EQ(prv_send(), -1);
+    CHECK_EQ(lan9646_model_stats()->writes, 0);
+
+    /* Single host: a neighbour is refused, even with a cached request ID */
+    regsvc_allow(g_cli_ip, g_host_mask);
+    CHECK_EQ(prv_send(), REGSVC_OK);
+    CHECK_EQ(lan9646_model_get(0x6301, 1), 0x55);
+    lan9646_model_set(0x6301, 1, 0);
+    CHECK_EQ(prv_send_from(g_other_ip), -1);
+    prv_req_begin(11);
+    prv_req_op(REGSVC_OP_WRITE, 1, 0x6301, 0x66, 0);
+    CHECK_EQ(prv_send_from(g_other_ip), -1);
+    CHECK_EQ(lan9646_model_get(0x6301, 1), 0);
+
+    /* Subnet */
+    regsvc_allow(net, mask24);
+    CHECK_EQ(prv_send_from(g_other_ip), REGSVC_OK);
+    CHECK_EQ(lan9646_model_get(0x6301, 1), 0x66);
+    CHECK_EQ(prv_send_from(far_ip), -1);
+
+    regsvc_get_stats(&st);
+    CHECK_EQ(st.denied, 4);
+}
+
+/**
+ * \brief           Bus time of one full request at 100 kHz
+ */
+static double prv_request_ms(const char* what, uint8_t ops) {
+    double ms;
+
+    lan9646_model_clear_stats();
+    CHECK(prv_send() != -1);
+    ms = (double)lan9646_model_bus_ns(LAN9646_MODEL_I2C_HZ) / 1e6;
+    printf("%-34s | %4u ops | %6lu txn | %8.2f ms\n", what, (unsigned)ops,
+           (unsigned long)(lan9646_model_stats()->reads + lan9646_model_stats()->writes), ms);
+    return ms;
+}
+
+static void prv_blocking(void) {
+    static uint8_t data[REGSVC_BURST_MAX];
+    uint32_t id = 100;
+    uint8_t n;
+    uint8_t i;
+    double ms;
+
+    prv_setup();
+    printf("regsvc: I2C time the RX handler blocks, 100 kHz\n");
+
+    prv_req_begin(id++);
+    prv_req_op(REGSVC_OP_READ, 1, 0x6300, 0, 0);
+    (void)prv_request_ms("1 READ 8-bit", 1);
+    prv_req_begin(id++);
+    prv_req_op(REGSVC_OP_READ, 4, 0x0010, 0, 0);
+    (void)prv_request_ms("1 READ 32-bit", 1);
+    prv_req_begin(id++);
+    prv_req_op(REGSVC_OP_MODIFY, 4, 0x0010, 1, 1);
+    (void)prv_request_ms("1 MODIFY 32-bit", 1);
+    prv_req_begin(id++);
+    prv_req_op(REGSVC_OP_MIB, 1, 6, 0, 0);
+    (void)prv_request_ms("1 MIB counter", 1);
+
+    /* Worst full requests: as many ops as fit in the request and reply */
+    n = (uint8_t)((REQ_MAX - sizeof(regsvc_hdr_t)) / sizeof(regsvc_op_t));
+    prv_req_begin(id++);
+    for (i = 0; i < n; i++) {
+        prv_req_op(REGSVC_OP_MODIFY, 4, 0x0010, 1, 1);
+    }
+    ms = prv_request_ms("full request of MODIFY 32-bit", n);
+    CHECK(ms < 200.0);
+
+    prv_req_begin(id++);
+    for (i = 0; i < 5U; i++) {
+        prv_req_op(REGSVC_OP_READ_BURST, 0, (uint16_t)(i * 0x100U), REGSVC_BURST_MAX, 0);
+    }
+    (void)prv_request_ms("5 READ_BURST 256 bytes", 5);
+
+    prv_req_begin(id++);
+    for (i = 0; i < 5U; i++) {
+        prv_req_op(REGSVC_OP_WRITE_BURST, 0, (uint16_t)(0x2000U + i * 0x100U), REGSVC_BURST_MAX, 0);
+        prv_req_data(data, sizeof(data));
+    }
+    (void)prv_request_ms("5 WRITE_BURST 256 bytes", 5);
+
+    prv_req_begin(id++);
+    for (i = 0; i < 11U; i++) {
+        prv_req_op(REGSVC_OP_MIB, REGSVC_MIB_MAX, 6, 0, 0);
+    }
+    ms = prv_request_ms("11 MIB ops of 32 counters", 11);
+    CHECK(ms < 700.0);
+}
+
+int main(void) {
+    prv_test_ops();
+    prv_test_filter();
+    prv_blocking();
+
+    return test_done("test_regsvc");
+}
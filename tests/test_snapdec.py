@@ -0,0 +1,115 @@
+#!/usr/bin/env python3
+"""
+Round trip of 03_Softwares/lan9646_snap/snapdec.py on captured snapshots.
+
+test_lan9646_snap captures two snapshots with lan9646_snap_capture() on the
+register model and writes them to a temporary directory; snapdec.py must
+decode every register byte, MIB total and VID the model held, and its
+show and diff commands must report the one change of each kind between
+the two.
+
+    python3 test_snapdec.py <path to test_lan9646_snap> <path to snapdec.py>
+"""
+
+import importlib.util
+import os
+import subprocess
+import sys
+import tempfile
+import unittest
+
+CAPTURE = sys.argv.pop(1) if len(sys.argv) > 1 else "./test_lan9646_snap"
+SNAPDEC = sys.argv.pop(1) if len(sys.argv) > 1 else "../03_Softwares/lan9646_snap/snapdec.py"
+
+spec = importlib.util.spec_from_file_location("snapdec", SNAPDEC)
+snapdec = importlib.util.module_from_spec(spec)
+spec.loader.exec_module(snapdec)
+
+CHIP_ID = 0x9477
+TIME_MS = 123456
+PHY_PORTS = [1, 2, 3, 4]
+CLEAR_ON_READ = [0x102, 0x10C, 0x114]     # PHY basic status, AN expansion, 1000BASE-T status
+
+
+def pattern(addr):
+    """SNAP_PATTERN() of test_lan9646_snap.c"""
+    return ((addr >> 8) ^ (addr * 3)) & 0xFF
+
+
+def mib_total(port, i):
+    return (port << 40) | (i << 8) | port
+
+
+class SnapdecTest(unittest.TestCase):
+
+    @classmethod
+    def setUpClass(cls):
+        cls.tmp = tempfile.TemporaryDirectory()
+        proc = subprocess.run([CAPTURE, cls.tmp.name], stdout=subprocess.PIPE, text=True)
+        if proc.returncode != 0:
+            raise RuntimeError(f"capture failed:\n{proc.stdout}")
+        cls.before = os.path.join(cls.tmp.name, "before.snap")
+        cls.after = os.path.join(cls.tmp.name, "after.snap")
+
+    @classmethod
+    def tearDownClass(cls):
+        cls.tmp.cleanup()
+
+    def run_snapdec(self, *args):
+        proc = subprocess.run([sys.executable, SNAPDEC] + list(args), stdout=subprocess.PIPE,
+                              stderr=subprocess.STDOUT, text=True)
+        return proc.returncode, proc.stdout
+
+    def test_header(self):
+        s = snapdec.load(self.before)
+        self.assertEqual((s.flags, s.time_ms, s.chip_id), (0, TIME_MS, CHIP_ID))
+        self.assertEqual(s.flag_text(), "-")
+
+    def test_registers(self):
+        s = snapdec.load(self.before)
+        self.assertTrue(s.regs)
+        bad = [a for a, b in s.regs.items() if a not in (1, 2) and b != pattern(a)]
+        self.assertEqual(bad, [])
+        self.assertEqual(s.be(0x0001, 2), CHIP_ID)
+        for p in PHY_PORTS:
+            base = p << 12
+            self.assertEqual(s.be(base | 0x100, 2), (pattern(base | 0x100) << 8) | pattern(base | 0x101))
+            self.assertIsNotNone(s.be(base | 0x104, 4))
+            for reg in CLEAR_ON_READ:
+                self.assertIsNone(s.be(base | reg, 2), f"0x{base | reg:04X} captured")
+
+    def test_mib(self):
+        s = snapdec.load(self.before)
+        self.assertEqual(sorted(s.mib), snapdec.PORTS)
+        for p in snapdec.PORTS:
+            self.assertEqual(len(s.mib[p]), len(snapdec.MIB_NAMES))
+            self.assertEqual(s.mib[p], [mib_total(p, i) for i in range(len(snapdec.MIB_NAMES))])
+
+    def test_vlans(self):
+        self.assertEqual(snapdec.load(self.before).vlans, [(1, 0x6F, 0x6F, 0), (100, 0x21, 0x01, 1)])
+        self.assertEqual(snapdec.load(self.after).vlans, [(1, 0x6F, 0x6F, 0), (100, 0x23, 0x01, 1)])
+
+    def test_show(self):
+        code, out = self.run_snapdec("show", self.before)
+        self.assertEqual(code, 0, out)
+        self.assertIn(f"chip id 0x{CHIP_ID:04X}", out)
+        self.assertIn(f"t={TIME_MS} ms", out)
+        self.assertIn("rx_hi_prio_byte", out)
+        self.assertIn(" 100    1  1,6", out)
+
+    def test_diff(self):
+        code, out = self.run_snapdec("diff", self.before, self.after)
+        self.assertEqual(code, 1, out)
+        self.assertIn(f"  2A07: 0x{pattern(0x2A07):02X} -> 0x4D", out)
+        self.assertIn("1 register bytes differ", out)
+        self.assertRegex(out, r"\n  port 1 rx_hi_prio_byte +\+5\n")
+        self.assertIn("  vid 100: (33, 1, 1) -> (35, 1, 1)", out)
+        self.assertEqual(out.count("\n  port "), 1, out)
+
+        code, out = self.run_snapdec("diff", self.before, self.before)
+        self.assertEqual(code, 0, out)
+        self.assertIn("0 register bytes differ", out)
+
+
+if __name__ == "__main__":
+    unittest.main(verbosity=1)
@@ -0,0 +1,246 @@
+/**
+ * \file            test_telemetry.c
+ * \brief           Telemetry publisher: sequence gap check on the wire and records per second
+ *
+ * The publisher runs against the real frame template, ARP cache and TX
+ * pool on the simulated DMA. Every datagram leaving the wire is decoded
+ * and its datagram and record sequence numbers are checked for gaps the
+ * same way 03_Softwares/telemetry_rx/tlm_rx.py does.
+ *
+ * The benchmark prints host cycles per record, including the amortized
+ * datagram close and send, and the records per second that gives.
+ */
+
+#include "telemetry.h"
+#include "arp_cache.h"
+#include "eth_tx.h"
+#include "net_dispatch.h"
+#include "gmac_mock.h"
+#include "mock_clock.h"
+#include "test_util.h"
+#include <string.h>
+
+#define SOURCES                     4U
+#define RECS_PER_DGRAM              ((1472U - sizeof(tlm_hdr_t)) / sizeof(tlm_rec_t))
+
+static const uint8_t g_our_mac[6] = {0x02, 0x00, 0x00, 0x00, 0x00, 0x01};
+static const uint8_t g_our_ip[4] = {192, 168, 1, 100};
+static const uint8_t g_netmask[4] = {255, 255, 255, 0};
+static const uint8_t g_gateway[4] = {192, 168, 1, 1};
+static const uint8_t g_coll_ip[4] = {192, 168, 1, 10};
+static const uint8_t g_coll_mac[6] = {0x00, 0x11, 0x22, 0x33, 0x44, 0x55};
+
+/* Receiver side, as tlm_rx.py */
+typedef struct {
+    uint32_t dgrams;
+    uint32_t records;
+    uint32_t dgram_missing;
+    uint32_t rec_missing;
+    uint32_t bad;
+    uint32_t dev_lost;
+    uint32_t next_seq;
+    uint32_t next_rec;
+    uint32_t max_count;
+    uint32_t max_age_us;        /* Oldest record age when its datagram left */
+} rx_check_t;
+
+static rx_check_t g_rx;
+static uint32_t g_sample_no;
+static bool g_drop_next;        /* Make the next sink frame vanish on the wire */
+
+static void prv_sink(const uint8_t* frame, uint16_t len) {
+    const uint8_t* udp;
+    tlm_hdr_t hdr;
+    tlm_rec_t rec;
+    uint32_t now = (uint32_t)(mock_clock_ns() / 1000U);
+    uint32_t i;
+
+    if (len < 42U || frame[12] != 0x08 || frame[13] != 0x00 || frame[23] != 17U) return;
+    if (g_drop_next) {
+        g_drop_next = false;
+        return;
+    }
+    udp = &frame[34];
+    if (len < 42U + sizeof(hdr)) {
+        g_rx.bad++;
+        return;
+    }
+    memcpy(&hdr, &udp[8], sizeof(hdr));
+    if (hdr.magic != TLM_MAGIC || hdr.version != TLM_VERSION
+        || len < 42U + sizeof(hdr) + (uint32_t)hdr.count * sizeof(tlm_rec_t)) {
+        g_rx.bad++;
+        return;
+    }
+
+    if (g_rx.dgrams > 0U) {
+        g_rx.dgram_missing += hdr.seq - g_rx.next_seq;
+        g_rx.rec_missing += hdr.first_rec - g_rx.next_rec;
+    }
+    g_rx.next_seq = hdr.seq + 1U;
+    g_rx.next_rec = hdr.first_rec + hdr.count;
+    g_rx.dev_lost = hdr.lost;
+    g_rx.dgrams++;
+    g_rx.records += hdr.count;
+    if (hdr.count > g_rx.max_count) {
+        g_rx.max_count = hdr.count;
+    }
+
+    for (i = 0; i < hdr.count; i++) {
+        memcpy(&rec, &udp[8U + sizeof(hdr) + i * sizeof(rec)], sizeof(rec));
+        if (now - rec.t_us > g_rx.max_age_us) {
+            g_rx.max_age_us = now - rec.t_us;
+        }
+    }
+}
+
+static void prv_source(void* arg) {
+    uint32_t v[TLM_REC_VALUES] = {0};
+
+    v[0] = g_sample_no;
+    v[1] = (uint32_t)(uintptr_t)arg;
+    (void)tlm_record(TLM_REC_LOOP, (uint16_t)(uintptr_t)arg, v, TLM_REC_VALUES);
+    if ((uintptr_t)arg == 0U) {
+        g_sample_no++;
+    }
+}
+
+static void prv_rx_arp_reply(void) {
+    uint8_t f[60];
+
+    memset(f, 0, sizeof(f));
+    memcpy(&f[0], g_our_mac, 6);
+    memcpy(&f[6], g_coll_mac, 6);
+    f[12] = 0x08; f[13] = 0x06;
+    f[14] = 0x00; f[15] = 0x01; f[16] = 0x08; f[17] = 0x00;
+    f[18] = 6; f[19] = 4; f[20] = 0x00; f[21] = 2;
+    memcpy(&f[22], g_coll_mac, 6);
+    memcpy(&f[28], g_coll_ip, 4);
+    memcpy(&f[32], g_our_mac, 6);
+    memcpy(&f[38], g_our_ip, 4);
+    net_dispatch(f, sizeof(f));
+}
+
+/* One main loop pass: 10 us of other work, then the publisher */
+static void prv_loop_for_us(uint64_t us) {
+    uint64_t end = mock_clock_ns() + us * 1000U;
+
+    while (mock_clock_ns() < end) {
+        mock_clock_advance(10000U);
+        if (eth_tx_pending()) {
+            (void)eth_tx_reclaim();
+        }
+        tlm_poll();
+    }
+}
+
+static void prv_setup(void) {
+    uintptr_t i;
+
+    mock_clock_reset();
+    gmac_mock_reset(0);
+    gmac_mock_set_irq(NULL, eth_tx_irq_callback);
+    gmac_mock_set_tx_sink(prv_sink);
+    eth_tx_init(0, 0);
+    net_dispatch_init();
+    arp_init(g_our_mac, g_our_ip, g_netmask, g_gateway);
+    CHECK(net_register_ethertype(NET_ETHERTYPE_ARP, "arp", arp_input));
+
+    tlm_init(g_our_mac, g_our_ip, g_coll_ip, TLM_UDP_PORT);
+    for (i = 0; i < SOURCES; i++) {
+        CHECK(tlm_add_source(prv_source, (void*)i));
+    }
+}
+
+static void prv_test_stream(void) {
+    tlm_stats_t st;
+
+    prv_setup();
+    CHECK(!tlm_set_rate_hz(TLM_MAX_RATE_HZ + 1U));
+    CHECK(tlm_set_rate_hz(TLM_MAX_RATE_HZ));
+
+    /* The first datagram waits for ARP, then the collector answers */
+    prv_loop_for_us(5000U);
+    prv_rx_arp_reply();
+
+    /* 2 s at the maximum rate */
+    prv_loop_for_us(2000000U);
+    tlm_set_rate_hz(0U);
+    tlm_flush();
+    prv_loop_for_us(1000U);
+
+    tlm_get_stats(&st);
+    printf("stream: %lu samples, %lu records in %lu datagrams (max %lu per datagram), "
+           "oldest record %lu us\n",
+           (unsigned long)st.samples, (unsigned long)g_rx.records,
+           (unsigned long)g_rx.dgrams, (unsigned long)g_rx.max_count,
+           (unsigned long)g_rx.max_age_us);
+
+    CHECK(st.samples >= 2U * TLM_MAX_RATE_HZ);
+    CHECK_EQ(st.late, 0);
+    CHECK_EQ(st.lost, 0);
+    CHECK_EQ(g_rx.bad, 0);
+    CHECK_EQ(g_rx.dgram_missing, 0);
+    CHECK_EQ(g_rx.rec_missing, 0);
+    CHECK_EQ(g_rx.dev_lost, 0);
+    CHECK_EQ(g_rx.records, st.records);
+    CHECK_EQ(g_rx.dgrams, st.datagrams);
+    CHECK_EQ(g_rx.max_count, RECS_PER_DGRAM);
+    CHECK(g_rx.max_age_us <= TLM_FLUSH_US + 1000U);
+
+    /* A datagram lost on the wire shows up as exactly one datagram gap
+     * and its record count as the record gap */
+    tlm_set_rate_hz(1000U);
+    prv_loop_for_us(50000U);
+    g_drop_next = true;
+    prv_loop_for_us(50000U);
+    tlm_set_rate_hz(0U);
+    tlm_flush();
+    prv_loop_for_us(1000U);
+    CHECK_EQ(g_rx.dgram_missing, 1);
+    CHECK(g_rx.rec_missing > 0U && g_rx.rec_missing <= RECS_PER_DGRAM);
+    tlm_get_stats(&st);
+    CHECK_EQ(g_rx.records + g_rx.rec_missing, st.records);
+}
+
+static void prv_bench(void) {
+    const uint32_t dgrams = 20000U;
+    uint32_t v[TLM_REC_VALUES] = {1, 2, 3, 4, 5, 6};
+    tlm_stats_t before;
+    tlm_stats_t after;
+    uint64_t t0;
+    uint64_t cycles = 0;
+    uint64_t ns = 0;
+    uint32_t d;
+    uint32_t r;
+
+    tlm_get_stats(&before);
+    for (d = 0; d < dgrams; d++) {
+        uint64_t h0 = test_host_ns();
+
+        /* One full datagram, closed and sent by the last record */
+        t0 = test_cycles();
+        for (r = 0; r < RECS_PER_DGRAM; r++) {
+            (void)tlm_record(TLM_REC_LOOP, 0, v, TLM_REC_VALUES);
+        }
+        cycles += test_cycles() - t0;
+        ns += test_host_ns() - h0;
+
+        /* Let the frame leave so the template buffer comes back */
+        mock_clock_advance(20000U);
+        (void)eth_tx_reclaim();
+    }
+    tlm_get_stats(&after);
+
+    r = after.records - before.records;
+    printf("tlm_record: %.1f host cycles per record incl. send, %.1f M records/s on this host\n",
+           (double)cycles / r, (double)r * 1000.0 / (double)ns);
+    CHECK_EQ(after.lost, before.lost);
+    CHECK_EQ(r, dgrams * RECS_PER_DGRAM);
+}
+
+int main(void) {
+    prv_test_stream();
+    prv_bench();
+
+    return test_done("test_telemetry");
+}
@@ -0,0 +1,148 @@
+#!/usr/bin/env python3
+"""
+Gap check of 03_Softwares/telemetry_rx/tlm_rx.py.
+
+SeqTracker is fed loss, reordering, duplicates and 32-bit wrap directly;
+then tlm_rx.py runs as a receiver on a loopback UDP port and is sent a
+datagram stream with one datagram dropped, one delayed and one repeated.
+Its last summary line and exit code must report exactly that.
+
+    python3 test_tlm_rx.py <path to tlm_rx.py>
+"""
+
+import importlib.util
+import re
+import socket
+import struct
+import subprocess
+import sys
+import time
+import unittest
+
+TLM_RX = sys.argv.pop(1) if len(sys.argv) > 1 else "../03_Softwares/telemetry_rx/tlm_rx.py"
+
+spec = importlib.util.spec_from_file_location("tlm_rx", TLM_RX)
+tlm_rx = importlib.util.module_from_spec(spec)
+spec.loader.exec_module(tlm_rx)
+
+RECS = 45
+
+
+def datagram(seq, first_rec, count=RECS, lost=0):
+    data = tlm_rx.HDR.pack(tlm_rx.TLM_MAGIC, tlm_rx.TLM_VERSION, count, seq, first_rec, lost)
+    for i in range(count):
+        data += tlm_rx.REC.pack(3, 0, 1000 * (first_rec + i), first_rec + i, 0, 0, 0, 0, 0)
+    return data
+
+
+class SeqTrackerTest(unittest.TestCase):
+
+    def test_in_order(self):
+        t = tlm_rx.SeqTracker()
+        for s in range(100):
+            t.feed(s)
+        self.assertEqual((t.missing, t.reordered, t.duplicates), (0, 0, 0))
+
+    def test_loss(self):
+        t = tlm_rx.SeqTracker()
+        for s in [0, 1, 2, 5, 6, 10]:
+            t.feed(s)
+        self.assertEqual(t.missing, 2 + 3)
+
+    def test_late_fills_hole(self):
+        t = tlm_rx.SeqTracker()
+        for s in [0, 1, 3, 4, 2]:
+            t.feed(s)
+        self.assertEqual((t.missing, t.reordered, t.duplicates), (0, 1, 0))
+
+    def test_duplicate(self):
+        t = tlm_rx.SeqTracker()
+        for s in [0, 1, 2, 1, 2, 3]:
+            t.feed(s)
+        self.assertEqual((t.missing, t.reordered, t.duplicates), (0, 0, 2))
+
+    def test_record_ranges(self):
+        t = tlm_rx.SeqTracker()
+        t.feed(0, 45)
+        t.feed(90, 45)          # 45..89 missing
+        t.feed(45, 45)          # arrives late
+        t.feed(135, 45)
+        self.assertEqual((t.missing, t.reordered, t.duplicates), (0, 45, 0))
+
+    def test_partial_fill_splits_hole(self):
+        t = tlm_rx.SeqTracker()
+        t.feed(0)
+        t.feed(10)              # 1..9 missing
+        t.feed(4)
+        t.feed(4)               # second copy: duplicate
+        self.assertEqual((t.missing, t.reordered, t.duplicates), (8, 1, 1))
+        t.feed(1)
+        t.feed(9)
+        self.assertEqual(t.missing, 6)
+
+    def test_wrap(self):
+        t = tlm_rx.SeqTracker()
+        for s in [0xFFFFFFFD, 0xFFFFFFFE, 0xFFFFFFFF, 0, 2]:
+            t.feed(s)
+        self.assertEqual(t.missing, 1)
+        t.feed(1)
+        self.assertEqual((t.missing, t.reordered), (0, 1))
+        t.feed(0xFFFFFFFF)
+        self.assertEqual(t.duplicates, 1)
+
+
+class ReceiverTest(unittest.TestCase):
+
+    def run_receiver(self, frames):
+        probe = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        probe.bind(("127.0.0.1", 0))
+        port = probe.getsockname()[1]
+        probe.close()
+
+        proc = subprocess.Popen([sys.executable, "-u", TLM_RX, "--bind", "127.0.0.1",
+                                 "--port", str(port), "--interval", "0.2", "--duration", "1.5"],
+                                stdout=subprocess.PIPE, text=True)
+        try:
+            self.assertIn("listening", proc.stdout.readline())
+            tx = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+            for data in frames:
+                tx.sendto(data, ("127.0.0.1", port))
+                time.sleep(0.001)
+            tx.close()
+            out, _ = proc.communicate(timeout=10)
+        finally:
+            if proc.poll() is None:
+                proc.kill()
+        summaries = [l for l in out.splitlines() if "dgram miss=" in l]
+        self.assertTrue(summaries, out)
+        m = re.search(r"dgram miss=(\d+) reorder=(\d+) dup=(\d+) \| rec miss=(\d+) dev_lost=(\d+) bad=(\d+)",
+                      summaries[-1])
+        self.assertIsNotNone(m, summaries[-1])
+        return proc.returncode, tuple(int(x) for x in m.groups())
+
+    def test_clean_stream(self):
+        frames = [datagram(s, s * RECS) for s in range(200)]
+        code, counts = self.run_receiver(frames)
+        self.assertEqual(counts, (0, 0, 0, 0, 0, 0))
+        self.assertEqual(code, 0)
+
+    def test_gaps(self):
+        frames = [datagram(s, s * RECS) for s in range(200)]
+        late = frames.pop(50)               # delayed past two others
+        frames.insert(52, late)
+        del frames[120]                     # lost: seq 120
+        frames.insert(150, frames[149])     # repeated
+        frames.append(b"\x00" * 8)          # runt
+        code, counts = self.run_receiver(frames)
+        self.assertEqual(counts, (1, 1, 1, RECS, 0, 1))
+        self.assertEqual(code, 1)
+
+    def test_device_loss(self):
+        frames = [datagram(s, s * RECS, lost=7 if s >= 100 else 0) for s in range(150)]
+        code, counts = self.run_receiver(frames)
+        self.assertEqual(counts[4], 7)
+        self.assertEqual(code, 1)
+
+
+if __name__ == "__main__":
+    unittest.main(verbosity=1)